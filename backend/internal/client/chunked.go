@@ -0,0 +1,103 @@
+package client
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"syscall"
+)
+
+// streamedHeadTrailer is the 64-bit image data length that ends a version 2
+// response head.
+const streamedHeadTrailer = 8
+
+// readStreamedData completes a version 2 response head. The head ends with
+// the total image data length, and the data follows either in MSG_CHUNK
+// frames (flagChunked) or in the memfd passed with the head (flagSHM). The
+// returned message has the length trailer removed, the data inline,
+// payload_len covering it, and the transport flags cleared.
+func (c *Conn) readStreamedData(head []byte, flags uint32, shmFD int) ([]byte, error) {
+	if len(head) < 16+streamedHeadTrailer {
+		return nil, fmt.Errorf("response head too small: %d bytes", len(head))
+	}
+	transport := flags & (flagChunked | flagSHM)
+	if transport != flagChunked && transport != flagSHM {
+		return nil, fmt.Errorf("invalid response head flags: 0x%08x", flags)
+	}
+
+	fieldsLen := len(head) - streamedHeadTrailer
+	dataLen := binary.BigEndian.Uint64(head[fieldsLen:])
+	if dataLen == 0 || dataLen > maxStreamedDataSize {
+		return nil, fmt.Errorf("response data length invalid: %d bytes (max %d)", dataLen, maxStreamedDataSize)
+	}
+
+	full := make([]byte, fieldsLen+int(dataLen))
+	copy(full, head[:fieldsLen])
+
+	if transport == flagChunked {
+		if err := c.readChunks(full[fieldsLen:]); err != nil {
+			return nil, err
+		}
+	} else {
+		if shmFD < 0 {
+			return nil, errors.New("shared memory response without a file descriptor")
+		}
+		if err := copySharedData(full[fieldsLen:], shmFD); err != nil {
+			return nil, err
+		}
+	}
+
+	binary.BigEndian.PutUint32(full[8:12], uint32(len(full)-16))
+	binary.BigEndian.PutUint32(full[12:16], flags&^transport)
+	return full, nil
+}
+
+// readChunks fills dst from consecutive MSG_CHUNK frames. weave-compute
+// writes a response's chunks back to back, so any other frame is an error.
+func (c *Conn) readChunks(dst []byte) error {
+	header := make([]byte, 16)
+	for filled := 0; filled < len(dst); {
+		if _, err := io.ReadFull(c.conn, header); err != nil {
+			return classifyReadError(err)
+		}
+		if binary.BigEndian.Uint32(header[0:4]) != protocolMagic {
+			return fmt.Errorf("invalid chunk magic: 0x%08x", binary.BigEndian.Uint32(header[0:4]))
+		}
+		if msgType := binary.BigEndian.Uint16(header[6:8]); msgType != msgChunk {
+			return fmt.Errorf("unexpected message type 0x%04x while reading chunks", msgType)
+		}
+
+		chunkLen := int(binary.BigEndian.Uint32(header[8:12]))
+		if chunkLen == 0 || chunkLen > maxChunkSize || chunkLen > len(dst)-filled {
+			return fmt.Errorf("invalid chunk length: %d bytes (%d remaining)", chunkLen, len(dst)-filled)
+		}
+
+		if _, err := io.ReadFull(c.conn, dst[filled:filled+chunkLen]); err != nil {
+			return classifyReadError(err)
+		}
+		filled += chunkLen
+	}
+	return nil
+}
+
+// copySharedData copies the memfd carrying a version 2 response's image data
+// into dst. The memfd must be exactly len(dst) bytes.
+func copySharedData(dst []byte, fd int) error {
+	var st syscall.Stat_t
+	if err := syscall.Fstat(fd, &st); err != nil {
+		return fmt.Errorf("failed to stat shared memory: %w", err)
+	}
+	if st.Size != int64(len(dst)) {
+		return fmt.Errorf("shared memory size invalid: %d bytes, expected %d", st.Size, len(dst))
+	}
+
+	data, err := syscall.Mmap(fd, 0, len(dst), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return fmt.Errorf("failed to map shared memory: %w", err)
+	}
+	defer syscall.Munmap(data)
+
+	copy(dst, data)
+	return nil
+}
@@ -0,0 +1,175 @@
+package client
+
+import (
+	"bytes"
+	"encoding/binary"
+	"os"
+	"syscall"
+	"testing"
+)
+
+// buildTestHead returns a version 2 response head: a test frame whose
+// payload ends with the 64-bit data length.
+func buildTestHead(flags uint32, fields []byte, dataLen uint64) []byte {
+	extra := make([]byte, len(fields)+8)
+	copy(extra, fields)
+	binary.BigEndian.PutUint64(extra[len(fields):], dataLen)
+	head := buildTestFrame(0x0002, 11, extra)
+	binary.BigEndian.PutUint16(head[4:6], protocolVersion2)
+	binary.BigEndian.PutUint32(head[12:16], flags)
+	return head
+}
+
+// buildTestChunk returns a MSG_CHUNK frame carrying data.
+func buildTestChunk(data []byte) []byte {
+	chunk := make([]byte, 16+len(data))
+	binary.BigEndian.PutUint32(chunk[0:4], protocolMagic)
+	binary.BigEndian.PutUint16(chunk[4:6], protocolVersion2)
+	binary.BigEndian.PutUint16(chunk[6:8], msgChunk)
+	binary.BigEndian.PutUint32(chunk[8:12], uint32(len(data)))
+	copy(chunk[16:], data)
+	return chunk
+}
+
+func TestReadFrameChunked(t *testing.T) {
+	fields := []byte{1, 2, 3, 4}
+	// Larger than maxPayloadSize, so only reachable through chunks
+	data := make([]byte, 11*1024*1024)
+	for i := range data {
+		data[i] = byte(i * 7)
+	}
+
+	var chunks []byte
+	for off := 0; off < len(data); off += maxChunkSize {
+		end := off + maxChunkSize
+		if end > len(data) {
+			end = len(data)
+		}
+		chunks = append(chunks, buildTestChunk(data[off:end])...)
+	}
+
+	wrongType := buildTestChunk(data[:16])
+	binary.BigEndian.PutUint16(wrongType[6:8], 0x0005)
+
+	tests := []struct {
+		name    string
+		head    []byte
+		follow  []byte
+		wantErr bool
+	}{
+		{name: "chunks reassembled", head: buildTestHead(flagChunked, fields, uint64(len(data))), follow: chunks},
+		{name: "interleaved frame", head: buildTestHead(flagChunked, fields, 16), follow: wrongType, wantErr: true},
+		{name: "chunk past data length", head: buildTestHead(flagChunked, fields, 8), follow: buildTestChunk(data[:16]), wantErr: true},
+		{name: "oversized chunk", head: buildTestHead(flagChunked, fields, maxChunkSize+1), follow: buildTestChunk(data[:maxChunkSize+1]), wantErr: true},
+		{name: "data length too large", head: buildTestHead(flagChunked, fields, maxStreamedDataSize+1), wantErr: true},
+		{name: "zero data length", head: buildTestHead(flagChunked, fields, 0), wantErr: true},
+		{name: "both data flags", head: buildTestHead(flagChunked|flagSHM, fields, 16), wantErr: true},
+		{name: "other flags kept", head: buildTestHead(flagChunked|0x8, fields, uint64(len(data))), follow: chunks},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			server, clientEnd := unixPair(t)
+			defer server.Close()
+
+			go func() {
+				server.Write(tt.head)
+				server.Write(tt.follow)
+			}()
+
+			conn := &Conn{conn: clientEnd}
+			defer conn.Close()
+
+			got, err := conn.readFrame()
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("readFrame() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+
+			fieldsLen := len(tt.head) - 8
+			if len(got) != fieldsLen+len(data) {
+				t.Fatalf("len = %d, want %d", len(got), fieldsLen+len(data))
+			}
+			if binary.BigEndian.Uint32(got[8:12]) != uint32(len(got)-16) {
+				t.Errorf("payload_len = %d, want %d", binary.BigEndian.Uint32(got[8:12]), len(got)-16)
+			}
+			wantFlags := binary.BigEndian.Uint32(tt.head[12:16]) &^ flagChunked
+			if binary.BigEndian.Uint32(got[12:16]) != wantFlags {
+				t.Errorf("flags = 0x%08x, want 0x%08x", binary.BigEndian.Uint32(got[12:16]), wantFlags)
+			}
+			if !bytes.Equal(got[:8], tt.head[:8]) || !bytes.Equal(got[16:fieldsLen], tt.head[16:fieldsLen]) {
+				t.Errorf("response fields altered")
+			}
+			if !bytes.Equal(got[fieldsLen:], data) {
+				t.Errorf("chunk data does not match")
+			}
+		})
+	}
+}
+
+func TestReadFrameSharedMemoryV2(t *testing.T) {
+	fields := []byte{1, 2, 3, 4}
+	data := bytes.Repeat([]byte{0x5A}, 12*1024*1024)
+
+	tests := []struct {
+		name    string
+		dataLen uint64
+		passFD  bool
+		wantErr bool
+	}{
+		{name: "shm data appended", dataLen: uint64(len(data)), passFD: true},
+		{name: "shm size mismatch", dataLen: uint64(len(data)) - 1, passFD: true, wantErr: true},
+		{name: "shm head without fd", dataLen: uint64(len(data)), wantErr: true},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			server, clientEnd := unixPair(t)
+			defer server.Close()
+
+			head := buildTestHead(flagSHM, fields, tt.dataLen)
+			var oob []byte
+			if tt.passFD {
+				f, err := os.CreateTemp(t.TempDir(), "shm")
+				if err != nil {
+					t.Fatalf("CreateTemp() error = %v", err)
+				}
+				defer f.Close()
+				if _, err := f.Write(data); err != nil {
+					t.Fatalf("Write() error = %v", err)
+				}
+				oob = syscall.UnixRights(int(f.Fd()))
+			}
+			if _, _, err := server.WriteMsgUnix(head, oob, nil); err != nil {
+				t.Fatalf("WriteMsgUnix() error = %v", err)
+			}
+
+			conn := &Conn{conn: clientEnd}
+			defer conn.Close()
+
+			got, err := conn.readFrame()
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("readFrame() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+
+			fieldsLen := len(head) - 8
+			if len(got) != fieldsLen+len(data) {
+				t.Fatalf("len = %d, want %d", len(got), fieldsLen+len(data))
+			}
+			if binary.BigEndian.Uint32(got[8:12]) != uint32(len(got)-16) {
+				t.Errorf("payload_len = %d, want %d", binary.BigEndian.Uint32(got[8:12]), len(got)-16)
+			}
+			if binary.BigEndian.Uint32(got[12:16]) != 0 {
+				t.Errorf("flags = 0x%08x, want 0", binary.BigEndian.Uint32(got[12:16]))
+			}
+			if !bytes.Equal(got[fieldsLen:], data) {
+				t.Errorf("shared data does not match")
+			}
+		})
+	}
+}
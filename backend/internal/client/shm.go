@@ -0,0 +1,102 @@
+package client
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"syscall"
+)
+
+// maxPassedFDs is how many descriptors a single header read accepts. The
+// compute process sends at most one; extras are closed.
+const maxPassedFDs = 4
+
+// readHeader fills header from the socket. On Unix sockets it also collects a
+// file descriptor passed with SCM_RIGHTS alongside the header bytes and
+// returns it (caller must close), or -1 if none arrived.
+func (c *Conn) readHeader(header []byte) (int, error) {
+	unixConn, ok := c.conn.(*net.UnixConn)
+	if !ok {
+		if _, err := io.ReadFull(c.conn, header); err != nil {
+			return -1, classifyReadError(err)
+		}
+		return -1, nil
+	}
+
+	oob := make([]byte, syscall.CmsgSpace(4*maxPassedFDs))
+	shmFD := -1
+	read := 0
+	for read < len(header) {
+		n, oobn, _, _, err := unixConn.ReadMsgUnix(header[read:], oob)
+		if oobn > 0 {
+			for _, fd := range parseRights(oob[:oobn]) {
+				if shmFD < 0 {
+					shmFD = fd
+				} else {
+					syscall.Close(fd)
+				}
+			}
+		}
+		read += n
+		if err != nil {
+			if shmFD >= 0 {
+				syscall.Close(shmFD)
+			}
+			if read > 0 && errors.Is(err, io.EOF) {
+				err = io.ErrUnexpectedEOF
+			}
+			return -1, classifyReadError(err)
+		}
+	}
+
+	return shmFD, nil
+}
+
+// parseRights extracts the descriptors from SCM_RIGHTS control messages.
+func parseRights(oob []byte) []int {
+	msgs, err := syscall.ParseSocketControlMessage(oob)
+	if err != nil {
+		return nil
+	}
+	var fds []int
+	for i := range msgs {
+		rights, err := syscall.ParseUnixRights(&msgs[i])
+		if err == nil {
+			fds = append(fds, rights...)
+		}
+	}
+	return fds
+}
+
+// appendSharedTail maps the memfd carrying the rest of a flagSHM message's
+// payload and returns the message with that tail inline, payload_len
+// restored, and the flag cleared.
+func appendSharedTail(message []byte, fd int) ([]byte, error) {
+	var st syscall.Stat_t
+	if err := syscall.Fstat(fd, &st); err != nil {
+		return nil, fmt.Errorf("failed to stat shared memory: %w", err)
+	}
+
+	inlineLen := uint64(len(message) - 16)
+	if st.Size <= 0 || uint64(st.Size)+inlineLen > maxPayloadSize {
+		return nil, fmt.Errorf("shared memory size invalid: %d bytes with %d inline (max %d)",
+			st.Size, inlineLen, maxPayloadSize)
+	}
+	tailLen := int(st.Size)
+
+	tail, err := syscall.Mmap(fd, 0, tailLen, syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("failed to map shared memory: %w", err)
+	}
+	defer syscall.Munmap(tail)
+
+	full := make([]byte, len(message)+tailLen)
+	copy(full, message)
+	copy(full[len(message):], tail)
+
+	binary.BigEndian.PutUint32(full[8:12], uint32(inlineLen)+uint32(tailLen))
+	binary.BigEndian.PutUint32(full[12:16], binary.BigEndian.Uint32(full[12:16])&^flagSHM)
+	return full, nil
+}
@@ -0,0 +1,103 @@
+package client
+
+import (
+	"bytes"
+	"encoding/binary"
+	"net"
+	"os"
+	"syscall"
+	"testing"
+)
+
+// unixPair returns two connected *net.UnixConn ends.
+func unixPair(t *testing.T) (*net.UnixConn, *net.UnixConn) {
+	t.Helper()
+	fds, err := syscall.Socketpair(syscall.AF_UNIX, syscall.SOCK_STREAM, 0)
+	if err != nil {
+		t.Fatalf("Socketpair() error = %v", err)
+	}
+	ends := make([]*net.UnixConn, 2)
+	for i, fd := range fds {
+		f := os.NewFile(uintptr(fd), "socketpair")
+		c, err := net.FileConn(f)
+		f.Close()
+		if err != nil {
+			t.Fatalf("FileConn() error = %v", err)
+		}
+		ends[i] = c.(*net.UnixConn)
+	}
+	return ends[0], ends[1]
+}
+
+func TestReadFrameSharedMemory(t *testing.T) {
+	tail := bytes.Repeat([]byte{0xC3}, 64*1024)
+	inline := []byte{1, 2, 3, 4}
+
+	tests := []struct {
+		name    string
+		flags   uint32
+		passFD  bool
+		wantErr bool
+	}{
+		{name: "shm tail appended", flags: flagSHM, passFD: true},
+		{name: "shm flag without fd", flags: flagSHM, passFD: false, wantErr: true},
+		{name: "unexpected fd ignored", flags: 0, passFD: true},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			server, clientEnd := unixPair(t)
+			defer server.Close()
+
+			frame := buildTestFrame(0x0002, 9, inline)
+			binary.BigEndian.PutUint32(frame[12:16], tt.flags)
+
+			var oob []byte
+			if tt.passFD {
+				f, err := os.CreateTemp(t.TempDir(), "shm")
+				if err != nil {
+					t.Fatalf("CreateTemp() error = %v", err)
+				}
+				defer f.Close()
+				if _, err := f.Write(tail); err != nil {
+					t.Fatalf("Write() error = %v", err)
+				}
+				oob = syscall.UnixRights(int(f.Fd()))
+			}
+			if _, _, err := server.WriteMsgUnix(frame, oob, nil); err != nil {
+				t.Fatalf("WriteMsgUnix() error = %v", err)
+			}
+
+			conn := &Conn{conn: clientEnd}
+			defer conn.Close()
+
+			got, err := conn.readFrame()
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("readFrame() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+
+			wantLen := len(frame)
+			if tt.flags&flagSHM != 0 {
+				wantLen += len(tail)
+			}
+			if len(got) != wantLen {
+				t.Fatalf("len = %d, want %d", len(got), wantLen)
+			}
+			if binary.BigEndian.Uint32(got[8:12]) != uint32(wantLen-16) {
+				t.Errorf("payload_len = %d, want %d", binary.BigEndian.Uint32(got[8:12]), wantLen-16)
+			}
+			if binary.BigEndian.Uint32(got[12:16])&flagSHM != 0 {
+				t.Errorf("flagSHM still set")
+			}
+			if tt.flags == 0 && !bytes.Equal(got, frame) {
+				t.Errorf("inline frame altered")
+			}
+			if tt.flags&flagSHM != 0 && !bytes.Equal(got[len(frame):], tail) {
+				t.Errorf("shared tail does not match")
+			}
+		})
+	}
+}
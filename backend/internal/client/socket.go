@@ -53,6 +53,30 @@ const (
 	readTimeout = 65 * time.Second
 	// maxPayloadSize is the maximum size of a response payload (10 MB)
 	maxPayloadSize = 10 * 1024 * 1024
+	// msgGenerateProgress is the MSG_GENERATE_PROGRESS message type (header bytes 6-7)
+	msgGenerateProgress = 0x0005
+	// msgCancel is the MSG_CANCEL message type (header bytes 6-7)
+	msgCancel = 0x0006
+	// msgGenerateTimings is the MSG_GENERATE_TIMINGS trailer sent after a response
+	msgGenerateTimings = 0x0008
+	// flagTimings asks for a timings trailer after the response (header bytes 12-15)
+	flagTimings = 0x00000010
+	// protocolMagic and protocolVersion start every header; only cancel frames are built here
+	protocolMagic   = 0x57455645
+	protocolVersion = 0x0001
+	// flagSHM marks a message whose payload tail is in a passed memfd (header bytes 12-15)
+	flagSHM = 0x00000002
+	// protocolVersion2 responses stream image data after a response head
+	protocolVersion2 = 0x0002
+	// msgChunk is the MSG_CHUNK message type carrying part of a version 2 response
+	msgChunk = 0x0007
+	// flagChunked marks a version 2 response head followed by MSG_CHUNK frames
+	flagChunked = 0x00000004
+	// maxChunkSize is the largest data length of one MSG_CHUNK frame (1 MB)
+	maxChunkSize = 1024 * 1024
+	// maxStreamedDataSize bounds the image data of a version 2 response
+	// (a batch of 8 RGBA images at 2048x2048)
+	maxStreamedDataSize = 8 * 2048 * 2048 * 4
 )
 
 var (
@@ -74,6 +98,18 @@ var (
 	ErrReaderDead = errors.New("response reader goroutine has stopped")
 )
 
+// ProgressFunc receives MSG_GENERATE_PROGRESS frames (header + payload) for a
+// request sent with SendWithProgress. It runs on the connection's reader
+// goroutine and must not block.
+type ProgressFunc func(frame []byte)
+
+// TimingsFunc receives MSG_GENERATE_TIMINGS frames (header + payload), which
+// compute sends after the response to a request whose header sets the
+// timings flag. The response has already been returned to its caller, so
+// frames are matched to requests by the request ID they carry. It runs on
+// the goroutine reading the connection and must not block.
+type TimingsFunc func(frame []byte)
+
 // Conn represents a connection to the weave-compute process.
 //
 // For persistent connections (created via AcceptConnection), the connection
@@ -86,10 +122,12 @@ type Conn struct {
 	conn net.Conn
 
 	// Multiplexing fields (nil for per-request connections)
-	mu              sync.Mutex
-	pendingRequests map[uint64]chan []byte // Maps request ID to response channel
-	readerDone      chan struct{}          // Closed when response reader exits
-	readerErr       error                  // Error from response reader (if any)
+	mu               sync.Mutex
+	pendingRequests  map[uint64]chan []byte  // Maps request ID to response channel
+	progressHandlers map[uint64]ProgressFunc // Maps request ID to progress handler
+	onTimings        TimingsFunc             // Receives timings trailers (nil = discard)
+	readerDone       chan struct{}           // Closed when response reader exits
+	readerErr        error                   // Error from response reader (if any)
 }
 
 // Connect establishes a connection to the weave-compute process.
@@ -179,9 +217,10 @@ func AcceptConnection(ctx context.Context, listener net.Listener) (*Conn, error)
 
 	// Create multiplexed connection
 	c := &Conn{
-		conn:            conn,
-		pendingRequests: make(map[uint64]chan []byte),
-		readerDone:      make(chan struct{}),
+		conn:             conn,
+		pendingRequests:  make(map[uint64]chan []byte),
+		progressHandlers: make(map[uint64]ProgressFunc),
+		readerDone:       make(chan struct{}),
 	}
 
 	// Start response reader goroutine
@@ -221,15 +260,18 @@ func (c *Conn) RawConn() net.Conn {
 //
 // The reader extracts the request ID from each response header (bytes 16-23)
 // and delivers the response to the corresponding channel in pendingRequests.
+// MSG_GENERATE_PROGRESS frames go to the request's progress handler instead
+// and leave the request pending. MSG_GENERATE_TIMINGS frames follow the
+// response and go to the connection's timings handler.
 func (c *Conn) responseReader() {
 	defer close(c.readerDone)
 
 	for {
-		// Read response header (16 bytes)
-		header := make([]byte, 16)
-		if _, err := io.ReadFull(c.conn, header); err != nil {
+		// Read one complete message (header + payload)
+		response, err := c.readFrame()
+		if err != nil {
 			c.mu.Lock()
-			c.readerErr = classifyReadError(err)
+			c.readerErr = err
 			// Notify all pending requests of the error
 			for _, ch := range c.pendingRequests {
 				close(ch)
@@ -239,55 +281,39 @@ func (c *Conn) responseReader() {
 			return
 		}
 
-		// Extract payload length from header (bytes 8-11, big-endian)
-		payloadLen := binary.BigEndian.Uint32(header[8:12])
+		// Extract request ID from response payload (bytes 16-23, little-endian)
+		// The protocol has: Header (16 bytes) + RequestID (8 bytes) + ...
+		if len(response) < 24 {
+			// Response too short to contain request ID - skip it
+			continue
+		}
+		requestID := binary.LittleEndian.Uint64(response[16:24])
 
-		// Validate payload length
-		if payloadLen > maxPayloadSize {
+		// Progress frames precede the final response for the same request ID
+		if binary.BigEndian.Uint16(response[6:8]) == msgGenerateProgress {
 			c.mu.Lock()
-			c.readerErr = fmt.Errorf("payload too large: %d bytes (max %d)", payloadLen, maxPayloadSize)
-			// Notify all pending requests of the error
-			for _, ch := range c.pendingRequests {
-				close(ch)
-			}
-			c.pendingRequests = make(map[uint64]chan []byte)
+			onProgress := c.progressHandlers[requestID]
 			c.mu.Unlock()
-			return
-		}
-
-		// Allocate buffer for full message (header + payload)
-		totalLen := 16 + payloadLen
-		response := make([]byte, totalLen)
-		copy(response, header)
-
-		// Read remaining payload
-		if payloadLen > 0 {
-			if _, err := io.ReadFull(c.conn, response[16:]); err != nil {
-				c.mu.Lock()
-				c.readerErr = classifyReadError(err)
-				// Notify all pending requests of the error
-				for _, ch := range c.pendingRequests {
-					close(ch)
-				}
-				c.pendingRequests = make(map[uint64]chan []byte)
-				c.mu.Unlock()
-				return
+			if onProgress != nil {
+				onProgress(response)
 			}
+			continue
 		}
 
-		// Extract request ID from response payload (bytes 16-23, little-endian)
-		// The protocol has: Header (16 bytes) + RequestID (8 bytes) + ...
-		if len(response) < 24 {
-			// Response too short to contain request ID - skip it
+		// Timings trailers follow a response that has already been delivered
+		if binary.BigEndian.Uint16(response[6:8]) == msgGenerateTimings {
+			if onTimings := c.timingsHandler(); onTimings != nil {
+				onTimings(response)
+			}
 			continue
 		}
-		requestID := binary.LittleEndian.Uint64(response[16:24])
 
 		// Route response to the correct pending request
 		c.mu.Lock()
 		ch, ok := c.pendingRequests[requestID]
 		if ok {
 			delete(c.pendingRequests, requestID)
+			delete(c.progressHandlers, requestID)
 			c.mu.Unlock()
 
 			// Send response to waiting goroutine
@@ -305,6 +331,22 @@ func (c *Conn) responseReader() {
 	}
 }
 
+// SetTimingsHandler sets the function that receives timings trailers on
+// this connection. Trailers that arrive while no handler is set are
+// discarded. fn may be nil.
+func (c *Conn) SetTimingsHandler(fn TimingsFunc) {
+	c.mu.Lock()
+	c.onTimings = fn
+	c.mu.Unlock()
+}
+
+// timingsHandler returns the current timings handler.
+func (c *Conn) timingsHandler() TimingsFunc {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.onTimings
+}
+
 // Send sends a protocol message to the compute process and reads the response.
 //
 // For multiplexed connections (created via AcceptConnection), this method:
@@ -324,6 +366,14 @@ func (c *Conn) responseReader() {
 //
 // Returns the response bytes or an error if the send/receive fails.
 func (c *Conn) Send(ctx context.Context, request []byte) ([]byte, error) {
+	return c.SendWithProgress(ctx, request, nil)
+}
+
+// SendWithProgress behaves like Send, and additionally passes every
+// MSG_GENERATE_PROGRESS frame received for the request to onProgress before
+// the final response is returned. Progress frames are only sent when the
+// request header sets the progress flag. onProgress may be nil.
+func (c *Conn) SendWithProgress(ctx context.Context, request []byte, onProgress ProgressFunc) ([]byte, error) {
 	if c.conn == nil {
 		return nil, errors.New("connection is nil")
 	}
@@ -335,17 +385,32 @@ func (c *Conn) Send(ctx context.Context, request []byte) ([]byte, error) {
 
 	// Check if this is a multiplexed connection
 	if c.pendingRequests != nil {
-		return c.sendMultiplexed(ctx, request)
+		return c.sendMultiplexed(ctx, request, onProgress)
 	}
 
 	// Non-multiplexed connection (legacy behavior)
-	return c.sendDirect(ctx, request)
+	return c.sendDirect(ctx, request, onProgress)
+}
+
+// Notify writes a message compute does not reply to, such as MSG_PREPARE,
+// without waiting for anything. Compute drops an invalid MSG_PREPARE without
+// a reply too, so nothing is ever read back for it.
+func (c *Conn) Notify(message []byte) error {
+	if c.conn == nil {
+		return errors.New("connection is nil")
+	}
+
+	// Protected by the net.Conn's internal locking, like request writes
+	if _, err := c.conn.Write(message); err != nil {
+		return fmt.Errorf("failed to write message: %w", err)
+	}
+	return nil
 }
 
 // sendMultiplexed sends a request over a multiplexed connection.
 // It extracts the request ID, registers a response channel, and waits for
 // the response reader to deliver the response.
-func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, error) {
+func (c *Conn) sendMultiplexed(ctx context.Context, request []byte, onProgress ProgressFunc) ([]byte, error) {
 	// Extract request ID from request (bytes 16-23, little-endian)
 	// Protocol: Header (16 bytes) + RequestID (8 bytes) + ...
 	if len(request) < 24 {
@@ -369,6 +434,9 @@ func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, err
 	default:
 	}
 	c.pendingRequests[requestID] = responseCh
+	if onProgress != nil {
+		c.progressHandlers[requestID] = onProgress
+	}
 	c.mu.Unlock()
 
 	// Write request to socket
@@ -377,6 +445,7 @@ func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, err
 		// Remove pending request on write failure
 		c.mu.Lock()
 		delete(c.pendingRequests, requestID)
+		delete(c.progressHandlers, requestID)
 		c.mu.Unlock()
 		return nil, fmt.Errorf("failed to write request: %w", err)
 	}
@@ -390,6 +459,7 @@ func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, err
 			// Context already expired
 			c.mu.Lock()
 			delete(c.pendingRequests, requestID)
+			delete(c.progressHandlers, requestID)
 			c.mu.Unlock()
 			return nil, ctx.Err()
 		}
@@ -400,23 +470,28 @@ func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, err
 
 	select {
 	case <-ctx.Done():
-		// Context cancelled - remove pending request
+		// Context cancelled - remove pending request and stop the generation
 		c.mu.Lock()
 		delete(c.pendingRequests, requestID)
+		delete(c.progressHandlers, requestID)
 		c.mu.Unlock()
+		c.sendCancel(request[16:24])
 		return nil, ctx.Err()
 
 	case <-timer.C:
-		// Timeout - remove pending request
+		// Timeout - remove pending request and stop the generation
 		c.mu.Lock()
 		delete(c.pendingRequests, requestID)
+		delete(c.progressHandlers, requestID)
 		c.mu.Unlock()
+		c.sendCancel(request[16:24])
 		return nil, ErrReadTimeout
 
 	case <-c.readerDone:
 		// Response reader died - return error
 		c.mu.Lock()
 		delete(c.pendingRequests, requestID)
+		delete(c.progressHandlers, requestID)
 		err := c.readerErr
 		c.mu.Unlock()
 		if err != nil {
@@ -439,9 +514,30 @@ func (c *Conn) sendMultiplexed(ctx context.Context, request []byte) ([]byte, err
 	}
 }
 
+// sendCancel asks compute to abandon a request the caller stopped waiting
+// for, so it does not keep the GPU busy. rawID is the request ID exactly as
+// encoded in the request (bytes 16-23). Best effort: write errors are ignored
+// because the response reader reports a broken connection. Compute replies
+// to the cancelled request with ERR_CANCELLED, or as usual if it already
+// finished; either way the reader discards the unclaimed response.
+func (c *Conn) sendCancel(rawID []byte) {
+	frame := make([]byte, 24)
+	binary.BigEndian.PutUint32(frame[0:4], protocolMagic)
+	binary.BigEndian.PutUint16(frame[4:6], protocolVersion)
+	binary.BigEndian.PutUint16(frame[6:8], msgCancel)
+	binary.BigEndian.PutUint32(frame[8:12], 8)
+	copy(frame[16:24], rawID)
+
+	// Protected by the net.Conn's internal locking, like request writes
+	_, _ = c.conn.Write(frame)
+}
+
 // sendDirect sends a request over a non-multiplexed connection (legacy behavior).
-// This is the original implementation used by Connect().
-func (c *Conn) sendDirect(ctx context.Context, request []byte) ([]byte, error) {
+// This is the original implementation used by Connect(). Progress frames are
+// read inline and handed to onProgress until the final response arrives.
+// When the request asks for timings, the trailer is read before returning so
+// it does not precede the next request's response.
+func (c *Conn) sendDirect(ctx context.Context, request []byte, onProgress ProgressFunc) ([]byte, error) {
 	// Write request to socket
 	if _, err := c.conn.Write(request); err != nil {
 		return nil, fmt.Errorf("failed to write request: %w", err)
@@ -456,10 +552,52 @@ func (c *Conn) sendDirect(ctx context.Context, request []byte) ([]byte, error) {
 		return nil, fmt.Errorf("failed to reset read deadline: %w", err)
 	}
 
+	for {
+		response, err := c.readFrame()
+		if err != nil {
+			return nil, err
+		}
+		if binary.BigEndian.Uint16(response[6:8]) != msgGenerateProgress {
+			c.readTimingsTrailer(request)
+			return response, nil
+		}
+		if onProgress != nil {
+			onProgress(response)
+		}
+	}
+}
+
+// readTimingsTrailer reads the timings trailer that follows the response to
+// request on a non-multiplexed connection, if request asked for one. The
+// response has already arrived, so a failed read is left for the next
+// request to report.
+func (c *Conn) readTimingsTrailer(request []byte) {
+	if len(request) < 16 || binary.BigEndian.Uint32(request[12:16])&flagTimings == 0 {
+		return
+	}
+
+	frame, err := c.readFrame()
+	if err != nil || binary.BigEndian.Uint16(frame[6:8]) != msgGenerateTimings {
+		return
+	}
+	if onTimings := c.timingsHandler(); onTimings != nil {
+		onTimings(frame)
+	}
+}
+
+// readFrame reads one complete message (header + payload) from the socket.
+// Image data that arrived in shared memory (flagSHM) or, for version 2
+// responses, in MSG_CHUNK frames is appended to the payload, so callers
+// always see a regular inline message.
+func (c *Conn) readFrame() ([]byte, error) {
 	// Read response header first (16 bytes) to determine payload length
 	header := make([]byte, 16)
-	if _, err := io.ReadFull(c.conn, header); err != nil {
-		return nil, classifyReadError(err)
+	shmFD, err := c.readHeader(header)
+	if err != nil {
+		return nil, err
+	}
+	if shmFD >= 0 {
+		defer syscall.Close(shmFD)
 	}
 
 	// Extract payload length from header (bytes 8-11, big-endian)
@@ -482,7 +620,17 @@ func (c *Conn) sendDirect(ctx context.Context, request []byte) ([]byte, error) {
 		}
 	}
 
-	return response, nil
+	flags := binary.BigEndian.Uint32(header[12:16])
+	if binary.BigEndian.Uint16(header[4:6]) >= protocolVersion2 && flags&(flagChunked|flagSHM) != 0 {
+		return c.readStreamedData(response, flags, shmFD)
+	}
+	if flags&flagSHM == 0 {
+		return response, nil
+	}
+	if shmFD < 0 {
+		return nil, errors.New("shared memory response without a file descriptor")
+	}
+	return appendSharedTail(response, shmFD)
 }
 
 // getSocketPath constructs the socket path from XDG_RUNTIME_DIR
@@ -1,7 +1,9 @@
 package client
 
 import (
+	"bytes"
 	"context"
+	"encoding/binary"
 	"errors"
 	"io"
 	"net"
@@ -1077,3 +1079,238 @@ func TestMultiplexedCloseWaitsForReader(t *testing.T) {
 		t.Error("Close() did not wait for response reader to exit")
 	}
 }
+
+// buildTestFrame builds a message with the given type whose payload starts
+// with requestID (little-endian, as the client extracts it) followed by extra.
+func buildTestFrame(msgType uint16, requestID uint64, extra []byte) []byte {
+	frame := make([]byte, 24+len(extra))
+	binary.BigEndian.PutUint32(frame[0:4], 0x57455645)
+	binary.BigEndian.PutUint16(frame[4:6], 0x0001)
+	binary.BigEndian.PutUint16(frame[6:8], msgType)
+	binary.BigEndian.PutUint32(frame[8:12], uint32(8+len(extra)))
+	binary.LittleEndian.PutUint64(frame[16:24], requestID)
+	copy(frame[24:], extra)
+	return frame
+}
+
+// serveProgress reads one 28-byte request from conn, then writes two progress
+// frames and a final response for requestID.
+func serveProgress(conn net.Conn, requestID uint64) {
+	request := make([]byte, 28)
+	if _, err := io.ReadFull(conn, request); err != nil {
+		return
+	}
+	conn.Write(buildTestFrame(msgGenerateProgress, requestID, []byte{1}))
+	conn.Write(buildTestFrame(msgGenerateProgress, requestID, []byte{2}))
+	conn.Write(buildTestFrame(0x0002, requestID, []byte{0xAA}))
+}
+
+func TestSendWithProgress(t *testing.T) {
+	tests := []struct {
+		name        string
+		multiplexed bool
+	}{
+		{name: "multiplexed", multiplexed: true},
+		{name: "direct", multiplexed: false},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			serverConn, clientConn := net.Pipe()
+			defer serverConn.Close()
+			go serveProgress(serverConn, 123)
+
+			conn := &Conn{conn: clientConn}
+			if tt.multiplexed {
+				conn.pendingRequests = make(map[uint64]chan []byte)
+				conn.progressHandlers = make(map[uint64]ProgressFunc)
+				conn.readerDone = make(chan struct{})
+				go conn.responseReader()
+			}
+			defer conn.Close()
+
+			var steps []byte
+			onProgress := func(frame []byte) {
+				steps = append(steps, frame[24])
+			}
+
+			ctx, cancel := context.WithTimeout(context.Background(), 2*time.Second)
+			defer cancel()
+
+			response, err := conn.SendWithProgress(ctx, buildTestFrame(0x0001, 123, make([]byte, 4)), onProgress)
+			if err != nil {
+				t.Fatalf("SendWithProgress() error = %v", err)
+			}
+			if binary.BigEndian.Uint16(response[6:8]) != 0x0002 || response[24] != 0xAA {
+				t.Errorf("SendWithProgress() returned a progress frame instead of the response")
+			}
+			if string(steps) != "\x01\x02" {
+				t.Errorf("progress frames = %v, want [1 2]", steps)
+			}
+			if tt.multiplexed && len(conn.progressHandlers) != 0 {
+				t.Errorf("progress handler not removed after response")
+			}
+		})
+	}
+}
+
+// TestMultiplexedSendCancels verifies that a caller giving up on a request
+// sends MSG_CANCEL with the request ID bytes copied from the request.
+func TestMultiplexedSendCancels(t *testing.T) {
+	serverConn, clientConn := net.Pipe()
+	defer serverConn.Close()
+
+	conn := &Conn{
+		conn:             clientConn,
+		pendingRequests:  make(map[uint64]chan []byte),
+		progressHandlers: make(map[uint64]ProgressFunc),
+		readerDone:       make(chan struct{}),
+	}
+	go conn.responseReader()
+	defer conn.Close()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+
+	request := buildTestFrame(0x0001, 77, make([]byte, 4))
+	cancelCh := make(chan []byte, 1)
+	go func() {
+		// Read the request, give up on it without answering, then read the cancel
+		if _, err := io.ReadFull(serverConn, make([]byte, len(request))); err != nil {
+			return
+		}
+		cancel()
+		frame := make([]byte, 24)
+		if _, err := io.ReadFull(serverConn, frame); err != nil {
+			return
+		}
+		cancelCh <- frame
+	}()
+
+	if _, err := conn.Send(ctx, request); !errors.Is(err, context.Canceled) {
+		t.Fatalf("Send() error = %v, want %v", err, context.Canceled)
+	}
+
+	select {
+	case frame := <-cancelCh:
+		if got := binary.BigEndian.Uint16(frame[6:8]); got != msgCancel {
+			t.Errorf("msg_type = 0x%04x, want 0x%04x", got, msgCancel)
+		}
+		if got := binary.BigEndian.Uint32(frame[8:12]); got != 8 {
+			t.Errorf("payload_len = %d, want 8", got)
+		}
+		if !bytes.Equal(frame[16:24], request[16:24]) {
+			t.Errorf("request ID = %x, want %x", frame[16:24], request[16:24])
+		}
+	case <-time.After(time.Second):
+		t.Fatal("no cancel frame written after the context expired")
+	}
+}
+
+// TestSendWithTimings verifies that the timings trailer after a response
+// reaches the connection's timings handler and is not mistaken for the
+// response to the next request.
+func TestSendWithTimings(t *testing.T) {
+	tests := []struct {
+		name        string
+		multiplexed bool
+	}{
+		{name: "multiplexed", multiplexed: true},
+		{name: "direct", multiplexed: false},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			serverConn, clientConn := net.Pipe()
+			defer serverConn.Close()
+			go func() {
+				// Two requests: the first answered with a trailer, the second without
+				request := make([]byte, 28)
+				for _, marker := range []byte{0xAA, 0xBB} {
+					if _, err := io.ReadFull(serverConn, request); err != nil {
+						return
+					}
+					serverConn.Write(buildTestFrame(0x0002, 9, []byte{marker}))
+					if marker == 0xAA {
+						serverConn.Write(buildTestFrame(msgGenerateTimings, 9, []byte{0x7F}))
+					}
+				}
+			}()
+
+			conn := &Conn{conn: clientConn}
+			if tt.multiplexed {
+				conn.pendingRequests = make(map[uint64]chan []byte)
+				conn.progressHandlers = make(map[uint64]ProgressFunc)
+				conn.readerDone = make(chan struct{})
+				go conn.responseReader()
+			}
+			defer conn.Close()
+
+			timingsCh := make(chan []byte, 1)
+			conn.SetTimingsHandler(func(frame []byte) { timingsCh <- frame })
+
+			ctx, cancel := context.WithTimeout(context.Background(), 2*time.Second)
+			defer cancel()
+
+			request := buildTestFrame(0x0001, 9, make([]byte, 4))
+			binary.BigEndian.PutUint32(request[12:16], flagTimings)
+			response, err := conn.Send(ctx, request)
+			if err != nil {
+				t.Fatalf("Send() error = %v", err)
+			}
+			if response[24] != 0xAA {
+				t.Errorf("first response marker = 0x%02x, want 0xAA", response[24])
+			}
+
+			select {
+			case frame := <-timingsCh:
+				if frame[24] != 0x7F {
+					t.Errorf("timings marker = 0x%02x, want 0x7F", frame[24])
+				}
+			case <-time.After(time.Second):
+				t.Fatal("timings handler not called")
+			}
+
+			response, err = conn.Send(ctx, buildTestFrame(0x0001, 9, make([]byte, 4)))
+			if err != nil {
+				t.Fatalf("second Send() error = %v", err)
+			}
+			if response[24] != 0xBB {
+				t.Errorf("second response marker = 0x%02x, want 0xBB", response[24])
+			}
+		})
+	}
+}
+
+func TestNotify(t *testing.T) {
+	clientConn, serverConn := net.Pipe()
+	defer serverConn.Close()
+
+	conn := &Conn{
+		conn:            clientConn,
+		pendingRequests: make(map[uint64]chan []byte),
+		readerDone:      make(chan struct{}),
+	}
+	defer clientConn.Close()
+
+	message := []byte("prepare message")
+	received := make(chan []byte, 1)
+	go func() {
+		buf := make([]byte, len(message))
+		if _, err := io.ReadFull(serverConn, buf); err == nil {
+			received <- buf
+		}
+	}()
+
+	if err := conn.Notify(message); err != nil {
+		t.Fatalf("Notify() error = %v", err)
+	}
+	select {
+	case got := <-received:
+		if !bytes.Equal(got, message) {
+			t.Errorf("server read %q, want %q", got, message)
+		}
+	case <-time.After(time.Second):
+		t.Fatal("server did not receive the message")
+	}
+}
@@ -87,6 +87,11 @@ type Config struct {
 	Height int
 	Seed   int64
 
+	// CLIPOnly asks compute to condition on CLIP-L/G without T5-XXL. The
+	// model must be loaded without T5-XXL or have a CLIP-only counterpart;
+	// compute refuses the request otherwise.
+	CLIPOnly bool
+
 	// LLM configuration
 	LLMSeed     int64
 	OllamaURL   string
@@ -121,6 +126,7 @@ func Parse(args []string, output io.Writer) (*Config, error) {
 	fs.IntVar(&c.Width, "width", defaultWidth, "Image width in pixels")
 	fs.IntVar(&c.Height, "height", defaultHeight, "Image height in pixels")
 	fs.Int64Var(&c.Seed, "seed", defaultSeed, "Image generation seed (-1 = random)")
+	fs.BoolVar(&c.CLIPOnly, "clip-only", false, "Condition images on CLIP only, without T5-XXL")
 
 	// LLM flags
 	fs.Int64Var(&c.LLMSeed, "llm-seed", defaultLLMSeed, "LLM seed for deterministic responses (0 = random)")
@@ -224,6 +230,8 @@ FLAGS:
     --width <WIDTH>            Image width in pixels (default: %d)
     --height <HEIGHT>          Image height in pixels (default: %d)
     --seed <SEED>              Image generation seed, -1 = random (default: %d)
+    --clip-only                Condition images on CLIP only, without T5-XXL (faster
+                               encode; needs a CLIP-only model in weave-compute)
     --llm-seed <SEED>          LLM seed for deterministic responses, 0 = random (default: %d)
     --ollama-url <URL>         Ollama API endpoint (default: %s)
     --ollama-model <MODEL>     Ollama model name (default: %s)
@@ -506,6 +506,25 @@ func TestLoadAgentPrompt_UnreadableFile(t *testing.T) {
 	}
 }
 
+func TestParse_CLIPOnlyFlag(t *testing.T) {
+	output := &bytes.Buffer{}
+	cfg, err := Parse([]string{}, output)
+	if err != nil {
+		t.Fatalf("Parse() error = %v, want nil", err)
+	}
+	if cfg.CLIPOnly {
+		t.Error("CLIPOnly = true, want false by default")
+	}
+
+	cfg, err = Parse([]string{"--clip-only"}, output)
+	if err != nil {
+		t.Fatalf("Parse(--clip-only) error = %v, want nil", err)
+	}
+	if !cfg.CLIPOnly {
+		t.Error("CLIPOnly = false, want true with --clip-only")
+	}
+}
+
 func TestParse_AgentPromptFlag(t *testing.T) {
 	tests := []struct {
 		name           string
@@ -408,6 +408,39 @@ func (m *Manager) GetMessage(id int) *ConversationMessage {
 	return nil
 }
 
+// SetMessageComputeRequest records the compute request_id that generated the
+// preview of a message with a snapshot.
+//
+// If the message doesn't exist or has no snapshot, this method does nothing.
+func (m *Manager) SetMessageComputeRequest(id int, requestID uint64) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	for i := range m.conv.messages {
+		if m.conv.messages[i].ID == id && m.conv.messages[i].Snapshot != nil {
+			m.conv.messages[i].Snapshot.ComputeRequestID = requestID
+			m.triggerOnChangeLocked()
+			return
+		}
+	}
+}
+
+// LastComputeRequest returns the compute request_id of the most recent
+// completed preview, the image a refinement would start from. Returns false
+// if no message has one.
+func (m *Manager) LastComputeRequest() (uint64, bool) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	for i := len(m.conv.messages) - 1; i >= 0; i-- {
+		snapshot := m.conv.messages[i].Snapshot
+		if snapshot != nil && snapshot.PreviewStatus == PreviewStatusComplete && snapshot.ComputeRequestID != 0 {
+			return snapshot.ComputeRequestID, true
+		}
+	}
+	return 0, false
+}
+
 // UpdateMessagePreview updates the preview status and URL for a message with a snapshot.
 // This is called when a preview image is generated or generation completes.
 //
@@ -262,6 +262,48 @@ func TestUpdateMessagePreview(t *testing.T) {
 	}
 }
 
+// TestMessageComputeRequest tests recording compute request IDs and finding
+// the latest completed one.
+func TestMessageComputeRequest(t *testing.T) {
+	m := NewManager()
+
+	if _, ok := m.LastComputeRequest(); ok {
+		t.Error("LastComputeRequest() on empty conversation reported a request")
+	}
+
+	metadata := &ollama.LLMMetadata{Prompt: "a cat"}
+	first := m.AddAssistantMessage("Here's a cat", "a cat", metadata)
+	m.UpdateMessagePreview(first, PreviewStatusComplete, "/images/1.png")
+	m.SetMessageComputeRequest(first, 7)
+
+	if got, ok := m.LastComputeRequest(); !ok || got != 7 {
+		t.Errorf("LastComputeRequest() = %d, %v, want 7, true", got, ok)
+	}
+
+	// A preview still generating is not a refinement source yet
+	second := m.AddAssistantMessage("Here's a dog", "a dog", &ollama.LLMMetadata{Prompt: "a dog"})
+	m.UpdateMessagePreview(second, PreviewStatusGenerating, "")
+	m.SetMessageComputeRequest(second, 8)
+	if got, _ := m.LastComputeRequest(); got != 7 {
+		t.Errorf("LastComputeRequest() while generating = %d, want 7", got)
+	}
+
+	m.UpdateMessagePreview(second, PreviewStatusComplete, "/images/2.png")
+	if got, _ := m.LastComputeRequest(); got != 8 {
+		t.Errorf("LastComputeRequest() = %d, want 8", got)
+	}
+
+	// Messages without snapshots are ignored
+	plain := m.AddAssistantMessage("No snapshot", "", nil)
+	m.SetMessageComputeRequest(plain, 9)
+	if msg := m.GetMessage(plain); msg.Snapshot != nil {
+		t.Error("SetMessageComputeRequest() created a snapshot")
+	}
+	if got, _ := m.LastComputeRequest(); got != 8 {
+		t.Errorf("LastComputeRequest() = %d, want 8", got)
+	}
+}
+
 // TestUpdateMessagePreviewNoSnapshot tests that UpdateMessagePreview does nothing for messages without snapshots.
 func TestUpdateMessagePreviewNoSnapshot(t *testing.T) {
 	m := NewManager()
@@ -96,6 +96,12 @@ type StateSnapshot struct {
 	// PreviewURL is the URL or path to the preview image.
 	// Empty if PreviewStatus is "none" or "generating".
 	PreviewURL string `json:"preview_url"`
+
+	// ComputeRequestID is the request_id the preview was generated with.
+	// weave-compute keeps recent results under it, so a refinement of this
+	// preview can start from it (protocol.InitSourceRetained) instead of
+	// sending the pixels back. Zero if no preview has been generated.
+	ComputeRequestID uint64 `json:"compute_request_id,omitempty"`
 }
 
 // ConversationMessage represents a message with additional metadata for conversation history.
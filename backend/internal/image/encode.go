@@ -97,3 +97,73 @@ func EncodePNG(width, height int, pixels []byte, format PixelFormat) ([]byte, er
 
 	return buf.Bytes(), nil
 }
+
+// ThumbnailSize is the longest side of a thumbnail in pixels
+const ThumbnailSize = 128
+
+// EncodeThumbnail decodes a PNG and encodes a copy at most ThumbnailSize
+// pixels on its longest side, keeping the aspect ratio. Each thumbnail
+// pixel is the average of the source pixels it covers. Smaller images are
+// re-encoded at their own size.
+//
+// Returns PNG bytes or error if pngData does not decode.
+func EncodeThumbnail(pngData []byte) ([]byte, error) {
+	src, err := png.Decode(bytes.NewReader(pngData))
+	if err != nil {
+		return nil, err
+	}
+
+	bounds := src.Bounds()
+	width, height := bounds.Dx(), bounds.Dy()
+	if width <= 0 || height <= 0 {
+		return nil, ErrInvalidDimensions
+	}
+
+	thumbWidth, thumbHeight := width, height
+	if width >= height && width > ThumbnailSize {
+		thumbWidth, thumbHeight = ThumbnailSize, max(height*ThumbnailSize/width, 1)
+	} else if height > width && height > ThumbnailSize {
+		thumbWidth, thumbHeight = max(width*ThumbnailSize/height, 1), ThumbnailSize
+	}
+
+	// PNGs from compute decode to *image.RGBA: read its pixels directly
+	// instead of boxing every one in a color.Color
+	rgba, _ := src.(*image.RGBA)
+	pixel := func(x, y int) (uint64, uint64, uint64, uint64) {
+		if rgba != nil {
+			p := rgba.Pix[rgba.PixOffset(x, y):]
+			return uint64(p[0]), uint64(p[1]), uint64(p[2]), uint64(p[3])
+		}
+		r, g, b, a := src.At(x, y).RGBA()
+		return uint64(r >> 8), uint64(g >> 8), uint64(b >> 8), uint64(a >> 8)
+	}
+
+	thumb := image.NewRGBA(image.Rect(0, 0, thumbWidth, thumbHeight))
+	for ty := 0; ty < thumbHeight; ty++ {
+		y0 := bounds.Min.Y + ty*height/thumbHeight
+		y1 := bounds.Min.Y + (ty+1)*height/thumbHeight
+		for tx := 0; tx < thumbWidth; tx++ {
+			x0 := bounds.Min.X + tx*width/thumbWidth
+			x1 := bounds.Min.X + (tx+1)*width/thumbWidth
+
+			var r, g, b, a, n uint64
+			for y := y0; y < y1; y++ {
+				for x := x0; x < x1; x++ {
+					pr, pg, pb, pa := pixel(x, y)
+					r, g, b, a = r+pr, g+pg, b+pb, a+pa
+					n++
+				}
+			}
+
+			dst := thumb.Pix[thumb.PixOffset(tx, ty):]
+			dst[0], dst[1], dst[2], dst[3] = uint8(r/n), uint8(g/n), uint8(b/n), uint8(a/n)
+		}
+	}
+
+	var buf bytes.Buffer
+	if err := png.Encode(&buf, thumb); err != nil {
+		return nil, err
+	}
+
+	return buf.Bytes(), nil
+}
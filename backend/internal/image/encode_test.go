@@ -238,3 +238,68 @@ func TestEncodePNG_MaxDimensions(t *testing.T) {
 		t.Errorf("max dimensions should work: %v", err)
 	}
 }
+
+func TestEncodeThumbnail_Downscale(t *testing.T) {
+	// 256x64 image, left half black and right half white
+	width, height := 256, 64
+	pixels := make([]byte, width*height*3)
+	for y := 0; y < height; y++ {
+		for x := width / 2; x < width; x++ {
+			i := (y*width + x) * 3
+			pixels[i], pixels[i+1], pixels[i+2] = 255, 255, 255
+		}
+	}
+
+	pngData, err := EncodePNG(width, height, pixels, FormatRGB)
+	if err != nil {
+		t.Fatalf("EncodePNG failed: %v", err)
+	}
+
+	thumb, err := EncodeThumbnail(pngData)
+	if err != nil {
+		t.Fatalf("EncodeThumbnail failed: %v", err)
+	}
+
+	img, err := png.Decode(bytes.NewReader(thumb))
+	if err != nil {
+		t.Fatalf("Failed to decode thumbnail: %v", err)
+	}
+
+	bounds := img.Bounds()
+	if bounds.Dx() != ThumbnailSize || bounds.Dy() != 32 {
+		t.Fatalf("got dimensions %dx%d, want %dx32", bounds.Dx(), bounds.Dy(), ThumbnailSize)
+	}
+
+	if r, _, _, _ := img.At(0, 0).RGBA(); r != 0 {
+		t.Errorf("left pixel red = %d, want 0", r>>8)
+	}
+	if r, _, _, _ := img.At(ThumbnailSize-1, 31).RGBA(); r>>8 != 255 {
+		t.Errorf("right pixel red = %d, want 255", r>>8)
+	}
+}
+
+func TestEncodeThumbnail_SmallImageKeepsSize(t *testing.T) {
+	pngData, err := EncodePNG(16, 8, make([]byte, 16*8*3), FormatRGB)
+	if err != nil {
+		t.Fatalf("EncodePNG failed: %v", err)
+	}
+
+	thumb, err := EncodeThumbnail(pngData)
+	if err != nil {
+		t.Fatalf("EncodeThumbnail failed: %v", err)
+	}
+
+	img, err := png.Decode(bytes.NewReader(thumb))
+	if err != nil {
+		t.Fatalf("Failed to decode thumbnail: %v", err)
+	}
+	if img.Bounds().Dx() != 16 || img.Bounds().Dy() != 8 {
+		t.Errorf("got dimensions %dx%d, want 16x8", img.Bounds().Dx(), img.Bounds().Dy())
+	}
+}
+
+func TestEncodeThumbnail_InvalidPNG(t *testing.T) {
+	if _, err := EncodeThumbnail([]byte{1, 2, 3, 4}); err == nil {
+		t.Error("expected error for data that is not a PNG")
+	}
+}
@@ -1,8 +1,14 @@
 package image
 
 import (
+	"bytes"
+	"container/list"
 	"context"
 	"errors"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
 	"sort"
 	"sync"
 	"time"
@@ -20,6 +26,8 @@ const (
 	CleanupInterval = 10 * time.Minute
 	// MaxImageSize is the maximum size of a single image (10MB)
 	MaxImageSize = 10 * 1024 * 1024
+	// MaxHotBytes is the default bound on PNG bytes held in memory (64MB)
+	MaxHotBytes = 64 * 1024 * 1024
 )
 
 var (
@@ -33,27 +41,65 @@ var (
 
 // storedImage holds image data with metadata
 type storedImage struct {
-	Data       []byte
+	Data       []byte // PNG bytes while in the hot tier, nil once evicted
+	Thumbnail  []byte // Small PNG preview, nil if Data did not decode
 	Width      int
 	Height     int
+	Size       int // len of the PNG bytes, in memory or on disk
 	CreatedAt  time.Time
 	AccessedAt time.Time
+
+	path string        // Spill file ("" for memory-only storage)
+	hot  *list.Element // Position in Storage.hot, nil once evicted
 }
 
-// Storage provides thread-safe in-memory image storage
+// Storage provides thread-safe image storage in two tiers.
+//
+// The hot tier keeps the PNG bytes of recently used images in memory, up to
+// a byte budget, evicting the least recently used first. With a spill
+// directory every image is also written there at store time, so eviction
+// only drops the memory copy and the image is then served from its file;
+// without one, eviction deletes the image.
 type Storage struct {
-	mu     sync.RWMutex
-	images map[string]*storedImage
+	mu       sync.RWMutex
+	images   map[string]*storedImage
+	hot      *list.List // Image IDs in the hot tier, most recently used first
+	hotBytes int        // PNG bytes in the hot tier
+	maxHot   int        // Bound on hotBytes
+	dir      string     // Spill directory ("" for memory-only storage)
 }
 
-// NewStorage creates a new image storage
+// NewStorage creates memory-only image storage bounded by MaxHotBytes.
 func NewStorage() *Storage {
+	return newStorage("", MaxHotBytes)
+}
+
+// NewTieredStorage creates image storage that keeps up to hotBytes of PNG
+// data in memory and every image in a file under dir, which is created if
+// needed. dir should be on a real disk, not tmpfs, or spilling saves no
+// memory. Close removes the files.
+func NewTieredStorage(dir string, hotBytes int) (*Storage, error) {
+	if dir == "" || hotBytes <= 0 {
+		return nil, errors.New("spill directory and hot tier size are required")
+	}
+	if err := os.MkdirAll(dir, 0700); err != nil {
+		return nil, err
+	}
+	return newStorage(dir, hotBytes), nil
+}
+
+func newStorage(dir string, hotBytes int) *Storage {
 	return &Storage{
 		images: make(map[string]*storedImage),
+		hot:    list.New(),
+		maxHot: hotBytes,
+		dir:    dir,
 	}
 }
 
-// Store saves PNG bytes and returns a unique ID
+// Store saves PNG bytes and returns a unique ID. Storage keeps pngData
+// itself, so the caller must not modify it afterwards. A thumbnail is
+// generated here so previews never wait for one.
 func (s *Storage) Store(pngData []byte, width, height int) (string, error) {
 	if len(pngData) == 0 {
 		return "", errors.New("empty PNG data")
@@ -75,42 +121,114 @@ func (s *Storage) Store(pngData []byte, width, height int) (string, error) {
 		Data:       pngData,
 		Width:      width,
 		Height:     height,
+		Size:       len(pngData),
 		CreatedAt:  now,
 		AccessedAt: now,
 	}
 
+	// Best effort: data that is not a PNG just has no thumbnail
+	if thumb, err := EncodeThumbnail(pngData); err == nil {
+		img.Thumbnail = thumb
+	}
+
+	// Written before the image is visible, outside the lock
+	if s.dir != "" {
+		img.path = filepath.Join(s.dir, id+".png")
+		if err := os.WriteFile(img.path, pngData, 0600); err != nil {
+			return "", err
+		}
+	}
+
 	s.mu.Lock()
 	s.images[id] = img
+	img.hot = s.hot.PushFront(id)
+	s.hotBytes += img.Size
+	s.evictLocked()
 	s.mu.Unlock()
 
 	return id, nil
 }
 
-// Get retrieves PNG bytes by ID, returns ErrNotFound if not exists
+// Get retrieves a copy of the PNG bytes by ID, returns ErrNotFound if not
+// exists. Open serves an image without the copy.
 func (s *Storage) Get(id string) ([]byte, int, int, error) {
+	r, img, err := s.open(id)
+	if err != nil {
+		return nil, 0, 0, err
+	}
+	defer r.Close()
+
+	data := make([]byte, img.Size)
+	if _, err := io.ReadFull(r, data); err != nil {
+		return nil, 0, 0, err
+	}
+	return data, img.Width, img.Height, nil
+}
+
+// Open returns a reader over an image's PNG bytes and its creation time,
+// for http.ServeContent. Hot images are read from memory without a copy;
+// evicted ones from their file, which net/http sends with sendfile. The
+// caller must Close the reader.
+func (s *Storage) Open(id string) (io.ReadSeekCloser, time.Time, error) {
+	r, img, err := s.open(id)
+	if err != nil {
+		return nil, time.Time{}, err
+	}
+	return r, img.CreatedAt, nil
+}
+
+// open looks up and touches an image and opens a reader over its bytes.
+// The returned storedImage must only be used for its immutable fields.
+func (s *Storage) open(id string) (io.ReadSeekCloser, *storedImage, error) {
 	// Validate ID format (no lock needed)
 	if _, err := uuid.Parse(id); err != nil {
-		return nil, 0, 0, ErrInvalidID
+		return nil, nil, ErrInvalidID
 	}
 
-	// Use read lock to check existence
-	s.mu.RLock()
+	s.mu.Lock()
 	img, exists := s.images[id]
-	s.mu.RUnlock()
-
 	if !exists {
-		return nil, 0, 0, ErrNotFound
+		s.mu.Unlock()
+		return nil, nil, ErrNotFound
 	}
-
-	// Update access time with write lock (separate from read)
-	s.mu.Lock()
 	img.AccessedAt = time.Now()
+	data := img.Data
+	if img.hot != nil {
+		s.hot.MoveToFront(img.hot)
+	}
 	s.mu.Unlock()
 
-	// Return copy of data to prevent external modification
-	data := make([]byte, len(img.Data))
-	copy(data, img.Data)
-	return data, img.Width, img.Height, nil
+	// Stored bytes are never modified, so readers can share them
+	if data != nil {
+		return nopCloser{bytes.NewReader(data)}, img, nil
+	}
+
+	f, err := os.Open(img.path)
+	if errors.Is(err, fs.ErrNotExist) {
+		// Deleted since the lookup
+		return nil, nil, ErrNotFound
+	}
+	if err != nil {
+		return nil, nil, err
+	}
+	return f, img, nil
+}
+
+// Thumbnail returns the preview stored with an image, or ErrNotFound if the
+// image does not exist or has no preview. The bytes are shared and must not
+// be modified.
+func (s *Storage) Thumbnail(id string) ([]byte, error) {
+	if _, err := uuid.Parse(id); err != nil {
+		return nil, ErrInvalidID
+	}
+
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	img, exists := s.images[id]
+	if !exists || img.Thumbnail == nil {
+		return nil, ErrNotFound
+	}
+	return img.Thumbnail, nil
 }
 
 // Count returns number of stored images
@@ -121,21 +239,76 @@ func (s *Storage) Count() int {
 	return count
 }
 
+// HotBytes returns the PNG bytes currently held in memory
+func (s *Storage) HotBytes() int {
+	s.mu.RLock()
+	n := s.hotBytes
+	s.mu.RUnlock()
+	return n
+}
+
 // Delete removes an image by ID. Returns true if image was deleted.
 func (s *Storage) Delete(id string) bool {
 	s.mu.Lock()
 	_, exists := s.images[id]
 	if exists {
-		delete(s.images, id)
+		s.removeLocked(id)
 	}
 	s.mu.Unlock()
 	return exists
 }
 
+// Close removes every image and the spill directory. Call it once the
+// storage is no longer used: a tiered storage cannot store after it.
+func (s *Storage) Close() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	for id := range s.images {
+		s.removeLocked(id)
+	}
+	if s.dir == "" {
+		return nil
+	}
+	return os.RemoveAll(s.dir)
+}
+
+// evictLocked drops the least recently used images from the hot tier until
+// it fits its budget. Caller holds s.mu.
+func (s *Storage) evictLocked() {
+	for s.hotBytes > s.maxHot {
+		id := s.hot.Back().Value.(string)
+		img := s.images[id]
+		if img.path == "" {
+			// Memory-only: nowhere to keep it
+			s.removeLocked(id)
+			continue
+		}
+		s.hot.Remove(img.hot)
+		img.hot = nil
+		img.Data = nil
+		s.hotBytes -= img.Size
+	}
+}
+
+// removeLocked deletes an image from both tiers. Caller holds s.mu.
+func (s *Storage) removeLocked(id string) {
+	img := s.images[id]
+	if img.hot != nil {
+		s.hot.Remove(img.hot)
+		s.hotBytes -= img.Size
+	}
+	if img.path != "" {
+		// Readers that already opened the file keep reading it
+		_ = os.Remove(img.path)
+	}
+	delete(s.images, id)
+}
+
 // StartCleanup starts a background goroutine that periodically removes
 // old images (older than MaxAge) and enforces the MaxImages limit via LRU.
-// The goroutine runs until ctx is cancelled. Caller MUST cancel ctx
-// to stop cleanup and prevent goroutine leak.
+// The goroutine runs until ctx is cancelled, then calls Close. Caller MUST
+// cancel ctx to stop cleanup and prevent goroutine leak.
 func (s *Storage) StartCleanup(ctx context.Context, logger *logging.Logger) {
 	ticker := time.NewTicker(CleanupInterval)
 	go func() {
@@ -144,6 +317,9 @@ func (s *Storage) StartCleanup(ctx context.Context, logger *logging.Logger) {
 			select {
 			case <-ctx.Done():
 				logger.Debug("Image cleanup goroutine stopping")
+				if err := s.Close(); err != nil {
+					logger.Warn("Failed to remove image spill directory: %v", err)
+				}
 				return
 			case <-ticker.C:
 				s.cleanup(logger)
@@ -164,7 +340,7 @@ func (s *Storage) cleanup(logger *logging.Logger) {
 	ageDeleted := 0
 	for id, img := range s.images {
 		if now.Sub(img.CreatedAt) > MaxAge {
-			delete(s.images, id)
+			s.removeLocked(id)
 			ageDeleted++
 		}
 	}
@@ -198,7 +374,7 @@ func (s *Storage) cleanup(logger *logging.Logger) {
 		toDelete := len(entries) - MaxImages
 		if toDelete > 0 {
 			for i := 0; i < toDelete; i++ {
-				delete(s.images, entries[i].id)
+				s.removeLocked(entries[i].id)
 				lruDeleted++
 			}
 		}
@@ -213,3 +389,10 @@ func (s *Storage) cleanup(logger *logging.Logger) {
 		logger.Debug("Cleanup complete: %d -> %d images", initialCount, finalCount)
 	}
 }
+
+// nopCloser makes a bytes.Reader an io.ReadSeekCloser
+type nopCloser struct {
+	*bytes.Reader
+}
+
+func (nopCloser) Close() error { return nil }
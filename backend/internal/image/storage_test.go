@@ -4,6 +4,10 @@ import (
 	"bytes"
 	"context"
 	"errors"
+	"image/png"
+	"io"
+	"os"
+	"path/filepath"
 	"sync"
 	"testing"
 	"time"
@@ -408,3 +412,162 @@ func TestStorage_MaxImageSize(t *testing.T) {
 		t.Error("expected valid ID")
 	}
 }
+
+func TestStorage_TieredSpill(t *testing.T) {
+	dir := filepath.Join(t.TempDir(), "images")
+	storage, err := NewTieredStorage(dir, 10)
+	if err != nil {
+		t.Fatalf("NewTieredStorage failed: %v", err)
+	}
+
+	// Three 4-byte images do not fit a 10-byte hot tier
+	ids := make([]string, 3)
+	for i := range ids {
+		ids[i], err = storage.Store([]byte{byte(i), 1, 2, 3}, 100, 100)
+		if err != nil {
+			t.Fatalf("Store failed: %v", err)
+		}
+	}
+
+	if storage.Count() != 3 {
+		t.Errorf("expected 3 images, got %d", storage.Count())
+	}
+	if storage.HotBytes() != 8 {
+		t.Errorf("expected 8 hot bytes, got %d", storage.HotBytes())
+	}
+	if storage.images[ids[0]].Data != nil {
+		t.Error("oldest image should have been evicted from memory")
+	}
+
+	// Evicted image is served from its file
+	data, _, _, err := storage.Get(ids[0])
+	if err != nil {
+		t.Fatalf("Get evicted image failed: %v", err)
+	}
+	if !bytes.Equal(data, []byte{0, 1, 2, 3}) {
+		t.Errorf("got %v from disk, want [0 1 2 3]", data)
+	}
+
+	r, _, err := storage.Open(ids[0])
+	if err != nil {
+		t.Fatalf("Open evicted image failed: %v", err)
+	}
+	if _, ok := r.(*os.File); !ok {
+		t.Errorf("evicted image should be served from a file, got %T", r)
+	}
+	r.Close()
+
+	// Delete removes the file
+	path := storage.images[ids[0]].path
+	storage.Delete(ids[0])
+	if _, err := os.Stat(path); !os.IsNotExist(err) {
+		t.Errorf("spill file should be removed, stat returned %v", err)
+	}
+
+	// Close removes the directory
+	if err := storage.Close(); err != nil {
+		t.Fatalf("Close failed: %v", err)
+	}
+	if _, err := os.Stat(dir); !os.IsNotExist(err) {
+		t.Errorf("spill directory should be removed, stat returned %v", err)
+	}
+}
+
+func TestStorage_MemoryOnlyEviction(t *testing.T) {
+	storage := newStorage("", 10)
+
+	ids := make([]string, 3)
+	for i := range ids {
+		var err error
+		ids[i], err = storage.Store([]byte{byte(i), 1, 2, 3}, 100, 100)
+		if err != nil {
+			t.Fatalf("Store failed: %v", err)
+		}
+	}
+
+	// Without a spill directory the least recently used image is gone
+	if storage.Count() != 2 {
+		t.Errorf("expected 2 images, got %d", storage.Count())
+	}
+	if _, _, _, err := storage.Get(ids[0]); !errors.Is(err, ErrNotFound) {
+		t.Errorf("expected ErrNotFound for evicted image, got %v", err)
+	}
+	if storage.HotBytes() > 10 {
+		t.Errorf("hot tier over budget: %d bytes", storage.HotBytes())
+	}
+}
+
+func TestStorage_EvictsLeastRecentlyUsed(t *testing.T) {
+	storage := newStorage("", 8)
+
+	first, _ := storage.Store([]byte{1, 1, 1, 1}, 100, 100)
+	second, _ := storage.Store([]byte{2, 2, 2, 2}, 100, 100)
+
+	// Reading the first image makes the second the eviction candidate
+	if _, _, _, err := storage.Get(first); err != nil {
+		t.Fatalf("Get failed: %v", err)
+	}
+	if _, err := storage.Store([]byte{3, 3, 3, 3}, 100, 100); err != nil {
+		t.Fatalf("Store failed: %v", err)
+	}
+
+	if _, _, _, err := storage.Get(first); err != nil {
+		t.Errorf("recently used image should remain: %v", err)
+	}
+	if _, _, _, err := storage.Get(second); !errors.Is(err, ErrNotFound) {
+		t.Errorf("expected ErrNotFound for least recently used image, got %v", err)
+	}
+}
+
+func TestStorage_OpenHot(t *testing.T) {
+	storage := NewStorage()
+
+	pngData := []byte{1, 2, 3, 4}
+	id, _ := storage.Store(pngData, 100, 100)
+
+	r, _, err := storage.Open(id)
+	if err != nil {
+		t.Fatalf("Open failed: %v", err)
+	}
+	defer r.Close()
+
+	data, err := io.ReadAll(r)
+	if err != nil {
+		t.Fatalf("ReadAll failed: %v", err)
+	}
+	if !bytes.Equal(data, pngData) {
+		t.Errorf("got %v, want %v", data, pngData)
+	}
+
+	if _, _, err := storage.Open("not-a-uuid"); !errors.Is(err, ErrInvalidID) {
+		t.Errorf("expected ErrInvalidID, got %v", err)
+	}
+}
+
+func TestStorage_Thumbnail(t *testing.T) {
+	storage := NewStorage()
+
+	pngData, err := EncodePNG(256, 128, make([]byte, 256*128*3), FormatRGB)
+	if err != nil {
+		t.Fatalf("EncodePNG failed: %v", err)
+	}
+	id, _ := storage.Store(pngData, 256, 128)
+
+	thumb, err := storage.Thumbnail(id)
+	if err != nil {
+		t.Fatalf("Thumbnail failed: %v", err)
+	}
+	img, err := png.Decode(bytes.NewReader(thumb))
+	if err != nil {
+		t.Fatalf("Failed to decode thumbnail: %v", err)
+	}
+	if img.Bounds().Dx() != 128 || img.Bounds().Dy() != 64 {
+		t.Errorf("got thumbnail %dx%d, want 128x64", img.Bounds().Dx(), img.Bounds().Dy())
+	}
+
+	// Data that is not a PNG is stored without a thumbnail
+	junkID, _ := storage.Store([]byte{1, 2, 3, 4}, 100, 100)
+	if _, err := storage.Thumbnail(junkID); !errors.Is(err, ErrNotFound) {
+		t.Errorf("expected ErrNotFound, got %v", err)
+	}
+}
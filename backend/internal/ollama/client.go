@@ -123,6 +123,28 @@ func (c *Client) Endpoint() string {
 	return c.endpoint
 }
 
+// ImagePromptFunc receives the prompt of an update_generation call that asks
+// for an image, as soon as the call arrives in the stream. It runs on the
+// goroutine reading the stream and must not block.
+type ImagePromptFunc func(prompt string)
+
+type imagePromptKey struct{}
+
+// WithImagePromptHook returns a context that makes Chat pass the image
+// prompt to fn as soon as the LLM's update_generation call arrives, which
+// may be before the rest of the response has streamed. Callers can use it
+// to get image generation ready early; the call is still reported in the
+// ChatResult. Like httptrace, the hook travels with the request's context.
+func WithImagePromptHook(ctx context.Context, fn ImagePromptFunc) context.Context {
+	return context.WithValue(ctx, imagePromptKey{}, fn)
+}
+
+// imagePromptHook returns the hook set by WithImagePromptHook, or nil.
+func imagePromptHook(ctx context.Context) ImagePromptFunc {
+	fn, _ := ctx.Value(imagePromptKey{}).(ImagePromptFunc)
+	return fn
+}
+
 // StreamCallback is called for each token received during streaming.
 // The callback receives the token text and a done flag indicating completion.
 // If the callback returns an error, streaming is aborted.
@@ -226,7 +248,7 @@ func (c *Client) Chat(ctx context.Context, messages []Message, seed *int64, tool
 	}
 
 	// Parse streaming response (newline-delimited JSON)
-	fullResponse, err := c.parseStreamingResponse(resp.Body, callback)
+	fullResponse, err := c.parseStream(resp.Body, callback, imagePromptHook(ctx))
 	if err != nil {
 		return ChatResult{}, err
 	}
@@ -261,6 +283,13 @@ const maxResponseSize = 1024 * 1024
 // We enforce a 1MB limit to prevent unbounded memory usage if the LLM generates
 // an extremely long response (malicious or malfunctioning model).
 func (c *Client) parseStreamingResponse(body io.Reader, callback StreamCallback) (string, error) {
+	return c.parseStream(body, callback, nil)
+}
+
+// parseStream is parseStreamingResponse that also passes the prompt of an
+// update_generation call asking for an image to onImagePrompt (may be nil)
+// as soon as the call arrives.
+func (c *Client) parseStream(body io.Reader, callback StreamCallback, onImagePrompt ImagePromptFunc) (string, error) {
 	scanner := bufio.NewScanner(body)
 	var fullResponse bytes.Buffer
 	var toolCalls []ToolCall // Collect tool calls from any chunk
@@ -298,6 +327,16 @@ func (c *Client) parseStreamingResponse(body io.Reader, callback StreamCallback)
 		if len(chatResp.Message.ToolCalls) > 0 {
 			toolCalls = append(toolCalls, chatResp.Message.ToolCalls...)
 			log.Printf("DEBUG: Captured %d tool calls from chunk %d", len(chatResp.Message.ToolCalls), chunkCount)
+
+			// Announce the image prompt now rather than after the stream ends.
+			// WHY NOT FAIL: Malformed calls are reported by parseResponse() once
+			// the stream completes; here they only mean no early prompt.
+			if onImagePrompt != nil {
+				if metadata, err := parseToolCalls(chatResp.Message.ToolCalls); err == nil &&
+					metadata.GenerateImage && metadata.Prompt != "" {
+					onImagePrompt(metadata.Prompt)
+				}
+			}
 		}
 
 		token := chatResp.Message.Content
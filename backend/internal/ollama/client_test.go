@@ -1075,3 +1075,57 @@ func TestParseStreamingResponseWithToolCallsNoContent(t *testing.T) {
 		t.Errorf("got %d tokens, want %d", len(tokens), len(expectedTokens))
 	}
 }
+
+func TestParseStreamImagePrompt(t *testing.T) {
+	client := NewClient()
+
+	// The call arrives before the last text chunk
+	input := `{"model":"test","message":{"role":"assistant","content":"Perfect! "},"done":false}
+{"model":"test","message":{"role":"assistant","content":"","tool_calls":[{"function":{"name":"update_generation","arguments":"{\"prompt\":\"a cat in space\",\"steps\":28,\"cfg\":7.5,\"seed\":42,\"generate_image\":true}"}}]},"done":false}
+{"model":"test","message":{"role":"assistant","content":"Generating now."},"done":true}
+`
+
+	var events []string
+	callback := func(token StreamToken) error {
+		events = append(events, "token:"+token.Content)
+		return nil
+	}
+	onImagePrompt := func(prompt string) {
+		events = append(events, "prompt:"+prompt)
+	}
+
+	if _, err := client.parseStream(strings.NewReader(input), callback, onImagePrompt); err != nil {
+		t.Fatalf("parseStream() error = %v", err)
+	}
+
+	want := []string{"token:Perfect! ", "prompt:a cat in space", "token:Generating now."}
+	if strings.Join(events, "|") != strings.Join(want, "|") {
+		t.Errorf("events = %q, want %q", events, want)
+	}
+
+	// No prompt when the call does not ask for an image
+	input = `{"model":"test","message":{"role":"assistant","content":"","tool_calls":[{"function":{"name":"update_generation","arguments":"{\"prompt\":\"a cat\",\"steps\":4,\"cfg\":1.0,\"seed\":-1,\"generate_image\":false}"}}]},"done":true}
+`
+	if _, err := client.parseStream(strings.NewReader(input), nil, func(prompt string) {
+		t.Errorf("unexpected image prompt %q", prompt)
+	}); err != nil {
+		t.Fatalf("parseStream() error = %v", err)
+	}
+}
+
+func TestImagePromptHook(t *testing.T) {
+	if imagePromptHook(context.Background()) != nil {
+		t.Error("imagePromptHook() on a plain context should be nil")
+	}
+
+	var got string
+	ctx := WithImagePromptHook(context.Background(), func(prompt string) { got = prompt })
+	fn := imagePromptHook(ctx)
+	if fn == nil {
+		t.Fatal("imagePromptHook() = nil, want the hook")
+	}
+	fn("a cat")
+	if got != "a cat" {
+		t.Errorf("hook received %q, want %q", got, "a cat")
+	}
+}
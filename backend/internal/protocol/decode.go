@@ -9,7 +9,9 @@ import (
 )
 
 // DecodeResponse decodes a response message from the given byte slice.
-// It returns either a *SD35GenerateResponse or *ErrorResponse depending on the message type.
+// It returns a *SD35GenerateResponse, *SD35GenerateBatchResponse,
+// *GenerateProgress, *GenerateTimings, *StatsResponse, or *ErrorResponse
+// depending on the message type.
 // Returns an error if the message is invalid, truncated, or malformed.
 func DecodeResponse(data []byte) (interface{}, error) {
 	// Validate minimum message size (common header = 16 bytes)
@@ -23,9 +25,13 @@ func DecodeResponse(data []byte) (interface{}, error) {
 		return nil, err
 	}
 
-	// Validate payload length
-	if header.PayloadLen > MaxMessageSize {
-		return nil, fmt.Errorf("%w: payload_len %d exceeds max %d", ErrMessageTooLarge, header.PayloadLen, MaxMessageSize)
+	// Validate payload length (reassembled version 2 responses may be larger)
+	maxSize := MaxMessageSize
+	if header.Version >= ProtocolVersion2 {
+		maxSize = MaxStreamedMessageSize
+	}
+	if header.PayloadLen > maxSize {
+		return nil, fmt.Errorf("%w: payload_len %d exceeds max %d", ErrMessageTooLarge, header.PayloadLen, maxSize)
 	}
 
 	// Check total message size
@@ -38,6 +44,14 @@ func DecodeResponse(data []byte) (interface{}, error) {
 	switch header.MsgType {
 	case MsgGenerateResponse:
 		return decodeGenerateResponse(header, data[16:16+header.PayloadLen])
+	case MsgGenerateBatchResponse:
+		return decodeGenerateBatchResponse(header, data[16:16+header.PayloadLen])
+	case MsgGenerateProgress:
+		return decodeGenerateProgress(header, data[16:16+header.PayloadLen])
+	case MsgGenerateTimings:
+		return decodeGenerateTimings(header, data[16:16+header.PayloadLen])
+	case MsgStatsResponse:
+		return decodeStatsResponse(header, data[16:16+header.PayloadLen])
 	case MsgError:
 		return decodeErrorResponse(header, data[16:16+header.PayloadLen])
 	default:
@@ -67,8 +81,8 @@ func decodeHeader(data []byte) (Header, error) {
 	if err := binary.Read(buf, binary.BigEndian, &h.PayloadLen); err != nil {
 		return Header{}, fmt.Errorf("failed to read payload_len: %w", err)
 	}
-	if err := binary.Read(buf, binary.BigEndian, &h.Reserved); err != nil {
-		return Header{}, fmt.Errorf("failed to read reserved: %w", err)
+	if err := binary.Read(buf, binary.BigEndian, &h.Flags); err != nil {
+		return Header{}, fmt.Errorf("failed to read flags: %w", err)
 	}
 
 	// Validate magic number
@@ -135,34 +149,17 @@ func decodeGenerateResponse(header Header, payload []byte) (*SD35GenerateRespons
 		return nil, fmt.Errorf("failed to read image_data_len: %w", err)
 	}
 
-	// Validate image dimensions
-	if resp.ImageWidth < SD35MinWidth || resp.ImageWidth > SD35MaxWidth || resp.ImageWidth%SD35DimensionAlign != 0 {
-		return nil, fmt.Errorf("%w: width %d (must be %d-%d, multiple of %d)",
-			ErrInvalidDimensions, resp.ImageWidth, SD35MinWidth, SD35MaxWidth, SD35DimensionAlign)
-	}
-	if resp.ImageHeight < SD35MinHeight || resp.ImageHeight > SD35MaxHeight || resp.ImageHeight%SD35DimensionAlign != 0 {
-		return nil, fmt.Errorf("%w: height %d (must be %d-%d, multiple of %d)",
-			ErrInvalidDimensions, resp.ImageHeight, SD35MinHeight, SD35MaxHeight, SD35DimensionAlign)
-	}
-
-	// Validate channels
-	if resp.Channels != SD35ChannelsRGB && resp.Channels != SD35ChannelsRGBA {
-		return nil, fmt.Errorf("invalid channels: got %d, expected %d (RGB) or %d (RGBA)",
-			resp.Channels, SD35ChannelsRGB, SD35ChannelsRGBA)
-	}
-
-	// Validate image_data_len matches dimensions
-	// Check for integer overflow first
-	if resp.ImageWidth > math.MaxUint32/resp.ImageHeight {
-		return nil, fmt.Errorf("image dimensions too large: width * height would overflow")
-	}
-	if resp.ImageWidth*resp.ImageHeight > math.MaxUint32/resp.Channels {
-		return nil, fmt.Errorf("image dimensions too large: width * height * channels would overflow")
+	// A PNG file has no fixed length; validate the dimensions it claims
+	expectedLen := resp.ImageDataLen
+	if header.Flags&FlagPNG != 0 {
+		if resp.ImageDataLen == 0 {
+			return nil, fmt.Errorf("empty PNG image data")
+		}
+		resp.Format = ImageFormatPNG
+		expectedLen = resp.ImageWidth * resp.ImageHeight * resp.Channels
 	}
-	expectedLen := resp.ImageWidth * resp.ImageHeight * resp.Channels
-	if resp.ImageDataLen != expectedLen {
-		return nil, fmt.Errorf("image_data_len mismatch: got %d, expected %d (width %d * height %d * channels %d)",
-			resp.ImageDataLen, expectedLen, resp.ImageWidth, resp.ImageHeight, resp.Channels)
+	if err := validateImageMetadata(resp.ImageWidth, resp.ImageHeight, resp.Channels, expectedLen); err != nil {
+		return nil, err
 	}
 
 	// Validate we have enough bytes for image data
@@ -180,6 +177,294 @@ func decodeGenerateResponse(header Header, payload []byte) (*SD35GenerateRespons
 	return &resp, nil
 }
 
+// decodeGenerateBatchResponse decodes a MSG_GENERATE_BATCH_RESPONSE payload (status 200).
+// Payload structure:
+//   - request_id (8 bytes)
+//   - status (4 bytes)
+//   - generation_time (4 bytes, whole batch)
+//   - image_width (4 bytes)
+//   - image_height (4 bytes)
+//   - channels (4 bytes)
+//   - image_count (4 bytes)
+//   - image_data_len (4 bytes, per image)
+//   - image_data (image_count * image_data_len bytes)
+func decodeGenerateBatchResponse(header Header, payload []byte) (*SD35GenerateBatchResponse, error) {
+	// Minimum payload: common response (16) + image header (20) = 36 bytes
+	if len(payload) < 36 {
+		return nil, fmt.Errorf("batch response payload too small: got %d bytes, need at least 36", len(payload))
+	}
+
+	buf := bytes.NewReader(payload)
+	var resp SD35GenerateBatchResponse
+	resp.Header = header
+
+	// Read common response fields and image header (36 bytes)
+	fields := []interface{}{&resp.RequestID, &resp.Status, &resp.GenerationTime,
+		&resp.ImageWidth, &resp.ImageHeight, &resp.Channels, &resp.ImageCount, &resp.ImageDataLen}
+	for _, field := range fields {
+		if err := binary.Read(buf, binary.BigEndian, field); err != nil {
+			return nil, fmt.Errorf("failed to read batch response header: %w", err)
+		}
+	}
+
+	// Validate status code
+	if resp.Status != StatusOK {
+		return nil, fmt.Errorf("invalid status for GENERATE_BATCH_RESPONSE: got %d, expected %d", resp.Status, StatusOK)
+	}
+
+	if resp.ImageCount < SD35MinBatchSize || resp.ImageCount > SD35MaxBatchSize {
+		return nil, fmt.Errorf("%w: image_count %d not in range [%d, %d]",
+			ErrInvalidSeedCount, resp.ImageCount, SD35MinBatchSize, SD35MaxBatchSize)
+	}
+
+	if err := validateImageMetadata(resp.ImageWidth, resp.ImageHeight, resp.Channels, resp.ImageDataLen); err != nil {
+		return nil, err
+	}
+
+	// Validate we have enough bytes for every image
+	remaining := uint64(len(payload) - 36)
+	if remaining < uint64(resp.ImageCount)*uint64(resp.ImageDataLen) {
+		return nil, fmt.Errorf("truncated image data: got %d bytes, expected %d",
+			remaining, uint64(resp.ImageCount)*uint64(resp.ImageDataLen))
+	}
+
+	// Read image data
+	resp.Images = make([][]byte, resp.ImageCount)
+	for i := range resp.Images {
+		resp.Images[i] = make([]byte, resp.ImageDataLen)
+		if _, err := io.ReadFull(buf, resp.Images[i]); err != nil {
+			return nil, fmt.Errorf("failed to read image %d: %w", i, err)
+		}
+	}
+
+	return &resp, nil
+}
+
+// decodeGenerateProgress decodes a MSG_GENERATE_PROGRESS payload.
+// Payload structure:
+//   - request_id (8 bytes)
+//   - step (4 bytes)
+//   - total_steps (4 bytes)
+//   - elapsed_ms (4 bytes)
+//   - preview_width (4 bytes)
+//   - preview_height (4 bytes)
+//   - preview_channels (4 bytes)
+//   - preview_data_len (4 bytes, 0 if no preview)
+//   - preview_data (variable)
+func decodeGenerateProgress(header Header, payload []byte) (*GenerateProgress, error) {
+	if len(payload) < 36 {
+		return nil, fmt.Errorf("progress payload too small: got %d bytes, need at least 36", len(payload))
+	}
+
+	buf := bytes.NewReader(payload)
+	var p GenerateProgress
+	p.Header = header
+
+	fields := []interface{}{&p.RequestID, &p.Step, &p.TotalSteps, &p.ElapsedMs,
+		&p.PreviewWidth, &p.PreviewHeight, &p.PreviewChannels, &p.PreviewDataLen}
+	for _, field := range fields {
+		if err := binary.Read(buf, binary.BigEndian, field); err != nil {
+			return nil, fmt.Errorf("failed to read progress fields: %w", err)
+		}
+	}
+
+	if p.TotalSteps == 0 || p.Step > p.TotalSteps {
+		return nil, fmt.Errorf("%w: step %d of %d", ErrInvalidSteps, p.Step, p.TotalSteps)
+	}
+
+	if p.PreviewDataLen == 0 {
+		return &p, nil
+	}
+
+	if p.PreviewWidth == 0 || p.PreviewWidth > SD35MaxPreviewDim ||
+		p.PreviewHeight == 0 || p.PreviewHeight > SD35MaxPreviewDim {
+		return nil, fmt.Errorf("%w: preview %dx%d (max %d)",
+			ErrInvalidDimensions, p.PreviewWidth, p.PreviewHeight, SD35MaxPreviewDim)
+	}
+	if p.PreviewChannels != SD35ChannelsRGB && p.PreviewChannels != SD35ChannelsRGBA {
+		return nil, fmt.Errorf("invalid preview channels: got %d", p.PreviewChannels)
+	}
+	// Bounded by SD35MaxPreviewDim, so this cannot overflow
+	expectedLen := p.PreviewWidth * p.PreviewHeight * p.PreviewChannels
+	if p.PreviewDataLen != expectedLen {
+		return nil, fmt.Errorf("preview_data_len mismatch: got %d, expected %d", p.PreviewDataLen, expectedLen)
+	}
+	if uint32(len(payload)-36) < p.PreviewDataLen {
+		return nil, fmt.Errorf("truncated preview data: got %d bytes, expected %d", len(payload)-36, p.PreviewDataLen)
+	}
+
+	p.Preview = make([]byte, p.PreviewDataLen)
+	if _, err := io.ReadFull(buf, p.Preview); err != nil {
+		return nil, fmt.Errorf("failed to read preview data: %w", err)
+	}
+
+	return &p, nil
+}
+
+// decodeGenerateTimings decodes a MSG_GENERATE_TIMINGS payload.
+//
+// Payload layout: request_id (8), stage_count (4), stage_count durations
+// (8 each), step_count (4), step_count step durations (4 each).
+func decodeGenerateTimings(header Header, payload []byte) (*GenerateTimings, error) {
+	buf := bytes.NewReader(payload)
+	var t GenerateTimings
+	var stageCount, stepCount uint32
+	t.Header = header
+
+	if err := binary.Read(buf, binary.BigEndian, &t.RequestID); err != nil {
+		return nil, fmt.Errorf("failed to read timings request_id: %w", err)
+	}
+	if err := binary.Read(buf, binary.BigEndian, &stageCount); err != nil {
+		return nil, fmt.Errorf("failed to read timings stage_count: %w", err)
+	}
+	if stageCount != TimingStageCount {
+		return nil, fmt.Errorf("invalid timings stage_count: got %d, expected %d", stageCount, TimingStageCount)
+	}
+	if err := binary.Read(buf, binary.BigEndian, &t.StagesUs); err != nil {
+		return nil, fmt.Errorf("failed to read timings stages: %w", err)
+	}
+	if err := binary.Read(buf, binary.BigEndian, &stepCount); err != nil {
+		return nil, fmt.Errorf("failed to read timings step_count: %w", err)
+	}
+	if stepCount > SD35MaxSteps*SD35MaxBatchSize {
+		return nil, fmt.Errorf("%w: %d timed steps", ErrInvalidSteps, stepCount)
+	}
+	if uint32(buf.Len()) != stepCount*4 {
+		return nil, fmt.Errorf("timings payload mismatch: %d bytes for %d steps", buf.Len(), stepCount)
+	}
+
+	t.StepsUs = make([]uint32, stepCount)
+	if err := binary.Read(buf, binary.BigEndian, t.StepsUs); err != nil {
+		return nil, fmt.Errorf("failed to read timings steps: %w", err)
+	}
+
+	return &t, nil
+}
+
+// decodeStatsResponse decodes a MSG_STATS_RESPONSE payload.
+//
+// Payload layout: request_id (8), status (4), uptime_ms (8), requests (8),
+// completed (8), queue_depth (4), in_flight (4), vram_bytes (8),
+// pool_hits (8), pool_misses (8), pool_idle_bytes (8); class_count (4)
+// then per priority class queue_depth (4) and wait_ms (4); error_count (4) then per error code (4) and count (8); bucket_count (4)
+// then bucket upper bounds (8 each); histogram_count (4) then per histogram
+// stage (4), count (8), sum_us (8) and bucket_count counts (8 each).
+func decodeStatsResponse(header Header, payload []byte) (*StatsResponse, error) {
+	buf := bytes.NewReader(payload)
+	var s StatsResponse
+	var classCount, errorCount, bucketCount, histogramCount uint32
+	s.Header = header
+
+	fields := []interface{}{&s.RequestID, &s.Status, &s.UptimeMs, &s.Requests,
+		&s.Completed, &s.QueueDepth, &s.InFlight, &s.VRAMBytes,
+		&s.PoolHits, &s.PoolMisses, &s.PoolIdleBytes, &classCount}
+	for _, field := range fields {
+		if err := binary.Read(buf, binary.BigEndian, field); err != nil {
+			return nil, fmt.Errorf("failed to read stats fields: %w", err)
+		}
+	}
+	if classCount > PriorityCount {
+		return nil, fmt.Errorf("invalid stats class_count: %d (max %d)", classCount, PriorityCount)
+	}
+	s.ClassQueue = make([]StatsClassQueue, classCount)
+	if err := binary.Read(buf, binary.BigEndian, s.ClassQueue); err != nil {
+		return nil, fmt.Errorf("failed to read stats class queues: %w", err)
+	}
+
+	if err := binary.Read(buf, binary.BigEndian, &errorCount); err != nil {
+		return nil, fmt.Errorf("failed to read stats error_count: %w", err)
+	}
+	if errorCount > StatsMaxErrorCodes {
+		return nil, fmt.Errorf("invalid stats error_count: %d (max %d)", errorCount, StatsMaxErrorCodes)
+	}
+
+	s.Errors = make(map[uint32]uint64, errorCount)
+	for i := uint32(0); i < errorCount; i++ {
+		var code uint32
+		var count uint64
+		if err := binary.Read(buf, binary.BigEndian, &code); err != nil {
+			return nil, fmt.Errorf("failed to read stats error code: %w", err)
+		}
+		if err := binary.Read(buf, binary.BigEndian, &count); err != nil {
+			return nil, fmt.Errorf("failed to read stats error count: %w", err)
+		}
+		s.Errors[code] = count
+	}
+
+	if err := binary.Read(buf, binary.BigEndian, &bucketCount); err != nil {
+		return nil, fmt.Errorf("failed to read stats bucket_count: %w", err)
+	}
+	if bucketCount == 0 || bucketCount > StatsMaxHistogramBucket {
+		return nil, fmt.Errorf("invalid stats bucket_count: %d (max %d)", bucketCount, StatsMaxHistogramBucket)
+	}
+	s.BucketBoundsUs = make([]uint64, bucketCount)
+	if err := binary.Read(buf, binary.BigEndian, s.BucketBoundsUs); err != nil {
+		return nil, fmt.Errorf("failed to read stats bucket bounds: %w", err)
+	}
+
+	if err := binary.Read(buf, binary.BigEndian, &histogramCount); err != nil {
+		return nil, fmt.Errorf("failed to read stats histogram_count: %w", err)
+	}
+	if histogramCount > TimingStageCount {
+		return nil, fmt.Errorf("invalid stats histogram_count: %d (max %d)", histogramCount, TimingStageCount)
+	}
+	s.Histograms = make([]StatsHistogram, histogramCount)
+	for i := range s.Histograms {
+		h := &s.Histograms[i]
+		for _, field := range []interface{}{&h.Stage, &h.Count, &h.SumUs} {
+			if err := binary.Read(buf, binary.BigEndian, field); err != nil {
+				return nil, fmt.Errorf("failed to read stats histogram: %w", err)
+			}
+		}
+		h.Buckets = make([]uint64, bucketCount)
+		if err := binary.Read(buf, binary.BigEndian, h.Buckets); err != nil {
+			return nil, fmt.Errorf("failed to read stats histogram buckets: %w", err)
+		}
+	}
+
+	if buf.Len() != 0 {
+		return nil, fmt.Errorf("stats payload has %d trailing bytes", buf.Len())
+	}
+
+	return &s, nil
+}
+
+// validateImageMetadata checks image dimensions, channels, and that dataLen
+// matches width * height * channels.
+func validateImageMetadata(width, height, channels, dataLen uint32) error {
+	// Validate image dimensions
+	if width < SD35MinWidth || width > SD35MaxWidth || width%SD35DimensionAlign != 0 {
+		return fmt.Errorf("%w: width %d (must be %d-%d, multiple of %d)",
+			ErrInvalidDimensions, width, SD35MinWidth, SD35MaxWidth, SD35DimensionAlign)
+	}
+	if height < SD35MinHeight || height > SD35MaxHeight || height%SD35DimensionAlign != 0 {
+		return fmt.Errorf("%w: height %d (must be %d-%d, multiple of %d)",
+			ErrInvalidDimensions, height, SD35MinHeight, SD35MaxHeight, SD35DimensionAlign)
+	}
+
+	// Validate channels
+	if channels != SD35ChannelsRGB && channels != SD35ChannelsRGBA {
+		return fmt.Errorf("invalid channels: got %d, expected %d (RGB) or %d (RGBA)",
+			channels, SD35ChannelsRGB, SD35ChannelsRGBA)
+	}
+
+	// Validate image_data_len matches dimensions
+	// Check for integer overflow first
+	if width > math.MaxUint32/height {
+		return fmt.Errorf("image dimensions too large: width * height would overflow")
+	}
+	if width*height > math.MaxUint32/channels {
+		return fmt.Errorf("image dimensions too large: width * height * channels would overflow")
+	}
+	expectedLen := width * height * channels
+	if dataLen != expectedLen {
+		return fmt.Errorf("image_data_len mismatch: got %d, expected %d (width %d * height %d * channels %d)",
+			dataLen, expectedLen, width, height, channels)
+	}
+
+	return nil
+}
+
 // decodeErrorResponse decodes a MSG_ERROR payload (status 400/500).
 // Payload structure:
 //   - request_id (8 bytes)
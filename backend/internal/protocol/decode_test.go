@@ -45,6 +45,54 @@ func buildGenerateResponse(requestID uint64, status uint32, generationTime uint3
 	return buf.Bytes()
 }
 
+// Helper function to build a progress frame
+func buildGenerateProgress(requestID uint64, step, totalSteps, width, height, channels, previewLen uint32, preview []byte) []byte {
+	buf := new(bytes.Buffer)
+	buf.Write(buildHeader(MsgGenerateProgress, uint32(36+len(preview))))
+
+	fields := []uint32{step, totalSteps, 250, width, height, channels, previewLen}
+	binary.Write(buf, binary.BigEndian, requestID)
+	for _, f := range fields {
+		binary.Write(buf, binary.BigEndian, f)
+	}
+	buf.Write(preview)
+
+	return buf.Bytes()
+}
+
+// Helper function to build a complete batch generate response
+func buildGenerateBatchResponse(requestID uint64, status uint32, width, height, channels, imageCount, imageDataLen uint32, images [][]byte) []byte {
+	buf := new(bytes.Buffer)
+
+	dataLen := 0
+	for _, img := range images {
+		dataLen += len(img)
+	}
+
+	// Common header
+	payloadLen := uint32(16 + 20 + dataLen) // response + image header + data
+	buf.Write(buildHeader(MsgGenerateBatchResponse, payloadLen))
+
+	// Common response fields
+	binary.Write(buf, binary.BigEndian, requestID)
+	binary.Write(buf, binary.BigEndian, status)
+	binary.Write(buf, binary.BigEndian, uint32(1000))
+
+	// Image header
+	binary.Write(buf, binary.BigEndian, width)
+	binary.Write(buf, binary.BigEndian, height)
+	binary.Write(buf, binary.BigEndian, channels)
+	binary.Write(buf, binary.BigEndian, imageCount)
+	binary.Write(buf, binary.BigEndian, imageDataLen)
+
+	// Image data
+	for _, img := range images {
+		buf.Write(img)
+	}
+
+	return buf.Bytes()
+}
+
 // Helper function to build a complete error response
 func buildErrorResponse(requestID uint64, status uint32, errorCode uint32, errorMsg string) []byte {
 	buf := new(bytes.Buffer)
@@ -678,3 +726,399 @@ func TestDecodeResponse_RoundTrip(t *testing.T) {
 		}
 	})
 }
+
+func TestDecodeGenerateBatchResponse(t *testing.T) {
+	const imageLen = 64 * 64 * 3
+	first := bytes.Repeat([]byte{0x11}, imageLen)
+	second := bytes.Repeat([]byte{0x22}, imageLen)
+
+	tests := []struct {
+		name      string
+		data      []byte
+		wantErr   bool
+		errMsg    string
+		wantCount int
+	}{
+		{
+			name:      "valid two images",
+			data:      buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, 2, imageLen, [][]byte{first, second}),
+			wantCount: 2,
+		},
+		{
+			name:      "valid single image",
+			data:      buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, 1, imageLen, [][]byte{first}),
+			wantCount: 1,
+		},
+		{
+			name:    "payload too small",
+			data:    append(buildHeader(MsgGenerateBatchResponse, 20), make([]byte, 20)...),
+			wantErr: true,
+			errMsg:  "payload too small",
+		},
+		{
+			name:    "wrong status code",
+			data:    buildGenerateBatchResponse(7, StatusBadRequest, 64, 64, 3, 1, imageLen, [][]byte{first}),
+			wantErr: true,
+			errMsg:  "invalid status for GENERATE_BATCH_RESPONSE",
+		},
+		{
+			name:    "zero images",
+			data:    buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, 0, imageLen, nil),
+			wantErr: true,
+			errMsg:  "invalid seed count",
+		},
+		{
+			name:    "too many images",
+			data:    buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, SD35MaxBatchSize+1, imageLen, nil),
+			wantErr: true,
+			errMsg:  "invalid seed count",
+		},
+		{
+			name:    "image_data_len mismatch",
+			data:    buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, 1, 1000, [][]byte{make([]byte, 1000)}),
+			wantErr: true,
+			errMsg:  "image_data_len mismatch",
+		},
+		{
+			name:    "fewer images than image_count",
+			data:    buildGenerateBatchResponse(7, StatusOK, 64, 64, 3, 3, imageLen, [][]byte{first, second}),
+			wantErr: true,
+			errMsg:  "truncated image data",
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			result, err := DecodeResponse(tt.data)
+			if (err != nil) != tt.wantErr {
+				t.Errorf("DecodeResponse() error = %v, wantErr %v", err, tt.wantErr)
+				return
+			}
+			if tt.wantErr && tt.errMsg != "" && !strings.Contains(err.Error(), tt.errMsg) {
+				t.Errorf("DecodeResponse() error = %v, want error containing %q", err, tt.errMsg)
+				return
+			}
+			if !tt.wantErr {
+				resp, ok := result.(*SD35GenerateBatchResponse)
+				if !ok {
+					t.Errorf("DecodeResponse() returned wrong type: got %T, want *SD35GenerateBatchResponse", result)
+					return
+				}
+				if resp.RequestID != 7 {
+					t.Errorf("RequestID = %d, want 7", resp.RequestID)
+				}
+				if len(resp.Images) != tt.wantCount {
+					t.Errorf("len(Images) = %d, want %d", len(resp.Images), tt.wantCount)
+					return
+				}
+				if !bytes.Equal(resp.Images[0], first) {
+					t.Errorf("Images[0] does not match first image")
+				}
+				if tt.wantCount > 1 && !bytes.Equal(resp.Images[1], second) {
+					t.Errorf("Images[1] does not match second image")
+				}
+			}
+		})
+	}
+}
+
+func TestDecodeGenerateProgress(t *testing.T) {
+	const previewLen = 96 * 96 * 3
+	preview := bytes.Repeat([]byte{0x33}, previewLen)
+
+	tests := []struct {
+		name        string
+		data        []byte
+		wantErr     bool
+		errMsg      string
+		wantPreview bool
+	}{
+		{
+			name: "step without preview",
+			data: buildGenerateProgress(5, 3, 28, 0, 0, 0, 0, nil),
+		},
+		{
+			name:        "step with preview",
+			data:        buildGenerateProgress(5, 4, 28, 96, 96, 3, previewLen, preview),
+			wantPreview: true,
+		},
+		{
+			name:    "payload too small",
+			data:    append(buildHeader(MsgGenerateProgress, 20), make([]byte, 20)...),
+			wantErr: true,
+			errMsg:  "progress payload too small",
+		},
+		{
+			name:    "step past total",
+			data:    buildGenerateProgress(5, 29, 28, 0, 0, 0, 0, nil),
+			wantErr: true,
+			errMsg:  "invalid steps",
+		},
+		{
+			name:    "preview too large",
+			data:    buildGenerateProgress(5, 4, 28, 512, 96, 3, previewLen, preview),
+			wantErr: true,
+			errMsg:  "invalid dimensions",
+		},
+		{
+			name:    "preview length mismatch",
+			data:    buildGenerateProgress(5, 4, 28, 64, 64, 3, previewLen, preview),
+			wantErr: true,
+			errMsg:  "preview_data_len mismatch",
+		},
+		{
+			name:    "truncated preview",
+			data:    buildGenerateProgress(5, 4, 28, 96, 96, 3, previewLen, preview[:100]),
+			wantErr: true,
+			errMsg:  "truncated preview data",
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			result, err := DecodeResponse(tt.data)
+			if (err != nil) != tt.wantErr {
+				t.Errorf("DecodeResponse() error = %v, wantErr %v", err, tt.wantErr)
+				return
+			}
+			if tt.wantErr && tt.errMsg != "" && !strings.Contains(err.Error(), tt.errMsg) {
+				t.Errorf("DecodeResponse() error = %v, want error containing %q", err, tt.errMsg)
+				return
+			}
+			if !tt.wantErr {
+				p, ok := result.(*GenerateProgress)
+				if !ok {
+					t.Errorf("DecodeResponse() returned wrong type: got %T, want *GenerateProgress", result)
+					return
+				}
+				if p.RequestID != 5 || p.TotalSteps != 28 || p.ElapsedMs != 250 {
+					t.Errorf("progress = %+v, want request 5, 28 steps, 250ms", p)
+				}
+				if tt.wantPreview != (p.Preview != nil) {
+					t.Errorf("Preview present = %v, want %v", p.Preview != nil, tt.wantPreview)
+				}
+				if tt.wantPreview && !bytes.Equal(p.Preview, preview) {
+					t.Errorf("Preview does not match")
+				}
+			}
+		})
+	}
+}
+
+// TestDecodeResponse_Version2Size verifies that reassembled version 2
+// responses may exceed MaxMessageSize while version 1 responses may not.
+func TestDecodeResponse_Version2Size(t *testing.T) {
+	channels := SD35ChannelsRGBA
+	dataLen := SD35MaxWidth * SD35MaxHeight * channels
+	data := buildGenerateResponse(5, StatusOK, 0, SD35MaxWidth, SD35MaxHeight, channels, dataLen,
+		make([]byte, dataLen))
+
+	if _, err := DecodeResponse(data); !isErrorType(err, ErrMessageTooLarge) {
+		t.Fatalf("DecodeResponse(v1) error = %v, want ErrMessageTooLarge", err)
+	}
+
+	binary.BigEndian.PutUint16(data[4:6], ProtocolVersion2)
+	decoded, err := DecodeResponse(data)
+	if err != nil {
+		t.Fatalf("DecodeResponse(v2) error = %v", err)
+	}
+	resp, ok := decoded.(*SD35GenerateResponse)
+	if !ok {
+		t.Fatalf("DecodeResponse(v2) returned %T, want *SD35GenerateResponse", decoded)
+	}
+	if uint32(len(resp.ImageData)) != dataLen {
+		t.Errorf("len(ImageData) = %d, want %d", len(resp.ImageData), dataLen)
+	}
+}
+
+// TestDecodeGenerateResponse_PNG verifies that FlagPNG responses carry a
+// PNG file of any length for valid dimensions.
+func TestDecodeGenerateResponse_PNG(t *testing.T) {
+	pngData := []byte{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'}
+
+	tests := []struct {
+		name    string
+		width   uint32
+		data    []byte
+		wantErr bool
+	}{
+		{name: "png file", width: 512, data: pngData},
+		{name: "invalid dimensions", width: 100, data: pngData, wantErr: true},
+		{name: "empty file", width: 512, data: nil, wantErr: true},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			data := buildGenerateResponse(4, StatusOK, 10, tt.width, 512, SD35ChannelsRGB,
+				uint32(len(tt.data)), tt.data)
+			binary.BigEndian.PutUint32(data[12:16], FlagPNG)
+
+			decoded, err := DecodeResponse(data)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("DecodeResponse() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			resp := decoded.(*SD35GenerateResponse)
+			if resp.Format != ImageFormatPNG {
+				t.Errorf("Format = %v, want ImageFormatPNG", resp.Format)
+			}
+			if !bytes.Equal(resp.ImageData, tt.data) {
+				t.Errorf("ImageData = %v, want %v", resp.ImageData, tt.data)
+			}
+		})
+	}
+
+	// Without the flag the same payload is a raw image of the wrong size
+	data := buildGenerateResponse(4, StatusOK, 10, 512, 512, SD35ChannelsRGB, uint32(len(pngData)), pngData)
+	if _, err := DecodeResponse(data); err == nil {
+		t.Errorf("DecodeResponse() without FlagPNG error = nil, want length mismatch")
+	}
+}
+
+// buildGenerateTimings builds a MSG_GENERATE_TIMINGS frame with stage i
+// taking (i + 1) * 1000 microseconds.
+func buildGenerateTimings(requestID uint64, stageCount uint32, steps []uint32) []byte {
+	payload := new(bytes.Buffer)
+	binary.Write(payload, binary.BigEndian, requestID)
+	binary.Write(payload, binary.BigEndian, stageCount)
+	for i := uint32(0); i < stageCount; i++ {
+		binary.Write(payload, binary.BigEndian, uint64(i+1)*1000)
+	}
+	binary.Write(payload, binary.BigEndian, uint32(len(steps)))
+	binary.Write(payload, binary.BigEndian, steps)
+
+	return append(buildHeader(MsgGenerateTimings, uint32(payload.Len())), payload.Bytes()...)
+}
+
+func TestDecodeGenerateTimings(t *testing.T) {
+	t.Run("valid", func(t *testing.T) {
+		result, err := DecodeResponse(buildGenerateTimings(7, TimingStageCount, []uint32{500, 600}))
+		if err != nil {
+			t.Fatalf("DecodeResponse() error = %v", err)
+		}
+		timings, ok := result.(*GenerateTimings)
+		if !ok {
+			t.Fatalf("DecodeResponse() returned %T, want *GenerateTimings", result)
+		}
+		if timings.RequestID != 7 {
+			t.Errorf("RequestID = %d, want 7", timings.RequestID)
+		}
+		if timings.StagesUs[TimingStageSampling] != 4000 || timings.StagesUs[TimingStageTotal] != 8000 {
+			t.Errorf("StagesUs = %v", timings.StagesUs)
+		}
+		if len(timings.StepsUs) != 2 || timings.StepsUs[1] != 600 {
+			t.Errorf("StepsUs = %v, want [500 600]", timings.StepsUs)
+		}
+	})
+
+	errTests := []struct {
+		name   string
+		data   []byte
+		errMsg string
+	}{
+		{"wrong stage count", buildGenerateTimings(7, 3, nil), "invalid timings stage_count"},
+		{"truncated stages", append(buildHeader(MsgGenerateTimings, 20), make([]byte, 20)...), "invalid timings stage_count"},
+		{"steps missing", buildGenerateTimings(7, TimingStageCount, []uint32{1, 2})[:16+8+4+64+4+4], "timings payload mismatch"},
+	}
+	for _, tt := range errTests {
+		t.Run(tt.name, func(t *testing.T) {
+			data := tt.data
+			binary.BigEndian.PutUint32(data[8:12], uint32(len(data)-16))
+			_, err := DecodeResponse(data)
+			if err == nil || !strings.Contains(err.Error(), tt.errMsg) {
+				t.Errorf("DecodeResponse() error = %v, want error containing %q", err, tt.errMsg)
+			}
+		})
+	}
+}
+
+// buildStatsResponse builds a MSG_STATS_RESPONSE with every priority class,
+// two error codes, two buckets and one histogram.
+func buildStatsResponse(requestID uint64, bucketCount uint32) []byte {
+	payload := new(bytes.Buffer)
+	for _, f := range []interface{}{requestID, StatusOK, uint64(90000), uint64(12), uint64(9),
+		uint32(2), uint32(1), uint64(6 << 30), uint64(40), uint64(3), uint64(32 << 20)} {
+		binary.Write(payload, binary.BigEndian, f)
+	}
+	binary.Write(payload, binary.BigEndian, PriorityCount)
+	for i := uint32(0); i < PriorityCount; i++ {
+		binary.Write(payload, binary.BigEndian, i)        // queue_depth
+		binary.Write(payload, binary.BigEndian, i*30000) // wait_ms
+	}
+	binary.Write(payload, binary.BigEndian, uint32(2))
+	binary.Write(payload, binary.BigEndian, ErrCodeTimeout)
+	binary.Write(payload, binary.BigEndian, uint64(1))
+	binary.Write(payload, binary.BigEndian, ErrCodeInternal)
+	binary.Write(payload, binary.BigEndian, uint64(2))
+
+	binary.Write(payload, binary.BigEndian, bucketCount)
+	for i := uint32(0); i < bucketCount; i++ {
+		binary.Write(payload, binary.BigEndian, uint64(i+1)*1000)
+	}
+	binary.Write(payload, binary.BigEndian, uint32(1))
+	binary.Write(payload, binary.BigEndian, uint32(TimingStageTotal))
+	binary.Write(payload, binary.BigEndian, uint64(9))
+	binary.Write(payload, binary.BigEndian, uint64(12345))
+	for i := uint32(0); i < bucketCount; i++ {
+		binary.Write(payload, binary.BigEndian, uint64(i))
+	}
+
+	return append(buildHeader(MsgStatsResponse, uint32(payload.Len())), payload.Bytes()...)
+}
+
+func TestDecodeStatsResponse(t *testing.T) {
+	result, err := DecodeResponse(buildStatsResponse(3, 2))
+	if err != nil {
+		t.Fatalf("DecodeResponse() error = %v", err)
+	}
+	stats, ok := result.(*StatsResponse)
+	if !ok {
+		t.Fatalf("DecodeResponse() returned %T, want *StatsResponse", result)
+	}
+	if stats.RequestID != 3 || stats.Requests != 12 || stats.Completed != 9 ||
+		stats.QueueDepth != 2 || stats.InFlight != 1 || stats.VRAMBytes != 6<<30 ||
+		stats.PoolHits != 40 || stats.PoolMisses != 3 || stats.PoolIdleBytes != 32<<20 {
+		t.Errorf("counters = %+v", stats)
+	}
+	if len(stats.ClassQueue) != int(PriorityCount) ||
+		stats.ClassQueue[PriorityBatch] != (StatsClassQueue{Depth: 2, WaitMs: 60000}) {
+		t.Errorf("ClassQueue = %+v", stats.ClassQueue)
+	}
+	if stats.Errors[ErrCodeTimeout] != 1 || stats.Errors[ErrCodeInternal] != 2 || len(stats.Errors) != 2 {
+		t.Errorf("Errors = %v", stats.Errors)
+	}
+	if len(stats.BucketBoundsUs) != 2 || stats.BucketBoundsUs[1] != 2000 {
+		t.Errorf("BucketBoundsUs = %v", stats.BucketBoundsUs)
+	}
+	if len(stats.Histograms) != 1 || stats.Histograms[0].Stage != TimingStageTotal ||
+		stats.Histograms[0].SumUs != 12345 || stats.Histograms[0].Buckets[1] != 1 {
+		t.Errorf("Histograms = %+v", stats.Histograms)
+	}
+
+	t.Run("too many buckets", func(t *testing.T) {
+		_, err := DecodeResponse(buildStatsResponse(3, StatsMaxHistogramBucket+1))
+		if err == nil || !strings.Contains(err.Error(), "invalid stats bucket_count") {
+			t.Errorf("DecodeResponse() error = %v, want invalid bucket_count", err)
+		}
+	})
+
+	t.Run("too many classes", func(t *testing.T) {
+		data := buildStatsResponse(3, 2)
+		binary.BigEndian.PutUint32(data[16+76:], PriorityCount+1)
+		_, err := DecodeResponse(data)
+		if err == nil || !strings.Contains(err.Error(), "invalid stats class_count") {
+			t.Errorf("DecodeResponse() error = %v, want invalid class_count", err)
+		}
+	})
+
+	t.Run("trailing bytes", func(t *testing.T) {
+		data := append(buildStatsResponse(3, 2), 0)
+		binary.BigEndian.PutUint32(data[8:12], uint32(len(data)-16))
+		_, err := DecodeResponse(data)
+		if err == nil || !strings.Contains(err.Error(), "trailing bytes") {
+			t.Errorf("DecodeResponse() error = %v, want trailing bytes", err)
+		}
+	})
+}
@@ -19,8 +19,14 @@ func EncodeSD35GenerateRequest(req *SD35GenerateRequest) ([]byte, error) {
 	// Common request fields: 12 bytes (request_id=8 + model_id=4)
 	// SD35 params: 48 bytes (width=4 + height=4 + steps=4 + cfg=4 + seed=8 + offset_table=24)
 	// Prompt data: 3 * len(prompt) bytes
+	// Sampling block: 8 bytes (sampler=4 + scheduler=4), only with FlagSampling
+	// Init image block: 24 bytes + pixels, only with FlagInitImage
+	// Scheduling block: 8 bytes (priority=4 + deadline_ms=4), only with FlagScheduling
 	promptLen := uint32(len(req.PromptData))
-	sd35PayloadSize := uint32(48 + promptLen)
+	flags, samplingLen := samplingFlags(req.Header.Flags, req.Sampler, req.Scheduler)
+	flags, initLen := initImageFlags(flags, req)
+	flags, schedulingLen := schedulingFlags(flags, req.Priority, req.DeadlineMs)
+	sd35PayloadSize := uint32(48 + samplingLen + initLen + schedulingLen + promptLen)
 	payloadLen := 12 + sd35PayloadSize
 
 	// Check total message size
@@ -33,10 +39,10 @@ func EncodeSD35GenerateRequest(req *SD35GenerateRequest) ([]byte, error) {
 
 	// Common header (16 bytes)
 	binary.Write(buf, binary.BigEndian, MagicNumber)
-	binary.Write(buf, binary.BigEndian, ProtocolVersion1)
+	binary.Write(buf, binary.BigEndian, requestVersion(req.Header))
 	binary.Write(buf, binary.BigEndian, MsgGenerateRequest)
 	binary.Write(buf, binary.BigEndian, payloadLen)
-	binary.Write(buf, binary.BigEndian, uint32(0)) // reserved
+	binary.Write(buf, binary.BigEndian, flags)
 
 	// Common request fields (12 bytes)
 	binary.Write(buf, binary.BigEndian, req.RequestID)
@@ -57,12 +63,190 @@ func EncodeSD35GenerateRequest(req *SD35GenerateRequest) ([]byte, error) {
 	binary.Write(buf, binary.BigEndian, req.T5Offset)
 	binary.Write(buf, binary.BigEndian, req.T5Length)
 
+	writeSampling(buf, flags, req.Sampler, req.Scheduler)
+	writeInitImage(buf, flags, req)
+	writeScheduling(buf, flags, req.Priority, req.DeadlineMs)
+
+	// Prompt data (variable)
+	buf.Write(req.PromptData)
+
+	return buf.Bytes(), nil
+}
+
+// EncodeSD35GenerateBatchRequest encodes an SD35GenerateBatchRequest to bytes.
+// Returns the encoded message or an error if validation fails.
+func EncodeSD35GenerateBatchRequest(req *SD35GenerateBatchRequest) ([]byte, error) {
+	if req == nil {
+		return nil, fmt.Errorf("request is nil")
+	}
+
+	seedCount := uint32(len(req.Seeds))
+	if seedCount < SD35MinBatchSize || seedCount > SD35MaxBatchSize {
+		return nil, fmt.Errorf("%w: %d seeds not in range [%d, %d]", ErrInvalidSeedCount, seedCount, SD35MinBatchSize, SD35MaxBatchSize)
+	}
+
+	// Validate shared parameters using the single-request rules
+	if err := validateSD35Request(req.single()); err != nil {
+		return nil, err
+	}
+
+	// Calculate sizes
+	// Common request fields: 12 bytes (request_id=8 + model_id=4)
+	// SD35 params: 44 bytes (width=4 + height=4 + steps=4 + cfg=4 + seed_count=4 + offset_table=24)
+	// Seeds: 8 bytes each
+	// Sampling block: 8 bytes, only with FlagSampling
+	// Init image block: 24 bytes + pixels, only with FlagInitImage
+	// Scheduling block: 8 bytes, only with FlagScheduling
+	// Prompt data: 3 * len(prompt) bytes
+	promptLen := uint32(len(req.PromptData))
+	flags, samplingLen := samplingFlags(req.Header.Flags, req.Sampler, req.Scheduler)
+	flags, initLen := initImageFlags(flags, req.single())
+	flags, schedulingLen := schedulingFlags(flags, req.Priority, req.DeadlineMs)
+	payloadLen := 12 + 44 + seedCount*8 + samplingLen + initLen + schedulingLen + promptLen
+
+	// Check total message size
+	totalSize := 16 + payloadLen // header + payload
+	if totalSize > MaxMessageSize {
+		return nil, fmt.Errorf("%w: %d bytes exceeds limit of %d", ErrMessageTooLarge, totalSize, MaxMessageSize)
+	}
+
+	buf := new(bytes.Buffer)
+
+	// Common header (16 bytes)
+	binary.Write(buf, binary.BigEndian, MagicNumber)
+	binary.Write(buf, binary.BigEndian, requestVersion(req.Header))
+	binary.Write(buf, binary.BigEndian, MsgGenerateBatchRequest)
+	binary.Write(buf, binary.BigEndian, payloadLen)
+	binary.Write(buf, binary.BigEndian, flags)
+
+	// Common request fields (12 bytes)
+	binary.Write(buf, binary.BigEndian, req.RequestID)
+	binary.Write(buf, binary.BigEndian, req.ModelID)
+
+	// SD35 batch parameters (20 bytes)
+	binary.Write(buf, binary.BigEndian, req.Width)
+	binary.Write(buf, binary.BigEndian, req.Height)
+	binary.Write(buf, binary.BigEndian, req.Steps)
+	binary.Write(buf, binary.BigEndian, math.Float32bits(req.CFGScale))
+	binary.Write(buf, binary.BigEndian, seedCount)
+
+	// Prompt offset table (24 bytes)
+	binary.Write(buf, binary.BigEndian, req.CLIPLOffset)
+	binary.Write(buf, binary.BigEndian, req.CLIPLLength)
+	binary.Write(buf, binary.BigEndian, req.CLIPGOffset)
+	binary.Write(buf, binary.BigEndian, req.CLIPGLength)
+	binary.Write(buf, binary.BigEndian, req.T5Offset)
+	binary.Write(buf, binary.BigEndian, req.T5Length)
+
+	// Seeds (8 bytes each)
+	for _, seed := range req.Seeds {
+		binary.Write(buf, binary.BigEndian, seed)
+	}
+
+	writeSampling(buf, flags, req.Sampler, req.Scheduler)
+	writeInitImage(buf, flags, req.single())
+	writeScheduling(buf, flags, req.Priority, req.DeadlineMs)
+
 	// Prompt data (variable)
 	buf.Write(req.PromptData)
 
 	return buf.Bytes(), nil
 }
 
+// single returns the batch parameters as a single-seed request, used to
+// share validation with SD35GenerateRequest.
+func (req *SD35GenerateBatchRequest) single() *SD35GenerateRequest {
+	return &SD35GenerateRequest{
+		GenerateRequest: req.GenerateRequest,
+		Width:           req.Width,
+		Height:          req.Height,
+		Steps:           req.Steps,
+		CFGScale:        req.CFGScale,
+		Sampler:         req.Sampler,
+		Scheduler:       req.Scheduler,
+		InitSource:      req.InitSource,
+		Strength:        req.Strength,
+		InitRequestID:   req.InitRequestID,
+		InitIndex:       req.InitIndex,
+		InitImage:       req.InitImage,
+		Priority:        req.Priority,
+		DeadlineMs:      req.DeadlineMs,
+		CLIPLOffset:     req.CLIPLOffset,
+		CLIPLLength:     req.CLIPLLength,
+		CLIPGOffset:     req.CLIPGOffset,
+		CLIPGLength:     req.CLIPGLength,
+		T5Offset:        req.T5Offset,
+		T5Length:        req.T5Length,
+		PromptData:      req.PromptData,
+	}
+}
+
+// samplingFlags returns the header flags to send and the size of the
+// sampling block. The block is sent when the caller set FlagSampling or asked
+// for anything but the model defaults.
+func samplingFlags(flags, sampler, scheduler uint32) (uint32, uint32) {
+	if sampler != SamplerDefault || scheduler != SchedulerDefault {
+		flags |= FlagSampling
+	}
+	if flags&FlagSampling == 0 {
+		return flags, 0
+	}
+	return flags, 8
+}
+
+// writeSampling writes the sampling block if flags carry FlagSampling.
+func writeSampling(buf *bytes.Buffer, flags, sampler, scheduler uint32) {
+	if flags&FlagSampling == 0 {
+		return
+	}
+	binary.Write(buf, binary.BigEndian, sampler)
+	binary.Write(buf, binary.BigEndian, scheduler)
+}
+
+// initImageFlags returns the header flags to send and the size of the init
+// image block, pixels included. The block is sent only for an init image.
+func initImageFlags(flags uint32, req *SD35GenerateRequest) (uint32, uint32) {
+	if req.InitSource == InitSourceNone {
+		return flags &^ FlagInitImage, 0
+	}
+	return flags | FlagInitImage, InitImageBlockSize + uint32(len(req.InitImage))
+}
+
+// writeInitImage writes the init image block if flags carry FlagInitImage.
+func writeInitImage(buf *bytes.Buffer, flags uint32, req *SD35GenerateRequest) {
+	if flags&FlagInitImage == 0 {
+		return
+	}
+	binary.Write(buf, binary.BigEndian, math.Float32bits(req.Strength))
+	binary.Write(buf, binary.BigEndian, req.InitSource)
+	binary.Write(buf, binary.BigEndian, req.InitRequestID)
+	binary.Write(buf, binary.BigEndian, req.InitIndex)
+	binary.Write(buf, binary.BigEndian, uint32(len(req.InitImage)))
+	buf.Write(req.InitImage)
+}
+
+// schedulingFlags returns the header flags to send and the size of the
+// scheduling block. The block is sent when the caller set FlagScheduling or
+// asked for anything but an interactive request with the server's timeout.
+func schedulingFlags(flags, priority, deadlineMs uint32) (uint32, uint32) {
+	if priority != PriorityInteractive || deadlineMs != 0 {
+		flags |= FlagScheduling
+	}
+	if flags&FlagScheduling == 0 {
+		return flags, 0
+	}
+	return flags, SchedulingBlockSize
+}
+
+// writeScheduling writes the scheduling block if flags carry FlagScheduling.
+func writeScheduling(buf *bytes.Buffer, flags, priority, deadlineMs uint32) {
+	if flags&FlagScheduling == 0 {
+		return
+	}
+	binary.Write(buf, binary.BigEndian, priority)
+	binary.Write(buf, binary.BigEndian, deadlineMs)
+}
+
 // validateSD35Request validates all parameters of an SD35GenerateRequest.
 func validateSD35Request(req *SD35GenerateRequest) error {
 	if req == nil {
@@ -99,9 +283,40 @@ func validateSD35Request(req *SD35GenerateRequest) error {
 		return fmt.Errorf("%w: cfg_scale %.2f not in range [%.1f, %.1f]", ErrInvalidCFG, req.CFGScale, SD35MinCFG, SD35MaxCFG)
 	}
 
+	// Validate sampling
+	if req.Sampler >= SamplerCount {
+		return fmt.Errorf("%w: sampler %d not in range [0, %d)", ErrInvalidSampler, req.Sampler, SamplerCount)
+	}
+	if req.Scheduler >= SchedulerCount {
+		return fmt.Errorf("%w: scheduler %d not in range [0, %d)", ErrInvalidSampler, req.Scheduler, SchedulerCount)
+	}
+
+	// Validate init image
+	switch req.InitSource {
+	case InitSourceNone:
+	case InitSourceInline:
+		if want := int(req.Width) * int(req.Height) * 3; len(req.InitImage) != want {
+			return fmt.Errorf("%w: %d bytes of pixels, expected %d for %dx%d RGB", ErrInvalidInitImage, len(req.InitImage), want, req.Width, req.Height)
+		}
+	case InitSourceRetained:
+		if len(req.InitImage) != 0 {
+			return fmt.Errorf("%w: retained init image carries %d bytes of pixels", ErrInvalidInitImage, len(req.InitImage))
+		}
+	default:
+		return fmt.Errorf("%w: source %d not supported", ErrInvalidInitImage, req.InitSource)
+	}
+	if req.InitSource != InitSourceNone && !(req.Strength > 0 && req.Strength <= 1) {
+		return fmt.Errorf("%w: strength %v not in range (0.0, 1.0]", ErrInvalidInitImage, req.Strength)
+	}
+
+	// Validate scheduling
+	if req.Priority >= PriorityCount {
+		return fmt.Errorf("%w: priority %d not in range [0, %d)", ErrInvalidPriority, req.Priority, PriorityCount)
+	}
+
 	// Validate model ID
-	if req.ModelID != ModelIDSD35 {
-		return fmt.Errorf("%w: model_id %d not supported (expected %d)", ErrInvalidModelID, req.ModelID, ModelIDSD35)
+	if req.ModelID > ModelIDSD35Max {
+		return fmt.Errorf("%w: model_id %d not supported (expected %d-%d)", ErrInvalidModelID, req.ModelID, ModelIDSD35, ModelIDSD35Max)
 	}
 
 	// Validate prompt data
@@ -120,8 +335,12 @@ func validateSD35Request(req *SD35GenerateRequest) error {
 	if req.CLIPGLength < SD35MinPromptLen || req.CLIPGLength > SD35MaxPromptLen {
 		return fmt.Errorf("%w: clip_g_length %d not in range [%d, %d]", ErrInvalidPrompt, req.CLIPGLength, SD35MinPromptLen, SD35MaxPromptLen)
 	}
-	if req.T5Length < SD35MinPromptLen || req.T5Length > SD35MaxPromptLen {
-		return fmt.Errorf("%w: t5_length %d not in range [%d, %d]", ErrInvalidPrompt, req.T5Length, SD35MinPromptLen, SD35MaxPromptLen)
+	minT5Len := SD35MinPromptLen
+	if req.Header.Flags&FlagCLIPOnly != 0 {
+		minT5Len = 0
+	}
+	if req.T5Length < minT5Len || req.T5Length > SD35MaxPromptLen {
+		return fmt.Errorf("%w: t5_length %d not in range [%d, %d]", ErrInvalidPrompt, req.T5Length, minT5Len, SD35MaxPromptLen)
 	}
 
 	// Validate prompt offsets (bounds checking)
@@ -180,7 +399,7 @@ func NewSD35GenerateRequest(requestID uint64, prompt string, width, height, step
 				Version:    ProtocolVersion1,
 				MsgType:    MsgGenerateRequest,
 				PayloadLen: 0, // Will be calculated during encoding
-				Reserved:   0,
+				Flags:      0,
 			},
 			RequestID: requestID,
 			ModelID:   ModelIDSD35,
@@ -204,3 +423,108 @@ func NewSD35GenerateRequest(requestID uint64, prompt string, width, height, step
 
 	return req, nil
 }
+
+// NewSD35GenerateBatchRequest creates a new SD35GenerateBatchRequest with the
+// prompt duplicated three times, like NewSD35GenerateRequest. One image is
+// generated per seed.
+func NewSD35GenerateBatchRequest(requestID uint64, prompt string, width, height, steps uint32, cfgScale float32, seeds []uint64) (*SD35GenerateBatchRequest, error) {
+	single, err := NewSD35GenerateRequest(requestID, prompt, width, height, steps, cfgScale, 0)
+	if err != nil {
+		return nil, err
+	}
+
+	seedCount := uint32(len(seeds))
+	if seedCount < SD35MinBatchSize || seedCount > SD35MaxBatchSize {
+		return nil, fmt.Errorf("%w: %d seeds not in range [%d, %d]", ErrInvalidSeedCount, seedCount, SD35MinBatchSize, SD35MaxBatchSize)
+	}
+
+	req := &SD35GenerateBatchRequest{
+		GenerateRequest: single.GenerateRequest,
+		Width:           single.Width,
+		Height:          single.Height,
+		Steps:           single.Steps,
+		CFGScale:        single.CFGScale,
+		CLIPLOffset:     single.CLIPLOffset,
+		CLIPLLength:     single.CLIPLLength,
+		CLIPGOffset:     single.CLIPGOffset,
+		CLIPGLength:     single.CLIPGLength,
+		T5Offset:        single.T5Offset,
+		T5Length:        single.T5Length,
+		Seeds:           append([]uint64(nil), seeds...),
+		PromptData:      single.PromptData,
+	}
+	req.Header.MsgType = MsgGenerateBatchRequest
+
+	return req, nil
+}
+
+// EncodeStatsRequest encodes a MSG_STATS_REQUEST. weave-compute answers it
+// with a MSG_STATS_RESPONSE echoing requestID, without queueing it behind
+// generation requests.
+func EncodeStatsRequest(requestID uint64) []byte {
+	buf := new(bytes.Buffer)
+
+	binary.Write(buf, binary.BigEndian, MagicNumber)
+	binary.Write(buf, binary.BigEndian, ProtocolVersion1)
+	binary.Write(buf, binary.BigEndian, MsgStatsRequest)
+	binary.Write(buf, binary.BigEndian, uint32(8))
+	binary.Write(buf, binary.BigEndian, uint32(0))
+	binary.Write(buf, binary.BigEndian, requestID)
+
+	return buf.Bytes()
+}
+
+// EncodePrepareRequest encodes a MSG_PREPARE announcing a generation request
+// that will follow, so weave-compute can load the model and reset the
+// context while the request is still being composed. requestID is the ID the
+// request will carry (0 if not assigned yet) and flags the header flags it
+// will set. The prompt may be empty or partial and is duplicated for all
+// three encoders, like NewSD35GenerateRequest does. weave-compute does not
+// reply to it.
+func EncodePrepareRequest(requestID uint64, modelID, width, height, flags uint32, prompt string) ([]byte, error) {
+	if modelID > ModelIDSD35Max {
+		return nil, fmt.Errorf("%w: %d", ErrInvalidModelID, modelID)
+	}
+	if width < SD35MinWidth || width > SD35MaxWidth || width%SD35DimensionAlign != 0 {
+		return nil, fmt.Errorf("%w: width %d", ErrInvalidDimensions, width)
+	}
+	if height < SD35MinHeight || height > SD35MaxHeight || height%SD35DimensionAlign != 0 {
+		return nil, fmt.Errorf("%w: height %d", ErrInvalidDimensions, height)
+	}
+	promptLen := uint32(len(prompt))
+	if promptLen > SD35MaxPromptLen {
+		return nil, fmt.Errorf("%w: prompt length %d exceeds maximum %d", ErrInvalidPrompt, promptLen, SD35MaxPromptLen)
+	}
+
+	buf := new(bytes.Buffer)
+
+	binary.Write(buf, binary.BigEndian, MagicNumber)
+	binary.Write(buf, binary.BigEndian, ProtocolVersion1)
+	binary.Write(buf, binary.BigEndian, MsgPrepare)
+	binary.Write(buf, binary.BigEndian, 44+3*promptLen)
+	binary.Write(buf, binary.BigEndian, flags)
+
+	binary.Write(buf, binary.BigEndian, requestID)
+	binary.Write(buf, binary.BigEndian, modelID)
+	binary.Write(buf, binary.BigEndian, width)
+	binary.Write(buf, binary.BigEndian, height)
+	for i := uint32(0); i < 3; i++ {
+		binary.Write(buf, binary.BigEndian, i*promptLen)
+		binary.Write(buf, binary.BigEndian, promptLen)
+	}
+	for i := 0; i < 3; i++ {
+		buf.WriteString(prompt)
+	}
+
+	return buf.Bytes(), nil
+}
+
+// requestVersion returns the version to put in a request header. Version 2
+// is sent only when the request asks for it; anything else encodes as
+// version 1.
+func requestVersion(h Header) uint16 {
+	if h.Version == ProtocolVersion2 {
+		return ProtocolVersion2
+	}
+	return ProtocolVersion1
+}
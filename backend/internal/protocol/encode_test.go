@@ -3,7 +3,9 @@ package protocol
 import (
 	"bytes"
 	"encoding/binary"
+	"errors"
 	"math"
+	"strings"
 	"testing"
 )
 
@@ -35,6 +37,28 @@ func TestEncodeSD35GenerateRequest(t *testing.T) {
 			},
 			wantErr: nil,
 		},
+		{
+			name: "valid request for another SD 3.5 family model",
+			req: &SD35GenerateRequest{
+				GenerateRequest: GenerateRequest{
+					RequestID: 1,
+					ModelID:   ModelIDSD35Max,
+				},
+				Width:       512,
+				Height:      512,
+				Steps:       4,
+				CFGScale:    1.0,
+				Seed:        0,
+				CLIPLOffset: 0,
+				CLIPLLength: 5,
+				CLIPGOffset: 5,
+				CLIPGLength: 5,
+				T5Offset:    10,
+				T5Length:    5,
+				PromptData:  []byte("testttestttestt"),
+			},
+			wantErr: nil,
+		},
 		{
 			name: "valid request with minimum dimensions",
 			req: &SD35GenerateRequest{
@@ -819,3 +843,490 @@ func TestEncodeSD35GenerateRequest_HexDump(t *testing.T) {
 		t.Errorf("total message size = %d bytes, want 118", len(data))
 	}
 }
+
+func TestEncodeSD35GenerateBatchRequest(t *testing.T) {
+	tests := []struct {
+		name    string
+		seeds   []uint64
+		modify  func(*SD35GenerateBatchRequest)
+		wantErr error
+	}{
+		{
+			name:  "single seed",
+			seeds: []uint64{42},
+		},
+		{
+			name:  "maximum seeds",
+			seeds: []uint64{1, 2, 3, 4, 5, 6, 7, 8},
+		},
+		{
+			name:    "no seeds",
+			seeds:   []uint64{1},
+			modify:  func(r *SD35GenerateBatchRequest) { r.Seeds = nil },
+			wantErr: ErrInvalidSeedCount,
+		},
+		{
+			name:    "too many seeds",
+			seeds:   []uint64{1},
+			modify:  func(r *SD35GenerateBatchRequest) { r.Seeds = make([]uint64, SD35MaxBatchSize+1) },
+			wantErr: ErrInvalidSeedCount,
+		},
+		{
+			name:    "invalid steps",
+			seeds:   []uint64{1, 2},
+			modify:  func(r *SD35GenerateBatchRequest) { r.Steps = 0 },
+			wantErr: ErrInvalidSteps,
+		},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			req, err := NewSD35GenerateBatchRequest(9, "a cat in space", 512, 512, 28, 7.0, tt.seeds)
+			if err != nil {
+				t.Fatalf("NewSD35GenerateBatchRequest() error = %v", err)
+			}
+			if tt.modify != nil {
+				tt.modify(req)
+			}
+
+			data, err := EncodeSD35GenerateBatchRequest(req)
+			if tt.wantErr != nil {
+				if !errors.Is(err, tt.wantErr) {
+					t.Errorf("EncodeSD35GenerateBatchRequest() error = %v, want %v", err, tt.wantErr)
+				}
+				return
+			}
+			if err != nil {
+				t.Fatalf("EncodeSD35GenerateBatchRequest() error = %v", err)
+			}
+
+			promptLen := 3 * len("a cat in space")
+			wantLen := 16 + 12 + 44 + 8*len(tt.seeds) + promptLen
+			if len(data) != wantLen {
+				t.Fatalf("encoded length = %d, want %d", len(data), wantLen)
+			}
+			if got := binary.BigEndian.Uint16(data[6:8]); got != MsgGenerateBatchRequest {
+				t.Errorf("msg_type = 0x%04X, want 0x%04X", got, MsgGenerateBatchRequest)
+			}
+			if got := binary.BigEndian.Uint32(data[44:48]); got != uint32(len(tt.seeds)) {
+				t.Errorf("seed_count = %d, want %d", got, len(tt.seeds))
+			}
+			for i, seed := range tt.seeds {
+				off := 72 + 8*i
+				if got := binary.BigEndian.Uint64(data[off : off+8]); got != seed {
+					t.Errorf("seeds[%d] = %d, want %d", i, got, seed)
+				}
+			}
+			if !bytes.Equal(data[72+8*len(tt.seeds):], req.PromptData) {
+				t.Errorf("prompt data not at end of message")
+			}
+		})
+	}
+}
+
+func TestNewSD35GenerateBatchRequest_InvalidSeedCount(t *testing.T) {
+	if _, err := NewSD35GenerateBatchRequest(1, "a cat", 512, 512, 28, 7.0, nil); !errors.Is(err, ErrInvalidSeedCount) {
+		t.Errorf("NewSD35GenerateBatchRequest(nil seeds) error = %v, want %v", err, ErrInvalidSeedCount)
+	}
+	if _, err := NewSD35GenerateBatchRequest(1, "", 512, 512, 28, 7.0, []uint64{1}); !errors.Is(err, ErrInvalidPrompt) {
+		t.Errorf("NewSD35GenerateBatchRequest(empty prompt) error = %v, want %v", err, ErrInvalidPrompt)
+	}
+}
+
+// TestEncodeSampling verifies that the sampling block is sent only when a
+// request asks for a sampler or scheduler, ahead of the prompt data.
+func TestEncodeSampling(t *testing.T) {
+	req, err := NewSD35GenerateRequest(1, "a cat", 512, 512, 4, 1.0, 7)
+	if err != nil {
+		t.Fatalf("NewSD35GenerateRequest() error = %v", err)
+	}
+
+	data, err := EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagSampling != 0 {
+		t.Errorf("flags = 0x%08X, want FlagSampling clear for defaults", flags)
+	}
+	plain := len(data)
+
+	req.Sampler = SamplerLCM
+	req.Scheduler = SchedulerSGMUniform
+	data, err = EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if len(data) != plain+8 {
+		t.Fatalf("encoded length = %d, want %d", len(data), plain+8)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagSampling == 0 {
+		t.Errorf("flags = 0x%08X, want FlagSampling set", flags)
+	}
+	if got := binary.BigEndian.Uint32(data[8:12]); got != uint32(len(data)-16) {
+		t.Errorf("payload_len = %d, want %d", got, len(data)-16)
+	}
+	if got := binary.BigEndian.Uint32(data[76:80]); got != SamplerLCM {
+		t.Errorf("sampler = %d, want %d", got, SamplerLCM)
+	}
+	if got := binary.BigEndian.Uint32(data[80:84]); got != SchedulerSGMUniform {
+		t.Errorf("scheduler = %d, want %d", got, SchedulerSGMUniform)
+	}
+	if !bytes.Equal(data[84:], req.PromptData) {
+		t.Errorf("prompt data not after the sampling block")
+	}
+
+	batch, err := NewSD35GenerateBatchRequest(2, "a cat", 512, 512, 4, 1.0, []uint64{1, 2})
+	if err != nil {
+		t.Fatalf("NewSD35GenerateBatchRequest() error = %v", err)
+	}
+	batch.Sampler = SamplerTCD
+	data, err = EncodeSD35GenerateBatchRequest(batch)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateBatchRequest() error = %v", err)
+	}
+	if got := binary.BigEndian.Uint32(data[88:92]); got != SamplerTCD {
+		t.Errorf("batch sampler = %d, want %d", got, SamplerTCD)
+	}
+	if got := binary.BigEndian.Uint32(data[92:96]); got != SchedulerDefault {
+		t.Errorf("batch scheduler = %d, want %d", got, SchedulerDefault)
+	}
+	if !bytes.Equal(data[96:], batch.PromptData) {
+		t.Errorf("batch prompt data not after the sampling block")
+	}
+
+	req.Sampler = SamplerCount
+	if _, err := EncodeSD35GenerateRequest(req); !errors.Is(err, ErrInvalidSampler) {
+		t.Errorf("EncodeSD35GenerateRequest(sampler %d) error = %v, want %v", SamplerCount, err, ErrInvalidSampler)
+	}
+	batch.Sampler = SamplerDefault
+	batch.Scheduler = SchedulerCount
+	if _, err := EncodeSD35GenerateBatchRequest(batch); !errors.Is(err, ErrInvalidSampler) {
+		t.Errorf("EncodeSD35GenerateBatchRequest(scheduler %d) error = %v, want %v", SchedulerCount, err, ErrInvalidSampler)
+	}
+}
+
+// TestEncodeCLIPOnly verifies that an empty T5 prompt is accepted only with
+// FlagCLIPOnly.
+func TestEncodeCLIPOnly(t *testing.T) {
+	req, err := NewSD35GenerateRequest(1, "a cat", 512, 512, 4, 1.0, 7)
+	if err != nil {
+		t.Fatalf("NewSD35GenerateRequest() error = %v", err)
+	}
+	req.T5Offset = 0
+	req.T5Length = 0
+
+	if _, err := EncodeSD35GenerateRequest(req); !errors.Is(err, ErrInvalidPrompt) {
+		t.Errorf("EncodeSD35GenerateRequest(t5_length 0) error = %v, want %v", err, ErrInvalidPrompt)
+	}
+
+	req.Header.Flags |= FlagCLIPOnly
+	data, err := EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest(FlagCLIPOnly) error = %v", err)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagCLIPOnly == 0 {
+		t.Errorf("flags = 0x%08X, want FlagCLIPOnly set", flags)
+	}
+	if got := binary.BigEndian.Uint32(data[72:76]); got != 0 {
+		t.Errorf("t5_length = %d, want 0", got)
+	}
+
+	req.CLIPGLength = 0
+	if _, err := EncodeSD35GenerateRequest(req); !errors.Is(err, ErrInvalidPrompt) {
+		t.Errorf("EncodeSD35GenerateRequest(clip_g_length 0) error = %v, want %v", err, ErrInvalidPrompt)
+	}
+}
+
+// TestEncodeInitImage verifies that the init image block and its pixels are
+// sent after the sampling block, only for requests with an init image.
+func TestEncodeInitImage(t *testing.T) {
+	req, err := NewSD35GenerateRequest(1, "a cat", 64, 64, 4, 1.0, 7)
+	if err != nil {
+		t.Fatalf("NewSD35GenerateRequest() error = %v", err)
+	}
+	data, err := EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	plain := len(data)
+
+	req.InitSource = InitSourceInline
+	req.Strength = 0.5
+	req.InitImage = bytes.Repeat([]byte{0x5A}, 64*64*3)
+	data, err = EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if want := plain + InitImageBlockSize + len(req.InitImage); len(data) != want {
+		t.Fatalf("encoded length = %d, want %d", len(data), want)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagInitImage == 0 {
+		t.Errorf("flags = 0x%08X, want FlagInitImage set", flags)
+	}
+	if got := binary.BigEndian.Uint32(data[8:12]); got != uint32(len(data)-16) {
+		t.Errorf("payload_len = %d, want %d", got, len(data)-16)
+	}
+	if got := math.Float32frombits(binary.BigEndian.Uint32(data[76:80])); got != 0.5 {
+		t.Errorf("strength = %v, want 0.5", got)
+	}
+	if got := binary.BigEndian.Uint32(data[80:84]); got != InitSourceInline {
+		t.Errorf("source = %d, want %d", got, InitSourceInline)
+	}
+	if got := binary.BigEndian.Uint32(data[96:100]); got != uint32(len(req.InitImage)) {
+		t.Errorf("data_len = %d, want %d", got, len(req.InitImage))
+	}
+	if !bytes.Equal(data[100:100+len(req.InitImage)], req.InitImage) {
+		t.Errorf("pixels not after the init image block")
+	}
+	if !bytes.Equal(data[100+len(req.InitImage):], req.PromptData) {
+		t.Errorf("prompt data not after the pixels")
+	}
+
+	batch, err := NewSD35GenerateBatchRequest(2, "a cat", 64, 64, 4, 1.0, []uint64{1, 2})
+	if err != nil {
+		t.Fatalf("NewSD35GenerateBatchRequest() error = %v", err)
+	}
+	batch.Sampler = SamplerEuler
+	batch.InitSource = InitSourceRetained
+	batch.Strength = 0.25
+	batch.InitRequestID = 0x0102030405060708
+	batch.InitIndex = 3
+	data, err = EncodeSD35GenerateBatchRequest(batch)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateBatchRequest() error = %v", err)
+	}
+	// Fixed fields, two seeds and the sampling block come first
+	block := data[16+56+2*8+8:]
+	if got := binary.BigEndian.Uint32(block[4:8]); got != InitSourceRetained {
+		t.Errorf("batch source = %d, want %d", got, InitSourceRetained)
+	}
+	if got := binary.BigEndian.Uint64(block[8:16]); got != batch.InitRequestID {
+		t.Errorf("batch request_id = 0x%X, want 0x%X", got, batch.InitRequestID)
+	}
+	if got := binary.BigEndian.Uint32(block[16:20]); got != 3 {
+		t.Errorf("batch index = %d, want 3", got)
+	}
+	if !bytes.Equal(block[InitImageBlockSize:], batch.PromptData) {
+		t.Errorf("batch prompt data not after the init image block")
+	}
+
+	// A caller-set flag without an init image is not sent
+	req.InitSource = InitSourceNone
+	req.InitImage = nil
+	req.Header.Flags = FlagInitImage
+	data, err = EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagInitImage != 0 || len(data) != plain {
+		t.Errorf("flags = 0x%08X, length %d, want FlagInitImage clear and length %d", flags, len(data), plain)
+	}
+	req.Header.Flags = 0
+
+	invalid := []struct {
+		name     string
+		source   uint32
+		strength float32
+		pixels   int
+	}{
+		{"zero strength", InitSourceRetained, 0, 0},
+		{"strength above 1", InitSourceRetained, 1.5, 0},
+		{"NaN strength", InitSourceRetained, float32(math.NaN()), 0},
+		{"short pixels", InitSourceInline, 0.5, 64 * 64},
+		{"retained with pixels", InitSourceRetained, 0.5, 3},
+		{"unknown source", 3, 0.5, 0},
+	}
+	for _, tt := range invalid {
+		req.InitSource = tt.source
+		req.Strength = tt.strength
+		req.InitImage = make([]byte, tt.pixels)
+		if _, err := EncodeSD35GenerateRequest(req); !errors.Is(err, ErrInvalidInitImage) {
+			t.Errorf("%s: error = %v, want %v", tt.name, err, ErrInvalidInitImage)
+		}
+	}
+}
+
+// TestEncodeScheduling verifies that the scheduling block is sent after the
+// init image block, only for requests that are not interactive or carry a
+// deadline.
+func TestEncodeScheduling(t *testing.T) {
+	req, err := NewSD35GenerateRequest(1, "a cat", 64, 64, 4, 1.0, 7)
+	if err != nil {
+		t.Fatalf("NewSD35GenerateRequest() error = %v", err)
+	}
+	data, err := EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagScheduling != 0 {
+		t.Errorf("flags = 0x%08X, want FlagScheduling clear for defaults", flags)
+	}
+	plain := len(data)
+
+	req.Priority = PriorityBatch
+	req.DeadlineMs = 30000
+	req.InitSource = InitSourceRetained
+	req.Strength = 0.5
+	data, err = EncodeSD35GenerateRequest(req)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+	}
+	if want := plain + InitImageBlockSize + SchedulingBlockSize; len(data) != want {
+		t.Fatalf("encoded length = %d, want %d", len(data), want)
+	}
+	if flags := binary.BigEndian.Uint32(data[12:16]); flags&FlagScheduling == 0 {
+		t.Errorf("flags = 0x%08X, want FlagScheduling set", flags)
+	}
+	block := data[76+InitImageBlockSize:]
+	if got := binary.BigEndian.Uint32(block[0:4]); got != PriorityBatch {
+		t.Errorf("priority = %d, want %d", got, PriorityBatch)
+	}
+	if got := binary.BigEndian.Uint32(block[4:8]); got != 30000 {
+		t.Errorf("deadline_ms = %d, want 30000", got)
+	}
+	if !bytes.Equal(block[SchedulingBlockSize:], req.PromptData) {
+		t.Errorf("prompt data not after the scheduling block")
+	}
+
+	batch, err := NewSD35GenerateBatchRequest(2, "a cat", 64, 64, 4, 1.0, []uint64{1, 2})
+	if err != nil {
+		t.Fatalf("NewSD35GenerateBatchRequest() error = %v", err)
+	}
+	batch.Priority = PriorityDraft
+	data, err = EncodeSD35GenerateBatchRequest(batch)
+	if err != nil {
+		t.Fatalf("EncodeSD35GenerateBatchRequest() error = %v", err)
+	}
+	// Fixed fields and two seeds come first
+	block = data[16+56+2*8:]
+	if got := binary.BigEndian.Uint32(block[0:4]); got != PriorityDraft {
+		t.Errorf("batch priority = %d, want %d", got, PriorityDraft)
+	}
+	if got := binary.BigEndian.Uint32(block[4:8]); got != 0 {
+		t.Errorf("batch deadline_ms = %d, want 0", got)
+	}
+	if !bytes.Equal(block[SchedulingBlockSize:], batch.PromptData) {
+		t.Errorf("batch prompt data not after the scheduling block")
+	}
+
+	req.Priority = PriorityCount
+	if _, err := EncodeSD35GenerateRequest(req); !errors.Is(err, ErrInvalidPriority) {
+		t.Errorf("EncodeSD35GenerateRequest(priority %d) error = %v, want %v", PriorityCount, err, ErrInvalidPriority)
+	}
+}
+
+// TestEncodeRequestVersion verifies that requests encode as version 1 unless
+// they ask for version 2.
+func TestEncodeRequestVersion(t *testing.T) {
+	tests := []struct {
+		name    string
+		version uint16
+		want    uint16
+	}{
+		{"default", ProtocolVersion1, ProtocolVersion1},
+		{"version 2", ProtocolVersion2, ProtocolVersion2},
+		{"unset", 0, ProtocolVersion1},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			req, err := NewSD35GenerateRequest(1, "a cat", 512, 512, 28, 7.0, 0)
+			if err != nil {
+				t.Fatalf("NewSD35GenerateRequest() error = %v", err)
+			}
+			req.Header.Version = tt.version
+			data, err := EncodeSD35GenerateRequest(req)
+			if err != nil {
+				t.Fatalf("EncodeSD35GenerateRequest() error = %v", err)
+			}
+			if got := binary.BigEndian.Uint16(data[4:6]); got != tt.want {
+				t.Errorf("version = %d, want %d", got, tt.want)
+			}
+
+			batch, err := NewSD35GenerateBatchRequest(2, "a cat", 512, 512, 28, 7.0, []uint64{1, 2})
+			if err != nil {
+				t.Fatalf("NewSD35GenerateBatchRequest() error = %v", err)
+			}
+			batch.Header.Version = tt.version
+			data, err = EncodeSD35GenerateBatchRequest(batch)
+			if err != nil {
+				t.Fatalf("EncodeSD35GenerateBatchRequest() error = %v", err)
+			}
+			if got := binary.BigEndian.Uint16(data[4:6]); got != tt.want {
+				t.Errorf("batch version = %d, want %d", got, tt.want)
+			}
+		})
+	}
+}
+
+func TestEncodeStatsRequest(t *testing.T) {
+	data := EncodeStatsRequest(0x0102030405060708)
+
+	if len(data) != 24 {
+		t.Fatalf("len = %d, want 24", len(data))
+	}
+	if got := binary.BigEndian.Uint16(data[6:8]); got != MsgStatsRequest {
+		t.Errorf("msg_type = 0x%04x, want 0x%04x", got, MsgStatsRequest)
+	}
+	if got := binary.BigEndian.Uint32(data[8:12]); got != 8 {
+		t.Errorf("payload_len = %d, want 8", got)
+	}
+	if got := binary.BigEndian.Uint64(data[16:24]); got != 0x0102030405060708 {
+		t.Errorf("request_id = 0x%x, want 0x0102030405060708", got)
+	}
+}
+
+func TestEncodePrepareRequest(t *testing.T) {
+	data, err := EncodePrepareRequest(9, ModelIDSD35, 768, 512, FlagPNG, "cat")
+	if err != nil {
+		t.Fatalf("EncodePrepareRequest: %v", err)
+	}
+
+	if len(data) != 16+44+9 {
+		t.Fatalf("len = %d, want %d", len(data), 16+44+9)
+	}
+	if got := binary.BigEndian.Uint16(data[6:8]); got != MsgPrepare {
+		t.Errorf("msg_type = 0x%04x, want 0x%04x", got, MsgPrepare)
+	}
+	if got := binary.BigEndian.Uint32(data[8:12]); got != 44+9 {
+		t.Errorf("payload_len = %d, want %d", got, 44+9)
+	}
+	if got := binary.BigEndian.Uint32(data[12:16]); got != FlagPNG {
+		t.Errorf("flags = 0x%x, want 0x%x", got, FlagPNG)
+	}
+	if got := binary.BigEndian.Uint64(data[16:24]); got != 9 {
+		t.Errorf("request_id = %d, want 9", got)
+	}
+	if w, h := binary.BigEndian.Uint32(data[28:32]), binary.BigEndian.Uint32(data[32:36]); w != 768 || h != 512 {
+		t.Errorf("size = %dx%d, want 768x512", w, h)
+	}
+	// T5 offset and length
+	if off, n := binary.BigEndian.Uint32(data[52:56]), binary.BigEndian.Uint32(data[56:60]); off != 6 || n != 3 {
+		t.Errorf("t5 = (%d, %d), want (6, 3)", off, n)
+	}
+	if got := string(data[60:]); got != "catcatcat" {
+		t.Errorf("prompt data = %q, want %q", got, "catcatcat")
+	}
+
+	// The prompt may not be known yet
+	if data, err = EncodePrepareRequest(0, ModelIDSD35, 64, 64, 0, ""); err != nil || len(data) != 60 {
+		t.Errorf("empty prompt: len = %d, err = %v", len(data), err)
+	}
+
+	tests := []struct {
+		name          string
+		modelID, w, h uint32
+		prompt        string
+		want          error
+	}{
+		{"model", ModelIDSD35Max + 1, 64, 64, "cat", ErrInvalidModelID},
+		{"width", ModelIDSD35, 100, 64, "cat", ErrInvalidDimensions},
+		{"height", ModelIDSD35, 64, SD35MaxHeight + SD35DimensionAlign, "cat", ErrInvalidDimensions},
+		{"prompt", ModelIDSD35, 64, 64, strings.Repeat("a", int(SD35MaxPromptLen)+1), ErrInvalidPrompt},
+	}
+	for _, tt := range tests {
+		if _, err := EncodePrepareRequest(1, tt.modelID, tt.w, tt.h, 0, tt.prompt); !errors.Is(err, tt.want) {
+			t.Errorf("%s: err = %v, want %v", tt.name, err, tt.want)
+		}
+	}
+}
@@ -8,16 +8,178 @@ import "errors"
 const (
 	ProtocolVersion1    uint16 = 0x0001
 	MinSupportedVersion uint16 = ProtocolVersion1
-	MaxSupportedVersion uint16 = ProtocolVersion1
+	MaxSupportedVersion uint16 = ProtocolVersion2
 	MagicNumber         uint32 = 0x57455645       // "WEVE"
 	MaxMessageSize      uint32 = 10 * 1024 * 1024 // 10 MB
+
+	// ProtocolVersion2 keeps the version 1 layouts, but image responses to a
+	// version 2 request stream their pixels in MSG_CHUNK frames (or shared
+	// memory) after a response head, so they are not bound by MaxMessageSize.
+	// The client package reassembles them into one message whose header
+	// still says version 2.
+	ProtocolVersion2 uint16 = 0x0002
+
+	// MaxChunkSize is the largest data length of one MSG_CHUNK frame (1 MB)
+	MaxChunkSize uint32 = 1024 * 1024
+
+	// MaxStreamedMessageSize bounds a reassembled version 2 response: a
+	// full batch of maximum-size RGBA images plus the response fields.
+	MaxStreamedMessageSize uint32 = 129 * 1024 * 1024 // 129 MB
 )
 
 // Message type constants
 const (
-	MsgGenerateRequest  uint16 = 0x0001
-	MsgGenerateResponse uint16 = 0x0002
-	MsgError            uint16 = 0x00FF
+	MsgGenerateRequest       uint16 = 0x0001
+	MsgGenerateResponse      uint16 = 0x0002
+	MsgGenerateBatchRequest  uint16 = 0x0003
+	MsgGenerateBatchResponse uint16 = 0x0004
+	MsgGenerateProgress      uint16 = 0x0005
+	MsgCancel                uint16 = 0x0006
+	MsgChunk                 uint16 = 0x0007
+	MsgGenerateTimings       uint16 = 0x0008
+	MsgStatsRequest          uint16 = 0x0009
+	MsgStatsResponse         uint16 = 0x000A
+	MsgPrepare               uint16 = 0x000B
+	MsgError                 uint16 = 0x00FF
+)
+
+// Header flag bits
+const (
+	// FlagProgress asks weave-compute to stream MSG_GENERATE_PROGRESS frames
+	// before the final response. Only meaningful on requests.
+	FlagProgress uint32 = 0x00000001
+
+	// FlagSHM asks weave-compute to deliver image data in a memfd passed over
+	// the Unix socket instead of inline. The client package reassembles such
+	// responses, so decoders never see the flag.
+	FlagSHM uint32 = 0x00000002
+
+	// FlagChunked marks a version 2 response head whose image data follows
+	// in MSG_CHUNK frames. Only set by weave-compute; the client package
+	// reassembles such responses, so decoders never see the flag.
+	FlagChunked uint32 = 0x00000004
+
+	// FlagPNG asks weave-compute to return a single response's image as a
+	// PNG file instead of raw pixels. On a response it marks ImageData as
+	// PNG; the decoder reports it as ImageFormatPNG.
+	FlagPNG uint32 = 0x00000008
+
+	// FlagTimings asks weave-compute to follow the final response (or error
+	// response) with one MSG_GENERATE_TIMINGS frame. Only meaningful on
+	// requests.
+	FlagTimings uint32 = 0x00000010
+
+	// FlagSampling marks a generation request that carries a sampler and a
+	// scheduler after its fixed fields (after the seeds in a batch request).
+	// The encoder sets it whenever either is not the default.
+	FlagSampling uint32 = 0x00000020
+
+	// FlagInitImage marks a generation request that refines an init image
+	// instead of starting from noise. The init image block follows the
+	// sampling block. The encoder sets it whenever InitSource is not
+	// InitSourceNone.
+	FlagInitImage uint32 = 0x00000040
+
+	// FlagCLIPOnly asks for conditioning on CLIP-L/G without T5-XXL, which
+	// saves compute host RAM and encode time on short prompts. T5Length may
+	// be 0. weave-compute hands the request to the model's CLIP-only
+	// counterpart if one is configured, serves it as is from a model loaded
+	// without T5-XXL, and otherwise refuses it with ErrCodeNoCLIPOnly.
+	FlagCLIPOnly uint32 = 0x00000080
+
+	// FlagScheduling marks a generation request that carries a priority
+	// class and its own deadline. The scheduling block follows the init
+	// image block. The encoder sets it whenever either is not the default.
+	FlagScheduling uint32 = 0x00000100
+)
+
+// Priority classes for SD35GenerateRequest.Priority. weave-compute generates
+// queued requests of a more urgent class first.
+const (
+	PriorityInteractive uint32 = 0 // A user is waiting on the result
+	PriorityDraft       uint32 = 1 // Previews and cheap drafts
+	PriorityBatch       uint32 = 2 // Background work
+	PriorityCount       uint32 = 3 // Number of classes, not a class
+)
+
+// SchedulingBlockSize is the size of the scheduling block:
+// priority=4 + deadline_ms=4.
+const SchedulingBlockSize = 8
+
+// Init image sources for SD35GenerateRequest.InitSource.
+const (
+	InitSourceNone     uint32 = 0 // Text-to-image
+	InitSourceInline   uint32 = 1 // InitImage carries the pixels
+	InitSourceRetained uint32 = 2 // An image weave-compute returned earlier, by request_id and index
+)
+
+// InitImageBlockSize is the size of the init image block before its pixels:
+// strength=4 + source=4 + request_id=8 + index=4 + data_len=4.
+const InitImageBlockSize = 24
+
+// Samplers for SD35GenerateRequest.Sampler. SamplerDefault leaves the choice
+// to the model; few-step distillations need their own (SamplerLCM,
+// SamplerTCD) to give usable images at 4-8 steps.
+const (
+	SamplerDefault      uint32 = 0
+	SamplerEuler        uint32 = 1
+	SamplerEulerA       uint32 = 2
+	SamplerHeun         uint32 = 3
+	SamplerDPM2         uint32 = 4
+	SamplerDPMPP2SA     uint32 = 5
+	SamplerDPMPP2M      uint32 = 6
+	SamplerDPMPP2MV2    uint32 = 7
+	SamplerIPNDM        uint32 = 8
+	SamplerIPNDMV       uint32 = 9
+	SamplerLCM          uint32 = 10
+	SamplerDDIMTrailing uint32 = 11
+	SamplerTCD          uint32 = 12
+	SamplerCount        uint32 = 13 // Number of samplers, not a sampler
+)
+
+// Schedulers for SD35GenerateRequest.Scheduler. SchedulerDefault leaves the
+// choice to the model and sampler.
+const (
+	SchedulerDefault     uint32 = 0
+	SchedulerDiscrete    uint32 = 1
+	SchedulerKarras      uint32 = 2
+	SchedulerExponential uint32 = 3
+	SchedulerAYS         uint32 = 4
+	SchedulerGITS        uint32 = 5
+	SchedulerSGMUniform  uint32 = 6
+	SchedulerSimple      uint32 = 7
+	SchedulerSmoothstep  uint32 = 8
+	SchedulerCount       uint32 = 9 // Number of schedulers, not a scheduler
+)
+
+// Timing stages, in the order GenerateTimings.StagesUs and
+// StatsResponse.Histograms report them
+const (
+	TimingStageQueue      = 0 // Received until a GPU thread picked it up
+	TimingStageReset      = 1 // Context reset before generating
+	TimingStageTextEncode = 2 // Prompt encoding (CLIP-L, CLIP-G, T5)
+	TimingStageSampling   = 3 // Diffusion sampling
+	TimingStageVAEDecode  = 4 // Latent decode
+	TimingStageEncode     = 5 // PNG encoding of the response
+	TimingStageWrite      = 6 // Writing the response
+	TimingStageTotal      = 7 // Received until the response was written
+	TimingStageCount      = 8
+)
+
+// Stats response bounds
+const (
+	StatsMaxErrorCodes      = 24 // Most error codes one response lists
+	StatsMaxHistogramBucket = 14 // Most histogram buckets one response carries
+)
+
+// ImageFormat is the encoding of a response's image data
+type ImageFormat int
+
+const (
+	// ImageFormatRaw is width * height * channels pixel bytes
+	ImageFormatRaw ImageFormat = iota
+	// ImageFormatPNG is a PNG file of the response's dimensions
+	ImageFormatPNG
 )
 
 // Status codes (HTTP-like)
@@ -40,12 +202,24 @@ const (
 	ErrCodeOutOfMemory        uint32 = 8
 	ErrCodeGPUError           uint32 = 9
 	ErrCodeTimeout            uint32 = 10
+	ErrCodeInvalidSeedCount   uint32 = 11
+	ErrCodeCancelled          uint32 = 12
+	ErrCodeInvalidSampler     uint32 = 13
+	ErrCodeInvalidInitImage   uint32 = 14
+	ErrCodeBusy               uint32 = 15 // Estimated wait exceeds the request's deadline
+	ErrCodeInvalidPriority    uint32 = 16
+	ErrCodeNoCLIPOnly         uint32 = 17 // FlagCLIPOnly for a model with T5-XXL and no CLIP-only model
 	ErrCodeInternal           uint32 = 99
 )
 
 // Model identifiers
 const (
-	ModelIDSD35 uint32 = 0x00000000 // Stable Diffusion 3.5
+	ModelIDSD35 uint32 = 0x00000000 // Stable Diffusion 3.5 (default SD 3.5 model)
+
+	// ModelIDSD35Max is the highest SD 3.5 family model ID. IDs up to it share
+	// the SD 3.5 payload; which ones exist depends on the compute process's
+	// model registry.
+	ModelIDSD35Max uint32 = 0x000000FF
 )
 
 // Sentinel errors
@@ -60,6 +234,11 @@ var (
 	ErrOutOfMemory        = errors.New("out of memory")
 	ErrGPUError           = errors.New("GPU error")
 	ErrTimeout            = errors.New("timeout")
+	ErrInvalidSeedCount   = errors.New("invalid seed count")
+	ErrInvalidSampler     = errors.New("invalid sampler or scheduler")
+	ErrInvalidInitImage   = errors.New("invalid init image")
+	ErrBusy               = errors.New("server busy")
+	ErrInvalidPriority    = errors.New("invalid priority")
 	ErrInternal           = errors.New("internal error")
 	ErrBufferTooSmall     = errors.New("buffer too small")
 	ErrMessageTooLarge    = errors.New("message too large")
@@ -71,7 +250,7 @@ type Header struct {
 	Version    uint16 // Protocol version
 	MsgType    uint16 // Message type (request/response/error)
 	PayloadLen uint32 // Length of data following header
-	Reserved   uint32 // Must be 0x00000000
+	Flags      uint32 // Header flags (Flag* constants)
 }
 
 // GenerateRequest represents the common fields in all generation requests.
@@ -112,6 +291,21 @@ type SD35GenerateRequest struct {
 	CFGScale float32 // Classifier-Free Guidance scale (0.0-20.0)
 	Seed     uint64  // Random seed (0 = random)
 
+	// Sampling (Sampler*/Scheduler* constants, 0 = model default)
+	Sampler   uint32
+	Scheduler uint32
+
+	// Init image (InitSource* constants, InitSourceNone for text-to-image)
+	InitSource    uint32
+	Strength      float32 // How far to move from the init image (0.0-1.0]
+	InitRequestID uint64  // InitSourceRetained: request_id the image was returned with
+	InitIndex     uint32  // InitSourceRetained: image index in that response
+	InitImage     []byte  // InitSourceInline: RGB pixels, Width * Height * 3
+
+	// Scheduling (Priority* constants; DeadlineMs 0 = the server's timeout)
+	Priority   uint32
+	DeadlineMs uint32 // Answer ErrCodeBusy at once if it cannot finish within this
+
 	// Prompt offset table
 	CLIPLOffset uint32 // Offset of CLIP-L prompt in PromptData
 	CLIPLLength uint32 // Length of CLIP-L prompt
@@ -134,8 +328,130 @@ type SD35GenerateResponse struct {
 	Channels     uint32 // Number of channels (3=RGB, 4=RGBA)
 	ImageDataLen uint32 // Size of image data in bytes
 
-	// Image data (raw RGB/RGBA pixels)
+	// Image data (raw RGB/RGBA pixels, or a PNG file if Format is ImageFormatPNG)
 	ImageData []byte
+	Format    ImageFormat
+}
+
+// SD35GenerateBatchRequest represents an SD 3.5 request rendering one prompt
+// with several seeds. The compute process encodes the prompt once and keeps
+// the model loaded across the whole batch.
+type SD35GenerateBatchRequest struct {
+	GenerateRequest
+
+	// Generation parameters (shared by every image)
+	Width    uint32  // Image width (64-2048, multiple of 64)
+	Height   uint32  // Image height (64-2048, multiple of 64)
+	Steps    uint32  // Inference steps (1-100)
+	CFGScale float32 // Classifier-Free Guidance scale (0.0-20.0)
+
+	// Sampling (Sampler*/Scheduler* constants, 0 = model default)
+	Sampler   uint32
+	Scheduler uint32
+
+	// Init image (InitSource* constants, InitSourceNone for text-to-image)
+	InitSource    uint32
+	Strength      float32 // How far to move from the init image (0.0-1.0]
+	InitRequestID uint64  // InitSourceRetained: request_id the image was returned with
+	InitIndex     uint32  // InitSourceRetained: image index in that response
+	InitImage     []byte  // InitSourceInline: RGB pixels, Width * Height * 3
+
+	// Scheduling (Priority* constants; DeadlineMs 0 = the server's timeout)
+	Priority   uint32
+	DeadlineMs uint32 // Answer ErrCodeBusy at once if it cannot finish within this
+
+	// Prompt offset table
+	CLIPLOffset uint32 // Offset of CLIP-L prompt in PromptData
+	CLIPLLength uint32 // Length of CLIP-L prompt
+	CLIPGOffset uint32 // Offset of CLIP-G prompt in PromptData
+	CLIPGLength uint32 // Length of CLIP-G prompt
+	T5Offset    uint32 // Offset of T5 prompt in PromptData
+	T5Length    uint32 // Length of T5 prompt
+
+	// Seeds, one per output image (1-8 entries, 0 = random)
+	Seeds []uint64
+
+	// Prompt data (contains all three prompts)
+	PromptData []byte
+}
+
+// SD35GenerateBatchResponse represents a successful SD 3.5 batch response.
+// Images are returned in the same order as the request seeds.
+type SD35GenerateBatchResponse struct {
+	GenerateResponse
+
+	// Image metadata (same for every image)
+	ImageWidth   uint32 // Actual image width
+	ImageHeight  uint32 // Actual image height
+	Channels     uint32 // Number of channels (3=RGB, 4=RGBA)
+	ImageCount   uint32 // Number of images
+	ImageDataLen uint32 // Size of each image in bytes
+
+	// Image data (raw RGB/RGBA pixels per image)
+	Images [][]byte
+}
+
+// GenerateProgress is a mid-generation update streamed ahead of the final
+// response when the request header sets FlagProgress. Preview is an optional
+// low-resolution projection of the current latents (nil if not sent).
+type GenerateProgress struct {
+	Header          Header
+	RequestID       uint64 // Echoed from request
+	Step            uint32 // Sampling step just completed (1-based)
+	TotalSteps      uint32 // Total sampling steps
+	ElapsedMs       uint32 // Milliseconds since the request was received
+	PreviewWidth    uint32 // Preview width (0 if no preview)
+	PreviewHeight   uint32 // Preview height (0 if no preview)
+	PreviewChannels uint32 // Preview channels (3=RGB, 4=RGBA, 0 if no preview)
+	PreviewDataLen  uint32 // Size of preview data in bytes
+
+	// Preview data (raw RGB/RGBA pixels)
+	Preview []byte
+}
+
+// GenerateTimings is the trailer weave-compute sends after the response to
+// a request that set FlagTimings. Durations come from a monotonic clock.
+type GenerateTimings struct {
+	Header    Header
+	RequestID uint64                   // Echoed from request
+	StagesUs  [TimingStageCount]uint64 // Microseconds per TimingStage* stage
+	StepsUs   []uint32                 // Microseconds of each sampling step
+}
+
+// StatsHistogram is the latency distribution of one timing stage over
+// successful requests. Buckets[i] counts durations up to
+// StatsResponse.BucketBoundsUs[i] (and above the previous bound).
+type StatsHistogram struct {
+	Stage   uint32   // TimingStage* constant
+	Count   uint64   // Durations recorded
+	SumUs   uint64   // Sum of the durations in microseconds
+	Buckets []uint64 // Per-bucket counts (not cumulative)
+}
+
+// StatsClassQueue is the generate queue of one priority class.
+type StatsClassQueue struct {
+	Depth  uint32 // Requests of the class waiting for a GPU
+	WaitMs uint32 // Estimated wait of a new request of the class (0 = unknown)
+}
+
+// StatsResponse is weave-compute's answer to a MSG_STATS_REQUEST.
+type StatsResponse struct {
+	Header         Header
+	RequestID      uint64            // Echoed from request
+	Status         uint32            // Status code (StatusOK)
+	UptimeMs       uint64            // Milliseconds since weave-compute started
+	Requests       uint64            // Generation requests read
+	Completed      uint64            // Requests answered successfully
+	QueueDepth     uint32            // Requests waiting for a GPU thread
+	InFlight       uint32            // Requests generating
+	VRAMBytes      uint64            // VRAM held by loaded models, all devices
+	PoolHits       uint64            // Buffers served from the buffer pool
+	PoolMisses     uint64            // Buffers the buffer pool had to allocate
+	PoolIdleBytes  uint64            // Bytes the buffer pool holds for reuse
+	ClassQueue     []StatsClassQueue // Generate queue per Priority* class, by class
+	Errors         map[uint32]uint64 // Error responses by ErrCode* (non-zero only)
+	BucketBoundsUs []uint64          // Histogram bucket upper bounds (last is unbounded)
+	Histograms     []StatsHistogram  // One per timing stage
 }
 
 // SD35 parameter bounds
@@ -154,4 +470,7 @@ const (
 	SD35MaxPromptData  uint32  = 768 // 3 * 256
 	SD35ChannelsRGB    uint32  = 3
 	SD35ChannelsRGBA   uint32  = 4
+	SD35MinBatchSize   uint32  = 1
+	SD35MaxBatchSize   uint32  = 8
+	SD35MaxPreviewDim  uint32  = 256 // Largest progress preview side
 )
@@ -30,7 +30,7 @@ func TestHeaderFieldOffsets(t *testing.T) {
 		{"Version", unsafe.Offsetof(h.Version), 4},
 		{"MsgType", unsafe.Offsetof(h.MsgType), 6},
 		{"PayloadLen", unsafe.Offsetof(h.PayloadLen), 8},
-		{"Reserved", unsafe.Offsetof(h.Reserved), 12},
+		{"Flags", unsafe.Offsetof(h.Flags), 12},
 	}
 
 	for _, tt := range tests {
@@ -52,8 +52,10 @@ func TestProtocolConstants(t *testing.T) {
 		{"MagicNumber", MagicNumber, uint32(0x57455645)},
 		{"ProtocolVersion1", ProtocolVersion1, uint16(0x0001)},
 		{"MinSupportedVersion", MinSupportedVersion, uint16(0x0001)},
-		{"MaxSupportedVersion", MaxSupportedVersion, uint16(0x0001)},
+		{"ProtocolVersion2", ProtocolVersion2, uint16(0x0002)},
+		{"MaxSupportedVersion", MaxSupportedVersion, uint16(0x0002)},
 		{"MaxMessageSize", MaxMessageSize, uint32(10 * 1024 * 1024)},
+		{"MaxChunkSize", MaxChunkSize, uint32(1024 * 1024)},
 	}
 
 	for _, tt := range tests {
@@ -74,6 +76,7 @@ func TestMessageTypes(t *testing.T) {
 	}{
 		{"MsgGenerateRequest", MsgGenerateRequest, 0x0001},
 		{"MsgGenerateResponse", MsgGenerateResponse, 0x0002},
+		{"MsgChunk", MsgChunk, 0x0007},
 		{"MsgError", MsgError, 0x00FF},
 	}
 
@@ -142,6 +145,9 @@ func TestModelIDs(t *testing.T) {
 	if ModelIDSD35 != 0x00000000 {
 		t.Errorf("ModelIDSD35 = 0x%08X, want 0x00000000", ModelIDSD35)
 	}
+	if ModelIDSD35Max != 0x000000FF {
+		t.Errorf("ModelIDSD35Max = 0x%08X, want 0x000000FF", ModelIDSD35Max)
+	}
 }
 
 // TestSentinelErrors verifies sentinel errors are defined.
@@ -209,7 +215,7 @@ func TestSD35GenerateRequestFields(t *testing.T) {
 				Version:    ProtocolVersion1,
 				MsgType:    MsgGenerateRequest,
 				PayloadLen: 102,
-				Reserved:   0,
+				Flags:      0,
 			},
 			RequestID: 1,
 			ModelID:   ModelIDSD35,
@@ -374,7 +380,7 @@ func TestSD35GenerateResponseStructure(t *testing.T) {
 				Version:    ProtocolVersion1,
 				MsgType:    MsgGenerateResponse,
 				PayloadLen: 786464,
-				Reserved:   0,
+				Flags:      0,
 			},
 			RequestID:      1,
 			Status:         StatusOK,
@@ -416,7 +422,7 @@ func TestErrorResponseStructure(t *testing.T) {
 			Version:    ProtocolVersion1,
 			MsgType:    MsgError,
 			PayloadLen: 34,
-			Reserved:   0,
+			Flags:      0,
 		},
 		RequestID:    1,
 		Status:       StatusBadRequest,
@@ -9,6 +9,9 @@ import (
 	"os"
 	"os/exec"
 	"path/filepath"
+	"strconv"
+	"strings"
+	"syscall"
 	"time"
 
 	"github.com/hurricanerix/weave/internal/client"
@@ -217,13 +220,77 @@ func CreateImageStore(logger *logging.Logger) *persistence.ImageStore {
 	return store
 }
 
-// CreateImageStorage creates image storage and starts cleanup goroutine
+// CreateImageStorage creates image storage and starts cleanup goroutine.
+// Images past the in-memory budget are served from a per-process spill
+// directory under the user cache directory, removed when ctx is cancelled.
+// Without a usable cache directory storage stays memory-only.
 func CreateImageStorage(ctx context.Context, logger *logging.Logger) *image.Storage {
-	storage := image.NewStorage()
+	storage, err := createTieredImageStorage(logger)
+	if err != nil {
+		logger.Warn("Image spill directory unavailable, keeping images in memory only: %v", err)
+		storage = image.NewStorage()
+	}
 	storage.StartCleanup(ctx, logger)
 	return storage
 }
 
+// imageDirPrefix names the per-process spill directories under
+// $XDG_CACHE_HOME/weave; the owning process ID follows it.
+const imageDirPrefix = "images-"
+
+// createTieredImageStorage creates image storage spilling to a directory of
+// its own under $XDG_CACHE_HOME/weave (not /tmp, which is often RAM-backed).
+// Storage.Close removes it on shutdown; directories a crashed run left
+// behind are removed here.
+func createTieredImageStorage(logger *logging.Logger) (*image.Storage, error) {
+	cacheDir, err := os.UserCacheDir()
+	if err != nil {
+		return nil, err
+	}
+	parent := filepath.Join(cacheDir, "weave")
+	if err := os.MkdirAll(parent, 0700); err != nil {
+		return nil, err
+	}
+	removeStaleImageDirs(parent, logger)
+
+	dir := filepath.Join(parent, fmt.Sprintf("%s%d", imageDirPrefix, os.Getpid()))
+	if err := os.RemoveAll(dir); err != nil {
+		return nil, err
+	}
+	if err := os.Mkdir(dir, 0700); err != nil {
+		return nil, err
+	}
+	return image.NewTieredStorage(dir, image.MaxHotBytes)
+}
+
+// removeStaleImageDirs removes spill directories whose process is gone.
+// Directories of running weave processes are left alone, so concurrent
+// instances do not delete each other's images.
+func removeStaleImageDirs(parent string, logger *logging.Logger) {
+	matches, err := filepath.Glob(filepath.Join(parent, imageDirPrefix+"*"))
+	if err != nil {
+		return
+	}
+	for _, dir := range matches {
+		pid, err := strconv.Atoi(strings.TrimPrefix(filepath.Base(dir), imageDirPrefix))
+		if err == nil && pid != os.Getpid() && processAlive(pid) {
+			continue
+		}
+		if err := os.RemoveAll(dir); err != nil {
+			logger.Warn("Failed to remove stale image directory %s: %v", dir, err)
+		}
+	}
+}
+
+// processAlive reports whether a process with the given ID exists.
+func processAlive(pid int) bool {
+	if pid <= 0 {
+		return false
+	}
+	err := syscall.Kill(pid, 0)
+	return err == nil || errors.Is(err, syscall.EPERM)
+}
+
 // CreateWebServer creates the HTTP server with all dependencies wired
 func CreateWebServer(cfg *config.Config, ollamaClient *ollama.Client, sessionManager *conversation.SessionManager, imageStorage *image.Storage, imageStore *persistence.ImageStore, computeClient *client.Conn, logger *logging.Logger) (*web.Server, error) {
 	addr := fmt.Sprintf("localhost:%d", cfg.Port)
@@ -3,6 +3,7 @@ package web
 import (
 	"context"
 	"embed"
+	"encoding/base64"
 	"encoding/json"
 	"errors"
 	"fmt"
@@ -89,6 +90,9 @@ type Server struct {
 	defaultWidth  int
 	defaultHeight int
 
+	// Ask compute for CLIP-only conditioning (protocol.FlagCLIPOnly)
+	clipOnly bool
+
 	// Agent prompt loaded from file
 	agentPrompt string
 
@@ -150,6 +154,7 @@ func NewServerWithDeps(addr string, ollamaClient ollamaClient, sessionManager *c
 	defaultSeed := int64(0)
 	defaultWidth := 1024
 	defaultHeight := 1024
+	clipOnly := false
 	var agentPromptPath string
 	if cfg != nil {
 		defaultSteps = cfg.Steps
@@ -157,6 +162,7 @@ func NewServerWithDeps(addr string, ollamaClient ollamaClient, sessionManager *c
 		defaultSeed = cfg.Seed
 		defaultWidth = cfg.Width
 		defaultHeight = cfg.Height
+		clipOnly = cfg.CLIPOnly
 		agentPromptPath = cfg.AgentPromptPath
 	}
 
@@ -192,6 +198,7 @@ func NewServerWithDeps(addr string, ollamaClient ollamaClient, sessionManager *c
 		defaultSeed:    defaultSeed,
 		defaultWidth:   defaultWidth,
 		defaultHeight:  defaultHeight,
+		clipOnly:       clipOnly,
 		agentPrompt:    agentPrompt,
 	}
 
@@ -236,6 +243,7 @@ func (s *Server) registerRoutes(mux *http.ServeMux) {
 
 	// Image serving endpoints
 	mux.HandleFunc("GET /images/{id}", s.handleImage)
+	mux.HandleFunc("GET /images/{id}/thumbnail.png", s.handleImageThumbnail)
 	mux.HandleFunc("GET /sessions/{sessionID}/images/{filename}", s.handleSessionImage)
 
 	// Message state endpoint for loading historical snapshots
@@ -423,7 +431,11 @@ func (s *Server) handleChat(w http.ResponseWriter, r *http.Request) {
 
 	// Stream response from ollama with automatic retry on format errors
 	tokenCount := 0
-	result, err := s.chatWithRetry(r.Context(), sessionID, ollamaMessages, nil, tools, func(token ollama.StreamToken) error {
+	// Let compute get ready while the rest of the response streams
+	chatCtx := ollama.WithImagePromptHook(r.Context(), func(prompt string) {
+		s.prepareImage(sessionID, prompt)
+	})
+	result, err := s.chatWithRetry(chatCtx, sessionID, ollamaMessages, nil, tools, func(token ollama.StreamToken) error {
 		// Send each token via SSE
 		if token.Content != "" {
 			tokenCount++
@@ -985,6 +997,143 @@ func (s *Server) handleNewChat(w http.ResponseWriter, r *http.Request) {
 	fmt.Fprintf(w, `{"status":"ok","session_id":"%s"}`, sessionID)
 }
 
+// progressQueueSize bounds the progress frames waiting to be sent to the
+// browser. Frames arriving while the queue is full are dropped.
+const progressQueueSize = 4
+
+// forwardProgress returns a client.ProgressFunc that relays compute progress
+// frames to the session as EventGenerationProgress, and a stop function that
+// must be called once the final response has arrived. Frames are decoded and
+// sent on a separate goroutine so a slow SSE client never stalls the
+// connection's response reader.
+func (s *Server) forwardProgress(sessionID string, messageID int) (client.ProgressFunc, func()) {
+	frames := make(chan []byte, progressQueueSize)
+	done := make(chan struct{})
+
+	go func() {
+		defer close(done)
+		for frame := range frames {
+			data, err := progressEventData(frame, messageID)
+			if err != nil {
+				log.Printf("Dropping progress frame for session %s: %v", sessionID, err)
+				continue
+			}
+			_ = s.broker.SendEvent(sessionID, EventGenerationProgress, data)
+		}
+	}()
+
+	onProgress := func(frame []byte) {
+		select {
+		case frames <- frame:
+		default:
+			// Browser is behind; the next frame supersedes this one
+		}
+	}
+	stop := func() {
+		close(frames)
+		<-done
+	}
+	return onProgress, stop
+}
+
+// progressEventData decodes a MSG_GENERATE_PROGRESS frame into the SSE event
+// payload, encoding any preview as a PNG data URL.
+func progressEventData(frame []byte, messageID int) (GenerationProgressData, error) {
+	decoded, err := protocol.DecodeResponse(frame)
+	if err != nil {
+		return GenerationProgressData{}, err
+	}
+	progress, ok := decoded.(*protocol.GenerateProgress)
+	if !ok {
+		return GenerationProgressData{}, fmt.Errorf("unexpected message type %T", decoded)
+	}
+
+	data := GenerationProgressData{
+		Step:       int(progress.Step),
+		TotalSteps: int(progress.TotalSteps),
+		ElapsedMs:  int(progress.ElapsedMs),
+		MessageID:  messageID,
+	}
+	if progress.Preview == nil {
+		return data, nil
+	}
+
+	format := image.FormatRGB
+	if progress.PreviewChannels == protocol.SD35ChannelsRGBA {
+		format = image.FormatRGBA
+	}
+	pngData, err := image.EncodePNG(int(progress.PreviewWidth), int(progress.PreviewHeight), progress.Preview, format)
+	if err != nil {
+		return GenerationProgressData{}, fmt.Errorf("failed to encode preview: %w", err)
+	}
+	data.Preview = "data:image/png;base64," + base64.StdEncoding.EncodeToString(pngData)
+	return data, nil
+}
+
+// Generation request shape shared by generateImage and prepareImage.
+const (
+	// 768x768 balances quality and VRAM usage; 1024x1024 causes OOM during VAE decode
+	generateWidth  = 768
+	generateHeight = 768
+
+	// A request compute refuses as busy is retried once as a draft this
+	// size, with half the steps, rather than failing outright
+	draftWidth  = 512
+	draftHeight = 512
+
+	generateFlags = protocol.FlagProgress | protocol.FlagSHM | protocol.FlagPNG
+)
+
+// requestFlags returns the header flags for generateImage and prepareImage.
+func (s *Server) requestFlags() uint32 {
+	if s.clipOnly {
+		return generateFlags | protocol.FlagCLIPOnly
+	}
+	return generateFlags
+}
+
+// downgradeRequest turns a request compute refused with ErrCodeBusy into a
+// cheaper draft that is more likely to fit within its deadline.
+func downgradeRequest(req *protocol.SD35GenerateRequest) {
+	req.Priority = protocol.PriorityDraft
+	req.Width, req.Height = draftWidth, draftHeight
+	req.Steps = max(req.Steps/2, protocol.SD35MinSteps)
+}
+
+// truncatePrompt cuts a prompt to the protocol's maximum length at a UTF-8
+// character boundary. This works around the CLIP/T5 token mismatch bug in
+// stable-diffusion.cpp, where T5 producing more tokens than CLIP causes GGML
+// assertion failures. See docs/bugs/003-long-prompt-crash.md for details.
+func truncatePrompt(prompt string) string {
+	maxLen := int(protocol.SD35MaxPromptLen)
+	if len(prompt) <= maxLen {
+		return prompt
+	}
+	for maxLen > 0 && !utf8.RuneStart(prompt[maxLen]) {
+		maxLen--
+	}
+	return prompt[:maxLen]
+}
+
+// prepareImage tells compute about a generation that is likely to follow,
+// so it can load the model and reset its context while the LLM finishes its
+// response. Best effort: compute does not reply, and failures are only
+// logged because generateImage reports any real problem.
+func (s *Server) prepareImage(sessionID string, prompt string) {
+	if s.computeClient == nil {
+		return
+	}
+
+	message, err := protocol.EncodePrepareRequest(0, protocol.ModelIDSD35, generateWidth, generateHeight, s.requestFlags(), truncatePrompt(prompt))
+	if err != nil {
+		log.Printf("Failed to encode prepare request for session %s: %v", sessionID, err)
+		return
+	}
+	if err := s.computeClient.Notify(message); err != nil {
+		log.Printf("Failed to send prepare request for session %s: %v", sessionID, err)
+	}
+}
+
 // generateImage performs image generation using the compute process.
 // It handles the entire generation flow: protocol request creation, compute communication,
 // response handling, and SSE event sending. This method is called from both handleGenerate
@@ -1002,23 +1151,10 @@ func (s *Server) handleNewChat(w http.ResponseWriter, r *http.Request) {
 // Returns:
 //   - error: Connection or generation error (for HTTP status code handling in handleGenerate)
 func (s *Server) generateImage(ctx context.Context, sessionID string, prompt string, steps int, cfg float64, seed int64, messageID int) error {
-	// Truncate prompt if it exceeds maximum length
-	// This works around the CLIP/T5 token mismatch bug in stable-diffusion.cpp
-	// where T5 producing more tokens than CLIP causes GGML assertion failures.
-	// See docs/bugs/003-long-prompt-crash.md for details.
-	promptBytes := []byte(prompt)
-	if len(promptBytes) > int(protocol.SD35MaxPromptLen) {
-		originalLen := len(promptBytes)
-
-		// Truncate at UTF-8 character boundary to avoid corrupting multi-byte characters
-		maxLen := int(protocol.SD35MaxPromptLen)
-		for maxLen > 0 && !utf8.RuneStart(promptBytes[maxLen]) {
-			maxLen--
-		}
-
-		prompt = string(promptBytes[:maxLen])
+	if truncated := truncatePrompt(prompt); len(truncated) != len(prompt) {
 		log.Printf("Truncated prompt from %d to %d bytes for session %s",
-			originalLen, len(prompt), sessionID)
+			len(prompt), len(truncated), sessionID)
+		prompt = truncated
 	}
 
 	log.Printf("Generation settings for session %s: steps=%d, cfg=%.2f, seed=%d",
@@ -1028,8 +1164,7 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 	reqID := atomic.AddUint64(&s.requestID, 1)
 
 	// Create protocol request
-	// 768x768 balances quality and VRAM usage; 1024x1024 causes OOM during VAE decode
-	width, height := uint32(768), uint32(768)
+	width, height := uint32(generateWidth), uint32(generateHeight)
 	cfgScale := float32(cfg)
 
 	// Convert seed to uint64 for protocol
@@ -1045,14 +1180,10 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 		s.sendErrorEvent(sessionID, "Failed to create generation request: invalid prompt")
 		return fmt.Errorf("failed to create protocol request: %w", err)
 	}
-
-	// Encode request
-	requestData, err := protocol.EncodeSD35GenerateRequest(protoReq)
-	if err != nil {
-		log.Printf("Failed to encode protocol request for session %s: %v", sessionID, err)
-		s.sendErrorEvent(sessionID, "Failed to encode generation request")
-		return fmt.Errorf("failed to encode request: %w", err)
-	}
+	// Compute PNG-encodes the image on its own writer thread, off this goroutine
+	protoReq.Header.Flags |= s.requestFlags()
+	// Version 2 lets compute stream images larger than MaxMessageSize
+	protoReq.Header.Version = protocol.ProtocolVersion2
 
 	// Use persistent compute connection
 	if s.computeClient == nil {
@@ -1061,51 +1192,79 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 		return client.ErrComputeNotRunning
 	}
 
-	// Send request and receive response over persistent connection
 	genCtx, cancel := context.WithTimeout(ctx, 120*time.Second) // 2 min timeout for generation
 	defer cancel()
 
-	responseData, err := s.computeClient.Send(genCtx, requestData)
-	if err != nil {
-		log.Printf("Failed to send request to compute process for session %s: %v", sessionID, err)
-		if errors.Is(err, client.ErrConnectionClosed) || errors.Is(err, client.ErrReaderDead) {
-			s.sendErrorEvent(sessionID, "Connection to image generation service was closed")
-		} else if errors.Is(err, client.ErrReadTimeout) {
-			s.sendErrorEvent(sessionID, "Image generation timed out. Try a simpler prompt.")
-		} else {
-			s.sendErrorEvent(sessionID, "Failed to generate image")
+	var response interface{}
+	for downgraded := false; ; downgraded = true {
+		// Encode request
+		requestData, err := protocol.EncodeSD35GenerateRequest(protoReq)
+		if err != nil {
+			log.Printf("Failed to encode protocol request for session %s: %v", sessionID, err)
+			s.sendErrorEvent(sessionID, "Failed to encode generation request")
+			return fmt.Errorf("failed to encode request: %w", err)
 		}
-		return fmt.Errorf("failed to send request: %w", err)
-	}
 
-	// Decode response
-	response, err := protocol.DecodeResponse(responseData)
-	if err != nil {
-		log.Printf("Failed to decode response for session %s: %v", sessionID, err)
-		s.sendErrorEvent(sessionID, "Failed to decode image generation response")
-		return fmt.Errorf("failed to decode response: %w", err)
+		// Send request and receive response over persistent connection
+		onProgress, stopProgress := s.forwardProgress(sessionID, messageID)
+		responseData, err := s.computeClient.SendWithProgress(genCtx, requestData, onProgress)
+		stopProgress()
+		if err != nil {
+			log.Printf("Failed to send request to compute process for session %s: %v", sessionID, err)
+			if errors.Is(err, client.ErrConnectionClosed) || errors.Is(err, client.ErrReaderDead) {
+				s.sendErrorEvent(sessionID, "Connection to image generation service was closed")
+			} else if errors.Is(err, client.ErrReadTimeout) {
+				s.sendErrorEvent(sessionID, "Image generation timed out. Try a simpler prompt.")
+			} else {
+				s.sendErrorEvent(sessionID, "Failed to generate image")
+			}
+			return fmt.Errorf("failed to send request: %w", err)
+		}
+
+		// Decode response
+		response, err = protocol.DecodeResponse(responseData)
+		if err != nil {
+			log.Printf("Failed to decode response for session %s: %v", sessionID, err)
+			s.sendErrorEvent(sessionID, "Failed to decode image generation response")
+			return fmt.Errorf("failed to decode response: %w", err)
+		}
+
+		// Compute refused it at once as it could not finish in time: shed
+		// load by asking for a cheaper draft instead
+		errResp, busy := response.(*protocol.ErrorResponse)
+		if !busy || errResp.ErrorCode != protocol.ErrCodeBusy || downgraded {
+			break
+		}
+		reqID = atomic.AddUint64(&s.requestID, 1)
+		protoReq.RequestID = reqID
+		downgradeRequest(protoReq)
+		log.Printf("Compute busy for session %s, retrying as a %dx%d draft with %d steps",
+			sessionID, protoReq.Width, protoReq.Height, protoReq.Steps)
 	}
 
 	// Handle response type
 	switch resp := response.(type) {
 	case *protocol.SD35GenerateResponse:
-		// Success - convert raw pixels to PNG
-		var format image.PixelFormat
-		if resp.Channels == 3 {
-			format = image.FormatRGB
-		} else {
-			format = image.FormatRGBA
-		}
+		// Success - compute normally sends PNG; convert raw pixels otherwise
+		pngData := resp.ImageData
+		if resp.Format != protocol.ImageFormatPNG {
+			var format image.PixelFormat
+			if resp.Channels == 3 {
+				format = image.FormatRGB
+			} else {
+				format = image.FormatRGBA
+			}
 
-		pngData, err := image.EncodePNG(int(resp.ImageWidth), int(resp.ImageHeight), resp.ImageData, format)
-		if err != nil {
-			log.Printf("Failed to encode PNG for session %s: %v", sessionID, err)
-			s.sendErrorEvent(sessionID, "Failed to encode generated image")
-			return fmt.Errorf("failed to encode PNG: %w", err)
+			pngData, err = image.EncodePNG(int(resp.ImageWidth), int(resp.ImageHeight), resp.ImageData, format)
+			if err != nil {
+				log.Printf("Failed to encode PNG for session %s: %v", sessionID, err)
+				s.sendErrorEvent(sessionID, "Failed to encode generated image")
+				return fmt.Errorf("failed to encode PNG: %w", err)
+			}
 		}
 
 		// Determine storage strategy based on message ID
-		var imageURL string
+		var imageURL, thumbnailURL string
 		if messageID > 0 {
 			// Save to persistent session-specific storage
 			if err := s.imageStore.Save(sessionID, messageID, pngData); err != nil {
@@ -1118,6 +1277,7 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 			session := s.sessionManager.GetSession(sessionID)
 			manager := session.Manager()
 			manager.UpdateMessagePreview(messageID, conversation.PreviewStatusComplete, s.imageStore.GetURL(sessionID, messageID))
+			manager.SetMessageComputeRequest(messageID, reqID)
 
 			imageURL = s.imageStore.GetURL(sessionID, messageID)
 			log.Printf("Saved image to session storage: %s", imageURL)
@@ -1134,6 +1294,9 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 				return fmt.Errorf("failed to store image: %w", err)
 			}
 			imageURL = fmt.Sprintf("/images/%s.png", imageID)
+			if _, err := s.imageStorage.Thumbnail(imageID); err == nil {
+				thumbnailURL = fmt.Sprintf("/images/%s/thumbnail.png", imageID)
+			}
 		}
 
 		log.Printf("Generated image for session %s: %dx%d in %dms",
@@ -1141,10 +1304,11 @@ func (s *Server) generateImage(ctx context.Context, sessionID string, prompt str
 
 		// Send image-ready event with message ID
 		_ = s.broker.SendEvent(sessionID, EventImageReady, ImageReadyData{
-			URL:       imageURL,
-			Width:     int(resp.ImageWidth),
-			Height:    int(resp.ImageHeight),
-			MessageID: messageID,
+			URL:          imageURL,
+			ThumbnailURL: thumbnailURL,
+			Width:        int(resp.ImageWidth),
+			Height:       int(resp.ImageHeight),
+			MessageID:    messageID,
 		})
 
 	case *protocol.ErrorResponse:
@@ -1294,30 +1458,50 @@ func (s *Server) handleImage(w http.ResponseWriter, r *http.Request) {
 	// Remove .png extension if present
 	id = strings.TrimSuffix(id, ".png")
 
-	// Get image from storage
-	pngData, _, _, err := s.imageStorage.Get(id)
+	// Open image in storage: memory or its spill file, no copy either way
+	pngData, modTime, err := s.imageStorage.Open(id)
 	if err != nil {
-		if errors.Is(err, image.ErrNotFound) {
-			http.Error(w, "Image not found", http.StatusNotFound)
-			return
-		}
-		if errors.Is(err, image.ErrInvalidID) {
-			http.Error(w, "Invalid image ID", http.StatusBadRequest)
-			return
-		}
-		http.Error(w, "Internal server error", http.StatusInternalServerError)
+		writeImageError(w, err)
 		return
 	}
+	defer pngData.Close()
 
 	// Set headers for image serving
 	w.Header().Set("Content-Type", "image/png")
 	w.Header().Set("Cache-Control", "public, max-age=31536000, immutable")
 
-	// Write PNG data
+	// ServeContent sends a spill file with sendfile
+	http.ServeContent(w, r, "", modTime, pngData)
+}
+
+// handleImageThumbnail serves the thumbnail stored with a generated image.
+// GET /images/{id}/thumbnail.png
+func (s *Server) handleImageThumbnail(w http.ResponseWriter, r *http.Request) {
+	thumbnail, err := s.imageStorage.Thumbnail(r.PathValue("id"))
+	if err != nil {
+		writeImageError(w, err)
+		return
+	}
+
+	w.Header().Set("Content-Type", "image/png")
+	w.Header().Set("Cache-Control", "public, max-age=31536000, immutable")
 	w.WriteHeader(http.StatusOK)
-	if _, err := w.Write(pngData); err != nil {
-		log.Printf("Failed to write image data for %s: %v", id, err)
+	if _, err := w.Write(thumbnail); err != nil {
+		log.Printf("Failed to write thumbnail for %s: %v", r.PathValue("id"), err)
+	}
+}
+
+// writeImageError answers an image lookup error from image.Storage.
+func writeImageError(w http.ResponseWriter, err error) {
+	if errors.Is(err, image.ErrNotFound) {
+		http.Error(w, "Image not found", http.StatusNotFound)
+		return
+	}
+	if errors.Is(err, image.ErrInvalidID) {
+		http.Error(w, "Invalid image ID", http.StatusBadRequest)
+		return
 	}
+	http.Error(w, "Internal server error", http.StatusInternalServerError)
 }
 
 // handleSessionImage serves a session-specific image by message ID.
@@ -1,7 +1,9 @@
 package web
 
 import (
+	"bytes"
 	"context"
+	"encoding/binary"
 	"errors"
 	"fmt"
 	"io"
@@ -16,6 +18,7 @@ import (
 	"github.com/hurricanerix/weave/internal/config"
 	"github.com/hurricanerix/weave/internal/image"
 	"github.com/hurricanerix/weave/internal/ollama"
+	"github.com/hurricanerix/weave/internal/protocol"
 )
 
 func TestNewServer(t *testing.T) {
@@ -762,6 +765,62 @@ func TestHandleImage_InvalidID(t *testing.T) {
 	}
 }
 
+func TestHandleImageThumbnail(t *testing.T) {
+	storage := image.NewStorage()
+	server, err := NewServerWithDeps("", nil, nil, storage, nil, nil, nil)
+	if err != nil {
+		t.Fatalf("NewServerWithDeps failed: %v", err)
+	}
+
+	pngData, err := image.EncodePNG(256, 256, make([]byte, 256*256*3), image.FormatRGB)
+	if err != nil {
+		t.Fatalf("EncodePNG failed: %v", err)
+	}
+	id, err := storage.Store(pngData, 256, 256)
+	if err != nil {
+		t.Fatalf("Store failed: %v", err)
+	}
+	junkID, err := storage.Store([]byte{1, 2, 3, 4}, 100, 100)
+	if err != nil {
+		t.Fatalf("Store failed: %v", err)
+	}
+
+	tests := []struct {
+		name string
+		id   string
+		want int
+	}{
+		{"stored image", id, http.StatusOK},
+		{"no thumbnail", junkID, http.StatusNotFound},
+		{"unknown image", "550e8400-e29b-41d4-a716-446655440000", http.StatusNotFound},
+		{"invalid id", "not-a-uuid", http.StatusBadRequest},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			req := httptest.NewRequest("GET", "/images/"+tt.id+"/thumbnail.png", nil)
+			w := httptest.NewRecorder()
+
+			server.server.Handler.ServeHTTP(w, req)
+
+			if w.Code != tt.want {
+				t.Fatalf("got status %d, want %d", w.Code, tt.want)
+			}
+			if tt.want != http.StatusOK {
+				return
+			}
+
+			if contentType := w.Header().Get("Content-Type"); contentType != "image/png" {
+				t.Errorf("got Content-Type %q, want %q", contentType, "image/png")
+			}
+			thumbnail, _ := storage.Thumbnail(id)
+			if !bytes.Equal(w.Body.Bytes(), thumbnail) {
+				t.Error("body does not match stored thumbnail")
+			}
+		})
+	}
+}
+
 func TestChatWithRetry_CompactionAfterMissingFieldsError(t *testing.T) {
 	mock := &mockOllamaClient{
 		responses: []mockResponse{
@@ -1506,3 +1565,58 @@ func TestGenerateFallbackResponse(t *testing.T) {
 		t.Errorf("generateFallbackResponse() = %q, want %q", got, want)
 	}
 }
+
+// buildProgressFrame builds a MSG_GENERATE_PROGRESS frame with an optional
+// square RGB preview.
+func buildProgressFrame(step, totalSteps, previewSide uint32) []byte {
+	previewLen := previewSide * previewSide * 3
+
+	buf := new(bytes.Buffer)
+	binary.Write(buf, binary.BigEndian, protocol.MagicNumber)
+	binary.Write(buf, binary.BigEndian, protocol.ProtocolVersion1)
+	binary.Write(buf, binary.BigEndian, protocol.MsgGenerateProgress)
+	binary.Write(buf, binary.BigEndian, 36+previewLen)
+	binary.Write(buf, binary.BigEndian, uint32(0))
+	binary.Write(buf, binary.BigEndian, uint64(1))
+	channels := uint32(0)
+	if previewSide > 0 {
+		channels = 3
+	}
+	for _, f := range []uint32{step, totalSteps, 500, previewSide, previewSide, channels, previewLen} {
+		binary.Write(buf, binary.BigEndian, f)
+	}
+	buf.Write(make([]byte, previewLen))
+	return buf.Bytes()
+}
+
+func TestProgressEventData(t *testing.T) {
+	tests := []struct {
+		name        string
+		frame       []byte
+		wantErr     bool
+		wantPreview bool
+	}{
+		{name: "step only", frame: buildProgressFrame(3, 28, 0)},
+		{name: "with preview", frame: buildProgressFrame(4, 28, 16), wantPreview: true},
+		{name: "invalid step", frame: buildProgressFrame(30, 28, 0), wantErr: true},
+		{name: "truncated", frame: buildProgressFrame(4, 28, 16)[:60], wantErr: true},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			data, err := progressEventData(tt.frame, 42)
+			if (err != nil) != tt.wantErr {
+				t.Fatalf("progressEventData() error = %v, wantErr %v", err, tt.wantErr)
+			}
+			if tt.wantErr {
+				return
+			}
+			if data.MessageID != 42 || data.TotalSteps != 28 || data.ElapsedMs != 500 {
+				t.Errorf("progressEventData() = %+v", data)
+			}
+			if got := strings.HasPrefix(data.Preview, "data:image/png;base64,"); got != tt.wantPreview {
+				t.Errorf("Preview = %q, want PNG data URL: %v", data.Preview, tt.wantPreview)
+			}
+		})
+	}
+}
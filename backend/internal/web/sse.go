@@ -50,6 +50,13 @@ const (
 	// Example: {"source": "agent"} or {"source": "manual"}
 	EventGenerationStarted = "generation-started"
 
+	// EventGenerationProgress reports a completed sampling step.
+	// Preview is a PNG data URL of a low-resolution latent preview, sent every
+	// few steps and omitted otherwise.
+	// Data schema: {"step": int, "total_steps": int, "elapsed_ms": int, "message_id": int, "preview": string}
+	// Example: {"step": 4, "total_steps": 28, "elapsed_ms": 1830, "message_id": 42, "preview": "data:image/png;base64,..."}
+	EventGenerationProgress = "generation-progress"
+
 	// EventAgentRetry indicates the agent response failed validation and is being retried.
 	// The UI should clear any partial streaming message.
 	// Data schema: {"attempt": int}
@@ -314,11 +321,22 @@ type AgentDoneData struct {
 	HasSnapshot bool `json:"has_snapshot"`
 }
 
+// GenerationProgressData represents the data sent with EventGenerationProgress.
+type GenerationProgressData struct {
+	Step       int    `json:"step"`
+	TotalSteps int    `json:"total_steps"`
+	ElapsedMs  int    `json:"elapsed_ms"`
+	MessageID  int    `json:"message_id"`
+	Preview    string `json:"preview,omitempty"`
+}
+
 // ImageReadyData represents the data sent with EventImageReady.
 // It includes the URL, dimensions, and message ID the image is associated with.
+// ThumbnailURL is set for images that have a stored thumbnail.
 type ImageReadyData struct {
-	URL       string `json:"url"`
-	Width     int    `json:"width"`
-	Height    int    `json:"height"`
-	MessageID int    `json:"message_id"`
+	URL          string `json:"url"`
+	ThumbnailURL string `json:"thumbnail_url,omitempty"`
+	Width        int    `json:"width"`
+	Height       int    `json:"height"`
+	MessageID    int    `json:"message_id"`
 }
@@ -0,0 +1,902 @@
+/**
+ * End-to-end benchmark for weave-compute over its socket protocol.
+ *
+ * Unlike bench_generate, which times sd_wrapper_generate() in-process, this
+ * drives a real weave-compute binary the way weave does: it listens on a
+ * Unix socket, starts the daemon with --socket-path so the daemon connects
+ * back (socket_connect() and the request pipeline), and sends encoded
+ * requests over that one connection. Latency therefore includes protocol
+ * encode/decode, queueing, resets, response encoding and socket copies.
+ *
+ * Load models:
+ * - Closed loop (default): --concurrency requests are kept outstanding;
+ *   each completion releases the next request.
+ * - Open loop (--rate): requests arrive as a Poisson process at the given
+ *   rate regardless of completions. Latency is measured from each request's
+ *   scheduled arrival, so a stalled daemon is not hidden by a stalled sender.
+ *
+ * Run against bench/weave-compute-stub (the daemon linked with a stub SD
+ * wrapper, see sd_wrapper_stub.c) to isolate daemon overhead from GPU time.
+ *
+ * Results are printed to stdout as one JSON object; daemon logs go to
+ * stderr only with --verbose.
+ *
+ * Usage:
+ *   bench_e2e --daemon PATH [options] [-- daemon args...]
+ *
+ * Example:
+ *   bench_e2e --daemon bench/weave-compute-stub --mix 512x512x4*3,1024x1024x4 -c 4
+ */
+
+#define _GNU_SOURCE /* For mkdtemp, pipe2 and getopt_long */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "weave/protocol.h"
+
+#define MAX_MIX_ENTRIES 16
+#define MAX_DAEMON_ARGS 64
+#define DEFAULT_REQUESTS 100
+#define DEFAULT_WARMUP 5
+#define DEFAULT_START_TIMEOUT_S 300
+#define BENCH_PROMPT "a lighthouse on a cliff at dawn, oil painting"
+
+/** One request shape in the mix */
+typedef struct {
+    char spec[32];      /* As given on the command line, without weight */
+    uint32_t width;
+    uint32_t height;
+    uint32_t steps;
+    uint32_t batch;     /* 1 = MSG_GENERATE_REQUEST, >1 = batch request */
+    uint32_t weight;    /* Relative frequency */
+} mix_entry_t;
+
+/** Benchmark configuration */
+typedef struct {
+    const char* daemon_path;
+    char* daemon_args[MAX_DAEMON_ARGS];
+    int daemon_argc;
+    uint32_t requests;
+    uint32_t warmup;
+    uint32_t concurrency;
+    double rate;                /* Requests per second (0 = closed loop) */
+    mix_entry_t mix[MAX_MIX_ENTRIES];
+    uint32_t mix_count;
+    uint32_t flags;             /* Request header flags */
+    uint64_t seed;              /* 0 = random per request */
+    const char* label;
+    int start_timeout_s;
+    bool verbose;
+} bench_config_t;
+
+/** Per-request record, indexed by request_id - 1 */
+typedef struct {
+    uint32_t mix_index;
+    struct timespec start;      /* Send time, or scheduled arrival (open loop) */
+    struct timespec end;        /* Final response or error received */
+    uint32_t error_code;        /* ERR_NONE or the MSG_ERROR code */
+    bool done;
+} request_record_t;
+
+/** State shared by the sender and the receiver thread */
+typedef struct {
+    int fd;
+    request_record_t* records;
+    uint32_t total;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t completed;         /* Guarded by lock */
+    bool failed;                /* Receiver hit an I/O or protocol error; guarded by lock */
+} bench_state_t;
+
+static void write_u16_be(uint8_t* buf, uint16_t value) {
+    buf[0] = (uint8_t)(value >> 8);
+    buf[1] = (uint8_t)value;
+}
+
+static void write_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+}
+
+static void write_u64_be(uint8_t* buf, uint64_t value) {
+    write_u32_be(buf, (uint32_t)(value >> 32));
+    write_u32_be(buf + 4, (uint32_t)value);
+}
+
+static uint32_t read_u32_be(const uint8_t* buf) {
+    return (uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 | (uint32_t)buf[2] << 8 | buf[3];
+}
+
+static uint64_t read_u64_be(const uint8_t* buf) {
+    return (uint64_t)read_u32_be(buf) << 32 | read_u32_be(buf + 4);
+}
+
+static double elapsed_ms(const struct timespec* from, const struct timespec* to) {
+    return (double)(to->tv_sec - from->tv_sec) * 1000.0 +
+           (double)(to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+static void add_seconds(struct timespec* ts, double seconds) {
+    long long ns = ts->tv_nsec + (long long)(seconds * 1e9);
+
+    ts->tv_sec += (time_t)(ns / 1000000000);
+    ts->tv_nsec = (long)(ns % 1000000000);
+}
+
+/**
+ * next_random - xorshift64* step, for reproducible mixes and arrivals
+ */
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * next_unit - Uniform double in (0, 1]
+ */
+static double next_unit(uint64_t* state) {
+    return ((double)(next_random(state) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+static int write_full(int fd, const uint8_t* buf, size_t count) {
+    while (count > 0) {
+        ssize_t n = write(fd, buf, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        count -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_full(int fd, uint8_t* buf, size_t count) {
+    while (count > 0) {
+        ssize_t n = read(fd, buf, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        count -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * build_request - Encode one single or batch generation request
+ *
+ * Layouts are those decode_generate_request() and
+ * decode_generate_batch_request() accept. The same prompt is sent to all
+ * three encoders.
+ *
+ * @return Encoded length, or 0 if buf is too small
+ */
+static size_t build_request(uint8_t* buf, size_t buf_size, uint64_t request_id,
+                            const mix_entry_t* shape, uint32_t flags, uint64_t seed) {
+    size_t prompt_len = strlen(BENCH_PROMPT);
+    size_t seeds_len = shape->batch > 1 ? (size_t)shape->batch * 8 : 0;
+    size_t payload_len = 12 + (shape->batch > 1 ? 44 : 48) + seeds_len + 3 * prompt_len;
+    uint8_t* p = buf;
+
+    if (16 + payload_len > buf_size) {
+        return 0;
+    }
+
+    write_u32_be(p, PROTOCOL_MAGIC);
+    write_u16_be(p + 4, PROTOCOL_VERSION_1);
+    write_u16_be(p + 6, shape->batch > 1 ? MSG_GENERATE_BATCH_REQUEST : MSG_GENERATE_REQUEST);
+    write_u32_be(p + 8, (uint32_t)payload_len);
+    write_u32_be(p + 12, flags);
+    p += 16;
+
+    write_u64_be(p, request_id);
+    write_u32_be(p + 8, MODEL_ID_SD35);
+    write_u32_be(p + 12, shape->width);
+    write_u32_be(p + 16, shape->height);
+    write_u32_be(p + 20, shape->steps);
+    write_u32_be(p + 24, 0x40900000u); /* cfg_scale 4.5f */
+    p += 28;
+
+    if (shape->batch > 1) {
+        write_u32_be(p, shape->batch);
+        p += 4;
+    } else {
+        write_u64_be(p, seed);
+        p += 8;
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+        write_u32_be(p, (uint32_t)(i * prompt_len));
+        write_u32_be(p + 4, (uint32_t)prompt_len);
+        p += 8;
+    }
+
+    for (uint32_t i = 0; i < shape->batch && shape->batch > 1; i++) {
+        write_u64_be(p, seed != 0 ? seed + i : 0);
+        p += 8;
+    }
+
+    for (uint32_t i = 0; i < 3; i++) {
+        memcpy(p, BENCH_PROMPT, prompt_len);
+        p += prompt_len;
+    }
+
+    return 16 + payload_len;
+}
+
+/**
+ * receiver_thread - Read replies and record their completion times
+ *
+ * Progress and timings frames are skipped; responses and errors are matched
+ * to their record by request_id.
+ */
+static void* receiver_thread(void* arg) {
+    bench_state_t* state = (bench_state_t*)arg;
+    uint8_t header[16];
+    uint8_t* payload = NULL;
+    size_t payload_cap = 0;
+    bool ok = true;
+
+    while (ok) {
+        uint32_t payload_len;
+        uint16_t msg_type;
+        uint64_t request_id;
+        struct timespec now;
+
+        pthread_mutex_lock(&state->lock);
+        ok = state->completed < state->total;
+        pthread_mutex_unlock(&state->lock);
+        if (!ok) {
+            break;
+        }
+
+        if (read_full(state->fd, header, sizeof(header)) != 0) {
+            fprintf(stderr, "bench: connection closed by daemon\n");
+            ok = false;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        payload_len = read_u32_be(header + 8);
+        msg_type = (uint16_t)(header[6] << 8 | header[7]);
+        if (payload_len > MAX_MESSAGE_SIZE) {
+            fprintf(stderr, "bench: reply payload too large (%u bytes)\n", payload_len);
+            ok = false;
+            break;
+        }
+        if (payload_len > payload_cap) {
+            uint8_t* grown = realloc(payload, payload_len);
+            if (grown == NULL) {
+                ok = false;
+                break;
+            }
+            payload = grown;
+            payload_cap = payload_len;
+        }
+        if (read_full(state->fd, payload, payload_len) != 0) {
+            fprintf(stderr, "bench: connection closed mid-reply\n");
+            ok = false;
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (msg_type == MSG_GENERATE_PROGRESS || msg_type == MSG_GENERATE_TIMINGS) {
+            continue;
+        }
+        if ((msg_type != MSG_GENERATE_RESPONSE && msg_type != MSG_GENERATE_BATCH_RESPONSE &&
+             msg_type != MSG_ERROR) || payload_len < 8) {
+            fprintf(stderr, "bench: unexpected reply type 0x%04x\n", msg_type);
+            ok = false;
+            break;
+        }
+
+        request_id = read_u64_be(payload);
+        if (request_id == 0 || request_id > state->total ||
+            state->records[request_id - 1].done) {
+            fprintf(stderr, "bench: reply for unknown request %llu (error %u)\n",
+                    (unsigned long long)request_id,
+                    msg_type == MSG_ERROR && payload_len >= 16 ? read_u32_be(payload + 12) : 0);
+            ok = false;
+            break;
+        }
+
+        pthread_mutex_lock(&state->lock);
+        state->records[request_id - 1].end = now;
+        state->records[request_id - 1].error_code =
+            msg_type == MSG_ERROR && payload_len >= 16 ? read_u32_be(payload + 12) : ERR_NONE;
+        state->records[request_id - 1].done = true;
+        state->completed++;
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    free(payload);
+    if (!ok) {
+        pthread_mutex_lock(&state->lock);
+        state->failed = true;
+        pthread_cond_broadcast(&state->cond);
+        pthread_mutex_unlock(&state->lock);
+    }
+    return NULL;
+}
+
+/**
+ * wait_completed - Block until at least target requests have completed
+ *
+ * @return 0 once reached, -1 if the receiver failed
+ */
+static int wait_completed(bench_state_t* state, uint32_t target) {
+    int rc = 0;
+
+    pthread_mutex_lock(&state->lock);
+    while (state->completed < target && !state->failed) {
+        pthread_cond_wait(&state->cond, &state->lock);
+    }
+    if (state->completed < target) {
+        rc = -1;
+    }
+    pthread_mutex_unlock(&state->lock);
+    return rc;
+}
+
+/**
+ * run_phase - Send requests first_id .. first_id + count - 1 and wait for them
+ *
+ * @return 0 on success, -1 on connection or protocol failure
+ */
+static int run_phase(const bench_config_t* config, bench_state_t* state, uint32_t first_id,
+                     uint32_t count, uint64_t* rng) {
+    uint8_t request[4096];
+    struct timespec arrival;
+    uint32_t total_weight = 0;
+
+    for (uint32_t i = 0; i < config->mix_count; i++) {
+        total_weight += config->mix[i].weight;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &arrival);
+    for (uint32_t id = first_id; id < first_id + count; id++) {
+        request_record_t* record = &state->records[id - 1];
+        uint32_t pick = (uint32_t)(next_random(rng) % total_weight);
+        size_t len;
+
+        record->mix_index = 0;
+        while (pick >= config->mix[record->mix_index].weight) {
+            pick -= config->mix[record->mix_index].weight;
+            record->mix_index++;
+        }
+
+        if (config->rate > 0) {
+            /* Exponential gaps make a Poisson arrival process */
+            add_seconds(&arrival, -log(next_unit(rng)) / config->rate);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &arrival, NULL) == EINTR) {
+            }
+            record->start = arrival;
+        } else {
+            if (id > config->concurrency && wait_completed(state, id - config->concurrency) != 0) {
+                return -1;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &record->start);
+        }
+
+        len = build_request(request, sizeof(request), id, &config->mix[record->mix_index],
+                            config->flags, config->seed);
+        if (len == 0 || write_full(state->fd, request, len) != 0) {
+            fprintf(stderr, "bench: failed to send request %u\n", id);
+            return -1;
+        }
+    }
+
+    return wait_completed(state, first_id + count - 1);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * percentile - Nearest-rank percentile of sorted values
+ */
+static double percentile(const double* sorted, size_t count, double p) {
+    size_t rank = (size_t)ceil(p / 100.0 * (double)count);
+
+    if (count == 0) {
+        return 0.0;
+    }
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank - 1];
+}
+
+/**
+ * print_latency - Print a latency_ms JSON object for the selected requests
+ *
+ * @param mix_index  Mix entry to include, or -1 for every successful request
+ */
+static void print_latency(const bench_state_t* state, uint32_t first, uint32_t count,
+                          int mix_index, double* scratch) {
+    size_t n = 0;
+    double sum = 0.0;
+
+    for (uint32_t i = first; i < first + count; i++) {
+        const request_record_t* record = &state->records[i];
+        if (record->error_code != ERR_NONE ||
+            (mix_index >= 0 && record->mix_index != (uint32_t)mix_index)) {
+            continue;
+        }
+        scratch[n] = elapsed_ms(&record->start, &record->end);
+        sum += scratch[n];
+        n++;
+    }
+    qsort(scratch, n, sizeof(scratch[0]), compare_double);
+
+    printf("{\"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, "
+           "\"max\": %.3f}",
+           n > 0 ? scratch[0] : 0.0, n > 0 ? sum / (double)n : 0.0,
+           percentile(scratch, n, 50), percentile(scratch, n, 95), percentile(scratch, n, 99),
+           n > 0 ? scratch[n - 1] : 0.0);
+}
+
+/**
+ * print_json_string - Print s as a JSON string literal
+ */
+static void print_json_string(const char* s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            printf("\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            printf("\\u%04x", (unsigned)(unsigned char)*s);
+        } else {
+            putchar(*s);
+        }
+    }
+    putchar('"');
+}
+
+/**
+ * print_results - Print the measured phase as one JSON object
+ */
+static int print_results(const bench_config_t* config, const bench_state_t* state) {
+    uint32_t first = config->warmup;
+    uint32_t count = config->requests;
+    struct timespec phase_start = state->records[first].start;
+    struct timespec phase_end = state->records[first].end;
+    uint32_t errors = 0;
+    uint64_t images = 0;
+    double duration_s;
+    double* scratch = malloc(count * sizeof(double));
+
+    if (scratch == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = first; i < first + count; i++) {
+        const request_record_t* record = &state->records[i];
+        if (elapsed_ms(&record->end, &phase_end) < 0) {
+            phase_end = record->end;
+        }
+        if (record->error_code != ERR_NONE) {
+            errors++;
+        } else {
+            images += config->mix[record->mix_index].batch;
+        }
+    }
+    duration_s = elapsed_ms(&phase_start, &phase_end) / 1000.0;
+
+    printf("{\n  \"label\": ");
+    print_json_string(config->label);
+    printf(",\n  \"mode\": \"%s\",\n", config->rate > 0 ? "open" : "closed");
+    printf("  \"concurrency\": %u,\n", config->rate > 0 ? 0 : config->concurrency);
+    printf("  \"rate_rps\": %.3f,\n", config->rate);
+    printf("  \"flags\": %u,\n", config->flags);
+    printf("  \"requests\": %u,\n  \"warmup\": %u,\n  \"errors\": %u,\n",
+           count, config->warmup, errors);
+    printf("  \"duration_s\": %.6f,\n", duration_s);
+    printf("  \"throughput_rps\": %.3f,\n",
+           duration_s > 0 ? (double)(count - errors) / duration_s : 0.0);
+    printf("  \"images_per_s\": %.3f,\n", duration_s > 0 ? (double)images / duration_s : 0.0);
+    printf("  \"latency_ms\": ");
+    print_latency(state, first, count, -1, scratch);
+    printf(",\n  \"mix\": [\n");
+    for (uint32_t m = 0; m < config->mix_count; m++) {
+        uint32_t n = 0;
+        uint32_t mix_errors = 0;
+
+        for (uint32_t i = first; i < first + count; i++) {
+            if (state->records[i].mix_index == m) {
+                n++;
+                mix_errors += state->records[i].error_code != ERR_NONE;
+            }
+        }
+        printf("    {\"spec\": ");
+        print_json_string(config->mix[m].spec);
+        printf(", \"weight\": %u, \"count\": %u, \"errors\": %u, \"latency_ms\": ",
+               config->mix[m].weight, n, mix_errors);
+        print_latency(state, first, count, (int)m, scratch);
+        printf("}%s\n", m + 1 < config->mix_count ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    free(scratch);
+    return 0;
+}
+
+/**
+ * parse_mix - Parse WxHxSTEPS[xBATCH][*WEIGHT][,...] into config->mix
+ *
+ * @return 0 on success, -1 on a malformed or out-of-range entry
+ */
+static int parse_mix(const char* spec, bench_config_t* config) {
+    char buf[512];
+    char* save = NULL;
+    char* entry;
+
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, spec);
+    config->mix_count = 0;
+
+    for (entry = strtok_r(buf, ",", &save); entry != NULL; entry = strtok_r(NULL, ",", &save)) {
+        mix_entry_t* shape = &config->mix[config->mix_count];
+        char* star = strchr(entry, '*');
+        char trailing;
+        int fields;
+
+        if (config->mix_count == MAX_MIX_ENTRIES) {
+            return -1;
+        }
+
+        shape->weight = 1;
+        if (star != NULL) {
+            *star = '\0';
+            if (sscanf(star + 1, "%u%c", &shape->weight, &trailing) != 1 || shape->weight == 0) {
+                return -1;
+            }
+        }
+
+        shape->batch = 1;
+        fields = sscanf(entry, "%ux%ux%ux%u%c", &shape->width, &shape->height, &shape->steps,
+                        &shape->batch, &trailing);
+        if ((fields != 3 && fields != 4) ||
+            shape->width < SD35_MIN_DIMENSION || shape->width > SD35_MAX_DIMENSION ||
+            shape->height < SD35_MIN_DIMENSION || shape->height > SD35_MAX_DIMENSION ||
+            shape->steps < SD35_MIN_STEPS || shape->steps > SD35_MAX_STEPS ||
+            shape->batch < 1 || shape->batch > SD35_MAX_BATCH_SIZE ||
+            strlen(entry) >= sizeof(shape->spec)) {
+            return -1;
+        }
+        strcpy(shape->spec, entry);
+        config->mix_count++;
+    }
+
+    return config->mix_count > 0 ? 0 : -1;
+}
+
+/**
+ * parse_flags - Parse a comma-separated list of png, progress, timings and clip-only
+ */
+static int parse_flags(const char* list, uint32_t* flags) {
+    char buf[128];
+    char* save = NULL;
+    char* name;
+
+    if (strlen(list) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, list);
+    *flags = 0;
+
+    for (name = strtok_r(buf, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        if (strcmp(name, "png") == 0) {
+            *flags |= PROTOCOL_FLAG_PNG;
+        } else if (strcmp(name, "progress") == 0) {
+            *flags |= PROTOCOL_FLAG_PROGRESS;
+        } else if (strcmp(name, "timings") == 0) {
+            *flags |= PROTOCOL_FLAG_TIMINGS;
+        } else if (strcmp(name, "clip-only") == 0) {
+            *flags |= PROTOCOL_FLAG_CLIP_ONLY;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * start_daemon - Listen on a fresh socket, start the daemon and accept it
+ *
+ * The daemon's stdin is a pipe held open by *stdin_fd; closing it is how
+ * weave-compute learns its parent is gone.
+ *
+ * @return Connected socket, or -1 on failure
+ */
+static int start_daemon(const bench_config_t* config, char* socket_dir, pid_t* pid,
+                        int* stdin_fd) {
+    struct sockaddr_un addr;
+    char* argv[MAX_DAEMON_ARGS + 4];
+    int listen_fd;
+    int conn_fd = -1;
+    int stdin_pipe[2];
+    struct pollfd pfd;
+    int argc = 0;
+
+    if (mkdtemp(socket_dir) == NULL) {
+        perror("bench: mkdtemp");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/bench.sock", socket_dir);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 1) != 0) {
+        perror("bench: listen");
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        return -1;
+    }
+
+    if (pipe2(stdin_pipe, O_CLOEXEC) != 0) {
+        perror("bench: pipe");
+        close(listen_fd);
+        return -1;
+    }
+
+    argv[argc++] = (char*)config->daemon_path;
+    argv[argc++] = "--socket-path";
+    argv[argc++] = addr.sun_path;
+    for (int i = 0; i < config->daemon_argc; i++) {
+        argv[argc++] = config->daemon_args[i];
+    }
+    argv[argc] = NULL;
+
+    *pid = fork();
+    if (*pid < 0) {
+        perror("bench: fork");
+        close(stdin_pipe[0]);
+        close(stdin_pipe[1]);
+        close(listen_fd);
+        return -1;
+    }
+    if (*pid == 0) {
+        dup2(stdin_pipe[0], STDIN_FILENO);
+        if (!config->verbose) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDERR_FILENO);
+            }
+        }
+        execv(config->daemon_path, argv);
+        _exit(127);
+    }
+    close(stdin_pipe[0]);
+    *stdin_fd = stdin_pipe[1];
+
+    /* The daemon loads its pinned models before it connects */
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, config->start_timeout_s * 1000) == 1) {
+        conn_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    }
+    if (conn_fd < 0) {
+        fprintf(stderr, "bench: daemon did not connect within %d s\n", config->start_timeout_s);
+    }
+    close(listen_fd);
+    return conn_fd;
+}
+
+static void print_usage(const char* program, int exit_code) {
+    FILE* out = exit_code == 0 ? stdout : stderr;
+
+    fprintf(out, "Usage: %s --daemon PATH [options] [-- daemon args...]\n\n", program);
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -d, --daemon PATH        weave-compute binary to start (required)\n");
+    fprintf(out, "  -n, --requests N         Measured requests (default: %d)\n", DEFAULT_REQUESTS);
+    fprintf(out, "  -w, --warmup N           Unmeasured requests sent first (default: %d)\n",
+            DEFAULT_WARMUP);
+    fprintf(out, "  -c, --concurrency N      Closed loop: requests kept outstanding (default: 1)\n");
+    fprintf(out, "  -r, --rate R             Open loop: Poisson arrivals at R requests/s\n");
+    fprintf(out, "  -m, --mix SPEC           Request mix, WxHxSTEPS[xBATCH][*WEIGHT],...\n");
+    fprintf(out, "                           (default: 512x512x4)\n");
+    fprintf(out, "  -f, --flags LIST         Header flags: png,progress,timings,clip-only\n");
+    fprintf(out, "  -s, --seed N             Seed for every request (default: 0 = random).\n");
+    fprintf(out, "                           A fixed seed lets the result cache answer repeats\n");
+    fprintf(out, "  -l, --label TEXT         Label copied into the JSON (e.g. a commit)\n");
+    fprintf(out, "  -t, --start-timeout S    Seconds to wait for the daemon (default: %d)\n",
+            DEFAULT_START_TIMEOUT_S);
+    fprintf(out, "  -v, --verbose            Pass daemon logs through to stderr\n");
+    fprintf(out, "  -h, --help               Show this help message\n\n");
+    fprintf(out, "Set WEAVE_STUB_STEP_US to give bench/weave-compute-stub a per-step delay.\n");
+    exit(exit_code);
+}
+
+static uint32_t parse_count(const char* arg, const char* program) {
+    char* end;
+    unsigned long value;
+
+    errno = 0;
+    value = strtoul(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || value > UINT32_MAX / 2) {
+        fprintf(stderr, "invalid count: %s\n", arg);
+        print_usage(program, 1);
+    }
+    return (uint32_t)value;
+}
+
+int main(int argc, char* argv[]) {
+    bench_config_t config;
+    bench_state_t state;
+    char socket_dir[] = "/tmp/weave-bench-XXXXXX";
+    char socket_path[sizeof(socket_dir) + 16];
+    pthread_t receiver;
+    pid_t pid = -1;
+    int stdin_fd = -1;
+    int status;
+    int rc = 1;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    int opt;
+
+    static struct option long_options[] = {
+        {"daemon", required_argument, 0, 'd'},
+        {"requests", required_argument, 0, 'n'},
+        {"warmup", required_argument, 0, 'w'},
+        {"concurrency", required_argument, 0, 'c'},
+        {"rate", required_argument, 0, 'r'},
+        {"mix", required_argument, 0, 'm'},
+        {"flags", required_argument, 0, 'f'},
+        {"seed", required_argument, 0, 's'},
+        {"label", required_argument, 0, 'l'},
+        {"start-timeout", required_argument, 0, 't'},
+        {"verbose", no_argument, 0, 'v'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    memset(&config, 0, sizeof(config));
+    config.requests = DEFAULT_REQUESTS;
+    config.warmup = DEFAULT_WARMUP;
+    config.concurrency = 1;
+    config.label = "";
+    config.start_timeout_s = DEFAULT_START_TIMEOUT_S;
+    parse_mix("512x512x4", &config);
+
+    while ((opt = getopt_long(argc, argv, "d:n:w:c:r:m:f:s:l:t:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            config.daemon_path = optarg;
+            break;
+        case 'n':
+            config.requests = parse_count(optarg, argv[0]);
+            break;
+        case 'w':
+            config.warmup = parse_count(optarg, argv[0]);
+            break;
+        case 'c':
+            config.concurrency = parse_count(optarg, argv[0]);
+            break;
+        case 'r':
+            config.rate = strtod(optarg, NULL);
+            if (!(config.rate > 0)) {
+                fprintf(stderr, "invalid rate: %s\n", optarg);
+                print_usage(argv[0], 1);
+            }
+            break;
+        case 'm':
+            if (parse_mix(optarg, &config) != 0) {
+                fprintf(stderr, "invalid mix: %s\n", optarg);
+                print_usage(argv[0], 1);
+            }
+            break;
+        case 'f':
+            if (parse_flags(optarg, &config.flags) != 0) {
+                fprintf(stderr, "invalid flags: %s\n", optarg);
+                print_usage(argv[0], 1);
+            }
+            break;
+        case 's':
+            config.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'l':
+            config.label = optarg;
+            break;
+        case 't':
+            config.start_timeout_s = (int)parse_count(optarg, argv[0]);
+            break;
+        case 'v':
+            config.verbose = true;
+            break;
+        case 'h':
+            print_usage(argv[0], 0);
+            break;
+        default:
+            print_usage(argv[0], 1);
+            break;
+        }
+    }
+
+    if (config.daemon_path == NULL || config.requests == 0 || config.concurrency == 0) {
+        print_usage(argv[0], 1);
+    }
+    for (int i = optind; i < argc; i++) {
+        if (config.daemon_argc == MAX_DAEMON_ARGS) {
+            fprintf(stderr, "too many daemon arguments\n");
+            return 1;
+        }
+        config.daemon_args[config.daemon_argc++] = argv[i];
+    }
+
+    /* A dead daemon must surface as a failed read, not kill the bench */
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&state, 0, sizeof(state));
+    state.total = config.warmup + config.requests;
+    state.records = calloc(state.total, sizeof(state.records[0]));
+    if (state.records == NULL || pthread_mutex_init(&state.lock, NULL) != 0 ||
+        pthread_cond_init(&state.cond, NULL) != 0) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    state.fd = start_daemon(&config, socket_dir, &pid, &stdin_fd);
+    if (state.fd >= 0 && pthread_create(&receiver, NULL, receiver_thread, &state) == 0) {
+        if ((config.warmup == 0 || run_phase(&config, &state, 1, config.warmup, &rng) == 0) &&
+            run_phase(&config, &state, config.warmup + 1, config.requests, &rng) == 0) {
+            rc = print_results(&config, &state) == 0 ? 0 : 1;
+        }
+        shutdown(state.fd, SHUT_RDWR);
+        pthread_join(receiver, NULL);
+    }
+
+    if (state.fd >= 0) {
+        close(state.fd);
+    }
+    if (stdin_fd >= 0) {
+        close(stdin_fd);
+    }
+    if (pid > 0) {
+        waitpid(pid, &status, 0);
+    }
+    snprintf(socket_path, sizeof(socket_path), "%s/bench.sock", socket_dir);
+    unlink(socket_path);
+    rmdir(socket_dir);
+
+    pthread_cond_destroy(&state.cond);
+    pthread_mutex_destroy(&state.lock);
+    free(state.records);
+    return rc;
+}
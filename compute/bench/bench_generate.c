@@ -7,12 +7,15 @@
  * - Measures timing for each iteration
  * - Reports min/max/avg/median performance
  * - Validates against target performance (1024x1024, 4 steps < 3s)
+ * - With a step cache threshold, compares step caching against the uncached
+ *   path at the default 28 steps: speedup and image difference
  *
  * Usage:
- *   bench_generate <model_path> [iterations]
+ *   bench_generate <model_path> [iterations] [step_cache_threshold]
  *
  * Example:
  *   bench_generate models/sd3.5_medium.safetensors 10
+ *   bench_generate models/sd3.5_medium.safetensors 5 0.2
  *
  * Target hardware: RTX 4070 Super (12GB VRAM)
  * Target performance: 1024x1024, 4 steps in under 3 seconds
@@ -23,6 +26,7 @@
 #include "weave/sd_wrapper.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -35,6 +39,7 @@ typedef struct {
     const char* model_path;
     int iterations;
     bool verbose;
+    float step_cache_threshold; /* 0 = skip the step cache comparison */
 } bench_config_t;
 
 /* Benchmark result for one configuration */
@@ -50,8 +55,17 @@ typedef struct {
     double median_ms;
     bool target_pass; /* Did this meet target? */
     double target_ms;
+    sd_wrapper_step_cache_t step_cache;
+    float step_cache_threshold;
 } bench_result_t;
 
+/* Difference between an image and its uncached reference */
+typedef struct {
+    double mean_abs;  /* Mean absolute channel difference (0-255) */
+    int max_abs;      /* Largest channel difference (0-255) */
+    double psnr_db;   /* Peak signal-to-noise ratio (INFINITY if identical) */
+} image_diff_t;
+
 /* Timing measurement */
 static double get_time_ms(struct timespec* start, struct timespec* end) {
     double start_ms = start->tv_sec * 1000.0 + start->tv_nsec / 1000000.0;
@@ -102,10 +116,41 @@ static void calculate_stats(double* times, int count, bench_result_t* result) {
     }
 }
 
-/* Run benchmark for one configuration */
+/* Compare two images of the same shape */
+static bool compare_images(const sd_wrapper_image_t* ref, const sd_wrapper_image_t* img,
+                           image_diff_t* diff) {
+    if (ref->width != img->width || ref->height != img->height ||
+        ref->channels != img->channels || ref->data_size != img->data_size ||
+        ref->data_size == 0) {
+        return false;
+    }
+
+    uint64_t sum_abs = 0;
+    double sum_sq = 0.0;
+    int max_abs = 0;
+
+    for (size_t i = 0; i < ref->data_size; i++) {
+        int d = abs((int)ref->data[i] - (int)img->data[i]);
+        sum_abs += (uint64_t)d;
+        sum_sq += (double)d * d;
+        if (d > max_abs) max_abs = d;
+    }
+
+    double mse = sum_sq / (double)ref->data_size;
+    diff->mean_abs = (double)sum_abs / (double)ref->data_size;
+    diff->max_abs = max_abs;
+    diff->psnr_db = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+    return true;
+}
+
+/*
+ * Run benchmark for one configuration. If last_image is not NULL, the last
+ * iteration's image is kept there for the caller to free.
+ */
 static bool run_benchmark(sd_wrapper_ctx_t* ctx,
                          bench_config_t* bench_config,
-                         bench_result_t* result) {
+                         bench_result_t* result,
+                         sd_wrapper_image_t* last_image) {
     double* times = (double*)malloc(sizeof(double) * bench_config->iterations);
     if (times == NULL) {
         fprintf(stderr, "Error: Failed to allocate timing array\n");
@@ -122,6 +167,8 @@ static bool run_benchmark(sd_wrapper_ctx_t* ctx,
     params.steps = result->steps;
     params.cfg_scale = result->cfg_scale;
     params.seed = 42; /* Fixed seed for reproducibility */
+    params.step_cache = result->step_cache;
+    params.step_cache_threshold = result->step_cache_threshold;
 
     if (bench_config->verbose) {
         printf("  Running %d iterations...\n", bench_config->iterations);
@@ -151,8 +198,12 @@ static bool run_benchmark(sd_wrapper_ctx_t* ctx,
                    i + 1, bench_config->iterations, times[i]);
         }
 
-        /* Free image data */
-        sd_wrapper_free_image(&image);
+        /* Keep the last image for comparison, free the rest */
+        if (last_image != NULL && i == bench_config->iterations - 1) {
+            *last_image = image;
+        } else {
+            sd_wrapper_free_image(&image);
+        }
     }
 
     /* Calculate statistics */
@@ -199,6 +250,73 @@ static void print_results(bench_result_t* results, int count) {
     }
 }
 
+/*
+ * Time the default 28 steps with and without step caching and report the
+ * speedup and how far the cached image is from the uncached one.
+ */
+static bool run_step_cache_comparison(sd_wrapper_ctx_t* ctx, bench_config_t* bench_config) {
+    bench_result_t runs[2] = {
+        {
+            .name = "Default Steps (1024x1024, 28 steps), uncached",
+            .width = 1024,
+            .height = 1024,
+            .steps = 28,
+            .cfg_scale = 4.5f,
+            .step_cache = SD_WRAPPER_STEP_CACHE_OFF,
+        },
+        {
+            .name = "Default Steps (1024x1024, 28 steps), step cache",
+            .width = 1024,
+            .height = 1024,
+            .steps = 28,
+            .cfg_scale = 4.5f,
+            .step_cache = SD_WRAPPER_STEP_CACHE_ON,
+            .step_cache_threshold = bench_config->step_cache_threshold,
+        },
+    };
+    sd_wrapper_image_t images[2];
+    image_diff_t diff;
+    bool same_shape;
+
+    memset(images, 0, sizeof(images));
+    for (int i = 0; i < 2; i++) {
+        printf("Running: %s\n", runs[i].name);
+        if (!run_benchmark(ctx, bench_config, &runs[i], &images[i])) {
+            sd_wrapper_free_image(&images[0]);
+            return false;
+        }
+    }
+    same_shape = compare_images(&images[0], &images[1], &diff);
+    sd_wrapper_free_image(&images[0]);
+    sd_wrapper_free_image(&images[1]);
+
+    printf("\n");
+    printf("=== Step Cache ===\n");
+    printf("\n");
+    printf("Configuration: Default Steps (1024x1024, 28 steps)\n");
+    printf("  Threshold: %.2f\n", bench_config->step_cache_threshold);
+    printf("\n");
+    printf("  Uncached avg: %7.2f ms (median %.2f ms)\n", runs[0].avg_ms, runs[0].median_ms);
+    printf("  Cached avg:   %7.2f ms (median %.2f ms)\n", runs[1].avg_ms, runs[1].median_ms);
+    printf("  Speedup:      %.2fx\n",
+           runs[1].avg_ms > 0.0 ? runs[0].avg_ms / runs[1].avg_ms : 0.0);
+    printf("\n");
+    if (!same_shape) {
+        fprintf(stderr, "Error: Cached and uncached images differ in shape\n");
+        return false;
+    }
+    printf("  Image difference vs uncached (seed 42):\n");
+    printf("    Mean abs error: %.3f / 255\n", diff.mean_abs);
+    printf("    Max abs error:  %d / 255\n", diff.max_abs);
+    if (isinf(diff.psnr_db)) {
+        printf("    PSNR:           identical\n");
+    } else {
+        printf("    PSNR:           %.2f dB\n", diff.psnr_db);
+    }
+    printf("\n");
+    return true;
+}
+
 /* Detect GPU name using nvidia-smi or rocm-smi */
 static void detect_gpu(char* gpu_name, size_t buf_size) {
     FILE* fp = popen("nvidia-smi --query-gpu=name --format=csv,noheader 2>/dev/null", "r");
@@ -254,10 +372,11 @@ static void get_vram_usage(char* vram_str, size_t buf_size) {
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <model_path> [iterations]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <model_path> [iterations] [step_cache_threshold]\n", argv[0]);
         fprintf(stderr, "\n");
         fprintf(stderr, "Example:\n");
         fprintf(stderr, "  %s models/sd3.5_medium.safetensors 10\n", argv[0]);
+        fprintf(stderr, "  %s models/sd3.5_medium.safetensors 5 0.2\n", argv[0]);
         fprintf(stderr, "\n");
         fprintf(stderr, "Note: Model file must exist and GPU must be available.\n");
         return 1;
@@ -267,6 +386,7 @@ int main(int argc, char** argv) {
         .model_path = argv[1],
         .iterations = 10,
         .verbose = true,
+        .step_cache_threshold = 0.0f,
     };
 
     if (argc >= 3) {
@@ -287,6 +407,18 @@ int main(int argc, char** argv) {
         bench_config.iterations = (int)val;
     }
 
+    if (argc >= 4) {
+        char *endptr;
+        float val = strtof(argv[3], &endptr);
+
+        if (endptr == argv[3] || *endptr != '\0' || !(val > 0.0f && val <= 1.0f)) {
+            fprintf(stderr, "Error: Step cache threshold must be above 0.0 and at most 1.0\n");
+            return 1;
+        }
+
+        bench_config.step_cache_threshold = val;
+    }
+
     printf("=== Weave Compute Benchmark ===\n");
     printf("\n");
     printf("Model: SD 3.5 Medium\n");
@@ -409,7 +541,7 @@ int main(int argc, char** argv) {
     for (int i = 0; i < 3; i++) {
         printf("Running: %s\n", results[i].name);
 
-        if (!run_benchmark(ctx, &bench_config, &results[i])) {
+        if (!run_benchmark(ctx, &bench_config, &results[i], NULL)) {
             fprintf(stderr, "Error: Benchmark failed for configuration: %s\n",
                     results[i].name);
             sd_wrapper_free(ctx);
@@ -420,6 +552,13 @@ int main(int argc, char** argv) {
     /* Print results */
     print_results(results, 3);
 
+    if (bench_config.step_cache_threshold > 0.0f &&
+        !run_step_cache_comparison(ctx, &bench_config)) {
+        fprintf(stderr, "Error: Step cache comparison failed\n");
+        sd_wrapper_free(ctx);
+        return 1;
+    }
+
     /* Overall status */
     printf("=== Overall Status ===\n");
     printf("\n");
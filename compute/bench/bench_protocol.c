@@ -0,0 +1,424 @@
+/**
+ * Micro-benchmark for the binary protocol encoders and decoders.
+ *
+ * This benchmark:
+ * - Times request decoding, whole-message and header-then-payload, across
+ *   prompt lengths and batch sizes
+ * - Times response framing (v1 prefix, v2 head) across image sizes, next to
+ *   a full v1 encode that copies the pixels, for contrast
+ * - Times error, chunk and progress frame encoding
+ * - Checks that framing cost does not grow with image size
+ *
+ * Framing writes a fixed-size prefix and never touches the pixels, which go
+ * to the socket with writev, so its cost must be flat from 64x64 to
+ * 2048x2048. The run fails if the slowest size of a framing case takes more
+ * than FRAMING_MAX_RATIO times the fastest.
+ *
+ * Usage:
+ *   bench_protocol [min_ms_per_case]
+ *
+ * Example:
+ *   bench_protocol 200
+ */
+
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weave/protocol.h"
+
+/* Default measuring time per case */
+#define DEFAULT_MIN_MS 100.0
+
+/* Allowed slowest/fastest ratio for a framing case across image sizes */
+#define FRAMING_MAX_RATIO 3.0
+
+/* Largest encoded message used by any case */
+#define BENCH_BUFFER_SIZE (MAX_MESSAGE_SIZE)
+
+typedef error_code_t (*bench_fn_t)(void* ctx);
+
+/* Request decoding input */
+typedef struct {
+    uint8_t message[4096];
+    size_t len;
+    sd35_generate_request_t req;
+    sd35_generate_batch_request_t batch;
+    cancel_request_t cancel;
+} decode_ctx_t;
+
+/* Response encoding input */
+typedef struct {
+    sd35_generate_response_t resp;
+    sd35_generate_batch_response_t batch;
+    error_response_t error;
+    sd35_generate_progress_t progress;
+    uint32_t chunk_len;
+    uint8_t* out;
+    size_t out_len;
+} encode_ctx_t;
+
+static uint8_t* g_pixels;
+static uint8_t* g_out;
+
+static void write_u16_be(uint8_t* buf, uint16_t value) {
+    buf[0] = (uint8_t)(value >> 8);
+    buf[1] = (uint8_t)value;
+}
+
+static void write_u32_be(uint8_t* buf, uint32_t value) {
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+}
+
+static void write_u64_be(uint8_t* buf, uint64_t value) {
+    write_u32_be(buf, (uint32_t)(value >> 32));
+    write_u32_be(buf + 4, (uint32_t)value);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * build_request - Encode a single (seed_count 0) or batch request
+ *
+ * @return Encoded length
+ */
+static size_t build_request(uint8_t* buf, uint32_t seed_count, uint32_t prompt_len) {
+    size_t seeds_len = (size_t)seed_count * 8;
+    size_t payload_len = 12 + (seed_count > 0 ? 44 : 48) + seeds_len + 3 * (size_t)prompt_len;
+    uint8_t* p = buf;
+
+    write_u32_be(p, PROTOCOL_MAGIC);
+    write_u16_be(p + 4, PROTOCOL_VERSION_1);
+    write_u16_be(p + 6, seed_count > 0 ? MSG_GENERATE_BATCH_REQUEST : MSG_GENERATE_REQUEST);
+    write_u32_be(p + 8, (uint32_t)payload_len);
+    write_u32_be(p + 12, 0);
+    p += 16;
+
+    write_u64_be(p, 1);
+    write_u32_be(p + 8, MODEL_ID_SD35);
+    write_u32_be(p + 12, 1024);
+    write_u32_be(p + 16, 1024);
+    write_u32_be(p + 20, 28);
+    write_u32_be(p + 24, 0x40900000u); /* 4.5f */
+    p += 28;
+
+    if (seed_count > 0) {
+        write_u32_be(p, seed_count);
+        p += 4;
+    } else {
+        write_u64_be(p, 42);
+        p += 8;
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        write_u32_be(p, i * prompt_len);
+        write_u32_be(p + 4, prompt_len);
+        p += 8;
+    }
+    for (uint32_t i = 0; i < seed_count; i++) {
+        write_u64_be(p, 100 + i);
+        p += 8;
+    }
+    memset(p, 'a', 3 * (size_t)prompt_len);
+
+    return 16 + payload_len;
+}
+
+static error_code_t run_decode_header(void* arg) {
+    decode_ctx_t* ctx = (decode_ctx_t*)arg;
+    protocol_header_t header;
+    return decode_header(ctx->message, ctx->len, &header);
+}
+
+static error_code_t run_decode_request(void* arg) {
+    decode_ctx_t* ctx = (decode_ctx_t*)arg;
+    return decode_generate_request(ctx->message, ctx->len, &ctx->req);
+}
+
+static error_code_t run_decode_request_payload(void* arg) {
+    decode_ctx_t* ctx = (decode_ctx_t*)arg;
+    protocol_header_t header;
+    error_code_t err = decode_header(ctx->message, ctx->len, &header);
+    if (err != ERR_NONE) {
+        return err;
+    }
+    return decode_generate_request_payload(&header, ctx->message + 16, &ctx->req);
+}
+
+static error_code_t run_decode_batch(void* arg) {
+    decode_ctx_t* ctx = (decode_ctx_t*)arg;
+    return decode_generate_batch_request(ctx->message, ctx->len, &ctx->batch);
+}
+
+static error_code_t run_decode_cancel(void* arg) {
+    decode_ctx_t* ctx = (decode_ctx_t*)arg;
+    return decode_cancel_request(ctx->message, ctx->len, &ctx->cancel);
+}
+
+static error_code_t run_encode_prefix(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_generate_response_prefix(&ctx->resp, ctx->out, SD35_RESPONSE_PREFIX_SIZE,
+                                           &ctx->out_len);
+}
+
+static error_code_t run_encode_head(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_generate_response_head(&ctx->resp, PROTOCOL_FLAG_CHUNKED, ctx->out,
+                                         SD35_RESPONSE_HEAD_SIZE, &ctx->out_len);
+}
+
+static error_code_t run_encode_full(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_generate_response(&ctx->resp, ctx->out, BENCH_BUFFER_SIZE, &ctx->out_len);
+}
+
+static error_code_t run_encode_batch_prefix(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_generate_batch_response_prefix(&ctx->batch, ctx->out,
+                                                 SD35_BATCH_RESPONSE_PREFIX_SIZE, &ctx->out_len);
+}
+
+static error_code_t run_encode_error(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_error_response(&ctx->error, ctx->out, BENCH_BUFFER_SIZE, &ctx->out_len);
+}
+
+static error_code_t run_encode_chunk_header(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    ctx->out_len = 16;
+    return encode_chunk_header(ctx->chunk_len, ctx->out, 16);
+}
+
+static error_code_t run_encode_progress(void* arg) {
+    encode_ctx_t* ctx = (encode_ctx_t*)arg;
+    return encode_generate_progress(&ctx->progress, ctx->out, BENCH_BUFFER_SIZE, &ctx->out_len);
+}
+
+/**
+ * time_case - Measure ns per call of fn, doubling the batch until min_ms pass
+ *
+ * @return ns per call, or a negative value if fn fails
+ */
+static double time_case(bench_fn_t fn, void* ctx, double min_ms) {
+    uint64_t iterations = 1;
+
+    if (fn(ctx) != ERR_NONE) {
+        return -1.0;
+    }
+
+    for (;;) {
+        double start = now_ns();
+        double elapsed;
+
+        for (uint64_t i = 0; i < iterations; i++) {
+            fn(ctx);
+        }
+        elapsed = now_ns() - start;
+
+        if (elapsed >= min_ms * 1e6 || iterations >= (1ULL << 40)) {
+            return elapsed / (double)iterations;
+        }
+        iterations *= 2;
+    }
+}
+
+/**
+ * report - Print one result row and return its ns per call
+ *
+ * Throughput is printed only for cases that copy the whole message.
+ */
+static double report(const char* name, const char* size, size_t message_bytes, bool copies,
+                     bench_fn_t fn, void* ctx, double min_ms, bool* failed) {
+    double ns = time_case(fn, ctx, min_ms);
+
+    if (ns < 0) {
+        printf("%-34s %-12s %12s  FAILED\n", name, size, "");
+        *failed = true;
+        return 0.0;
+    }
+    printf("%-34s %-12s %12zu %10.1f ns", name, size, message_bytes, ns);
+    if (copies && ns > 0) {
+        printf(" %9.0f MB/s", (double)message_bytes / ns * 1e3);
+    }
+    printf("\n");
+    return ns;
+}
+
+/**
+ * check_flat - Print whether a framing case stayed flat across image sizes
+ *
+ * @return true if slowest / fastest <= FRAMING_MAX_RATIO
+ */
+static bool check_flat(const char* name, const double* ns, int count) {
+    double lo = ns[0];
+    double hi = ns[0];
+
+    for (int i = 1; i < count; i++) {
+        lo = ns[i] < lo ? ns[i] : lo;
+        hi = ns[i] > hi ? ns[i] : hi;
+    }
+    printf("  %-32s slowest/fastest = %.2f  %s\n", name, lo > 0 ? hi / lo : 0.0,
+           lo > 0 && hi / lo <= FRAMING_MAX_RATIO ? "PASS" : "FAIL");
+    return lo > 0 && hi / lo <= FRAMING_MAX_RATIO;
+}
+
+int main(int argc, char* argv[]) {
+    static const uint32_t prompt_lengths[] = {1, 64, SD35_MAX_PROMPT_LENGTH};
+    static const uint32_t batch_sizes[] = {1, SD35_MAX_BATCH_SIZE};
+    /* v1 responses are capped at MAX_MESSAGE_SIZE; v2 heads take any size */
+    static const uint32_t v1_edges[] = {64, 256, 512, 1024, 1792};
+    static const uint32_t v2_edges[] = {64, 256, 512, 1024, 2048};
+    static const uint16_t error_lengths[] = {0, 64, 1024};
+    enum { V1_COUNT = sizeof(v1_edges) / sizeof(v1_edges[0]),
+           V2_COUNT = sizeof(v2_edges) / sizeof(v2_edges[0]) };
+    double prefix_ns[V1_COUNT];
+    double head_ns[V2_COUNT];
+    double min_ms = DEFAULT_MIN_MS;
+    decode_ctx_t* dec;
+    encode_ctx_t enc;
+    char size[32];
+    char error_msg[1024];
+    bool failed = false;
+    bool flat = true;
+
+    if (argc > 2 || (argc == 2 && (min_ms = atof(argv[1])) <= 0)) {
+        fprintf(stderr, "Usage: %s [min_ms_per_case]\n", argv[0]);
+        return 1;
+    }
+
+    dec = calloc(1, sizeof(*dec));
+    g_pixels = malloc((size_t)SD35_MAX_DIMENSION * SD35_MAX_DIMENSION * 3);
+    g_out = malloc(BENCH_BUFFER_SIZE);
+    if (dec == NULL || g_pixels == NULL || g_out == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(g_pixels, 0x80, (size_t)SD35_MAX_DIMENSION * SD35_MAX_DIMENSION * 3);
+    memset(error_msg, 'e', sizeof(error_msg));
+
+    printf("=== Weave Protocol Benchmark ===\n\n");
+    printf("%-34s %-12s %12s %13s\n", "Case", "Size", "Msg bytes", "Time/op");
+
+    /* Request decoding */
+    for (size_t i = 0; i < sizeof(prompt_lengths) / sizeof(prompt_lengths[0]); i++) {
+        dec->len = build_request(dec->message, 0, prompt_lengths[i]);
+        snprintf(size, sizeof(size), "prompt %u", prompt_lengths[i]);
+        if (i == 0) {
+            report("decode_header", "16", 16, false, run_decode_header, dec, min_ms, &failed);
+        }
+        report("decode_generate_request", size, dec->len, false, run_decode_request, dec, min_ms,
+               &failed);
+        report("decode_header + _payload", size, dec->len, false, run_decode_request_payload, dec,
+               min_ms, &failed);
+    }
+    for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+        dec->len = build_request(dec->message, batch_sizes[i], 64);
+        snprintf(size, sizeof(size), "seeds %u", batch_sizes[i]);
+        report("decode_generate_batch_request", size, dec->len, false, run_decode_batch, dec, min_ms,
+               &failed);
+    }
+    write_u32_be(dec->message, PROTOCOL_MAGIC);
+    write_u16_be(dec->message + 4, PROTOCOL_VERSION_1);
+    write_u16_be(dec->message + 6, MSG_CANCEL);
+    write_u32_be(dec->message + 8, 8);
+    write_u32_be(dec->message + 12, 0);
+    write_u64_be(dec->message + 16, 1);
+    dec->len = 24;
+    report("decode_cancel_request", "8", dec->len, false, run_decode_cancel, dec, min_ms, &failed);
+
+    /* Response framing and encoding */
+    memset(&enc, 0, sizeof(enc));
+    enc.out = g_out;
+    enc.resp.request_id = 1;
+    enc.resp.status = STATUS_OK;
+    enc.resp.channels = 3;
+    enc.resp.image_data = g_pixels;
+    enc.resp.image_format = IMAGE_FORMAT_RAW;
+
+    for (int i = 0; i < V1_COUNT; i++) {
+        enc.resp.image_width = v1_edges[i];
+        enc.resp.image_height = v1_edges[i];
+        enc.resp.image_data_len = v1_edges[i] * v1_edges[i] * 3;
+        snprintf(size, sizeof(size), "%ux%u", v1_edges[i], v1_edges[i]);
+        prefix_ns[i] = report("encode_generate_response_prefix", size,
+                              SD35_RESPONSE_PREFIX_SIZE + (size_t)enc.resp.image_data_len, false,
+                              run_encode_prefix, &enc, min_ms, &failed);
+    }
+    for (int i = 0; i < V2_COUNT; i++) {
+        enc.resp.image_width = v2_edges[i];
+        enc.resp.image_height = v2_edges[i];
+        enc.resp.image_data_len = v2_edges[i] * v2_edges[i] * 3;
+        snprintf(size, sizeof(size), "%ux%u", v2_edges[i], v2_edges[i]);
+        head_ns[i] = report("encode_generate_response_head", size,
+                            SD35_RESPONSE_HEAD_SIZE + (size_t)enc.resp.image_data_len, false,
+                            run_encode_head, &enc, min_ms, &failed);
+    }
+    for (int i = 0; i < V1_COUNT; i++) {
+        enc.resp.image_width = v1_edges[i];
+        enc.resp.image_height = v1_edges[i];
+        enc.resp.image_data_len = v1_edges[i] * v1_edges[i] * 3;
+        snprintf(size, sizeof(size), "%ux%u", v1_edges[i], v1_edges[i]);
+        report("encode_generate_response (copy)", size,
+               SD35_RESPONSE_PREFIX_SIZE + (size_t)enc.resp.image_data_len, true,
+               run_encode_full, &enc, min_ms, &failed);
+    }
+
+    enc.batch.request_id = 1;
+    enc.batch.status = STATUS_OK;
+    enc.batch.image_width = 512;
+    enc.batch.image_height = 512;
+    enc.batch.channels = 3;
+    enc.batch.image_count = SD35_MAX_BATCH_SIZE;
+    enc.batch.image_data_len = 512 * 512 * 3;
+    for (int i = 0; i < SD35_MAX_BATCH_SIZE; i++) {
+        enc.batch.images[i] = g_pixels;
+    }
+    report("encode_generate_batch_resp_prefix", "8x512x512",
+           SD35_BATCH_RESPONSE_PREFIX_SIZE + (size_t)SD35_MAX_BATCH_SIZE * 512 * 512 * 3, false,
+           run_encode_batch_prefix, &enc, min_ms, &failed);
+
+    enc.chunk_len = PROTOCOL_MAX_CHUNK_SIZE;
+    report("encode_chunk_header", "1 MB", 16 + (size_t)PROTOCOL_MAX_CHUNK_SIZE, false,
+           run_encode_chunk_header, &enc, min_ms, &failed);
+
+    enc.progress.request_id = 1;
+    enc.progress.step = 3;
+    enc.progress.total_steps = 28;
+    report("encode_generate_progress", "no preview", 16 + 32, false, run_encode_progress, &enc,
+           min_ms, &failed);
+
+    enc.error.request_id = 1;
+    enc.error.status = STATUS_BAD_REQUEST;
+    enc.error.error_code = ERR_INVALID_PROMPT;
+    enc.error.error_msg = error_msg;
+    for (size_t i = 0; i < sizeof(error_lengths) / sizeof(error_lengths[0]); i++) {
+        enc.error.error_msg_len = error_lengths[i];
+        snprintf(size, sizeof(size), "msg %u", (unsigned)error_lengths[i]);
+        report("encode_error_response", size, 16 + 18 + (size_t)error_lengths[i], false,
+               run_encode_error, &enc, min_ms, &failed);
+    }
+
+    printf("\n=== Framing Overhead vs Image Size ===\n\n");
+    flat = check_flat("v1 response prefix", prefix_ns, V1_COUNT) && flat;
+    flat = check_flat("v2 response head", head_ns, V2_COUNT) && flat;
+
+    printf("\n=== Overall Status ===\n\n");
+    printf("Encoders/decoders: %s\n", failed ? "FAIL" : "PASS");
+    printf("Framing overhead constant: %s\n", flat ? "PASS" : "FAIL");
+
+    free(dec);
+    free(g_pixels);
+    free(g_out);
+    return failed || !flat ? 1 : 0;
+}
@@ -0,0 +1,313 @@
+/**
+ * Stub SD Wrapper - sd_wrapper.h without stable-diffusion.cpp
+ *
+ * Linked into bench/weave-compute-stub in place of sd_wrapper.cpp, so the
+ * daemon's socket, protocol, queue, cache and encode paths can be measured
+ * without a GPU or model files. Generation returns a checkerboard (like
+ * test/test_stub_generator.c) after sleeping WEAVE_STUB_STEP_US
+ * microseconds per sampling step (default 0), reporting progress and
+ * polling the abort callback at every step like the real wrapper. With an
+ * init image only the steps img2img would sample are run.
+ *
+ * Model paths are not opened, resets do nothing, and there is no Vulkan
+ * device, so the VRAM planner keeps the configured placement.
+ */
+
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime and nanosleep */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weave/sd_wrapper.h"
+
+/** Checkerboard block edge in pixels */
+#define STUB_BLOCK_SIZE 8
+
+struct sd_wrapper_ctx {
+    sd_wrapper_progress_fn progress_fn;
+    void* progress_user_data;
+    sd_wrapper_abort_fn abort_fn;
+    void* abort_user_data;
+    sd_wrapper_timings_t timings;
+    bool has_generated;
+    char error[128];
+};
+
+static uint64_t stub_now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * stub_step_us - Simulated duration of one sampling step
+ */
+static uint64_t stub_step_us(void) {
+    const char* value = getenv("WEAVE_STUB_STEP_US");
+    char* end;
+    unsigned long long us;
+
+    if (value == NULL || value[0] == '\0') {
+        return 0;
+    }
+    us = strtoull(value, &end, 10);
+    return *end == '\0' ? (uint64_t)us : 0;
+}
+
+static void stub_sleep_us(uint64_t us) {
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(us / 1000000);
+    ts.tv_nsec = (long)(us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) != 0) {
+    }
+}
+
+void sd_wrapper_config_init(sd_wrapper_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->n_threads = -1;
+    config->keep_clip_on_cpu = true;
+    config->enable_flash_attn = true;
+    config->device_index = -1;
+    config->weight_type = SD_WRAPPER_WTYPE_F16;
+}
+
+void sd_wrapper_gen_params_init(sd_wrapper_gen_params_t* params) {
+    if (params == NULL) {
+        return;
+    }
+    memset(params, 0, sizeof(*params));
+    params->width = 1024;
+    params->height = 1024;
+    params->steps = 28;
+    params->cfg_scale = 4.5f;
+    params->vae_tiling = SD_WRAPPER_VAE_TILING_AUTO;
+    params->strength = 0.75f;
+}
+
+sd_wrapper_ctx_t* sd_wrapper_create(const sd_wrapper_config_t* config) {
+    if (config == NULL || config->model_path == NULL) {
+        return NULL;
+    }
+    return calloc(1, sizeof(sd_wrapper_ctx_t));
+}
+
+void sd_wrapper_free(sd_wrapper_ctx_t* ctx) {
+    free(ctx);
+}
+
+/**
+ * stub_sampled_steps - Steps the real wrapper samples (see sd_wrapper.cpp)
+ */
+static uint32_t stub_sampled_steps(const sd_wrapper_gen_params_t* params) {
+    uint32_t t_enc;
+
+    if (params->init_image == NULL) {
+        return params->steps;
+    }
+    t_enc = (uint32_t)((float)params->steps * params->strength);
+    if (t_enc >= params->steps) {
+        t_enc = params->steps - 1;
+    }
+    return t_enc + 1;
+}
+
+/**
+ * stub_run - Simulate one diffusion pass and produce its image
+ *
+ * @return SD_WRAPPER_OK, SD_WRAPPER_ERR_CANCELLED or SD_WRAPPER_ERR_OUT_OF_MEMORY
+ */
+static sd_wrapper_error_t stub_run(sd_wrapper_ctx_t* ctx, const sd_wrapper_gen_params_t* params,
+                                   sd_wrapper_image_t* image) {
+    uint64_t step_us = stub_step_us();
+    uint64_t start = stub_now_us();
+    size_t size = (size_t)params->width * params->height * 3;
+    uint32_t steps = stub_sampled_steps(params);
+
+    for (uint32_t step = 1; step <= steps; step++) {
+        uint64_t step_start = stub_now_us();
+        sd_wrapper_progress_t progress;
+
+        if (ctx->abort_fn != NULL && ctx->abort_fn(ctx->abort_user_data)) {
+            return SD_WRAPPER_ERR_CANCELLED;
+        }
+        stub_sleep_us(step_us);
+
+        if (ctx->timings.step_count < SD_WRAPPER_MAX_TIMED_STEPS) {
+            ctx->timings.step_us[ctx->timings.step_count++] =
+                (uint32_t)(stub_now_us() - step_start);
+        }
+        if (ctx->progress_fn != NULL) {
+            progress.step = step;
+            progress.total_steps = steps;
+            progress.preview = NULL;
+            ctx->progress_fn(&progress, ctx->progress_user_data);
+        }
+    }
+    ctx->timings.sampling_us += stub_now_us() - start;
+
+    start = stub_now_us();
+    image->data = malloc(size);
+    if (image->data == NULL) {
+        return SD_WRAPPER_ERR_OUT_OF_MEMORY;
+    }
+    for (uint32_t y = 0; y < params->height; y++) {
+        for (uint32_t x = 0; x < params->width; x++) {
+            uint8_t value = ((x / STUB_BLOCK_SIZE + y / STUB_BLOCK_SIZE) % 2) ? 0xFF : 0x00;
+            memset(image->data + ((size_t)y * params->width + x) * 3, value, 3);
+        }
+    }
+    image->width = params->width;
+    image->height = params->height;
+    image->channels = 3;
+    image->data_size = size;
+    ctx->timings.vae_decode_us += stub_now_us() - start;
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_generate_batch(sd_wrapper_ctx_t* ctx,
+                                              const sd_wrapper_gen_params_t* params,
+                                              const int64_t* seeds,
+                                              uint32_t count,
+                                              sd_wrapper_image_t* images) {
+    sd_wrapper_error_t err = SD_WRAPPER_OK;
+    uint32_t done = 0;
+
+    if (ctx == NULL || params == NULL || seeds == NULL || images == NULL ||
+        count == 0 || count > SD_WRAPPER_MAX_BATCH || params->prompt == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    memset(&ctx->timings, 0, sizeof(ctx->timings));
+    memset(images, 0, count * sizeof(images[0]));
+    ctx->has_generated = true;
+
+    while (done < count && err == SD_WRAPPER_OK) {
+        err = stub_run(ctx, params, &images[done]);
+        if (err == SD_WRAPPER_OK) {
+            done++;
+        }
+    }
+
+    if (err != SD_WRAPPER_OK) {
+        for (uint32_t i = 0; i < done; i++) {
+            sd_wrapper_free_image(&images[i]);
+        }
+        snprintf(ctx->error, sizeof(ctx->error), "stub generation stopped (%d)", (int)err);
+    }
+    return err;
+}
+
+sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
+                                        const sd_wrapper_gen_params_t* params,
+                                        sd_wrapper_image_t* image) {
+    int64_t seed;
+
+    if (params == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    seed = params->seed;
+    return sd_wrapper_generate_batch(ctx, params, &seed, 1, image);
+}
+
+void sd_wrapper_free_image(sd_wrapper_image_t* image) {
+    if (image == NULL) {
+        return;
+    }
+    free(image->data);
+    image->data = NULL;
+    image->data_size = 0;
+}
+
+const char* sd_wrapper_get_error(sd_wrapper_ctx_t* ctx) {
+    return ctx != NULL ? ctx->error : "null context";
+}
+
+sd_wrapper_error_t sd_wrapper_get_timings(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_timings_t* timings) {
+    if (ctx == NULL || timings == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    *timings = ctx->timings;
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_set_progress_callback(sd_wrapper_ctx_t* ctx,
+                                                     sd_wrapper_progress_fn fn,
+                                                     void* user_data,
+                                                     uint32_t preview_interval) {
+    (void)preview_interval;
+    if (ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    ctx->progress_fn = fn;
+    ctx->progress_user_data = user_data;
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_set_abort_callback(sd_wrapper_ctx_t* ctx,
+                                                  sd_wrapper_abort_fn fn,
+                                                  void* user_data) {
+    if (ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    ctx->abort_fn = fn;
+    ctx->abort_user_data = user_data;
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_get_device_memory(int device_index,
+                                                 size_t* free_bytes,
+                                                 size_t* total_bytes) {
+    (void)device_index;
+    if (free_bytes == NULL || total_bytes == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    return SD_WRAPPER_ERR_GPU_ERROR;
+}
+
+sd_wrapper_error_t sd_wrapper_set_pipeline_cache_dir(const char* dir) {
+    /* No Vulkan, so nothing reads the driver cache settings */
+    if (dir == NULL || dir[0] == '\0') {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_get_model_info(sd_wrapper_ctx_t* ctx,
+                                              char* model_name,
+                                              size_t buf_size) {
+    if (ctx == NULL || model_name == NULL || buf_size == 0) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    snprintf(model_name, buf_size, "stub");
+    return SD_WRAPPER_OK;
+}
+
+sd_wrapper_error_t sd_wrapper_reset(sd_wrapper_ctx_t* ctx) {
+    return sd_wrapper_reset_mode(ctx, SD_WRAPPER_RESET_FULL);
+}
+
+sd_wrapper_error_t sd_wrapper_reset_mode(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_reset_mode_t mode) {
+    (void)mode;
+    if (ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    return SD_WRAPPER_OK;
+}
+
+bool sd_wrapper_has_generated(const sd_wrapper_ctx_t* ctx) {
+    return ctx != NULL && ctx->has_generated;
+}
+
+uint64_t sd_wrapper_take_reset_time(sd_wrapper_ctx_t* ctx) {
+    (void)ctx;
+    return 0;
+}
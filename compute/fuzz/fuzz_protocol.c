@@ -1,7 +1,8 @@
 /**
  * Weave Protocol Fuzzer
  *
- * Fuzzing harness for decode_generate_request() using libFuzzer.
+ * Fuzzing harness for decode_generate_request() and
+ * decode_generate_batch_request() using libFuzzer.
  * Tests the decoder with random byte inputs to find crashes, hangs,
  * and undefined behavior.
  *
@@ -34,6 +35,9 @@ int main(void) {
     sd35_generate_request_t req;
     decode_generate_request(buffer, len, &req);
 
+    sd35_generate_batch_request_t batch_req;
+    decode_generate_batch_request(buffer, len, &batch_req);
+
     return 0;
 }
 
@@ -61,10 +65,13 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
         return 0;
     }
 
-    /* Fuzz the decoder - we don't care about the result */
+    /* Fuzz both decoders - we don't care about the result */
     sd35_generate_request_t req;
     (void)decode_generate_request(data, size, &req);
 
+    sd35_generate_batch_request_t batch_req;
+    (void)decode_generate_batch_request(data, size, &batch_req);
+
     /* Return 0 to continue fuzzing */
     return 0;
 }
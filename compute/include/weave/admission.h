@@ -0,0 +1,156 @@
+/**
+ * Weave Admission Module - Queue Wait Estimates and Admission Control
+ *
+ * Tracks the generation work waiting for a GPU per priority class and
+ * estimates how long a new request would wait, so weave-compute can answer
+ * ERR_BUSY at once instead of letting a request sit in the queue until its
+ * deadline passes.
+ *
+ * Cost model:
+ * A request's work is its pixel-steps, width * height * steps * images (the
+ * steps a refinement actually runs). GPU time per pixel-step is learned as
+ * a moving average of finished generations. Until the first one finishes
+ * nothing is known, estimates are 0 and every request is admitted.
+ *
+ * A request of class p waits for the queued work of classes 0 to p (the
+ * generate queue pops the most urgent class first) and, on average, half of
+ * the work already generating, spread over the GPU workers.
+ *
+ * Request lifecycle, one call per transition:
+ *   admission_enqueue()  passed to the GPU queue, or refused with ADMISSION_ERR_BUSY
+ *   admission_start()    picked up by a GPU worker
+ *   admission_finish()   generation returned
+ *
+ * Thread safety:
+ * - Every function may be called from any thread; one mutex guards the state
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "weave/protocol.h"
+
+/**
+ * Weight of a new sample in the GPU time moving average.
+ */
+#define ADMISSION_EWMA_WEIGHT 0.25
+
+/**
+ * Admission Error Codes
+ */
+typedef enum {
+    ADMISSION_OK = 0,                 /**< Success */
+    ADMISSION_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    ADMISSION_ERR_INVALID_ARG = -2,   /**< Worker count below 1 or unknown class */
+    ADMISSION_ERR_INIT_FAILED = -3,   /**< Failed to initialize the mutex */
+    ADMISSION_ERR_BUSY = -4,          /**< Estimated completion is past the budget */
+} admission_error_t;
+
+/**
+ * Admission state.
+ *
+ * Fields are private; embed or allocate the struct and use the functions
+ * below.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    int workers;                                   /* GPU workers sharing the queue */
+    double us_per_unit;                            /* GPU us per pixel-step (0 = unknown) */
+    uint32_t queued[SD35_PRIORITY_COUNT];          /* Requests waiting per class */
+    uint64_t queued_units[SD35_PRIORITY_COUNT];    /* Their pixel-steps */
+    uint64_t running_units;                        /* Pixel-steps generating */
+} admission_t;
+
+/**
+ * admission_init - Initialize with nothing queued and no GPU time known
+ *
+ * @param adm      Admission state to initialize
+ * @param workers  GPU workers popping the queue (at least 1)
+ * @return         ADMISSION_OK, ADMISSION_ERR_NULL_POINTER,
+ *                 ADMISSION_ERR_INVALID_ARG or ADMISSION_ERR_INIT_FAILED
+ */
+admission_error_t admission_init(admission_t *adm, int workers);
+
+/**
+ * admission_destroy - Release admission resources
+ *
+ * @param adm  Admission state to destroy (NULL safe)
+ */
+void admission_destroy(admission_t *adm);
+
+/**
+ * admission_request_units - Pixel-steps of a generation request
+ *
+ * A refinement runs steps * strength steps (at least 1).
+ *
+ * @param req     Decoded request (the base of a batch request)
+ * @param images  Images generated (1, or the batch's seed_count)
+ * @return        width * height * steps * images, 0 if req is NULL
+ */
+uint64_t admission_request_units(const sd35_generate_request_t *req, uint32_t images);
+
+/**
+ * admission_estimate_wait_us - Estimated wait of a request of a class read now
+ *
+ * @param adm       Admission state
+ * @param priority  sd35_priority_t of the request
+ * @return          Microseconds until a GPU would pick it up, 0 while GPU
+ *                  time is unknown or for a NULL adm or unknown class
+ */
+uint64_t admission_estimate_wait_us(admission_t *adm, uint32_t priority);
+
+/**
+ * admission_enqueue - Count a request as queued unless it cannot finish in time
+ *
+ * The request is refused if its estimated wait plus its own estimated GPU
+ * time exceeds budget_us. Check and count happen under one lock, so
+ * concurrent callers see each other's work.
+ *
+ * @param adm        Admission state
+ * @param priority   sd35_priority_t of the request
+ * @param units      From admission_request_units()
+ * @param budget_us  Time left until its deadline (0 = no deadline)
+ * @param wait_us    Output estimated wait (may be NULL)
+ * @return           ADMISSION_OK (counted as queued), ADMISSION_ERR_BUSY
+ *                   (not counted), ADMISSION_ERR_NULL_POINTER or
+ *                   ADMISSION_ERR_INVALID_ARG
+ */
+admission_error_t admission_enqueue(admission_t *adm, uint32_t priority, uint64_t units,
+                                    uint64_t budget_us, uint64_t *wait_us);
+
+/**
+ * admission_start - A queued request reached a GPU worker
+ *
+ * @param adm       Admission state (NULL safe)
+ * @param priority  Class it was queued with
+ * @param units     Units it was queued with
+ */
+void admission_start(admission_t *adm, uint32_t priority, uint64_t units);
+
+/**
+ * admission_finish - A started request's generation returned
+ *
+ * @param adm     Admission state (NULL safe)
+ * @param units   Units it was queued with
+ * @param gpu_us  GPU time it took, 0 if it failed or was aborted (no sample)
+ */
+void admission_finish(admission_t *adm, uint64_t units, uint64_t gpu_us);
+
+/**
+ * admission_snapshot - Queue depth and estimated wait of every class
+ *
+ * @param adm      Admission state (NULL leaves the outputs zeroed)
+ * @param depth    Output requests queued per class (SD35_PRIORITY_COUNT entries)
+ * @param wait_ms  Output estimated wait per class (SD35_PRIORITY_COUNT entries)
+ */
+void admission_snapshot(admission_t *adm, uint32_t *depth, uint32_t *wait_ms);
+
+/**
+ * admission_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *admission_error_string(admission_error_t err);
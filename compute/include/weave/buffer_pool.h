@@ -0,0 +1,151 @@
+/**
+ * Weave Buffer Pool Module - Recycled Request and Response Buffers
+ *
+ * Every request needs a buffer for its message and, with PROTOCOL_FLAG_PNG,
+ * one for the encoded file. Image-sized allocations are served by mmap() and
+ * returned with munmap(), so each request pays for fresh mappings and a page
+ * fault per page on first touch. The pool keeps released buffers and hands
+ * them out again, so a warm daemon reuses memory that is already mapped.
+ *
+ * Size classes:
+ * Requests are rounded up to a power of two from BUFFER_POOL_MIN_CLASS to
+ * BUFFER_POOL_MAX_CLASS, and each class keeps its own free list, newest
+ * first. Larger requests are allocated and freed without the pool. Rounding
+ * wastes address space, not memory: pages past the bytes a caller touches
+ * are never faulted in.
+ *
+ * Options:
+ * - Hugepages: classes of BUFFER_POOL_HUGEPAGE_SIZE and up are aligned to it
+ *   and advised with MADV_HUGEPAGE, so a 16 MiB buffer is eight TLB entries
+ *   instead of 4096. Only a hint; the kernel may decline.
+ * - Lock: buffers are mlock()ed when first allocated, which also faults them
+ *   in, so recycled buffers never page fault or swap. Limited by
+ *   RLIMIT_MEMLOCK; buffers the kernel refuses to lock are still used and
+ *   counted in lock_failures.
+ *
+ * Ownership model:
+ * - buffer_pool_get() returns a page-aligned buffer owned by the caller
+ * - The caller gives it back with buffer_pool_put() and the same size
+ * - A NULL pool allocates with malloc() and releases with free(), so callers
+ *   need no separate path when pooling is disabled
+ *
+ * Thread safety:
+ * - Every function may be called from any thread; one mutex guards the
+ *   free lists
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Smallest size class (one page) */
+#define BUFFER_POOL_MIN_CLASS ((size_t)4096)
+
+/** Largest size class; bigger buffers bypass the pool */
+#define BUFFER_POOL_MAX_CLASS ((size_t)64 * 1024 * 1024)
+
+/** Transparent hugepage size classes are aligned to when hugepages is set */
+#define BUFFER_POOL_HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/**
+ * Buffer Pool Error Codes
+ */
+typedef enum {
+    BUFFER_POOL_OK = 0,                  /**< Success */
+    BUFFER_POOL_ERR_NULL_POINTER = -1,   /**< NULL pointer argument */
+    BUFFER_POOL_ERR_OUT_OF_MEMORY = -2,  /**< Memory allocation failed */
+    BUFFER_POOL_ERR_INIT_FAILED = -3,    /**< Failed to initialize the mutex */
+} buffer_pool_error_t;
+
+/**
+ * Opaque pool handle
+ */
+typedef struct buffer_pool buffer_pool_t;
+
+/**
+ * Pool configuration
+ */
+typedef struct {
+    size_t max_idle_bytes;  /**< Released bytes kept for reuse; beyond this they are freed */
+    bool hugepages;         /**< Back large classes with transparent hugepages */
+    bool lock;              /**< mlock() buffers so they stay resident */
+} buffer_pool_config_t;
+
+/**
+ * Pool statistics
+ */
+typedef struct {
+    uint64_t hits;            /* Gets served from a free list */
+    uint64_t misses;          /* Gets that allocated */
+    uint64_t drops;           /* Puts freed instead of kept (pool full or oversized) */
+    uint64_t lock_failures;   /* Buffers mlock() refused */
+    size_t idle_bytes;        /* Bytes on the free lists */
+    uint32_t idle_buffers;    /* Buffers on the free lists */
+} buffer_pool_stats_t;
+
+/**
+ * buffer_pool_create - Create an empty pool
+ *
+ * @param config  Pool configuration (copied)
+ * @param pool    Output: pool handle
+ * @return        BUFFER_POOL_OK on success, error code on failure
+ */
+buffer_pool_error_t buffer_pool_create(const buffer_pool_config_t *config, buffer_pool_t **pool);
+
+/**
+ * buffer_pool_destroy - Free every idle buffer and the pool
+ *
+ * Buffers still held by callers must not be put back afterwards.
+ *
+ * @param pool  Pool to destroy (NULL safe)
+ */
+void buffer_pool_destroy(buffer_pool_t *pool);
+
+/**
+ * buffer_pool_get - Get a buffer of at least size bytes
+ *
+ * Contents are undefined: a recycled buffer holds whatever was last
+ * written to it.
+ *
+ * @param pool  Pool to take from, or NULL for a plain malloc()
+ * @param size  Bytes needed
+ * @return      Page-aligned buffer (malloc() alignment for a NULL pool), or
+ *              NULL if out of memory
+ */
+void *buffer_pool_get(buffer_pool_t *pool, size_t size);
+
+/**
+ * buffer_pool_put - Give a buffer back for reuse
+ *
+ * @param pool  Pool it came from, or NULL if it came from a NULL pool
+ * @param buf   Buffer from buffer_pool_get() (NULL safe)
+ * @param size  Size passed to buffer_pool_get() for it
+ */
+void buffer_pool_put(buffer_pool_t *pool, void *buf, size_t size);
+
+/**
+ * buffer_pool_get_stats - Read the pool counters
+ *
+ * @param pool   Pool to query
+ * @param stats  Output statistics
+ * @return       BUFFER_POOL_OK on success, error code on failure
+ */
+buffer_pool_error_t buffer_pool_get_stats(buffer_pool_t *pool, buffer_pool_stats_t *stats);
+
+/**
+ * buffer_pool_class_size - Size class a request is rounded up to
+ *
+ * @param size  Bytes needed
+ * @return      Class size in bytes, or 0 if size is above BUFFER_POOL_MAX_CLASS
+ */
+size_t buffer_pool_class_size(size_t size);
+
+/**
+ * buffer_pool_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *buffer_pool_error_string(buffer_pool_error_t err);
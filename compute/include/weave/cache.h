@@ -0,0 +1,228 @@
+/**
+ * Weave Cache Module - Content-Addressed Result Cache
+ *
+ * With a fixed seed (1 to INT64_MAX), the decoded generation parameters and
+ * prompts fully determine the output image. This cache keeps generated pixels keyed by
+ * those inputs so an identical request (session recovery, UI re-renders)
+ * can be answered without touching the GPU.
+ *
+ * Tiers:
+ * - Memory: LRU list bounded by total pixel bytes
+ * - Disk (optional): one file per image in a private directory, normally
+ *   $XDG_RUNTIME_DIR/weave/cache, read back with mmap() and bounded by total
+ *   file bytes. It survives a weave-compute restart. Memory misses fall
+ *   through to it, and disk hits are promoted to memory.
+ *
+ * Keys:
+ * The key is the canonical byte string of model_id, width, height, steps,
+ * cfg_scale, seed, the three prompts and a fingerprint from the caller.
+ * request_id is not part of it. The fingerprint covers what the request
+ * does not: which files model_id is loaded from and the settings that
+ * change the pixels, so a disk entry written under an older --models
+ * setup is a miss rather than a stale hit. A
+ * 64-bit FNV-1a hash of the key speeds up lookup and names disk files, and
+ * the full key is compared on every hit, so a hash collision is a miss.
+ * Requests with an init image depend on its pixels and are not cacheable.
+ *
+ * Retained results:
+ * result_cache_retain() and result_cache_recall() key an image by the
+ * request_id and image index that returned it instead, so a later request
+ * can name it as its init image (SD35_INIT_RETAINED). Request IDs are only
+ * unique per client, so the key also holds an owner, the connection the
+ * response was sent on: a client can only recall its own results, and
+ * result_cache_forget() drops them when it disconnects. weave-compute keeps
+ * them in a cache of their own, so refinement sources are not evicted by
+ * ordinary cache traffic.
+ *
+ * Ownership model:
+ * - Stored pixels are copied into the cache
+ * - Looked-up pixels are copied into a malloc() buffer owned by the caller,
+ *   compatible with free_generate_response()
+ *
+ * Thread safety:
+ * - NOT thread-safe. Use from the generating thread only, like the SD
+ *   wrapper context.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "weave/protocol.h"
+
+/**
+ * Directory under $XDG_RUNTIME_DIR/weave for the disk tier
+ */
+#define RESULT_CACHE_DIR_NAME "cache"
+
+/**
+ * Cache Error Codes
+ */
+typedef enum {
+    CACHE_OK = 0,                     /**< Success */
+    CACHE_ERR_NULL_POINTER = -1,      /**< NULL pointer argument */
+    CACHE_ERR_OUT_OF_MEMORY = -2,     /**< Memory allocation failed */
+    CACHE_ERR_NOT_FOUND = -3,         /**< No entry for this request */
+    CACHE_ERR_NOT_CACHEABLE = -4,     /**< Random seed (0 or > INT64_MAX) or image too large */
+    CACHE_ERR_IO = -5,                /**< Disk tier I/O failed */
+} cache_error_t;
+
+/**
+ * Opaque cache handle
+ */
+typedef struct result_cache result_cache_t;
+
+/**
+ * Cache configuration
+ */
+typedef struct {
+    size_t memory_max_bytes;  /**< Memory tier budget in pixel bytes (0 = no memory tier) */
+    size_t disk_max_bytes;    /**< Disk tier budget in file bytes (0 = no disk tier) */
+    const char *disk_dir;     /**< Disk tier directory (created 0700 if missing) */
+} result_cache_config_t;
+
+/**
+ * A cached image
+ */
+typedef struct {
+    uint32_t width;      /**< Image width in pixels */
+    uint32_t height;     /**< Image height in pixels */
+    uint32_t channels;   /**< Number of channels (3 = RGB, 4 = RGBA) */
+    size_t data_size;    /**< Size of data in bytes */
+    uint8_t *data;       /**< Raw pixels (owned by the caller after lookup) */
+} result_cache_image_t;
+
+/**
+ * Cache statistics
+ */
+typedef struct {
+    uint64_t hits;            /* Lookups answered from memory */
+    uint64_t disk_hits;       /* Lookups answered from disk */
+    uint64_t misses;          /* Cacheable lookups with no entry */
+    uint64_t evictions;       /* Memory entries dropped to stay within budget */
+    size_t memory_bytes;      /* Pixel bytes held in memory */
+    size_t disk_bytes;        /* File bytes held on disk */
+} result_cache_stats_t;
+
+/**
+ * result_cache_create - Create a cache
+ *
+ * Existing files in disk_dir are indexed, oldest first, so a restarted
+ * daemon keeps serving earlier results.
+ *
+ * @param config  Cache configuration (copied)
+ * @return        Cache handle, or NULL if both tiers are disabled or on failure
+ */
+result_cache_t *result_cache_create(const result_cache_config_t *config);
+
+/**
+ * result_cache_destroy - Free the memory tier and the handle
+ *
+ * Disk tier files are kept.
+ *
+ * @param cache  Cache to destroy (NULL safe)
+ */
+void result_cache_destroy(result_cache_t *cache);
+
+/**
+ * result_cache_lookup - Find the image generated for a request and seed
+ *
+ * @param cache        Cache to search
+ * @param req          Decoded request (request_id and req->seed are ignored)
+ * @param seed         Seed the image was generated with
+ * @param fingerprint  Model files and settings it is generated with (NULL = none)
+ * @param image        Output image (populated on CACHE_OK)
+ * @return             CACHE_OK on a hit, CACHE_ERR_NOT_FOUND on a miss,
+ *                     CACHE_ERR_NOT_CACHEABLE for a random seed (0, or above
+ *                     INT64_MAX, which stable-diffusion.cpp randomizes) or an
+ *                     init image, or
+ *                     another error code
+ *
+ * @note On CACHE_OK, image->data must be released with free()
+ */
+cache_error_t result_cache_lookup(result_cache_t *cache, const sd35_generate_request_t *req,
+                                  uint64_t seed, const char *fingerprint,
+                                  result_cache_image_t *image);
+
+/**
+ * result_cache_store - Remember the image generated for a request and seed
+ *
+ * Replaces any existing entry for the same key and evicts least recently
+ * used entries to stay within budget. A disk write failure is reported but
+ * the memory tier entry is kept.
+ *
+ * @param cache        Cache to store into
+ * @param req          Decoded request (request_id and req->seed are ignored)
+ * @param seed         Seed the image was generated with
+ * @param fingerprint  Model files and settings it was generated with (NULL = none)
+ * @param image        Image to store (pixels are copied, not taken)
+ * @return             CACHE_OK on success, CACHE_ERR_NOT_CACHEABLE for a random
+ *                     seed (as for result_cache_lookup()), an init image or an
+ *                     image larger than both budgets, or
+ *                     another error code
+ */
+cache_error_t result_cache_store(result_cache_t *cache, const sd35_generate_request_t *req,
+                                 uint64_t seed, const char *fingerprint,
+                                 const result_cache_image_t *image);
+
+/**
+ * result_cache_retain - Keep an image under the request that returned it
+ *
+ * Replaces any image already kept for the same owner, request_id and index.
+ *
+ * @param cache       Cache to store into
+ * @param owner       Connection the response was sent on
+ * @param request_id  request_id of the response the image was sent in
+ * @param index       Image index in that response (0 for a single response)
+ * @param image       Image to keep (pixels are copied, not taken)
+ * @return            CACHE_OK on success, CACHE_ERR_NOT_CACHEABLE for an image
+ *                    larger than both budgets, or another error code
+ */
+cache_error_t result_cache_retain(result_cache_t *cache, uint64_t owner, uint64_t request_id,
+                                  uint32_t index, const result_cache_image_t *image);
+
+/**
+ * result_cache_recall - Find an image kept by result_cache_retain()
+ *
+ * @param cache       Cache to search
+ * @param owner       Connection asking; another owner's images are not found
+ * @param request_id  request_id the image was returned for
+ * @param index       Image index in that response
+ * @param image       Output image (populated on CACHE_OK)
+ * @return            CACHE_OK on a hit, CACHE_ERR_NOT_FOUND if it was never
+ *                    kept for owner or has been evicted, or another error code
+ *
+ * @note On CACHE_OK, image->data must be released with free()
+ */
+cache_error_t result_cache_recall(result_cache_t *cache, uint64_t owner, uint64_t request_id,
+                                  uint32_t index, result_cache_image_t *image);
+
+/**
+ * result_cache_forget - Drop every image kept for an owner
+ *
+ * Only the memory tier is searched; retained images on a disk tier are left
+ * to eviction (they still cannot be recalled by another owner).
+ *
+ * @param cache  Cache to drop from (NULL safe)
+ * @param owner  Owner passed to result_cache_retain()
+ * @return       Number of images dropped
+ */
+size_t result_cache_forget(result_cache_t *cache, uint64_t owner);
+
+/**
+ * result_cache_get_stats - Get hit/miss counters and tier usage
+ *
+ * @param cache  Cache to query
+ * @param stats  Output statistics
+ * @return       CACHE_OK on success, CACHE_ERR_NULL_POINTER
+ */
+cache_error_t result_cache_get_stats(const result_cache_t *cache, result_cache_stats_t *stats);
+
+/**
+ * cache_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *cache_error_string(cache_error_t err);
@@ -0,0 +1,189 @@
+/**
+ * Weave Connection Module - Client Connection State Shared by Pipeline Stages
+ *
+ * One connection per client socket feeding the request pipeline. Client
+ * mode has one, for the socket connected to weave; server mode has one per
+ * accepted client.
+ *
+ * Lifetime:
+ * - The reader holds the reference connection_create() returns, and every
+ *   request queued from the connection takes another (connection_ref())
+ * - The last connection_unref() calls on_release with the owner, closes an
+ *   owned socket and frees the connection, so no stage ever writes to a
+ *   descriptor number a newer client has been given
+ *
+ * Writes:
+ * - Progress frames come from the GPU workers while replies come from the
+ *   writer, so every write goes through connection_send(), which serializes
+ *   them
+ * - The first failed send marks the connection broken and shuts the socket
+ *   down, which ends the reader's read; later sends are skipped
+ *
+ * Cancellation:
+ * - A request is tracked from when it is read until it has been generated
+ *   (connection_track() to connection_untrack())
+ * - MSG_CANCEL flags a tracked request (connection_cancel()), and the
+ *   worker generating it polls connection_is_cancelled()
+ *
+ * Thread safety:
+ * - Every function may be called from any thread
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Connection Error Codes
+ */
+typedef enum {
+    CONNECTION_OK = 0,                  /**< Success */
+    CONNECTION_ERR_NULL_POINTER = -1,   /**< NULL pointer argument */
+    CONNECTION_ERR_INVALID_ARG = -2,    /**< Negative descriptor or no in-flight slots */
+    CONNECTION_ERR_OUT_OF_MEMORY = -3,  /**< Failed to allocate the connection */
+    CONNECTION_ERR_INIT_FAILED = -4,    /**< Failed to initialize a mutex */
+    CONNECTION_ERR_BROKEN = -5,         /**< A send failed on the connection */
+    CONNECTION_ERR_FULL = -6,           /**< Every in-flight slot is taken */
+    CONNECTION_ERR_NOT_FOUND = -7,      /**< Request is not in flight */
+} connection_error_t;
+
+/**
+ * Opaque connection handle.
+ */
+typedef struct connection connection_t;
+
+/**
+ * Called once, with the connection's owner, when the last reference is
+ * dropped (before an owned socket is closed).
+ */
+typedef void (*connection_release_fn)(uint64_t owner, void *user_data);
+
+/**
+ * Writes to the connection's socket under its write lock.
+ *
+ * @return  0 on success, non-zero if the socket can no longer be written
+ */
+typedef int (*connection_send_fn)(int client_fd, void *arg);
+
+/**
+ * Connection configuration.
+ */
+typedef struct {
+    int client_fd;                     /**< Connected, authenticated client socket */
+    int owns_fd;                       /**< Close client_fd with the last reference */
+    uint64_t owner;                    /**< Retained result owner of the connection */
+    size_t max_inflight;               /**< Requests that can be tracked at once (at least 1) */
+    connection_release_fn on_release;  /**< Called with owner on the last unref (may be NULL) */
+    void *user_data;                   /**< Passed to on_release */
+} connection_config_t;
+
+/**
+ * connection_create - Set up the state for one client connection
+ *
+ * @param config  Connection configuration
+ * @param conn    Output connection holding the reader's reference
+ * @return        CONNECTION_OK, CONNECTION_ERR_NULL_POINTER,
+ *                CONNECTION_ERR_INVALID_ARG, CONNECTION_ERR_OUT_OF_MEMORY or
+ *                CONNECTION_ERR_INIT_FAILED
+ */
+connection_error_t connection_create(const connection_config_t *config, connection_t **conn);
+
+/**
+ * connection_ref - Take a reference for a request entering the pipeline
+ *
+ * @param conn  Connection (NULL safe)
+ */
+void connection_ref(connection_t *conn);
+
+/**
+ * connection_unref - Drop a reference, releasing the connection with the last
+ *
+ * @param conn  Connection (NULL safe)
+ */
+void connection_unref(connection_t *conn);
+
+/**
+ * connection_fd - Client socket of a connection
+ *
+ * @param conn  Connection
+ * @return      client_fd from the configuration, -1 if conn is NULL
+ */
+int connection_fd(const connection_t *conn);
+
+/**
+ * connection_owner - Retained result owner of a connection
+ *
+ * @param conn  Connection
+ * @return      owner from the configuration, 0 if conn is NULL
+ */
+uint64_t connection_owner(const connection_t *conn);
+
+/**
+ * connection_send - Write to the connection, serialized with every other send
+ *
+ * Calls send with the client socket under the write lock unless the
+ * connection is already broken. If send fails, the connection is marked
+ * broken and the socket shut down in both directions.
+ *
+ * @param conn  Connection
+ * @param send  Function doing the writes
+ * @param arg   Passed to send
+ * @return      CONNECTION_OK if send succeeded, CONNECTION_ERR_BROKEN if it
+ *              failed or was skipped, or CONNECTION_ERR_NULL_POINTER
+ */
+connection_error_t connection_send(connection_t *conn, connection_send_fn send, void *arg);
+
+/**
+ * connection_is_broken - Whether a send has failed on the connection
+ *
+ * @param conn  Connection
+ * @return      1 if broken (or conn is NULL), 0 otherwise
+ */
+int connection_is_broken(connection_t *conn);
+
+/**
+ * connection_track - Make a request reachable by MSG_CANCEL
+ *
+ * @param conn        Connection the request came on
+ * @param request_id  Request ID
+ * @return            CONNECTION_OK, CONNECTION_ERR_FULL (not tracked) or
+ *                    CONNECTION_ERR_NULL_POINTER
+ */
+connection_error_t connection_track(connection_t *conn, uint64_t request_id);
+
+/**
+ * connection_untrack - Forget a request once it has been generated
+ *
+ * @param conn        Connection the request came on (NULL safe)
+ * @param request_id  Request ID passed to connection_track()
+ */
+void connection_untrack(connection_t *conn, uint64_t request_id);
+
+/**
+ * connection_cancel - Mark a queued or generating request as cancelled
+ *
+ * @param conn        Connection the request came on
+ * @param request_id  Request ID from MSG_CANCEL
+ * @return            CONNECTION_OK, CONNECTION_ERR_NOT_FOUND if it already
+ *                    finished (or was never tracked), or
+ *                    CONNECTION_ERR_NULL_POINTER
+ */
+connection_error_t connection_cancel(connection_t *conn, uint64_t request_id);
+
+/**
+ * connection_is_cancelled - Check whether MSG_CANCEL arrived for a request
+ *
+ * @param conn        Connection the request came on
+ * @param request_id  Request ID
+ * @return            1 if cancelled, 0 otherwise (or conn is NULL)
+ */
+int connection_is_cancelled(connection_t *conn, uint64_t request_id);
+
+/**
+ * connection_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *connection_error_string(connection_error_t err);
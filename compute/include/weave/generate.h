@@ -33,6 +33,7 @@
  * - Invalid prompt → STATUS_BAD_REQUEST (400)
  * - Model not loaded → STATUS_INTERNAL_SERVER_ERROR (500)
  * - GPU/OOM errors → STATUS_INTERNAL_SERVER_ERROR (500)
+ * - Aborted by the abort callback → ERR_CANCELLED, STATUS_BAD_REQUEST (400)
  *
  * @param ctx   SD wrapper context (must not be NULL, must be initialized)
  * @param req   Decoded protocol request (borrowed, not modified)
@@ -57,3 +58,57 @@ error_code_t process_generate_request(sd_wrapper_ctx_t *ctx,
  * @param resp  Response structure (image_data will be freed and set to NULL)
  */
 void free_generate_response(sd35_generate_response_t *resp);
+
+/**
+ * Get the SD context ready for a generation announced by MSG_PREPARE.
+ *
+ * Runs the context reset the next process_generate_request() or
+ * process_generate_batch_request() would otherwise start with, so a slow
+ * full reset (after a failed generation) happens before that request
+ * arrives. Text encoding is not done ahead: stable-diffusion.cpp encodes
+ * prompts inside generation and takes no precomputed conditioning.
+ *
+ * The reset time is taken from ctx and returned in *reset_us, so the next
+ * request's reset stage does not report time spent before it arrived.
+ *
+ * @param ctx       SD wrapper context (must not be NULL, must be initialized)
+ * @param req       Decoded prepare request (borrowed, not modified)
+ * @param reset_us  Output reset time in microseconds (may be NULL)
+ * @return          ERR_NONE on success, ERR_INTERNAL if the reset failed
+ *
+ * @note This function is NOT thread-safe (ctx is single-threaded)
+ */
+error_code_t process_prepare_request(sd_wrapper_ctx_t *ctx, const sd35_prepare_request_t *req,
+                                     uint64_t *reset_us);
+
+
+/**
+ * Process a batch generation request and produce a batch response.
+ *
+ * Renders one image per seed with a single context preparation, sharing the
+ * prompt and parameters across the batch. Error mapping matches
+ * process_generate_request(), plus ERR_INVALID_SEED_COUNT for an out-of-range
+ * seed count.
+ *
+ * @param ctx   SD wrapper context (must not be NULL, must be initialized)
+ * @param req   Decoded protocol batch request (borrowed, not modified)
+ * @param resp  Output batch response structure (populated on success)
+ * @return      ERR_NONE on success, error code on failure
+ *
+ * @note On success, resp->images[] are allocated and must be freed by caller
+ *       with free_generate_batch_response()
+ * @note On failure, resp is unchanged (no cleanup needed)
+ * @note This function is NOT thread-safe (ctx is single-threaded)
+ */
+error_code_t process_generate_batch_request(sd_wrapper_ctx_t *ctx,
+                                             const sd35_generate_batch_request_t *req,
+                                             sd35_generate_batch_response_t *resp);
+
+/**
+ * Free response image data allocated by process_generate_batch_request().
+ *
+ * Safe to call with NULL or already-freed image data.
+ *
+ * @param resp  Batch response structure (images will be freed and set to NULL)
+ */
+void free_generate_batch_response(sd35_generate_batch_response_t *resp);
@@ -0,0 +1,91 @@
+/**
+ * Weave Image Encode Module - Compressed Response Encoding
+ *
+ * Turns the raw RGB/RGBA pixels stable-diffusion.cpp produces into a PNG
+ * file, so the backend can store the bytes as-is instead of encoding them
+ * on its request goroutine, and so the socket carries the compressed frame.
+ *
+ * Encoding uses libpng's simplified write API with PNG_IMAGE_FLAG_FAST:
+ * cheap row filtering and a low zlib level, trading a little size for a
+ * lot of CPU time.
+ *
+ * Ownership model:
+ * - Input pixels are only read
+ * - image_encode_png() returns a malloc() buffer owned by the caller,
+ *   compatible with free_generate_response()
+ * - image_encode_png_to() writes into a caller buffer of at least
+ *   image_encode_png_bound() bytes, such as one from the buffer pool
+ *
+ * Thread safety:
+ * - Reentrant. main.c calls it from the pipeline writer stage, so it
+ *   overlaps with the GPU worker generating the next request.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Image Encode Error Codes
+ */
+typedef enum {
+    IMAGE_ENCODE_OK = 0,                  /**< Success */
+    IMAGE_ENCODE_ERR_NULL_POINTER = -1,   /**< NULL pointer argument */
+    IMAGE_ENCODE_ERR_INVALID_PARAMS = -2, /**< Zero dimensions or channels not 3 or 4 */
+    IMAGE_ENCODE_ERR_OUT_OF_MEMORY = -3,  /**< Output buffer allocation failed */
+    IMAGE_ENCODE_ERR_ENCODE_FAILED = -4,  /**< libpng reported an error */
+    IMAGE_ENCODE_ERR_BUFFER_TOO_SMALL = -5, /**< Output buffer below image_encode_png_bound() */
+} image_encode_error_t;
+
+/**
+ * image_encode_png - Encode raw pixels as a PNG file
+ *
+ * @param pixels    Tightly packed rows, width * height * channels bytes
+ * @param width     Image width in pixels
+ * @param height    Image height in pixels
+ * @param channels  3 (RGB) or 4 (RGBA)
+ * @param out       Output: PNG file (malloc()ed, caller frees)
+ * @param out_len   Output: size of *out in bytes
+ * @return          IMAGE_ENCODE_OK on success, error code on failure
+ *
+ * @note On failure *out is NULL and *out_len is 0
+ */
+image_encode_error_t image_encode_png(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                      uint32_t channels, uint8_t **out, size_t *out_len);
+
+/**
+ * image_encode_png_bound - Largest PNG file an image can encode to
+ *
+ * @param width     Image width in pixels
+ * @param height    Image height in pixels
+ * @param channels  3 (RGB) or 4 (RGBA)
+ * @return          Bound in bytes, or 0 if the parameters are invalid
+ */
+size_t image_encode_png_bound(uint32_t width, uint32_t height, uint32_t channels);
+
+/**
+ * image_encode_png_to - Encode raw pixels as a PNG file into a caller buffer
+ *
+ * @param pixels    Tightly packed rows, width * height * channels bytes
+ * @param width     Image width in pixels
+ * @param height    Image height in pixels
+ * @param channels  3 (RGB) or 4 (RGBA)
+ * @param out       Output buffer
+ * @param capacity  Size of out, at least image_encode_png_bound() bytes
+ * @param out_len   Output: bytes of out used by the PNG file
+ * @return          IMAGE_ENCODE_OK on success, error code on failure
+ *
+ * @note On failure *out_len is 0 and the contents of out are undefined
+ */
+image_encode_error_t image_encode_png_to(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                         uint32_t channels, uint8_t *out, size_t capacity,
+                                         size_t *out_len);
+
+/**
+ * image_encode_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *image_encode_error_string(image_encode_error_t err);
@@ -0,0 +1,278 @@
+/**
+ * Weave Model Registry - Lazily Loaded Models Under a VRAM Budget
+ *
+ * Maps protocol model_id values to model files and SD wrapper options so one
+ * weave-compute can serve several SD 3.5 family models (for example Medium,
+ * a distilled turbo variant and Large) over the same socket.
+ *
+ * Loading:
+ * - Pinned models are loaded by model_registry_load_pinned() at startup and
+ *   are never evicted, so the hot model never pays load latency
+ * - Other models are loaded on first use by model_registry_acquire()
+ * - Before a load, least recently used unpinned models are unloaded until
+ *   the new model fits the VRAM budget
+ *
+ * The registry knows nothing about stable-diffusion.cpp. Models are loaded
+ * and unloaded through a model_loader_t, and a loaded model is an opaque
+ * handle (an sd_wrapper_ctx_t in weave-compute).
+ *
+ * Config file format (see model_registry_parse()):
+ *
+ *   # Lines starting with '#' are comments
+ *   [model 0]
+ *   name = sd3.5-medium
+ *   model = ./config/models/sd3.5_medium.safetensors
+ *   clip_l = ./config/models/clip_l.safetensors
+ *   clip_g = ./config/models/clip_g.safetensors
+ *   t5xxl = ./config/models/t5xxl_fp8_e4m3fn.safetensors
+ *   pinned = true
+ *
+ * Each [model ID] section takes: name, model (required), clip_l, clip_g,
+ * t5xxl, t5, clip_only, vae, vram_mb, pinned, keep_clip_on_cpu,
+ * keep_vae_on_cpu, flash_attn and step_cache. Booleans are true/false.
+ * Without vram_mb, a model's VRAM use is estimated from the sizes of its
+ * files that live on the GPU. step_cache is the model's step caching
+ * threshold, 0 (off, the default) to 1.0; see sd_wrapper_step_cache_t.
+ *
+ * CLIP-only conditioning:
+ * T5-XXL is the largest text encoder by far, in host RAM and in encode time,
+ * and short chat prompts condition well on CLIP-L/G alone. "t5 = false"
+ * loads no T5-XXL; its part of the conditioning is zeros. "clip_only = ID"
+ * names a CLIP-only model (usually the same files with t5 = false) that
+ * serves this model's PROTOCOL_FLAG_CLIP_ONLY requests. A model with T5-XXL
+ * and no clip_only cannot serve them (see model_config_clip_only_model()).
+ *
+ * Thread safety:
+ * - NOT thread-safe. weave-compute keeps one registry per device, used only
+ *   by the thread generating on that device.
+ * - model_registry_find() only reads the configuration, which never changes
+ *   after model_registry_create(), and may be called from any thread.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum models in one registry */
+#define MODEL_REGISTRY_MAX_MODELS 16
+
+/** Maximum model name length, including the NUL terminator */
+#define MODEL_REGISTRY_NAME_MAX 64
+
+/** Maximum file path length, including the NUL terminator */
+#define MODEL_REGISTRY_PATH_MAX 1024
+
+/** model_config_t.clip_only_model when no CLIP-only model is configured */
+#define MODEL_REGISTRY_NO_MODEL UINT32_MAX
+
+/**
+ * Model Registry Error Codes
+ */
+typedef enum {
+    MODEL_REGISTRY_OK = 0,                 /**< Success */
+    MODEL_REGISTRY_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    MODEL_REGISTRY_ERR_OUT_OF_MEMORY = -2, /**< Memory allocation failed */
+    MODEL_REGISTRY_ERR_NOT_FOUND = -3,     /**< model_id is not configured */
+    MODEL_REGISTRY_ERR_NO_VRAM = -4,       /**< Model does not fit even after eviction */
+    MODEL_REGISTRY_ERR_LOAD_FAILED = -5,   /**< Loader returned NULL */
+    MODEL_REGISTRY_ERR_IO = -6,            /**< Config file could not be read */
+    MODEL_REGISTRY_ERR_PARSE = -7,         /**< Config file is malformed */
+} model_registry_error_t;
+
+/**
+ * One configured model
+ *
+ * Empty paths mean "not set" (the SD wrapper then auto-detects or skips the
+ * component).
+ */
+typedef struct {
+    uint32_t model_id;                             /**< Protocol model_id */
+    char name[MODEL_REGISTRY_NAME_MAX];            /**< Name for logs */
+    char model_path[MODEL_REGISTRY_PATH_MAX];      /**< Diffusion model file (required) */
+    char clip_l_path[MODEL_REGISTRY_PATH_MAX];     /**< CLIP-L encoder */
+    char clip_g_path[MODEL_REGISTRY_PATH_MAX];     /**< CLIP-G encoder */
+    char t5xxl_path[MODEL_REGISTRY_PATH_MAX];      /**< T5-XXL encoder */
+    bool t5;                                       /**< Load T5-XXL (false = CLIP-only) */
+    uint32_t clip_only_model;                      /**< Model for CLIP-only requests
+                                                        (MODEL_REGISTRY_NO_MODEL = none) */
+    char vae_path[MODEL_REGISTRY_PATH_MAX];        /**< VAE */
+    bool keep_clip_on_cpu;                         /**< Text encoders on CPU */
+    bool keep_vae_on_cpu;                          /**< VAE on CPU */
+    bool enable_flash_attn;                        /**< Flash attention */
+    bool pinned;                                   /**< Loaded at startup, never evicted */
+    size_t vram_bytes;                             /**< VRAM while loaded (0 = estimate) */
+    float step_cache;                              /**< Step caching threshold (0 = off) */
+} model_config_t;
+
+/**
+ * Loads and unloads models for a registry
+ */
+typedef struct {
+    /**
+     * Load a model.
+     * @return Handle for model_registry_acquire() callers, NULL on failure
+     */
+    void *(*load)(const model_config_t *model, void *user_data);
+
+    /**
+     * Unload a model returned by load().
+     */
+    void (*unload)(void *handle, const model_config_t *model, void *user_data);
+
+    void *user_data;  /**< Passed through to load and unload */
+} model_loader_t;
+
+/**
+ * Opaque registry handle
+ */
+typedef struct model_registry model_registry_t;
+
+/**
+ * Registry statistics
+ */
+typedef struct {
+    uint64_t hits;            /* Acquires of an already loaded model */
+    uint64_t loads;           /* Successful loads */
+    uint64_t load_failures;   /* Loads that failed */
+    uint64_t evictions;       /* Models unloaded to make room */
+    uint32_t loaded;          /* Models currently loaded */
+    size_t vram_bytes;        /* VRAM of the loaded models */
+} model_registry_stats_t;
+
+/**
+ * model_config_init - Initialize a model with defaults
+ *
+ * Defaults match weave-compute's single-model setup: text encoders on CPU,
+ * VAE on GPU, flash attention on, T5-XXL loaded, no CLIP-only model, not
+ * pinned, no paths.
+ *
+ * @param model     Model to initialize
+ * @param model_id  Protocol model_id
+ */
+void model_config_init(model_config_t *model, uint32_t model_id);
+
+/**
+ * model_config_clip_only_model - Model that serves a model's CLIP-only requests
+ *
+ * @param model  Configured model
+ * @return       model->model_id if the model loads no T5-XXL, its clip_only
+ *               model if one is configured, or MODEL_REGISTRY_NO_MODEL when
+ *               it has T5-XXL and no CLIP-only counterpart, so CLIP-only
+ *               conditioning is not available for it
+ */
+uint32_t model_config_clip_only_model(const model_config_t *model);
+
+/**
+ * model_registry_parse - Parse a registry config
+ *
+ * @param text        NUL-terminated config text
+ * @param models      Output array of max_models models
+ * @param max_models  Capacity of models
+ * @param count       Output number of models parsed
+ * @param error_line  Output 1-based line of the first error (0 if none or
+ *                    not tied to a line); may be NULL
+ * @return            MODEL_REGISTRY_OK, MODEL_REGISTRY_ERR_NULL_POINTER or
+ *                    MODEL_REGISTRY_ERR_PARSE (unknown key, bad value,
+ *                    duplicate model_id, missing model path, no models,
+ *                    more than max_models, or a clip_only that is not a
+ *                    configured model with t5 = false; that last check is
+ *                    not tied to a line)
+ */
+model_registry_error_t model_registry_parse(const char *text, model_config_t *models,
+                                            size_t max_models, size_t *count,
+                                            unsigned *error_line);
+
+/**
+ * model_registry_parse_file - Read and parse a registry config file
+ *
+ * @param path        Config file path
+ * @param models      Output array of max_models models
+ * @param max_models  Capacity of models
+ * @param count       Output number of models parsed
+ * @param error_line  As for model_registry_parse(); may be NULL
+ * @return            As for model_registry_parse(), or MODEL_REGISTRY_ERR_IO
+ *                    if the file cannot be read
+ */
+model_registry_error_t model_registry_parse_file(const char *path, model_config_t *models,
+                                                 size_t max_models, size_t *count,
+                                                 unsigned *error_line);
+
+/**
+ * model_registry_create - Create a registry with nothing loaded
+ *
+ * Models without vram_bytes get an estimate: the model and VAE files, plus
+ * the text encoder files unless keep_clip_on_cpu, minus the VAE if
+ * keep_vae_on_cpu.
+ *
+ * @param models       Configured models (copied)
+ * @param count        Number of models (1-MODEL_REGISTRY_MAX_MODELS)
+ * @param vram_budget  VRAM available for models in bytes (0 = unlimited)
+ * @param loader       Load/unload callbacks (copied)
+ * @return             Registry handle, or NULL on invalid arguments or
+ *                     allocation failure
+ */
+model_registry_t *model_registry_create(const model_config_t *models, size_t count,
+                                        size_t vram_budget, const model_loader_t *loader);
+
+/**
+ * model_registry_destroy - Unload every model and free the registry
+ *
+ * @param registry  Registry to destroy (NULL safe)
+ */
+void model_registry_destroy(model_registry_t *registry);
+
+/**
+ * model_registry_find - Look up a model's configuration
+ *
+ * @param registry  Registry to search
+ * @param model_id  Protocol model_id
+ * @return          Model configuration, or NULL if not configured
+ */
+const model_config_t *model_registry_find(const model_registry_t *registry, uint32_t model_id);
+
+/**
+ * model_registry_load_pinned - Load every pinned model
+ *
+ * @param registry  Registry
+ * @return          MODEL_REGISTRY_OK, or the error of the first pinned model
+ *                  that failed to load
+ */
+model_registry_error_t model_registry_load_pinned(model_registry_t *registry);
+
+/**
+ * model_registry_acquire - Get a loaded model, loading it if needed
+ *
+ * Marks the model most recently used. If it is not loaded, least recently
+ * used unpinned models are unloaded until it fits the budget. Nothing is
+ * evicted when it cannot fit even with every unpinned model unloaded.
+ *
+ * @param registry  Registry
+ * @param model_id  Protocol model_id
+ * @param handle    Output handle from the loader (valid until the next
+ *                  acquire or model_registry_destroy())
+ * @return          MODEL_REGISTRY_OK, MODEL_REGISTRY_ERR_NOT_FOUND,
+ *                  MODEL_REGISTRY_ERR_NO_VRAM, MODEL_REGISTRY_ERR_LOAD_FAILED
+ *                  or MODEL_REGISTRY_ERR_NULL_POINTER
+ */
+model_registry_error_t model_registry_acquire(model_registry_t *registry, uint32_t model_id,
+                                              void **handle);
+
+/**
+ * model_registry_get_stats - Get load/eviction counters and VRAM use
+ *
+ * @param registry  Registry to query
+ * @param stats     Output statistics
+ * @return          MODEL_REGISTRY_OK, MODEL_REGISTRY_ERR_NULL_POINTER
+ */
+model_registry_error_t model_registry_get_stats(const model_registry_t *registry,
+                                                model_registry_stats_t *stats);
+
+/**
+ * model_registry_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *model_registry_error_string(model_registry_error_t err);
@@ -0,0 +1,182 @@
+/**
+ * Weave Pipeline Module - Request Pipeline Stages
+ *
+ * Moves requests through the stages of weave-compute on their own threads,
+ * connected by bounded work queues (see queue.h):
+ *
+ *   pipeline_submit() -> requests -> prepare thread
+ *   prepare thread    -> generate -> GPU workers, one per device
+ *   prepare thread    -> responses -> writer thread (answered without a GPU)
+ *   GPU workers       -> responses -> writer thread
+ *
+ * The pipeline never looks inside a job. The caller's pipeline_ops_t does
+ * the work of each stage, so socket I/O, cache lookups and protocol work
+ * overlap generation instead of stalling the GPU. A full queue blocks the
+ * stage feeding it, which caps memory when requests arrive faster than the
+ * GPUs generate.
+ *
+ * Ordering:
+ * - The generate queue pops the most urgent priority first
+ *   (work_queue_push_priority()), FIFO within a priority
+ * - All workers pop the same generate queue, so each job goes to whichever
+ *   device frees up first; with several devices jobs finish out of order
+ *
+ * Ownership model:
+ * - A job belongs to the pipeline from a successful pipeline_submit() until
+ *   ops->release() is called for it, exactly once: after ops->respond(), or
+ *   as soon as a queue refuses it
+ *
+ * Shutdown:
+ * - pipeline_stop() closes each queue once the stage feeding it has
+ *   finished, so every submitted job is still prepared, generated and
+ *   answered before the threads exit
+ */
+
+#pragma once
+
+#include <pthread.h>
+
+#include "weave/queue.h"
+
+/**
+ * Most GPU workers (devices) one pipeline drives.
+ */
+#define PIPELINE_MAX_WORKERS 8
+
+/**
+ * Queue depths.
+ * Requests are at most MAX_MESSAGE_SIZE; finished batch responses hold up
+ * to SD35_MAX_BATCH_SIZE full-resolution images, so fewer are buffered.
+ * The generate queue holds prepared requests waiting for a device, so the
+ * prepare stage can pass a queued miss and answer the cache hits behind it.
+ * It pops the most urgent priority class first, so it is deep enough for an
+ * interactive request to overtake a backlog of batch work.
+ */
+#define PIPELINE_REQUEST_QUEUE_DEPTH 4
+#define PIPELINE_GENERATE_QUEUE_DEPTH 16
+#define PIPELINE_RESPONSE_QUEUE_DEPTH 2
+
+/**
+ * Jobs of one submitter that can be between submit and generated at once:
+ * every job in the request and generate queues, one being generated per
+ * worker, and the ones the submitter and the prepare stage are blocked
+ * pushing.
+ */
+#define PIPELINE_MAX_INFLIGHT \
+    (PIPELINE_REQUEST_QUEUE_DEPTH + PIPELINE_GENERATE_QUEUE_DEPTH + PIPELINE_MAX_WORKERS + 2)
+
+/**
+ * Pipeline Error Codes
+ */
+typedef enum {
+    PIPELINE_OK = 0,                  /**< Success */
+    PIPELINE_ERR_NULL_POINTER = -1,   /**< NULL pointer argument or callback */
+    PIPELINE_ERR_INVALID_ARG = -2,    /**< Worker count out of range */
+    PIPELINE_ERR_INIT_FAILED = -3,    /**< Failed to set up a queue or start a thread */
+    PIPELINE_ERR_CLOSED = -4,         /**< Pipeline no longer accepts jobs */
+} pipeline_error_t;
+
+/**
+ * Stage callbacks. user_data is the pointer given to pipeline_start().
+ */
+typedef struct {
+    /**
+     * Prepare thread: do the CPU work of a job. Return 1 to queue it for a
+     * GPU worker at *priority (0 the most urgent, preset to 0), or 0 to hand
+     * it straight to the writer.
+     */
+    int (*prepare)(void *job, unsigned *priority, void *user_data);
+
+    /**
+     * GPU worker: generate a job on the worker's device. Only the worker of
+     * a device calls this with it while the pipeline runs.
+     */
+    void (*generate)(void *job, void *device, void *user_data);
+
+    /**
+     * Writer thread: send a job's reply.
+     */
+    void (*respond)(void *job, void *user_data);
+
+    /**
+     * Free a job: after respond, or when a queue no longer accepts it.
+     */
+    void (*release)(void *job, void *user_data);
+} pipeline_ops_t;
+
+struct pipeline;
+
+/**
+ * A GPU worker thread and the device it generates on.
+ */
+typedef struct {
+    struct pipeline *pipeline;   /* Pipeline the worker serves */
+    void *device;                /* Device passed to ops.generate */
+    pthread_t thread;            /* Worker thread */
+} pipeline_worker_t;
+
+/**
+ * Request pipeline.
+ *
+ * Fields are private; embed or allocate the struct and use the functions
+ * below.
+ */
+typedef struct pipeline {
+    work_queue_t requests;       /* Submitted jobs awaiting the prepare stage */
+    work_queue_t generate;       /* Prepared jobs awaiting a device */
+    work_queue_t responses;      /* Finished jobs awaiting the writer */
+    pthread_t preparer;          /* Prepare stage thread */
+    pipeline_worker_t workers[PIPELINE_MAX_WORKERS]; /* One GPU worker per device */
+    int worker_count;            /* Workers started */
+    pthread_t writer;            /* Response writer thread */
+    pipeline_ops_t ops;          /* Stage callbacks */
+    void *user_data;             /* Passed to every callback */
+} pipeline_t;
+
+/**
+ * pipeline_start - Set up the queues and start the stage threads
+ *
+ * Starts the writer, the prepare stage and one GPU worker per device.
+ *
+ * @param pipeline      Pipeline to initialize
+ * @param ops           Stage callbacks (all required, copied)
+ * @param devices       Device of each worker, passed to ops->generate
+ * @param device_count  Workers to start (1 to PIPELINE_MAX_WORKERS)
+ * @param user_data     Passed to every callback
+ * @return              PIPELINE_OK, PIPELINE_ERR_NULL_POINTER,
+ *                      PIPELINE_ERR_INVALID_ARG or PIPELINE_ERR_INIT_FAILED
+ *                      (nothing left to clean up)
+ */
+pipeline_error_t pipeline_start(pipeline_t *pipeline, const pipeline_ops_t *ops,
+                                void *const *devices, int device_count, void *user_data);
+
+/**
+ * pipeline_submit - Queue a job for the prepare stage
+ *
+ * Blocks while the request queue is full.
+ *
+ * @param pipeline  Running pipeline
+ * @param job       Job to queue
+ * @return          PIPELINE_OK (the pipeline owns job), PIPELINE_ERR_CLOSED
+ *                  or PIPELINE_ERR_NULL_POINTER (the caller still owns job)
+ */
+pipeline_error_t pipeline_submit(pipeline_t *pipeline, void *job);
+
+/**
+ * pipeline_stop - Drain the pipeline and release it
+ *
+ * Jobs already submitted are still prepared, generated and answered
+ * before the threads exit. Must not be called concurrently with
+ * pipeline_submit().
+ *
+ * @param pipeline  Pipeline started by pipeline_start() (NULL safe)
+ */
+void pipeline_stop(pipeline_t *pipeline);
+
+/**
+ * pipeline_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *pipeline_error_string(pipeline_error_t err);
@@ -0,0 +1,143 @@
+/**
+ * Weave Prepared Model Module - Converted Weights Kept Next to the Source
+ *
+ * stable-diffusion.cpp converts .safetensors weights to the context's weight
+ * type (F16 unless the VRAM plan quantizes) every time a context is created.
+ * A prepared model is that conversion done once and saved as GGUF next to the source
+ * file, so later sd_wrapper_create() calls and full resets read weights that
+ * already have the right layout and type.
+ *
+ * Files for a source "sd3.5_medium.safetensors" prepared as F16:
+ * - sd3.5_medium.safetensors.f16.gguf      Prepared weights
+ * - sd3.5_medium.safetensors.f16.gguf.src  Manifest: source fingerprint and
+ *                                          prepared file size
+ *
+ * Validation:
+ * The fingerprint is the source's size, modification time and a 64-bit
+ * FNV-1a hash of its first and last PREPARED_MODEL_SAMPLE_BYTES. Hashing the
+ * whole file would read gigabytes on every start, which is the cost this
+ * module exists to avoid. A prepared file is used only when its manifest
+ * matches the current source and its own size matches the manifest;
+ * anything else means it is re-created.
+ *
+ * The conversion itself lives in the SD wrapper. This module only names,
+ * validates and commits the files. Commit writes the manifest under a
+ * temporary name and renames the prepared file into place before the
+ * manifest, so a crash never leaves a manifest describing a partial file.
+ *
+ * Thread safety:
+ * - Functions are reentrant; callers serialize preparation of the same file
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Suffixes appended to the source path for the prepared file, by weight type */
+#define PREPARED_MODEL_SUFFIX ".f16.gguf"
+#define PREPARED_MODEL_SUFFIX_Q8_0 ".q8_0.gguf"
+#define PREPARED_MODEL_SUFFIX_Q4_0 ".q4_0.gguf"
+
+/** Suffix appended to the prepared path for its manifest */
+#define PREPARED_MODEL_MANIFEST_SUFFIX ".src"
+
+/** Suffix appended to the prepared path while it is being written */
+#define PREPARED_MODEL_TMP_SUFFIX ".tmp"
+
+/** Bytes hashed at each end of the source */
+#define PREPARED_MODEL_SAMPLE_BYTES (1024 * 1024)
+
+/**
+ * Prepared Model Error Codes
+ */
+typedef enum {
+    PREPARED_MODEL_OK = 0,                 /**< Success / prepared file is valid */
+    PREPARED_MODEL_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    PREPARED_MODEL_ERR_PATH_TOO_LONG = -2, /**< Output path does not fit */
+    PREPARED_MODEL_ERR_IO = -3,            /**< Source unreadable or write failed */
+    PREPARED_MODEL_ERR_NOT_FOUND = -4,     /**< No prepared file or manifest */
+    PREPARED_MODEL_ERR_STALE = -5,         /**< Prepared file does not match the source */
+} prepared_model_error_t;
+
+/**
+ * Source file fingerprint
+ */
+typedef struct {
+    uint64_t size;         /**< File size in bytes */
+    int64_t mtime_sec;     /**< Modification time, seconds */
+    int64_t mtime_nsec;    /**< Modification time, nanoseconds */
+    uint64_t sample_hash;  /**< FNV-1a of the first and last sample bytes */
+} prepared_model_fingerprint_t;
+
+/**
+ * prepared_model_path - Build a prepared, manifest or temporary path
+ *
+ * @param base      Source path (for PREPARED_MODEL_SUFFIX*) or prepared path
+ *                  (for PREPARED_MODEL_MANIFEST_SUFFIX / _TMP_SUFFIX)
+ * @param suffix    Suffix to append
+ * @param out       Output buffer
+ * @param out_size  Size of out in bytes
+ * @return          PREPARED_MODEL_OK, PREPARED_MODEL_ERR_NULL_POINTER or
+ *                  PREPARED_MODEL_ERR_PATH_TOO_LONG
+ */
+prepared_model_error_t prepared_model_path(const char *base, const char *suffix,
+                                           char *out, size_t out_size);
+
+/**
+ * prepared_model_fingerprint - Fingerprint a source file
+ *
+ * @param path  File to fingerprint
+ * @param fp    Output fingerprint
+ * @return      PREPARED_MODEL_OK, PREPARED_MODEL_ERR_NULL_POINTER or
+ *              PREPARED_MODEL_ERR_IO
+ */
+prepared_model_error_t prepared_model_fingerprint(const char *path,
+                                                  prepared_model_fingerprint_t *fp);
+
+/**
+ * prepared_model_check - Check whether a prepared file can be used
+ *
+ * @param source    Source weights path
+ * @param prepared  Prepared file path (from prepared_model_path())
+ * @return          PREPARED_MODEL_OK if it matches the source,
+ *                  PREPARED_MODEL_ERR_NOT_FOUND if it or its manifest is
+ *                  missing, PREPARED_MODEL_ERR_STALE if it does not match,
+ *                  PREPARED_MODEL_ERR_IO if the source cannot be read, or
+ *                  PREPARED_MODEL_ERR_NULL_POINTER
+ */
+prepared_model_error_t prepared_model_check(const char *source, const char *prepared);
+
+/**
+ * prepared_model_commit - Publish a freshly written prepared file
+ *
+ * Renames tmp to prepared and writes prepared's manifest. On failure the
+ * temporary file, and any prepared file and manifest, are removed.
+ *
+ * Take the fingerprint before converting, so a source replaced during the
+ * conversion is detected as stale on the next check.
+ *
+ * @param source_fp Fingerprint of the source the file was converted from
+ * @param tmp       Completely written prepared file under a temporary name
+ * @param prepared  Final prepared file path
+ * @return          PREPARED_MODEL_OK, PREPARED_MODEL_ERR_NULL_POINTER,
+ *                  PREPARED_MODEL_ERR_PATH_TOO_LONG or PREPARED_MODEL_ERR_IO
+ */
+prepared_model_error_t prepared_model_commit(const prepared_model_fingerprint_t *source_fp,
+                                             const char *tmp, const char *prepared);
+
+/**
+ * prepared_model_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *prepared_model_error_string(prepared_model_error_t err);
+
+#ifdef __cplusplus
+}
+#endif
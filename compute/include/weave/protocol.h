@@ -5,7 +5,7 @@
  * The protocol is used for communication between the Go orchestration layer
  * (weave) and the C GPU compute process (weave-compute) over Unix domain sockets.
  *
- * Protocol version: 1
+ * Protocol versions: 1, 2 (version 2 adds chunked image responses)
  * Specification: docs/protocol/SPEC.md, docs/protocol/SPEC_SD35.md
  *
  * Wire format conventions:
@@ -27,25 +27,110 @@
 /** Protocol magic number: ASCII "WEVE" (0x57455645) */
 #define PROTOCOL_MAGIC 0x57455645
 
-/** Current protocol version */
+/** Protocol version 1 */
 #define PROTOCOL_VERSION_1 0x0001
 
+/**
+ * Protocol version 2: same message layouts, but image responses to a
+ * version 2 request are a head frame followed by MSG_CHUNK frames, so image
+ * data is not limited by MAX_MESSAGE_SIZE.
+ */
+#define PROTOCOL_VERSION_2 0x0002
+
 /** Minimum supported protocol version */
 #define MIN_SUPPORTED_VERSION PROTOCOL_VERSION_1
 
 /** Maximum supported protocol version */
-#define MAX_SUPPORTED_VERSION PROTOCOL_VERSION_1
+#define MAX_SUPPORTED_VERSION PROTOCOL_VERSION_2
 
-/** Maximum total message size: 10 MB */
+/** Maximum total message size (one frame): 10 MB */
 #define MAX_MESSAGE_SIZE (10 * 1024 * 1024)
 
+/** Maximum MSG_CHUNK data bytes: 1 MB */
+#define PROTOCOL_MAX_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * Header Flags
+ *
+ * Carried in the header flags field. Unknown bits are ignored.
+ */
+
+/** Request: stream MSG_GENERATE_PROGRESS frames before the final response */
+#define PROTOCOL_FLAG_PROGRESS 0x00000001
+
+/**
+ * Request: the client accepts image data in shared memory.
+ * Response: payload_len covers only the inline bytes. The rest of the
+ * payload (the image data) is in a sealed memfd passed with SCM_RIGHTS on
+ * the first byte of the header; its size is the number of missing bytes.
+ */
+#define PROTOCOL_FLAG_SHM 0x00000002
+
+/**
+ * Response (version 2 head): the image data announced by the head's 64-bit
+ * data length follows in MSG_CHUNK frames, with no other frames in between.
+ */
+#define PROTOCOL_FLAG_CHUNKED 0x00000004
+
+/**
+ * Request: the client accepts a PNG file instead of raw pixels.
+ * Response: image_data is a PNG file and image_data_len its size. Only
+ * single responses are encoded; batch responses stay raw.
+ */
+#define PROTOCOL_FLAG_PNG 0x00000008
+
+/**
+ * Request: after the final response (including its chunks, or an error
+ * response), send one MSG_GENERATE_TIMINGS frame with the request's stage
+ * timings.
+ */
+#define PROTOCOL_FLAG_TIMINGS 0x00000010
+
+/**
+ * Request: the generation payload carries a sampling block, sampler (4) and
+ * scheduler (4), between the fixed fields (the seed table in a batch
+ * request) and prompt_data. Without it both are the model defaults.
+ */
+#define PROTOCOL_FLAG_SAMPLING 0x00000020
+
+/**
+ * Request: the generation payload carries an init image block after the
+ * sampling block (if any) and before prompt_data, so the image is refined
+ * from an earlier one instead of generated from noise. See
+ * sd35_init_source_t.
+ */
+#define PROTOCOL_FLAG_INIT_IMAGE 0x00000040
+
+/**
+ * Request: condition on CLIP-L/G only, without T5-XXL. t5_length may be 0.
+ * A model configured with a CLIP-only counterpart (see model_registry.h)
+ * hands the request to it; a model loaded without T5-XXL is CLIP-only
+ * anyway; any other model refuses it with ERR_NO_CLIP_ONLY.
+ */
+#define PROTOCOL_FLAG_CLIP_ONLY 0x00000080
+
+/**
+ * Request: the generation payload carries a scheduling block, priority (4,
+ * sd35_priority_t) and deadline_ms (4), after the init image block (if any)
+ * and before prompt_data. Without it the request is SD35_PRIORITY_INTERACTIVE
+ * with weave-compute's default deadline.
+ */
+#define PROTOCOL_FLAG_SCHEDULING 0x00000100
+
 /**
  * Model Identifiers
  */
 
-/** Stable Diffusion 3.5 model ID */
+/** Stable Diffusion 3.5 model ID (the default SD 3.5 model) */
 #define MODEL_ID_SD35 0x00000000
 
+/**
+ * Highest SD 3.5 family model ID.
+ * IDs MODEL_ID_SD35-MODEL_ID_SD35_MAX share the SD 3.5 payload and select
+ * a model configured in the compute process (Medium, Large, turbo, ...).
+ */
+#define MODEL_ID_SD35_MAX 0x000000FF
+
 /**
  * SD 3.5 Parameter Bounds
  */
@@ -90,12 +175,58 @@
 /** Maximum total prompt data size (3 encoders × 256 bytes) */
 #define SD35_MAX_PROMPT_DATA_SIZE (3 * SD35_MAX_PROMPT_LENGTH)
 
+/** Minimum seeds per batch request */
+#define SD35_MIN_BATCH_SIZE 1
+
+/** Maximum seeds per batch request */
+#define SD35_MAX_BATCH_SIZE 8
+
+/** Maximum progress preview dimension (pixels) */
+#define SD35_MAX_PREVIEW_DIMENSION 256
+
+/** Response bytes before the image data: header + response fields + image metadata */
+#define SD35_RESPONSE_PREFIX_SIZE (16 + 16 + 16)
+
+/** Batch response bytes before the image data (image metadata adds image_count) */
+#define SD35_BATCH_RESPONSE_PREFIX_SIZE (16 + 16 + 20)
+
+/** Version 2 response heads: the prefix plus a 64-bit image data length */
+#define SD35_RESPONSE_HEAD_SIZE (SD35_RESPONSE_PREFIX_SIZE + 8)
+#define SD35_BATCH_RESPONSE_HEAD_SIZE (SD35_BATCH_RESPONSE_PREFIX_SIZE + 8)
+
+/** Most sampling steps one timings frame reports (a batch of one pass per seed) */
+#define SD35_MAX_TIMED_STEPS (SD35_MAX_STEPS * SD35_MAX_BATCH_SIZE)
+
+/** Largest MSG_GENERATE_TIMINGS frame */
+#define SD35_TIMINGS_MAX_SIZE (16 + 12 + 8 * TIMING_STAGE_COUNT + 4 + 4 * SD35_MAX_TIMED_STEPS)
+
+/** Latency histogram buckets in a stats response, the last one unbounded */
+#define STATS_HISTOGRAM_BUCKETS 14
+
+/** Most distinct error codes a stats response reports */
+#define STATS_MAX_ERROR_CODES 24
+
+/** Largest MSG_STATS_RESPONSE frame */
+#define STATS_RESPONSE_MAX_SIZE                                        \
+    (16 + 76 + 4 + 8 * SD35_PRIORITY_COUNT + 4 + 12 * STATS_MAX_ERROR_CODES + \
+     4 + 8 * STATS_HISTOGRAM_BUCKETS +                                 \
+     4 + (20 + 8 * STATS_HISTOGRAM_BUCKETS) * TIMING_STAGE_COUNT)
+
 /**
  * Message Types
  */
 typedef enum {
     MSG_GENERATE_REQUEST  = 0x0001,  /**< Generation request */
     MSG_GENERATE_RESPONSE = 0x0002,  /**< Generation response (success) */
+    MSG_GENERATE_BATCH_REQUEST  = 0x0003,  /**< Multi-seed generation request */
+    MSG_GENERATE_BATCH_RESPONSE = 0x0004,  /**< Multi-seed generation response */
+    MSG_GENERATE_PROGRESS = 0x0005,  /**< Mid-generation progress frame */
+    MSG_CANCEL            = 0x0006,  /**< Cancel a queued or running request */
+    MSG_CHUNK             = 0x0007,  /**< Part of a version 2 response's image data */
+    MSG_GENERATE_TIMINGS  = 0x0008,  /**< Stage timings after a final response */
+    MSG_STATS_REQUEST     = 0x0009,  /**< Query server counters and histograms */
+    MSG_STATS_RESPONSE    = 0x000A,  /**< Reply to MSG_STATS_REQUEST */
+    MSG_PREPARE           = 0x000B,  /**< Get ready for a generation request still being composed */
     MSG_ERROR             = 0x00FF,  /**< Error response */
 } message_type_t;
 
@@ -117,9 +248,11 @@ typedef enum {
  * Error codes map to HTTP status codes:
  * - Client errors (400): ERR_INVALID_MAGIC, ERR_UNSUPPORTED_VERSION,
  *   ERR_INVALID_MODEL_ID, ERR_INVALID_PROMPT, ERR_INVALID_DIMENSIONS,
- *   ERR_INVALID_STEPS, ERR_INVALID_CFG
+ *   ERR_INVALID_STEPS, ERR_INVALID_CFG, ERR_INVALID_SEED_COUNT,
+ *   ERR_CANCELLED, ERR_INVALID_SAMPLER, ERR_INVALID_INIT_IMAGE,
+ *   ERR_INVALID_PRIORITY, ERR_NO_CLIP_ONLY
  * - Server errors (500): ERR_OUT_OF_MEMORY, ERR_GPU_ERROR,
- *   ERR_TIMEOUT, ERR_INTERNAL
+ *   ERR_TIMEOUT, ERR_BUSY, ERR_INTERNAL
  */
 typedef enum {
     ERR_NONE                = 0,   /**< No error */
@@ -133,9 +266,122 @@ typedef enum {
     ERR_OUT_OF_MEMORY       = 8,   /**< Out of memory (500) */
     ERR_GPU_ERROR           = 9,   /**< GPU error (500) */
     ERR_TIMEOUT             = 10,  /**< Operation timeout (500) */
+    ERR_INVALID_SEED_COUNT  = 11,  /**< Batch seed count out of range (400) */
+    ERR_CANCELLED           = 12,  /**< Request cancelled by MSG_CANCEL (400) */
+    ERR_INVALID_SAMPLER     = 13,  /**< Unknown sampler or scheduler (400) */
+    ERR_INVALID_INIT_IMAGE  = 14,  /**< Bad init image or unknown retained result (400) */
+    ERR_BUSY                = 15,  /**< Estimated queue wait exceeds the deadline (500) */
+    ERR_INVALID_PRIORITY    = 16,  /**< Unknown priority class (400) */
+    ERR_NO_CLIP_ONLY        = 17,  /**< CLIP-only requested, model has T5 and no CLIP-only model (400) */
     ERR_INTERNAL            = 99,  /**< Internal error (500) */
 } error_code_t;
 
+/**
+ * Image Formats
+ *
+ * Encoding of a response's image_data. Not on the wire: IMAGE_FORMAT_PNG
+ * is signalled by PROTOCOL_FLAG_PNG in the response header.
+ */
+typedef enum {
+    IMAGE_FORMAT_RAW = 0,  /**< width * height * channels pixel bytes */
+    IMAGE_FORMAT_PNG = 1,  /**< PNG file of width x height, channels deep */
+} image_format_t;
+
+/**
+ * Timing Stages
+ *
+ * Stages of one generation request, in the order they run. Durations are
+ * measured with CLOCK_MONOTONIC; a stage that did not run reports 0.
+ */
+typedef enum {
+    TIMING_STAGE_QUEUE       = 0,  /**< Read until a GPU thread picked it up */
+    TIMING_STAGE_RESET       = 1,  /**< Context reset before generating */
+    TIMING_STAGE_TEXT_ENCODE = 2,  /**< Prompt encoding (until the first step) */
+    TIMING_STAGE_SAMPLING    = 3,  /**< Diffusion sampling */
+    TIMING_STAGE_VAE_DECODE  = 4,  /**< Latent decode (after the last step) */
+    TIMING_STAGE_ENCODE      = 5,  /**< Response image encoding (PNG) */
+    TIMING_STAGE_WRITE       = 6,  /**< Writing the response to the socket */
+    TIMING_STAGE_TOTAL       = 7,  /**< Read until the response was written */
+    TIMING_STAGE_COUNT       = 8,  /**< Number of stages */
+} timing_stage_t;
+
+/**
+ * Samplers
+ *
+ * Sampling method of a generation request (PROTOCOL_FLAG_SAMPLING).
+ * SD35_SAMPLER_DEFAULT leaves the choice to the model, Euler for SD 3.5.
+ * Few-step models (turbo, LCM and TCD distillations) need the matching
+ * sampler to give usable images at 4-8 steps.
+ */
+typedef enum {
+    SD35_SAMPLER_DEFAULT       = 0,   /**< Model default */
+    SD35_SAMPLER_EULER         = 1,   /**< Euler */
+    SD35_SAMPLER_EULER_A       = 2,   /**< Euler ancestral */
+    SD35_SAMPLER_HEUN          = 3,   /**< Heun (two model calls per step) */
+    SD35_SAMPLER_DPM2          = 4,   /**< DPM2 (two model calls per step) */
+    SD35_SAMPLER_DPMPP_2S_A    = 5,   /**< DPM++ 2S ancestral */
+    SD35_SAMPLER_DPMPP_2M      = 6,   /**< DPM++ 2M */
+    SD35_SAMPLER_DPMPP_2M_V2   = 7,   /**< DPM++ 2M v2 */
+    SD35_SAMPLER_IPNDM         = 8,   /**< iPNDM */
+    SD35_SAMPLER_IPNDM_V       = 9,   /**< iPNDM with variable step size */
+    SD35_SAMPLER_LCM           = 10,  /**< Latent consistency model */
+    SD35_SAMPLER_DDIM_TRAILING = 11,  /**< DDIM with trailing timesteps */
+    SD35_SAMPLER_TCD           = 12,  /**< Trajectory consistency distillation */
+    SD35_SAMPLER_COUNT         = 13,  /**< Number of samplers */
+} sd35_sampler_t;
+
+/**
+ * Schedulers
+ *
+ * Noise schedule of a generation request (PROTOCOL_FLAG_SAMPLING).
+ * SD35_SCHEDULER_DEFAULT leaves the choice to the model and sampler.
+ */
+typedef enum {
+    SD35_SCHEDULER_DEFAULT     = 0,   /**< Model and sampler default */
+    SD35_SCHEDULER_DISCRETE    = 1,   /**< Discrete (the model's training schedule) */
+    SD35_SCHEDULER_KARRAS      = 2,   /**< Karras */
+    SD35_SCHEDULER_EXPONENTIAL = 3,   /**< Exponential */
+    SD35_SCHEDULER_AYS         = 4,   /**< Align Your Steps */
+    SD35_SCHEDULER_GITS        = 5,   /**< GITS */
+    SD35_SCHEDULER_SGM_UNIFORM = 6,   /**< SGM uniform */
+    SD35_SCHEDULER_SIMPLE      = 7,   /**< Simple */
+    SD35_SCHEDULER_SMOOTHSTEP  = 8,   /**< Smoothstep */
+    SD35_SCHEDULER_COUNT       = 9,   /**< Number of schedulers */
+} sd35_scheduler_t;
+
+/**
+ * Init Image Sources
+ *
+ * Where the init image of a PROTOCOL_FLAG_INIT_IMAGE request comes from.
+ * Either way it must have the request's width and height.
+ */
+typedef enum {
+    SD35_INIT_NONE     = 0,  /**< No init image (always without the flag) */
+    SD35_INIT_INLINE   = 1,  /**< RGB pixels carried in the request */
+    SD35_INIT_RETAINED = 2,  /**< An image weave-compute returned earlier,
+                                  by request_id and image index */
+} sd35_init_source_t;
+
+/** Size of the init image block before its inline pixels */
+#define SD35_INIT_IMAGE_BLOCK_SIZE 24
+
+/**
+ * Priority Classes
+ *
+ * Scheduling class of a generation request (PROTOCOL_FLAG_SCHEDULING).
+ * A GPU takes the oldest queued request of the most urgent class, so
+ * interactive requests overtake queued drafts and batches.
+ */
+typedef enum {
+    SD35_PRIORITY_INTERACTIVE = 0,  /**< A user is waiting (the default) */
+    SD35_PRIORITY_DRAFT       = 1,  /**< Cheap preview a user may be waiting on */
+    SD35_PRIORITY_BATCH       = 2,  /**< Background work */
+    SD35_PRIORITY_COUNT       = 3,  /**< Number of classes */
+} sd35_priority_t;
+
+/** Size of the scheduling block */
+#define SD35_SCHEDULING_BLOCK_SIZE 8
+
 /**
  * Common Message Header
  *
@@ -149,7 +395,7 @@ typedef struct {
     uint16_t version;      /**< Protocol version */
     uint16_t msg_type;     /**< Message type (message_type_t) */
     uint32_t payload_len;  /**< Length of data following header */
-    uint32_t reserved;     /**< Reserved (must be 0) */
+    uint32_t flags;        /**< Request flags (PROTOCOL_FLAG_*), 0 in responses */
 } protocol_header_t;
 
 /**
@@ -160,7 +406,7 @@ typedef struct {
  *
  * Wire format payload structure (after common header):
  * - request_id: 8 bytes (uint64)
- * - model_id: 4 bytes (uint32, must be 0x00000000 for SD 3.5)
+ * - model_id: 4 bytes (uint32, 0x00000000-0x000000FF for SD 3.5 models)
  * - width: 4 bytes (uint32)
  * - height: 4 bytes (uint32)
  * - steps: 4 bytes (uint32)
@@ -172,12 +418,24 @@ typedef struct {
  * - clip_g_length: 4 bytes (uint32)
  * - t5_offset: 4 bytes (uint32)
  * - t5_length: 4 bytes (uint32)
+ * - sampler, scheduler: 4 bytes each (uint32), only with PROTOCOL_FLAG_SAMPLING
+ * - init image block, only with PROTOCOL_FLAG_INIT_IMAGE:
+ *   - strength: 4 bytes (float32, 0.0 exclusive to 1.0)
+ *   - source: 4 bytes (uint32, sd35_init_source_t)
+ *   - source_request_id: 8 bytes (uint64, SD35_INIT_RETAINED only)
+ *   - source_index: 4 bytes (uint32, image index in that response)
+ *   - data_len: 4 bytes (uint32, width * height * 3 inline, else 0)
+ *   - data: data_len bytes (RGB pixels)
+ * - scheduling block, only with PROTOCOL_FLAG_SCHEDULING:
+ *   - priority: 4 bytes (uint32, sd35_priority_t)
+ *   - deadline_ms: 4 bytes (uint32, from when the request is read; 0 for
+ *     weave-compute's default)
  * - prompt_data: variable bytes (UTF-8 encoded prompts)
  */
 typedef struct {
     /* Common request fields */
     uint64_t request_id;   /**< Unique request identifier (echoed in response) */
-    uint32_t model_id;     /**< Model identifier (must be MODEL_ID_SD35) */
+    uint32_t model_id;     /**< Model identifier (MODEL_ID_SD35-MODEL_ID_SD35_MAX) */
 
     /* Generation parameters */
     uint32_t width;        /**< Image width (64-2048, multiple of 64) */
@@ -185,6 +443,23 @@ typedef struct {
     uint32_t steps;        /**< Denoising steps (1-100, recommended: 28) */
     float cfg_scale;       /**< CFG scale (0.0-20.0, recommended: 7.0) */
     uint64_t seed;         /**< Random seed (0 = random) */
+    uint32_t sampler;      /**< Sampling method (sd35_sampler_t) */
+    uint32_t scheduler;    /**< Noise schedule (sd35_scheduler_t) */
+
+    /* Init image (PROTOCOL_FLAG_INIT_IMAGE) */
+    uint32_t init_source;        /**< sd35_init_source_t (SD35_INIT_NONE without the flag) */
+    float strength;              /**< Fraction of the steps to run from the init image */
+    uint64_t init_request_id;    /**< Retained result's request_id */
+    uint32_t init_index;         /**< Image index in the retained result */
+    const uint8_t *init_data;    /**< RGB pixels, width * height * 3 (points into the
+                                      received buffer, or set once a retained result
+                                      is looked up) */
+    size_t init_data_len;        /**< Size of init_data */
+
+    /* Scheduling (PROTOCOL_FLAG_SCHEDULING) */
+    uint32_t priority;           /**< sd35_priority_t (interactive without the flag) */
+    uint32_t deadline_ms;        /**< Deadline from when the request was read
+                                      (0 = weave-compute's default) */
 
     /* Prompt offset table */
     uint32_t clip_l_offset; /**< Byte offset of CLIP-L prompt in prompt_data */
@@ -192,7 +467,8 @@ typedef struct {
     uint32_t clip_g_offset; /**< Byte offset of CLIP-G prompt in prompt_data */
     uint32_t clip_g_length; /**< Length of CLIP-G prompt (1-1024 bytes) */
     uint32_t t5_offset;     /**< Byte offset of T5 prompt in prompt_data */
-    uint32_t t5_length;     /**< Length of T5 prompt (1-1024 bytes) */
+    uint32_t t5_length;     /**< Length of T5 prompt (1-1024 bytes, 0 with
+                                 PROTOCOL_FLAG_CLIP_ONLY) */
 
     /* Prompt data (not owned by this struct, points into received buffer) */
     const uint8_t *prompt_data;  /**< Pointer to prompt data buffer */
@@ -213,7 +489,7 @@ typedef struct {
  * - image_height: 4 bytes (uint32)
  * - channels: 4 bytes (uint32, 3 = RGB, 4 = RGBA)
  * - image_data_len: 4 bytes (uint32)
- * - image_data: variable bytes (raw pixel data)
+ * - image_data: variable bytes (raw pixel data, or PNG with PROTOCOL_FLAG_PNG)
  */
 typedef struct {
     /* Common response fields */
@@ -228,9 +504,256 @@ typedef struct {
     uint32_t image_data_len; /**< Size of image_data in bytes */
 
     /* Image data (not owned by this struct, points into buffer) */
-    const uint8_t *image_data; /**< Pointer to raw pixel data (RGB/RGBA) */
+    const uint8_t *image_data; /**< Pointer to raw pixel data (RGB/RGBA) or PNG file */
+    image_format_t image_format; /**< Encoding of image_data (sets PROTOCOL_FLAG_PNG) */
 } sd35_generate_response_t;
 
+/**
+ * SD 3.5 Batch Generation Request
+ *
+ * One prompt and parameter set rendered with several seeds.
+ * This struct is NOT for wire format - use encoding/decoding functions.
+ *
+ * Wire format payload structure (after common header):
+ * - request_id: 8 bytes (uint64)
+ * - model_id: 4 bytes (uint32, 0x00000000-0x000000FF for SD 3.5 models)
+ * - width: 4 bytes (uint32)
+ * - height: 4 bytes (uint32)
+ * - steps: 4 bytes (uint32)
+ * - cfg_scale: 4 bytes (float32, IEEE 754)
+ * - seed_count: 4 bytes (uint32, 1-8)
+ * - clip_l_offset/length, clip_g_offset/length, t5_offset/length: 24 bytes
+ * - seeds: seed_count * 8 bytes (uint64 each, 0 = random)
+ * - sampler, scheduler: 4 bytes each (uint32), only with PROTOCOL_FLAG_SAMPLING
+ * - init image block, only with PROTOCOL_FLAG_INIT_IMAGE (as in a single request)
+ * - scheduling block, only with PROTOCOL_FLAG_SCHEDULING (as in a single request)
+ * - prompt_data: variable bytes (UTF-8 encoded prompts)
+ */
+typedef struct {
+    sd35_generate_request_t base;  /**< Shared parameters (base.seed = seeds[0]) */
+    uint32_t seed_count;           /**< Number of seeds (1-8) */
+    uint64_t seeds[SD35_MAX_BATCH_SIZE]; /**< One seed per output image */
+} sd35_generate_batch_request_t;
+
+/**
+ * SD 3.5 Batch Generation Response
+ *
+ * In-memory representation of a successful batch response.
+ * This struct is NOT for wire format - use encoding/decoding functions.
+ *
+ * Wire format payload structure (after common header):
+ * - request_id: 8 bytes (uint64)
+ * - status: 4 bytes (uint32, must be STATUS_OK = 200)
+ * - generation_time_ms: 4 bytes (uint32, whole batch)
+ * - image_width: 4 bytes (uint32)
+ * - image_height: 4 bytes (uint32)
+ * - channels: 4 bytes (uint32, 3 = RGB, 4 = RGBA)
+ * - image_count: 4 bytes (uint32, equals request seed_count)
+ * - image_data_len: 4 bytes (uint32, bytes per image)
+ * - image_data: image_count * image_data_len bytes, in seed order
+ */
+typedef struct {
+    uint64_t request_id;         /**< Request ID (echoed from request) */
+    uint32_t status;             /**< Status code (STATUS_OK = 200) */
+    uint32_t generation_time_ms; /**< Generation time for the whole batch */
+
+    uint32_t image_width;   /**< Image width (same for every image) */
+    uint32_t image_height;  /**< Image height (same for every image) */
+    uint32_t channels;      /**< Number of channels (3 = RGB, 4 = RGBA) */
+    uint32_t image_count;   /**< Number of images */
+    uint32_t image_data_len; /**< Size of each image in bytes */
+
+    /* Image data (not owned by this struct) */
+    const uint8_t *images[SD35_MAX_BATCH_SIZE]; /**< Raw pixels per image */
+} sd35_generate_batch_response_t;
+
+/**
+ * SD 3.5 Generation Progress
+ *
+ * Sent zero or more times before the final response when the request set
+ * PROTOCOL_FLAG_PROGRESS. This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header):
+ * - request_id: 8 bytes (uint64, echoed from request)
+ * - step: 4 bytes (uint32, sampling step just completed, 1-based)
+ * - total_steps: 4 bytes (uint32)
+ * - elapsed_ms: 4 bytes (uint32, since the request was received)
+ * - preview_width: 4 bytes (uint32, 0 if no preview)
+ * - preview_height: 4 bytes (uint32, 0 if no preview)
+ * - preview_channels: 4 bytes (uint32, 0 if no preview, else 3 or 4)
+ * - preview_data_len: 4 bytes (uint32)
+ * - preview_data: variable bytes (raw pixels, approximate latent projection)
+ */
+typedef struct {
+    uint64_t request_id;        /**< Request ID (echoed from request) */
+    uint32_t step;              /**< Sampling step just completed */
+    uint32_t total_steps;       /**< Total sampling steps */
+    uint32_t elapsed_ms;        /**< Time since the request was received */
+
+    uint32_t preview_width;     /**< Preview width (0 = no preview) */
+    uint32_t preview_height;    /**< Preview height (0 = no preview) */
+    uint32_t preview_channels;  /**< Preview channels (3 = RGB, 4 = RGBA) */
+    uint32_t preview_data_len;  /**< Size of preview_data in bytes */
+
+    /* Preview data (not owned by this struct) */
+    const uint8_t *preview_data; /**< Raw preview pixels (NULL if none) */
+} sd35_generate_progress_t;
+
+/**
+ * Cancel Request
+ *
+ * Asks weave-compute to abandon a request sent earlier on the same
+ * connection. There is no reply to the cancel itself: the cancelled request
+ * is answered with ERR_CANCELLED, or as usual if it already finished.
+ * This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header with msg_type = MSG_CANCEL):
+ * - request_id: 8 bytes (uint64, request to cancel)
+ */
+typedef struct {
+    uint64_t request_id;  /**< Request ID to cancel */
+} cancel_request_t;
+
+/**
+ * SD 3.5 Generation Timings
+ *
+ * Sent once after the final response (or error) of a request that set
+ * PROTOCOL_FLAG_TIMINGS. This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header with
+ * msg_type = MSG_GENERATE_TIMINGS):
+ * - request_id: 8 bytes (uint64, echoed from request)
+ * - stage_count: 4 bytes (uint32, TIMING_STAGE_COUNT)
+ * - stage_us: stage_count * 8 bytes (uint64 microseconds, timing_stage_t order)
+ * - step_count: 4 bytes (uint32, 0-SD35_MAX_TIMED_STEPS)
+ * - step_us: step_count * 4 bytes (uint32 microseconds per sampling step)
+ */
+typedef struct {
+    uint64_t request_id;                   /**< Request ID (echoed from request) */
+    uint64_t stage_us[TIMING_STAGE_COUNT]; /**< Duration per timing_stage_t */
+    uint32_t step_count;                   /**< Entries in step_us */
+    uint32_t step_us[SD35_MAX_TIMED_STEPS]; /**< Duration of each sampling step */
+} sd35_generate_timings_t;
+
+/**
+ * Stats Request
+ *
+ * Asks weave-compute for its counters and latency histograms. Answered
+ * with MSG_STATS_RESPONSE as soon as it is read, ahead of queued requests.
+ * This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header with
+ * msg_type = MSG_STATS_REQUEST):
+ * - request_id: 8 bytes (uint64, echoed in the response)
+ */
+typedef struct {
+    uint64_t request_id;  /**< Request ID */
+} stats_request_t;
+
+/**
+ * SD 3.5 Prepare Request
+ *
+ * Sent while the prompt of a generation request is still being written,
+ * e.g. by the LLM. weave-compute gets the model, the context and the
+ * response buffers ready for it, so the generation request that follows
+ * starts warm. There is no reply; the generation request is answered as
+ * usual whether or not it matches. Header flags are the ones the
+ * generation request will set. This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header with
+ * msg_type = MSG_PREPARE):
+ * - request_id: 8 bytes (uint64, request it prepares for; 0 if not known yet)
+ * - model_id: 4 bytes (uint32)
+ * - width: 4 bytes (uint32)
+ * - height: 4 bytes (uint32)
+ * - clip_l_offset, clip_l_length: 4 bytes each (uint32)
+ * - clip_g_offset, clip_g_length: 4 bytes each (uint32)
+ * - t5_offset, t5_length: 4 bytes each (uint32)
+ * - prompt_data: variable bytes (prompts may be empty or partial)
+ */
+typedef struct {
+    uint64_t request_id;     /**< Request it prepares for (0 = not known yet) */
+    uint32_t model_id;       /**< Model identifier (MODEL_ID_SD35-MODEL_ID_SD35_MAX) */
+    uint32_t width;          /**< Image width in pixels */
+    uint32_t height;         /**< Image height in pixels */
+
+    uint32_t clip_l_offset;  /**< Byte offset of CLIP-L prompt */
+    uint32_t clip_l_length;  /**< Byte length of CLIP-L prompt (may be 0) */
+    uint32_t clip_g_offset;  /**< Byte offset of CLIP-G prompt */
+    uint32_t clip_g_length;  /**< Byte length of CLIP-G prompt (may be 0) */
+    uint32_t t5_offset;      /**< Byte offset of T5 prompt */
+    uint32_t t5_length;      /**< Byte length of T5 prompt (may be 0) */
+
+    /* Prompt data (not owned by this struct) */
+    const uint8_t *prompt_data;  /**< Pointer to prompt data buffer */
+    size_t prompt_data_len;      /**< Total size of prompt data */
+} sd35_prepare_request_t;
+
+/**
+ * Latency histogram of one timing stage over completed requests
+ */
+typedef struct {
+    uint64_t count;       /**< Requests recorded */
+    uint64_t sum_us;      /**< Sum of their durations */
+    uint64_t buckets[STATS_HISTOGRAM_BUCKETS]; /**< Requests per bucket (not cumulative) */
+} stats_histogram_t;
+
+/**
+ * Count of replies with one error code
+ */
+typedef struct {
+    uint32_t code;        /**< Error code (error_code_t) */
+    uint64_t count;       /**< Replies with this code */
+} stats_error_count_t;
+
+/**
+ * Stats Response
+ *
+ * This struct is NOT for wire format.
+ *
+ * Wire format payload structure (after common header with
+ * msg_type = MSG_STATS_RESPONSE):
+ * - request_id: 8 bytes (uint64, echoed from request)
+ * - status: 4 bytes (uint32, STATUS_OK)
+ * - uptime_ms: 8 bytes (uint64)
+ * - requests: 8 bytes (uint64, generation requests read)
+ * - completed: 8 bytes (uint64, answered successfully)
+ * - queue_depth: 4 bytes (uint32, read and waiting for a GPU)
+ * - in_flight: 4 bytes (uint32, generating)
+ * - vram_bytes: 8 bytes (uint64, loaded models on every device)
+ * - pool_hits: 8 bytes (uint64, buffer pool gets served by a recycled buffer)
+ * - pool_misses: 8 bytes (uint64, buffer pool gets that allocated)
+ * - pool_idle_bytes: 8 bytes (uint64, held by the buffer pool for reuse)
+ * - class_count: 4 bytes (uint32, SD35_PRIORITY_COUNT), then per priority
+ *   class: queue_depth (4, waiting for a GPU) and wait_ms (4, estimated
+ *   wait of a request of that class read now; 0 until a generation was
+ *   timed)
+ * - error_count: 4 bytes (uint32), then per error: code (4), count (8)
+ * - bucket_count: 4 bytes (uint32), then per bucket its inclusive upper
+ *   bound in microseconds (8, the last is UINT64_MAX)
+ * - histogram_count: 4 bytes (uint32), then per histogram: stage (4),
+ *   count (8), sum_us (8), bucket_count * 8 bucket counts
+ */
+typedef struct {
+    uint64_t request_id;          /**< Request ID (echoed from request) */
+    uint32_t status;              /**< Status code (STATUS_OK = 200) */
+    uint64_t uptime_ms;           /**< Time since the counters started */
+    uint64_t requests;            /**< Generation requests read */
+    uint64_t completed;           /**< Requests answered successfully */
+    uint32_t queue_depth;         /**< Requests waiting for a GPU */
+    uint32_t in_flight;           /**< Requests generating */
+    uint64_t vram_bytes;          /**< VRAM of the loaded models */
+    uint64_t pool_hits;           /**< Buffer pool gets served by a recycled buffer */
+    uint64_t pool_misses;         /**< Buffer pool gets that allocated */
+    uint64_t pool_idle_bytes;     /**< Bytes the buffer pool holds for reuse */
+    uint32_t class_queue_depth[SD35_PRIORITY_COUNT]; /**< Waiting per sd35_priority_t */
+    uint32_t class_wait_ms[SD35_PRIORITY_COUNT];     /**< Estimated wait per sd35_priority_t */
+    uint32_t error_count;         /**< Entries in errors */
+    stats_error_count_t errors[STATS_MAX_ERROR_CODES]; /**< Non-zero error counts */
+    uint64_t bucket_bounds_us[STATS_HISTOGRAM_BUCKETS]; /**< Upper bound per bucket */
+    stats_histogram_t histograms[TIMING_STAGE_COUNT];   /**< Per timing_stage_t */
+} stats_response_t;
+
 /**
  * Error Response
  *
@@ -258,6 +781,88 @@ typedef struct {
  * Encoding and Decoding Functions
  */
 
+/**
+ * decode_header - Decode and validate the common protocol header
+ *
+ * Checks magic, version and payload length, but not the message type. The
+ * header is filled in even on failure. A reader that has validated the
+ * header this way decodes the payload with the *_payload functions below
+ * instead of handing the whole message to decode_generate_request() and
+ * friends, which would parse the header again.
+ *
+ * @param data      Input buffer (at least 16 bytes)
+ * @param data_len  Size of input buffer
+ * @param header    Output header structure
+ * @return          ERR_NONE, ERR_INVALID_MAGIC, ERR_UNSUPPORTED_VERSION, or
+ *                  ERR_INTERNAL (NULL pointer, short buffer, payload too large)
+ */
+error_code_t decode_header(const uint8_t *data, size_t data_len,
+                           protocol_header_t *header);
+
+/**
+ * decode_generate_request_payload - Decode a generation request's payload
+ *
+ * @param header   Header validated by decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure (ERR_INTERNAL
+ *                 if header->msg_type is not MSG_GENERATE_REQUEST)
+ */
+error_code_t decode_generate_request_payload(const protocol_header_t *header,
+                                             const uint8_t *payload,
+                                             sd35_generate_request_t *req);
+
+/**
+ * decode_generate_batch_request_payload - Decode a batch request's payload
+ *
+ * @param header   Header validated by decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure (ERR_INTERNAL
+ *                 if header->msg_type is not MSG_GENERATE_BATCH_REQUEST)
+ */
+error_code_t decode_generate_batch_request_payload(const protocol_header_t *header,
+                                                   const uint8_t *payload,
+                                                   sd35_generate_batch_request_t *req);
+
+/**
+ * decode_prepare_request_payload - Decode a prepare request's payload
+ *
+ * @param header   Header validated by decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure
+ *
+ * Error codes: as decode_prepare_request(), except header checks.
+ */
+error_code_t decode_prepare_request_payload(const protocol_header_t *header,
+                                            const uint8_t *payload,
+                                            sd35_prepare_request_t *req);
+
+/**
+ * decode_cancel_request_payload - Decode a cancel request's payload
+ *
+ * @param header   Header validated by decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t decode_cancel_request_payload(const protocol_header_t *header,
+                                           const uint8_t *payload,
+                                           cancel_request_t *req);
+
+/**
+ * decode_stats_request_payload - Decode a stats request's payload
+ *
+ * @param header   Header validated by decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t decode_stats_request_payload(const protocol_header_t *header,
+                                          const uint8_t *payload,
+                                          stats_request_t *req);
+
 /**
  * decode_generate_request - Decode and validate SD 3.5 generation request
  *
@@ -269,6 +874,42 @@ typedef struct {
 error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
                                      sd35_generate_request_t *req);
 
+/**
+ * encode_generate_response_prefix - Encode a generation response up to the pixels
+ *
+ * Writes SD35_RESPONSE_PREFIX_SIZE bytes. The encoded message is this prefix
+ * followed by resp->image_data, which the caller sends without copying (e.g.
+ * with writev).
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer (at least SD35_RESPONSE_PREFIX_SIZE bytes)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store prefix length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_response_prefix(const sd35_generate_response_t *resp,
+                                             uint8_t *buffer, size_t buf_size,
+                                             size_t *out_len);
+
+/**
+ * encode_generate_response_head - Encode a version 2 generation response head
+ *
+ * Writes SD35_RESPONSE_HEAD_SIZE bytes: the response prefix with version 2
+ * and the given flags, followed by the image data length as a uint64.
+ * payload_len covers only the head. resp->image_data follows in MSG_CHUNK
+ * frames (PROTOCOL_FLAG_CHUNKED) or in a memfd (PROTOCOL_FLAG_SHM).
+ *
+ * @param resp      Response structure to encode
+ * @param flags     PROTOCOL_FLAG_CHUNKED or PROTOCOL_FLAG_SHM
+ * @param buffer    Output buffer (at least SD35_RESPONSE_HEAD_SIZE bytes)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store head length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_response_head(const sd35_generate_response_t *resp,
+                                           uint32_t flags, uint8_t *buffer,
+                                           size_t buf_size, size_t *out_len);
+
 /**
  * encode_generate_response - Encode SD 3.5 generation response
  *
@@ -282,6 +923,166 @@ error_code_t encode_generate_response(const sd35_generate_response_t *resp,
                                       uint8_t *buffer, size_t buf_size,
                                       size_t *out_len);
 
+/**
+ * decode_generate_batch_request - Decode and validate SD 3.5 batch request
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_generate_batch_request(const uint8_t *data, size_t data_len,
+                                           sd35_generate_batch_request_t *req);
+
+/**
+ * decode_cancel_request - Decode a cancel request
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_cancel_request(const uint8_t *data, size_t data_len,
+                                   cancel_request_t *req);
+
+/**
+ * decode_prepare_request - Decode and validate a prepare request
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INVALID_MODEL_ID: model_id is not an SD 3.5 family ID
+ * - ERR_INVALID_DIMENSIONS: width/height out of range or not aligned
+ * - ERR_INVALID_PROMPT: a prompt is too long or out of bounds
+ * - ERR_INTERNAL: Truncated message or other structural error
+ */
+error_code_t decode_prepare_request(const uint8_t *data, size_t data_len,
+                                    sd35_prepare_request_t *req);
+
+/**
+ * decode_stats_request - Decode a stats request
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_stats_request(const uint8_t *data, size_t data_len,
+                                  stats_request_t *req);
+
+/**
+ * move_payload_tail_to_shm - Rewrite an encoded header for a shared-memory tail
+ *
+ * Subtracts tail_len from payload_len and sets PROTOCOL_FLAG_SHM, for a
+ * message whose last tail_len payload bytes are sent in a memfd instead of
+ * inline.
+ *
+ * @param header    Encoded message header (16 bytes, modified in place)
+ * @param tail_len  Payload bytes moved to shared memory
+ * @return          ERR_NONE on success, ERR_INTERNAL if header is NULL or
+ *                  tail_len exceeds payload_len
+ */
+error_code_t move_payload_tail_to_shm(uint8_t *header, uint32_t tail_len);
+
+/**
+ * encode_generate_batch_response_prefix - Encode a batch response up to the pixels
+ *
+ * Writes SD35_BATCH_RESPONSE_PREFIX_SIZE bytes. The encoded message is this
+ * prefix followed by resp->images[0..image_count) in order.
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer (at least SD35_BATCH_RESPONSE_PREFIX_SIZE bytes)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store prefix length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_batch_response_prefix(const sd35_generate_batch_response_t *resp,
+                                                   uint8_t *buffer, size_t buf_size,
+                                                   size_t *out_len);
+
+/**
+ * encode_generate_batch_response_head - Encode a version 2 batch response head
+ *
+ * Writes SD35_BATCH_RESPONSE_HEAD_SIZE bytes, like
+ * encode_generate_response_head(). The data length is
+ * image_count * image_data_len.
+ *
+ * @param resp      Response structure to encode
+ * @param flags     PROTOCOL_FLAG_CHUNKED or PROTOCOL_FLAG_SHM
+ * @param buffer    Output buffer (at least SD35_BATCH_RESPONSE_HEAD_SIZE bytes)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store head length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_batch_response_head(const sd35_generate_batch_response_t *resp,
+                                                 uint32_t flags, uint8_t *buffer,
+                                                 size_t buf_size, size_t *out_len);
+
+/**
+ * encode_chunk_header - Encode the 16-byte header of a MSG_CHUNK frame
+ *
+ * @param chunk_len  Data bytes following the header (1 to PROTOCOL_MAX_CHUNK_SIZE)
+ * @param buffer     Output buffer (at least 16 bytes)
+ * @param buf_size   Size of output buffer in bytes
+ * @return           ERR_NONE on success, ERR_INTERNAL on invalid arguments
+ */
+error_code_t encode_chunk_header(uint32_t chunk_len, uint8_t *buffer, size_t buf_size);
+
+/**
+ * encode_generate_batch_response - Encode SD 3.5 batch generation response
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_batch_response(const sd35_generate_batch_response_t *resp,
+                                            uint8_t *buffer, size_t buf_size,
+                                            size_t *out_len);
+
+/**
+ * encode_generate_progress - Encode SD 3.5 generation progress frame
+ *
+ * @param progress  Progress structure to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t encode_generate_progress(const sd35_generate_progress_t *progress,
+                                      uint8_t *buffer, size_t buf_size,
+                                      size_t *out_len);
+
+/**
+ * encode_generate_timings - Encode a MSG_GENERATE_TIMINGS frame
+ *
+ * @param timings   Timings to encode
+ * @param buffer    Output buffer (SD35_TIMINGS_MAX_SIZE bytes is always enough)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t encode_generate_timings(const sd35_generate_timings_t *timings,
+                                     uint8_t *buffer, size_t buf_size,
+                                     size_t *out_len);
+
+/**
+ * encode_stats_response - Encode a MSG_STATS_RESPONSE frame
+ *
+ * @param resp      Stats to encode
+ * @param buffer    Output buffer (STATS_RESPONSE_MAX_SIZE bytes is always enough)
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t encode_stats_response(const stats_response_t *resp,
+                                   uint8_t *buffer, size_t buf_size,
+                                   size_t *out_len);
+
 /**
  * encode_error_response - Encode error response
  *
@@ -0,0 +1,126 @@
+/**
+ * Weave Queue Module - Bounded Blocking Work Queue
+ *
+ * A fixed-capacity FIFO of opaque pointers shared between threads. It
+ * connects the stages of the request pipeline (pipeline.h: prepare, GPU
+ * worker, writer) and provides backpressure: a producer blocks while the
+ * queue is full, a consumer blocks while it is empty.
+ *
+ * Priorities:
+ * - work_queue_push_priority() tags an item with a priority, 0 the most
+ *   urgent; work_queue_push() uses priority 0
+ * - work_queue_pop() returns the oldest item of the most urgent priority
+ *   queued, so items of one priority stay in FIFO order
+ * - Strict: a steady stream of urgent items starves the others
+ *
+ * Shutdown:
+ * - work_queue_close() wakes every waiter and rejects further pushes
+ * - Items already queued are still delivered by work_queue_pop()
+ * - work_queue_pop() returns QUEUE_ERR_CLOSED once closed and drained
+ *
+ * Ownership model:
+ * - The queue never dereferences or frees items
+ * - An item belongs to the queue between a successful push and its pop
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * Queue Error Codes
+ */
+typedef enum {
+    QUEUE_OK = 0,                     /**< Success */
+    QUEUE_ERR_NULL_POINTER = -1,      /**< NULL pointer argument */
+    QUEUE_ERR_INVALID_CAPACITY = -2,  /**< Capacity is zero */
+    QUEUE_ERR_OUT_OF_MEMORY = -3,     /**< Failed to allocate slots */
+    QUEUE_ERR_INIT_FAILED = -4,       /**< Failed to initialize mutex or condvar */
+    QUEUE_ERR_CLOSED = -5,            /**< Queue closed (and drained, for pop) */
+} queue_error_t;
+
+/**
+ * Bounded work queue.
+ *
+ * Fields are private; embed or allocate the struct and use the functions
+ * below.
+ */
+typedef struct {
+    void **slots;                     /* Ring buffer of capacity items */
+    unsigned *priorities;             /* Priority of each slot */
+    size_t capacity;                  /* Maximum queued items */
+    size_t head;                      /* Index of the next item to pop */
+    size_t count;                     /* Items currently queued */
+    int closed;                       /* Set by work_queue_close() */
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} work_queue_t;
+
+/**
+ * work_queue_init - Initialize an empty queue
+ *
+ * @param queue     Queue to initialize
+ * @param capacity  Maximum queued items (at least 1)
+ * @return          QUEUE_OK on success, error code on failure
+ */
+queue_error_t work_queue_init(work_queue_t *queue, size_t capacity);
+
+/**
+ * work_queue_destroy - Release queue resources
+ *
+ * Items still queued are not freed. No thread may be blocked on the queue.
+ *
+ * @param queue  Queue to destroy (NULL safe)
+ */
+void work_queue_destroy(work_queue_t *queue);
+
+/**
+ * work_queue_push - Append an item, blocking while the queue is full
+ *
+ * @param queue  Queue to push onto
+ * @param item   Item to append (may be NULL)
+ * @return       QUEUE_OK on success, QUEUE_ERR_CLOSED if the queue is closed
+ *               (the item was not queued), or QUEUE_ERR_NULL_POINTER
+ */
+queue_error_t work_queue_push(work_queue_t *queue, void *item);
+
+/**
+ * work_queue_push_priority - Append an item with a priority, blocking while
+ * the queue is full
+ *
+ * @param queue     Queue to push onto
+ * @param item      Item to append (may be NULL)
+ * @param priority  Priority, lower pops first (work_queue_push() uses 0)
+ * @return          As work_queue_push()
+ */
+queue_error_t work_queue_push_priority(work_queue_t *queue, void *item, unsigned priority);
+
+/**
+ * work_queue_pop - Remove the oldest item of the most urgent priority,
+ * blocking while the queue is empty
+ *
+ * @param queue  Queue to pop from
+ * @param item   Output item
+ * @return       QUEUE_OK on success, QUEUE_ERR_CLOSED once the queue is closed
+ *               and empty, or QUEUE_ERR_NULL_POINTER
+ */
+queue_error_t work_queue_pop(work_queue_t *queue, void **item);
+
+/**
+ * work_queue_close - Stop accepting items and wake all waiters
+ *
+ * Idempotent. Consumers keep receiving queued items until the queue drains.
+ *
+ * @param queue  Queue to close (NULL safe)
+ */
+void work_queue_close(work_queue_t *queue);
+
+/**
+ * queue_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *queue_error_string(queue_error_t err);
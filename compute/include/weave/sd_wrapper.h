@@ -16,6 +16,12 @@
 extern "C" {
 #endif
 
+/** Maximum images per sd_wrapper_generate_batch() call */
+#define SD_WRAPPER_MAX_BATCH 8
+
+/** Most sampling steps timed per generation (100 per pass, one pass per seed) */
+#define SD_WRAPPER_MAX_TIMED_STEPS (100 * SD_WRAPPER_MAX_BATCH)
+
 /**
  * Error codes returned by wrapper functions.
  */
@@ -28,8 +34,26 @@ typedef enum {
     SD_WRAPPER_ERR_GPU_ERROR = -5,
     SD_WRAPPER_ERR_INIT_FAILED = -6,
     SD_WRAPPER_ERR_GENERATION_FAILED = -7,
+    SD_WRAPPER_ERR_CANCELLED = -8,
 } sd_wrapper_error_t;
 
+/**
+ * Reset modes for sd_wrapper_reset_mode().
+ */
+typedef enum {
+    SD_WRAPPER_RESET_FULL = 0,        /* Destroy and recreate sd_ctx (reloads weights from disk) */
+    SD_WRAPPER_RESET_COMPUTE = 1,     /* Keep the context if reuse_context, else as FULL */
+} sd_wrapper_reset_mode_t;
+
+/**
+ * Weight types for sd_wrapper_config_t.weight_type.
+ */
+typedef enum {
+    SD_WRAPPER_WTYPE_F16 = 0,         /* 16-bit floats */
+    SD_WRAPPER_WTYPE_Q8_0 = 1,        /* 8-bit blocks, ~53% of F16 */
+    SD_WRAPPER_WTYPE_Q4_0 = 2,        /* 4-bit blocks, ~28% of F16 */
+} sd_wrapper_wtype_t;
+
 /**
  * Opaque context for SD wrapper.
  * Holds stable-diffusion.cpp context and configuration.
@@ -49,8 +73,86 @@ typedef struct {
     bool keep_clip_on_cpu;            /* Keep text encoders on CPU (saves VRAM) */
     bool keep_vae_on_cpu;             /* Keep VAE on CPU (saves VRAM) */
     bool enable_flash_attn;           /* Enable flash attention (faster) */
+    int device_index;                 /* Vulkan device index (-1 for library default) */
+    bool prepare_weights;             /* Load from prepared GGUF files (see sd_wrapper_create()) */
+    sd_wrapper_wtype_t weight_type;   /* Type weights are converted to on load */
+    uint32_t vae_tile_pixels;         /* AUTO tiling above this many pixels (0 = never) */
+    float step_cache_threshold;       /* AUTO step caching threshold (0 = off, else up to 1.0) */
+    bool reuse_context;               /* Opt-in: compute resets keep the context (see sd_wrapper_reset_mode()) */
 } sd_wrapper_config_t;
 
+/**
+ * VAE decode tiling for sd_wrapper_gen_params_t.vae_tiling.
+ *
+ * A tiled decode runs the VAE on overlapping latent tiles and blends them
+ * into the output image, so its compute memory depends on the tile size
+ * instead of the image size. It is slower than a one-pass decode and used
+ * only when the one-pass decode would not fit.
+ */
+typedef enum {
+    SD_WRAPPER_VAE_TILING_AUTO = 0,   /* Tile above the context's vae_tile_pixels */
+    SD_WRAPPER_VAE_TILING_OFF = 1,    /* Always decode in one pass */
+    SD_WRAPPER_VAE_TILING_ON = 2,     /* Always tile */
+} sd_wrapper_vae_tiling_t;
+
+/**
+ * Step caching for sd_wrapper_gen_params_t.step_cache.
+ *
+ * Adjacent sampling steps do much the same transformer work. With step
+ * caching, stable-diffusion.cpp's EasyCache skips a step's transformer pass
+ * and reuses the previous step's output change while the accumulated
+ * relative change of the transformer input stays below the threshold.
+ * Higher thresholds reuse more steps: faster, further from the uncached
+ * image. Useful at 20+ steps; few-step models have nothing to reuse.
+ */
+typedef enum {
+    SD_WRAPPER_STEP_CACHE_AUTO = 0,   /* Use the context's step_cache_threshold */
+    SD_WRAPPER_STEP_CACHE_OFF = 1,    /* Run every step */
+    SD_WRAPPER_STEP_CACHE_ON = 2,     /* Use the params' step_cache_threshold */
+} sd_wrapper_step_cache_t;
+
+/**
+ * Sampling method for sd_wrapper_gen_params_t.sampler.
+ *
+ * Values match sd35_sampler_t in protocol.h. DEFAULT uses the model's own
+ * choice (Euler for SD 3.5).
+ */
+typedef enum {
+    SD_WRAPPER_SAMPLER_DEFAULT = 0,
+    SD_WRAPPER_SAMPLER_EULER = 1,
+    SD_WRAPPER_SAMPLER_EULER_A = 2,
+    SD_WRAPPER_SAMPLER_HEUN = 3,
+    SD_WRAPPER_SAMPLER_DPM2 = 4,
+    SD_WRAPPER_SAMPLER_DPMPP_2S_A = 5,
+    SD_WRAPPER_SAMPLER_DPMPP_2M = 6,
+    SD_WRAPPER_SAMPLER_DPMPP_2M_V2 = 7,
+    SD_WRAPPER_SAMPLER_IPNDM = 8,
+    SD_WRAPPER_SAMPLER_IPNDM_V = 9,
+    SD_WRAPPER_SAMPLER_LCM = 10,
+    SD_WRAPPER_SAMPLER_DDIM_TRAILING = 11,
+    SD_WRAPPER_SAMPLER_TCD = 12,
+    SD_WRAPPER_SAMPLER_COUNT = 13,    /* Number of samplers, not a sampler */
+} sd_wrapper_sampler_t;
+
+/**
+ * Noise schedule for sd_wrapper_gen_params_t.scheduler.
+ *
+ * Values match sd35_scheduler_t in protocol.h. DEFAULT uses the model's
+ * choice for the selected sampler.
+ */
+typedef enum {
+    SD_WRAPPER_SCHEDULER_DEFAULT = 0,
+    SD_WRAPPER_SCHEDULER_DISCRETE = 1,
+    SD_WRAPPER_SCHEDULER_KARRAS = 2,
+    SD_WRAPPER_SCHEDULER_EXPONENTIAL = 3,
+    SD_WRAPPER_SCHEDULER_AYS = 4,
+    SD_WRAPPER_SCHEDULER_GITS = 5,
+    SD_WRAPPER_SCHEDULER_SGM_UNIFORM = 6,
+    SD_WRAPPER_SCHEDULER_SIMPLE = 7,
+    SD_WRAPPER_SCHEDULER_SMOOTHSTEP = 8,
+    SD_WRAPPER_SCHEDULER_COUNT = 9,   /* Number of schedulers, not a scheduler */
+} sd_wrapper_scheduler_t;
+
 /**
  * Parameters for image generation.
  */
@@ -63,6 +165,14 @@ typedef struct {
     float cfg_scale;                  /* Guidance scale (0.0-20.0) */
     int64_t seed;                     /* Random seed (0 for random) */
     int clip_skip;                    /* CLIP skip layers (0 for default) */
+    sd_wrapper_vae_tiling_t vae_tiling; /* VAE decode tiling (AUTO by default) */
+    uint32_t vae_tile_size;           /* Tile edge in latent pixels (0 for default, else 16-128) */
+    sd_wrapper_sampler_t sampler;     /* Sampling method (DEFAULT for the model's) */
+    sd_wrapper_scheduler_t scheduler; /* Noise schedule (DEFAULT for the model's) */
+    sd_wrapper_step_cache_t step_cache; /* Step caching (AUTO by default) */
+    float step_cache_threshold;       /* ON only: reuse threshold (0 for default, else up to 1.0) */
+    const uint8_t* init_image;        /* RGB, width x height, to refine (NULL for txt2img) */
+    float strength;                   /* init_image only: how far to move from it (0.0-1.0] */
 } sd_wrapper_gen_params_t;
 
 /**
@@ -76,6 +186,50 @@ typedef struct {
     size_t data_size;                 /* Size of data buffer in bytes */
 } sd_wrapper_image_t;
 
+/**
+ * Mid-generation progress report.
+ */
+typedef struct {
+    uint32_t step;                    /* Sampling step just completed (1-based) */
+    uint32_t total_steps;             /* Total sampling steps */
+    const sd_wrapper_image_t* preview; /* Latent preview (NULL if none, borrowed) */
+} sd_wrapper_progress_t;
+
+/**
+ * Progress callback.
+ *
+ * Called synchronously from inside sd_wrapper_generate() on the generating
+ * thread. The preview image is only valid for the duration of the call.
+ */
+typedef void (*sd_wrapper_progress_fn)(const sd_wrapper_progress_t* progress,
+                                       void* user_data);
+
+/**
+ * Abort callback.
+ *
+ * Polled on the generating thread before each diffusion pass and at every
+ * sampling step. Return true to abandon the running generation.
+ */
+typedef bool (*sd_wrapper_abort_fn)(void* user_data);
+
+/**
+ * Stage timings of the last generation.
+ *
+ * stable-diffusion.cpp runs text encoding, sampling and decoding inside one
+ * generate_image() call, so stage boundaries come from the step callback:
+ * text encoding is everything before the first sampling step (including
+ * latent setup), decoding everything after the last one. With one pass per
+ * seed the stages are summed over the passes.
+ */
+typedef struct {
+    uint64_t reset_us;                /* Resets since the previous generation */
+    uint64_t text_encode_us;          /* Prompt encoding */
+    uint64_t sampling_us;             /* Diffusion sampling */
+    uint64_t vae_decode_us;           /* Latent decode */
+    uint32_t step_count;              /* Entries in step_us */
+    uint32_t step_us[SD_WRAPPER_MAX_TIMED_STEPS]; /* Duration of each sampling step */
+} sd_wrapper_timings_t;
+
 /**
  * Initialize wrapper configuration with defaults.
  *
@@ -102,8 +256,18 @@ void sd_wrapper_gen_params_init(sd_wrapper_gen_params_t* params);
  * @param config  Configuration for model loading
  * @return        Context on success, NULL on failure
  *
+ * With config->prepare_weights, each .safetensors weight file is converted
+ * once to a GGUF in config->weight_type next to it (see weave/prepared_model.h), and this
+ * context and its full resets load the prepared files instead. A missing or
+ * stale prepared file is re-created first, which takes as long as a
+ * conversion; a file that cannot be prepared (read-only directory, full
+ * disk) is loaded from its source as without the option. Writing needs free
+ * space for a converted copy of every weight file.
+ *
  * @note Model remains loaded until sd_wrapper_free() is called
  * @note This function may take several seconds to complete
+ * @note Contexts on different devices may be used concurrently, one
+ *       generating thread per context
  */
 sd_wrapper_ctx_t* sd_wrapper_create(const sd_wrapper_config_t* config);
 
@@ -128,12 +292,39 @@ void sd_wrapper_free(sd_wrapper_ctx_t* ctx);
  * @return        SD_WRAPPER_OK on success, error code on failure
  *
  * @note image->data must be freed by caller using free()
+ * @note image->data is the buffer stable-diffusion.cpp decoded into; it is
+ *       handed over without a copy
+ * @note stable-diffusion.cpp computes conditioning inside generate_image()
+ *       and its C API cannot accept precomputed tensors, so a cache hit is
+ *       counted but text encoding still runs
  * @note Generation time depends on steps and resolution (1-10s typical)
  */
 sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
                                         const sd_wrapper_gen_params_t* params,
                                         sd_wrapper_image_t* image);
 
+/**
+ * Generate one image per seed from a single prompt.
+ *
+ * The prompt is encoded once and the context is not reset between images.
+ * Consecutive seeds (seeds[i] == seeds[0] + i) run as one stable-diffusion.cpp
+ * batch; other seed lists run one diffusion pass per seed.
+ *
+ * @param ctx     SD wrapper context (must not be NULL)
+ * @param params  Generation parameters (params->seed is ignored)
+ * @param seeds   Seed per output image
+ * @param count   Number of seeds/images (1-SD_WRAPPER_MAX_BATCH)
+ * @param images  Output array of count images (caller must free each)
+ * @return        SD_WRAPPER_OK on success, error code on failure
+ *
+ * @note On failure no images are returned (all partial results are freed)
+ */
+sd_wrapper_error_t sd_wrapper_generate_batch(sd_wrapper_ctx_t* ctx,
+                                              const sd_wrapper_gen_params_t* params,
+                                              const int64_t* seeds,
+                                              uint32_t count,
+                                              sd_wrapper_image_t* images);
+
 /**
  * Free image data allocated by sd_wrapper_generate().
  *
@@ -149,6 +340,111 @@ void sd_wrapper_free_image(sd_wrapper_image_t* image);
  */
 const char* sd_wrapper_get_error(sd_wrapper_ctx_t* ctx);
 
+/**
+ * Get stage timings of the last sd_wrapper_generate() or
+ * sd_wrapper_generate_batch() call.
+ *
+ * Times come from a monotonic clock and cover failed and cancelled
+ * generations up to the point they stopped. reset_us is the time spent in
+ * sd_wrapper_reset_mode() between the previous generation and this one,
+ * less any time already taken by sd_wrapper_take_reset_time().
+ *
+ * @param ctx      SD wrapper context
+ * @param timings  Output timings
+ * @return         SD_WRAPPER_OK on success, error code on failure
+ */
+sd_wrapper_error_t sd_wrapper_get_timings(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_timings_t* timings);
+
+/**
+ * Register a progress callback for subsequent generations.
+ *
+ * Step reports come from stable-diffusion.cpp's sampler. When
+ * preview_interval is non-zero, every preview_interval steps also carry a
+ * preview projected directly from the latents (no VAE decode), at 1/8 of
+ * the output resolution.
+ *
+ * stable-diffusion.cpp callbacks are process-wide. The wrapper routes them
+ * to the context generating on the calling thread, so each context can have
+ * its own callback; the preview interval is shared, and the last non-zero
+ * value registered applies to every context.
+ *
+ * @param ctx               SD wrapper context (must not be NULL)
+ * @param fn                Callback (NULL to disable progress reporting)
+ * @param user_data         Passed through to fn
+ * @param preview_interval  Steps between previews (0 = no previews)
+ * @return                  SD_WRAPPER_OK on success, error code on failure
+ */
+sd_wrapper_error_t sd_wrapper_set_progress_callback(sd_wrapper_ctx_t* ctx,
+                                                     sd_wrapper_progress_fn fn,
+                                                     void* user_data,
+                                                     uint32_t preview_interval);
+
+/**
+ * Register an abort callback for subsequent generations.
+ *
+ * Once fn returns true, sd_wrapper_generate() and sd_wrapper_generate_batch()
+ * stop reporting progress, skip any remaining diffusion passes and return
+ * SD_WRAPPER_ERR_CANCELLED with no images. A cancelled generation does not
+ * force a full reset: a compute reset still keeps a reuse_context context.
+ *
+ * Shares stable-diffusion.cpp's process-wide step callback with
+ * sd_wrapper_set_progress_callback().
+ *
+ * @param ctx        SD wrapper context (must not be NULL)
+ * @param fn         Callback (NULL to disable)
+ * @param user_data  Passed through to fn
+ * @return           SD_WRAPPER_OK on success, error code on failure
+ *
+ * @note stable-diffusion.cpp's C API cannot stop a generate_image() call from
+ *       a callback, so a pass that is already sampling when fn fires runs to
+ *       completion and its images are discarded
+ */
+sd_wrapper_error_t sd_wrapper_set_abort_callback(sd_wrapper_ctx_t* ctx,
+                                                  sd_wrapper_abort_fn fn,
+                                                  void* user_data);
+
+/**
+ * Query a Vulkan device's memory.
+ *
+ * Used to size a configuration before any context exists (see
+ * weave/vram_plan.h).
+ *
+ * @param device_index  Vulkan device index (-1 for SD_VK_DEVICE, else device 0)
+ * @param free_bytes    Output memory available for allocations
+ * @param total_bytes   Output size of the device-local heap
+ * @return              SD_WRAPPER_OK, SD_WRAPPER_ERR_INVALID_PARAM for NULL
+ *                      outputs, SD_WRAPPER_ERR_GPU_ERROR if there is no such
+ *                      device
+ *
+ * @note Free memory comes from VK_EXT_memory_budget where the driver supports
+ *       it. Without it, free_bytes is the whole heap.
+ */
+sd_wrapper_error_t sd_wrapper_get_device_memory(int device_index,
+                                                 size_t* free_bytes,
+                                                 size_t* total_bytes);
+
+/**
+ * Keep compiled Vulkan pipelines in a directory across runs.
+ *
+ * ggml's Vulkan backend creates its compute pipelines without a
+ * VkPipelineCache and offers no hook to pass one, so the first generation
+ * of every run compiles each shader again. The NVIDIA and Mesa drivers keep
+ * their own on-disk pipeline caches. This points both at dir and raises
+ * their size limits so all of ggml's pipelines fit. Variables the user has
+ * already set are left alone.
+ *
+ * Process-wide. Must be called before the first sd_wrapper_create() or
+ * sd_wrapper_get_device_memory(), since drivers read the settings when
+ * Vulkan is first initialized.
+ *
+ * @param dir  Existing directory, writable by this process
+ * @return     SD_WRAPPER_OK on success, SD_WRAPPER_ERR_INVALID_PARAM for a
+ *             NULL or empty dir, SD_WRAPPER_ERR_OUT_OF_MEMORY if the
+ *             environment cannot be updated
+ */
+sd_wrapper_error_t sd_wrapper_set_pipeline_cache_dir(const char* dir);
+
 /**
  * Get model information.
  *
@@ -164,21 +460,71 @@ sd_wrapper_error_t sd_wrapper_get_model_info(sd_wrapper_ctx_t* ctx,
 /**
  * Reset the SD context to clean state.
  *
+ * Equivalent to sd_wrapper_reset_mode(ctx, SD_WRAPPER_RESET_FULL).
+ *
  * This function destroys and recreates the internal stable-diffusion.cpp
  * context to ensure clean state between generations.
  *
- * WORKAROUND: This is needed because stable-diffusion.cpp has a bug where
- * GGML compute buffers are not properly freed between generate_image() calls,
- * causing segfaults on subsequent generations with different prompt lengths.
- *
  * @param ctx  SD wrapper context (must not be NULL)
  * @return     SD_WRAPPER_OK on success, error code on failure
  *
  * @note This operation takes 2-3 seconds as the model must be reloaded.
- * @note Call this before each generation to avoid segfaults.
  */
 sd_wrapper_error_t sd_wrapper_reset(sd_wrapper_ctx_t* ctx);
 
+/**
+ * Reset the SD context between generations using the given mode.
+ *
+ * SD_WRAPPER_RESET_FULL destroys and recreates the stable-diffusion.cpp
+ * context, re-reading and re-converting every weight file from disk.
+ *
+ * SD_WRAPPER_RESET_COMPUTE is a full reset unless the context was created
+ * with reuse_context. With it, the stable-diffusion.cpp context and its
+ * already-uploaded weight tensors are kept: the context is created with
+ * free_params_immediately disabled, so weights survive generate_image(),
+ * and GGML compute buffers and graphs are allocated per run and released
+ * by stable-diffusion.cpp itself. reuse_context is opt-in because reusing
+ * a context has not been verified on hardware against bug 002 (see
+ * docs/bugs/002-segfault.md).
+ *
+ * WORKAROUND: Compute mode also escalates to a full reset when the context
+ * is missing or the previous generation failed, since a failed run may
+ * leave the backend in an unknown state.
+ *
+ * @param ctx   SD wrapper context (must not be NULL)
+ * @param mode  Reset mode
+ * @return      SD_WRAPPER_OK on success, error code on failure
+ *
+ * @note Full reset takes 2-3 seconds; a kept context does no disk I/O.
+ */
+sd_wrapper_error_t sd_wrapper_reset_mode(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_reset_mode_t mode);
+
+/**
+ * Whether generate_image() has run on this context since sd_wrapper_create().
+ *
+ * A fresh context must generate without a reset first, and every later
+ * generation needs one (see sd_wrapper_reset_mode()). Per context, so each
+ * GPU worker asks only about its own context.
+ *
+ * @param ctx  SD wrapper context
+ * @return     true once a generation has been attempted, false for NULL
+ */
+bool sd_wrapper_has_generated(const sd_wrapper_ctx_t* ctx);
+
+/**
+ * Take the reset time the next generation would report.
+ *
+ * For resets done outside a request, such as ahead of one: the time is
+ * returned to the caller and cleared, so the next generation's reset_us
+ * (see sd_wrapper_get_timings()) covers only its own resets.
+ *
+ * @param ctx  SD wrapper context
+ * @return     Microseconds spent in sd_wrapper_reset_mode() since the previous
+ *             generation or take, 0 for NULL
+ */
+uint64_t sd_wrapper_take_reset_time(sd_wrapper_ctx_t* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,182 @@
+/**
+ * Weave Server Stats Module - Request Accounting for Stats and Admission
+ *
+ * Keeps the request counters (stats.h) and the per-class queue estimates
+ * (admission.h) of one weave-compute in step, so each pipeline stage
+ * records a request with one call instead of updating both.
+ *
+ * Request lifecycle, one call per transition:
+ *   server_stats_received()   read from the socket
+ *   server_stats_admit()      passed to the GPU queue, or refused (SERVER_STATS_ERR_BUSY)
+ *   server_stats_started()    picked up by a GPU thread
+ *   server_stats_generated()  generation returned
+ *   server_stats_finished()   reply written
+ *
+ * A request answered before reaching a GPU thread (rejected, refused, or
+ * served from the result cache) calls server_stats_answered() instead of
+ * started() and generated(). A request generated without going through
+ * admission (one at a time, without the pipeline) passes a NULL ticket.
+ *
+ * Thread safety:
+ * - Every function may be called from any thread; stats_t and admission_t
+ *   each have their own lock
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "weave/admission.h"
+#include "weave/buffer_pool.h"
+#include "weave/protocol.h"
+#include "weave/stats.h"
+
+/**
+ * Server Stats Error Codes
+ */
+typedef enum {
+    SERVER_STATS_OK = 0,                 /**< Success */
+    SERVER_STATS_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    SERVER_STATS_ERR_INVALID_ARG = -2,   /**< Worker count below 1 or unknown class */
+    SERVER_STATS_ERR_INIT_FAILED = -3,   /**< Failed to initialize a mutex */
+    SERVER_STATS_ERR_BUSY = -4,          /**< Estimated completion is past the deadline */
+} server_stats_error_t;
+
+/**
+ * Where server_stats_admit() queued a request; passed back when it starts
+ * and when it is generated.
+ */
+typedef struct {
+    uint32_t priority;       /**< sd35_priority_t it was queued with */
+    uint64_t units;          /**< Admission cost it was queued with */
+} server_stats_ticket_t;
+
+/**
+ * Server statistics and admission state.
+ *
+ * Fields are private; embed or allocate the struct and use the functions
+ * below.
+ */
+typedef struct {
+    stats_t stats;
+    admission_t admission;
+} server_stats_t;
+
+/**
+ * server_stats_init - Initialize with no requests seen
+ *
+ * @param s        Server stats to initialize
+ * @param workers  GPU workers popping the generate queue (at least 1)
+ * @return         SERVER_STATS_OK, SERVER_STATS_ERR_NULL_POINTER,
+ *                 SERVER_STATS_ERR_INVALID_ARG or SERVER_STATS_ERR_INIT_FAILED
+ */
+server_stats_error_t server_stats_init(server_stats_t *s, int workers);
+
+/**
+ * server_stats_destroy - Release server stats resources
+ *
+ * @param s  Server stats to destroy (NULL safe)
+ */
+void server_stats_destroy(server_stats_t *s);
+
+/**
+ * server_stats_received - A generation request was read
+ *
+ * @param s  Server stats (NULL safe)
+ */
+void server_stats_received(server_stats_t *s);
+
+/**
+ * server_stats_admit - Queue a request for a device unless it would miss its deadline
+ *
+ * Costs the request (admission_request_units()) and counts it as queued
+ * under its priority class, unless its estimated wait plus generation time
+ * runs past deadline. A request already past its deadline is refused once
+ * any GPU time is known.
+ *
+ * @param s         Server stats
+ * @param req       Decoded request (the base of a batch request)
+ * @param images    Images it generates (1, or the batch's seed_count)
+ * @param deadline  CLOCK_MONOTONIC expiry, or NULL for none
+ * @param ticket    Output class and cost, for started() and generated()
+ * @param wait_us   Output estimated wait (may be NULL)
+ * @return          SERVER_STATS_OK (queued), SERVER_STATS_ERR_BUSY (not
+ *                  counted), SERVER_STATS_ERR_NULL_POINTER or
+ *                  SERVER_STATS_ERR_INVALID_ARG
+ */
+server_stats_error_t server_stats_admit(server_stats_t *s, const sd35_generate_request_t *req,
+                                        uint32_t images, const struct timespec *deadline,
+                                        server_stats_ticket_t *ticket, uint64_t *wait_us);
+
+/**
+ * server_stats_answered - A request was answered without reaching a GPU thread
+ *
+ * @param s  Server stats (NULL safe)
+ */
+void server_stats_answered(server_stats_t *s);
+
+/**
+ * server_stats_started - A request reached a GPU thread
+ *
+ * @param s       Server stats (NULL safe)
+ * @param ticket  From server_stats_admit(), or NULL if it was not admitted
+ */
+void server_stats_started(server_stats_t *s, const server_stats_ticket_t *ticket);
+
+/**
+ * server_stats_generated - A started request's generation returned
+ *
+ * The GPU stages of timings (reset to VAE decode) teach admission how fast
+ * the devices are.
+ *
+ * @param s        Server stats (NULL safe)
+ * @param ticket   As passed to server_stats_started()
+ * @param timings  Stage durations of a completed generation, or NULL if it
+ *                 failed, was aborted or was skipped
+ */
+void server_stats_generated(server_stats_t *s, const server_stats_ticket_t *ticket,
+                            const sd35_generate_timings_t *timings);
+
+/**
+ * server_stats_finished - The reply of a request was written
+ *
+ * @param s        Server stats (NULL safe)
+ * @param error    ERR_NONE for a successful reply, else its error code
+ * @param timings  Stage durations to add to the histograms (NULL to skip)
+ */
+void server_stats_finished(server_stats_t *s, error_code_t error,
+                           const sd35_generate_timings_t *timings);
+
+/**
+ * server_stats_set_vram - Record the VRAM held by a device's loaded models
+ *
+ * @param s       Server stats (NULL safe)
+ * @param device  Device slot (0 to STATS_MAX_DEVICES - 1, others ignored)
+ * @param bytes   VRAM in use
+ */
+void server_stats_set_vram(server_stats_t *s, int device, size_t bytes);
+
+/**
+ * server_stats_snapshot - Fill a stats response with the current values
+ *
+ * Adds the buffer pool counters and the per-class queue depth and wait
+ * estimates to the stats_snapshot() values.
+ *
+ * @param s           Server stats
+ * @param request_id  Request ID to echo
+ * @param pool        Buffer pool to report (NULL reports zeros)
+ * @param resp        Output response (status STATUS_OK)
+ * @return            SERVER_STATS_OK or SERVER_STATS_ERR_NULL_POINTER
+ */
+server_stats_error_t server_stats_snapshot(server_stats_t *s, uint64_t request_id,
+                                           buffer_pool_t *pool, stats_response_t *resp);
+
+/**
+ * server_stats_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *server_stats_error_string(server_stats_error_t err);
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <sys/uio.h>
 
 /**
  * Socket Error Codes
@@ -49,6 +50,9 @@ typedef enum {
     SOCKET_ERR_ACCEPT_FAILED = -15,   /**< Failed to accept connection */
     SOCKET_ERR_NULL_HANDLER = -16,    /**< NULL handler provided to accept loop */
     SOCKET_ERR_CONNECT_FAILED = -17,  /**< Failed to connect to socket */
+    SOCKET_ERR_SHM_FAILED = -18,      /**< Failed to create shared memory */
+    SOCKET_ERR_SEND_FAILED = -19,     /**< Failed to send on socket */
+    SOCKET_ERR_EPOLL_FAILED = -20,    /**< epoll setup or wait failed */
 } socket_error_t;
 
 /**
@@ -277,7 +281,7 @@ socket_error_t socket_set_timeouts(int fd, int read_timeout_s, int write_timeout
  *
  * This function is async-signal-safe and can be called from signal handlers.
  * After calling, socket_accept_loop() will exit after completing the current
- * connection (if any).
+ * connection (if any), and socket_event_loop() within 500 ms.
  */
 void socket_request_shutdown(void);
 
@@ -310,3 +314,103 @@ int socket_is_shutdown_requested(void);
  * - EINTR during accept() is handled (continues loop)
  */
 socket_error_t socket_accept_loop(int listen_fd, socket_connection_handler_t handler);
+
+/**
+ * Maximum client connections socket_event_loop() keeps open at once.
+ * Connections beyond this are accepted and closed immediately.
+ */
+#define SOCKET_MAX_CONNECTIONS 64
+
+/**
+ * Callbacks for socket_event_loop()
+ *
+ * open:     Called for each authenticated connection. Returns the handler's
+ *           per-connection state, or NULL to refuse the connection (the loop
+ *           closes client_fd).
+ * readable: Called when the connection has data, has been hung up, or has an
+ *           error. The handler must read without blocking (recv with
+ *           MSG_DONTWAIT) until it would block. Returns 0 to keep watching
+ *           the connection, non-zero to drop it.
+ * close:    Called once per opened connection, after it is dropped or when
+ *           the loop stops. Ownership of client_fd passes to the handler,
+ *           which must close it, possibly later, once nothing else writes
+ *           to it.
+ */
+typedef struct {
+    void *(*open)(int client_fd, void *user_data);
+    int (*readable)(void *conn, void *user_data);
+    void (*close)(void *conn, void *user_data);
+} socket_event_handlers_t;
+
+/**
+ * socket_event_loop - Serve many connections at once from one thread
+ *
+ * Like socket_accept_loop(), but watches the listening socket and every open
+ * connection with epoll instead of handling one connection to completion.
+ * A client that is idle or mid-request does not delay anyone else.
+ *
+ * The loop continues until socket_request_shutdown() is called or an
+ * unrecoverable error occurs. It wakes at least every 500 ms to check for
+ * shutdown, so the request may come from any thread. On return, close has
+ * been called for every connection still open.
+ *
+ * @param listen_fd  Listening socket from socket_create()
+ * @param handlers   Connection callbacks (all three required)
+ * @param user_data  Passed to every callback
+ * @return           SOCKET_OK on graceful shutdown, error code on failure
+ *
+ * Behavior:
+ * - Authentication and timeouts as in socket_accept_loop(); the read
+ *   timeout only matters to handlers that do blocking reads
+ * - Sockets stay in blocking mode, so handlers can write with ordinary
+ *   blocking calls from any thread
+ * - Events are level-triggered; readable need not drain the socket
+ * - At most SOCKET_MAX_CONNECTIONS connections are open at once
+ *
+ * Error codes:
+ * - SOCKET_ERR_INVALID_FD: listen_fd is negative
+ * - SOCKET_ERR_NULL_HANDLER: handlers or one of its callbacks is NULL
+ * - SOCKET_ERR_EPOLL_FAILED: epoll_create1, epoll_ctl or epoll_wait failed
+ * - SOCKET_ERR_ACCEPT_FAILED: accept() failed with a non-transient error
+ */
+socket_error_t socket_event_loop(int listen_fd, const socket_event_handlers_t *handlers,
+                                 void *user_data);
+
+/**
+ * socket_create_shm - Copy buffers into a sealed anonymous memory file
+ *
+ * Creates a memfd sized to the total length of iov, writes every buffer
+ * into it in order, and seals it against writes and resizing so the
+ * receiver can map it without the contents changing underneath it.
+ *
+ * @param iov      Buffers to copy, in order
+ * @param iovcnt   Number of buffers
+ * @param shm_fd   Output memfd (caller must close)
+ * @return         SOCKET_OK on success, error code on failure
+ *
+ * Error codes:
+ * - SOCKET_ERR_NULL_POINTER: iov or shm_fd is NULL
+ * - SOCKET_ERR_SHM_FAILED: memfd_create, write, or sealing failed
+ */
+socket_error_t socket_create_shm(const struct iovec *iov, int iovcnt, int *shm_fd);
+
+/**
+ * socket_send_with_fd - Send a buffer with a file descriptor attached
+ *
+ * pass_fd travels as SCM_RIGHTS ancillary data on the first byte of buf, so
+ * the peer receives it with the read that starts at buf. The rest of buf is
+ * written normally, handling partial writes and EINTR. The caller keeps its
+ * own copy of pass_fd and may close it once this returns.
+ *
+ * @param fd       Connected Unix domain socket
+ * @param buf      Data to send (at least 1 byte)
+ * @param len      Length of buf
+ * @param pass_fd  Descriptor to pass to the peer
+ * @return         SOCKET_OK on success, error code on failure
+ *
+ * Error codes:
+ * - SOCKET_ERR_INVALID_FD: fd or pass_fd is negative
+ * - SOCKET_ERR_NULL_POINTER: buf is NULL or len is 0
+ * - SOCKET_ERR_SEND_FAILED: sendmsg or write failed
+ */
+socket_error_t socket_send_with_fd(int fd, const void *buf, size_t len, int pass_fd);
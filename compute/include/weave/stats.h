@@ -0,0 +1,146 @@
+/**
+ * Weave Stats Module - Request Counters and Stage Latency Histograms
+ *
+ * Collects what MSG_STATS_REQUEST reports: how many generation requests were
+ * read, how many are waiting or generating, how each one was answered, the
+ * VRAM held by loaded models, and a latency histogram per timing stage.
+ *
+ * Request lifecycle, one call per transition:
+ *   stats_request_received()   read from the socket       (queue_depth + 1)
+ *   stats_request_started()    picked up by a GPU thread  (queue_depth - 1, in_flight + 1)
+ *   stats_request_generated()  generation returned        (in_flight - 1)
+ *   stats_request_finished()   reply written              (completed or error count + 1)
+ *
+ * Requests answered before reaching a GPU thread (rejected, or served from
+ * the result cache) still pass through started() and generated(), so the
+ * gauges return to zero when idle.
+ *
+ * Histograms:
+ * Buckets have fixed upper bounds from 1 ms to 60 s plus an unbounded last
+ * bucket, so stages measured in microseconds (response encoding) and in
+ * seconds (sampling) share one layout. Counts are per bucket, not cumulative.
+ *
+ * Thread safety:
+ * - Every function may be called from any thread; one mutex guards the state
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "weave/protocol.h"
+
+/** Devices whose VRAM use is tracked */
+#define STATS_MAX_DEVICES 8
+
+/**
+ * Stats Error Codes
+ */
+typedef enum {
+    STATS_OK = 0,                 /**< Success */
+    STATS_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    STATS_ERR_INIT_FAILED = -2,   /**< Failed to initialize the mutex */
+} stats_error_t;
+
+/**
+ * Server statistics.
+ *
+ * Fields are private; embed or allocate the struct and use the functions
+ * below.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    struct timespec start;            /* CLOCK_MONOTONIC time of stats_init() */
+    uint64_t requests;                /* Generation requests read */
+    uint64_t completed;               /* Answered successfully */
+    uint64_t started;                 /* Picked up by a GPU thread */
+    uint64_t generated;               /* Generation returned */
+    uint64_t error_counts[ERR_INTERNAL + 1]; /* Replies per error code */
+    size_t vram_bytes[STATS_MAX_DEVICES];    /* Loaded models per device */
+    stats_histogram_t histograms[TIMING_STAGE_COUNT]; /* Per timing_stage_t */
+} stats_t;
+
+/**
+ * stats_init - Initialize zeroed statistics and start the uptime clock
+ *
+ * @param stats  Statistics to initialize
+ * @return       STATS_OK, STATS_ERR_NULL_POINTER or STATS_ERR_INIT_FAILED
+ */
+stats_error_t stats_init(stats_t *stats);
+
+/**
+ * stats_destroy - Release statistics resources
+ *
+ * @param stats  Statistics to destroy (NULL safe)
+ */
+void stats_destroy(stats_t *stats);
+
+/**
+ * stats_request_received - Count a generation request read from a client
+ *
+ * @param stats  Statistics (NULL safe)
+ */
+void stats_request_received(stats_t *stats);
+
+/**
+ * stats_request_started - A received request reached a GPU thread
+ *
+ * @param stats  Statistics (NULL safe)
+ */
+void stats_request_started(stats_t *stats);
+
+/**
+ * stats_request_generated - A started request's generation returned
+ *
+ * @param stats  Statistics (NULL safe)
+ */
+void stats_request_generated(stats_t *stats);
+
+/**
+ * stats_request_finished - Record how a request was answered
+ *
+ * @param stats    Statistics (NULL safe)
+ * @param error    ERR_NONE for a successful reply, else its error code
+ *                 (codes above ERR_INTERNAL count as ERR_INTERNAL)
+ * @param timings  Stage durations to add to the histograms (NULL to skip)
+ */
+void stats_request_finished(stats_t *stats, error_code_t error,
+                            const sd35_generate_timings_t *timings);
+
+/**
+ * stats_set_vram - Record the VRAM held by a device's loaded models
+ *
+ * @param stats   Statistics (NULL safe)
+ * @param device  Device slot (0 to STATS_MAX_DEVICES - 1, others ignored)
+ * @param bytes   VRAM in use
+ */
+void stats_set_vram(stats_t *stats, int device, size_t bytes);
+
+/**
+ * stats_snapshot - Fill a stats response with the current values
+ *
+ * @param stats       Statistics
+ * @param request_id  Request ID to echo
+ * @param resp        Output response (status STATUS_OK)
+ * @return            STATS_OK or STATS_ERR_NULL_POINTER
+ */
+stats_error_t stats_snapshot(stats_t *stats, uint64_t request_id, stats_response_t *resp);
+
+/**
+ * stats_bucket_index - Histogram bucket holding a duration
+ *
+ * @param duration_us  Duration in microseconds
+ * @return             Bucket index (0 to STATS_HISTOGRAM_BUCKETS - 1)
+ */
+uint32_t stats_bucket_index(uint64_t duration_us);
+
+/**
+ * stats_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *stats_error_string(stats_error_t err);
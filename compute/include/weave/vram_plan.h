@@ -0,0 +1,133 @@
+/**
+ * Weave VRAM Plan Module - Pick Placement and Weight Type for a VRAM Budget
+ *
+ * The right SD wrapper options depend on the card: on 24 GB everything fits
+ * on the GPU in F16, on 12 GB the text encoders must move to the CPU, and on
+ * 8 GB the diffusion model has to be quantized as well. The planner tries
+ * configurations from fastest to most frugal and returns the first whose
+ * estimated peak VRAM fits:
+ *
+ *   1. F16, text encoders and VAE on GPU
+ *   2. F16, text encoders on CPU       (they run once per prompt, and cached
+ *                                       prompts skip them entirely)
+ *   3. Q8_0, text encoders on CPU
+ *   4. Q4_0, text encoders on CPU
+ *   5. Q4_0, text encoders and VAE on CPU
+ *
+ * VAE tiling:
+ * With the VAE on the GPU, decoding the largest allowed image may not fit
+ * next to the weights even when sampling does. The plan then sets a pixel
+ * threshold above which the decode is tiled; smaller images still decode in
+ * one pass. A configuration that does not fit even with tiling is skipped.
+ *
+ * Estimates:
+ * Weight sizes are the caller's F16 byte counts (the file sizes). Compute
+ * buffers are rough per-megapixel figures for SD 3.5 with flash attention,
+ * measured on the Vulkan backend. Stages run one at a time and free their
+ * compute buffers, so peak VRAM is the weights plus the largest stage.
+ *
+ * Thread safety:
+ * - Pure functions, safe from any thread
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Headroom left free for the driver and fragmentation */
+#define VRAM_PLAN_DEFAULT_RESERVE_BYTES ((size_t)512 * 1024 * 1024)
+
+/** Diffusion compute buffer: fixed part */
+#define VRAM_PLAN_DIFFUSION_BASE_BYTES ((size_t)512 * 1024 * 1024)
+
+/** Diffusion compute buffer: per megapixel of output */
+#define VRAM_PLAN_DIFFUSION_PER_MP_BYTES ((size_t)1024 * 1024 * 1024)
+
+/** Text encoder compute buffer when the encoders are on the GPU */
+#define VRAM_PLAN_TEXT_ENCODER_BYTES ((size_t)256 * 1024 * 1024)
+
+/** Untiled VAE decode compute buffer per megapixel of output */
+#define VRAM_PLAN_VAE_PER_MP_BYTES ((size_t)4096 * 1024 * 1024)
+
+/** Tiled VAE decode compute buffer (independent of image size) */
+#define VRAM_PLAN_VAE_TILED_BYTES ((size_t)512 * 1024 * 1024)
+
+/**
+ * VRAM Plan Error Codes
+ */
+typedef enum {
+    VRAM_PLAN_OK = 0,                 /**< Success */
+    VRAM_PLAN_ERR_NULL_POINTER = -1,  /**< NULL pointer argument */
+    VRAM_PLAN_ERR_INVALID = -2,       /**< max_pixels is 0 */
+    VRAM_PLAN_ERR_NO_FIT = -3,        /**< Nothing fits; plan is the most frugal one */
+} vram_plan_error_t;
+
+/**
+ * Weight types, in the order the planner tries them
+ */
+typedef enum {
+    VRAM_PLAN_WTYPE_F16 = 0,   /**< 16 bits per weight */
+    VRAM_PLAN_WTYPE_Q8_0 = 1,  /**< 8.5 bits per weight */
+    VRAM_PLAN_WTYPE_Q4_0 = 2,  /**< 4.5 bits per weight */
+} vram_plan_wtype_t;
+
+/**
+ * What to plan for
+ */
+typedef struct {
+    size_t vram_free;            /**< VRAM available on the device in bytes */
+    size_t reserve_bytes;        /**< Headroom to leave free */
+    size_t diffusion_bytes;      /**< Diffusion model weights at F16 */
+    size_t text_encoder_bytes;   /**< CLIP-L + CLIP-G + T5-XXL weights at F16 */
+    size_t vae_bytes;            /**< VAE weights (not quantized) */
+    uint32_t max_pixels;         /**< Largest request, width * height */
+} vram_plan_input_t;
+
+/**
+ * A chosen configuration
+ */
+typedef struct {
+    vram_plan_wtype_t wtype;     /**< Weight type */
+    bool keep_clip_on_cpu;       /**< Text encoders on CPU */
+    bool keep_vae_on_cpu;        /**< VAE on CPU */
+    uint32_t vae_tile_pixels;    /**< Tile VAE decode above this many pixels (0 = never) */
+    size_t weight_bytes;         /**< Estimated weights resident in VRAM */
+    size_t peak_bytes;           /**< Estimated peak VRAM at max_pixels */
+} vram_plan_t;
+
+/**
+ * vram_plan_input_init - Initialize an input with the default reserve
+ *
+ * @param input  Input to initialize (everything else zero)
+ */
+void vram_plan_input_init(vram_plan_input_t *input);
+
+/**
+ * vram_plan_choose - Pick the fastest configuration that fits
+ *
+ * @param input  What to plan for
+ * @param plan   Output plan; on VRAM_PLAN_ERR_NO_FIT, the most frugal
+ *               configuration, which may still run on devices that spill
+ *               to system memory
+ * @return       VRAM_PLAN_OK, VRAM_PLAN_ERR_NULL_POINTER,
+ *               VRAM_PLAN_ERR_INVALID or VRAM_PLAN_ERR_NO_FIT
+ */
+vram_plan_error_t vram_plan_choose(const vram_plan_input_t *input, vram_plan_t *plan);
+
+/**
+ * vram_plan_wtype_name - Get a weight type's name for logs ("f16", "q8_0", "q4_0")
+ *
+ * @param wtype  Weight type
+ * @return       Static string
+ */
+const char *vram_plan_wtype_name(vram_plan_wtype_t wtype);
+
+/**
+ * vram_plan_error_string - Get human-readable error message
+ *
+ * @param err  Error code
+ * @return     Static string describing the error
+ */
+const char *vram_plan_error_string(vram_plan_error_t err);
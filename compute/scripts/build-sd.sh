@@ -4,6 +4,9 @@
 #
 # This script builds stable-diffusion.cpp as a static library with Vulkan support.
 # It's called by the Makefile during the build process.
+#
+# With --check it only verifies that the checkout provides the API used by
+# src/sd_wrapper.cpp, which the Makefile runs before compiling the wrapper.
 
 set -e
 
@@ -18,6 +21,18 @@ if [ ! -d "${SD_DIR}" ]; then
     exit 1
 fi
 
+# sd_wrapper.cpp maps step caching onto EasyCache (sd_img_gen_params_t.easycache),
+# which older stable-diffusion.cpp commits do not have
+if ! grep -q "sd_easycache_params_t" "${SD_DIR}/stable-diffusion.h"; then
+    echo "Error: stable-diffusion.cpp at ${SD_DIR} predates EasyCache"
+    echo "Check out a commit that defines sd_easycache_params_t in stable-diffusion.h"
+    exit 1
+fi
+
+if [ "$1" = "--check" ]; then
+    exit 0
+fi
+
 # Create build directory
 mkdir -p "${BUILD_DIR}"
 
@@ -0,0 +1,174 @@
+/**
+ * Weave Admission Module - Implementation
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "weave/admission.h"
+
+admission_error_t admission_init(admission_t *adm, int workers) {
+    if (adm == NULL) {
+        return ADMISSION_ERR_NULL_POINTER;
+    }
+    if (workers < 1) {
+        return ADMISSION_ERR_INVALID_ARG;
+    }
+
+    memset(adm, 0, sizeof(*adm));
+    adm->workers = workers;
+    if (pthread_mutex_init(&adm->lock, NULL) != 0) {
+        return ADMISSION_ERR_INIT_FAILED;
+    }
+    return ADMISSION_OK;
+}
+
+void admission_destroy(admission_t *adm) {
+    if (adm == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&adm->lock);
+}
+
+uint64_t admission_request_units(const sd35_generate_request_t *req, uint32_t images) {
+    uint64_t steps;
+
+    if (req == NULL) {
+        return 0;
+    }
+
+    steps = req->steps;
+    if (req->init_source != SD35_INIT_NONE) {
+        steps = (uint64_t)ceilf((float)req->steps * req->strength);
+        if (steps == 0) {
+            steps = 1;
+        }
+    }
+    return (uint64_t)req->width * req->height * steps * images;
+}
+
+/**
+ * Estimated wait in microseconds of a request of class priority. Caller
+ * holds adm->lock.
+ */
+static uint64_t estimate_wait_locked(const admission_t *adm, uint32_t priority) {
+    double units = (double)adm->running_units / 2.0;
+
+    for (uint32_t i = 0; i <= priority; i++) {
+        units += (double)adm->queued_units[i];
+    }
+    return (uint64_t)(units * adm->us_per_unit / adm->workers);
+}
+
+uint64_t admission_estimate_wait_us(admission_t *adm, uint32_t priority) {
+    uint64_t wait;
+
+    if (adm == NULL || priority >= SD35_PRIORITY_COUNT) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&adm->lock);
+    wait = estimate_wait_locked(adm, priority);
+    pthread_mutex_unlock(&adm->lock);
+    return wait;
+}
+
+admission_error_t admission_enqueue(admission_t *adm, uint32_t priority, uint64_t units,
+                                    uint64_t budget_us, uint64_t *wait_us) {
+    uint64_t wait;
+    uint64_t own;
+
+    if (adm == NULL) {
+        return ADMISSION_ERR_NULL_POINTER;
+    }
+    if (priority >= SD35_PRIORITY_COUNT) {
+        return ADMISSION_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&adm->lock);
+    wait = estimate_wait_locked(adm, priority);
+    own = (uint64_t)((double)units * adm->us_per_unit);
+    if (wait_us != NULL) {
+        *wait_us = wait;
+    }
+    if (budget_us > 0 && wait + own > budget_us) {
+        pthread_mutex_unlock(&adm->lock);
+        return ADMISSION_ERR_BUSY;
+    }
+    adm->queued[priority]++;
+    adm->queued_units[priority] += units;
+    pthread_mutex_unlock(&adm->lock);
+
+    return ADMISSION_OK;
+}
+
+void admission_start(admission_t *adm, uint32_t priority, uint64_t units) {
+    if (adm == NULL || priority >= SD35_PRIORITY_COUNT) {
+        return;
+    }
+    pthread_mutex_lock(&adm->lock);
+    if (adm->queued[priority] > 0) {
+        adm->queued[priority]--;
+    }
+    adm->queued_units[priority] -= units < adm->queued_units[priority]
+                                       ? units
+                                       : adm->queued_units[priority];
+    adm->running_units += units;
+    pthread_mutex_unlock(&adm->lock);
+}
+
+void admission_finish(admission_t *adm, uint64_t units, uint64_t gpu_us) {
+    if (adm == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&adm->lock);
+    adm->running_units -= units < adm->running_units ? units : adm->running_units;
+    if (gpu_us > 0 && units > 0) {
+        double sample = (double)gpu_us / (double)units;
+
+        if (adm->us_per_unit == 0.0) {
+            adm->us_per_unit = sample;
+        } else {
+            adm->us_per_unit += ADMISSION_EWMA_WEIGHT * (sample - adm->us_per_unit);
+        }
+    }
+    pthread_mutex_unlock(&adm->lock);
+}
+
+void admission_snapshot(admission_t *adm, uint32_t *depth, uint32_t *wait_ms) {
+    if (depth == NULL || wait_ms == NULL) {
+        return;
+    }
+    memset(depth, 0, SD35_PRIORITY_COUNT * sizeof(*depth));
+    memset(wait_ms, 0, SD35_PRIORITY_COUNT * sizeof(*wait_ms));
+    if (adm == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&adm->lock);
+    for (uint32_t i = 0; i < SD35_PRIORITY_COUNT; i++) {
+        uint64_t ms = estimate_wait_locked(adm, i) / 1000;
+
+        depth[i] = adm->queued[i];
+        wait_ms[i] = ms < UINT32_MAX ? (uint32_t)ms : UINT32_MAX;
+    }
+    pthread_mutex_unlock(&adm->lock);
+}
+
+const char *admission_error_string(admission_error_t err) {
+    switch (err) {
+    case ADMISSION_OK:
+        return "success";
+    case ADMISSION_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case ADMISSION_ERR_INVALID_ARG:
+        return "invalid argument";
+    case ADMISSION_ERR_INIT_FAILED:
+        return "failed to initialize mutex";
+    case ADMISSION_ERR_BUSY:
+        return "estimated wait exceeds the deadline";
+    default:
+        return "unknown error";
+    }
+}
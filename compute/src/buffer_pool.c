@@ -0,0 +1,235 @@
+/**
+ * Weave Buffer Pool Module - Implementation
+ *
+ * Idle buffers are linked through their own first bytes, so keeping one
+ * costs no allocation. Allocation, mlock() and free() happen outside the
+ * mutex; only free list pushes, pops and counters are under it.
+ */
+
+#define _DEFAULT_SOURCE /* For madvise() and MADV_HUGEPAGE */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "weave/buffer_pool.h"
+
+/** Size classes from BUFFER_POOL_MIN_CLASS to BUFFER_POOL_MAX_CLASS, doubling */
+#define BUFFER_POOL_CLASS_COUNT 15
+
+/**
+ * Header written into an idle buffer
+ */
+typedef struct idle_buffer {
+    struct idle_buffer *next;
+} idle_buffer_t;
+
+struct buffer_pool {
+    buffer_pool_config_t config;
+    pthread_mutex_t lock;
+    idle_buffer_t *free_lists[BUFFER_POOL_CLASS_COUNT]; /* Newest first */
+    buffer_pool_stats_t stats;
+};
+
+/**
+ * class_index - Free list index for a size, or -1 if it bypasses the pool
+ */
+static int class_index(size_t size) {
+    size_t class_size = BUFFER_POOL_MIN_CLASS;
+
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+        if (size <= class_size) {
+            return i;
+        }
+        class_size <<= 1;
+    }
+    return -1;
+}
+
+size_t buffer_pool_class_size(size_t size) {
+    int index = class_index(size);
+
+    return index < 0 ? 0 : BUFFER_POOL_MIN_CLASS << index;
+}
+
+/**
+ * allocate_buffer - Allocate a new buffer of alloc_size bytes
+ *
+ * @param pool        Pool the buffer is for
+ * @param alloc_size  Class size, or the exact size of an oversized buffer
+ * @param pooled      Whether the buffer belongs to a size class
+ * @return            Buffer, or NULL if out of memory
+ */
+static void *allocate_buffer(buffer_pool_t *pool, size_t alloc_size, int pooled) {
+    size_t alignment = BUFFER_POOL_MIN_CLASS;
+    void *buf;
+
+    if (pool->config.hugepages && alloc_size >= BUFFER_POOL_HUGEPAGE_SIZE) {
+        alignment = BUFFER_POOL_HUGEPAGE_SIZE;
+    }
+    if (posix_memalign(&buf, alignment, alloc_size) != 0) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (alignment == BUFFER_POOL_HUGEPAGE_SIZE) {
+        /* Advisory; an error only means regular pages */
+        (void)madvise(buf, alloc_size, MADV_HUGEPAGE);
+    }
+#endif
+
+    /* Oversized buffers are freed on put, so locking them would buy nothing */
+    if (pooled && pool->config.lock && mlock(buf, alloc_size) != 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stats.lock_failures++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return buf;
+}
+
+/**
+ * release_buffer - Return a buffer's memory to the system
+ */
+static void release_buffer(buffer_pool_t *pool, void *buf, size_t alloc_size) {
+    if (pool->config.lock) {
+        /* Harmless if mlock() failed for this buffer */
+        (void)munlock(buf, alloc_size);
+    }
+    free(buf);
+}
+
+buffer_pool_error_t buffer_pool_create(const buffer_pool_config_t *config, buffer_pool_t **pool) {
+    buffer_pool_t *p;
+
+    if (pool == NULL) {
+        return BUFFER_POOL_ERR_NULL_POINTER;
+    }
+    *pool = NULL;
+    if (config == NULL) {
+        return BUFFER_POOL_ERR_NULL_POINTER;
+    }
+
+    p = calloc(1, sizeof(*p));
+    if (p == NULL) {
+        return BUFFER_POOL_ERR_OUT_OF_MEMORY;
+    }
+    if (pthread_mutex_init(&p->lock, NULL) != 0) {
+        free(p);
+        return BUFFER_POOL_ERR_INIT_FAILED;
+    }
+    p->config = *config;
+
+    *pool = p;
+    return BUFFER_POOL_OK;
+}
+
+void buffer_pool_destroy(buffer_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+        idle_buffer_t *buf = pool->free_lists[i];
+        while (buf != NULL) {
+            idle_buffer_t *next = buf->next;
+            release_buffer(pool, buf, BUFFER_POOL_MIN_CLASS << i);
+            buf = next;
+        }
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void *buffer_pool_get(buffer_pool_t *pool, size_t size) {
+    int index;
+    idle_buffer_t *buf;
+
+    if (pool == NULL) {
+        return malloc(size > 0 ? size : 1);
+    }
+
+    index = class_index(size);
+    pthread_mutex_lock(&pool->lock);
+    buf = index >= 0 ? pool->free_lists[index] : NULL;
+    if (buf != NULL) {
+        pool->free_lists[index] = buf->next;
+        pool->stats.idle_bytes -= BUFFER_POOL_MIN_CLASS << index;
+        pool->stats.idle_buffers--;
+        pool->stats.hits++;
+    } else {
+        pool->stats.misses++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (buf != NULL) {
+        return buf;
+    }
+    if (index < 0) {
+        return allocate_buffer(pool, size, 0);
+    }
+    return allocate_buffer(pool, BUFFER_POOL_MIN_CLASS << index, 1);
+}
+
+void buffer_pool_put(buffer_pool_t *pool, void *buf, size_t size) {
+    int index;
+    size_t class_size;
+    idle_buffer_t *idle = buf;
+
+    if (buf == NULL) {
+        return;
+    }
+    if (pool == NULL) {
+        free(buf);
+        return;
+    }
+
+    index = class_index(size);
+    if (index < 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stats.drops++;
+        pthread_mutex_unlock(&pool->lock);
+        free(buf);
+        return;
+    }
+
+    class_size = BUFFER_POOL_MIN_CLASS << index;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->stats.idle_bytes + class_size > pool->config.max_idle_bytes) {
+        pool->stats.drops++;
+        pthread_mutex_unlock(&pool->lock);
+        release_buffer(pool, buf, class_size);
+        return;
+    }
+    idle->next = pool->free_lists[index];
+    pool->free_lists[index] = idle;
+    pool->stats.idle_bytes += class_size;
+    pool->stats.idle_buffers++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+buffer_pool_error_t buffer_pool_get_stats(buffer_pool_t *pool, buffer_pool_stats_t *stats) {
+    if (pool == NULL || stats == NULL) {
+        return BUFFER_POOL_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+    return BUFFER_POOL_OK;
+}
+
+const char *buffer_pool_error_string(buffer_pool_error_t err) {
+    switch (err) {
+        case BUFFER_POOL_OK:
+            return "success";
+        case BUFFER_POOL_ERR_NULL_POINTER:
+            return "NULL pointer argument";
+        case BUFFER_POOL_ERR_OUT_OF_MEMORY:
+            return "out of memory";
+        case BUFFER_POOL_ERR_INIT_FAILED:
+            return "failed to initialize mutex";
+        default:
+            return "unknown error";
+    }
+}
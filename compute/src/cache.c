@@ -0,0 +1,891 @@
+/**
+ * Weave Cache Module - Content-Addressed Result Cache Implementation
+ *
+ * Both tiers are doubly linked lists in most-recently-used order. A lookup
+ * scans the list comparing hashes first; with multi-megabyte images the
+ * budget keeps entry counts in the tens to hundreds, so a scan is cheaper to
+ * maintain than a hash table and costs nothing next to one cache miss.
+ *
+ * Disk file layout (native byte order, local to this machine):
+ * - magic: 4 bytes ("WVCI")
+ * - version: 4 bytes
+ * - key_len: 4 bytes
+ * - width, height, channels: 4 bytes each
+ * - data_size: 8 bytes
+ * - key: key_len bytes
+ * - pixels: data_size bytes
+ * Files are written to a temporary name and renamed into place, so a reader
+ * never sees a partial file.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "weave/cache.h"
+
+#define CACHE_FILE_MAGIC 0x49435657u   /* "WVCI" in memory on little-endian */
+#define CACHE_FILE_VERSION 2u
+#define CACHE_FILE_HEADER_SIZE 32
+#define CACHE_FILE_SUFFIX ".img"
+#define CACHE_FILE_NAME_LEN (16 + 4)  /* 16 hex digits + suffix */
+
+/* Fixed part of the key: model_id, width, height, steps, cfg_scale, seed,
+ * sampler, scheduler, the three prompt lengths and the fingerprint length */
+#define CACHE_KEY_FIXED_SIZE (4 + 4 + 4 + 4 + 4 + 8 + 4 + 4 + 4 + 4 + 4 + 4)
+
+/* Retained result key: owner, request_id, image index */
+#define RETAINED_KEY_SIZE (8 + 8 + 4)
+
+/**
+ * Memory tier entry
+ */
+typedef struct cache_entry {
+    struct cache_entry *prev;
+    struct cache_entry *next;
+    uint64_t hash;
+    uint8_t *key;
+    size_t key_len;
+    result_cache_image_t image;   /* Owns image.data */
+} cache_entry_t;
+
+/**
+ * Disk tier entry (index only, pixels stay in the file)
+ */
+typedef struct disk_entry {
+    struct disk_entry *prev;
+    struct disk_entry *next;
+    uint64_t hash;
+    size_t file_size;
+} disk_entry_t;
+
+struct result_cache {
+    size_t memory_max_bytes;
+    size_t memory_bytes;
+    cache_entry_t *memory_head;   /* Most recently used */
+    cache_entry_t *memory_tail;   /* Evicted first */
+
+    char *disk_dir;               /* NULL if the disk tier is disabled */
+    size_t disk_max_bytes;
+    size_t disk_bytes;
+    disk_entry_t *disk_head;
+    disk_entry_t *disk_tail;
+
+    result_cache_stats_t stats;   /* memory_bytes/disk_bytes filled on query */
+};
+
+/* Doubly linked list helpers shared by both entry types */
+#define LIST_UNLINK(head, tail, e) \
+    do { \
+        if ((e)->prev != NULL) (e)->prev->next = (e)->next; else (head) = (e)->next; \
+        if ((e)->next != NULL) (e)->next->prev = (e)->prev; else (tail) = (e)->prev; \
+        (e)->prev = NULL; \
+        (e)->next = NULL; \
+    } while (0)
+
+#define LIST_PUSH_FRONT(head, tail, e) \
+    do { \
+        (e)->prev = NULL; \
+        (e)->next = (head); \
+        if ((head) != NULL) (head)->prev = (e); else (tail) = (e); \
+        (head) = (e); \
+    } while (0)
+
+static void put_u32(uint8_t *buf, uint32_t value) {
+    buf[0] = (uint8_t)(value >> 24);
+    buf[1] = (uint8_t)(value >> 16);
+    buf[2] = (uint8_t)(value >> 8);
+    buf[3] = (uint8_t)value;
+}
+
+static void put_u64(uint8_t *buf, uint64_t value) {
+    put_u32(buf, (uint32_t)(value >> 32));
+    put_u32(buf + 4, (uint32_t)value);
+}
+
+/**
+ * fnv1a_64 - 64-bit FNV-1a hash
+ */
+static uint64_t fnv1a_64(const uint8_t *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * build_key - Encode the inputs that determine the output image
+ *
+ * @param req          Decoded request
+ * @param seed         Seed the image is generated with
+ * @param fingerprint  Caller's model fingerprint (NULL = none)
+ * @param key_len      Output key length
+ * @return             Allocated key (caller frees), or NULL on invalid prompts or OOM
+ */
+static uint8_t *build_key(const sd35_generate_request_t *req, uint64_t seed,
+                          const char *fingerprint, size_t *key_len) {
+    const uint32_t offsets[3] = {req->clip_l_offset, req->clip_g_offset, req->t5_offset};
+    const uint32_t lengths[3] = {req->clip_l_length, req->clip_g_length, req->t5_length};
+    size_t fingerprint_len = fingerprint != NULL ? strlen(fingerprint) : 0;
+    uint32_t cfg_bits;
+    size_t len = CACHE_KEY_FIXED_SIZE;
+    uint8_t *key;
+    uint8_t *p;
+
+    if (fingerprint_len > UINT32_MAX) {
+        return NULL;
+    }
+    len += fingerprint_len;
+
+    for (int i = 0; i < 3; i++) {
+        if (lengths[i] == 0) {
+            continue;
+        }
+        if (req->prompt_data == NULL ||
+            (size_t)offsets[i] + lengths[i] > req->prompt_data_len) {
+            return NULL;
+        }
+        len += lengths[i];
+    }
+
+    key = malloc(len);
+    if (key == NULL) {
+        return NULL;
+    }
+
+    memcpy(&cfg_bits, &req->cfg_scale, sizeof(cfg_bits));
+
+    p = key;
+    put_u32(p, req->model_id);
+    put_u32(p + 4, req->width);
+    put_u32(p + 8, req->height);
+    put_u32(p + 12, req->steps);
+    put_u32(p + 16, cfg_bits);
+    put_u64(p + 20, seed);
+    put_u32(p + 28, req->sampler);
+    put_u32(p + 32, req->scheduler);
+    put_u32(p + 36, lengths[0]);
+    put_u32(p + 40, lengths[1]);
+    put_u32(p + 44, lengths[2]);
+    put_u32(p + 48, (uint32_t)fingerprint_len);
+    p += CACHE_KEY_FIXED_SIZE;
+
+    for (int i = 0; i < 3; i++) {
+        if (lengths[i] > 0) {
+            memcpy(p, req->prompt_data + offsets[i], lengths[i]);
+            p += lengths[i];
+        }
+    }
+    if (fingerprint_len > 0) {
+        memcpy(p, fingerprint, fingerprint_len);
+    }
+
+    *key_len = len;
+    return key;
+}
+
+static void free_memory_entry(cache_entry_t *entry) {
+    free(entry->key);
+    free(entry->image.data);
+    free(entry);
+}
+
+/**
+ * memory_find - Find a memory tier entry and mark it most recently used
+ */
+static cache_entry_t *memory_find(result_cache_t *cache, uint64_t hash,
+                                  const uint8_t *key, size_t key_len) {
+    for (cache_entry_t *e = cache->memory_head; e != NULL; e = e->next) {
+        if (e->hash == hash && e->key_len == key_len && memcmp(e->key, key, key_len) == 0) {
+            LIST_UNLINK(cache->memory_head, cache->memory_tail, e);
+            LIST_PUSH_FRONT(cache->memory_head, cache->memory_tail, e);
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void memory_remove(result_cache_t *cache, cache_entry_t *entry) {
+    LIST_UNLINK(cache->memory_head, cache->memory_tail, entry);
+    cache->memory_bytes -= entry->image.data_size;
+    free_memory_entry(entry);
+}
+
+/**
+ * memory_insert - Copy an image into the memory tier
+ *
+ * @return  CACHE_OK, CACHE_ERR_NOT_CACHEABLE if it exceeds the budget, or
+ *          CACHE_ERR_OUT_OF_MEMORY
+ */
+static cache_error_t memory_insert(result_cache_t *cache, uint64_t hash, const uint8_t *key,
+                                   size_t key_len, const result_cache_image_t *image) {
+    cache_entry_t *entry;
+
+    if (image->data_size > cache->memory_max_bytes) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    entry = memory_find(cache, hash, key, key_len);
+    if (entry != NULL) {
+        memory_remove(cache, entry);
+    }
+
+    while (cache->memory_tail != NULL &&
+           cache->memory_bytes + image->data_size > cache->memory_max_bytes) {
+        memory_remove(cache, cache->memory_tail);
+        cache->stats.evictions++;
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    if (entry == NULL) {
+        return CACHE_ERR_OUT_OF_MEMORY;
+    }
+
+    entry->key = malloc(key_len);
+    entry->image = *image;
+    entry->image.data = malloc(image->data_size);
+    if (entry->key == NULL || entry->image.data == NULL) {
+        free_memory_entry(entry);
+        return CACHE_ERR_OUT_OF_MEMORY;
+    }
+
+    memcpy(entry->key, key, key_len);
+    memcpy(entry->image.data, image->data, image->data_size);
+    entry->key_len = key_len;
+    entry->hash = hash;
+
+    LIST_PUSH_FRONT(cache->memory_head, cache->memory_tail, entry);
+    cache->memory_bytes += image->data_size;
+
+    return CACHE_OK;
+}
+
+/**
+ * disk_path - Format the path of the file for a hash
+ *
+ * @return  0 on success, -1 if the path does not fit
+ */
+static int disk_path(const result_cache_t *cache, uint64_t hash, const char *suffix,
+                     char *buf, size_t buf_size) {
+    int written = snprintf(buf, buf_size, "%s/%016llx%s", cache->disk_dir,
+                           (unsigned long long)hash, suffix);
+    return (written < 0 || (size_t)written >= buf_size) ? -1 : 0;
+}
+
+static disk_entry_t *disk_find(result_cache_t *cache, uint64_t hash) {
+    for (disk_entry_t *e = cache->disk_head; e != NULL; e = e->next) {
+        if (e->hash == hash) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void disk_remove(result_cache_t *cache, disk_entry_t *entry) {
+    char path[4096];
+
+    if (disk_path(cache, entry->hash, CACHE_FILE_SUFFIX, path, sizeof(path)) == 0) {
+        unlink(path);
+    }
+
+    LIST_UNLINK(cache->disk_head, cache->disk_tail, entry);
+    cache->disk_bytes -= entry->file_size;
+    free(entry);
+}
+
+/**
+ * disk_track - Record a file in the disk index as most recently used
+ */
+static cache_error_t disk_track(result_cache_t *cache, uint64_t hash, size_t file_size) {
+    disk_entry_t *entry = calloc(1, sizeof(*entry));
+    if (entry == NULL) {
+        return CACHE_ERR_OUT_OF_MEMORY;
+    }
+
+    entry->hash = hash;
+    entry->file_size = file_size;
+    LIST_PUSH_FRONT(cache->disk_head, cache->disk_tail, entry);
+    cache->disk_bytes += file_size;
+
+    return CACHE_OK;
+}
+
+static int write_all(int fd, const void *buf, size_t count) {
+    const uint8_t *p = buf;
+
+    while (count > 0) {
+        ssize_t n = write(fd, p, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        count -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/**
+ * disk_insert - Write an image to the disk tier
+ */
+static cache_error_t disk_insert(result_cache_t *cache, uint64_t hash, const uint8_t *key,
+                                 size_t key_len, const result_cache_image_t *image) {
+    uint8_t header[CACHE_FILE_HEADER_SIZE];
+    uint32_t fields[6];
+    uint64_t data_size = image->data_size;
+    size_t file_size = CACHE_FILE_HEADER_SIZE + key_len + image->data_size;
+    char tmp_path[4096];
+    char path[4096];
+    disk_entry_t *old;
+    int fd;
+
+    if (file_size > cache->disk_max_bytes) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    if (disk_path(cache, hash, ".tmp", tmp_path, sizeof(tmp_path)) != 0 ||
+        disk_path(cache, hash, CACHE_FILE_SUFFIX, path, sizeof(path)) != 0) {
+        return CACHE_ERR_IO;
+    }
+
+    old = disk_find(cache, hash);
+    if (old != NULL) {
+        disk_remove(cache, old);
+    }
+
+    while (cache->disk_tail != NULL && cache->disk_bytes + file_size > cache->disk_max_bytes) {
+        disk_remove(cache, cache->disk_tail);
+    }
+
+    fields[0] = CACHE_FILE_MAGIC;
+    fields[1] = CACHE_FILE_VERSION;
+    fields[2] = (uint32_t)key_len;
+    fields[3] = image->width;
+    fields[4] = image->height;
+    fields[5] = image->channels;
+    memcpy(header, fields, sizeof(fields));
+    memcpy(header + sizeof(fields), &data_size, sizeof(data_size));
+
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return CACHE_ERR_IO;
+    }
+
+    if (write_all(fd, header, sizeof(header)) != 0 ||
+        write_all(fd, key, key_len) != 0 ||
+        write_all(fd, image->data, image->data_size) != 0) {
+        close(fd);
+        unlink(tmp_path);
+        return CACHE_ERR_IO;
+    }
+
+    if (close(fd) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return CACHE_ERR_IO;
+    }
+
+    return disk_track(cache, hash, file_size);
+}
+
+/**
+ * disk_lookup - Read an image back from the disk tier
+ *
+ * The file is mapped rather than read so only the pixel copy touches the
+ * data. A file that is missing, truncated or for a different key is a miss;
+ * an unreadable or corrupt file is also dropped from the index.
+ */
+static cache_error_t disk_lookup(result_cache_t *cache, uint64_t hash, const uint8_t *key,
+                                 size_t key_len, result_cache_image_t *image) {
+    uint32_t fields[6];
+    uint64_t data_size;
+    char path[4096];
+    disk_entry_t *entry;
+    struct stat st;
+    const uint8_t *map;
+    cache_error_t result = CACHE_ERR_NOT_FOUND;
+    int corrupt = 1;
+    int fd;
+
+    entry = disk_find(cache, hash);
+    if (entry == NULL) {
+        return CACHE_ERR_NOT_FOUND;
+    }
+
+    if (disk_path(cache, hash, CACHE_FILE_SUFFIX, path, sizeof(path)) != 0) {
+        return CACHE_ERR_IO;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        disk_remove(cache, entry);
+        return CACHE_ERR_NOT_FOUND;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < CACHE_FILE_HEADER_SIZE) {
+        close(fd);
+        disk_remove(cache, entry);
+        return CACHE_ERR_NOT_FOUND;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return CACHE_ERR_IO;
+    }
+
+    memcpy(fields, map, sizeof(fields));
+    memcpy(&data_size, map + sizeof(fields), sizeof(data_size));
+
+    if (fields[0] == CACHE_FILE_MAGIC && fields[1] == CACHE_FILE_VERSION &&
+        data_size <= (uint64_t)st.st_size &&
+        (uint64_t)CACHE_FILE_HEADER_SIZE + fields[2] + data_size == (uint64_t)st.st_size) {
+        corrupt = 0;
+
+        if (fields[2] == key_len &&
+            memcmp(map + CACHE_FILE_HEADER_SIZE, key, key_len) == 0) {
+            image->data = malloc((size_t)data_size);
+            if (image->data == NULL) {
+                result = CACHE_ERR_OUT_OF_MEMORY;
+            } else {
+                memcpy(image->data, map + CACHE_FILE_HEADER_SIZE + key_len, (size_t)data_size);
+                image->width = fields[3];
+                image->height = fields[4];
+                image->channels = fields[5];
+                image->data_size = (size_t)data_size;
+                result = CACHE_OK;
+            }
+        }
+    }
+
+    munmap((void *)map, (size_t)st.st_size);
+
+    if (corrupt) {
+        disk_remove(cache, entry);
+    } else if (result == CACHE_OK) {
+        LIST_UNLINK(cache->disk_head, cache->disk_tail, entry);
+        LIST_PUSH_FRONT(cache->disk_head, cache->disk_tail, entry);
+    }
+
+    return result;
+}
+
+/**
+ * Existing disk file found while indexing
+ */
+typedef struct {
+    uint64_t hash;
+    size_t file_size;
+    struct timespec mtime;
+} disk_scan_t;
+
+static int compare_scan_mtime(const void *a, const void *b) {
+    const disk_scan_t *x = a;
+    const disk_scan_t *y = b;
+
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+    }
+    if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+        return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * disk_index - Create the disk tier directory and index files from earlier runs
+ *
+ * Files are added oldest first so the newest end up most recently used.
+ * Leftover temporary files are removed.
+ */
+static cache_error_t disk_index(result_cache_t *cache) {
+    disk_scan_t *found = NULL;
+    size_t found_count = 0;
+    size_t found_cap = 0;
+    struct dirent *de;
+    char path[4096];
+    DIR *dir;
+
+    if (mkdir(cache->disk_dir, 0700) != 0 && errno != EEXIST) {
+        return CACHE_ERR_IO;
+    }
+
+    dir = opendir(cache->disk_dir);
+    if (dir == NULL) {
+        return CACHE_ERR_IO;
+    }
+
+    while ((de = readdir(dir)) != NULL) {
+        size_t name_len = strlen(de->d_name);
+        unsigned long long hash;
+        struct stat st;
+        char *end;
+
+        if (name_len != CACHE_FILE_NAME_LEN) {
+            continue;
+        }
+
+        errno = 0;
+        hash = strtoull(de->d_name, &end, 16);
+        if (errno != 0 || end != de->d_name + 16) {
+            continue;
+        }
+
+        if (snprintf(path, sizeof(path), "%s/%s", cache->disk_dir, de->d_name) >=
+            (int)sizeof(path)) {
+            continue;
+        }
+
+        if (strcmp(end, ".tmp") == 0) {
+            unlink(path);
+            continue;
+        }
+
+        if (strcmp(end, CACHE_FILE_SUFFIX) != 0 || stat(path, &st) != 0 ||
+            !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        if (found_count == found_cap) {
+            size_t new_cap = found_cap == 0 ? 16 : found_cap * 2;
+            disk_scan_t *grown = realloc(found, new_cap * sizeof(*found));
+            if (grown == NULL) {
+                free(found);
+                closedir(dir);
+                return CACHE_ERR_OUT_OF_MEMORY;
+            }
+            found = grown;
+            found_cap = new_cap;
+        }
+
+        found[found_count].hash = (uint64_t)hash;
+        found[found_count].file_size = (size_t)st.st_size;
+        found[found_count].mtime = st.st_mtim;
+        found_count++;
+    }
+
+    closedir(dir);
+
+    if (found_count > 0) {
+        qsort(found, found_count, sizeof(*found), compare_scan_mtime);
+    }
+
+    for (size_t i = 0; i < found_count; i++) {
+        if (disk_track(cache, found[i].hash, found[i].file_size) != CACHE_OK) {
+            free(found);
+            return CACHE_ERR_OUT_OF_MEMORY;
+        }
+    }
+    free(found);
+
+    /* The budget may have shrunk since the files were written */
+    while (cache->disk_tail != NULL && cache->disk_bytes > cache->disk_max_bytes) {
+        disk_remove(cache, cache->disk_tail);
+    }
+
+    return CACHE_OK;
+}
+
+/**
+ * result_cache_create - Create a cache
+ */
+result_cache_t *result_cache_create(const result_cache_config_t *config) {
+    result_cache_t *cache;
+
+    if (config == NULL) {
+        return NULL;
+    }
+
+    if (config->memory_max_bytes == 0 &&
+        (config->disk_max_bytes == 0 || config->disk_dir == NULL)) {
+        return NULL;
+    }
+
+    cache = calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->memory_max_bytes = config->memory_max_bytes;
+
+    if (config->disk_max_bytes > 0 && config->disk_dir != NULL) {
+        cache->disk_max_bytes = config->disk_max_bytes;
+        cache->disk_dir = strdup(config->disk_dir);
+        if (cache->disk_dir == NULL || disk_index(cache) != CACHE_OK) {
+            result_cache_destroy(cache);
+            return NULL;
+        }
+    }
+
+    return cache;
+}
+
+/**
+ * result_cache_destroy - Free the memory tier and the handle
+ */
+void result_cache_destroy(result_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    while (cache->memory_head != NULL) {
+        memory_remove(cache, cache->memory_head);
+    }
+
+    while (cache->disk_head != NULL) {
+        disk_entry_t *entry = cache->disk_head;
+        LIST_UNLINK(cache->disk_head, cache->disk_tail, entry);
+        free(entry);
+    }
+
+    free(cache->disk_dir);
+    free(cache);
+}
+
+/**
+ * lookup_key - Find the image stored under a key in either tier
+ */
+static cache_error_t lookup_key(result_cache_t *cache, const uint8_t *key, size_t key_len,
+                                result_cache_image_t *image) {
+    uint64_t hash = fnv1a_64(key, key_len);
+    cache_entry_t *entry;
+    cache_error_t err;
+
+    entry = memory_find(cache, hash, key, key_len);
+    if (entry != NULL) {
+        *image = entry->image;
+        image->data = malloc(entry->image.data_size);
+        if (image->data == NULL) {
+            return CACHE_ERR_OUT_OF_MEMORY;
+        }
+        memcpy(image->data, entry->image.data, entry->image.data_size);
+        cache->stats.hits++;
+        return CACHE_OK;
+    }
+
+    if (cache->disk_dir == NULL) {
+        cache->stats.misses++;
+        return CACHE_ERR_NOT_FOUND;
+    }
+
+    err = disk_lookup(cache, hash, key, key_len, image);
+    if (err == CACHE_OK) {
+        cache->stats.disk_hits++;
+        if (cache->memory_max_bytes > 0) {
+            /* Promotion is best effort; the caller already has its copy */
+            (void)memory_insert(cache, hash, key, key_len, image);
+        }
+    } else if (err == CACHE_ERR_NOT_FOUND) {
+        cache->stats.misses++;
+    }
+    return err;
+}
+
+/**
+ * store_key - Store an image under a key in every enabled tier
+ */
+static cache_error_t store_key(result_cache_t *cache, const uint8_t *key, size_t key_len,
+                               const result_cache_image_t *image) {
+    cache_error_t memory_err = CACHE_ERR_NOT_CACHEABLE;
+    cache_error_t disk_err = CACHE_ERR_NOT_CACHEABLE;
+    uint64_t hash = fnv1a_64(key, key_len);
+
+    if (cache->memory_max_bytes > 0) {
+        memory_err = memory_insert(cache, hash, key, key_len, image);
+    }
+
+    if (cache->disk_dir != NULL) {
+        disk_err = disk_insert(cache, hash, key, key_len, image);
+    }
+
+    if (disk_err == CACHE_OK || disk_err == CACHE_ERR_NOT_CACHEABLE) {
+        return (memory_err == CACHE_OK || disk_err == CACHE_OK) ? CACHE_OK : memory_err;
+    }
+    return disk_err;
+}
+
+/**
+ * build_retained_key - Key of a retained result: owner, request_id and image index
+ *
+ * Shorter than any request key, so the two kinds never compare equal.
+ */
+static void build_retained_key(uint64_t owner, uint64_t request_id, uint32_t index,
+                               uint8_t key[RETAINED_KEY_SIZE]) {
+    put_u64(key, owner);
+    put_u64(key + 8, request_id);
+    put_u32(key + 16, index);
+}
+
+/**
+ * seed_is_random - Whether a wire seed generates a different image every time
+ *
+ * 0 asks for a random seed. Seeds of 2^63 and up become negative int64_t
+ * seeds for stable-diffusion.cpp, which replaces any negative seed with a
+ * random one.
+ *
+ * @param seed  Seed from the request
+ * @return      1 if the image cannot be reproduced from the seed, 0 otherwise
+ */
+static int seed_is_random(uint64_t seed) {
+    return seed == 0 || seed > (uint64_t)INT64_MAX;
+}
+
+/**
+ * result_cache_lookup - Find the image generated for a request and seed
+ */
+cache_error_t result_cache_lookup(result_cache_t *cache, const sd35_generate_request_t *req,
+                                  uint64_t seed, const char *fingerprint,
+                                  result_cache_image_t *image) {
+    cache_error_t err;
+    uint8_t *key;
+    size_t key_len;
+
+    if (cache == NULL || req == NULL || image == NULL) {
+        return CACHE_ERR_NULL_POINTER;
+    }
+
+    if (seed_is_random(seed) || req->init_source != SD35_INIT_NONE) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    key = build_key(req, seed, fingerprint, &key_len);
+    if (key == NULL) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    err = lookup_key(cache, key, key_len, image);
+    free(key);
+    return err;
+}
+
+/**
+ * result_cache_store - Remember the image generated for a request and seed
+ */
+cache_error_t result_cache_store(result_cache_t *cache, const sd35_generate_request_t *req,
+                                 uint64_t seed, const char *fingerprint,
+                                 const result_cache_image_t *image) {
+    cache_error_t err;
+    uint8_t *key;
+    size_t key_len;
+
+    if (cache == NULL || req == NULL || image == NULL || image->data == NULL) {
+        return CACHE_ERR_NULL_POINTER;
+    }
+
+    if (seed_is_random(seed) || req->init_source != SD35_INIT_NONE) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    key = build_key(req, seed, fingerprint, &key_len);
+    if (key == NULL) {
+        return CACHE_ERR_NOT_CACHEABLE;
+    }
+
+    err = store_key(cache, key, key_len, image);
+    free(key);
+    return err;
+}
+
+/**
+ * result_cache_retain - Keep an image under the request that returned it
+ */
+cache_error_t result_cache_retain(result_cache_t *cache, uint64_t owner, uint64_t request_id,
+                                  uint32_t index, const result_cache_image_t *image) {
+    uint8_t key[RETAINED_KEY_SIZE];
+
+    if (cache == NULL || image == NULL || image->data == NULL) {
+        return CACHE_ERR_NULL_POINTER;
+    }
+
+    build_retained_key(owner, request_id, index, key);
+    return store_key(cache, key, sizeof(key), image);
+}
+
+/**
+ * result_cache_recall - Find an image kept by result_cache_retain()
+ */
+cache_error_t result_cache_recall(result_cache_t *cache, uint64_t owner, uint64_t request_id,
+                                  uint32_t index, result_cache_image_t *image) {
+    uint8_t key[RETAINED_KEY_SIZE];
+
+    if (cache == NULL || image == NULL) {
+        return CACHE_ERR_NULL_POINTER;
+    }
+
+    build_retained_key(owner, request_id, index, key);
+    return lookup_key(cache, key, sizeof(key), image);
+}
+
+/**
+ * result_cache_forget - Drop every image kept for an owner
+ */
+size_t result_cache_forget(result_cache_t *cache, uint64_t owner) {
+    uint8_t prefix[8];
+    cache_entry_t *next;
+    size_t dropped = 0;
+
+    if (cache == NULL) {
+        return 0;
+    }
+
+    put_u64(prefix, owner);
+    for (cache_entry_t *e = cache->memory_head; e != NULL; e = next) {
+        next = e->next;
+        if (e->key_len == RETAINED_KEY_SIZE && memcmp(e->key, prefix, sizeof(prefix)) == 0) {
+            memory_remove(cache, e);
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+/**
+ * result_cache_get_stats - Get hit/miss counters and tier usage
+ */
+cache_error_t result_cache_get_stats(const result_cache_t *cache, result_cache_stats_t *stats) {
+    if (cache == NULL || stats == NULL) {
+        return CACHE_ERR_NULL_POINTER;
+    }
+
+    *stats = cache->stats;
+    stats->memory_bytes = cache->memory_bytes;
+    stats->disk_bytes = cache->disk_bytes;
+
+    return CACHE_OK;
+}
+
+/**
+ * cache_error_string - Get human-readable error message
+ */
+const char *cache_error_string(cache_error_t err) {
+    switch (err) {
+        case CACHE_OK:
+            return "success";
+        case CACHE_ERR_NULL_POINTER:
+            return "null pointer argument";
+        case CACHE_ERR_OUT_OF_MEMORY:
+            return "memory allocation failed";
+        case CACHE_ERR_NOT_FOUND:
+            return "no cached result";
+        case CACHE_ERR_NOT_CACHEABLE:
+            return "result not cacheable";
+        case CACHE_ERR_IO:
+            return "cache disk I/O failed";
+        default:
+            return "unknown error";
+    }
+}
@@ -0,0 +1,264 @@
+/**
+ * Weave Connection Module - Implementation
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "weave/connection.h"
+
+/**
+ * A request that MSG_CANCEL can still reach, from read until generated.
+ */
+typedef struct {
+    uint64_t request_id;     /* Request ID */
+    int in_use;              /* Slot holds a request */
+    int cancelled;           /* MSG_CANCEL received for it */
+} inflight_request_t;
+
+struct connection {
+    int client_fd;                    /* Connected client socket */
+    int owns_fd;                      /* Close client_fd with the last reference */
+    uint64_t owner;                   /* Retained result owner */
+    connection_release_fn on_release; /* Called with owner on the last unref */
+    void *user_data;                  /* Passed to on_release */
+    pthread_mutex_t write_lock;       /* Serializes writes on client_fd */
+    int broken;                       /* A send failed; guarded by write_lock */
+    pthread_mutex_t cancel_lock;      /* Guards inflight and refs */
+    inflight_request_t *inflight;     /* Cancellable requests */
+    size_t max_inflight;              /* Slots in inflight */
+    int refs;                         /* Reader's reference plus one per queued request */
+};
+
+connection_error_t connection_create(const connection_config_t *config, connection_t **conn) {
+    connection_t *c;
+
+    if (config == NULL || conn == NULL) {
+        return CONNECTION_ERR_NULL_POINTER;
+    }
+    if (config->client_fd < 0 || config->max_inflight == 0) {
+        return CONNECTION_ERR_INVALID_ARG;
+    }
+
+    c = calloc(1, sizeof(*c));
+    if (c == NULL) {
+        return CONNECTION_ERR_OUT_OF_MEMORY;
+    }
+
+    c->inflight = calloc(config->max_inflight, sizeof(*c->inflight));
+    if (c->inflight == NULL) {
+        free(c);
+        return CONNECTION_ERR_OUT_OF_MEMORY;
+    }
+
+    if (pthread_mutex_init(&c->write_lock, NULL) != 0) {
+        free(c->inflight);
+        free(c);
+        return CONNECTION_ERR_INIT_FAILED;
+    }
+
+    if (pthread_mutex_init(&c->cancel_lock, NULL) != 0) {
+        pthread_mutex_destroy(&c->write_lock);
+        free(c->inflight);
+        free(c);
+        return CONNECTION_ERR_INIT_FAILED;
+    }
+
+    c->client_fd = config->client_fd;
+    c->owns_fd = config->owns_fd;
+    c->owner = config->owner;
+    c->on_release = config->on_release;
+    c->user_data = config->user_data;
+    c->max_inflight = config->max_inflight;
+    c->refs = 1;
+    *conn = c;
+    return CONNECTION_OK;
+}
+
+void connection_ref(connection_t *conn) {
+    if (conn == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&conn->cancel_lock);
+    conn->refs++;
+    pthread_mutex_unlock(&conn->cancel_lock);
+}
+
+void connection_unref(connection_t *conn) {
+    int refs;
+
+    if (conn == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&conn->cancel_lock);
+    refs = --conn->refs;
+    pthread_mutex_unlock(&conn->cancel_lock);
+
+    if (refs > 0) {
+        return;
+    }
+
+    if (conn->on_release != NULL) {
+        conn->on_release(conn->owner, conn->user_data);
+    }
+    if (conn->owns_fd) {
+        close(conn->client_fd);
+    }
+    pthread_mutex_destroy(&conn->cancel_lock);
+    pthread_mutex_destroy(&conn->write_lock);
+    free(conn->inflight);
+    free(conn);
+}
+
+int connection_fd(const connection_t *conn) {
+    return conn != NULL ? conn->client_fd : -1;
+}
+
+uint64_t connection_owner(const connection_t *conn) {
+    return conn != NULL ? conn->owner : 0;
+}
+
+connection_error_t connection_send(connection_t *conn, connection_send_fn send, void *arg) {
+    connection_error_t err = CONNECTION_OK;
+
+    if (conn == NULL || send == NULL) {
+        return CONNECTION_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&conn->write_lock);
+    if (conn->broken) {
+        err = CONNECTION_ERR_BROKEN;
+    } else if (send(conn->client_fd, arg) != 0) {
+        /* Ends the reader's read, so the connection winds down */
+        conn->broken = 1;
+        shutdown(conn->client_fd, SHUT_RDWR);
+        err = CONNECTION_ERR_BROKEN;
+    }
+    pthread_mutex_unlock(&conn->write_lock);
+
+    return err;
+}
+
+int connection_is_broken(connection_t *conn) {
+    int broken;
+
+    if (conn == NULL) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&conn->write_lock);
+    broken = conn->broken;
+    pthread_mutex_unlock(&conn->write_lock);
+
+    return broken;
+}
+
+/**
+ * Slot tracking request_id, or NULL. Caller holds conn->cancel_lock.
+ */
+static inflight_request_t *find_inflight_locked(connection_t *conn, uint64_t request_id) {
+    for (size_t i = 0; i < conn->max_inflight; i++) {
+        if (conn->inflight[i].in_use && conn->inflight[i].request_id == request_id) {
+            return &conn->inflight[i];
+        }
+    }
+    return NULL;
+}
+
+connection_error_t connection_track(connection_t *conn, uint64_t request_id) {
+    connection_error_t err = CONNECTION_ERR_FULL;
+
+    if (conn == NULL) {
+        return CONNECTION_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&conn->cancel_lock);
+    for (size_t i = 0; i < conn->max_inflight; i++) {
+        if (!conn->inflight[i].in_use) {
+            conn->inflight[i].request_id = request_id;
+            conn->inflight[i].in_use = 1;
+            conn->inflight[i].cancelled = 0;
+            err = CONNECTION_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&conn->cancel_lock);
+
+    return err;
+}
+
+void connection_untrack(connection_t *conn, uint64_t request_id) {
+    inflight_request_t *slot;
+
+    if (conn == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&conn->cancel_lock);
+    slot = find_inflight_locked(conn, request_id);
+    if (slot != NULL) {
+        slot->in_use = 0;
+    }
+    pthread_mutex_unlock(&conn->cancel_lock);
+}
+
+connection_error_t connection_cancel(connection_t *conn, uint64_t request_id) {
+    inflight_request_t *slot;
+
+    if (conn == NULL) {
+        return CONNECTION_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&conn->cancel_lock);
+    slot = find_inflight_locked(conn, request_id);
+    if (slot != NULL) {
+        slot->cancelled = 1;
+    }
+    pthread_mutex_unlock(&conn->cancel_lock);
+
+    return slot != NULL ? CONNECTION_OK : CONNECTION_ERR_NOT_FOUND;
+}
+
+int connection_is_cancelled(connection_t *conn, uint64_t request_id) {
+    inflight_request_t *slot;
+    int cancelled = 0;
+
+    if (conn == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&conn->cancel_lock);
+    slot = find_inflight_locked(conn, request_id);
+    if (slot != NULL) {
+        cancelled = slot->cancelled;
+    }
+    pthread_mutex_unlock(&conn->cancel_lock);
+
+    return cancelled;
+}
+
+const char *connection_error_string(connection_error_t err) {
+    switch (err) {
+    case CONNECTION_OK:
+        return "success";
+    case CONNECTION_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case CONNECTION_ERR_INVALID_ARG:
+        return "invalid argument";
+    case CONNECTION_ERR_OUT_OF_MEMORY:
+        return "out of memory";
+    case CONNECTION_ERR_INIT_FAILED:
+        return "failed to initialize mutex";
+    case CONNECTION_ERR_BROKEN:
+        return "connection broken";
+    case CONNECTION_ERR_FULL:
+        return "too many requests in flight";
+    case CONNECTION_ERR_NOT_FOUND:
+        return "request not in flight";
+    default:
+        return "unknown error";
+    }
+}
@@ -52,6 +52,13 @@ static error_code_t convert_request_params(const sd35_generate_request_t *req,
         return ERR_INVALID_PROMPT;
     }
 
+    /* Retained init images are resolved to pixels before generation */
+    if (req->init_source != SD35_INIT_NONE &&
+        (req->init_data == NULL ||
+         req->init_data_len != (size_t)req->width * req->height * 3)) {
+        return ERR_INVALID_INIT_IMAGE;
+    }
+
     memcpy(prompt, req->prompt_data + req->clip_l_offset, req->clip_l_length);
     prompt[req->clip_l_length] = '\0';
 
@@ -64,6 +71,12 @@ static error_code_t convert_request_params(const sd35_generate_request_t *req,
     params->cfg_scale = req->cfg_scale;
     params->seed = (int64_t)req->seed;
     params->clip_skip = 0;
+    params->sampler = (sd_wrapper_sampler_t)req->sampler;
+    params->scheduler = (sd_wrapper_scheduler_t)req->scheduler;
+    if (req->init_source != SD35_INIT_NONE) {
+        params->init_image = req->init_data;
+        params->strength = req->strength;
+    }
 
     return ERR_NONE;
 }
@@ -93,6 +106,10 @@ static error_code_t map_sd_error(sd_wrapper_error_t sd_err, uint32_t *status) {
         *status = STATUS_INTERNAL_SERVER_ERROR;
         return ERR_GPU_ERROR;
 
+    case SD_WRAPPER_ERR_CANCELLED:
+        *status = STATUS_BAD_REQUEST;
+        return ERR_CANCELLED;
+
     case SD_WRAPPER_ERR_MODEL_NOT_FOUND:
     case SD_WRAPPER_ERR_MODEL_CORRUPT:
     case SD_WRAPPER_ERR_INIT_FAILED:
@@ -114,6 +131,84 @@ static uint64_t get_time_ms(void) {
     return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
 }
 
+/**
+ * Prepare the SD context for the next generation.
+ *
+ * @param ctx  SD wrapper context
+ * @return     ERR_NONE on success, ERR_INTERNAL if the reset failed
+ */
+static error_code_t prepare_context(sd_wrapper_ctx_t *ctx) {
+    sd_wrapper_error_t sd_err;
+
+    /*
+     * WORKAROUND: Reset SD context between generations to avoid segfault.
+     *
+     * A second generate_image() call on the same stable-diffusion.cpp
+     * context segfaults (bug 002), so a reset is still required between
+     * generations. A compute reset is a full reload unless the context was
+     * created with reuse_context; then it keeps the uploaded weights and
+     * falls back to a full reload only if the previous generation failed.
+     *
+     * Important: Only reset AFTER the first generation. The initially created
+     * context works correctly, but recreated contexts from sd_wrapper_reset()
+     * may have subtle differences that cause crashes. The wrapper tracks this
+     * per context, so GPU workers on other devices share no state here.
+     *
+     * Performance impact: ~2-3 seconds of model reload per generation by
+     * default; with reuse_context, no disk I/O in the steady state.
+     */
+    if (sd_wrapper_has_generated(ctx)) {
+        sd_err = sd_wrapper_reset_mode(ctx, SD_WRAPPER_RESET_COMPUTE);
+        if (sd_err != SD_WRAPPER_OK) {
+            return ERR_INTERNAL;
+        }
+    }
+
+    return ERR_NONE;
+}
+
+/**
+ * Validate a generated image against the request and protocol bounds.
+ *
+ * @param req    Protocol request the image was generated for
+ * @param image  Generated image
+ * @return       ERR_NONE if valid, ERR_INTERNAL otherwise
+ */
+static error_code_t validate_generated_image(const sd35_generate_request_t *req,
+                                              const sd_wrapper_image_t *image) {
+    if (image->data == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    /* Validate image dimensions match request */
+    if (image->width != req->width || image->height != req->height) {
+        return ERR_INTERNAL;
+    }
+
+    /* Validate dimensions are within protocol bounds */
+    if (image->width < SD35_MIN_DIMENSION || image->width > SD35_MAX_DIMENSION ||
+        image->width % 64 != 0) {
+        return ERR_INTERNAL;
+    }
+
+    if (image->height < SD35_MIN_DIMENSION || image->height > SD35_MAX_DIMENSION ||
+        image->height % 64 != 0) {
+        return ERR_INTERNAL;
+    }
+
+    /* Validate channel count (RGB or RGBA) */
+    if (image->channels != 3 && image->channels != 4) {
+        return ERR_INTERNAL;
+    }
+
+    /* Validate image data size fits in uint32_t (protocol constraint) */
+    if (image->data_size > UINT32_MAX) {
+        return ERR_INTERNAL;
+    }
+
+    return ERR_NONE;
+}
+
 /**
  * Process a generation request and produce a response.
  *
@@ -127,8 +222,10 @@ static uint64_t get_time_ms(void) {
  * Error mapping:
  * - Invalid dimensions/steps/cfg → STATUS_BAD_REQUEST (400)
  * - Invalid prompt → STATUS_BAD_REQUEST (400)
+ * - Init image not resolved to width x height RGB → ERR_INVALID_INIT_IMAGE
  * - Model not loaded → STATUS_INTERNAL_SERVER_ERROR (500)
  * - GPU/OOM errors → STATUS_INTERNAL_SERVER_ERROR (500)
+ * - Aborted by the abort callback → ERR_CANCELLED, STATUS_BAD_REQUEST (400)
  *
  * @param ctx   SD wrapper context (must not be NULL, must be initialized)
  * @param req   Decoded protocol request (borrowed, not modified)
@@ -140,16 +237,6 @@ static uint64_t get_time_ms(void) {
  * @note req->prompt_data must remain valid during this call
  * @note This function is NOT thread-safe (ctx is single-threaded)
  */
-/*
- * Track whether a generation has been performed.
- *
- * stable-diffusion.cpp requires a context reset between generations, but
- * NOT before the first generation. The initially created context works
- * correctly, but recreated contexts from sd_wrapper_reset() may have
- * subtle differences that cause crashes.
- */
-static bool generation_performed = false;
-
 error_code_t process_generate_request(sd_wrapper_ctx_t *ctx,
                                        const sd35_generate_request_t *req,
                                        sd35_generate_response_t *resp) {
@@ -167,25 +254,9 @@ error_code_t process_generate_request(sd_wrapper_ctx_t *ctx,
         return err;
     }
 
-    /*
-     * WORKAROUND: Reset SD context between generations to avoid segfault.
-     *
-     * stable-diffusion.cpp has a bug where GGML compute buffers are not
-     * properly freed between generate_image() calls on the same context.
-     * This causes segfaults on subsequent generations with different prompt
-     * lengths. Resetting the context ensures clean state.
-     *
-     * Important: Only reset AFTER the first generation. The initially created
-     * context works correctly, but we must reset before subsequent generations.
-     *
-     * Performance impact: ~2-3 seconds model reload per generation (after first).
-     * This should be removed once the upstream bug is fixed.
-     */
-    if (generation_performed) {
-        sd_err = sd_wrapper_reset(ctx);
-        if (sd_err != SD_WRAPPER_OK) {
-            return ERR_INTERNAL;
-        }
+    err = prepare_context(ctx);
+    if (err != ERR_NONE) {
+        return err;
     }
 
     sd_wrapper_image_t image;
@@ -201,39 +272,134 @@ error_code_t process_generate_request(sd_wrapper_ctx_t *ctx,
         return err;
     }
 
-    if (image.data == NULL) {
-        return ERR_INTERNAL;
+    err = validate_generated_image(req, &image);
+    if (err != ERR_NONE) {
+        sd_wrapper_free_image(&image);
+        return err;
     }
 
-    /* Validate image dimensions match request */
-    if (image.width != req->width || image.height != req->height) {
-        sd_wrapper_free_image(&image);
-        return ERR_INTERNAL;
+    uint64_t generation_time = end_time - start_time;
+    /* Clamp generation time to UINT32_MAX (~49 days, acceptable limit) */
+    if (generation_time > UINT32_MAX) {
+        generation_time = UINT32_MAX;
     }
 
-    /* Validate dimensions are within protocol bounds */
-    if (image.width < SD35_MIN_DIMENSION || image.width > SD35_MAX_DIMENSION ||
-        image.width % 64 != 0) {
-        sd_wrapper_free_image(&image);
+    resp->request_id = req->request_id;
+    resp->status = STATUS_OK;
+    resp->generation_time_ms = (uint32_t)generation_time;
+    resp->image_width = image.width;
+    resp->image_height = image.height;
+    resp->channels = image.channels;
+    resp->image_data_len = (uint32_t)image.data_size;
+    resp->image_data = image.data;
+
+    return ERR_NONE;
+}
+
+/**
+ * Get the SD context ready for a generation announced by MSG_PREPARE.
+ *
+ * Does the reset process_generate_request() would do first. The reset that
+ * request still does then finds nothing left to discard, and a full reload
+ * after a failed generation happens here instead of on its critical path.
+ * The reset is not the request's, so its time is taken out of ctx.
+ *
+ * @param ctx       SD wrapper context (must not be NULL, must be initialized)
+ * @param req       Decoded prepare request (borrowed, not modified)
+ * @param reset_us  Output reset time in microseconds (may be NULL)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * @note This function is NOT thread-safe (ctx is single-threaded)
+ */
+error_code_t process_prepare_request(sd_wrapper_ctx_t *ctx, const sd35_prepare_request_t *req,
+                                     uint64_t *reset_us) {
+    error_code_t err;
+    uint64_t taken_us;
+
+    if (ctx == NULL || req == NULL) {
         return ERR_INTERNAL;
     }
 
-    if (image.height < SD35_MIN_DIMENSION || image.height > SD35_MAX_DIMENSION ||
-        image.height % 64 != 0) {
-        sd_wrapper_free_image(&image);
-        return ERR_INTERNAL;
+    err = prepare_context(ctx);
+    taken_us = sd_wrapper_take_reset_time(ctx);
+    if (reset_us != NULL) {
+        *reset_us = taken_us;
     }
+    return err;
+}
 
-    /* Validate channel count (RGB or RGBA) */
-    if (image.channels != 3 && image.channels != 4) {
-        sd_wrapper_free_image(&image);
+/**
+ * Process a batch generation request and produce a batch response.
+ *
+ * The context is prepared once for the whole batch, so every seed shares
+ * the same prompt encoding and loaded weights.
+ *
+ * @param ctx   SD wrapper context (must not be NULL, must be initialized)
+ * @param req   Decoded protocol batch request (borrowed, not modified)
+ * @param resp  Output batch response structure (populated on success)
+ * @return      ERR_NONE on success, error code on failure
+ *
+ * @note On success, resp->images[] are allocated and must be freed by caller
+ * @note On failure, resp is unchanged (no cleanup needed)
+ * @note This function is NOT thread-safe (ctx is single-threaded)
+ */
+error_code_t process_generate_batch_request(sd_wrapper_ctx_t *ctx,
+                                             const sd35_generate_batch_request_t *req,
+                                             sd35_generate_batch_response_t *resp) {
+    if (ctx == NULL || req == NULL || resp == NULL) {
         return ERR_INTERNAL;
     }
 
-    /* Validate image data size fits in uint32_t (protocol constraint) */
-    if (image.data_size > UINT32_MAX) {
-        sd_wrapper_free_image(&image);
-        return ERR_INTERNAL;
+    if (req->seed_count < SD35_MIN_BATCH_SIZE || req->seed_count > SD35_MAX_BATCH_SIZE) {
+        return ERR_INVALID_SEED_COUNT;
+    }
+
+    char prompt[SD35_MAX_PROMPT_LENGTH + 1];
+    sd_wrapper_gen_params_t params;
+    error_code_t err;
+    sd_wrapper_error_t sd_err;
+
+    err = convert_request_params(&req->base, &params, prompt, sizeof(prompt));
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    err = prepare_context(ctx);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    int64_t seeds[SD35_MAX_BATCH_SIZE];
+    for (uint32_t i = 0; i < req->seed_count; i++) {
+        seeds[i] = (int64_t)req->seeds[i];
+    }
+
+    sd_wrapper_image_t images[SD35_MAX_BATCH_SIZE];
+    memset(images, 0, sizeof(images));
+
+    uint64_t start_time = get_time_ms();
+    sd_err = sd_wrapper_generate_batch(ctx, &params, seeds, req->seed_count, images);
+    uint64_t end_time = get_time_ms();
+
+    uint32_t status;
+    err = map_sd_error(sd_err, &status);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    for (uint32_t i = 0; i < req->seed_count && err == ERR_NONE; i++) {
+        err = validate_generated_image(&req->base, &images[i]);
+        if (err == ERR_NONE && (images[i].channels != images[0].channels ||
+                                images[i].data_size != images[0].data_size)) {
+            err = ERR_INTERNAL;
+        }
+    }
+
+    if (err != ERR_NONE) {
+        for (uint32_t i = 0; i < req->seed_count; i++) {
+            sd_wrapper_free_image(&images[i]);
+        }
+        return err;
     }
 
     uint64_t generation_time = end_time - start_time;
@@ -242,17 +408,18 @@ error_code_t process_generate_request(sd_wrapper_ctx_t *ctx,
         generation_time = UINT32_MAX;
     }
 
-    resp->request_id = req->request_id;
+    memset(resp, 0, sizeof(*resp));
+    resp->request_id = req->base.request_id;
     resp->status = STATUS_OK;
     resp->generation_time_ms = (uint32_t)generation_time;
-    resp->image_width = image.width;
-    resp->image_height = image.height;
-    resp->channels = image.channels;
-    resp->image_data_len = (uint32_t)image.data_size;
-    resp->image_data = image.data;
-
-    /* Mark that a generation has been performed for reset logic */
-    generation_performed = true;
+    resp->image_width = images[0].width;
+    resp->image_height = images[0].height;
+    resp->channels = images[0].channels;
+    resp->image_count = req->seed_count;
+    resp->image_data_len = (uint32_t)images[0].data_size;
+    for (uint32_t i = 0; i < req->seed_count; i++) {
+        resp->images[i] = images[i].data;
+    }
 
     return ERR_NONE;
 }
@@ -284,3 +451,34 @@ void free_generate_response(sd35_generate_response_t *resp) {
         resp->image_data_len = 0;
     }
 }
+
+/**
+ * Free response image data allocated by process_generate_batch_request().
+ *
+ * Safe to call with NULL or already-freed image data.
+ *
+ * @param resp  Batch response structure (images will be freed and set to NULL)
+ */
+void free_generate_batch_response(sd35_generate_batch_response_t *resp) {
+    if (resp == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < SD35_MAX_BATCH_SIZE; i++) {
+        if (resp->images[i] != NULL) {
+            sd_wrapper_image_t image;
+            image.width = resp->image_width;
+            image.height = resp->image_height;
+            image.channels = resp->channels;
+            image.data = (uint8_t *)resp->images[i];
+            image.data_size = resp->image_data_len;
+
+            sd_wrapper_free_image(&image);
+
+            resp->images[i] = NULL;
+        }
+    }
+
+    resp->image_count = 0;
+    resp->image_data_len = 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * Weave Image Encode Module - PNG Encoding Implementation
+ *
+ * Output buffers are sized with PNG_IMAGE_PNG_SIZE_MAX() so libpng writes
+ * the file in a single pass. image_encode_png() then shrinks its buffer to
+ * the encoded size; image_encode_png_to() leaves that to the caller.
+ */
+
+#include <png.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "weave/image_encode.h"
+
+/**
+ * setup_image - Describe the pixels to libpng
+ *
+ * @return 0 on success, -1 if the parameters are invalid
+ */
+static int setup_image(png_image *image, uint32_t width, uint32_t height, uint32_t channels) {
+    if (width == 0 || height == 0 || (channels != 3 && channels != 4)) {
+        return -1;
+    }
+
+    /* Rules out overflow in PNG_IMAGE_PNG_SIZE_MAX(), which is below 2x the pixel bytes */
+    if (width > UINT32_MAX / height ||
+        (uint64_t)width * height > (uint64_t)SIZE_MAX / (2 * channels + 2)) {
+        return -1;
+    }
+
+    memset(image, 0, sizeof(*image));
+    image->version = PNG_IMAGE_VERSION;
+    image->width = width;
+    image->height = height;
+    image->format = channels == 4 ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+    image->flags = PNG_IMAGE_FLAG_FAST;
+    return 0;
+}
+
+/**
+ * image_encode_png_bound - Largest PNG file an image can encode to
+ */
+size_t image_encode_png_bound(uint32_t width, uint32_t height, uint32_t channels) {
+    png_image image;
+
+    if (setup_image(&image, width, height, channels) != 0) {
+        return 0;
+    }
+    return PNG_IMAGE_PNG_SIZE_MAX(image);
+}
+
+/**
+ * image_encode_png_to - Encode raw pixels as a PNG file into a caller buffer
+ */
+image_encode_error_t image_encode_png_to(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                         uint32_t channels, uint8_t *out, size_t capacity,
+                                         size_t *out_len) {
+    png_image image;
+    png_alloc_size_t written;
+
+    if (out_len == NULL) {
+        return IMAGE_ENCODE_ERR_NULL_POINTER;
+    }
+    *out_len = 0;
+
+    if (pixels == NULL || out == NULL) {
+        return IMAGE_ENCODE_ERR_NULL_POINTER;
+    }
+
+    if (setup_image(&image, width, height, channels) != 0) {
+        return IMAGE_ENCODE_ERR_INVALID_PARAMS;
+    }
+
+    if (capacity < PNG_IMAGE_PNG_SIZE_MAX(image)) {
+        return IMAGE_ENCODE_ERR_BUFFER_TOO_SMALL;
+    }
+
+    written = capacity;
+    if (!png_image_write_to_memory(&image, out, &written, 0, pixels, 0, NULL)) {
+        png_image_free(&image);
+        return IMAGE_ENCODE_ERR_ENCODE_FAILED;
+    }
+
+    *out_len = written;
+    return IMAGE_ENCODE_OK;
+}
+
+/**
+ * image_encode_png - Encode raw pixels as a PNG file
+ */
+image_encode_error_t image_encode_png(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                      uint32_t channels, uint8_t **out, size_t *out_len) {
+    image_encode_error_t err;
+    size_t capacity;
+    uint8_t *buffer;
+    uint8_t *shrunk;
+
+    if (out == NULL || out_len == NULL) {
+        return IMAGE_ENCODE_ERR_NULL_POINTER;
+    }
+    *out = NULL;
+    *out_len = 0;
+
+    if (pixels == NULL) {
+        return IMAGE_ENCODE_ERR_NULL_POINTER;
+    }
+
+    capacity = image_encode_png_bound(width, height, channels);
+    if (capacity == 0) {
+        return IMAGE_ENCODE_ERR_INVALID_PARAMS;
+    }
+
+    buffer = malloc(capacity);
+    if (buffer == NULL) {
+        return IMAGE_ENCODE_ERR_OUT_OF_MEMORY;
+    }
+
+    err = image_encode_png_to(pixels, width, height, channels, buffer, capacity, out_len);
+    if (err != IMAGE_ENCODE_OK) {
+        free(buffer);
+        return err;
+    }
+
+    /* Keep the larger buffer if shrinking fails */
+    shrunk = realloc(buffer, *out_len);
+    if (shrunk != NULL) {
+        buffer = shrunk;
+    }
+
+    *out = buffer;
+    return IMAGE_ENCODE_OK;
+}
+
+/**
+ * image_encode_error_string - Get human-readable error message
+ */
+const char *image_encode_error_string(image_encode_error_t err) {
+    switch (err) {
+        case IMAGE_ENCODE_OK:
+            return "success";
+        case IMAGE_ENCODE_ERR_NULL_POINTER:
+            return "NULL pointer argument";
+        case IMAGE_ENCODE_ERR_INVALID_PARAMS:
+            return "invalid image parameters";
+        case IMAGE_ENCODE_ERR_OUT_OF_MEMORY:
+            return "out of memory";
+        case IMAGE_ENCODE_ERR_ENCODE_FAILED:
+            return "PNG encoding failed";
+        case IMAGE_ENCODE_ERR_BUFFER_TOO_SMALL:
+            return "output buffer too small";
+        default:
+            return "unknown error";
+    }
+}
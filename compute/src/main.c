@@ -5,7 +5,8 @@
  * - Signal setup (SIGTERM, SIGINT for graceful shutdown)
  * - SD model loading
  * - Socket creation or connection
- * - Accept loop (server mode) or request/response loop (client mode)
+ * - Event loop over every client (server mode) or pipelined request/response
+ *   loop (client mode), both feeding one GPU worker per device
  * - Stdin monitoring (client mode only) for parent death detection
  * - Cleanup on exit
  *
@@ -25,17 +26,30 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "weave/buffer_pool.h"
+#include "weave/cache.h"
+#include "weave/connection.h"
 #include "weave/generate.h"
+#include "weave/image_encode.h"
+#include "weave/model_registry.h"
+#include "weave/pipeline.h"
 #include "weave/protocol.h"
 #include "weave/sd_wrapper.h"
+#include "weave/server_stats.h"
 #include "weave/socket.h"
+#include "weave/vram_plan.h"
 
 /**
  * Maximum message size for reading requests.
@@ -44,7 +58,80 @@
 #define MAX_REQUEST_SIZE (10 * 1024 * 1024)
 
 /**
- * Model paths (hardcoded for MVP).
+ * Steps between latent previews in progress frames.
+ * Every step still produces a step-only frame.
+ */
+#define PROGRESS_PREVIEW_INTERVAL 4
+
+/**
+ * Largest progress frame: header (16) + fields (36) + RGBA preview.
+ */
+#define MAX_PROGRESS_FRAME_SIZE \
+    (16 + 36 + SD35_MAX_PREVIEW_DIMENSION * SD35_MAX_PREVIEW_DIMENSION * 4)
+
+/**
+ * Maximum GPU devices (one SD wrapper context and pipeline worker each).
+ */
+#define MAX_GPU_DEVICES PIPELINE_MAX_WORKERS
+
+/**
+ * Default per-request deadline, measured from when the request was read.
+ * Kept below the Go client's 65s read timeout so an expired request is
+ * answered with ERR_TIMEOUT instead of being abandoned by the client.
+ */
+#define DEFAULT_REQUEST_TIMEOUT_S 60
+
+/**
+ * Default result cache budgets in MiB.
+ * The memory tier holds about 85 1024x1024 RGB images. The disk tier lives
+ * in $XDG_RUNTIME_DIR, usually RAM-backed tmpfs, so it is opt-in.
+ */
+#define DEFAULT_CACHE_SIZE_MB 256
+#define DEFAULT_CACHE_DISK_SIZE_MB 0
+#define MAX_CACHE_SIZE_MB (64 * 1024)
+
+/**
+ * Longest result cache fingerprint: five model file identities (path, size,
+ * mtime), the model settings and the per-device settings.
+ */
+#define RESULT_FINGERPRINT_MAX (6 * MODEL_REGISTRY_PATH_MAX)
+
+/**
+ * Vulkan pipeline cache directory, under $XDG_CACHE_HOME/weave (or
+ * ~/.cache/weave). It must outlive the session, so unlike the result cache's
+ * disk tier it does not go in $XDG_RUNTIME_DIR.
+ */
+#define PIPELINE_CACHE_DIR_NAME "vulkan-pipelines"
+
+/**
+ * --warmup generation: one step compiles and allocates everything a full
+ * generation at the same size does. CFG above 1 runs the unconditioned pass
+ * as well.
+ */
+#define WARMUP_STEPS 1
+#define WARMUP_CFG_SCALE 4.5f
+#define WARMUP_PROMPT "warm-up"
+
+/**
+ * Default --retain-results in MiB: about 21 1024x1024 RGB images that later
+ * requests can refine. Memory only; handles do not survive a restart.
+ */
+#define DEFAULT_RETAIN_RESULTS_MB 64
+
+/**
+ * Default and largest --buffer-pool in MiB.
+ * Enough idle buffers for a pipeline full of 1024x1024 PNG responses.
+ */
+#define DEFAULT_BUFFER_POOL_MB 64
+#define MAX_BUFFER_POOL_MB (64 * 1024)
+
+/**
+ * Largest --vram-budget in MiB.
+ */
+#define MAX_VRAM_BUDGET_MB (1024 * 1024)
+
+/**
+ * Default model, used when no --models config is given.
  */
 #define MODEL_PATH "./config/models/sd3.5_medium.safetensors"
 #define CLIP_L_PATH "./config/models/clip_l.safetensors"
@@ -68,14 +155,67 @@ static int g_socket_fd = -1;
 static int g_socket_owned = 0;
 
 /**
- * Global SD wrapper context for cleanup.
- * NOT accessed from signal handlers.
+ * One generation device: the models loaded on one Vulkan device and the
+ * buffer its progress frames are encoded into.
  *
- * IMPORTANT: The SD wrapper context is NOT thread-safe. weave-compute handles
- * connections sequentially (one at a time) in the main thread. Do NOT add
- * concurrent request processing without adding proper synchronization.
+ * IMPORTANT: SD wrapper contexts and model registries are NOT thread-safe.
+ * Each device is used by exactly one thread at a time: its own GPU worker
+ * thread while a pipeline runs (see serve_pipelined() and serve_clients()),
+ * or the main thread when the pipeline cannot be started.
+ */
+typedef struct {
+    model_registry_t *models;    /* Models loaded on this device */
+    sd_wrapper_ctx_t *sd_ctx;    /* Context of the model being generated */
+    int device_index;            /* Vulkan device index (-1 = library default) */
+    bool planned;                /* plans[] is set (see plan_device_models()) */
+    vram_plan_t plans[MODEL_REGISTRY_MAX_MODELS]; /* Per g_models[] entry */
+    uint8_t progress_buf[MAX_PROGRESS_FRAME_SIZE]; /* Progress frame encode buffer */
+} gpu_device_t;
+
+/**
+ * Loaded devices, for cleanup. NOT accessed from signal handlers.
+ * Set up in main() before any request is read.
+ */
+static gpu_device_t g_devices[MAX_GPU_DEVICES];
+static int g_device_count = 0;
+
+/**
+ * Configured models (from --models, or the default model).
+ * Read-only once requests are being read.
+ */
+static model_config_t g_models[MODEL_REGISTRY_MAX_MODELS];
+static size_t g_model_count = 0;
+
+/**
+ * Result cache fingerprint of each g_models[] entry: its files and the
+ * settings that change its output (see build_model_fingerprints()). NULL
+ * entries are not cached. Read-only once requests are being read.
+ */
+static char *g_model_fingerprints[MODEL_REGISTRY_MAX_MODELS];
+
+/**
+ * VRAM budget per device for loaded models in bytes (0 = unlimited).
+ * Set once from --vram-budget before any model is loaded.
+ */
+static size_t g_vram_budget = 0;
+
+/**
+ * Load models from prepared F16 GGUF copies of their weight files, creating
+ * them on first load. Set once from --prepare-models.
  */
-static sd_wrapper_ctx_t *g_sd_ctx = NULL;
+static bool g_prepare_weights = false;
+
+/**
+ * Keep each SD context and its weights across generations instead of
+ * reloading them before every request. Set once from --reuse-context.
+ */
+static bool g_reuse_context = false;
+
+/**
+ * Fit each model's placement and weight type to each device's free VRAM at
+ * startup. Cleared by --no-vram-plan to use the configured placement as-is.
+ */
+static bool g_vram_plan = true;
 
 /**
  * Global stdin monitoring thread handle.
@@ -84,6 +224,129 @@ static sd_wrapper_ctx_t *g_sd_ctx = NULL;
  */
 static pthread_t g_stdin_monitor_thread = 0;
 
+/**
+ * Per-request deadline in seconds (0 = no deadline).
+ * Set once from --request-timeout before any request is read.
+ */
+static long g_request_timeout_s = DEFAULT_REQUEST_TIMEOUT_S;
+
+/**
+ * Result cache for deterministic (fixed seed) requests, NULL if disabled.
+ * Shared by every generating thread; all access holds g_result_cache_lock.
+ */
+static result_cache_t *g_result_cache = NULL;
+static pthread_mutex_t g_result_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Recent results kept by (owner, request_id, index) for SD35_INIT_RETAINED,
+ * NULL if --retain-results is 0. The owner is the connection the result was
+ * sent on, since request IDs are only unique per client; a connection's
+ * results are dropped when it closes. Separate from g_result_cache so
+ * deterministic traffic cannot evict them; all access holds g_retained_lock.
+ */
+static result_cache_t *g_retained = NULL;
+static pthread_mutex_t g_retained_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Last retained result owner handed out by new_retained_owner(); guarded by
+ * g_retained_lock.
+ */
+static uint64_t g_last_owner = 0;
+
+/**
+ * Recycled request message and PNG buffers, NULL if --buffer-pool is 0.
+ * Created before any request is read; internally locked.
+ */
+static buffer_pool_t *g_buffer_pool = NULL;
+
+/**
+ * Counters, stage histograms and per-class wait estimates, for admission
+ * control and MSG_STATS_REQUEST. Initialized first thing in main();
+ * internally locked.
+ */
+static server_stats_t g_stats;
+
+/**
+ * Progress stream state for the request currently being generated.
+ * Only used from the thread generating on the stream's device.
+ */
+typedef struct {
+    gpu_device_t *device;    /* Device generating the request */
+    int client_fd;           /* Client socket */
+    uint64_t request_id;     /* Request ID echoed in every frame */
+    struct timespec start;   /* When the request was received */
+    int write_failed;        /* Stop streaming after the first write error */
+    connection_t *conn;      /* Connection owning client_fd (NULL if single-threaded) */
+} progress_stream_t;
+
+/**
+ * Bytes for send_buffer().
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} send_buffer_t;
+
+/**
+ * One request moving through the request stages.
+ *
+ * read_request() fills in the header fields and decoded request,
+ * run_request() adds the response or an error, and send_request_response()
+ * writes the reply and releases everything the job owns.
+ */
+typedef struct {
+    uint16_t msg_type;                          /* Request message type */
+    uint16_t version;                           /* Request protocol version */
+    uint32_t flags;                             /* Request header flags */
+    uint8_t *buffer;                            /* Request message (decoded fields point into it) */
+    size_t total_size;                          /* Size of buffer in bytes */
+    sd35_generate_request_t req;                /* Decoded single request */
+    sd35_generate_batch_request_t batch_req;    /* Decoded batch request */
+    uint8_t *init_pixels;                       /* Recalled retained init image (owned), or NULL */
+    sd35_generate_response_t resp;              /* Single response (owns image data) */
+    size_t png_size;                            /* Pool size of a PNG resp.image_data (0 if not pooled) */
+    sd35_generate_batch_response_t batch_resp;  /* Batch response (owns image data) */
+    cancel_request_t cancel;                    /* Decoded MSG_CANCEL */
+    stats_request_t stats_req;                  /* Decoded MSG_STATS_REQUEST */
+    sd35_prepare_request_t prep_req;            /* Decoded MSG_PREPARE */
+    uint64_t request_id;                        /* Request ID to echo (0 if invalid) */
+    uint64_t owner;                             /* Retained result owner of its connection */
+    struct timespec received;                   /* CLOCK_MONOTONIC time the header arrived */
+    sd35_generate_timings_t timings;            /* Stage durations (PROTOCOL_FLAG_TIMINGS) */
+    int has_deadline;                           /* Whether deadline applies */
+    struct timespec deadline;                   /* CLOCK_MONOTONIC expiry */
+    server_stats_ticket_t ticket;               /* Where it was admitted (pipeline only) */
+    int tracked;                                /* Registered as in flight (pipeline only) */
+    connection_t *conn;                         /* Source connection, referenced (pipeline only) */
+    error_code_t error;                         /* Error to reply with (ERR_NONE if none) */
+    const char *error_msg;                      /* Human-readable message for error */
+} request_job_t;
+
+/**
+ * Server-mode read state of one client: the connection its requests are
+ * dispatched on and the request it is part way through. The event loop
+ * reads each client without blocking, so a partial header or payload stays
+ * here until the rest arrives.
+ */
+typedef struct {
+    connection_t *conn;          /* Connection requests are dispatched on */
+    uint8_t header[16];          /* Header bytes read so far */
+    size_t header_len;           /* Bytes in header */
+    request_job_t *job;          /* Job awaiting the rest of its payload, or NULL */
+    protocol_header_t hdr;       /* Validated header of job */
+    error_code_t header_err;     /* decode_header() result for job */
+    size_t payload_read;         /* Payload bytes of job read so far */
+} client_reader_t;
+
+/**
+ * Abort state for the request being generated, polled by the SD wrapper.
+ */
+typedef struct {
+    connection_t *conn;          /* Cancellation source (NULL when single-threaded) */
+    const request_job_t *job;    /* Request being generated */
+    error_code_t reason;         /* ERR_CANCELLED or ERR_TIMEOUT once aborted */
+} abort_check_t;
+
 /**
  * print_usage - Print usage information and exit
  *
@@ -99,6 +362,48 @@ static void print_usage(const char *program_name, int exit_code) {
     fprintf(stream, "\n");
     fprintf(stream, "Options:\n");
     fprintf(stream, "  --socket-path PATH  Unix socket path (default: $XDG_RUNTIME_DIR/weave/weave.sock)\n");
+    fprintf(stream, "  --request-timeout SECONDS\n");
+    fprintf(stream, "                      Per-request deadline, 0 to disable (default: %d)\n",
+            DEFAULT_REQUEST_TIMEOUT_S);
+    fprintf(stream, "  --cache-size MB     Result cache memory budget, 0 to disable (default: %d)\n",
+            DEFAULT_CACHE_SIZE_MB);
+    fprintf(stream, "  --cache-disk-size MB\n");
+    fprintf(stream, "                      Result cache budget in $XDG_RUNTIME_DIR/weave/%s,\n",
+            RESULT_CACHE_DIR_NAME);
+    fprintf(stream, "                      0 to disable (default: %d)\n",
+            DEFAULT_CACHE_DISK_SIZE_MB);
+    fprintf(stream, "  --retain-results MB Recent results kept for refinement requests,\n");
+    fprintf(stream, "                      0 to disable (default: %d)\n", DEFAULT_RETAIN_RESULTS_MB);
+    fprintf(stream, "  --buffer-pool MB    Idle request and PNG buffers kept for reuse,\n");
+    fprintf(stream, "                      0 to disable (default: %d)\n", DEFAULT_BUFFER_POOL_MB);
+    fprintf(stream, "  --buffer-pool-hugepages\n");
+    fprintf(stream, "                      Back pooled buffers of 2 MiB and up with hugepages\n");
+    fprintf(stream, "  --buffer-pool-lock  mlock() pooled buffers so they stay resident\n");
+    fprintf(stream, "                      (limited by RLIMIT_MEMLOCK)\n");
+    fprintf(stream, "  --devices LIST      Comma-separated Vulkan device indices to generate on,\n");
+    fprintf(stream, "                      one model copy each (default: library default device)\n");
+    fprintf(stream, "  --models PATH       Model registry config mapping model IDs to model files\n");
+    fprintf(stream, "                      (default: SD 3.5 Medium as model 0, pinned)\n");
+    fprintf(stream, "  --vram-budget MB    VRAM per device for loaded models; least recently used\n");
+    fprintf(stream, "                      unpinned models are unloaded to stay within it,\n");
+    fprintf(stream, "                      0 for no limit (default: 0)\n");
+    fprintf(stream, "  --no-t5             Load no T5-XXL encoder; condition on CLIP-L/G only,\n");
+    fprintf(stream, "                      which saves host RAM and encode time\n");
+    fprintf(stream, "  --no-vram-plan      Use the configured CPU/GPU placement and F16 weights\n");
+    fprintf(stream, "                      instead of fitting them to each device's free VRAM\n");
+    fprintf(stream, "  --pipeline-cache DIR\n");
+    fprintf(stream, "                      Keep compiled Vulkan pipelines in DIR across runs\n");
+    fprintf(stream, "                      (default: $XDG_CACHE_HOME/weave/%s)\n",
+            PIPELINE_CACHE_DIR_NAME);
+    fprintf(stream, "  --no-pipeline-cache Leave the drivers' pipeline cache settings alone\n");
+    fprintf(stream, "  --warmup WxH        Generate one %d-step WxH image with each pinned model\n",
+            WARMUP_STEPS);
+    fprintf(stream, "                      before connecting, so the first request does not\n");
+    fprintf(stream, "                      pay for pipeline compilation (default: off)\n");
+    fprintf(stream, "  --prepare-models    Convert weight files once to F16 GGUF next to them and\n");
+    fprintf(stream, "                      load those on later starts (needs free disk space)\n");
+    fprintf(stream, "  --reuse-context     Keep models loaded between requests instead of reloading\n");
+    fprintf(stream, "                      them (experimental: see docs/bugs/002-segfault.md)\n");
     fprintf(stream, "  -h, --help          Show this help message and exit\n");
     fprintf(stream, "\n");
     fprintf(stream, "weave-compute loads SD 3.5 Medium and processes image generation requests.\n");
@@ -213,6 +518,13 @@ static int setup_signals(void) {
         return -1;
     }
 
+    /* A client that disconnects mid-reply fails that write, not the daemon */
+    sa.sa_handler = SIG_IGN;
+    if (sigaction(SIGPIPE, &sa, NULL) != 0) {
+        perror("sigaction(SIGPIPE)");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -273,6 +585,93 @@ static int write_full(int fd, const uint8_t *buf, size_t count) {
     return 0;
 }
 
+/**
+ * send_buffer - connection_send() callback writing one buffer
+ *
+ * @param fd   Client socket
+ * @param arg  send_buffer_t to write
+ * @return     write_full() result
+ */
+static int send_buffer(int fd, void *arg) {
+    const send_buffer_t *buf = (const send_buffer_t *)arg;
+
+    return write_full(fd, buf->data, buf->len);
+}
+
+/**
+ * writev_full - Write every iovec to socket
+ *
+ * Handles partial writes and EINTR like write_full(). Advances iov in place,
+ * so the caller's array is consumed.
+ *
+ * @param fd      Socket file descriptor
+ * @param iov     Buffers to write, in order
+ * @param iovcnt  Number of buffers
+ * @return        0 on success, -1 on error or timeout
+ */
+static int writev_full(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        size_t written = (size_t)n;
+        while (iovcnt > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * send_image_response - Write a response prefix followed by its image data
+ *
+ * When the request set PROTOCOL_FLAG_SHM, the image buffers are copied into a
+ * sealed memfd passed with the prefix via SCM_RIGHTS, and the prefix header
+ * is rewritten to leave them out of payload_len. Otherwise, or if shared
+ * memory cannot be set up, everything is written inline with writev().
+ *
+ * @param client_fd  Client socket
+ * @param iov        iov[0] is the encoded prefix, iov[1..] the image data
+ * @param iovcnt     Number of buffers (at least 2)
+ * @param flags      Request header flags
+ * @return           0 on success, -1 on error
+ */
+static int send_image_response(int client_fd, struct iovec *iov, int iovcnt, uint32_t flags) {
+    if ((flags & PROTOCOL_FLAG_SHM) != 0) {
+        size_t tail_len = 0;
+        int shm_fd;
+
+        for (int i = 1; i < iovcnt; i++) {
+            tail_len += iov[i].iov_len;
+        }
+
+        if (tail_len <= UINT32_MAX &&
+            socket_create_shm(iov + 1, iovcnt - 1, &shm_fd) == SOCKET_OK) {
+            socket_error_t sock_err;
+
+            move_payload_tail_to_shm(iov[0].iov_base, (uint32_t)tail_len);
+            sock_err = socket_send_with_fd(client_fd, iov[0].iov_base, iov[0].iov_len, shm_fd);
+            close(shm_fd);
+            return sock_err == SOCKET_OK ? 0 : -1;
+        }
+        /* Shared memory unavailable - fall back to inline pixels */
+    }
+
+    return writev_full(client_fd, iov, iovcnt);
+}
+
 /**
  * is_server_error - Check if error code indicates a server-side error
  *
@@ -290,6 +689,7 @@ static int is_server_error(error_code_t code) {
     case ERR_GPU_ERROR:
     case ERR_TIMEOUT:
     case ERR_INTERNAL:
+    case ERR_BUSY:
         return 1;
 
     /* Client-side errors (400) - everything else */
@@ -301,6 +701,12 @@ static int is_server_error(error_code_t code) {
     case ERR_INVALID_DIMENSIONS:
     case ERR_INVALID_STEPS:
     case ERR_INVALID_CFG:
+    case ERR_INVALID_SEED_COUNT:
+    case ERR_CANCELLED:
+    case ERR_INVALID_SAMPLER:
+    case ERR_INVALID_INIT_IMAGE:
+    case ERR_INVALID_PRIORITY:
+    case ERR_NO_CLIP_ONLY:
     default:
         return 0;
     }
@@ -350,209 +756,2702 @@ static int send_error_response(int client_fd, uint64_t request_id,
 }
 
 /**
- * handle_connection - Process a single request on a client connection
- *
- * This function:
- * 1. Reads request from socket (header then payload)
- * 2. Decodes and validates request
- * 3. Processes generation request
- * 4. Encodes and sends response (reusing request buffer)
- *
- * Note: We reuse request_buf for the response to save memory (10MB).
- * This is safe because we're done with the request data by the time we encode.
- *
- * Return value semantics:
- * - 0: Request processed successfully, connection still active (continue loop)
- * - -1: Connection closed by peer or fatal error (exit loop)
+ * send_progress_frame - Progress callback writing MSG_GENERATE_PROGRESS frames
  *
- * Protocol errors (invalid requests) are handled by sending error responses
- * and returning 0 to continue processing. Only connection loss or fatal
- * errors return -1.
+ * Runs synchronously on the generating thread. A write error ends the
+ * stream; in the pipeline it also marks the connection broken (see
+ * connection_send()), so its later replies are skipped.
  *
- * @param client_fd  Authenticated client socket
- * @return           0 on success (continue), -1 on connection close/fatal error (exit)
+ * @param progress   Step report from the SD wrapper
+ * @param user_data  progress_stream_t for the current request
  */
-static int handle_connection(int client_fd) {
-    /* All variable declarations at top for C99 compliance */
-    uint8_t header[16];
-    uint8_t *buffer = NULL;
-    uint32_t magic;
-    uint32_t payload_len;
-    size_t total_size;
-    sd35_generate_request_t req;
-    sd35_generate_response_t resp;
+static void send_progress_frame(const sd_wrapper_progress_t *progress, void *user_data) {
+    progress_stream_t *stream = (progress_stream_t *)user_data;
+    sd35_generate_progress_t frame;
+    struct timespec now;
+    size_t frame_len;
     error_code_t err;
-    size_t response_len;
-
-    /*
-     * Security: Read header into small stack buffer first, validate payload
-     * length, then allocate only the exact size needed. This prevents memory
-     * exhaustion attacks where an attacker sends headers claiming large
-     * payloads to force expensive allocations.
-     */
 
-    /*
-     * Step 1: Read 16-byte header into stack buffer.
-     * If read fails, it's either connection close or I/O error.
-     * In both cases, we return -1 to exit the request loop.
-     */
-    if (read_full(client_fd, header, 16) != 0) {
-        /* Connection closed or I/O error - exit loop */
-        return -1;
+    if (stream == NULL || stream->write_failed) {
+        return;
     }
 
-    /* Step 2: Validate magic number before any allocation */
-    magic = (uint32_t)header[0] << 24 |
-            (uint32_t)header[1] << 16 |
-            (uint32_t)header[2] << 8 |
-            (uint32_t)header[3];
-
-    if (magic != PROTOCOL_MAGIC) {
-        fprintf(stderr, "invalid magic number: 0x%08x\n", magic);
-        send_error_response(client_fd, 0, ERR_INVALID_MAGIC, "invalid magic number");
-        /* Protocol error - send error response and continue processing */
-        return 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    memset(&frame, 0, sizeof(frame));
+    frame.request_id = stream->request_id;
+    frame.step = progress->step;
+    frame.total_steps = progress->total_steps;
+    frame.elapsed_ms = (uint32_t)((now.tv_sec - stream->start.tv_sec) * 1000 +
+                                  (now.tv_nsec - stream->start.tv_nsec) / 1000000);
+
+    if (progress->preview != NULL && progress->preview->data_size <= UINT32_MAX) {
+        frame.preview_width = progress->preview->width;
+        frame.preview_height = progress->preview->height;
+        frame.preview_channels = progress->preview->channels;
+        frame.preview_data_len = (uint32_t)progress->preview->data_size;
+        frame.preview_data = progress->preview->data;
     }
 
-    /* Step 3: Validate payload length before allocation */
-    payload_len = (uint32_t)header[8] << 24 |
-                  (uint32_t)header[9] << 16 |
-                  (uint32_t)header[10] << 8 |
-                  (uint32_t)header[11];
-
-    if (payload_len > MAX_REQUEST_SIZE - 16) {
-        fprintf(stderr, "request payload too large: %u bytes\n", payload_len);
-        send_error_response(client_fd, 0, ERR_INTERNAL, "payload too large");
-        /* Protocol error - send error response and continue processing */
-        return 0;
+    err = encode_generate_progress(&frame, stream->device->progress_buf,
+                                   sizeof(stream->device->progress_buf), &frame_len);
+    if (err == ERR_INVALID_DIMENSIONS) {
+        /* Preview does not fit the protocol bounds - report the step alone */
+        frame.preview_width = 0;
+        frame.preview_height = 0;
+        frame.preview_channels = 0;
+        frame.preview_data_len = 0;
+        frame.preview_data = NULL;
+        err = encode_generate_progress(&frame, stream->device->progress_buf,
+                                       sizeof(stream->device->progress_buf), &frame_len);
     }
-
-    /* Step 4: Allocate exact size needed (header + payload) */
-    total_size = 16 + payload_len;
-    buffer = malloc(total_size);
-    if (buffer == NULL) {
-        fprintf(stderr, "failed to allocate buffer (%zu bytes)\n", total_size);
-        /* Out of memory - fatal error, exit loop */
-        return -1;
+    if (err != ERR_NONE) {
+        return;
     }
 
-    /* Copy header into buffer */
-    memcpy(buffer, header, 16);
+    if (stream->conn != NULL) {
+        send_buffer_t buf = {stream->device->progress_buf, frame_len};
 
-    /* Step 5: Read payload if present */
-    if (payload_len > 0) {
-        if (read_full(client_fd, buffer + 16, payload_len) != 0) {
-            /* Connection closed or I/O error - exit loop */
-            free(buffer);
-            return -1;
+        if (connection_send(stream->conn, send_buffer, &buf) != CONNECTION_OK) {
+            stream->write_failed = 1;
         }
+    } else if (write_full(stream->client_fd, stream->device->progress_buf, frame_len) != 0) {
+        stream->write_failed = 1;
     }
+}
 
-    err = decode_generate_request(buffer, 16 + payload_len, &req);
-    if (err != ERR_NONE) {
-        fprintf(stderr, "failed to decode request: %d\n", err);
-        send_error_response(client_fd, 0, err, "invalid request");
-        free(buffer);
-        /* Protocol error - send error response and continue processing */
-        return 0;
+/**
+ * progress_stream_begin - Start streaming progress if the request asked for it
+ *
+ * @param stream      Stream state to initialize
+ * @param device      Device generating the request
+ * @param client_fd   Client socket
+ * @param request_id  Request ID to echo
+ * @param flags       Request header flags
+ * @param conn        Connection owning client_fd (NULL if single-threaded)
+ */
+static void progress_stream_begin(progress_stream_t *stream, gpu_device_t *device,
+                                  int client_fd, uint64_t request_id, uint32_t flags,
+                                  connection_t *conn) {
+    if ((flags & PROTOCOL_FLAG_PROGRESS) == 0) {
+        return;
     }
 
-    memset(&resp, 0, sizeof(resp));
+    stream->device = device;
+    stream->client_fd = client_fd;
+    stream->request_id = request_id;
+    stream->write_failed = 0;
+    stream->conn = conn;
+    clock_gettime(CLOCK_MONOTONIC, &stream->start);
 
-    err = process_generate_request(g_sd_ctx, &req, &resp);
-    if (err != ERR_NONE) {
-        fprintf(stderr, "generation failed: %d\n", err);
-        send_error_response(client_fd, req.request_id, err, "generation failed");
-        free(buffer);
-        /* Generation error - send error response and continue processing */
-        return 0;
+    sd_wrapper_set_progress_callback(device->sd_ctx, send_progress_frame, stream,
+                                     PROGRESS_PREVIEW_INTERVAL);
+}
+
+/**
+ * progress_stream_end - Stop streaming progress for the current request
+ *
+ * @param device  Device generating the request
+ * @param flags   Request header flags (as passed to progress_stream_begin)
+ */
+static void progress_stream_end(gpu_device_t *device, uint32_t flags) {
+    if ((flags & PROTOCOL_FLAG_PROGRESS) == 0) {
+        return;
     }
 
-    /*
-     * Response may be larger than request (contains image data).
-     * Reallocate buffer to hold the response.
-     * Response size = header (16) + response metadata (16) + image metadata (16) + image data.
-     */
-    {
-        size_t response_buf_size = 16 + 16 + 16 + resp.image_data_len;
-        uint8_t *response_buf = realloc(buffer, response_buf_size);
-        if (response_buf == NULL) {
-            fprintf(stderr, "failed to allocate response buffer (%zu bytes)\n",
-                    response_buf_size);
-            free_generate_response(&resp);
-            free(buffer);
-            /* Out of memory - fatal error, exit loop */
-            return -1;
-        }
-        buffer = response_buf;
+    sd_wrapper_set_progress_callback(device->sd_ctx, NULL, NULL, 0);
+}
 
-        err = encode_generate_response(&resp, buffer, response_buf_size, &response_len);
-    }
-    free_generate_response(&resp);
+/**
+ * release_request_buffer - Return a job's request message to the buffer pool
+ *
+ * Fields decoded from the message point into it, so they must not be used
+ * afterwards.
+ *
+ * @param job  Job whose buffer to release (no-op if already released)
+ */
+static void release_request_buffer(request_job_t *job) {
+    buffer_pool_put(g_buffer_pool, job->buffer, job->total_size);
+    job->buffer = NULL;
+}
 
-    if (err != ERR_NONE) {
-        fprintf(stderr, "failed to encode response: %d\n", err);
-        free(buffer);
-        /* Encoding error - fatal error, exit loop */
-        return -1;
+/**
+ * release_request_job - Free everything a job still owns
+ *
+ * Safe on a job at any stage. Does not free the job itself.
+ *
+ * @param job  Job to release
+ */
+static void release_request_job(request_job_t *job) {
+    release_request_buffer(job);
+    if (job->png_size > 0) {
+        buffer_pool_put(g_buffer_pool, (void *)job->resp.image_data, job->png_size);
+        job->resp.image_data = NULL;
+        job->png_size = 0;
     }
+    free_generate_response(&job->resp);
+    free_generate_batch_response(&job->batch_resp);
+    free(job->init_pixels);
+    job->init_pixels = NULL;
+}
 
-    if (write_full(client_fd, buffer, response_len) != 0) {
-        /* Connection closed or I/O error - exit loop */
-        free(buffer);
-        return -1;
+/**
+ * find_model - Look up a configured model
+ *
+ * @param model_id  Protocol model_id
+ * @return          Model configuration, or NULL if not configured
+ */
+static const model_config_t *find_model(uint32_t model_id) {
+    for (size_t i = 0; i < g_model_count; i++) {
+        if (g_models[i].model_id == model_id) {
+            return &g_models[i];
+        }
     }
+    return NULL;
+}
 
-    /* Success - request processed, connection still active */
-    free(buffer);
-    return 0;
+/**
+ * is_control_message - Whether a job is answered by the reader, not generated
+ *
+ * @param job  Job from read_request()
+ * @return     1 for MSG_CANCEL and MSG_STATS_REQUEST, 0 otherwise
+ */
+static int is_control_message(const request_job_t *job) {
+    return job->msg_type == MSG_CANCEL || job->msg_type == MSG_STATS_REQUEST;
 }
 
 /**
- * cleanup - Clean up resources before exit
+ * is_prepare_message - Whether a job is a valid MSG_PREPARE
+ *
+ * Such jobs go to a device like generation requests but are not counted as
+ * requests and get no reply.
+ *
+ * @param job  Job from read_request()
+ * @return     1 for a MSG_PREPARE that decoded, 0 otherwise
  */
-static void cleanup(void) {
-    if (g_sd_ctx != NULL) {
-        fprintf(stderr, "unloading model...\n");
-        sd_wrapper_free(g_sd_ctx);
-        g_sd_ctx = NULL;
-    }
+static int is_prepare_message(const request_job_t *job) {
+    return job->msg_type == MSG_PREPARE && job->error == ERR_NONE;
+}
 
-    if (g_socket_fd >= 0) {
-        close(g_socket_fd);
-        g_socket_fd = -1;
+/**
+ * is_invalid_prepare - Whether a job is a MSG_PREPARE that failed validation
+ *
+ * A prepare is only a hint with no reply of its own, so these are dropped
+ * by the reader: request_decode() has logged why, and they are neither
+ * answered nor counted as requests.
+ *
+ * @param job  Job from read_request()
+ * @return     1 for a MSG_PREPARE with an error, 0 otherwise
+ */
+static int is_invalid_prepare(const request_job_t *job) {
+    return job->msg_type == MSG_PREPARE && job->error != ERR_NONE;
+}
+
+/**
+ * elapsed_us - Microseconds from one CLOCK_MONOTONIC time to a later one
+ */
+static uint64_t elapsed_us(const struct timespec *from, const struct timespec *to) {
+    int64_t us = (int64_t)(to->tv_sec - from->tv_sec) * 1000000 +
+                 (to->tv_nsec - from->tv_nsec) / 1000;
+    return us > 0 ? (uint64_t)us : 0;
+}
+
+/**
+ * request_model_id - Model a decoded generation request asks for
+ *
+ * @param job  Job holding a decoded single or batch request
+ * @return     Protocol model_id
+ */
+static uint32_t request_model_id(const request_job_t *job) {
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        return job->batch_req.base.model_id;
+    }
+    if (job->msg_type == MSG_PREPARE) {
+        return job->prep_req.model_id;
     }
+    return job->req.model_id;
+}
 
-    /*
-     * Only clean up socket file if we created it.
-     * If we connected to a socket created by weave, weave owns the cleanup.
-     */
-    if (g_socket_owned) {
-        socket_cleanup();
+/**
+ * request_base - Generation parameters of a decoded single or batch request
+ *
+ * @param job  Job holding a decoded single or batch request
+ * @return     The single request, or the batch request's base
+ */
+static const sd35_generate_request_t *request_base(const request_job_t *job) {
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        return &job->batch_req.base;
     }
+    return &job->req;
 }
 
-int main(int argc, char *argv[]) {
-    /* Variable declarations at top for C99 compliance */
-    int exit_code = EXIT_FAILURE;
-    socket_error_t err;
+/**
+ * route_clip_only - Hand a PROTOCOL_FLAG_CLIP_ONLY request to its CLIP-only model
+ *
+ * Models loaded without T5-XXL serve the request themselves; models with a
+ * clip_only model hand it over. The result cache keys on the model the
+ * request ends up with, so CLIP-only results never answer T5 requests.
+ *
+ * The SD wrapper gives every text encoder the same prompt, so a model with
+ * T5-XXL cannot zero its T5 conditioning for one request. Without a
+ * CLIP-only model such requests are refused rather than served with T5.
+ *
+ * @param job  Job holding a decoded single, batch or prepare request
+ * @return     1 if the request is served CLIP-only (or names an unconfigured
+ *             model, left to the caller), 0 if no model can serve it
+ */
+static int route_clip_only(request_job_t *job) {
+    const model_config_t *model = find_model(request_model_id(job));
+    uint32_t target;
+
+    if (model == NULL) {
+        return 1;
+    }
+
+    target = model_config_clip_only_model(model);
+    if (target == MODEL_REGISTRY_NO_MODEL) {
+        return 0;
+    }
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        job->batch_req.base.model_id = target;
+    } else if (job->msg_type == MSG_PREPARE) {
+        job->prep_req.model_id = target;
+    } else {
+        job->req.model_id = target;
+    }
+    return 1;
+}
+
+/**
+ * request_begin - Start a request from its 16-byte header
+ *
+ * Records when the request arrived, validates the header before allocating,
+ * and allocates the buffer its payload is read into. Protocol errors do not
+ * fail the request: they are recorded in job->error and answered by
+ * send_request_response() in request order.
+ *
+ * @param job         Output job (cleared by this function)
+ * @param header      The 16 header bytes
+ * @param hdr         Output validated header, for request_decode()
+ * @param header_err  Output decode_header() result, for request_decode()
+ * @return            1 if hdr->payload_len bytes must be read into
+ *                    job->buffer + 16 and passed to request_decode(),
+ *                    0 if the job is complete (rejected without a payload),
+ *                    -1 on fatal error (out of memory)
+ */
+static int request_begin(request_job_t *job, const uint8_t *header,
+                         protocol_header_t *hdr, error_code_t *header_err) {
+    memset(job, 0, sizeof(*job));
+    job->error = ERR_NONE;
+
+    /* The deadline and the queue stage cover time spent behind other requests */
+    clock_gettime(CLOCK_MONOTONIC, &job->received);
+    if (g_request_timeout_s > 0) {
+        job->deadline = job->received;
+        job->deadline.tv_sec += g_request_timeout_s;
+        job->has_deadline = 1;
+    }
+
+    /*
+     * Validate the header once, before any allocation. The payload
+     * decoders in request_decode() trust it instead of parsing it again. A
+     * bad version is reported only after its payload is read, so the stream
+     * stays framed.
+     */
+    *header_err = decode_header(header, 16, hdr);
+
+    if (*header_err == ERR_INVALID_MAGIC) {
+        fprintf(stderr, "invalid magic number: 0x%08x\n", hdr->magic);
+        /* Protocol error - send error response and continue processing */
+        job->error = ERR_INVALID_MAGIC;
+        job->error_msg = "invalid magic number";
+        return 0;
+    }
+
+    /* Validate payload length before allocation */
+    if (*header_err == ERR_INTERNAL || hdr->payload_len > MAX_REQUEST_SIZE - 16) {
+        fprintf(stderr, "request payload too large: %u bytes\n", hdr->payload_len);
+        /* Protocol error - send error response and continue processing */
+        job->error = ERR_INTERNAL;
+        job->error_msg = "payload too large";
+        return 0;
+    }
+
+    /* Allocate exact size needed (header + payload) */
+    job->total_size = 16 + (size_t)hdr->payload_len;
+    job->buffer = buffer_pool_get(g_buffer_pool, job->total_size);
+    if (job->buffer == NULL) {
+        fprintf(stderr, "failed to allocate buffer (%zu bytes)\n", job->total_size);
+        /* Out of memory - fatal error, exit loop */
+        return -1;
+    }
+
+    /* Copy header into buffer */
+    memcpy(job->buffer, header, 16);
+
+    return 1;
+}
+
+/**
+ * request_decode - Decode a request whose payload has been read
+ *
+ * Decodes the payload by msg_type (single, batch or control message) and
+ * checks the requested model is configured. Errors are recorded in the job
+ * as for request_begin().
+ *
+ * @param job         Job from request_begin() with its payload read
+ * @param hdr         Header from request_begin()
+ * @param header_err  Header result from request_begin()
+ */
+static void request_decode(request_job_t *job, const protocol_header_t *hdr,
+                           error_code_t header_err) {
+    const uint8_t *payload = job->buffer + 16;
+    error_code_t err;
+
+    job->version = hdr->version;
+    job->msg_type = hdr->msg_type;
+    job->flags = hdr->flags;
+
+    if (header_err != ERR_NONE) {
+        fprintf(stderr, "unsupported protocol version: %u\n", (unsigned)hdr->version);
+        err = header_err;
+    } else if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        err = decode_generate_batch_request_payload(hdr, payload, &job->batch_req);
+        if (err != ERR_NONE) {
+            fprintf(stderr, "failed to decode batch request: %d\n", err);
+        }
+        job->request_id = job->batch_req.base.request_id;
+    } else if (job->msg_type == MSG_CANCEL) {
+        err = decode_cancel_request_payload(hdr, payload, &job->cancel);
+        if (err != ERR_NONE) {
+            fprintf(stderr, "failed to decode cancel request: %d\n", err);
+        }
+        /* Nothing is generated for a cancel, so it has no reply of its own */
+        job->request_id = 0;
+    } else if (job->msg_type == MSG_STATS_REQUEST) {
+        err = decode_stats_request_payload(hdr, payload, &job->stats_req);
+        if (err != ERR_NONE) {
+            fprintf(stderr, "failed to decode stats request: %d\n", err);
+        }
+        job->request_id = job->stats_req.request_id;
+    } else if (job->msg_type == MSG_PREPARE) {
+        err = decode_prepare_request_payload(hdr, payload, &job->prep_req);
+        if (err != ERR_NONE) {
+            fprintf(stderr, "failed to decode prepare request: %d (dropped)\n", err);
+        }
+        /* Nothing is generated for a prepare, so it has no reply of its own */
+        job->request_id = 0;
+    } else {
+        err = decode_generate_request_payload(hdr, payload, &job->req);
+        if (err != ERR_NONE) {
+            fprintf(stderr, "failed to decode request: %d\n", err);
+        }
+        job->request_id = job->req.request_id;
+    }
+
+    if (err != ERR_NONE) {
+        /* Protocol error - send error response and continue processing */
+        job->request_id = 0;
+        job->error = err;
+        job->error_msg = "invalid request";
+        release_request_buffer(job);
+        return;
+    }
+
+    if ((job->flags & PROTOCOL_FLAG_CLIP_ONLY) != 0 && !is_control_message(job) &&
+        !route_clip_only(job)) {
+        if (job->msg_type == MSG_PREPARE) {
+            fprintf(stderr, "prepare for request %llu: model %u has no CLIP-only model (dropped)\n",
+                    (unsigned long long)job->prep_req.request_id,
+                    (unsigned)request_model_id(job));
+        } else {
+            fprintf(stderr, "request %llu: model %u has no CLIP-only model\n",
+                    (unsigned long long)job->request_id, (unsigned)request_model_id(job));
+        }
+        job->error = ERR_NO_CLIP_ONLY;
+        job->error_msg = "CLIP-only conditioning unavailable for model";
+        release_request_buffer(job);
+        return;
+    }
+    if (!is_control_message(job) && find_model(request_model_id(job)) == NULL) {
+        if (job->msg_type == MSG_PREPARE) {
+            fprintf(stderr, "prepare for request %llu names unconfigured model %u (dropped)\n",
+                    (unsigned long long)job->prep_req.request_id,
+                    (unsigned)request_model_id(job));
+        } else {
+            fprintf(stderr, "request %llu for unconfigured model %u\n",
+                    (unsigned long long)job->request_id, (unsigned)request_model_id(job));
+        }
+        job->error = ERR_INVALID_MODEL_ID;
+        job->error_msg = "unknown model ID";
+        release_request_buffer(job);
+        return;
+    }
+
+    /* A request's own deadline can only shorten the server's */
+    if (!is_control_message(job) && job->msg_type != MSG_PREPARE &&
+        request_base(job)->deadline_ms > 0) {
+        uint32_t deadline_ms = request_base(job)->deadline_ms;
+        struct timespec deadline = job->received;
+
+        deadline.tv_sec += deadline_ms / 1000;
+        deadline.tv_nsec += (long)(deadline_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (!job->has_deadline || deadline.tv_sec < job->deadline.tv_sec ||
+            (deadline.tv_sec == job->deadline.tv_sec &&
+             deadline.tv_nsec < job->deadline.tv_nsec)) {
+            job->deadline = deadline;
+            job->has_deadline = 1;
+        }
+    }
+}
+
+/**
+ * read_request - Read and decode one request from a client connection
+ *
+ * Blocking reader for client mode and the serial accept loop: reads the
+ * header, starts the job with request_begin(), reads the payload and
+ * decodes it with request_decode().
+ *
+ * @param client_fd  Authenticated client socket
+ * @param job        Output job (cleared by this function)
+ * @return           0 on success (job ready), -1 on connection close/fatal error (exit)
+ */
+static int read_request(int client_fd, request_job_t *job) {
+    /* All variable declarations at top for C99 compliance */
+    uint8_t header[16];
+    protocol_header_t hdr;
+    error_code_t header_err;
+    int rc;
+
+    memset(job, 0, sizeof(*job));
+
+    /*
+     * Security: Read header into small stack buffer first, validate payload
+     * length, then allocate only the exact size needed. This prevents memory
+     * exhaustion attacks where an attacker sends headers claiming large
+     * payloads to force expensive allocations.
+     *
+     * If the header read fails, it's either connection close or I/O error.
+     * In both cases, we return -1 to exit the request loop.
+     */
+    if (read_full(client_fd, header, 16) != 0) {
+        /* Connection closed or I/O error - exit loop */
+        return -1;
+    }
+
+    rc = request_begin(job, header, &hdr, &header_err);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    if (hdr.payload_len > 0) {
+        if (read_full(client_fd, job->buffer + 16, hdr.payload_len) != 0) {
+            /* Connection closed or I/O error - exit loop */
+            release_request_buffer(job);
+            return -1;
+        }
+    }
+
+    request_decode(job, &hdr, header_err);
+    return 0;
+}
+
+/**
+ * request_should_abort - SD wrapper abort callback
+ *
+ * Polled before each diffusion pass and at every sampling step. Records why
+ * the request was abandoned so run_request() can reply with the right code.
+ *
+ * @param user_data  abort_check_t for the request being generated
+ * @return           true once the request was cancelled or its deadline passed
+ */
+static bool request_should_abort(void *user_data) {
+    abort_check_t *check = (abort_check_t *)user_data;
+    struct timespec now;
+
+    if (check->reason != ERR_NONE) {
+        return true;
+    }
+
+    if (connection_is_cancelled(check->conn, check->job->request_id)) {
+        check->reason = ERR_CANCELLED;
+        return true;
+    }
+
+    if (check->job->has_deadline) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > check->job->deadline.tv_sec ||
+            (now.tv_sec == check->job->deadline.tv_sec &&
+             now.tv_nsec >= check->job->deadline.tv_nsec)) {
+            check->reason = ERR_TIMEOUT;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * plan_weight_type - SD wrapper weight type for a planned weight type
+ */
+static sd_wrapper_wtype_t plan_weight_type(vram_plan_wtype_t wtype) {
+    switch (wtype) {
+    case VRAM_PLAN_WTYPE_Q8_0:
+        return SD_WRAPPER_WTYPE_Q8_0;
+    case VRAM_PLAN_WTYPE_Q4_0:
+        return SD_WRAPPER_WTYPE_Q4_0;
+    case VRAM_PLAN_WTYPE_F16:
+    default:
+        return SD_WRAPPER_WTYPE_F16;
+    }
+}
+
+/**
+ * append_file_identity - Append a model file's path, size and mtime to a fingerprint
+ *
+ * @return  New length of buf, or size if it does not fit
+ */
+static size_t append_file_identity(char *buf, size_t size, size_t len, const char *label,
+                                   const char *path) {
+    struct stat st;
+    long long file_size = -1;
+    long long mtime_ns = -1;
+    int n;
+
+    if (path[0] != '\0' && stat(path, &st) == 0) {
+        file_size = (long long)st.st_size;
+        mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+    n = snprintf(buf + len, size - len, "%s=%s:%lld:%lld\n", label, path, file_size, mtime_ns);
+    if (n < 0 || (size_t)n >= size - len) {
+        return size;
+    }
+    return len + (size_t)n;
+}
+
+/**
+ * build_model_fingerprints - Fingerprint every configured model for the result cache
+ *
+ * The disk tier outlives the daemon, so a model_id in the key alone would
+ * serve images from whatever files and settings it meant last time. Each
+ * fingerprint names the model's files (path, size and mtime, so a file
+ * replaced in place counts as new) and its output-changing settings. A
+ * model whose fingerprint cannot be built is not cached.
+ */
+static void build_model_fingerprints(void) {
+    char buf[RESULT_FINGERPRINT_MAX];
+
+    for (size_t i = 0; i < g_model_count; i++) {
+        const model_config_t *model = &g_models[i];
+        size_t len = 0;
+        int n;
+
+        free(g_model_fingerprints[i]);
+        g_model_fingerprints[i] = NULL;
+
+        len = append_file_identity(buf, sizeof(buf), len, "model", model->model_path);
+        if (len < sizeof(buf)) {
+            len = append_file_identity(buf, sizeof(buf), len, "clip_l", model->clip_l_path);
+        }
+        if (len < sizeof(buf)) {
+            len = append_file_identity(buf, sizeof(buf), len, "clip_g", model->clip_g_path);
+        }
+        if (len < sizeof(buf) && model->t5) {
+            len = append_file_identity(buf, sizeof(buf), len, "t5xxl", model->t5xxl_path);
+        }
+        if (len < sizeof(buf)) {
+            len = append_file_identity(buf, sizeof(buf), len, "vae", model->vae_path);
+        }
+        if (len >= sizeof(buf)) {
+            continue;
+        }
+        n = snprintf(buf + len, sizeof(buf) - len, "t5=%d step_cache=%.9g flash_attn=%d\n",
+                     model->t5 ? 1 : 0, (double)model->step_cache,
+                     model->enable_flash_attn ? 1 : 0);
+        if (n < 0 || (size_t)n >= sizeof(buf) - len) {
+            continue;
+        }
+        g_model_fingerprints[i] = strdup(buf);
+    }
+}
+
+/**
+ * result_fingerprint - Result cache fingerprint of a request
+ *
+ * The model's fingerprint plus what each device decides per request: the
+ * weight type and placement the VRAM plan chose and whether the VAE decode
+ * of this size is tiled. The request is answered by whichever device is
+ * free, so it is only cacheable while every device would decide the same.
+ *
+ * @param req   Decoded request (the base of a batch request)
+ * @param buf   Output fingerprint
+ * @param size  Size of buf
+ * @return      0 on success, -1 if the request must not be cached
+ */
+static int result_fingerprint(const sd35_generate_request_t *req, char *buf, size_t size) {
+    const model_config_t *model = find_model(req->model_id);
+    sd_wrapper_config_t defaults;
+    uint64_t pixels = (uint64_t)req->width * req->height;
+    size_t index;
+    int n;
+    int wtype = -1;
+    int clip_on_cpu = -1;
+    int vae_on_cpu = -1;
+    int vae_tiled = -1;
+
+    if (model == NULL || g_model_fingerprints[model - g_models] == NULL) {
+        return -1;
+    }
+    index = (size_t)(model - g_models);
+    sd_wrapper_config_init(&defaults);
+
+    for (int i = 0; i < g_device_count; i++) {
+        const gpu_device_t *device = &g_devices[i];
+        const vram_plan_t *plan = &device->plans[index];
+        int d_wtype = device->planned ? (int)plan_weight_type(plan->wtype)
+                                      : (int)defaults.weight_type;
+        int d_clip = device->planned ? plan->keep_clip_on_cpu : model->keep_clip_on_cpu;
+        int d_vae = device->planned ? plan->keep_vae_on_cpu : model->keep_vae_on_cpu;
+        uint32_t tile_pixels = device->planned ? plan->vae_tile_pixels : defaults.vae_tile_pixels;
+        int d_tiled = tile_pixels != 0 && pixels > tile_pixels;
+
+        if (i == 0) {
+            wtype = d_wtype;
+            clip_on_cpu = d_clip;
+            vae_on_cpu = d_vae;
+            vae_tiled = d_tiled;
+        } else if (d_wtype != wtype || d_clip != clip_on_cpu || d_vae != vae_on_cpu ||
+                   d_tiled != vae_tiled) {
+            return -1;
+        }
+    }
+
+    n = snprintf(buf, size, "%swtype=%d clip_on_cpu=%d vae_on_cpu=%d vae_tiled=%d",
+                 g_model_fingerprints[index], wtype, clip_on_cpu, vae_on_cpu, vae_tiled);
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+/**
+ * cache_lookup_request - Answer a job from the result cache
+ *
+ * A batch is answered only if every seed hits; partial hits are released
+ * and the whole batch is generated. Hits report generation_time_ms = 0.
+ *
+ * @param job  Job from read_request() (ERR_NONE)
+ * @return     1 if the job's response was filled from the cache, 0 otherwise
+ */
+static int cache_lookup_request(request_job_t *job) {
+    result_cache_image_t images[SD35_MAX_BATCH_SIZE];
+    char fingerprint[RESULT_FINGERPRINT_MAX];
+    const sd35_generate_request_t *req;
+    const uint64_t *seeds;
+    uint32_t count;
+    uint32_t hits = 0;
+
+    if (g_result_cache == NULL) {
+        return 0;
+    }
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        req = &job->batch_req.base;
+        seeds = job->batch_req.seeds;
+        count = job->batch_req.seed_count;
+    } else {
+        req = &job->req;
+        seeds = &job->req.seed;
+        count = 1;
+    }
+
+    if (result_fingerprint(req, fingerprint, sizeof(fingerprint)) != 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_result_cache_lock);
+    while (hits < count &&
+           result_cache_lookup(g_result_cache, req, seeds[hits], fingerprint,
+                               &images[hits]) == CACHE_OK) {
+        /* Images in one response share dimensions; anything else is a miss */
+        if (images[hits].width != req->width || images[hits].height != req->height ||
+            images[hits].data_size > UINT32_MAX ||
+            images[hits].channels != images[0].channels ||
+            images[hits].data_size != images[0].data_size) {
+            free(images[hits].data);
+            break;
+        }
+        hits++;
+    }
+    pthread_mutex_unlock(&g_result_cache_lock);
+
+    if (hits < count) {
+        for (uint32_t i = 0; i < hits; i++) {
+            free(images[i].data);
+        }
+        return 0;
+    }
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        memset(&job->batch_resp, 0, sizeof(job->batch_resp));
+        job->batch_resp.request_id = job->request_id;
+        job->batch_resp.status = STATUS_OK;
+        job->batch_resp.generation_time_ms = 0;
+        job->batch_resp.image_width = images[0].width;
+        job->batch_resp.image_height = images[0].height;
+        job->batch_resp.channels = images[0].channels;
+        job->batch_resp.image_count = count;
+        job->batch_resp.image_data_len = (uint32_t)images[0].data_size;
+        for (uint32_t i = 0; i < count; i++) {
+            job->batch_resp.images[i] = images[i].data;
+        }
+    } else {
+        job->resp.request_id = job->request_id;
+        job->resp.status = STATUS_OK;
+        job->resp.generation_time_ms = 0;
+        job->resp.image_width = images[0].width;
+        job->resp.image_height = images[0].height;
+        job->resp.channels = images[0].channels;
+        job->resp.image_data_len = (uint32_t)images[0].data_size;
+        job->resp.image_data = images[0].data;
+    }
+
+    return 1;
+}
+
+/**
+ * cache_store_request - Remember a generated response in the result cache
+ *
+ * Must run before the request buffer is freed, since the key includes the
+ * prompts. Store failures only cost a future hit and are ignored.
+ *
+ * @param job  Job whose generation just succeeded
+ */
+static void cache_store_request(const request_job_t *job) {
+    const sd35_generate_request_t *req = job->msg_type == MSG_GENERATE_BATCH_REQUEST
+                                             ? &job->batch_req.base
+                                             : &job->req;
+    char fingerprint[RESULT_FINGERPRINT_MAX];
+    result_cache_image_t image;
+
+    if (g_result_cache == NULL || result_fingerprint(req, fingerprint, sizeof(fingerprint)) != 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_result_cache_lock);
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        image.width = job->batch_resp.image_width;
+        image.height = job->batch_resp.image_height;
+        image.channels = job->batch_resp.channels;
+        image.data_size = job->batch_resp.image_data_len;
+        for (uint32_t i = 0; i < job->batch_resp.image_count; i++) {
+            image.data = (uint8_t *)job->batch_resp.images[i];
+            (void)result_cache_store(g_result_cache, req, job->batch_req.seeds[i], fingerprint,
+                                     &image);
+        }
+    } else {
+        image.width = job->resp.image_width;
+        image.height = job->resp.image_height;
+        image.channels = job->resp.channels;
+        image.data_size = job->resp.image_data_len;
+        image.data = (uint8_t *)job->resp.image_data;
+        (void)result_cache_store(g_result_cache, req, job->req.seed, fingerprint, &image);
+    }
+    pthread_mutex_unlock(&g_result_cache_lock);
+}
+
+/**
+ * new_retained_owner - Owner for the retained results of a new connection
+ *
+ * @return  Owner never handed out before in this process
+ */
+static uint64_t new_retained_owner(void) {
+    uint64_t owner;
+
+    pthread_mutex_lock(&g_retained_lock);
+    owner = ++g_last_owner;
+    pthread_mutex_unlock(&g_retained_lock);
+    return owner;
+}
+
+/**
+ * forget_retained_owner - Drop a closed connection's retained results
+ *
+ * @param owner  Owner from new_retained_owner()
+ */
+static void forget_retained_owner(uint64_t owner) {
+    if (g_retained == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_retained_lock);
+    (void)result_cache_forget(g_retained, owner);
+    pthread_mutex_unlock(&g_retained_lock);
+}
+
+/**
+ * resolve_init_image - Point a SD35_INIT_RETAINED request at its pixels
+ *
+ * Recalls the result retained for job->owner into job->init_pixels, so a
+ * client can only refine its own results. Requests without a retained init
+ * image are left alone.
+ *
+ * @param job  Job from read_request() (ERR_NONE)
+ * @return     1 on success, 0 with job->error set if the result is gone or
+ *             does not match the request's dimensions
+ */
+static int resolve_init_image(request_job_t *job) {
+    sd35_generate_request_t *req = job->msg_type == MSG_GENERATE_BATCH_REQUEST
+                                       ? &job->batch_req.base
+                                       : &job->req;
+    result_cache_image_t image;
+    cache_error_t err = CACHE_ERR_NOT_FOUND;
+
+    if (req->init_source != SD35_INIT_RETAINED) {
+        return 1;
+    }
+
+    if (g_retained != NULL) {
+        pthread_mutex_lock(&g_retained_lock);
+        err = result_cache_recall(g_retained, job->owner, req->init_request_id, req->init_index,
+                                  &image);
+        pthread_mutex_unlock(&g_retained_lock);
+    }
+    if (err != CACHE_OK) {
+        job->error = err == CACHE_ERR_OUT_OF_MEMORY ? ERR_OUT_OF_MEMORY : ERR_INVALID_INIT_IMAGE;
+        job->error_msg = err == CACHE_ERR_OUT_OF_MEMORY ? "out of memory"
+                                                        : "retained result not found";
+        return 0;
+    }
+
+    if (image.width != req->width || image.height != req->height || image.channels != 3) {
+        free(image.data);
+        job->error = ERR_INVALID_INIT_IMAGE;
+        job->error_msg = "retained result does not match the requested dimensions";
+        return 0;
+    }
+
+    job->init_pixels = image.data;
+    req->init_data = image.data;
+    req->init_data_len = image.data_size;
+    return 1;
+}
+
+/**
+ * retain_response - Keep a successful response's images for refinement
+ *
+ * Each image is kept under the job's owner, the request_id it is sent with
+ * and its index in the response, raw pixels before any PNG encoding. Failures only cost a
+ * later SD35_INIT_RETAINED request and are ignored.
+ *
+ * @param job  Job with a successful response
+ */
+static void retain_response(const request_job_t *job) {
+    result_cache_image_t image;
+
+    if (g_retained == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_retained_lock);
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        image.width = job->batch_resp.image_width;
+        image.height = job->batch_resp.image_height;
+        image.channels = job->batch_resp.channels;
+        image.data_size = job->batch_resp.image_data_len;
+        for (uint32_t i = 0; i < job->batch_resp.image_count; i++) {
+            image.data = (uint8_t *)job->batch_resp.images[i];
+            (void)result_cache_retain(g_retained, job->owner, job->request_id, i, &image);
+        }
+    } else {
+        image.width = job->resp.image_width;
+        image.height = job->resp.image_height;
+        image.channels = job->resp.channels;
+        image.data_size = job->resp.image_data_len;
+        image.data = (uint8_t *)job->resp.image_data;
+        (void)result_cache_retain(g_retained, job->owner, job->request_id, 0, &image);
+    }
+    pthread_mutex_unlock(&g_retained_lock);
+}
+
+/**
+ * mark_queue_stage - End a job's queue stage
+ *
+ * @param job  Job leaving the queue for its first stage of work
+ */
+static void mark_queue_stage(request_job_t *job) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    job->timings.request_id = job->request_id;
+    job->timings.stage_us[TIMING_STAGE_QUEUE] = elapsed_us(&job->received, &now);
+}
+
+/**
+ * prepare_request - CPU stage of a request, before it needs a device
+ *
+ * Finishes requests that were rejected while reading and deterministic
+ * requests the result cache can answer, and recalls the retained result a
+ * refinement starts from. In the pipeline this runs on the prepare thread
+ * while earlier requests generate, so such requests never wait behind the
+ * GPU.
+ *
+ * Text encoding is not part of this stage and does not overlap diffusion:
+ * stable-diffusion.cpp encodes the prompt inside generate_image() and its C
+ * API takes no precomputed conditioning, so the CPU encode of a request
+ * still runs on its GPU worker, right before its own diffusion.
+ *
+ * @param job  Job from read_request()
+ * @return     1 if the job is answered (error or cache hit), 0 if it must
+ *             be generated by run_request()
+ */
+static int prepare_request(request_job_t *job) {
+    if (job->error != ERR_NONE) {
+        mark_queue_stage(job);
+        return 1;
+    }
+
+    if (!resolve_init_image(job)) {
+        mark_queue_stage(job);
+        release_request_buffer(job);
+        return 1;
+    }
+
+    /* An identical deterministic request skips the reset and the diffusion */
+    if (!cache_lookup_request(job)) {
+        return 0;
+    }
+
+    mark_queue_stage(job);
+    fprintf(stderr, "request %llu served from result cache\n",
+            (unsigned long long)job->request_id);
+    retain_response(job);
+    release_request_buffer(job);
+    return 1;
+}
+
+/**
+ * admit_request - Queue a prepared request for a device unless it would miss its deadline
+ *
+ * Counts the request in g_stats under its priority class. A request
+ * whose estimated wait plus generation time runs past its deadline is
+ * answered with ERR_BUSY at once, so the client can shed it or retry with
+ * a cheaper one, instead of timing out after waiting in the queue.
+ *
+ * @param job  Job that prepare_request() did not answer
+ * @return     1 if admitted (queue it for a device at job->ticket.priority),
+ *             0 if refused (answered with ERR_BUSY, buffer released)
+ */
+static int admit_request(request_job_t *job) {
+    uint32_t images = job->msg_type == MSG_GENERATE_BATCH_REQUEST ? job->batch_req.seed_count : 1;
+    uint64_t wait_us = 0;
+
+    if (server_stats_admit(&g_stats, request_base(job), images,
+                           job->has_deadline ? &job->deadline : NULL, &job->ticket,
+                           &wait_us) != SERVER_STATS_ERR_BUSY) {
+        return 1;
+    }
+
+    fprintf(stderr, "request %llu refused: estimated wait %llu ms exceeds its deadline\n",
+            (unsigned long long)job->request_id, (unsigned long long)(wait_us / 1000));
+    mark_queue_stage(job);
+    release_request_buffer(job);
+    job->error = ERR_BUSY;
+    job->error_msg = "server busy";
+    return 0;
+}
+
+/**
+ * select_model - Make a model the device's current context
+ *
+ * Loads the model on first use, possibly evicting another, and updates the
+ * device's VRAM gauge. Must run on the thread that owns device.
+ *
+ * @param device    Device to generate on
+ * @param model_id  Protocol model_id (configured)
+ * @return          MODEL_REGISTRY_OK with device->sd_ctx set, error code otherwise
+ */
+static model_registry_error_t select_model(gpu_device_t *device, uint32_t model_id) {
+    model_registry_stats_t model_stats;
+    model_registry_error_t model_err;
+    void *model;
+
+    model_err = model_registry_acquire(device->models, model_id, &model);
+    if (model_err != MODEL_REGISTRY_OK) {
+        return model_err;
+    }
+    device->sd_ctx = (sd_wrapper_ctx_t *)model;
+
+    if (model_registry_get_stats(device->models, &model_stats) == MODEL_REGISTRY_OK) {
+        server_stats_set_vram(&g_stats, (int)(device - g_devices), model_stats.vram_bytes);
+    }
+    return MODEL_REGISTRY_OK;
+}
+
+/**
+ * run_request - Generate the response for a decoded request
+ *
+ * Must run on the thread that owns device. Streams MSG_GENERATE_PROGRESS
+ * frames first when the header sets PROTOCOL_FLAG_PROGRESS. Jobs that
+ * already carry an error pass through untouched.
+ *
+ * A request that was cancelled or whose deadline passed while it was queued
+ * never reaches the GPU; one that is aborted mid-generation is answered with
+ * ERR_CANCELLED or ERR_TIMEOUT once the SD wrapper gives up on it.
+ *
+ * The requested model is loaded on the device first if it is not already.
+ *
+ * The request buffer is freed here, before the response is sent, since the
+ * decoded prompts are no longer referenced once generation is done.
+ *
+ * @param device     Device to generate on
+ * @param client_fd  Client socket (for progress frames)
+ * @param job        Job that prepare_request() did not answer
+ * @param conn       Connection owning client_fd (NULL when single-threaded)
+ */
+static void run_request(gpu_device_t *device, int client_fd, request_job_t *job,
+                        connection_t *conn) {
+    progress_stream_t progress;
+    abort_check_t abort_check;
+    model_registry_error_t model_err;
+    sd_wrapper_timings_t sd_timings;
+    error_code_t err;
+
+    mark_queue_stage(job);
+
+    if (job->error != ERR_NONE) {
+        return;
+    }
+
+    model_err = select_model(device, request_model_id(job));
+    if (model_err != MODEL_REGISTRY_OK) {
+        fprintf(stderr, "request %llu: model %u unavailable on device %d: %s\n",
+                (unsigned long long)job->request_id, (unsigned)request_model_id(job),
+                device->device_index, model_registry_error_string(model_err));
+        release_request_buffer(job);
+        if (model_err == MODEL_REGISTRY_ERR_NO_VRAM) {
+            job->error = ERR_OUT_OF_MEMORY;
+            job->error_msg = "model does not fit in VRAM";
+        } else {
+            job->error = ERR_GPU_ERROR;
+            job->error_msg = "model load failed";
+        }
+        return;
+    }
+
+    abort_check.conn = conn;
+    abort_check.job = job;
+    abort_check.reason = ERR_NONE;
+
+    if (conn != NULL || job->has_deadline) {
+        sd_wrapper_set_abort_callback(device->sd_ctx, request_should_abort, &abort_check);
+    }
+
+    progress_stream_begin(&progress, device, client_fd, job->request_id, job->flags, conn);
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        err = process_generate_batch_request(device->sd_ctx, &job->batch_req, &job->batch_resp);
+        if (err != ERR_NONE && err != ERR_CANCELLED) {
+            fprintf(stderr, "batch generation failed: %d\n", err);
+        }
+    } else {
+        err = process_generate_request(device->sd_ctx, &job->req, &job->resp);
+        if (err != ERR_NONE && err != ERR_CANCELLED) {
+            fprintf(stderr, "generation failed: %d\n", err);
+        }
+    }
+    progress_stream_end(device, job->flags);
+
+    if (conn != NULL || job->has_deadline) {
+        sd_wrapper_set_abort_callback(device->sd_ctx, NULL, NULL);
+    }
+
+    /* A request rejected before generating would read the previous request's timings */
+    if (err == ERR_NONE && sd_wrapper_get_timings(device->sd_ctx, &sd_timings) == SD_WRAPPER_OK) {
+        job->timings.stage_us[TIMING_STAGE_RESET] = sd_timings.reset_us;
+        job->timings.stage_us[TIMING_STAGE_TEXT_ENCODE] = sd_timings.text_encode_us;
+        job->timings.stage_us[TIMING_STAGE_SAMPLING] = sd_timings.sampling_us;
+        job->timings.stage_us[TIMING_STAGE_VAE_DECODE] = sd_timings.vae_decode_us;
+        job->timings.step_count = sd_timings.step_count < SD35_MAX_TIMED_STEPS
+                                      ? sd_timings.step_count
+                                      : SD35_MAX_TIMED_STEPS;
+        memcpy(job->timings.step_us, sd_timings.step_us,
+               job->timings.step_count * sizeof(job->timings.step_us[0]));
+    }
+
+    if (err == ERR_NONE) {
+        cache_store_request(job);
+        retain_response(job);
+    }
+
+    /* Request data (prompts) is no longer referenced once generation is done */
+    release_request_buffer(job);
+
+    if (err == ERR_CANCELLED && abort_check.reason == ERR_TIMEOUT) {
+        fprintf(stderr, "request %llu timed out\n", (unsigned long long)job->request_id);
+        job->error = ERR_TIMEOUT;
+        job->error_msg = "request timed out";
+    } else if (err == ERR_CANCELLED) {
+        fprintf(stderr, "request %llu cancelled\n", (unsigned long long)job->request_id);
+        job->error = ERR_CANCELLED;
+        job->error_msg = "request cancelled";
+    } else if (err == ERR_OUT_OF_MEMORY) {
+        job->error = err;
+        job->error_msg = "out of GPU memory";
+    } else if (err != ERR_NONE) {
+        /* Generation error - send error response and continue processing */
+        job->error = err;
+        job->error_msg = "generation failed";
+    }
+}
+
+/**
+ * run_prepare - Get a device ready for the request a MSG_PREPARE announces
+ *
+ * Must run on the thread that owns device. Loads the model if it is not
+ * loaded, does the context reset the request would start with, and, when
+ * the request will ask for PNG, leaves a PNG buffer of its size in the
+ * buffer pool. Failures are only logged: the request itself reports them.
+ *
+ * With several devices the request may be generated on another device than
+ * the one prepared; it then starts as it would without the prepare.
+ *
+ * @param device  Device to prepare
+ * @param job     Job for which is_prepare_message() holds
+ */
+static void run_prepare(gpu_device_t *device, request_job_t *job) {
+    const sd35_prepare_request_t *prep = &job->prep_req;
+    model_registry_error_t model_err;
+    struct timespec start;
+    struct timespec end;
+    uint64_t reset_us = 0;
+    error_code_t err;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    model_err = select_model(device, prep->model_id);
+    if (model_err != MODEL_REGISTRY_OK) {
+        fprintf(stderr, "prepare for request %llu: model %u unavailable on device %d: %s\n",
+                (unsigned long long)prep->request_id, (unsigned)prep->model_id,
+                device->device_index, model_registry_error_string(model_err));
+        release_request_buffer(job);
+        return;
+    }
+
+    err = process_prepare_request(device->sd_ctx, prep, &reset_us);
+    if (err != ERR_NONE) {
+        fprintf(stderr, "prepare for request %llu failed: %d\n",
+                (unsigned long long)prep->request_id, err);
+    }
+
+    /* A pool hit costs nothing; a miss allocates the buffer now, not after generating */
+    if (job->flags & PROTOCOL_FLAG_PNG) {
+        size_t png_size = image_encode_png_bound(prep->width, prep->height, 3);
+
+        if (png_size > 0) {
+            buffer_pool_put(g_buffer_pool, buffer_pool_get(g_buffer_pool, png_size), png_size);
+        }
+    }
+    release_request_buffer(job);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stderr, "prepared model %u on device %d for request %llu in %llu ms (reset %llu ms)\n",
+            (unsigned)prep->model_id, device->device_index,
+            (unsigned long long)prep->request_id,
+            (unsigned long long)(elapsed_us(&start, &end) / 1000),
+            (unsigned long long)(reset_us / 1000));
+}
+
+/**
+ * encode_response_image - Replace a single response's pixels with a PNG file
+ *
+ * Applies to successful single requests that set PROTOCOL_FLAG_PNG. It runs
+ * after generation and before the write lock is taken, so in pipeline mode
+ * the writer thread encodes while the GPU worker starts the next request.
+ * The cache has already stored the raw pixels. If encoding fails the raw
+ * pixels are sent, which such clients must accept anyway.
+ *
+ * @param job  Job from run_request()
+ */
+static void encode_response_image(request_job_t *job) {
+    image_encode_error_t err = IMAGE_ENCODE_ERR_OUT_OF_MEMORY;
+    uint8_t *png;
+    size_t png_size;
+    size_t png_len = 0;
+    struct timespec start;
+    struct timespec end;
+
+    if (job->error != ERR_NONE || job->msg_type != MSG_GENERATE_REQUEST ||
+        (job->flags & PROTOCOL_FLAG_PNG) == 0 || job->resp.image_data == NULL) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    png_size = image_encode_png_bound(job->resp.image_width, job->resp.image_height,
+                                      job->resp.channels);
+    png = png_size > 0 ? buffer_pool_get(g_buffer_pool, png_size) : NULL;
+    if (png_size == 0) {
+        err = IMAGE_ENCODE_ERR_INVALID_PARAMS;
+    } else if (png != NULL) {
+        err = image_encode_png_to(job->resp.image_data, job->resp.image_width,
+                                  job->resp.image_height, job->resp.channels, png, png_size,
+                                  &png_len);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    job->timings.stage_us[TIMING_STAGE_ENCODE] = elapsed_us(&start, &end);
+    if (err != IMAGE_ENCODE_OK || png_len > UINT32_MAX) {
+        fprintf(stderr, "PNG encoding failed, sending raw pixels: %s\n",
+                image_encode_error_string(err));
+        buffer_pool_put(g_buffer_pool, png, png_size);
+        return;
+    }
+
+    /* The pool buffer goes back in release_request_job(), not to free() */
+    free_generate_response(&job->resp);
+    job->resp.image_data = png;
+    job->resp.image_data_len = (uint32_t)png_len;
+    job->resp.image_format = IMAGE_FORMAT_PNG;
+    job->png_size = png_size;
+}
+
+/**
+ * send_chunked_response - Write a version 2 response using MSG_CHUNK frames
+ *
+ * Each image is cut into bands of whole rows no larger than
+ * PROTOCOL_MAX_CHUNK_SIZE, and every band is written with its chunk header
+ * straight from the generated buffer. The caller holds the connection's
+ * write lock, so no other frame can land between the head and its chunks.
+ *
+ * @param client_fd     Client socket
+ * @param head          Encoded head with PROTOCOL_FLAG_CHUNKED
+ * @param head_len      Size of head in bytes
+ * @param images        Image buffers, in order
+ * @param image_count   Number of images
+ * @param image_len     Size of each image in bytes
+ * @param row_bytes     Size of one image row in bytes (0 for encoded images)
+ * @return              0 on success, -1 on error
+ */
+static int send_chunked_response(int client_fd, const uint8_t *head, size_t head_len,
+                                 const uint8_t *const *images, uint32_t image_count,
+                                 size_t image_len, size_t row_bytes) {
+    uint8_t chunk_header[16];
+    struct iovec iov[2];
+    size_t band;
+
+    if (write_full(client_fd, head, head_len) != 0) {
+        return -1;
+    }
+
+    band = row_bytes > 0 ? (PROTOCOL_MAX_CHUNK_SIZE / row_bytes) * row_bytes : 0;
+    if (band == 0) {
+        /* No row structure, or a single row exceeds the chunk size */
+        band = PROTOCOL_MAX_CHUNK_SIZE;
+    }
+
+    for (uint32_t i = 0; i < image_count; i++) {
+        for (size_t offset = 0; offset < image_len; offset += band) {
+            size_t len = image_len - offset < band ? image_len - offset : band;
+
+            if (encode_chunk_header((uint32_t)len, chunk_header,
+                                    sizeof(chunk_header)) != ERR_NONE) {
+                return -1;
+            }
+            iov[0].iov_base = chunk_header;
+            iov[0].iov_len = sizeof(chunk_header);
+            iov[1].iov_base = (void *)(images[i] + offset);
+            iov[1].iov_len = len;
+            if (writev_full(client_fd, iov, 2) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * send_v2_response - Send the reply to a version 2 request
+ *
+ * The head announces the 64-bit image data length, so image size is not
+ * bounded by MAX_MESSAGE_SIZE. With PROTOCOL_FLAG_SHM the data goes in a
+ * memfd attached to the head, otherwise (or if shared memory cannot be set
+ * up) it follows in MSG_CHUNK frames.
+ *
+ * @param client_fd  Client socket
+ * @param job        Job from run_request() (ERR_NONE)
+ * @return           0 on success, -1 on error
+ */
+static int send_v2_response(int client_fd, const request_job_t *job) {
+    uint8_t head[SD35_BATCH_RESPONSE_HEAD_SIZE];
+    struct iovec iov[SD35_MAX_BATCH_SIZE];
+    const uint8_t *images[SD35_MAX_BATCH_SIZE];
+    uint32_t image_count;
+    size_t image_len;
+    size_t row_bytes;
+    size_t head_len;
+    error_code_t err;
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        image_count = job->batch_resp.image_count;
+        image_len = job->batch_resp.image_data_len;
+        row_bytes = (size_t)job->batch_resp.image_width * job->batch_resp.channels;
+        for (uint32_t i = 0; i < image_count; i++) {
+            images[i] = job->batch_resp.images[i];
+        }
+    } else {
+        image_count = 1;
+        image_len = job->resp.image_data_len;
+        row_bytes = job->resp.image_format == IMAGE_FORMAT_RAW
+                        ? (size_t)job->resp.image_width * job->resp.channels
+                        : 0;
+        images[0] = job->resp.image_data;
+    }
+
+    if ((job->flags & PROTOCOL_FLAG_SHM) != 0) {
+        int shm_fd;
+
+        for (uint32_t i = 0; i < image_count; i++) {
+            iov[i].iov_base = (void *)images[i];
+            iov[i].iov_len = image_len;
+        }
+
+        if (socket_create_shm(iov, (int)image_count, &shm_fd) == SOCKET_OK) {
+            socket_error_t sock_err;
+
+            if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+                err = encode_generate_batch_response_head(&job->batch_resp, PROTOCOL_FLAG_SHM,
+                                                          head, sizeof(head), &head_len);
+            } else {
+                err = encode_generate_response_head(&job->resp, PROTOCOL_FLAG_SHM, head,
+                                                    sizeof(head), &head_len);
+            }
+            if (err != ERR_NONE) {
+                fprintf(stderr, "failed to encode response head: %d\n", err);
+                close(shm_fd);
+                return -1;
+            }
+
+            sock_err = socket_send_with_fd(client_fd, head, head_len, shm_fd);
+            close(shm_fd);
+            return sock_err == SOCKET_OK ? 0 : -1;
+        }
+        /* Shared memory unavailable - fall back to chunks */
+    }
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        err = encode_generate_batch_response_head(&job->batch_resp, PROTOCOL_FLAG_CHUNKED, head,
+                                                  sizeof(head), &head_len);
+    } else {
+        err = encode_generate_response_head(&job->resp, PROTOCOL_FLAG_CHUNKED, head,
+                                            sizeof(head), &head_len);
+    }
+    if (err != ERR_NONE) {
+        fprintf(stderr, "failed to encode response head: %d\n", err);
+        return -1;
+    }
+
+    return send_chunked_response(client_fd, head, head_len, images, image_count, image_len,
+                                 row_bytes);
+}
+
+/**
+ * write_request_response - Send the reply for a job
+ *
+ * Error jobs get an error response. Otherwise only the fixed-size response
+ * prefix is encoded, and the pixels are sent straight from the buffers
+ * stable-diffusion.cpp produced, inline via writev() or in shared memory
+ * when the header sets PROTOCOL_FLAG_SHM (see send_image_response()).
+ * Version 2 requests get a response head and chunks (see send_v2_response()).
+ *
+ * @param client_fd  Client socket
+ * @param job        Job from run_request()
+ * @return           0 on success (continue), -1 on connection close/fatal error (exit)
+ */
+static int write_request_response(int client_fd, const request_job_t *job) {
+    /* The batch prefix is the larger of the two */
+    uint8_t prefix[SD35_BATCH_RESPONSE_PREFIX_SIZE];
+    struct iovec iov[1 + SD35_MAX_BATCH_SIZE];
+    error_code_t err;
+    size_t prefix_len;
+    int iovcnt;
+
+    if (job->error != ERR_NONE) {
+        send_error_response(client_fd, job->request_id, job->error, job->error_msg);
+        /* Error reported - continue processing */
+        return 0;
+    }
+
+    if (job->version >= PROTOCOL_VERSION_2) {
+        /* Connection closed or I/O error - exit loop */
+        return send_v2_response(client_fd, job);
+    }
+
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        err = encode_generate_batch_response_prefix(&job->batch_resp, prefix, sizeof(prefix),
+                                                    &prefix_len);
+    } else {
+        err = encode_generate_response_prefix(&job->resp, prefix, sizeof(prefix), &prefix_len);
+    }
+    if (err != ERR_NONE) {
+        fprintf(stderr, "failed to encode response: %d\n", err);
+        /* Encoding error - fatal error, exit loop */
+        return -1;
+    }
+
+    iov[0].iov_base = prefix;
+    iov[0].iov_len = prefix_len;
+    if (job->msg_type == MSG_GENERATE_BATCH_REQUEST) {
+        for (uint32_t i = 0; i < job->batch_resp.image_count; i++) {
+            iov[i + 1].iov_base = (void *)job->batch_resp.images[i];
+            iov[i + 1].iov_len = job->batch_resp.image_data_len;
+        }
+        iovcnt = (int)job->batch_resp.image_count + 1;
+    } else {
+        iov[1].iov_base = (void *)job->resp.image_data;
+        iov[1].iov_len = job->resp.image_data_len;
+        iovcnt = 2;
+    }
+
+    /* Connection closed or I/O error - exit loop */
+    return send_image_response(client_fd, iov, iovcnt, job->flags);
+}
+
+/**
+ * send_timings_frame - Write the MSG_GENERATE_TIMINGS trailer for a job
+ *
+ * @param client_fd  Client socket
+ * @param job        Job whose reply was just written
+ * @return           0 on success, -1 on write error
+ */
+static int send_timings_frame(int client_fd, const request_job_t *job) {
+    uint8_t buffer[SD35_TIMINGS_MAX_SIZE];
+    size_t len;
+
+    if (encode_generate_timings(&job->timings, buffer, sizeof(buffer), &len) != ERR_NONE) {
+        fprintf(stderr, "failed to encode timings for request %llu\n",
+                (unsigned long long)job->request_id);
+        return 0;
+    }
+    return write_full(client_fd, buffer, len);
+}
+
+/**
+ * send_request_response - Send the reply for a job, record it and release it
+ *
+ * Writes the reply (see write_request_response()), then the timings
+ * trailer when the request set PROTOCOL_FLAG_TIMINGS. The write stage ends
+ * once the reply is written, so the trailer reports it too.
+ *
+ * @param client_fd  Client socket
+ * @param job        Job from run_request() (released by this function)
+ * @return           0 on success (continue), -1 on connection close/fatal error (exit)
+ */
+static int send_request_response(int client_fd, request_job_t *job) {
+    struct timespec start;
+    struct timespec end;
+    int write_err;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    write_err = write_request_response(client_fd, job);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    job->timings.stage_us[TIMING_STAGE_WRITE] = elapsed_us(&start, &end);
+    job->timings.stage_us[TIMING_STAGE_TOTAL] = elapsed_us(&job->received, &end);
+
+    if (write_err == 0 && (job->flags & PROTOCOL_FLAG_TIMINGS) != 0) {
+        write_err = send_timings_frame(client_fd, job);
+    }
+    if (write_err == 0) {
+        /* Failed requests would skew the latency histograms with partial stages */
+        server_stats_finished(&g_stats, job->error,
+                              job->error == ERR_NONE ? &job->timings : NULL);
+    }
+    release_request_job(job);
+    return write_err;
+}
+
+/**
+ * send_stats_response - Answer a MSG_STATS_REQUEST with the current stats
+ *
+ * @param client_fd   Client socket
+ * @param request_id  Request ID to echo
+ * @return            0 on success, -1 on write error
+ */
+static int send_stats_response(int client_fd, uint64_t request_id) {
+    uint8_t buffer[STATS_RESPONSE_MAX_SIZE];
+    stats_response_t resp;
+    size_t len;
+
+    if (server_stats_snapshot(&g_stats, request_id, g_buffer_pool, &resp) != SERVER_STATS_OK) {
+        send_error_response(client_fd, request_id, ERR_INTERNAL, "failed to encode stats");
+        return 0;
+    }
+    if (encode_stats_response(&resp, buffer, sizeof(buffer), &len) != ERR_NONE) {
+        send_error_response(client_fd, request_id, ERR_INTERNAL, "failed to encode stats");
+        return 0;
+    }
+    return write_full(client_fd, buffer, len);
+}
+
+/**
+ * handle_connection - Process a single request on a client connection
+ *
+ * Runs the request stages back to back on the calling thread:
+ * read_request(), prepare_request(), run_request() and
+ * send_request_response(), generating on
+ * the first device. Used when the pipeline cannot be started: by the
+ * serial accept loop in server mode (handle_serial_client()), or one request
+ * at a time in client mode.
+ *
+ * Return value semantics:
+ * - 0: Request processed successfully, connection still active (continue loop)
+ * - -1: Connection closed by peer or fatal error (exit loop)
+ *
+ * Protocol errors (invalid requests) are handled by sending error responses
+ * and returning 0 to continue processing. Only connection loss or fatal
+ * errors return -1.
+ *
+ * @param client_fd  Authenticated client socket
+ * @param owner      Retained result owner of the connection
+ * @return           0 on success (continue), -1 on connection close/fatal error (exit)
+ */
+static int handle_connection(int client_fd, uint64_t owner) {
+    request_job_t job;
+
+    if (read_request(client_fd, &job) != 0) {
+        /* Connection closed or I/O error - exit loop */
+        return -1;
+    }
+    job.owner = owner;
+
+    if (job.msg_type == MSG_CANCEL && job.error == ERR_NONE) {
+        /* Nothing else runs on this connection, so there is nothing to cancel */
+        release_request_job(&job);
+        return 0;
+    }
+
+    if (is_invalid_prepare(&job)) {
+        release_request_job(&job);
+        return 0;
+    }
+
+    if (job.msg_type == MSG_STATS_REQUEST && job.error == ERR_NONE) {
+        release_request_job(&job);
+        return send_stats_response(client_fd, job.request_id);
+    }
+
+    if (is_prepare_message(&job)) {
+        run_prepare(&g_devices[0], &job);
+        release_request_job(&job);
+        return 0;
+    }
+
+    /* Nothing queues here, so it is not admitted */
+    server_stats_received(&g_stats);
+    server_stats_started(&g_stats, NULL);
+    if (!prepare_request(&job)) {
+        run_request(&g_devices[0], client_fd, &job, NULL);
+    }
+    server_stats_generated(&g_stats, NULL, NULL);
+    encode_response_image(&job);
+    return send_request_response(client_fd, &job);
+}
+
+/**
+ * handle_serial_client - Serve one client of the serial accept loop
+ *
+ * The serial accept loop hands each accepted client to this handler once;
+ * its retained results are dropped when it is done.
+ *
+ * @param client_fd  Authenticated client socket
+ * @return           handle_connection() result
+ */
+static int handle_serial_client(int client_fd) {
+    uint64_t owner = new_retained_owner();
+    int rc = handle_connection(client_fd, owner);
+
+    forget_retained_owner(owner);
+    return rc;
+}
+
+/**
+ * release_connection_owner - Connection release callback
+ *
+ * Every job has retained its results by the time the last reference goes,
+ * and nobody can name them again.
+ */
+static void release_connection_owner(uint64_t owner, void *user_data) {
+    (void)user_data;
+    forget_retained_owner(owner);
+}
+
+/**
+ * open_connection - Set up the pipeline state for one client connection
+ *
+ * @param client_fd  Connected, authenticated client socket
+ * @param owns_fd    Close client_fd when the last reference is dropped
+ * @return           Connection holding the reader's reference, or NULL on failure
+ */
+static connection_t *open_connection(int client_fd, int owns_fd) {
+    connection_config_t config;
+    connection_error_t conn_err;
+    connection_t *conn = NULL;
+
+    config.client_fd = client_fd;
+    config.owns_fd = owns_fd;
+    config.owner = new_retained_owner();
+    config.max_inflight = PIPELINE_MAX_INFLIGHT;
+    config.on_release = release_connection_owner;
+    config.user_data = NULL;
+
+    conn_err = connection_create(&config, &conn);
+    if (conn_err != CONNECTION_OK) {
+        fprintf(stderr, "failed to set up connection: %s\n", connection_error_string(conn_err));
+        forget_retained_owner(config.owner);
+        return NULL;
+    }
+    return conn;
+}
+
+/**
+ * pipeline_release_job - Free a pipeline job and drop its connection reference
+ *
+ * pipeline_ops_t.release, also used for jobs the pipeline never accepted.
+ *
+ * @param item       Job queued by pipeline_dispatch()
+ * @param user_data  Unused
+ */
+static void pipeline_release_job(void *item, void *user_data) {
+    request_job_t *job = (request_job_t *)item;
+    connection_t *conn = job->conn;
+
+    (void)user_data;
+    release_request_job(job);
+    free(job);
+    connection_unref(conn);
+}
+
+/**
+ * pipeline_prepare_job - Prepare stage, between the reader and the GPU workers
+ *
+ * Runs prepare_request() on each request while the workers generate earlier
+ * ones. Requests it answers go straight to the writer, with the same stats
+ * and in-flight bookkeeping a worker would do, as do requests admit_request()
+ * refuses; the rest wait for a device by priority class. Requests of a
+ * broken connection go to the writer unprepared, which releases them.
+ *
+ * @param item       Job queued by pipeline_dispatch()
+ * @param priority   Output generate queue priority
+ * @param user_data  Unused
+ * @return           1 to queue the job for a GPU worker, 0 to send it as is
+ */
+static int pipeline_prepare_job(void *item, unsigned *priority, void *user_data) {
+    request_job_t *job = (request_job_t *)item;
+
+    (void)user_data;
+
+    if (is_prepare_message(job)) {
+        /* Not a request: no stats, and nothing to send once it ran */
+        return 1;
+    }
+
+    if (connection_is_broken(job->conn) || prepare_request(job) || !admit_request(job)) {
+        server_stats_answered(&g_stats);
+        if (job->tracked) {
+            connection_untrack(job->conn, job->request_id);
+        }
+        return 0;
+    }
+
+    *priority = job->ticket.priority;
+    return 1;
+}
+
+/**
+ * pipeline_generate_job - GPU worker stage, on the worker's device
+ *
+ * Requests are skipped (but still handed on, so they are released) once
+ * the writer has marked their connection broken.
+ *
+ * @param item       Job that pipeline_prepare_job() queued
+ * @param device     gpu_device_t of the worker
+ * @param user_data  Unused
+ */
+static void pipeline_generate_job(void *item, void *device, void *user_data) {
+    request_job_t *job = (request_job_t *)item;
+    connection_t *conn = job->conn;
+    int broken = connection_is_broken(conn);
+
+    (void)user_data;
+
+    if (is_prepare_message(job)) {
+        if (!broken) {
+            run_prepare((gpu_device_t *)device, job);
+        }
+        return;
+    }
+
+    server_stats_started(&g_stats, &job->ticket);
+    if (!broken) {
+        run_request((gpu_device_t *)device, connection_fd(conn), job, conn);
+    }
+    server_stats_generated(&g_stats, &job->ticket,
+                           !broken && job->error == ERR_NONE ? &job->timings : NULL);
+
+    /* Generated (or skipped) - a late MSG_CANCEL no longer applies */
+    if (job->tracked) {
+        connection_untrack(conn, job->request_id);
+    }
+}
+
+/**
+ * send_job_response - connection_send() callback for send_request_response()
+ */
+static int send_job_response(int client_fd, void *arg) {
+    return send_request_response(client_fd, (request_job_t *)arg);
+}
+
+/**
+ * pipeline_respond_job - Writer stage, sending finished requests
+ *
+ * Sends replies in completion order through connection_send(),
+ * PNG-encoding them first when requested (see encode_response_image()).
+ * After the first failed send the connection is broken and its remaining
+ * jobs are released without being sent. A prepare has no reply.
+ *
+ * @param item       Job answered by the prepare stage or a GPU worker
+ * @param user_data  Unused
+ */
+static void pipeline_respond_job(void *item, void *user_data) {
+    request_job_t *job = (request_job_t *)item;
+
+    (void)user_data;
+
+    if (is_prepare_message(job)) {
+        return;
+    }
+
+    /* Outside the write lock so progress frames of the next request keep flowing */
+    encode_response_image(job);
+    connection_send(job->conn, send_job_response, job);
+}
+
+/**
+ * Stage callbacks of the request pipeline.
+ */
+static const pipeline_ops_t g_pipeline_ops = {
+    pipeline_prepare_job, pipeline_generate_job, pipeline_respond_job, pipeline_release_job
+};
+
+/**
+ * start_pipeline - Start the request pipeline with one GPU worker per device
+ *
+ * @param pipeline  Pipeline state to initialize
+ * @return          0 on success, -1 on failure (nothing left to clean up)
+ */
+static int start_pipeline(pipeline_t *pipeline) {
+    void *devices[MAX_GPU_DEVICES];
+    pipeline_error_t pipe_err;
+
+    for (int i = 0; i < g_device_count; i++) {
+        devices[i] = &g_devices[i];
+    }
+
+    pipe_err = pipeline_start(pipeline, &g_pipeline_ops, devices, g_device_count, NULL);
+    if (pipe_err != PIPELINE_OK) {
+        fprintf(stderr, "failed to start request pipeline: %s\n", pipeline_error_string(pipe_err));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * send_stats_frame - connection_send() callback for send_stats_response()
+ */
+static int send_stats_frame(int client_fd, void *arg) {
+    return send_stats_response(client_fd, *(const uint64_t *)arg);
+}
+
+/**
+ * pipeline_dispatch - Hand a request read from a connection to the pipeline
+ *
+ * MSG_CANCEL is handled here on the reader thread rather than queued, so it
+ * reaches a request of the same connection that is still queued or already
+ * generating. MSG_STATS_REQUEST is answered here too, so it reports a busy
+ * queue instead of waiting behind it. A MSG_PREPARE that failed validation is
+ * dropped. Everything else is queued, holding a reference to conn; a full
+ * queue blocks until the prepare stage takes a request.
+ *
+ * @param pipeline  Running pipeline
+ * @param conn      Connection the request was read from
+ * @param job       Job from read_request() or connection_read_job() (consumed)
+ * @return          0 to keep reading, -1 if the pipeline no longer accepts requests
+ */
+static int pipeline_dispatch(pipeline_t *pipeline, connection_t *conn, request_job_t *job) {
+    /* Cancels act immediately instead of queueing behind the GPU */
+    if (job->msg_type == MSG_CANCEL && job->error == ERR_NONE) {
+        if (connection_cancel(conn, job->cancel.request_id) != CONNECTION_OK) {
+            fprintf(stderr, "cancel for request %llu ignored (not in flight)\n",
+                    (unsigned long long)job->cancel.request_id);
+        }
+        release_request_job(job);
+        free(job);
+        return 0;
+    }
+
+    /* A prepare that failed validation was only a hint: no reply, not counted */
+    if (is_invalid_prepare(job)) {
+        release_request_job(job);
+        free(job);
+        return 0;
+    }
+
+    if (job->msg_type == MSG_STATS_REQUEST && job->error == ERR_NONE) {
+        connection_send(conn, send_stats_frame, &job->request_id);
+        release_request_job(job);
+        free(job);
+        return 0;
+    }
+
+    /* A prepare has no request ID of its own to cancel and is not counted */
+    if (job->error == ERR_NONE && !is_prepare_message(job)) {
+        job->tracked = connection_track(conn, job->request_id) == CONNECTION_OK;
+    }
+    job->conn = conn;
+    job->owner = connection_owner(conn);
+    connection_ref(conn);
+
+    /* Counted before the push so a fast worker never starts it first */
+    if (!is_prepare_message(job)) {
+        server_stats_received(&g_stats);
+    }
+
+    if (pipeline_submit(pipeline, job) != PIPELINE_OK) {
+        if (job->tracked) {
+            connection_untrack(conn, job->request_id);
+        }
+        pipeline_release_job(job, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * serve_pipelined - Process requests on a persistent connection as a pipeline
+ *
+ * The calling thread reads and decodes requests while the prepare thread
+ * answers what the result cache holds, the GPU worker threads (one per
+ * device) generate the rest and the writer thread sends finished ones (see
+ * pipeline.h), so socket I/O, cache lookups and protocol work overlap
+ * generation instead of stalling the GPU. Text encoding is part of
+ * generation and is not overlapped (see prepare_request()). Cache hits and
+ * rejected requests can be answered ahead of slower requests sent before
+ * them. Generated replies keep request order with one device; with several
+ * they are sent as they finish. Clients match replies by request_id.
+ * Control messages are answered by pipeline_dispatch().
+ *
+ * Falls back to handle_connection() one request at a time if the pipeline
+ * cannot be started.
+ *
+ * @param client_fd  Connected client socket
+ */
+static void serve_pipelined(int client_fd) {
+    pipeline_t pipeline;
+    connection_t *conn;
+
+    conn = open_connection(client_fd, 0);
+    if (conn == NULL || start_pipeline(&pipeline) != 0) {
+        uint64_t owner = new_retained_owner();
+
+        fprintf(stderr, "warning: request pipeline unavailable, processing requests sequentially\n");
+        connection_unref(conn);
+        while (!socket_is_shutdown_requested()) {
+            if (handle_connection(client_fd, owner) != 0) {
+                break;
+            }
+        }
+        forget_retained_owner(owner);
+        return;
+    }
+
+    while (!socket_is_shutdown_requested()) {
+        request_job_t *job = malloc(sizeof(*job));
+        if (job == NULL) {
+            fprintf(stderr, "failed to allocate request job\n");
+            break;
+        }
+
+        if (read_request(client_fd, job) != 0) {
+            /* Connection closed, I/O error, or shut down by the writer */
+            release_request_job(job);
+            free(job);
+            break;
+        }
+
+        if (pipeline_dispatch(&pipeline, conn, job) != 0) {
+            break;
+        }
+    }
+
+    pipeline_stop(&pipeline);
+    connection_unref(conn);
+}
+
+/**
+ * recv_progress - Map a recv() that made no progress to a read status
+ *
+ * @param n  recv() result (0 or negative)
+ * @return   0 if the socket would block or the call was interrupted,
+ *           -1 if the peer closed the connection or the read failed
+ */
+static int recv_progress(ssize_t n) {
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * connection_read_job - Read what has arrived towards a client's next request
+ *
+ * Non-blocking counterpart of read_request() for the server event loop. A
+ * partial header or payload stays in reader until the rest arrives. Reads
+ * stop at the end of the request, so bytes of the next one stay in the
+ * socket and the level-triggered loop calls back for them.
+ *
+ * @param reader  Server-mode client
+ * @param out     Set to the finished job when 1 is returned
+ * @return        1 if a request is complete, 0 if more data is needed,
+ *                -1 on connection close/fatal error
+ */
+static int connection_read_job(client_reader_t *reader, request_job_t **out) {
+    int client_fd = connection_fd(reader->conn);
+    ssize_t n;
+    int rc;
+
+    if (reader->job == NULL) {
+        n = recv(client_fd, reader->header + reader->header_len,
+                 sizeof(reader->header) - reader->header_len, MSG_DONTWAIT);
+        if (n <= 0) {
+            return recv_progress(n);
+        }
+        reader->header_len += (size_t)n;
+        if (reader->header_len < sizeof(reader->header)) {
+            return 0;
+        }
+        reader->header_len = 0;
+
+        request_job_t *job = malloc(sizeof(*job));
+        if (job == NULL) {
+            fprintf(stderr, "failed to allocate request job\n");
+            return -1;
+        }
+
+        rc = request_begin(job, reader->header, &reader->hdr, &reader->header_err);
+        if (rc < 0) {
+            free(job);
+            return -1;
+        }
+        if (rc == 0) {
+            *out = job;
+            return 1;
+        }
+        reader->job = job;
+        reader->payload_read = 0;
+    }
+
+    if (reader->payload_read < reader->hdr.payload_len) {
+        n = recv(client_fd, reader->job->buffer + 16 + reader->payload_read,
+                 reader->hdr.payload_len - reader->payload_read, MSG_DONTWAIT);
+        if (n <= 0) {
+            return recv_progress(n);
+        }
+        reader->payload_read += (size_t)n;
+        if (reader->payload_read < reader->hdr.payload_len) {
+            return 0;
+        }
+    }
+
+    request_decode(reader->job, &reader->hdr, reader->header_err);
+    *out = reader->job;
+    reader->job = NULL;
+    return 1;
+}
+
+/**
+ * server_connection_open - Event loop callback for a newly accepted client
+ */
+static void *server_connection_open(int client_fd, void *user_data) {
+    client_reader_t *reader;
+
+    (void)user_data;
+    reader = calloc(1, sizeof(*reader));
+    if (reader == NULL) {
+        fprintf(stderr, "failed to allocate connection state\n");
+        return NULL;
+    }
+
+    reader->conn = open_connection(client_fd, 1);
+    if (reader->conn == NULL) {
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/**
+ * server_connection_readable - Event loop callback: read and dispatch a request
+ *
+ * Dispatches at most one request per call, so a client with many requests
+ * buffered takes turns with the others.
+ */
+static int server_connection_readable(void *arg, void *user_data) {
+    client_reader_t *reader = (client_reader_t *)arg;
+    pipeline_t *pipeline = (pipeline_t *)user_data;
+    request_job_t *job;
+    int rc;
+
+    rc = connection_read_job(reader, &job);
+    if (rc <= 0) {
+        return rc;
+    }
+    return pipeline_dispatch(pipeline, reader->conn, job);
+}
+
+/**
+ * server_connection_close - Event loop callback for a dropped client
+ *
+ * Requests the client already sent are still generated and answered;
+ * the socket closes once the last of them is done.
+ */
+static void server_connection_close(void *arg, void *user_data) {
+    client_reader_t *reader = (client_reader_t *)arg;
+
+    (void)user_data;
+    if (reader->job != NULL) {
+        release_request_job(reader->job);
+        free(reader->job);
+    }
+    connection_unref(reader->conn);
+    free(reader);
+}
+
+/**
+ * serve_clients - Serve every client of the listening socket through one pipeline
+ *
+ * Server-mode counterpart of serve_pipelined(). The event loop keeps every
+ * authenticated client connected at once and reads their requests without
+ * blocking, and all of them share the request queue, so the GPU workers (one
+ * per device) take requests from whichever clients sent them. Replies,
+ * progress frames and MSG_CANCEL stay with the connection each request came
+ * from.
+ *
+ * Reading stops for everyone while the request queue is full, which caps
+ * memory instead of letting one fast client queue without bound. A client
+ * that stops reading its replies can hold up the writer for the socket write
+ * timeout, after which its connection is dropped.
+ *
+ * Falls back to the serial accept loop (handle_serial_client()) if the pipeline
+ * cannot be started.
+ *
+ * @param listen_fd  Listening socket from socket_create()
+ * @return           SOCKET_OK on graceful shutdown, error code on failure
+ */
+static socket_error_t serve_clients(int listen_fd) {
+    socket_event_handlers_t handlers = {
+        server_connection_open, server_connection_readable, server_connection_close
+    };
+    pipeline_t pipeline;
+    socket_error_t err;
+
+    if (start_pipeline(&pipeline) != 0) {
+        fprintf(stderr, "warning: request pipeline unavailable, serving one connection at a time\n");
+        return socket_accept_loop(listen_fd, handle_serial_client);
+    }
+
+    err = socket_event_loop(listen_fd, &handlers, &pipeline);
+    pipeline_stop(&pipeline);
+    return err;
+}
+
+/**
+ * model_file_size - Size of an optional model file (0 if unset or missing)
+ */
+static size_t model_file_size(const char *path) {
+    struct stat st;
+
+    if (path[0] == '\0' || stat(path, &st) != 0 || st.st_size < 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+/**
+ * plan_device_models - Fit every configured model to a device's free VRAM
+ *
+ * Fills device->plans and, in models (a copy of g_models for this device's
+ * registry), the planned CPU/GPU placement and, unless configured, the VRAM
+ * estimate. Each model is planned as if it had the device to itself; the
+ * registry's --vram-budget eviction handles several loaded models. Without
+ * a VRAM reading the configured placement is used unchanged.
+ *
+ * @param device  Device to plan for
+ * @param models  g_model_count models to update
+ */
+static void plan_device_models(gpu_device_t *device, model_config_t *models) {
+    size_t free_bytes;
+    size_t total_bytes;
+
+    device->planned = false;
+    if (!g_vram_plan) {
+        return;
+    }
+
+    if (sd_wrapper_get_device_memory(device->device_index, &free_bytes, &total_bytes)
+            != SD_WRAPPER_OK) {
+        fprintf(stderr, "device %d: cannot read free VRAM, using configured placement\n",
+                device->device_index);
+        return;
+    }
+    if (g_vram_budget != 0 && g_vram_budget < free_bytes) {
+        free_bytes = g_vram_budget;
+    }
+
+    for (size_t i = 0; i < g_model_count; i++) {
+        model_config_t *model = &models[i];
+        vram_plan_t *plan = &device->plans[i];
+        vram_plan_input_t input;
+        vram_plan_error_t err;
+
+        vram_plan_input_init(&input);
+        input.vram_free = free_bytes;
+        input.diffusion_bytes = model_file_size(model->model_path);
+        input.text_encoder_bytes = model_file_size(model->clip_l_path) +
+                                   model_file_size(model->clip_g_path);
+        if (model->t5) {
+            input.text_encoder_bytes += model_file_size(model->t5xxl_path);
+        }
+        input.vae_bytes = model_file_size(model->vae_path);
+        input.max_pixels = SD35_MAX_DIMENSION * SD35_MAX_DIMENSION;
+
+        err = vram_plan_choose(&input, plan);
+        if (err != VRAM_PLAN_OK && err != VRAM_PLAN_ERR_NO_FIT) {
+            fprintf(stderr, "device %d: planning model %u failed: %s\n",
+                    device->device_index, (unsigned)model->model_id,
+                    vram_plan_error_string(err));
+            return;
+        }
+
+        fprintf(stderr, "device %d model %u (%s): %s weights, text encoders on %s, "
+                "VAE on %s, VAE tiling %s%u px, ~%zu MB peak of %zu MB free\n",
+                device->device_index, (unsigned)model->model_id, model->name,
+                vram_plan_wtype_name(plan->wtype),
+                plan->keep_clip_on_cpu ? "CPU" : "GPU",
+                plan->keep_vae_on_cpu ? "CPU" : "GPU",
+                plan->vae_tile_pixels != 0 ? "above " : "off, max ",
+                plan->vae_tile_pixels != 0 ? plan->vae_tile_pixels : input.max_pixels,
+                plan->peak_bytes / (1024 * 1024), free_bytes / (1024 * 1024));
+        if (err == VRAM_PLAN_ERR_NO_FIT) {
+            fprintf(stderr, "warning: model %u is not expected to fit in %zu MB on device %d\n",
+                    (unsigned)model->model_id, free_bytes / (1024 * 1024), device->device_index);
+        }
+
+        model->keep_clip_on_cpu = plan->keep_clip_on_cpu;
+        model->keep_vae_on_cpu = plan->keep_vae_on_cpu;
+        if (model->vram_bytes == 0) {
+            model->vram_bytes = plan->weight_bytes;
+        }
+    }
+
+    device->planned = true;
+}
+
+/**
+ * load_model - Model registry loader: create an SD wrapper context
+ *
+ * @param model      Model to load
+ * @param user_data  gpu_device_t to load it on
+ * @return           sd_wrapper_ctx_t, or NULL on failure
+ */
+static void *load_model(const model_config_t *model, void *user_data) {
+    gpu_device_t *device = (gpu_device_t *)user_data;
+    sd_wrapper_config_t config;
+    sd_wrapper_ctx_t *ctx;
+
+    fprintf(stderr, "loading model %u (%s) from %s on device %d%s...\n",
+            (unsigned)model->model_id, model->name, model->model_path, device->device_index,
+            model->t5 ? "" : " without T5-XXL");
+
+    sd_wrapper_config_init(&config);
+    config.model_path = model->model_path;
+    config.clip_l_path = model->clip_l_path[0] != '\0' ? model->clip_l_path : NULL;
+    config.clip_g_path = model->clip_g_path[0] != '\0' ? model->clip_g_path : NULL;
+    /* Without T5-XXL, stable-diffusion.cpp zero-fills its part of the conditioning */
+    config.t5xxl_path = model->t5 && model->t5xxl_path[0] != '\0' ? model->t5xxl_path : NULL;
+    config.vae_path = model->vae_path[0] != '\0' ? model->vae_path : NULL;
+    config.n_threads = -1;
+    config.keep_clip_on_cpu = model->keep_clip_on_cpu;
+    config.keep_vae_on_cpu = model->keep_vae_on_cpu;
+    config.enable_flash_attn = model->enable_flash_attn;
+    config.step_cache_threshold = model->step_cache;
+    config.device_index = device->device_index;
+    config.prepare_weights = g_prepare_weights;
+    config.reuse_context = g_reuse_context;
+
+    if (device->planned) {
+        /* Registry models are copies of g_models[] entries */
+        const vram_plan_t *plan = &device->plans[find_model(model->model_id) - g_models];
+
+        config.weight_type = plan_weight_type(plan->wtype);
+        config.vae_tile_pixels = plan->vae_tile_pixels;
+    }
+
+    ctx = sd_wrapper_create(&config);
+    if (ctx == NULL) {
+        fprintf(stderr, "failed to load model %u (%s)\n", (unsigned)model->model_id, model->name);
+    }
+    return ctx;
+}
+
+/**
+ * unload_model - Model registry loader: free an SD wrapper context
+ *
+ * @param handle     sd_wrapper_ctx_t from load_model()
+ * @param model      Model being unloaded
+ * @param user_data  gpu_device_t it was loaded on
+ */
+static void unload_model(void *handle, const model_config_t *model, void *user_data) {
+    gpu_device_t *device = (gpu_device_t *)user_data;
+    sd_wrapper_ctx_t *ctx = (sd_wrapper_ctx_t *)handle;
+
+    fprintf(stderr, "unloading model %u (%s) from device %d...\n",
+            (unsigned)model->model_id, model->name, device->device_index);
+    sd_wrapper_free(ctx);
+}
+
+/**
+ * parse_device_list - Parse the --devices argument
+ *
+ * @param list     Comma-separated device indices, e.g. "0,1"
+ * @param indices  Output array of MAX_GPU_DEVICES indices
+ * @param count    Output number of indices
+ * @return         0 on success, -1 if the list is malformed, too long or
+ *                 repeats a device
+ */
+static int parse_device_list(const char *list, int *indices, int *count) {
+    const char *p = list;
+
+    *count = 0;
+    for (;;) {
+        char *end;
+        long value;
+
+        errno = 0;
+        value = strtol(p, &end, 10);
+        if (errno != 0 || end == p || value < 0 || value > 255 ||
+            (*end != ',' && *end != '\0') || *count >= MAX_GPU_DEVICES) {
+            return -1;
+        }
+        for (int i = 0; i < *count; i++) {
+            if (indices[i] == (int)value) {
+                return -1;
+            }
+        }
+        indices[(*count)++] = (int)value;
+
+        if (*end == '\0') {
+            return 0;
+        }
+        p = end + 1;
+    }
+}
+
+/**
+ * parse_resolution - Parse a WIDTHxHEIGHT argument
+ *
+ * @param arg     Argument, e.g. "1024x1024"
+ * @param width   Output width
+ * @param height  Output height
+ * @return        0 on success, -1 unless both are valid SD 3.5 dimensions
+ */
+static int parse_resolution(const char *arg, uint32_t *width, uint32_t *height) {
+    long values[2];
+    const char *p = arg;
+
+    for (int i = 0; i < 2; i++) {
+        char *end;
+
+        errno = 0;
+        values[i] = strtol(p, &end, 10);
+        if (errno != 0 || end == p || *end != (i == 0 ? 'x' : '\0') ||
+            values[i] < SD35_MIN_DIMENSION || values[i] > SD35_MAX_DIMENSION ||
+            values[i] % SD35_DIMENSION_ALIGNMENT != 0) {
+            return -1;
+        }
+        p = end + 1;
+    }
+    *width = (uint32_t)values[0];
+    *height = (uint32_t)values[1];
+    return 0;
+}
+
+/**
+ * make_dir - Create a directory unless it already exists
+ *
+ * @return  0 if path is a directory afterwards, -1 otherwise
+ */
+static int make_dir(const char *path) {
+    struct stat st;
+
+    if (mkdir(path, 0700) == 0) {
+        return 0;
+    }
+    return (errno == EEXIST && stat(path, &st) == 0 && S_ISDIR(st.st_mode)) ? 0 : -1;
+}
+
+/**
+ * default_pipeline_cache_dir - Create and return the default pipeline cache
+ *
+ * @param path  Output path
+ * @param size  Size of path
+ * @return      0 on success, -1 if neither XDG_CACHE_HOME nor HOME is set or
+ *              the directories cannot be created
+ */
+static int default_pipeline_cache_dir(char *path, size_t size) {
+    const char *base = getenv("XDG_CACHE_HOME");
+    int len;
+
+    /* The XDG spec says to ignore relative paths */
+    if (base != NULL && base[0] == '/') {
+        len = snprintf(path, size, "%s", base);
+    } else {
+        base = getenv("HOME");
+        if (base == NULL || base[0] != '/') {
+            return -1;
+        }
+        len = snprintf(path, size, "%s/.cache", base);
+    }
+    if (len < 0 || (size_t)len >= size || make_dir(path) != 0) {
+        return -1;
+    }
+
+    len += snprintf(path + len, size - (size_t)len, "/weave");
+    if ((size_t)len >= size || make_dir(path) != 0) {
+        return -1;
+    }
+
+    len += snprintf(path + len, size - (size_t)len, "/%s", PIPELINE_CACHE_DIR_NAME);
+    if ((size_t)len >= size || make_dir(path) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * warm_up_devices - Generate one small image with each pinned model
+ *
+ * Runs on the main thread before the socket is connected. The first
+ * generation on a context compiles the Vulkan pipelines it uses (or reads
+ * them from the pipeline cache) and makes ggml's first compute buffer
+ * allocations. Doing that here keeps it off the first request. The request
+ * after it takes the same reset path every later request takes.
+ *
+ * Failures are logged and otherwise ignored; the daemon serves requests
+ * as it would without a warm-up.
+ *
+ * @param width   Warm-up image width
+ * @param height  Warm-up image height
+ */
+static void warm_up_devices(uint32_t width, uint32_t height) {
+    static const char prompt[] = WARMUP_PROMPT;
+    uint8_t prompt_data[3 * (sizeof(prompt) - 1)];
+    sd35_generate_request_t req;
+
+    for (int i = 0; i < 3; i++) {
+        memcpy(prompt_data + i * (sizeof(prompt) - 1), prompt, sizeof(prompt) - 1);
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.width = width;
+    req.height = height;
+    req.steps = WARMUP_STEPS;
+    req.cfg_scale = WARMUP_CFG_SCALE;
+    req.seed = 1;
+    req.clip_l_offset = 0;
+    req.clip_l_length = sizeof(prompt) - 1;
+    req.clip_g_offset = sizeof(prompt) - 1;
+    req.clip_g_length = sizeof(prompt) - 1;
+    req.t5_offset = 2 * (sizeof(prompt) - 1);
+    req.t5_length = sizeof(prompt) - 1;
+    req.prompt_data = prompt_data;
+    req.prompt_data_len = sizeof(prompt_data);
+
+    for (int d = 0; d < g_device_count; d++) {
+        gpu_device_t *device = &g_devices[d];
+
+        for (size_t m = 0; m < g_model_count; m++) {
+            sd35_generate_response_t resp;
+            struct timespec start;
+            struct timespec end;
+            error_code_t err;
+            void *model;
+
+            if (!g_models[m].pinned) {
+                continue;
+            }
+            if (model_registry_acquire(device->models, g_models[m].model_id, &model) !=
+                MODEL_REGISTRY_OK) {
+                continue;
+            }
+            device->sd_ctx = (sd_wrapper_ctx_t *)model;
+            req.model_id = g_models[m].model_id;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            err = process_generate_request(device->sd_ctx, &req, &resp);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (err != ERR_NONE) {
+                fprintf(stderr, "warning: warm-up of model %u on device %d failed: %d\n",
+                        (unsigned)g_models[m].model_id, device->device_index, err);
+                continue;
+            }
+            free_generate_response(&resp);
+            fprintf(stderr, "warmed up model %u on device %d at %ux%u in %llu ms\n",
+                    (unsigned)g_models[m].model_id, device->device_index,
+                    (unsigned)width, (unsigned)height,
+                    (unsigned long long)(elapsed_us(&start, &end) / 1000));
+        }
+    }
+}
+
+/**
+ * cleanup - Clean up resources before exit
+ */
+static void cleanup(void) {
+    if (g_result_cache != NULL) {
+        result_cache_stats_t result_stats;
+        if (result_cache_get_stats(g_result_cache, &result_stats) == CACHE_OK) {
+            fprintf(stderr, "result cache: %llu hits, %llu disk hits, %llu misses, %llu evictions\n",
+                    (unsigned long long)result_stats.hits,
+                    (unsigned long long)result_stats.disk_hits,
+                    (unsigned long long)result_stats.misses,
+                    (unsigned long long)result_stats.evictions);
+        }
+        result_cache_destroy(g_result_cache);
+        g_result_cache = NULL;
+    }
+    result_cache_destroy(g_retained);
+    g_retained = NULL;
+    for (size_t i = 0; i < g_model_count; i++) {
+        free(g_model_fingerprints[i]);
+        g_model_fingerprints[i] = NULL;
+    }
+
+    for (int i = 0; i < g_device_count; i++) {
+        gpu_device_t *device = &g_devices[i];
+        model_registry_stats_t model_stats;
+        if (model_registry_get_stats(device->models, &model_stats) == MODEL_REGISTRY_OK) {
+            fprintf(stderr, "device %d models: %llu loads, %llu evictions, %llu load failures\n",
+                    device->device_index,
+                    (unsigned long long)model_stats.loads,
+                    (unsigned long long)model_stats.evictions,
+                    (unsigned long long)model_stats.load_failures);
+        }
+        model_registry_destroy(device->models);
+        device->models = NULL;
+        device->sd_ctx = NULL;
+    }
+    g_device_count = 0;
+
+    if (g_buffer_pool != NULL) {
+        buffer_pool_stats_t pool_stats;
+        if (buffer_pool_get_stats(g_buffer_pool, &pool_stats) == BUFFER_POOL_OK) {
+            fprintf(stderr, "buffer pool: %llu hits, %llu misses, %llu drops, "
+                    "%llu lock failures\n",
+                    (unsigned long long)pool_stats.hits,
+                    (unsigned long long)pool_stats.misses,
+                    (unsigned long long)pool_stats.drops,
+                    (unsigned long long)pool_stats.lock_failures);
+        }
+        buffer_pool_destroy(g_buffer_pool);
+        g_buffer_pool = NULL;
+    }
+
+    if (g_socket_fd >= 0) {
+        close(g_socket_fd);
+        g_socket_fd = -1;
+    }
+
+    /*
+     * Only clean up socket file if we created it.
+     * If we connected to a socket created by weave, weave owns the cleanup.
+     */
+    if (g_socket_owned) {
+        socket_cleanup();
+    }
+
+    server_stats_destroy(&g_stats);
+}
+
+int main(int argc, char *argv[]) {
+    /* Variable declarations at top for C99 compliance */
+    int exit_code = EXIT_FAILURE;
+    socket_error_t err;
     const char *custom_socket_path = NULL;
     char socket_path[SOCKET_PATH_MAX];
+    char cache_dir[SOCKET_PATH_MAX + sizeof(RESULT_CACHE_DIR_NAME) + 1];
+    long cache_size_mb = DEFAULT_CACHE_SIZE_MB;
+    long cache_disk_size_mb = DEFAULT_CACHE_DISK_SIZE_MB;
+    result_cache_config_t cache_config;
+    long retain_mb = DEFAULT_RETAIN_RESULTS_MB;
+    const char *pipeline_cache_path = NULL;
+    char pipeline_cache_buf[PATH_MAX];
+    bool pipeline_cache = true;
+    bool load_t5 = true;
+    uint32_t warmup_width = 0;
+    uint32_t warmup_height = 0;
+    long buffer_pool_mb = DEFAULT_BUFFER_POOL_MB;
+    buffer_pool_config_t pool_config = {0, false, false};
+    buffer_pool_error_t pool_err;
+    int device_indices[MAX_GPU_DEVICES] = {-1};
+    int device_count = 1;
+    const char *models_path = NULL;
+    model_loader_t loader;
+    model_registry_error_t model_err;
+    model_registry_stats_t model_stats;
+    unsigned error_line;
     int opt;
 
     /* Long options for getopt_long */
     static struct option long_options[] = {
         {"socket-path", required_argument, 0, 's'},
+        {"request-timeout", required_argument, 0, 't'},
+        {"cache-size", required_argument, 0, 'c'},
+        {"cache-disk-size", required_argument, 0, 'd'},
+        {"retain-results", required_argument, 0, 'r'},
+        {"buffer-pool", required_argument, 0, 'b'},
+        {"buffer-pool-hugepages", no_argument, 0, 'H'},
+        {"buffer-pool-lock", no_argument,  0, 'L'},
+        {"devices", required_argument, 0, 'g'},
+        {"models", required_argument, 0, 'm'},
+        {"vram-budget", required_argument, 0, 'v'},
+        {"prepare-models", no_argument,    0, 'p'},
+        {"pipeline-cache", required_argument, 0, 'C'},
+        {"no-pipeline-cache", no_argument, 0, 'N'},
+        {"warmup", required_argument,      0, 'W'},
+        {"no-vram-plan", no_argument,      0, 'P'},
+        {"no-t5",       no_argument,       0, 'T'},
+        {"reuse-context", no_argument,     0, 'R'},
         {"help",        no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
 
     /* Parse command line arguments */
-    while ((opt = getopt_long(argc, argv, "hs:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hs:t:c:d:r:b:HLg:m:v:pPC:NW:TR", long_options, NULL)) != -1) {
         switch (opt) {
         case 's':
             custom_socket_path = optarg;
             break;
+        case 't': {
+            char *end;
+            errno = 0;
+            g_request_timeout_s = strtol(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                g_request_timeout_s < 0 || g_request_timeout_s > 86400) {
+                fprintf(stderr, "error: --request-timeout must be 0-86400 seconds\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'c':
+        case 'd':
+        case 'r': {
+            char *end;
+            long value;
+            errno = 0;
+            value = strtol(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                value < 0 || value > MAX_CACHE_SIZE_MB) {
+                fprintf(stderr, "error: --%s must be 0-%d MB\n",
+                        opt == 'c' ? "cache-size"
+                                   : opt == 'd' ? "cache-disk-size" : "retain-results",
+                        MAX_CACHE_SIZE_MB);
+                return EXIT_FAILURE;
+            }
+            if (opt == 'c') {
+                cache_size_mb = value;
+            } else if (opt == 'd') {
+                cache_disk_size_mb = value;
+            } else {
+                retain_mb = value;
+            }
+            break;
+        }
+        case 'b': {
+            char *end;
+            errno = 0;
+            buffer_pool_mb = strtol(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                buffer_pool_mb < 0 || buffer_pool_mb > MAX_BUFFER_POOL_MB) {
+                fprintf(stderr, "error: --buffer-pool must be 0-%d MB\n", MAX_BUFFER_POOL_MB);
+                return EXIT_FAILURE;
+            }
+            break;
+        }
+        case 'H':
+            pool_config.hugepages = true;
+            break;
+        case 'L':
+            pool_config.lock = true;
+            break;
+        case 'g':
+            if (parse_device_list(optarg, device_indices, &device_count) != 0) {
+                fprintf(stderr, "error: --devices must be up to %d distinct indices 0-255, "
+                        "comma-separated\n", MAX_GPU_DEVICES);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'm':
+            models_path = optarg;
+            break;
+        case 'v': {
+            char *end;
+            long value;
+            errno = 0;
+            value = strtol(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' ||
+                value < 0 || value > MAX_VRAM_BUDGET_MB) {
+                fprintf(stderr, "error: --vram-budget must be 0-%d MB\n", MAX_VRAM_BUDGET_MB);
+                return EXIT_FAILURE;
+            }
+            g_vram_budget = (size_t)value * 1024 * 1024;
+            break;
+        }
+        case 'p':
+            g_prepare_weights = true;
+            break;
+        case 'P':
+            g_vram_plan = false;
+            break;
+        case 'C':
+            pipeline_cache_path = optarg;
+            break;
+        case 'N':
+            pipeline_cache = false;
+            break;
+        case 'T':
+            load_t5 = false;
+            break;
+        case 'R':
+            g_reuse_context = true;
+            break;
+        case 'W':
+            if (parse_resolution(optarg, &warmup_width, &warmup_height) != 0) {
+                fprintf(stderr, "error: --warmup must be WIDTHxHEIGHT, each %d-%d and a "
+                        "multiple of %d\n", SD35_MIN_DIMENSION, SD35_MAX_DIMENSION,
+                        SD35_DIMENSION_ALIGNMENT);
+                return EXIT_FAILURE;
+            }
+            break;
         case 'h':
             print_usage(argv[0], 0);
             break;
@@ -585,26 +3484,110 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    fprintf(stderr, "loading model from %s...\n", MODEL_PATH);
-    sd_wrapper_config_t config;
-    sd_wrapper_config_init(&config);
-    config.model_path = MODEL_PATH;
-    config.clip_l_path = CLIP_L_PATH;
-    config.clip_g_path = CLIP_G_PATH;
-    config.t5xxl_path = T5XXL_PATH;
-    config.n_threads = -1;
-    config.keep_clip_on_cpu = true;   /* Text encoders on CPU to save VRAM */
-    config.keep_vae_on_cpu = false;
-    config.enable_flash_attn = true;
-
-    g_sd_ctx = sd_wrapper_create(&config);
-    if (g_sd_ctx == NULL) {
-        fprintf(stderr, "failed to load model: %s\n", MODEL_PATH);
-        fprintf(stderr, "ensure model file exists and is a valid SD 3.5 Medium model\n");
+    /* Before any cleanup() call, which destroys it */
+    if (server_stats_init(&g_stats, device_count) != SERVER_STATS_OK) {
+        fprintf(stderr, "failed to initialize stats\n");
         return EXIT_FAILURE;
     }
 
-    fprintf(stderr, "model loaded successfully\n");
+    /* Model registry: --models config, or the default model pinned */
+    if (models_path != NULL) {
+        model_err = model_registry_parse_file(models_path, g_models, MODEL_REGISTRY_MAX_MODELS,
+                                              &g_model_count, &error_line);
+        if (model_err != MODEL_REGISTRY_OK) {
+            if (error_line > 0) {
+                fprintf(stderr, "error: %s:%u: %s\n", models_path, error_line,
+                        model_registry_error_string(model_err));
+            } else {
+                fprintf(stderr, "error: %s: %s\n", models_path,
+                        model_registry_error_string(model_err));
+            }
+            return EXIT_FAILURE;
+        }
+    } else {
+        model_config_init(&g_models[0], MODEL_ID_SD35);
+        snprintf(g_models[0].name, sizeof(g_models[0].name), "sd3.5-medium");
+        snprintf(g_models[0].model_path, sizeof(g_models[0].model_path), "%s", MODEL_PATH);
+        snprintf(g_models[0].clip_l_path, sizeof(g_models[0].clip_l_path), "%s", CLIP_L_PATH);
+        snprintf(g_models[0].clip_g_path, sizeof(g_models[0].clip_g_path), "%s", CLIP_G_PATH);
+        snprintf(g_models[0].t5xxl_path, sizeof(g_models[0].t5xxl_path), "%s", T5XXL_PATH);
+        g_models[0].pinned = true;
+        g_model_count = 1;
+    }
+    if (!load_t5) {
+        for (size_t i = 0; i < g_model_count; i++) {
+            g_models[i].t5 = false;
+        }
+    }
+
+    /*
+     * Pipeline cache. Set before anything initializes Vulkan: the VRAM plan
+     * below queries devices, and drivers read the settings only then.
+     */
+    if (pipeline_cache) {
+        if (pipeline_cache_path != NULL) {
+            if (make_dir(pipeline_cache_path) != 0) {
+                fprintf(stderr, "warning: cannot create %s, pipeline cache not set\n",
+                        pipeline_cache_path);
+                pipeline_cache_path = NULL;
+            }
+        } else if (default_pipeline_cache_dir(pipeline_cache_buf,
+                                              sizeof(pipeline_cache_buf)) == 0) {
+            pipeline_cache_path = pipeline_cache_buf;
+        } else {
+            fprintf(stderr, "warning: no usable cache directory, pipeline cache not set\n");
+        }
+        if (pipeline_cache_path != NULL &&
+            sd_wrapper_set_pipeline_cache_dir(pipeline_cache_path) == SD_WRAPPER_OK) {
+            fprintf(stderr, "pipeline cache: %s\n", pipeline_cache_path);
+        }
+    }
+
+    /*
+     * One registry per device; each device holds its own copy of every model
+     * it loads. Pinned models load now, the rest on first request.
+     */
+    for (int i = 0; i < device_count; i++) {
+        gpu_device_t *device = &g_devices[g_device_count];
+        model_config_t device_models[MODEL_REGISTRY_MAX_MODELS];
+
+        device->device_index = device_indices[i];
+        device->sd_ctx = NULL;
+        memcpy(device_models, g_models, g_model_count * sizeof(g_models[0]));
+        plan_device_models(device, device_models);
+
+        loader.load = load_model;
+        loader.unload = unload_model;
+        loader.user_data = device;
+        device->models = model_registry_create(device_models, g_model_count, g_vram_budget,
+                                               &loader);
+        if (device->models == NULL) {
+            fprintf(stderr, "failed to create model registry\n");
+            cleanup();
+            return EXIT_FAILURE;
+        }
+        g_device_count++;
+
+        model_err = model_registry_load_pinned(device->models);
+        if (model_err != MODEL_REGISTRY_OK) {
+            fprintf(stderr, "failed to load pinned models on device %d: %s\n",
+                    device->device_index, model_registry_error_string(model_err));
+            fprintf(stderr, "ensure model files exist and are valid SD 3.5 models\n");
+            cleanup();
+            return EXIT_FAILURE;
+        }
+        if (model_registry_get_stats(device->models, &model_stats) == MODEL_REGISTRY_OK) {
+            server_stats_set_vram(&g_stats, g_device_count - 1, model_stats.vram_bytes);
+        }
+    }
+
+    fprintf(stderr, "%zu model(s) configured on %d device(s)\n", g_model_count, g_device_count);
+    build_model_fingerprints();
+
+    /* Before connecting, so weave sees the daemon only once it is warm */
+    if (warmup_width > 0) {
+        warm_up_devices(warmup_width, warmup_height);
+    }
 
     /*
      * Socket initialization: connect to existing socket if path is provided,
@@ -639,6 +3622,71 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "listening on %s\n", socket_path);
     }
 
+    /*
+     * Result cache. The disk tier sits next to the socket directory; without
+     * XDG_RUNTIME_DIR it is skipped and only the memory tier is used.
+     */
+    cache_config.memory_max_bytes = (size_t)cache_size_mb * 1024 * 1024;
+    cache_config.disk_max_bytes = 0;
+    cache_config.disk_dir = NULL;
+    if (cache_disk_size_mb > 0) {
+        if (socket_get_dir_path(cache_dir, SOCKET_PATH_MAX) == SOCKET_OK) {
+            size_t dir_len = strlen(cache_dir);
+            snprintf(cache_dir + dir_len, sizeof(cache_dir) - dir_len, "/%s", RESULT_CACHE_DIR_NAME);
+            cache_config.disk_max_bytes = (size_t)cache_disk_size_mb * 1024 * 1024;
+            cache_config.disk_dir = cache_dir;
+        } else {
+            fprintf(stderr, "warning: XDG_RUNTIME_DIR not set, result cache disk tier disabled\n");
+        }
+    }
+    if (cache_config.memory_max_bytes > 0 || cache_config.disk_max_bytes > 0) {
+        g_result_cache = result_cache_create(&cache_config);
+        if (g_result_cache == NULL && cache_config.disk_dir != NULL &&
+            cache_config.memory_max_bytes > 0) {
+            fprintf(stderr, "warning: cannot use %s, result cache disk tier disabled\n", cache_dir);
+            cache_config.disk_max_bytes = 0;
+            cache_config.disk_dir = NULL;
+            g_result_cache = result_cache_create(&cache_config);
+        }
+        if (g_result_cache == NULL) {
+            fprintf(stderr, "warning: failed to create result cache, caching disabled\n");
+        } else {
+            fprintf(stderr, "result cache: %ld MB memory, %ld MB disk\n", cache_size_mb,
+                    cache_config.disk_dir != NULL ? cache_disk_size_mb : 0L);
+        }
+    }
+
+    /*
+     * Retained results for refinement. Memory only: a handle names a result
+     * this process sent, so keeping it past a restart buys nothing.
+     */
+    if (retain_mb > 0) {
+        cache_config.memory_max_bytes = (size_t)retain_mb * 1024 * 1024;
+        cache_config.disk_max_bytes = 0;
+        cache_config.disk_dir = NULL;
+        g_retained = result_cache_create(&cache_config);
+        if (g_retained == NULL) {
+            fprintf(stderr, "warning: failed to create retained results, refinement disabled\n");
+        }
+    }
+
+    /*
+     * Buffer pool. Without it request and PNG buffers come straight from
+     * malloc(), which is also the fallback if creating the pool fails.
+     */
+    if (buffer_pool_mb > 0) {
+        pool_config.max_idle_bytes = (size_t)buffer_pool_mb * 1024 * 1024;
+        pool_err = buffer_pool_create(&pool_config, &g_buffer_pool);
+        if (pool_err != BUFFER_POOL_OK) {
+            fprintf(stderr, "warning: failed to create buffer pool, pooling disabled: %s\n",
+                    buffer_pool_error_string(pool_err));
+        } else {
+            fprintf(stderr, "buffer pool: %ld MB idle%s%s\n", buffer_pool_mb,
+                    pool_config.hugepages ? ", hugepages" : "",
+                    pool_config.lock ? ", locked" : "");
+        }
+    }
+
     /*
      * Connection mode: client mode (connected to existing socket) or
      * server mode (created own socket and accepting connections).
@@ -655,9 +3703,9 @@ int main(int argc, char *argv[]) {
          * roles - weave is the server (owns socket), compute is the client
          * (connects and processes work).
          *
-         * handle_connection() processes ONE request and returns:
-         * - 0: Request processed (success or protocol error), continue loop
-         * - -1: Connection closed or fatal error, exit loop
+         * serve_pipelined() reads, generates and sends on separate threads
+         * and returns once the connection closes, a fatal error occurs, or
+         * shutdown is requested.
          */
 
         /*
@@ -703,19 +3751,7 @@ int main(int argc, char *argv[]) {
 
         fprintf(stderr, "entering request/response loop\n");
 
-        while (!socket_is_shutdown_requested()) {
-            int result = handle_connection(g_socket_fd);
-            if (result != 0) {
-                /*
-                 * Connection closed or fatal error. This is normal when:
-                 * - weave shuts down and closes the connection
-                 * - client disconnects
-                 * - I/O error on socket
-                 */
-                break;
-            }
-            /* Request processed successfully, continue to next request */
-        }
+        serve_pipelined(g_socket_fd);
 
         if (socket_is_shutdown_requested()) {
             fprintf(stderr, "shutting down gracefully (signal received)\n");
@@ -727,13 +3763,14 @@ int main(int argc, char *argv[]) {
         /*
          * Server mode: Accept connections from clients (backward compatibility).
          * This mode is used when compute creates and owns the socket.
+         * serve_clients() serves all of them at once on every device.
          */
-        err = socket_accept_loop(g_socket_fd, handle_connection);
+        err = serve_clients(g_socket_fd);
         if (err == SOCKET_OK) {
             fprintf(stderr, "shutting down gracefully\n");
             exit_code = EXIT_SUCCESS;
         } else {
-            fprintf(stderr, "accept loop failed: %s\n", socket_error_string(err));
+            fprintf(stderr, "server loop failed: %s\n", socket_error_string(err));
         }
     }
 
@@ -0,0 +1,639 @@
+/**
+ * Weave Model Registry - Implementation
+ *
+ * A registry holds at most MODEL_REGISTRY_MAX_MODELS entries, so LRU order is
+ * a per-entry use counter and eviction scans the array for the oldest
+ * unpinned loaded entry instead of maintaining a list.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "weave/model_registry.h"
+
+/** Largest accepted config file */
+#define MODEL_REGISTRY_MAX_FILE_SIZE (64 * 1024)
+
+/** Largest accepted vram_mb */
+#define MODEL_REGISTRY_MAX_VRAM_MB (1024 * 1024)
+
+/** Largest accepted step_cache */
+#define MODEL_REGISTRY_MAX_STEP_CACHE 1.0f
+
+/**
+ * Registry entry
+ */
+typedef struct {
+    model_config_t config;
+    void *handle;         /* Loader handle, NULL if not loaded */
+    uint64_t last_used;   /* Value of registry->clock at the last acquire */
+} registry_entry_t;
+
+struct model_registry {
+    registry_entry_t entries[MODEL_REGISTRY_MAX_MODELS];
+    size_t count;
+    size_t vram_budget;           /* 0 = unlimited */
+    model_loader_t loader;
+    uint64_t clock;               /* Advances on every acquire */
+    model_registry_stats_t stats; /* loaded/vram_bytes kept current */
+};
+
+void model_config_init(model_config_t *model, uint32_t model_id) {
+    if (model == NULL) {
+        return;
+    }
+
+    memset(model, 0, sizeof(*model));
+    model->model_id = model_id;
+    model->keep_clip_on_cpu = true;
+    model->keep_vae_on_cpu = false;
+    model->enable_flash_attn = true;
+    model->t5 = true;
+    model->clip_only_model = MODEL_REGISTRY_NO_MODEL;
+    model->pinned = false;
+    model->vram_bytes = 0;
+    model->step_cache = 0.0f;
+}
+
+uint32_t model_config_clip_only_model(const model_config_t *model) {
+    if (model == NULL) {
+        return MODEL_REGISTRY_NO_MODEL;
+    }
+    if (!model->t5) {
+        return model->model_id;
+    }
+    return model->clip_only_model;
+}
+
+/**
+ * Trim leading and trailing whitespace in place.
+ */
+static char *trim(char *s) {
+    char *end;
+
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+
+    end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    *end = '\0';
+
+    return s;
+}
+
+/**
+ * Parse "true"/"false".
+ */
+static int parse_bool(const char *value, bool *out) {
+    if (strcmp(value, "true") == 0) {
+        *out = true;
+        return 0;
+    }
+    if (strcmp(value, "false") == 0) {
+        *out = false;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Copy value into a fixed-size field, failing if it does not fit.
+ */
+static int copy_field(char *dst, size_t dst_size, const char *value) {
+    size_t len = strlen(value);
+
+    if (len >= dst_size) {
+        return -1;
+    }
+    memcpy(dst, value, len + 1);
+    return 0;
+}
+
+/**
+ * Parse a "[model ID]" section header.
+ */
+static int parse_section(const char *line, uint32_t *model_id) {
+    const char *p = line + 1;
+    char *end;
+    unsigned long value;
+
+    if (strncmp(p, "model", 5) != 0 || !isspace((unsigned char)p[5])) {
+        return -1;
+    }
+    p += 5;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return -1;
+    }
+
+    errno = 0;
+    value = strtoul(p, &end, 0);
+    if (errno != 0 || value > UINT32_MAX) {
+        return -1;
+    }
+    while (isspace((unsigned char)*end)) {
+        end++;
+    }
+    if (end[0] != ']' || end[1] != '\0') {
+        return -1;
+    }
+
+    *model_id = (uint32_t)value;
+    return 0;
+}
+
+/**
+ * Parse a model ID value (decimal or 0x hex, below MODEL_REGISTRY_NO_MODEL).
+ */
+static int parse_model_id(const char *value, uint32_t *model_id) {
+    char *end;
+    unsigned long id;
+
+    if (!isdigit((unsigned char)value[0])) {
+        return -1;
+    }
+    errno = 0;
+    id = strtoul(value, &end, 0);
+    if (errno != 0 || *end != '\0' || id >= MODEL_REGISTRY_NO_MODEL) {
+        return -1;
+    }
+    *model_id = (uint32_t)id;
+    return 0;
+}
+
+/**
+ * Apply one "key = value" line to model.
+ */
+static int parse_key(model_config_t *model, const char *key, const char *value) {
+    if (strcmp(key, "name") == 0) {
+        return copy_field(model->name, sizeof(model->name), value);
+    }
+    if (strcmp(key, "model") == 0) {
+        return copy_field(model->model_path, sizeof(model->model_path), value);
+    }
+    if (strcmp(key, "clip_l") == 0) {
+        return copy_field(model->clip_l_path, sizeof(model->clip_l_path), value);
+    }
+    if (strcmp(key, "clip_g") == 0) {
+        return copy_field(model->clip_g_path, sizeof(model->clip_g_path), value);
+    }
+    if (strcmp(key, "t5xxl") == 0) {
+        return copy_field(model->t5xxl_path, sizeof(model->t5xxl_path), value);
+    }
+    if (strcmp(key, "t5") == 0) {
+        return parse_bool(value, &model->t5);
+    }
+    if (strcmp(key, "clip_only") == 0) {
+        return parse_model_id(value, &model->clip_only_model);
+    }
+    if (strcmp(key, "vae") == 0) {
+        return copy_field(model->vae_path, sizeof(model->vae_path), value);
+    }
+    if (strcmp(key, "pinned") == 0) {
+        return parse_bool(value, &model->pinned);
+    }
+    if (strcmp(key, "keep_clip_on_cpu") == 0) {
+        return parse_bool(value, &model->keep_clip_on_cpu);
+    }
+    if (strcmp(key, "keep_vae_on_cpu") == 0) {
+        return parse_bool(value, &model->keep_vae_on_cpu);
+    }
+    if (strcmp(key, "flash_attn") == 0) {
+        return parse_bool(value, &model->enable_flash_attn);
+    }
+    if (strcmp(key, "vram_mb") == 0) {
+        char *end;
+        unsigned long mb;
+
+        if (!isdigit((unsigned char)value[0])) {
+            return -1;
+        }
+        errno = 0;
+        mb = strtoul(value, &end, 10);
+        if (errno != 0 || *end != '\0' || mb > MODEL_REGISTRY_MAX_VRAM_MB) {
+            return -1;
+        }
+        model->vram_bytes = (size_t)mb * 1024 * 1024;
+        return 0;
+    }
+    if (strcmp(key, "step_cache") == 0) {
+        char *end;
+        float threshold;
+
+        if (!isdigit((unsigned char)value[0])) {
+            return -1;
+        }
+        errno = 0;
+        threshold = strtof(value, &end);
+        if (errno != 0 || *end != '\0' || !(threshold <= MODEL_REGISTRY_MAX_STEP_CACHE)) {
+            return -1;
+        }
+        model->step_cache = threshold;
+        return 0;
+    }
+
+    return -1;
+}
+
+model_registry_error_t model_registry_parse(const char *text, model_config_t *models,
+                                            size_t max_models, size_t *count,
+                                            unsigned *error_line) {
+    char line_buf[MODEL_REGISTRY_PATH_MAX + 64];
+    model_config_t *current = NULL;
+    unsigned current_line = 0;
+    unsigned line_no = 0;
+    const char *p = text;
+    size_t n = 0;
+
+    if (error_line != NULL) {
+        *error_line = 0;
+    }
+    if (text == NULL || models == NULL || count == NULL) {
+        return MODEL_REGISTRY_ERR_NULL_POINTER;
+    }
+    *count = 0;
+
+    while (*p != '\0') {
+        const char *eol = strchr(p, '\n');
+        size_t len = eol != NULL ? (size_t)(eol - p) : strlen(p);
+        char *line;
+
+        line_no++;
+        if (len >= sizeof(line_buf)) {
+            goto fail;
+        }
+        memcpy(line_buf, p, len);
+        line_buf[len] = '\0';
+        p += len;
+        if (*p == '\n') {
+            p++;
+        }
+
+        line = trim(line_buf);
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        if (line[0] == '[') {
+            uint32_t model_id;
+
+            if (current != NULL && current->model_path[0] == '\0') {
+                line_no = current_line;
+                goto fail;
+            }
+            if (parse_section(line, &model_id) != 0 || n >= max_models) {
+                goto fail;
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (models[i].model_id == model_id) {
+                    goto fail;
+                }
+            }
+
+            current = &models[n++];
+            current_line = line_no;
+            model_config_init(current, model_id);
+            snprintf(current->name, sizeof(current->name), "model-%lu",
+                     (unsigned long)model_id);
+            continue;
+        }
+
+        {
+            char *eq = strchr(line, '=');
+            if (current == NULL || eq == NULL) {
+                goto fail;
+            }
+            *eq = '\0';
+            if (parse_key(current, trim(line), trim(eq + 1)) != 0) {
+                goto fail;
+            }
+        }
+    }
+
+    if (n == 0) {
+        line_no = 0;
+        goto fail;
+    }
+    if (current->model_path[0] == '\0') {
+        line_no = current_line;
+        goto fail;
+    }
+
+    /* CLIP-only models may be declared after the models that name them */
+    line_no = 0;
+    for (size_t i = 0; i < n; i++) {
+        const model_config_t *target = NULL;
+
+        if (models[i].clip_only_model == MODEL_REGISTRY_NO_MODEL) {
+            continue;
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (models[j].model_id == models[i].clip_only_model) {
+                target = &models[j];
+            }
+        }
+        if (target == NULL || target->t5) {
+            goto fail;
+        }
+    }
+
+    *count = n;
+    return MODEL_REGISTRY_OK;
+
+fail:
+    if (error_line != NULL) {
+        *error_line = line_no;
+    }
+    return MODEL_REGISTRY_ERR_PARSE;
+}
+
+model_registry_error_t model_registry_parse_file(const char *path, model_config_t *models,
+                                                 size_t max_models, size_t *count,
+                                                 unsigned *error_line) {
+    model_registry_error_t err;
+    FILE *file;
+    char *text;
+    size_t len;
+
+    if (error_line != NULL) {
+        *error_line = 0;
+    }
+    if (path == NULL || models == NULL || count == NULL) {
+        return MODEL_REGISTRY_ERR_NULL_POINTER;
+    }
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return MODEL_REGISTRY_ERR_IO;
+    }
+
+    text = malloc(MODEL_REGISTRY_MAX_FILE_SIZE + 1);
+    if (text == NULL) {
+        fclose(file);
+        return MODEL_REGISTRY_ERR_OUT_OF_MEMORY;
+    }
+
+    len = fread(text, 1, MODEL_REGISTRY_MAX_FILE_SIZE + 1, file);
+    if (ferror(file) || len > MODEL_REGISTRY_MAX_FILE_SIZE) {
+        free(text);
+        fclose(file);
+        return MODEL_REGISTRY_ERR_IO;
+    }
+    fclose(file);
+    text[len] = '\0';
+
+    if (memchr(text, '\0', len) != NULL) {
+        free(text);
+        return MODEL_REGISTRY_ERR_PARSE;
+    }
+
+    err = model_registry_parse(text, models, max_models, count, error_line);
+    free(text);
+    return err;
+}
+
+/**
+ * Size of a file in bytes, 0 if path is empty or cannot be stat()ed.
+ */
+static size_t file_size(const char *path) {
+    struct stat st;
+
+    if (path[0] == '\0' || stat(path, &st) != 0 || st.st_size < 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+/**
+ * Estimate VRAM use from the files that are uploaded to the GPU.
+ */
+static size_t estimate_vram(const model_config_t *model) {
+    size_t total = file_size(model->model_path);
+
+    if (!model->keep_clip_on_cpu) {
+        total += file_size(model->clip_l_path);
+        total += file_size(model->clip_g_path);
+        if (model->t5) {
+            total += file_size(model->t5xxl_path);
+        }
+    }
+    if (!model->keep_vae_on_cpu) {
+        total += file_size(model->vae_path);
+    }
+
+    return total;
+}
+
+model_registry_t *model_registry_create(const model_config_t *models, size_t count,
+                                        size_t vram_budget, const model_loader_t *loader) {
+    model_registry_t *registry;
+
+    if (models == NULL || loader == NULL || loader->load == NULL || loader->unload == NULL ||
+        count == 0 || count > MODEL_REGISTRY_MAX_MODELS) {
+        return NULL;
+    }
+
+    registry = calloc(1, sizeof(*registry));
+    if (registry == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        registry->entries[i].config = models[i];
+        if (registry->entries[i].config.vram_bytes == 0) {
+            registry->entries[i].config.vram_bytes = estimate_vram(&models[i]);
+        }
+    }
+    registry->count = count;
+    registry->vram_budget = vram_budget;
+    registry->loader = *loader;
+
+    return registry;
+}
+
+/**
+ * Unload an entry and update the counters.
+ */
+static void unload_entry(model_registry_t *registry, registry_entry_t *entry) {
+    registry->loader.unload(entry->handle, &entry->config, registry->loader.user_data);
+    entry->handle = NULL;
+    registry->stats.loaded--;
+    registry->stats.vram_bytes -= entry->config.vram_bytes;
+}
+
+void model_registry_destroy(model_registry_t *registry) {
+    if (registry == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < registry->count; i++) {
+        if (registry->entries[i].handle != NULL) {
+            unload_entry(registry, &registry->entries[i]);
+        }
+    }
+
+    free(registry);
+}
+
+/**
+ * Find the entry for model_id.
+ */
+static registry_entry_t *find_entry(const model_registry_t *registry, uint32_t model_id) {
+    for (size_t i = 0; i < registry->count; i++) {
+        if (registry->entries[i].config.model_id == model_id) {
+            return (registry_entry_t *)&registry->entries[i];
+        }
+    }
+    return NULL;
+}
+
+const model_config_t *model_registry_find(const model_registry_t *registry, uint32_t model_id) {
+    registry_entry_t *entry;
+
+    if (registry == NULL) {
+        return NULL;
+    }
+
+    entry = find_entry(registry, model_id);
+    return entry != NULL ? &entry->config : NULL;
+}
+
+/**
+ * Make room for target under the budget, then load it.
+ */
+static model_registry_error_t load_entry(model_registry_t *registry, registry_entry_t *target) {
+    size_t need = target->config.vram_bytes;
+
+    if (registry->vram_budget > 0) {
+        size_t evictable = 0;
+
+        for (size_t i = 0; i < registry->count; i++) {
+            const registry_entry_t *entry = &registry->entries[i];
+            if (entry->handle != NULL && !entry->config.pinned) {
+                evictable += entry->config.vram_bytes;
+            }
+        }
+
+        /* Check before evicting, so a hopeless load leaves everything loaded */
+        if (need > registry->vram_budget ||
+            registry->stats.vram_bytes - evictable > registry->vram_budget - need) {
+            return MODEL_REGISTRY_ERR_NO_VRAM;
+        }
+
+        while (registry->stats.vram_bytes > registry->vram_budget - need) {
+            registry_entry_t *victim = NULL;
+
+            for (size_t i = 0; i < registry->count; i++) {
+                registry_entry_t *entry = &registry->entries[i];
+                if (entry->handle != NULL && !entry->config.pinned &&
+                    (victim == NULL || entry->last_used < victim->last_used)) {
+                    victim = entry;
+                }
+            }
+
+            unload_entry(registry, victim);
+            registry->stats.evictions++;
+        }
+    }
+
+    target->handle = registry->loader.load(&target->config, registry->loader.user_data);
+    if (target->handle == NULL) {
+        registry->stats.load_failures++;
+        return MODEL_REGISTRY_ERR_LOAD_FAILED;
+    }
+
+    registry->stats.loads++;
+    registry->stats.loaded++;
+    registry->stats.vram_bytes += need;
+    return MODEL_REGISTRY_OK;
+}
+
+model_registry_error_t model_registry_load_pinned(model_registry_t *registry) {
+    if (registry == NULL) {
+        return MODEL_REGISTRY_ERR_NULL_POINTER;
+    }
+
+    for (size_t i = 0; i < registry->count; i++) {
+        registry_entry_t *entry = &registry->entries[i];
+        if (entry->config.pinned && entry->handle == NULL) {
+            model_registry_error_t err = load_entry(registry, entry);
+            if (err != MODEL_REGISTRY_OK) {
+                return err;
+            }
+            entry->last_used = ++registry->clock;
+        }
+    }
+
+    return MODEL_REGISTRY_OK;
+}
+
+model_registry_error_t model_registry_acquire(model_registry_t *registry, uint32_t model_id,
+                                              void **handle) {
+    registry_entry_t *entry;
+
+    if (registry == NULL || handle == NULL) {
+        return MODEL_REGISTRY_ERR_NULL_POINTER;
+    }
+
+    entry = find_entry(registry, model_id);
+    if (entry == NULL) {
+        return MODEL_REGISTRY_ERR_NOT_FOUND;
+    }
+
+    if (entry->handle != NULL) {
+        registry->stats.hits++;
+    } else {
+        model_registry_error_t err = load_entry(registry, entry);
+        if (err != MODEL_REGISTRY_OK) {
+            return err;
+        }
+    }
+
+    entry->last_used = ++registry->clock;
+    *handle = entry->handle;
+    return MODEL_REGISTRY_OK;
+}
+
+model_registry_error_t model_registry_get_stats(const model_registry_t *registry,
+                                                model_registry_stats_t *stats) {
+    if (registry == NULL || stats == NULL) {
+        return MODEL_REGISTRY_ERR_NULL_POINTER;
+    }
+
+    *stats = registry->stats;
+    return MODEL_REGISTRY_OK;
+}
+
+const char *model_registry_error_string(model_registry_error_t err) {
+    switch (err) {
+        case MODEL_REGISTRY_OK:
+            return "success";
+        case MODEL_REGISTRY_ERR_NULL_POINTER:
+            return "null pointer argument";
+        case MODEL_REGISTRY_ERR_OUT_OF_MEMORY:
+            return "memory allocation failed";
+        case MODEL_REGISTRY_ERR_NOT_FOUND:
+            return "model not configured";
+        case MODEL_REGISTRY_ERR_NO_VRAM:
+            return "model does not fit the VRAM budget";
+        case MODEL_REGISTRY_ERR_LOAD_FAILED:
+            return "model load failed";
+        case MODEL_REGISTRY_ERR_IO:
+            return "cannot read model config";
+        case MODEL_REGISTRY_ERR_PARSE:
+            return "invalid model config";
+        default:
+            return "unknown error";
+    }
+}
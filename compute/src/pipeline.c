@@ -0,0 +1,207 @@
+/**
+ * Weave Pipeline Module - Implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/pipeline.h"
+
+/**
+ * prepare_thread - Stage between the submitter and the GPU workers
+ *
+ * Runs ops.prepare on each job while the workers generate earlier ones.
+ * Jobs it answers go straight to the writer; the rest wait in the generate
+ * queue for a device, by priority.
+ */
+static void *prepare_thread(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    void *job;
+
+    while (work_queue_pop(&pipeline->requests, &job) == QUEUE_OK) {
+        work_queue_t *next = &pipeline->responses;
+        unsigned priority = 0;
+
+        if (pipeline->ops.prepare(job, &priority, pipeline->user_data)) {
+            next = &pipeline->generate;
+        } else {
+            /* Answers are written in the order they are ready */
+            priority = 0;
+        }
+
+        if (work_queue_push_priority(next, job, priority) != QUEUE_OK) {
+            pipeline->ops.release(job, pipeline->user_data);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * worker_thread - Stage that generates queued jobs on one device
+ */
+static void *worker_thread(void *arg) {
+    pipeline_worker_t *worker = (pipeline_worker_t *)arg;
+    pipeline_t *pipeline = worker->pipeline;
+    void *job;
+
+    while (work_queue_pop(&pipeline->generate, &job) == QUEUE_OK) {
+        pipeline->ops.generate(job, worker->device, pipeline->user_data);
+
+        if (work_queue_push(&pipeline->responses, job) != QUEUE_OK) {
+            pipeline->ops.release(job, pipeline->user_data);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * writer_thread - Stage that answers finished jobs in completion order
+ */
+static void *writer_thread(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    void *job;
+
+    while (work_queue_pop(&pipeline->responses, &job) == QUEUE_OK) {
+        pipeline->ops.respond(job, pipeline->user_data);
+        pipeline->ops.release(job, pipeline->user_data);
+    }
+
+    return NULL;
+}
+
+/**
+ * join_workers - Wait for the GPU workers, then let the writer drain
+ *
+ * @param pipeline  Pipeline whose generate queue is already closed
+ */
+static void join_workers(pipeline_t *pipeline) {
+    for (int i = 0; i < pipeline->worker_count; i++) {
+        pthread_join(pipeline->workers[i].thread, NULL);
+    }
+    pipeline->worker_count = 0;
+
+    /* Nothing feeds the writer any more */
+    work_queue_close(&pipeline->responses);
+}
+
+/**
+ * destroy_queues - Free the queues of a pipeline with no threads left
+ */
+static void destroy_queues(pipeline_t *pipeline) {
+    work_queue_destroy(&pipeline->responses);
+    work_queue_destroy(&pipeline->generate);
+    work_queue_destroy(&pipeline->requests);
+}
+
+pipeline_error_t pipeline_start(pipeline_t *pipeline, const pipeline_ops_t *ops,
+                                void *const *devices, int device_count, void *user_data) {
+    int thread_err;
+
+    if (pipeline == NULL || ops == NULL || devices == NULL || ops->prepare == NULL ||
+        ops->generate == NULL || ops->respond == NULL || ops->release == NULL) {
+        return PIPELINE_ERR_NULL_POINTER;
+    }
+    if (device_count < 1 || device_count > PIPELINE_MAX_WORKERS) {
+        return PIPELINE_ERR_INVALID_ARG;
+    }
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->ops = *ops;
+    pipeline->user_data = user_data;
+
+    if (work_queue_init(&pipeline->requests, PIPELINE_REQUEST_QUEUE_DEPTH) != QUEUE_OK) {
+        return PIPELINE_ERR_INIT_FAILED;
+    }
+
+    if (work_queue_init(&pipeline->generate, PIPELINE_GENERATE_QUEUE_DEPTH) != QUEUE_OK) {
+        work_queue_destroy(&pipeline->requests);
+        return PIPELINE_ERR_INIT_FAILED;
+    }
+
+    if (work_queue_init(&pipeline->responses, PIPELINE_RESPONSE_QUEUE_DEPTH) != QUEUE_OK) {
+        work_queue_destroy(&pipeline->generate);
+        work_queue_destroy(&pipeline->requests);
+        return PIPELINE_ERR_INIT_FAILED;
+    }
+
+    thread_err = pthread_create(&pipeline->writer, NULL, writer_thread, pipeline);
+    if (thread_err != 0) {
+        fprintf(stderr, "failed to start writer thread: %s\n", strerror(thread_err));
+        destroy_queues(pipeline);
+        return PIPELINE_ERR_INIT_FAILED;
+    }
+
+    thread_err = pthread_create(&pipeline->preparer, NULL, prepare_thread, pipeline);
+    if (thread_err != 0) {
+        fprintf(stderr, "failed to start prepare thread: %s\n", strerror(thread_err));
+        work_queue_close(&pipeline->responses);
+        pthread_join(pipeline->writer, NULL);
+        destroy_queues(pipeline);
+        return PIPELINE_ERR_INIT_FAILED;
+    }
+
+    for (int i = 0; i < device_count; i++) {
+        pipeline_worker_t *worker = &pipeline->workers[i];
+
+        worker->pipeline = pipeline;
+        worker->device = devices[i];
+        thread_err = pthread_create(&worker->thread, NULL, worker_thread, worker);
+        if (thread_err != 0) {
+            fprintf(stderr, "failed to start GPU worker thread: %s\n", strerror(thread_err));
+            work_queue_close(&pipeline->requests);
+            pthread_join(pipeline->preparer, NULL);
+            work_queue_close(&pipeline->generate);
+            join_workers(pipeline);
+            pthread_join(pipeline->writer, NULL);
+            destroy_queues(pipeline);
+            return PIPELINE_ERR_INIT_FAILED;
+        }
+        pipeline->worker_count++;
+    }
+
+    return PIPELINE_OK;
+}
+
+pipeline_error_t pipeline_submit(pipeline_t *pipeline, void *job) {
+    if (pipeline == NULL) {
+        return PIPELINE_ERR_NULL_POINTER;
+    }
+    if (work_queue_push(&pipeline->requests, job) != QUEUE_OK) {
+        return PIPELINE_ERR_CLOSED;
+    }
+    return PIPELINE_OK;
+}
+
+void pipeline_stop(pipeline_t *pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+
+    /* Each stage finishes before the queue after it is closed */
+    work_queue_close(&pipeline->requests);
+    pthread_join(pipeline->preparer, NULL);
+    work_queue_close(&pipeline->generate);
+    join_workers(pipeline);
+    pthread_join(pipeline->writer, NULL);
+
+    destroy_queues(pipeline);
+}
+
+const char *pipeline_error_string(pipeline_error_t err) {
+    switch (err) {
+    case PIPELINE_OK:
+        return "success";
+    case PIPELINE_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case PIPELINE_ERR_INVALID_ARG:
+        return "invalid argument";
+    case PIPELINE_ERR_INIT_FAILED:
+        return "failed to start pipeline";
+    case PIPELINE_ERR_CLOSED:
+        return "pipeline closed";
+    default:
+        return "unknown error";
+    }
+}
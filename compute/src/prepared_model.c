@@ -0,0 +1,278 @@
+/**
+ * Weave Prepared Model Module - Implementation
+ *
+ * Manifest layout (text, one field per line):
+ *   weave-prepared-model 1
+ *   source_size <bytes>
+ *   source_mtime <seconds> <nanoseconds>
+ *   source_sample <16 hex digits>
+ *   prepared_size <bytes>
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "weave/prepared_model.h"
+
+#define MANIFEST_VERSION 1u
+
+/** Longest path built here: prepared path plus the manifest temporary suffix */
+#define PREPARED_PATH_MAX 4096
+
+/**
+ * fnv1a_64_update - Continue a 64-bit FNV-1a hash
+ */
+static uint64_t fnv1a_64_update(uint64_t hash, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * hash_range - Hash len bytes of file starting at offset
+ *
+ * @return 0 on success, -1 on read failure
+ */
+static int hash_range(FILE *file, uint8_t *buffer, uint64_t offset, size_t len,
+                      uint64_t *hash) {
+    if (fseeko(file, (off_t)offset, SEEK_SET) != 0) {
+        return -1;
+    }
+    if (fread(buffer, 1, len, file) != len) {
+        return -1;
+    }
+    *hash = fnv1a_64_update(*hash, buffer, len);
+    return 0;
+}
+
+prepared_model_error_t prepared_model_path(const char *base, const char *suffix,
+                                           char *out, size_t out_size) {
+    int written;
+
+    if (base == NULL || suffix == NULL || out == NULL) {
+        return PREPARED_MODEL_ERR_NULL_POINTER;
+    }
+
+    written = snprintf(out, out_size, "%s%s", base, suffix);
+    if (written < 0 || (size_t)written >= out_size) {
+        return PREPARED_MODEL_ERR_PATH_TOO_LONG;
+    }
+    return PREPARED_MODEL_OK;
+}
+
+prepared_model_error_t prepared_model_fingerprint(const char *path,
+                                                  prepared_model_fingerprint_t *fp) {
+    struct stat st;
+    FILE *file;
+    uint8_t *buffer;
+    uint64_t size;
+    size_t head;
+    size_t tail;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int rc;
+
+    if (path == NULL || fp == NULL) {
+        return PREPARED_MODEL_ERR_NULL_POINTER;
+    }
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        return PREPARED_MODEL_ERR_IO;
+    }
+    if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fclose(file);
+        return PREPARED_MODEL_ERR_IO;
+    }
+
+    size = (uint64_t)st.st_size;
+    head = size < PREPARED_MODEL_SAMPLE_BYTES ? (size_t)size : PREPARED_MODEL_SAMPLE_BYTES;
+    tail = size - head < PREPARED_MODEL_SAMPLE_BYTES ? (size_t)(size - head)
+                                                     : PREPARED_MODEL_SAMPLE_BYTES;
+
+    buffer = malloc(PREPARED_MODEL_SAMPLE_BYTES);
+    if (buffer == NULL) {
+        fclose(file);
+        return PREPARED_MODEL_ERR_IO;
+    }
+
+    rc = hash_range(file, buffer, 0, head, &hash);
+    if (rc == 0 && tail > 0) {
+        rc = hash_range(file, buffer, size - tail, tail, &hash);
+    }
+
+    free(buffer);
+    fclose(file);
+    if (rc != 0) {
+        return PREPARED_MODEL_ERR_IO;
+    }
+
+    fp->size = size;
+    fp->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    fp->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    fp->sample_hash = hash;
+    return PREPARED_MODEL_OK;
+}
+
+/**
+ * read_manifest - Parse a manifest
+ *
+ * @return PREPARED_MODEL_OK, PREPARED_MODEL_ERR_NOT_FOUND if missing, or
+ *         PREPARED_MODEL_ERR_STALE if malformed or from another version
+ */
+static prepared_model_error_t read_manifest(const char *path, prepared_model_fingerprint_t *fp,
+                                            uint64_t *prepared_size) {
+    FILE *file;
+    unsigned version;
+    int fields;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return PREPARED_MODEL_ERR_NOT_FOUND;
+    }
+
+    fields = fscanf(file,
+                    "weave-prepared-model %u\n"
+                    "source_size %" SCNu64 "\n"
+                    "source_mtime %" SCNd64 " %" SCNd64 "\n"
+                    "source_sample %" SCNx64 "\n"
+                    "prepared_size %" SCNu64,
+                    &version, &fp->size, &fp->mtime_sec, &fp->mtime_nsec,
+                    &fp->sample_hash, prepared_size);
+    fclose(file);
+
+    if (fields != 6 || version != MANIFEST_VERSION) {
+        return PREPARED_MODEL_ERR_STALE;
+    }
+    return PREPARED_MODEL_OK;
+}
+
+prepared_model_error_t prepared_model_check(const char *source, const char *prepared) {
+    char manifest_path[PREPARED_PATH_MAX];
+    prepared_model_fingerprint_t current;
+    prepared_model_fingerprint_t recorded;
+    uint64_t prepared_size;
+    struct stat st;
+    prepared_model_error_t err;
+
+    if (source == NULL || prepared == NULL) {
+        return PREPARED_MODEL_ERR_NULL_POINTER;
+    }
+
+    err = prepared_model_path(prepared, PREPARED_MODEL_MANIFEST_SUFFIX,
+                              manifest_path, sizeof(manifest_path));
+    if (err != PREPARED_MODEL_OK) {
+        return err;
+    }
+
+    if (stat(prepared, &st) != 0) {
+        return PREPARED_MODEL_ERR_NOT_FOUND;
+    }
+
+    err = read_manifest(manifest_path, &recorded, &prepared_size);
+    if (err != PREPARED_MODEL_OK) {
+        return err;
+    }
+
+    err = prepared_model_fingerprint(source, &current);
+    if (err != PREPARED_MODEL_OK) {
+        return err;
+    }
+
+    if (current.size != recorded.size ||
+        current.mtime_sec != recorded.mtime_sec ||
+        current.mtime_nsec != recorded.mtime_nsec ||
+        current.sample_hash != recorded.sample_hash ||
+        (uint64_t)st.st_size != prepared_size) {
+        return PREPARED_MODEL_ERR_STALE;
+    }
+    return PREPARED_MODEL_OK;
+}
+
+prepared_model_error_t prepared_model_commit(const prepared_model_fingerprint_t *source_fp,
+                                             const char *tmp, const char *prepared) {
+    char manifest_path[PREPARED_PATH_MAX];
+    char manifest_tmp[PREPARED_PATH_MAX];
+    struct stat st;
+    FILE *file;
+    int ok;
+
+    if (source_fp == NULL || tmp == NULL || prepared == NULL) {
+        return PREPARED_MODEL_ERR_NULL_POINTER;
+    }
+
+    if (prepared_model_path(prepared, PREPARED_MODEL_MANIFEST_SUFFIX,
+                            manifest_path, sizeof(manifest_path)) != PREPARED_MODEL_OK ||
+        prepared_model_path(manifest_path, PREPARED_MODEL_TMP_SUFFIX,
+                            manifest_tmp, sizeof(manifest_tmp)) != PREPARED_MODEL_OK) {
+        unlink(tmp);
+        return PREPARED_MODEL_ERR_PATH_TOO_LONG;
+    }
+
+    if (stat(tmp, &st) != 0) {
+        return PREPARED_MODEL_ERR_IO;
+    }
+
+    /* An old manifest must never describe the new file, even briefly */
+    if (unlink(manifest_path) != 0 && errno != ENOENT) {
+        unlink(tmp);
+        return PREPARED_MODEL_ERR_IO;
+    }
+
+    file = fopen(manifest_tmp, "w");
+    if (file == NULL) {
+        unlink(tmp);
+        return PREPARED_MODEL_ERR_IO;
+    }
+    ok = fprintf(file,
+                 "weave-prepared-model %u\n"
+                 "source_size %" PRIu64 "\n"
+                 "source_mtime %" PRId64 " %" PRId64 "\n"
+                 "source_sample %016" PRIx64 "\n"
+                 "prepared_size %" PRIu64 "\n",
+                 MANIFEST_VERSION, source_fp->size, source_fp->mtime_sec,
+                 source_fp->mtime_nsec, source_fp->sample_hash,
+                 (uint64_t)st.st_size) > 0;
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tmp, prepared) != 0) {
+        unlink(manifest_tmp);
+        unlink(tmp);
+        return PREPARED_MODEL_ERR_IO;
+    }
+    if (rename(manifest_tmp, manifest_path) != 0) {
+        unlink(manifest_tmp);
+        unlink(prepared);
+        return PREPARED_MODEL_ERR_IO;
+    }
+    return PREPARED_MODEL_OK;
+}
+
+const char *prepared_model_error_string(prepared_model_error_t err) {
+    switch (err) {
+    case PREPARED_MODEL_OK:
+        return "success";
+    case PREPARED_MODEL_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case PREPARED_MODEL_ERR_PATH_TOO_LONG:
+        return "path too long";
+    case PREPARED_MODEL_ERR_IO:
+        return "I/O error";
+    case PREPARED_MODEL_ERR_NOT_FOUND:
+        return "prepared model not found";
+    case PREPARED_MODEL_ERR_STALE:
+        return "prepared model does not match its source";
+    default:
+        return "unknown error";
+    }
+}
@@ -10,7 +10,7 @@
  * - All input validated before use
  * - No undefined behavior
  *
- * Protocol version: 1
+ * Protocol versions: 1, 2
  * Specification: docs/protocol/SPEC.md, docs/protocol/SPEC_SD35.md
  */
 
@@ -81,17 +81,38 @@ static inline void write_u64_be(uint8_t *buf, uint64_t value) {
     buf[7] = value & 0xFF;
 }
 
+/** Fixed payload bytes ahead of the prompt data in a generation request */
+#define GENERATE_REQUEST_FIXED_SIZE (12 + 48)
+
+/** Fixed payload bytes ahead of the seed table in a batch request */
+#define BATCH_REQUEST_FIXED_SIZE (12 + 44)
+
+/** Fixed payload bytes ahead of the prompt data in a prepare request */
+#define PREPARE_REQUEST_FIXED_SIZE (12 + 32)
+
+/* PROTOCOL_FLAG_SAMPLING block: sampler, scheduler */
+#define SAMPLING_BLOCK_SIZE 8
+
 /**
- * decode_protocol_header - Decode and validate common protocol header
+ * decode_header - Decode and validate the common protocol header
  *
- * @param data      Input buffer (must be at least 16 bytes)
+ * Checks everything that does not depend on the message type: magic,
+ * version and payload length. The header is filled in even on failure, so
+ * a reader can still skip the payload of a message it rejects.
+ *
+ * @param data      Input buffer (at least 16 bytes)
  * @param data_len  Size of input buffer
  * @param header    Output header structure
  * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INVALID_MAGIC: Magic number mismatch
+ * - ERR_UNSUPPORTED_VERSION: Protocol version not supported
+ * - ERR_INTERNAL: NULL pointer, short buffer, or payload over MAX_MESSAGE_SIZE
  */
-static error_code_t decode_protocol_header(const uint8_t *data, size_t data_len,
-                                           protocol_header_t *header) {
-    if (data_len < 16) {
+error_code_t decode_header(const uint8_t *data, size_t data_len,
+                           protocol_header_t *header) {
+    if (data == NULL || header == NULL || data_len < 16) {
         return ERR_INTERNAL;
     }
 
@@ -99,7 +120,7 @@ static error_code_t decode_protocol_header(const uint8_t *data, size_t data_len,
     header->version = read_u16_be(data + 4);
     header->msg_type = read_u16_be(data + 6);
     header->payload_len = read_u32_be(data + 8);
-    header->reserved = read_u32_be(data + 12);
+    header->flags = read_u32_be(data + 12);
 
     if (header->magic != PROTOCOL_MAGIC) {
         return ERR_INVALID_MAGIC;
@@ -110,10 +131,6 @@ static error_code_t decode_protocol_header(const uint8_t *data, size_t data_len,
         return ERR_UNSUPPORTED_VERSION;
     }
 
-    if (header->msg_type != MSG_GENERATE_REQUEST) {
-        return ERR_INTERNAL;
-    }
-
     if (header->payload_len > MAX_MESSAGE_SIZE - 16) {
         return ERR_INTERNAL;
     }
@@ -122,114 +139,41 @@ static error_code_t decode_protocol_header(const uint8_t *data, size_t data_len,
 }
 
 /**
- * decode_generate_request - Decode and validate SD 3.5 generation request
- *
- * This function parses a complete binary protocol message containing a
- * generation request. It validates all fields according to the protocol
- * specification and returns appropriate error codes for invalid input.
- *
- * Message structure:
- * - Common header (16 bytes)
- * - Request ID (8 bytes)
- * - Model ID (4 bytes)
- * - SD 3.5 parameters (48 bytes)
- * - Prompt data (variable)
+ * decode_message_header - Decode the header of a complete message
  *
- * @param data      Input buffer containing complete message
- * @param data_len  Size of input buffer (must include header + payload)
- * @param req       Output request structure (populated on success)
- * @return          ERR_NONE on success, error code on failure
- *
- * Error codes:
- * - ERR_INVALID_MAGIC: Magic number mismatch
- * - ERR_UNSUPPORTED_VERSION: Protocol version not supported
- * - ERR_INVALID_MODEL_ID: model_id is not 0 (SD 3.5)
- * - ERR_INVALID_DIMENSIONS: width/height out of range or not aligned
- * - ERR_INVALID_STEPS: steps out of range
- * - ERR_INVALID_CFG: cfg_scale out of range, NaN, or Inf
- * - ERR_INVALID_PROMPT: prompt offset/length out of bounds
- * - ERR_INTERNAL: Truncated message or other structural error
+ * @param data           Complete message (header + payload)
+ * @param data_len       Size of data
+ * @param header         Output header structure
+ * @return               ERR_NONE if the header is valid and the whole
+ *                       payload is in data, error code otherwise
  */
-error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
-                                     sd35_generate_request_t *req) {
-    if (data == NULL || req == NULL) {
-        return ERR_INTERNAL;
-    }
-
-    if (data_len < 16) {
-        return ERR_INTERNAL;
-    }
-
-    protocol_header_t header;
-    error_code_t err = decode_protocol_header(data, data_len, &header);
+static error_code_t decode_message_header(const uint8_t *data, size_t data_len,
+                                          protocol_header_t *header) {
+    error_code_t err = decode_header(data, data_len, header);
     if (err != ERR_NONE) {
         return err;
     }
 
-    if (data_len < 16 + header.payload_len) {
-        return ERR_INTERNAL;
-    }
-
-    if (header.payload_len < 12 + 48) {
-        return ERR_INTERNAL;
-    }
-
-    const uint8_t *ptr = data + 16;
-    size_t remaining = header.payload_len;
-
-    req->request_id = read_u64_be(ptr);
-    ptr += 8;
-    remaining -= 8;
-
-    req->model_id = read_u32_be(ptr);
-    ptr += 4;
-    remaining -= 4;
-
-    if (req->model_id != MODEL_ID_SD35) {
-        return ERR_INVALID_MODEL_ID;
-    }
-
-    if (remaining < 48) {
+    if (data_len < 16 + (size_t)header->payload_len) {
         return ERR_INTERNAL;
     }
 
-    req->width = read_u32_be(ptr);
-    ptr += 4;
-
-    req->height = read_u32_be(ptr);
-    ptr += 4;
-
-    req->steps = read_u32_be(ptr);
-    ptr += 4;
-
-    req->cfg_scale = read_f32_be(ptr);
-    ptr += 4;
-
-    req->seed = read_u64_be(ptr);
-    ptr += 8;
-
-    req->clip_l_offset = read_u32_be(ptr);
-    ptr += 4;
-
-    req->clip_l_length = read_u32_be(ptr);
-    ptr += 4;
-
-    req->clip_g_offset = read_u32_be(ptr);
-    ptr += 4;
-
-    req->clip_g_length = read_u32_be(ptr);
-    ptr += 4;
-
-    req->t5_offset = read_u32_be(ptr);
-    ptr += 4;
-
-    req->t5_length = read_u32_be(ptr);
-    ptr += 4;
-
-    remaining -= 48;
+    return ERR_NONE;
+}
 
-    req->prompt_data = ptr;
-    req->prompt_data_len = remaining;
+/**
+ * validate_sd35_request - Validate decoded SD 3.5 generation parameters
+ *
+ * Shared by the single and batch request decoders. Expects prompt_data and
+ * prompt_data_len to be set.
+ *
+ * @param req    Decoded request
+ * @param flags  Header flags (PROTOCOL_FLAG_CLIP_ONLY allows an empty T5 prompt)
+ * @return       ERR_NONE if valid, error code otherwise
+ */
+static error_code_t validate_sd35_request(const sd35_generate_request_t *req,
+                                          uint32_t flags) {
+    uint32_t min_t5_length = (flags & PROTOCOL_FLAG_CLIP_ONLY) != 0 ? 0 : SD35_MIN_PROMPT_LENGTH;
 
     if (req->width < SD35_MIN_DIMENSION || req->width > SD35_MAX_DIMENSION ||
         req->width % SD35_DIMENSION_ALIGNMENT != 0) {
@@ -250,6 +194,30 @@ error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
         return ERR_INVALID_CFG;
     }
 
+    if (req->sampler >= SD35_SAMPLER_COUNT || req->scheduler >= SD35_SCHEDULER_COUNT) {
+        return ERR_INVALID_SAMPLER;
+    }
+
+    if (req->priority >= SD35_PRIORITY_COUNT) {
+        return ERR_INVALID_PRIORITY;
+    }
+
+    if (req->init_source != SD35_INIT_NONE) {
+        if (!(req->strength > 0.0f && req->strength <= 1.0f)) {
+            return ERR_INVALID_INIT_IMAGE;
+        }
+        if (req->init_source == SD35_INIT_INLINE &&
+            req->init_data_len != (size_t)req->width * req->height * 3) {
+            return ERR_INVALID_INIT_IMAGE;
+        }
+        if (req->init_source == SD35_INIT_RETAINED && req->init_data_len != 0) {
+            return ERR_INVALID_INIT_IMAGE;
+        }
+        if (req->init_source != SD35_INIT_INLINE && req->init_source != SD35_INIT_RETAINED) {
+            return ERR_INVALID_INIT_IMAGE;
+        }
+    }
+
     if (req->clip_l_length < SD35_MIN_PROMPT_LENGTH ||
         req->clip_l_length > SD35_MAX_PROMPT_LENGTH) {
         return ERR_INVALID_PROMPT;
@@ -260,7 +228,7 @@ error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
         return ERR_INVALID_PROMPT;
     }
 
-    if (req->t5_length < SD35_MIN_PROMPT_LENGTH ||
+    if (req->t5_length < min_t5_length ||
         req->t5_length > SD35_MAX_PROMPT_LENGTH) {
         return ERR_INVALID_PROMPT;
     }
@@ -293,116 +261,1370 @@ error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
 }
 
 /**
- * encode_generate_response - Encode SD 3.5 generation response
+ * decode_sampling - Read the PROTOCOL_FLAG_SAMPLING block, if present
  *
- * This function encodes a successful generation response into the binary
- * protocol format. The response contains the generated image data in raw
- * RGB format.
+ * Without the flag the request uses the model's defaults. With it, *ptr and
+ * *remaining are advanced past the block.
  *
- * Message structure:
- * - Common header (16 bytes)
- * - Common response fields: request_id (8), status (4), generation_time_ms (4)
- * - Image metadata: width (4), height (4), channels (4), image_data_len (4)
- * - Raw image data (width * height * channels bytes)
+ * @param header     Request header (flags)
+ * @param ptr        In/out: position of the block in the payload
+ * @param remaining  In/out: payload bytes from *ptr on
+ * @param req        Request to fill in sampler and scheduler
+ * @return           ERR_NONE, or ERR_INTERNAL if the block is truncated
+ */
+static error_code_t decode_sampling(const protocol_header_t *header, const uint8_t **ptr,
+                                    size_t *remaining, sd35_generate_request_t *req) {
+    req->sampler = SD35_SAMPLER_DEFAULT;
+    req->scheduler = SD35_SCHEDULER_DEFAULT;
+
+    if ((header->flags & PROTOCOL_FLAG_SAMPLING) == 0) {
+        return ERR_NONE;
+    }
+    if (*remaining < SAMPLING_BLOCK_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    req->sampler = read_u32_be(*ptr);
+    req->scheduler = read_u32_be(*ptr + 4);
+    *ptr += SAMPLING_BLOCK_SIZE;
+    *remaining -= SAMPLING_BLOCK_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * decode_init_image - Read the PROTOCOL_FLAG_INIT_IMAGE block, if present
  *
- * @param resp      Response structure to encode
- * @param buffer    Output buffer for encoded message
- * @param buf_size  Size of output buffer in bytes
- * @param out_len   Pointer to store actual encoded length (bytes written)
- * @return          ERR_NONE on success, error code on failure
+ * Inline pixels are left in place; req->init_data points at them. The
+ * values are checked by validate_sd35_request().
  *
- * Error codes:
- * - ERR_INTERNAL: NULL pointer, invalid parameters, or buffer too small
- * - ERR_INVALID_DIMENSIONS: Image dimensions invalid or mismatched with data_len
+ * @param header     Request header (flags)
+ * @param ptr        In/out: position of the block in the payload
+ * @param remaining  In/out: payload bytes from *ptr on
+ * @param req        Request to fill in the init image fields
+ * @return           ERR_NONE, ERR_INTERNAL if the block is truncated, or
+ *                   ERR_INVALID_INIT_IMAGE if the flag is set with source none
+ */
+static error_code_t decode_init_image(const protocol_header_t *header, const uint8_t **ptr,
+                                      size_t *remaining, sd35_generate_request_t *req) {
+    uint32_t data_len;
+
+    req->init_source = SD35_INIT_NONE;
+    req->strength = 0.0f;
+    req->init_request_id = 0;
+    req->init_index = 0;
+    req->init_data = NULL;
+    req->init_data_len = 0;
+
+    if ((header->flags & PROTOCOL_FLAG_INIT_IMAGE) == 0) {
+        return ERR_NONE;
+    }
+    if (*remaining < SD35_INIT_IMAGE_BLOCK_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    req->strength = read_f32_be(*ptr);
+    req->init_source = read_u32_be(*ptr + 4);
+    req->init_request_id = read_u64_be(*ptr + 8);
+    req->init_index = read_u32_be(*ptr + 16);
+    data_len = read_u32_be(*ptr + 20);
+    *ptr += SD35_INIT_IMAGE_BLOCK_SIZE;
+    *remaining -= SD35_INIT_IMAGE_BLOCK_SIZE;
+
+    if (data_len > *remaining) {
+        return ERR_INTERNAL;
+    }
+    if (req->init_source == SD35_INIT_NONE) {
+        return ERR_INVALID_INIT_IMAGE;
+    }
+    req->init_data = data_len > 0 ? *ptr : NULL;
+    req->init_data_len = data_len;
+    *ptr += data_len;
+    *remaining -= data_len;
+    return ERR_NONE;
+}
+
+/**
+ * decode_scheduling - Read the PROTOCOL_FLAG_SCHEDULING block, if present
  *
- * Validation performed:
- * - Width/height: 64-2048, multiple of 64
- * - Channels: 3 (RGB) or 4 (RGBA)
- * - image_data_len matches width * height * channels
- * - Buffer has enough space for complete message
- * - No integer overflow in size calculations
+ * Without the flag the request is interactive with the default deadline.
+ * With it, *ptr and *remaining are advanced past the block. The priority is
+ * checked by validate_sd35_request().
+ *
+ * @param header     Request header (flags)
+ * @param ptr        In/out: position of the block in the payload
+ * @param remaining  In/out: payload bytes from *ptr on
+ * @param req        Request to fill in priority and deadline_ms
+ * @return           ERR_NONE, or ERR_INTERNAL if the block is truncated
  */
-error_code_t encode_generate_response(const sd35_generate_response_t *resp,
-                                      uint8_t *buffer, size_t buf_size,
-                                      size_t *out_len) {
-    if (resp == NULL || buffer == NULL || out_len == NULL) {
+static error_code_t decode_scheduling(const protocol_header_t *header, const uint8_t **ptr,
+                                      size_t *remaining, sd35_generate_request_t *req) {
+    req->priority = SD35_PRIORITY_INTERACTIVE;
+    req->deadline_ms = 0;
+
+    if ((header->flags & PROTOCOL_FLAG_SCHEDULING) == 0) {
+        return ERR_NONE;
+    }
+    if (*remaining < SD35_SCHEDULING_BLOCK_SIZE) {
         return ERR_INTERNAL;
     }
 
-    if (resp->image_data == NULL) {
+    req->priority = read_u32_be(*ptr);
+    req->deadline_ms = read_u32_be(*ptr + 4);
+    *ptr += SD35_SCHEDULING_BLOCK_SIZE;
+    *remaining -= SD35_SCHEDULING_BLOCK_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * decode_generate_request_payload - Decode a generation request's payload
+ *
+ * The fixed fields sit at constant offsets, so they are read in one pass
+ * after a single length check; validation follows once all are read.
+ *
+ * @param header   Header from decode_header() (msg_type, payload_len)
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure
+ *
+ * Error codes: as decode_generate_request(), except header checks.
+ */
+error_code_t decode_generate_request_payload(const protocol_header_t *header,
+                                             const uint8_t *payload,
+                                             sd35_generate_request_t *req) {
+    if (header == NULL || payload == NULL || req == NULL) {
         return ERR_INTERNAL;
     }
 
-    if (resp->image_width < SD35_MIN_DIMENSION || resp->image_width > SD35_MAX_DIMENSION ||
-        resp->image_width % SD35_DIMENSION_ALIGNMENT != 0) {
-        return ERR_INVALID_DIMENSIONS;
+    if (header->msg_type != MSG_GENERATE_REQUEST ||
+        header->payload_len < GENERATE_REQUEST_FIXED_SIZE) {
+        return ERR_INTERNAL;
     }
 
-    if (resp->image_height < SD35_MIN_DIMENSION || resp->image_height > SD35_MAX_DIMENSION ||
-        resp->image_height % SD35_DIMENSION_ALIGNMENT != 0) {
-        return ERR_INVALID_DIMENSIONS;
+    size_t remaining = header->payload_len - GENERATE_REQUEST_FIXED_SIZE;
+    const uint8_t *ptr = payload + GENERATE_REQUEST_FIXED_SIZE;
+    error_code_t err;
+
+    req->request_id = read_u64_be(payload);
+    req->model_id = read_u32_be(payload + 8);
+    req->width = read_u32_be(payload + 12);
+    req->height = read_u32_be(payload + 16);
+    req->steps = read_u32_be(payload + 20);
+    req->cfg_scale = read_f32_be(payload + 24);
+    req->seed = read_u64_be(payload + 28);
+    req->clip_l_offset = read_u32_be(payload + 36);
+    req->clip_l_length = read_u32_be(payload + 40);
+    req->clip_g_offset = read_u32_be(payload + 44);
+    req->clip_g_length = read_u32_be(payload + 48);
+    req->t5_offset = read_u32_be(payload + 52);
+    req->t5_length = read_u32_be(payload + 56);
+
+    if (req->model_id > MODEL_ID_SD35_MAX) {
+        return ERR_INVALID_MODEL_ID;
     }
 
-    if (resp->channels != 3 && resp->channels != 4) {
-        return ERR_INVALID_DIMENSIONS;
+    if (decode_sampling(header, &ptr, &remaining, req) != ERR_NONE) {
+        return ERR_INTERNAL;
+    }
+    err = decode_init_image(header, &ptr, &remaining, req);
+    if (err != ERR_NONE) {
+        return err;
+    }
+    if (decode_scheduling(header, &ptr, &remaining, req) != ERR_NONE) {
+        return ERR_INTERNAL;
     }
 
-    if (resp->image_width > UINT32_MAX / resp->image_height) {
-        return ERR_INVALID_DIMENSIONS;
+    req->prompt_data = ptr;
+    req->prompt_data_len = remaining;
+
+    return validate_sd35_request(req, header->flags);
+}
+
+/**
+ * decode_generate_request - Decode and validate SD 3.5 generation request
+ *
+ * This function parses a complete binary protocol message containing a
+ * generation request. It validates all fields according to the protocol
+ * specification and returns appropriate error codes for invalid input.
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Request ID (8 bytes)
+ * - Model ID (4 bytes)
+ * - SD 3.5 parameters (48 bytes)
+ * - Sampler and scheduler (8 bytes, only with PROTOCOL_FLAG_SAMPLING)
+ * - Init image block (only with PROTOCOL_FLAG_INIT_IMAGE)
+ * - Priority and deadline (8 bytes, only with PROTOCOL_FLAG_SCHEDULING)
+ * - Prompt data (variable)
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer (must include header + payload)
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INVALID_MAGIC: Magic number mismatch
+ * - ERR_UNSUPPORTED_VERSION: Protocol version not supported
+ * - ERR_INVALID_MODEL_ID: model_id is not an SD 3.5 family ID (0-255); whether
+ *   the model is configured is checked by the caller
+ * - ERR_INVALID_DIMENSIONS: width/height out of range or not aligned
+ * - ERR_INVALID_STEPS: steps out of range
+ * - ERR_INVALID_CFG: cfg_scale out of range, NaN, or Inf
+ * - ERR_INVALID_SAMPLER: sampler or scheduler unknown
+ * - ERR_INVALID_PRIORITY: priority class unknown
+ * - ERR_INVALID_PROMPT: prompt offset/length out of bounds
+ * - ERR_INTERNAL: Truncated message or other structural error
+ */
+error_code_t decode_generate_request(const uint8_t *data, size_t data_len,
+                                     sd35_generate_request_t *req) {
+    if (data == NULL || req == NULL) {
+        return ERR_INTERNAL;
     }
-    uint32_t pixels = resp->image_width * resp->image_height;
 
-    if (pixels > UINT32_MAX / resp->channels) {
-        return ERR_INVALID_DIMENSIONS;
+    protocol_header_t header;
+    error_code_t err = decode_message_header(data, data_len, &header);
+    if (err != ERR_NONE) {
+        return err;
     }
-    uint32_t expected_data_len = pixels * resp->channels;
 
-    if (resp->image_data_len != expected_data_len) {
-        return ERR_INVALID_DIMENSIONS;
+    return decode_generate_request_payload(&header, data + 16, req);
+}
+
+/**
+ * decode_generate_batch_request_payload - Decode a batch request's payload
+ *
+ * @param header   Header from decode_header() (msg_type, payload_len)
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure
+ *
+ * Error codes: as decode_generate_batch_request(), except header checks.
+ */
+error_code_t decode_generate_batch_request_payload(const protocol_header_t *header,
+                                                   const uint8_t *payload,
+                                                   sd35_generate_batch_request_t *req) {
+    if (header == NULL || payload == NULL || req == NULL) {
+        return ERR_INTERNAL;
     }
 
-    if (resp->image_data_len > MAX_MESSAGE_SIZE - 16 - 16) {
+    if (header->msg_type != MSG_GENERATE_BATCH_REQUEST ||
+        header->payload_len < BATCH_REQUEST_FIXED_SIZE) {
         return ERR_INTERNAL;
     }
 
-    uint32_t payload_len = 16 + 16 + resp->image_data_len;
-    size_t total_len = 16 + payload_len;
+    sd35_generate_request_t *base = &req->base;
+    error_code_t err;
+    size_t remaining = header->payload_len - BATCH_REQUEST_FIXED_SIZE;
+    const uint8_t *ptr = payload + BATCH_REQUEST_FIXED_SIZE;
+
+    base->request_id = read_u64_be(payload);
+    base->model_id = read_u32_be(payload + 8);
+    base->width = read_u32_be(payload + 12);
+    base->height = read_u32_be(payload + 16);
+    base->steps = read_u32_be(payload + 20);
+    base->cfg_scale = read_f32_be(payload + 24);
+    req->seed_count = read_u32_be(payload + 28);
+    base->clip_l_offset = read_u32_be(payload + 32);
+    base->clip_l_length = read_u32_be(payload + 36);
+    base->clip_g_offset = read_u32_be(payload + 40);
+    base->clip_g_length = read_u32_be(payload + 44);
+    base->t5_offset = read_u32_be(payload + 48);
+    base->t5_length = read_u32_be(payload + 52);
+
+    if (base->model_id > MODEL_ID_SD35_MAX) {
+        return ERR_INVALID_MODEL_ID;
+    }
 
-    if (total_len > buf_size) {
+    if (req->seed_count < SD35_MIN_BATCH_SIZE || req->seed_count > SD35_MAX_BATCH_SIZE) {
+        return ERR_INVALID_SEED_COUNT;
+    }
+
+    if (remaining < (size_t)req->seed_count * 8) {
         return ERR_INTERNAL;
     }
 
-    uint8_t *ptr = buffer;
+    for (uint32_t i = 0; i < req->seed_count; i++) {
+        req->seeds[i] = read_u64_be(ptr);
+        ptr += 8;
+    }
+    remaining -= (size_t)req->seed_count * 8;
 
-    write_u32_be(ptr, PROTOCOL_MAGIC);
-    ptr += 4;
-    write_u16_be(ptr, PROTOCOL_VERSION_1);
-    ptr += 2;
-    write_u16_be(ptr, MSG_GENERATE_RESPONSE);
-    ptr += 2;
-    write_u32_be(ptr, payload_len);
-    ptr += 4;
-    write_u32_be(ptr, 0);
-    ptr += 4;
+    if (decode_sampling(header, &ptr, &remaining, base) != ERR_NONE) {
+        return ERR_INTERNAL;
+    }
+    err = decode_init_image(header, &ptr, &remaining, base);
+    if (err != ERR_NONE) {
+        return err;
+    }
+    if (decode_scheduling(header, &ptr, &remaining, base) != ERR_NONE) {
+        return ERR_INTERNAL;
+    }
 
-    write_u64_be(ptr, resp->request_id);
-    ptr += 8;
-    write_u32_be(ptr, resp->status);
-    ptr += 4;
-    write_u32_be(ptr, resp->generation_time_ms);
-    ptr += 4;
+    base->seed = req->seeds[0];
+    base->prompt_data = ptr;
+    base->prompt_data_len = remaining;
 
-    write_u32_be(ptr, resp->image_width);
-    ptr += 4;
-    write_u32_be(ptr, resp->image_height);
-    ptr += 4;
-    write_u32_be(ptr, resp->channels);
-    ptr += 4;
-    write_u32_be(ptr, resp->image_data_len);
+    return validate_sd35_request(base, header->flags);
+}
+
+/**
+ * decode_generate_batch_request - Decode and validate SD 3.5 batch request
+ *
+ * Same parameters and validation as decode_generate_request(), with a
+ * seed_count field in place of the single seed and a seed table ahead of
+ * the prompt data.
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Request ID (8 bytes)
+ * - Model ID (4 bytes)
+ * - width, height, steps, cfg_scale, seed_count (20 bytes)
+ * - Prompt offset table (24 bytes)
+ * - Seeds (seed_count * 8 bytes)
+ * - Sampler and scheduler (8 bytes, only with PROTOCOL_FLAG_SAMPLING)
+ * - Init image block (only with PROTOCOL_FLAG_INIT_IMAGE)
+ * - Priority and deadline (8 bytes, only with PROTOCOL_FLAG_SCHEDULING)
+ * - Prompt data (variable)
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer (must include header + payload)
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes: as decode_generate_request(), plus
+ * - ERR_INVALID_SEED_COUNT: seed_count outside 1-8
+ */
+error_code_t decode_generate_batch_request(const uint8_t *data, size_t data_len,
+                                           sd35_generate_batch_request_t *req) {
+    if (data == NULL || req == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    protocol_header_t header;
+    error_code_t err = decode_message_header(data, data_len, &header);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    return decode_generate_batch_request_payload(&header, data + 16, req);
+}
+
+/**
+ * validate_image_metadata - Validate response image metadata
+ *
+ * Shared by the single and batch response encoders.
+ *
+ * @param width     Image width
+ * @param height    Image height
+ * @param channels  Channel count
+ * @param data_len  Claimed size of one image in bytes
+ * @return          ERR_NONE if valid, ERR_INVALID_DIMENSIONS otherwise
+ */
+static error_code_t validate_image_metadata(uint32_t width, uint32_t height,
+                                            uint32_t channels, uint32_t data_len) {
+    if (width < SD35_MIN_DIMENSION || width > SD35_MAX_DIMENSION ||
+        width % SD35_DIMENSION_ALIGNMENT != 0) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    if (height < SD35_MIN_DIMENSION || height > SD35_MAX_DIMENSION ||
+        height % SD35_DIMENSION_ALIGNMENT != 0) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    if (channels != 3 && channels != 4) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    if (width > UINT32_MAX / height) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+    uint32_t pixels = width * height;
+
+    if (pixels > UINT32_MAX / channels) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    if (data_len != pixels * channels) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    return ERR_NONE;
+}
+
+/**
+ * validate_response_image - Validate a single response's image metadata
+ *
+ * Raw images must be exactly width * height * channels bytes. A PNG file
+ * only needs valid dimensions and a non-zero length.
+ *
+ * @param resp  Response to validate
+ * @return      ERR_NONE if valid, ERR_INVALID_DIMENSIONS otherwise
+ */
+static error_code_t validate_response_image(const sd35_generate_response_t *resp) {
+    uint32_t data_len = resp->image_data_len;
+
+    if (resp->image_format == IMAGE_FORMAT_PNG) {
+        if (data_len == 0) {
+            return ERR_INVALID_DIMENSIONS;
+        }
+        /* Checked against the raw size; a wrapped product fails the dimension checks */
+        data_len = resp->image_width * resp->image_height * resp->channels;
+    } else if (resp->image_format != IMAGE_FORMAT_RAW) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    return validate_image_metadata(resp->image_width, resp->image_height, resp->channels,
+                                   data_len);
+}
+
+/**
+ * write_generate_response_fields - Write a generation response up to the pixels
+ *
+ * @param resp         Validated response
+ * @param version      Header version
+ * @param payload_len  Header payload_len
+ * @param flags        Header flags
+ * @param buffer       Output buffer (at least SD35_RESPONSE_PREFIX_SIZE bytes)
+ */
+static void write_generate_response_fields(const sd35_generate_response_t *resp,
+                                           uint16_t version, uint32_t payload_len,
+                                           uint32_t flags, uint8_t *buffer) {
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
+    ptr += 4;
+    write_u16_be(ptr, version);
+    ptr += 2;
+    write_u16_be(ptr, MSG_GENERATE_RESPONSE);
+    ptr += 2;
+    write_u32_be(ptr, payload_len);
+    ptr += 4;
+    if (resp->image_format == IMAGE_FORMAT_PNG) {
+        flags |= PROTOCOL_FLAG_PNG;
+    }
+    write_u32_be(ptr, flags);
+    ptr += 4;
+
+    write_u64_be(ptr, resp->request_id);
+    ptr += 8;
+    write_u32_be(ptr, resp->status);
+    ptr += 4;
+    write_u32_be(ptr, resp->generation_time_ms);
+    ptr += 4;
+
+    write_u32_be(ptr, resp->image_width);
+    ptr += 4;
+    write_u32_be(ptr, resp->image_height);
+    ptr += 4;
+    write_u32_be(ptr, resp->channels);
+    ptr += 4;
+    write_u32_be(ptr, resp->image_data_len);
+}
+
+/**
+ * encode_generate_response_prefix - Encode everything before the image data
+ *
+ * Writes the common header, response fields, and image metadata of a
+ * MSG_GENERATE_RESPONSE (SD35_RESPONSE_PREFIX_SIZE bytes). The caller sends
+ * resp->image_data_len bytes of resp->image_data immediately after it, which
+ * lets the pixels go to the socket without being copied.
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer for the prefix
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store prefix length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INTERNAL: NULL pointer, invalid parameters, or buffer too small
+ * - ERR_INVALID_DIMENSIONS: Image dimensions invalid or mismatched with data_len
+ *
+ * Validation performed:
+ * - Width/height: 64-2048, multiple of 64
+ * - Channels: 3 (RGB) or 4 (RGBA)
+ * - image_data_len matches width * height * channels (raw), or is
+ *   non-zero (IMAGE_FORMAT_PNG)
+ * - Complete message fits in MAX_MESSAGE_SIZE
+ */
+error_code_t encode_generate_response_prefix(const sd35_generate_response_t *resp,
+                                             uint8_t *buffer, size_t buf_size,
+                                             size_t *out_len) {
+    if (resp == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (resp->image_data == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    error_code_t err = validate_response_image(resp);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    if (resp->image_data_len > MAX_MESSAGE_SIZE - 16 - 16) {
+        return ERR_INTERNAL;
+    }
+
+    if (buf_size < SD35_RESPONSE_PREFIX_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    write_generate_response_fields(resp, PROTOCOL_VERSION_1, 16 + 16 + resp->image_data_len, 0,
+                                   buffer);
+
+    *out_len = SD35_RESPONSE_PREFIX_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_response_head - Encode a version 2 generation response head
+ *
+ * Writes the header (version 2, the given flags), response fields, image
+ * metadata and the 64-bit image data length (SD35_RESPONSE_HEAD_SIZE bytes).
+ * payload_len covers only these bytes; the image data follows in MSG_CHUNK
+ * frames (PROTOCOL_FLAG_CHUNKED) or in a memfd (PROTOCOL_FLAG_SHM), so
+ * MAX_MESSAGE_SIZE does not limit it.
+ *
+ * @param resp      Response structure to encode
+ * @param flags     PROTOCOL_FLAG_CHUNKED or PROTOCOL_FLAG_SHM
+ * @param buffer    Output buffer for the head
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store head length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INTERNAL: NULL pointer, invalid flags, or buffer too small
+ * - ERR_INVALID_DIMENSIONS: Image dimensions invalid or mismatched with data_len
+ */
+error_code_t encode_generate_response_head(const sd35_generate_response_t *resp,
+                                           uint32_t flags, uint8_t *buffer,
+                                           size_t buf_size, size_t *out_len) {
+    if (resp == NULL || buffer == NULL || out_len == NULL || resp->image_data == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (flags != PROTOCOL_FLAG_CHUNKED && flags != PROTOCOL_FLAG_SHM) {
+        return ERR_INTERNAL;
+    }
+
+    error_code_t err = validate_response_image(resp);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    if (buf_size < SD35_RESPONSE_HEAD_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    write_generate_response_fields(resp, PROTOCOL_VERSION_2, 16 + 16 + 8, flags, buffer);
+    write_u64_be(buffer + SD35_RESPONSE_PREFIX_SIZE, resp->image_data_len);
+
+    *out_len = SD35_RESPONSE_HEAD_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_response - Encode SD 3.5 generation response
+ *
+ * This function encodes a successful generation response into the binary
+ * protocol format. The response contains the generated image data in raw
+ * RGB format.
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Common response fields: request_id (8), status (4), generation_time_ms (4)
+ * - Image metadata: width (4), height (4), channels (4), image_data_len (4)
+ * - Raw image data (width * height * channels bytes), or a PNG file when
+ *   resp->image_format is IMAGE_FORMAT_PNG (header sets PROTOCOL_FLAG_PNG)
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes: see encode_generate_response_prefix(); also ERR_INTERNAL if
+ * the buffer cannot hold the image data.
+ */
+error_code_t encode_generate_response(const sd35_generate_response_t *resp,
+                                      uint8_t *buffer, size_t buf_size,
+                                      size_t *out_len) {
+    size_t prefix_len;
+
+    if (out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    error_code_t err = encode_generate_response_prefix(resp, buffer, buf_size, &prefix_len);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    size_t total_len = prefix_len + resp->image_data_len;
+    if (total_len > buf_size) {
+        return ERR_INTERNAL;
+    }
+
+    memcpy(buffer + prefix_len, resp->image_data, resp->image_data_len);
+
+    *out_len = total_len;
+    return ERR_NONE;
+}
+
+/**
+ * prepare_prompt_valid - Check one prompt of a prepare request
+ *
+ * Unlike a generation request's, it may be empty.
+ *
+ * @param offset    Byte offset in the prompt data
+ * @param length    Byte length
+ * @param data_len  Size of the prompt data
+ * @return          1 if at most SD35_MAX_PROMPT_LENGTH and in bounds, 0 otherwise
+ */
+static int prepare_prompt_valid(uint32_t offset, uint32_t length, size_t data_len) {
+    return length <= SD35_MAX_PROMPT_LENGTH && offset <= data_len && length <= data_len - offset;
+}
+
+/**
+ * decode_prepare_request_payload - Decode a prepare request's payload
+ *
+ * @param header   Header from decode_header() (msg_type, payload_len)
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, error code on failure
+ *
+ * Error codes: as decode_prepare_request(), except header checks.
+ */
+error_code_t decode_prepare_request_payload(const protocol_header_t *header,
+                                            const uint8_t *payload,
+                                            sd35_prepare_request_t *req) {
+    if (header == NULL || payload == NULL || req == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (header->msg_type != MSG_PREPARE || header->payload_len < PREPARE_REQUEST_FIXED_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    req->request_id = read_u64_be(payload);
+    req->model_id = read_u32_be(payload + 8);
+    req->width = read_u32_be(payload + 12);
+    req->height = read_u32_be(payload + 16);
+    req->clip_l_offset = read_u32_be(payload + 20);
+    req->clip_l_length = read_u32_be(payload + 24);
+    req->clip_g_offset = read_u32_be(payload + 28);
+    req->clip_g_length = read_u32_be(payload + 32);
+    req->t5_offset = read_u32_be(payload + 36);
+    req->t5_length = read_u32_be(payload + 40);
+    req->prompt_data = payload + PREPARE_REQUEST_FIXED_SIZE;
+    req->prompt_data_len = header->payload_len - PREPARE_REQUEST_FIXED_SIZE;
+
+    if (req->model_id > MODEL_ID_SD35_MAX) {
+        return ERR_INVALID_MODEL_ID;
+    }
+
+    if (req->width < SD35_MIN_DIMENSION || req->width > SD35_MAX_DIMENSION ||
+        req->width % SD35_DIMENSION_ALIGNMENT != 0 ||
+        req->height < SD35_MIN_DIMENSION || req->height > SD35_MAX_DIMENSION ||
+        req->height % SD35_DIMENSION_ALIGNMENT != 0) {
+        return ERR_INVALID_DIMENSIONS;
+    }
+
+    if (!prepare_prompt_valid(req->clip_l_offset, req->clip_l_length, req->prompt_data_len) ||
+        !prepare_prompt_valid(req->clip_g_offset, req->clip_g_length, req->prompt_data_len) ||
+        !prepare_prompt_valid(req->t5_offset, req->t5_length, req->prompt_data_len)) {
+        return ERR_INVALID_PROMPT;
+    }
+
+    return ERR_NONE;
+}
+
+/**
+ * decode_prepare_request - Decode and validate a prepare request
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Request ID (8 bytes)
+ * - Model ID (4 bytes)
+ * - Width, height and prompt offsets/lengths (32 bytes)
+ * - Prompt data (variable)
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer (must include header + payload)
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_prepare_request(const uint8_t *data, size_t data_len,
+                                    sd35_prepare_request_t *req) {
+    if (data == NULL || req == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    protocol_header_t header;
+    error_code_t err = decode_message_header(data, data_len, &header);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    return decode_prepare_request_payload(&header, data + 16, req);
+}
+
+/**
+ * decode_request_id_payload - Decode a payload that is only a request ID
+ *
+ * @param header         Header from decode_header()
+ * @param expected_type  Required msg_type
+ * @param payload        header->payload_len bytes following the header
+ * @param request_id     Output request ID
+ * @return               ERR_NONE on success, ERR_INTERNAL on failure
+ */
+static error_code_t decode_request_id_payload(const protocol_header_t *header,
+                                              uint16_t expected_type,
+                                              const uint8_t *payload,
+                                              uint64_t *request_id) {
+    if (header == NULL || payload == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (header->msg_type != expected_type || header->payload_len != 8) {
+        return ERR_INTERNAL;
+    }
+
+    *request_id = read_u64_be(payload);
+    return ERR_NONE;
+}
+
+/**
+ * decode_cancel_request_payload - Decode a cancel request's payload
+ *
+ * @param header   Header from decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t decode_cancel_request_payload(const protocol_header_t *header,
+                                           const uint8_t *payload,
+                                           cancel_request_t *req) {
+    if (req == NULL) {
+        return ERR_INTERNAL;
+    }
+    return decode_request_id_payload(header, MSG_CANCEL, payload, &req->request_id);
+}
+
+/**
+ * decode_cancel_request - Decode a cancel request
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Request ID (8 bytes)
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer (must include header + payload)
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_cancel_request(const uint8_t *data, size_t data_len,
+                                   cancel_request_t *req) {
+    if (data == NULL || req == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    protocol_header_t header;
+    error_code_t err = decode_message_header(data, data_len, &header);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    return decode_cancel_request_payload(&header, data + 16, req);
+}
+
+/**
+ * decode_stats_request_payload - Decode a stats request's payload
+ *
+ * @param header   Header from decode_header()
+ * @param payload  header->payload_len bytes following the header
+ * @param req      Output request structure (populated on success)
+ * @return         ERR_NONE on success, ERR_INTERNAL on failure
+ */
+error_code_t decode_stats_request_payload(const protocol_header_t *header,
+                                          const uint8_t *payload,
+                                          stats_request_t *req) {
+    if (req == NULL) {
+        return ERR_INTERNAL;
+    }
+    return decode_request_id_payload(header, MSG_STATS_REQUEST, payload, &req->request_id);
+}
+
+/**
+ * decode_stats_request - Decode a stats request
+ *
+ * Message structure:
+ * - Common header (16 bytes)
+ * - Request ID (8 bytes)
+ *
+ * @param data      Input buffer containing complete message
+ * @param data_len  Size of input buffer (must include header + payload)
+ * @param req       Output request structure (populated on success)
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t decode_stats_request(const uint8_t *data, size_t data_len,
+                                  stats_request_t *req) {
+    if (data == NULL || req == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    protocol_header_t header;
+    error_code_t err = decode_message_header(data, data_len, &header);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    return decode_stats_request_payload(&header, data + 16, req);
+}
+
+/**
+ * move_payload_tail_to_shm - Rewrite an encoded header for a shared-memory tail
+ *
+ * Used with the *_prefix encoders: the image data that would follow the
+ * prefix is sent as a memfd, so it no longer counts toward payload_len.
+ *
+ * @param header    Encoded message header (16 bytes, modified in place)
+ * @param tail_len  Payload bytes moved to shared memory
+ * @return          ERR_NONE on success, error code on failure
+ */
+error_code_t move_payload_tail_to_shm(uint8_t *header, uint32_t tail_len) {
+    if (header == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    uint32_t payload_len = read_u32_be(header + 8);
+    if (tail_len > payload_len) {
+        return ERR_INTERNAL;
+    }
+
+    write_u32_be(header + 8, payload_len - tail_len);
+    write_u32_be(header + 12, read_u32_be(header + 12) | PROTOCOL_FLAG_SHM);
+    return ERR_NONE;
+}
+
+/**
+ * write_generate_batch_response_fields - Write a batch response up to the pixels
+ *
+ * @param resp         Validated response
+ * @param version      Header version
+ * @param payload_len  Header payload_len
+ * @param flags        Header flags
+ * @param buffer       Output buffer (at least SD35_BATCH_RESPONSE_PREFIX_SIZE bytes)
+ */
+static void write_generate_batch_response_fields(const sd35_generate_batch_response_t *resp,
+                                                 uint16_t version, uint32_t payload_len,
+                                                 uint32_t flags, uint8_t *buffer) {
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
+    ptr += 4;
+    write_u16_be(ptr, version);
+    ptr += 2;
+    write_u16_be(ptr, MSG_GENERATE_BATCH_RESPONSE);
+    ptr += 2;
+    write_u32_be(ptr, payload_len);
+    ptr += 4;
+    write_u32_be(ptr, flags);
+    ptr += 4;
+
+    write_u64_be(ptr, resp->request_id);
+    ptr += 8;
+    write_u32_be(ptr, resp->status);
+    ptr += 4;
+    write_u32_be(ptr, resp->generation_time_ms);
+    ptr += 4;
+
+    write_u32_be(ptr, resp->image_width);
+    ptr += 4;
+    write_u32_be(ptr, resp->image_height);
+    ptr += 4;
+    write_u32_be(ptr, resp->channels);
+    ptr += 4;
+    write_u32_be(ptr, resp->image_count);
+    ptr += 4;
+    write_u32_be(ptr, resp->image_data_len);
+}
+
+/**
+ * encode_generate_batch_response_prefix - Encode everything before the images
+ *
+ * Writes the common header, response fields, and image metadata of a
+ * MSG_GENERATE_BATCH_RESPONSE (SD35_BATCH_RESPONSE_PREFIX_SIZE bytes). The
+ * caller sends resp->images[0..image_count) of resp->image_data_len bytes
+ * each, in order, immediately after it.
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer for the prefix
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store prefix length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INTERNAL: NULL pointer, buffer too small, or message too large
+ * - ERR_INVALID_DIMENSIONS: Image metadata invalid or mismatched
+ */
+error_code_t encode_generate_batch_response_prefix(const sd35_generate_batch_response_t *resp,
+                                                   uint8_t *buffer, size_t buf_size,
+                                                   size_t *out_len) {
+    if (resp == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (resp->image_count < SD35_MIN_BATCH_SIZE || resp->image_count > SD35_MAX_BATCH_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    for (uint32_t i = 0; i < resp->image_count; i++) {
+        if (resp->images[i] == NULL) {
+            return ERR_INTERNAL;
+        }
+    }
+
+    error_code_t err = validate_image_metadata(resp->image_width, resp->image_height,
+                                               resp->channels, resp->image_data_len);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    /* 20 bytes of image metadata; reject before multiplying to avoid overflow */
+    if (resp->image_data_len > (MAX_MESSAGE_SIZE - 16 - 16 - 20) / resp->image_count) {
+        return ERR_INTERNAL;
+    }
+
+    if (buf_size < SD35_BATCH_RESPONSE_PREFIX_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    write_generate_batch_response_fields(resp, PROTOCOL_VERSION_1,
+                                         16 + 20 + resp->image_count * resp->image_data_len, 0,
+                                         buffer);
+
+    *out_len = SD35_BATCH_RESPONSE_PREFIX_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_batch_response_head - Encode a version 2 batch response head
+ *
+ * Like encode_generate_response_head(): the 64-bit data length after the
+ * image metadata is image_count * image_data_len, and the images follow in
+ * MSG_CHUNK frames or a memfd, in order (SD35_BATCH_RESPONSE_HEAD_SIZE bytes).
+ *
+ * @param resp      Response structure to encode
+ * @param flags     PROTOCOL_FLAG_CHUNKED or PROTOCOL_FLAG_SHM
+ * @param buffer    Output buffer for the head
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store head length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INTERNAL: NULL pointer, invalid flags or image count, or buffer too small
+ * - ERR_INVALID_DIMENSIONS: Image metadata invalid or mismatched
+ */
+error_code_t encode_generate_batch_response_head(const sd35_generate_batch_response_t *resp,
+                                                 uint32_t flags, uint8_t *buffer,
+                                                 size_t buf_size, size_t *out_len) {
+    if (resp == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (flags != PROTOCOL_FLAG_CHUNKED && flags != PROTOCOL_FLAG_SHM) {
+        return ERR_INTERNAL;
+    }
+
+    if (resp->image_count < SD35_MIN_BATCH_SIZE || resp->image_count > SD35_MAX_BATCH_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    for (uint32_t i = 0; i < resp->image_count; i++) {
+        if (resp->images[i] == NULL) {
+            return ERR_INTERNAL;
+        }
+    }
+
+    error_code_t err = validate_image_metadata(resp->image_width, resp->image_height,
+                                               resp->channels, resp->image_data_len);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    if (buf_size < SD35_BATCH_RESPONSE_HEAD_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    write_generate_batch_response_fields(resp, PROTOCOL_VERSION_2, 16 + 20 + 8, flags, buffer);
+    write_u64_be(buffer + SD35_BATCH_RESPONSE_PREFIX_SIZE,
+                 (uint64_t)resp->image_count * resp->image_data_len);
+
+    *out_len = SD35_BATCH_RESPONSE_HEAD_SIZE;
+    return ERR_NONE;
+}
+
+/**
+ * encode_chunk_header - Encode the header of a MSG_CHUNK frame
+ *
+ * The chunk_len data bytes that follow are the next part of the image data
+ * announced by the preceding version 2 response head.
+ *
+ * @param chunk_len  Data bytes in this chunk (1 to PROTOCOL_MAX_CHUNK_SIZE)
+ * @param buffer     Output buffer (at least 16 bytes)
+ * @param buf_size   Size of output buffer in bytes
+ * @return           ERR_NONE on success, ERR_INTERNAL on invalid arguments
+ */
+error_code_t encode_chunk_header(uint32_t chunk_len, uint8_t *buffer, size_t buf_size) {
+    if (buffer == NULL || buf_size < 16) {
+        return ERR_INTERNAL;
+    }
+
+    if (chunk_len == 0 || chunk_len > PROTOCOL_MAX_CHUNK_SIZE) {
+        return ERR_INTERNAL;
+    }
+
+    write_u32_be(buffer, PROTOCOL_MAGIC);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_2);
+    write_u16_be(buffer + 6, MSG_CHUNK);
+    write_u32_be(buffer + 8, chunk_len);
+    write_u32_be(buffer + 12, 0);
+
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_batch_response - Encode SD 3.5 batch generation response
+ *
+ * Message structure:
+ * - Common header (16 bytes, msg_type = MSG_GENERATE_BATCH_RESPONSE)
+ * - Common response fields: request_id (8), status (4), generation_time_ms (4)
+ * - Image metadata: width (4), height (4), channels (4), image_count (4),
+ *   image_data_len (4, per image)
+ * - image_count raw images of image_data_len bytes each, in seed order
+ *
+ * @param resp      Response structure to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length (bytes written)
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes: see encode_generate_batch_response_prefix(); also
+ * ERR_INTERNAL if the buffer cannot hold the image data.
+ */
+error_code_t encode_generate_batch_response(const sd35_generate_batch_response_t *resp,
+                                            uint8_t *buffer, size_t buf_size,
+                                            size_t *out_len) {
+    size_t prefix_len;
+
+    if (out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    error_code_t err = encode_generate_batch_response_prefix(resp, buffer, buf_size,
+                                                             &prefix_len);
+    if (err != ERR_NONE) {
+        return err;
+    }
+
+    size_t total_len = prefix_len + (size_t)resp->image_count * resp->image_data_len;
+    if (total_len > buf_size) {
+        return ERR_INTERNAL;
+    }
+
+    uint8_t *ptr = buffer + prefix_len;
+    for (uint32_t i = 0; i < resp->image_count; i++) {
+        memcpy(ptr, resp->images[i], resp->image_data_len);
+        ptr += resp->image_data_len;
+    }
+
+    *out_len = total_len;
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_progress - Encode SD 3.5 generation progress frame
+ *
+ * Message structure:
+ * - Common header (16 bytes, msg_type = MSG_GENERATE_PROGRESS)
+ * - request_id (8), step (4), total_steps (4), elapsed_ms (4)
+ * - Preview metadata: width (4), height (4), channels (4), data_len (4)
+ * - Preview pixels (data_len bytes, may be 0)
+ *
+ * @param progress  Progress structure to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, error code on failure
+ *
+ * Error codes:
+ * - ERR_INTERNAL: NULL pointers, buffer too small, or step out of range
+ * - ERR_INVALID_DIMENSIONS: preview metadata inconsistent
+ */
+error_code_t encode_generate_progress(const sd35_generate_progress_t *progress,
+                                      uint8_t *buffer, size_t buf_size,
+                                      size_t *out_len) {
+    if (progress == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (progress->step > progress->total_steps) {
+        return ERR_INTERNAL;
+    }
+
+    uint32_t preview_len = 0;
+    if (progress->preview_data_len > 0 || progress->preview_width > 0 ||
+        progress->preview_height > 0) {
+        if (progress->preview_data == NULL ||
+            progress->preview_width == 0 || progress->preview_height == 0 ||
+            progress->preview_width > SD35_MAX_PREVIEW_DIMENSION ||
+            progress->preview_height > SD35_MAX_PREVIEW_DIMENSION) {
+            return ERR_INVALID_DIMENSIONS;
+        }
+
+        if (progress->preview_channels != 3 && progress->preview_channels != 4) {
+            return ERR_INVALID_DIMENSIONS;
+        }
+
+        /* Bounded by SD35_MAX_PREVIEW_DIMENSION, cannot overflow */
+        preview_len = progress->preview_width * progress->preview_height *
+                      progress->preview_channels;
+        if (progress->preview_data_len != preview_len) {
+            return ERR_INVALID_DIMENSIONS;
+        }
+    }
+
+    uint32_t payload_len = 20 + 16 + preview_len;
+    size_t total_len = 16 + (size_t)payload_len;
+
+    if (total_len > buf_size) {
+        return ERR_INTERNAL;
+    }
+
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
+    ptr += 4;
+    write_u16_be(ptr, PROTOCOL_VERSION_1);
+    ptr += 2;
+    write_u16_be(ptr, MSG_GENERATE_PROGRESS);
+    ptr += 2;
+    write_u32_be(ptr, payload_len);
+    ptr += 4;
+    write_u32_be(ptr, 0);
+    ptr += 4;
+
+    write_u64_be(ptr, progress->request_id);
+    ptr += 8;
+    write_u32_be(ptr, progress->step);
+    ptr += 4;
+    write_u32_be(ptr, progress->total_steps);
+    ptr += 4;
+    write_u32_be(ptr, progress->elapsed_ms);
+    ptr += 4;
+
+    write_u32_be(ptr, preview_len > 0 ? progress->preview_width : 0);
+    ptr += 4;
+    write_u32_be(ptr, preview_len > 0 ? progress->preview_height : 0);
+    ptr += 4;
+    write_u32_be(ptr, preview_len > 0 ? progress->preview_channels : 0);
+    ptr += 4;
+    write_u32_be(ptr, preview_len);
+    ptr += 4;
+
+    if (preview_len > 0) {
+        memcpy(ptr, progress->preview_data, preview_len);
+    }
+
+    *out_len = total_len;
+    return ERR_NONE;
+}
+
+/**
+ * encode_generate_timings - Encode a MSG_GENERATE_TIMINGS frame
+ *
+ * Message structure:
+ * - Common header (16 bytes, msg_type = MSG_GENERATE_TIMINGS)
+ * - request_id (8), stage_count (4), stage_us (8 per stage)
+ * - step_count (4), step_us (4 per step)
+ *
+ * @param timings   Timings to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, ERR_INTERNAL on NULL pointers, a
+ *                  too small buffer or more than SD35_MAX_TIMED_STEPS steps
+ */
+error_code_t encode_generate_timings(const sd35_generate_timings_t *timings,
+                                     uint8_t *buffer, size_t buf_size,
+                                     size_t *out_len) {
+    if (timings == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (timings->step_count > SD35_MAX_TIMED_STEPS) {
+        return ERR_INTERNAL;
+    }
+
+    uint32_t payload_len = 8 + 4 + 8 * TIMING_STAGE_COUNT + 4 + 4 * timings->step_count;
+    size_t total_len = 16 + (size_t)payload_len;
+
+    if (total_len > buf_size) {
+        return ERR_INTERNAL;
+    }
+
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
+    ptr += 4;
+    write_u16_be(ptr, PROTOCOL_VERSION_1);
+    ptr += 2;
+    write_u16_be(ptr, MSG_GENERATE_TIMINGS);
+    ptr += 2;
+    write_u32_be(ptr, payload_len);
+    ptr += 4;
+    write_u32_be(ptr, 0);
+    ptr += 4;
+
+    write_u64_be(ptr, timings->request_id);
+    ptr += 8;
+    write_u32_be(ptr, TIMING_STAGE_COUNT);
+    ptr += 4;
+    for (uint32_t i = 0; i < TIMING_STAGE_COUNT; i++) {
+        write_u64_be(ptr, timings->stage_us[i]);
+        ptr += 8;
+    }
+    write_u32_be(ptr, timings->step_count);
+    ptr += 4;
+    for (uint32_t i = 0; i < timings->step_count; i++) {
+        write_u32_be(ptr, timings->step_us[i]);
+        ptr += 4;
+    }
+
+    *out_len = total_len;
+    return ERR_NONE;
+}
+
+/**
+ * encode_stats_response - Encode a MSG_STATS_RESPONSE frame
+ *
+ * Message structure:
+ * - Common header (16 bytes, msg_type = MSG_STATS_RESPONSE)
+ * - request_id (8), status (4), uptime_ms (8), requests (8), completed (8),
+ *   queue_depth (4), in_flight (4), vram_bytes (8), pool_hits (8),
+ *   pool_misses (8), pool_idle_bytes (8)
+ * - class_count (4), then queue_depth (4) and wait_ms (4) per priority class
+ * - error_count (4), then code (4) and count (8) per error
+ * - bucket_count (4), then an upper bound (8) per bucket
+ * - histogram_count (4), then stage (4), count (8), sum_us (8) and a count
+ *   (8) per bucket for each timing stage
+ *
+ * @param resp      Stats to encode
+ * @param buffer    Output buffer for encoded message
+ * @param buf_size  Size of output buffer in bytes
+ * @param out_len   Pointer to store actual encoded length
+ * @return          ERR_NONE on success, ERR_INTERNAL on NULL pointers, a
+ *                  too small buffer or more than STATS_MAX_ERROR_CODES errors
+ */
+error_code_t encode_stats_response(const stats_response_t *resp,
+                                   uint8_t *buffer, size_t buf_size,
+                                   size_t *out_len) {
+    if (resp == NULL || buffer == NULL || out_len == NULL) {
+        return ERR_INTERNAL;
+    }
+
+    if (resp->error_count > STATS_MAX_ERROR_CODES) {
+        return ERR_INTERNAL;
+    }
+
+    uint32_t payload_len = 76 + 4 + 8 * SD35_PRIORITY_COUNT + 4 + 12 * resp->error_count +
+                           4 + 8 * STATS_HISTOGRAM_BUCKETS +
+                           4 + (20 + 8 * STATS_HISTOGRAM_BUCKETS) * TIMING_STAGE_COUNT;
+    size_t total_len = 16 + (size_t)payload_len;
+
+    if (total_len > buf_size) {
+        return ERR_INTERNAL;
+    }
+
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
     ptr += 4;
+    write_u16_be(ptr, PROTOCOL_VERSION_1);
+    ptr += 2;
+    write_u16_be(ptr, MSG_STATS_RESPONSE);
+    ptr += 2;
+    write_u32_be(ptr, payload_len);
+    ptr += 4;
+    write_u32_be(ptr, 0);
+    ptr += 4;
+
+    write_u64_be(ptr, resp->request_id);
+    ptr += 8;
+    write_u32_be(ptr, resp->status);
+    ptr += 4;
+    write_u64_be(ptr, resp->uptime_ms);
+    ptr += 8;
+    write_u64_be(ptr, resp->requests);
+    ptr += 8;
+    write_u64_be(ptr, resp->completed);
+    ptr += 8;
+    write_u32_be(ptr, resp->queue_depth);
+    ptr += 4;
+    write_u32_be(ptr, resp->in_flight);
+    ptr += 4;
+    write_u64_be(ptr, resp->vram_bytes);
+    ptr += 8;
+    write_u64_be(ptr, resp->pool_hits);
+    ptr += 8;
+    write_u64_be(ptr, resp->pool_misses);
+    ptr += 8;
+    write_u64_be(ptr, resp->pool_idle_bytes);
+    ptr += 8;
+
+    write_u32_be(ptr, SD35_PRIORITY_COUNT);
+    ptr += 4;
+    for (uint32_t i = 0; i < SD35_PRIORITY_COUNT; i++) {
+        write_u32_be(ptr, resp->class_queue_depth[i]);
+        ptr += 4;
+        write_u32_be(ptr, resp->class_wait_ms[i]);
+        ptr += 4;
+    }
 
-    memcpy(ptr, resp->image_data, resp->image_data_len);
-    ptr += resp->image_data_len;
+    write_u32_be(ptr, resp->error_count);
+    ptr += 4;
+    for (uint32_t i = 0; i < resp->error_count; i++) {
+        write_u32_be(ptr, resp->errors[i].code);
+        ptr += 4;
+        write_u64_be(ptr, resp->errors[i].count);
+        ptr += 8;
+    }
+
+    write_u32_be(ptr, STATS_HISTOGRAM_BUCKETS);
+    ptr += 4;
+    for (uint32_t i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        write_u64_be(ptr, resp->bucket_bounds_us[i]);
+        ptr += 8;
+    }
+
+    write_u32_be(ptr, TIMING_STAGE_COUNT);
+    ptr += 4;
+    for (uint32_t stage = 0; stage < TIMING_STAGE_COUNT; stage++) {
+        const stats_histogram_t *hist = &resp->histograms[stage];
+
+        write_u32_be(ptr, stage);
+        ptr += 4;
+        write_u64_be(ptr, hist->count);
+        ptr += 8;
+        write_u64_be(ptr, hist->sum_us);
+        ptr += 8;
+        for (uint32_t i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+            write_u64_be(ptr, hist->buckets[i]);
+            ptr += 8;
+        }
+    }
 
     *out_len = total_len;
     return ERR_NONE;
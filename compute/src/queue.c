@@ -0,0 +1,215 @@
+/**
+ * Weave Queue Module - Bounded Blocking Work Queue Implementation
+ *
+ * A ring buffer guarded by one mutex with two condition variables:
+ * not_empty wakes consumers, not_full wakes producers. Closing broadcasts
+ * both so no thread stays blocked on a queue that will never change.
+ *
+ * Pop scans the ring for the first item of the lowest priority and closes
+ * the gap it leaves. Queues are a few slots deep, so the scan costs less
+ * than keeping a ring per priority.
+ */
+
+#include <stdlib.h>
+
+#include "weave/queue.h"
+
+/**
+ * work_queue_init - Initialize an empty queue
+ */
+queue_error_t work_queue_init(work_queue_t *queue, size_t capacity) {
+    if (queue == NULL) {
+        return QUEUE_ERR_NULL_POINTER;
+    }
+
+    if (capacity == 0) {
+        return QUEUE_ERR_INVALID_CAPACITY;
+    }
+
+    queue->slots = calloc(capacity, sizeof(*queue->slots));
+    queue->priorities = calloc(capacity, sizeof(*queue->priorities));
+    if (queue->slots == NULL || queue->priorities == NULL) {
+        free(queue->priorities);
+        free(queue->slots);
+        queue->slots = NULL;
+        return QUEUE_ERR_OUT_OF_MEMORY;
+    }
+
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+
+    if (pthread_mutex_init(&queue->lock, NULL) != 0) {
+        free(queue->priorities);
+        free(queue->slots);
+        queue->slots = NULL;
+        return QUEUE_ERR_INIT_FAILED;
+    }
+
+    if (pthread_cond_init(&queue->not_empty, NULL) != 0) {
+        pthread_mutex_destroy(&queue->lock);
+        free(queue->priorities);
+        free(queue->slots);
+        queue->slots = NULL;
+        return QUEUE_ERR_INIT_FAILED;
+    }
+
+    if (pthread_cond_init(&queue->not_full, NULL) != 0) {
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_mutex_destroy(&queue->lock);
+        free(queue->priorities);
+        free(queue->slots);
+        queue->slots = NULL;
+        return QUEUE_ERR_INIT_FAILED;
+    }
+
+    return QUEUE_OK;
+}
+
+/**
+ * work_queue_destroy - Release queue resources
+ */
+void work_queue_destroy(work_queue_t *queue) {
+    if (queue == NULL || queue->slots == NULL) {
+        return;
+    }
+
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->priorities);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+/**
+ * work_queue_push - Append an item, blocking while the queue is full
+ */
+queue_error_t work_queue_push(work_queue_t *queue, void *item) {
+    return work_queue_push_priority(queue, item, 0);
+}
+
+/**
+ * work_queue_push_priority - Append an item with a priority
+ */
+queue_error_t work_queue_push_priority(work_queue_t *queue, void *item, unsigned priority) {
+    size_t tail;
+
+    if (queue == NULL) {
+        return QUEUE_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == queue->capacity && !queue->closed) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return QUEUE_ERR_CLOSED;
+    }
+
+    tail = (queue->head + queue->count) % queue->capacity;
+    queue->slots[tail] = item;
+    queue->priorities[tail] = priority;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return QUEUE_OK;
+}
+
+/**
+ * work_queue_pop - Remove the oldest item of the most urgent priority
+ */
+queue_error_t work_queue_pop(work_queue_t *queue, void **item) {
+    size_t best = 0;
+
+    if (queue == NULL || item == NULL) {
+        return QUEUE_ERR_NULL_POINTER;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+
+    if (queue->count == 0) {
+        /* Closed and drained */
+        pthread_mutex_unlock(&queue->lock);
+        return QUEUE_ERR_CLOSED;
+    }
+
+    /* Offset from head of the first item with the lowest priority */
+    for (size_t i = 1; i < queue->count; i++) {
+        unsigned best_priority = queue->priorities[(queue->head + best) % queue->capacity];
+
+        if (best_priority == 0) {
+            break;
+        }
+        if (queue->priorities[(queue->head + i) % queue->capacity] < best_priority) {
+            best = i;
+        }
+    }
+
+    *item = queue->slots[(queue->head + best) % queue->capacity];
+
+    /* Shift the items ahead of it back one slot to close the gap */
+    for (size_t i = best; i > 0; i--) {
+        size_t to = (queue->head + i) % queue->capacity;
+        size_t from = (queue->head + i - 1) % queue->capacity;
+
+        queue->slots[to] = queue->slots[from];
+        queue->priorities[to] = queue->priorities[from];
+    }
+
+    queue->slots[queue->head] = NULL;
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+
+    return QUEUE_OK;
+}
+
+/**
+ * work_queue_close - Stop accepting items and wake all waiters
+ */
+void work_queue_close(work_queue_t *queue) {
+    if (queue == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * queue_error_string - Get human-readable error message
+ */
+const char *queue_error_string(queue_error_t err) {
+    switch (err) {
+        case QUEUE_OK:
+            return "success";
+        case QUEUE_ERR_NULL_POINTER:
+            return "null pointer argument";
+        case QUEUE_ERR_INVALID_CAPACITY:
+            return "queue capacity must be at least 1";
+        case QUEUE_ERR_OUT_OF_MEMORY:
+            return "failed to allocate queue";
+        case QUEUE_ERR_INIT_FAILED:
+            return "failed to initialize queue synchronization";
+        case QUEUE_ERR_CLOSED:
+            return "queue closed";
+        default:
+            return "unknown error";
+    }
+}
@@ -5,15 +5,36 @@
  */
 
 #include "weave/sd_wrapper.h"
+#include "weave/prepared_model.h"
 
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <new>      /* For std::nothrow */
 #include <string>
+#include <unistd.h>
 
 /* Include stable-diffusion.cpp C API */
 #include "stable-diffusion.h"
 
+/* ggml's Vulkan backend, for device memory queries */
+#include "ggml-vulkan.h"
+
+/**
+ * Default AUTO VAE tiling threshold: 1024x1024 decodes in one pass on a
+ * 12 GB card, 1536x1536 runs out of memory there.
+ */
+#define SD_WRAPPER_DEFAULT_VAE_TILE_PIXELS (1024 * 1024)
+
+/** VAE tile size limits in latent pixels (0 = library default) */
+#define SD_WRAPPER_MIN_VAE_TILE_SIZE 16
+#define SD_WRAPPER_MAX_VAE_TILE_SIZE 128
+
+/** Largest step cache threshold; past it nearly every step is reused */
+#define SD_WRAPPER_MAX_STEP_CACHE_THRESHOLD 1.0f
+
 /**
  * Internal context structure.
  * Holds stable-diffusion.cpp context and error state.
@@ -22,12 +43,92 @@ struct sd_wrapper_ctx {
     sd_ctx_t* sd_ctx;           /* stable-diffusion.cpp context */
     std::string error_msg;      /* Last error message */
     sd_wrapper_config_t config; /* Configuration used to create context */
+    sd_wrapper_config_t load_config; /* config with prepared weight paths, used by new_sd_ctx() */
+    std::string prepared_paths[5]; /* Storage for load_config's prepared paths */
+    bool needs_full_reset;      /* Last generation failed, compute reset is unsafe */
+    bool has_generated;         /* generate_image() has run on this context */
+    sd_wrapper_progress_fn progress_fn; /* Progress callback (NULL = disabled) */
+    void* progress_user_data;   /* Passed through to progress_fn */
+    uint32_t progress_steps;    /* Sampling steps of the running generation */
+    uint32_t preview_interval;  /* Steps between previews (0 = none) */
+    bool has_previews;          /* Counted in g_preview_users */
+    sd_wrapper_abort_fn abort_fn; /* Abort callback (NULL = disabled) */
+    void* abort_user_data;      /* Passed through to abort_fn */
+    bool aborted;               /* abort_fn fired during the running generation */
+    bool out_of_memory;         /* An allocation failed during the running generation */
+    sd_wrapper_timings_t timings; /* Stages of the last generation */
+    uint64_t pending_reset_us;  /* Reset time not yet reported by a generation */
+    uint64_t run_start_us;      /* When the running generate_image() call started */
+    uint64_t run_first_step_us; /* When its first sampling step started (0 = no step yet) */
+    uint64_t run_last_step_us;  /* When its latest sampling step ended */
 };
 
+/**
+ * Serializes new_sd_ctx() calls, which read the device from SD_VK_DEVICE.
+ */
+static std::mutex g_sd_ctx_create_lock;
+
+/**
+ * stable-diffusion.cpp weight type for a wrapper weight type.
+ */
+static enum sd_type_t sd_wrapper_sd_type(sd_wrapper_wtype_t wtype) {
+    switch (wtype) {
+    case SD_WRAPPER_WTYPE_Q8_0:
+        return SD_TYPE_Q8_0;
+    case SD_WRAPPER_WTYPE_Q4_0:
+        return SD_TYPE_Q4_0;
+    case SD_WRAPPER_WTYPE_F16:
+    default:
+        return SD_TYPE_F16;
+    }
+}
+
+/**
+ * Serializes weight preparation, so contexts for the same model on several
+ * devices convert each file once and then share it.
+ */
+static std::mutex g_prepare_lock;
+
+/**
+ * Guards the process-wide callback registration below.
+ */
+static std::mutex g_callback_lock;
+
+/** Contexts that currently want latent previews */
+static uint32_t g_preview_users = 0;
+
+/**
+ * Context generating on this thread (NULL outside generate_image()).
+ *
+ * stable-diffusion.cpp calls its process-wide callbacks on the thread that
+ * called generate_image(), so this routes them to the right context when
+ * several contexts generate at once on different devices.
+ */
+static thread_local sd_wrapper_ctx_t* t_generating_ctx = NULL;
+
 /* Forward declarations */
 static void sd_wrapper_log_callback(enum sd_log_level_t level,
                                      const char* text,
                                      void* data);
+static void sd_wrapper_fill_ctx_params(const sd_wrapper_config_t* config,
+                                       sd_ctx_params_t* sd_params);
+static sd_ctx_t* sd_wrapper_new_sd_ctx(const sd_wrapper_config_t* config);
+static void sd_wrapper_prepare_weights(sd_wrapper_ctx_t* ctx);
+static void sd_wrapper_progress_callback(int step, int steps, float time, void* data);
+static void sd_wrapper_preview_callback(int step, int frame_count, sd_image_t* frames,
+                                        bool is_noisy, void* data);
+static void sd_wrapper_install_callbacks(sd_wrapper_ctx_t* ctx);
+static bool sd_wrapper_check_abort(sd_wrapper_ctx_t* ctx);
+static sd_wrapper_error_t sd_wrapper_reset_ctx(sd_wrapper_ctx_t* ctx,
+                                               sd_wrapper_reset_mode_t mode);
+
+/**
+ * Monotonic clock in microseconds.
+ */
+static uint64_t sd_wrapper_now_us(void) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 /**
  * Initialize wrapper configuration with defaults.
@@ -49,6 +150,12 @@ void sd_wrapper_config_init(sd_wrapper_config_t* config) {
     config->keep_clip_on_cpu = true;  /* Save VRAM */
     config->keep_vae_on_cpu = false;  /* VAE on GPU for speed */
     config->enable_flash_attn = true; /* Faster attention */
+    config->device_index = -1;        /* SD_VK_DEVICE or device 0 */
+    config->prepare_weights = false;  /* Convert on every load */
+    config->weight_type = SD_WRAPPER_WTYPE_F16;
+    config->vae_tile_pixels = SD_WRAPPER_DEFAULT_VAE_TILE_PIXELS;
+    config->step_cache_threshold = 0.0f; /* Every step runs */
+    config->reuse_context = false;    /* Full reset between generations */
 }
 
 /**
@@ -70,6 +177,14 @@ void sd_wrapper_gen_params_init(sd_wrapper_gen_params_t* params) {
     params->cfg_scale = 4.5f;  /* SD 3.5 Medium default */
     params->seed = 0;          /* Random */
     params->clip_skip = 0;     /* No skip */
+    params->vae_tiling = SD_WRAPPER_VAE_TILING_AUTO;
+    params->vae_tile_size = 0; /* Library default */
+    params->sampler = SD_WRAPPER_SAMPLER_DEFAULT;
+    params->scheduler = SD_WRAPPER_SCHEDULER_DEFAULT;
+    params->step_cache = SD_WRAPPER_STEP_CACHE_AUTO;
+    params->step_cache_threshold = 0.0f; /* Library default */
+    params->init_image = NULL;           /* txt2img */
+    params->strength = 0.75f;            /* stable-diffusion.cpp default */
 }
 
 /**
@@ -79,6 +194,10 @@ sd_wrapper_ctx_t* sd_wrapper_create(const sd_wrapper_config_t* config) {
     if (config == NULL || config->model_path == NULL) {
         return NULL;
     }
+    if (!(config->step_cache_threshold >= 0.0f &&
+          config->step_cache_threshold <= SD_WRAPPER_MAX_STEP_CACHE_THRESHOLD)) {
+        return NULL;
+    }
 
     /* Allocate context using nothrow to return NULL instead of throwing */
     sd_wrapper_ctx_t* ctx = new(std::nothrow) sd_wrapper_ctx;
@@ -90,47 +209,47 @@ sd_wrapper_ctx_t* sd_wrapper_create(const sd_wrapper_config_t* config) {
     ctx->sd_ctx = NULL;
     ctx->error_msg = "Model load failed";  /* Default error before attempting load */
     ctx->config = *config;
+    ctx->load_config = *config;
+    ctx->needs_full_reset = false;
+    ctx->has_generated = false;
+    ctx->progress_fn = NULL;
+    ctx->progress_user_data = NULL;
+    ctx->progress_steps = 0;
+    ctx->preview_interval = 0;
+    ctx->has_previews = false;
+    ctx->abort_fn = NULL;
+    ctx->abort_user_data = NULL;
+    ctx->aborted = false;
+    ctx->out_of_memory = false;
+    memset(&ctx->timings, 0, sizeof(ctx->timings));
+    ctx->pending_reset_us = 0;
+    ctx->run_start_us = 0;
+    ctx->run_first_step_us = 0;
+    ctx->run_last_step_us = 0;
 
     /* Set up logging callback */
     sd_set_log_callback(sd_wrapper_log_callback, ctx);
 
-    /* Initialize stable-diffusion.cpp context parameters */
-    sd_ctx_params_t sd_params;
-    sd_ctx_params_init(&sd_params);
+    /* The step callback also times sampling, so it is always installed */
+    sd_wrapper_install_callbacks(ctx);
 
-    /* Set model paths */
-    sd_params.model_path = config->model_path;
-    sd_params.clip_l_path = config->clip_l_path;
-    sd_params.clip_g_path = config->clip_g_path;
-    sd_params.t5xxl_path = config->t5xxl_path;
-    sd_params.vae_path = config->vae_path;
-
-    /* Set CPU/GPU offloading */
-    sd_params.keep_clip_on_cpu = config->keep_clip_on_cpu;
-    sd_params.keep_vae_on_cpu = config->keep_vae_on_cpu;
-
-    /* Set threading */
-    if (config->n_threads > 0) {
-        sd_params.n_threads = config->n_threads;
-    } else {
-        sd_params.n_threads = sd_get_num_physical_cores();
+    if (config->prepare_weights) {
+        try {
+            sd_wrapper_prepare_weights(ctx);
+        } catch (const std::bad_alloc&) {
+            /* Fall back to the source files */
+            ctx->load_config = *config;
+        }
     }
 
-    /* Enable flash attention if requested */
-    sd_params.diffusion_flash_attn = config->enable_flash_attn;
-
-    /*
-     * Use FP16 for model weights.
-     * Trade-off: Saves ~50% VRAM with minimal quality loss for SD 3.5 Medium.
-     * This is intentional for 12GB VRAM cards like RTX 4070 Super.
-     */
-    sd_params.wtype = SD_TYPE_F16;
-
-    /* Enable Vulkan backend (will be set by build flags) */
-    /* The library will automatically use Vulkan if built with -DSD_USE_VULKAN */
-
     /* Create stable-diffusion.cpp context */
-    ctx->sd_ctx = new_sd_ctx(&sd_params);
+    ctx->sd_ctx = sd_wrapper_new_sd_ctx(&ctx->load_config);
+    if (ctx->sd_ctx == NULL && config->prepare_weights) {
+        /* A prepared file the library cannot read must not cost the model */
+        fprintf(stderr, "[sd] WARN: loading prepared weights failed, loading sources\n");
+        ctx->load_config = *config;
+        ctx->sd_ctx = sd_wrapper_new_sd_ctx(&ctx->load_config);
+    }
     if (ctx->sd_ctx == NULL) {
         /* Model load failed - error_msg already set */
         delete ctx;
@@ -151,6 +270,13 @@ void sd_wrapper_free(sd_wrapper_ctx_t* ctx) {
         return;
     }
 
+    /* Release this context's share of the process-wide callbacks */
+    if (ctx->progress_fn != NULL || ctx->abort_fn != NULL) {
+        ctx->progress_fn = NULL;
+        ctx->abort_fn = NULL;
+        sd_wrapper_install_callbacks(ctx);
+    }
+
     if (ctx->sd_ctx != NULL) {
         free_sd_ctx(ctx->sd_ctx);
         ctx->sd_ctx = NULL;
@@ -160,20 +286,10 @@ void sd_wrapper_free(sd_wrapper_ctx_t* ctx) {
 }
 
 /**
- * Generate an image from text prompt.
+ * Validate generation parameters shared by single and batch generation.
  */
-sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
-                                        const sd_wrapper_gen_params_t* params,
-                                        sd_wrapper_image_t* image) {
-    if (ctx == NULL || ctx->sd_ctx == NULL) {
-        return SD_WRAPPER_ERR_INVALID_PARAM;
-    }
-
-    if (params == NULL || params->prompt == NULL || image == NULL) {
-        ctx->error_msg = "Invalid parameters: params, prompt, or image is NULL";
-        return SD_WRAPPER_ERR_INVALID_PARAM;
-    }
-
+static sd_wrapper_error_t sd_wrapper_validate_params(sd_wrapper_ctx_t* ctx,
+                                                     const sd_wrapper_gen_params_t* params) {
     /* Validate dimensions */
     if (params->width < 64 || params->width > 2048 ||
         params->height < 64 || params->height > 2048 ||
@@ -194,72 +310,413 @@ sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
         return SD_WRAPPER_ERR_INVALID_PARAM;
     }
 
-    /* Initialize generation parameters */
-    sd_img_gen_params_t gen_params;
-    sd_img_gen_params_init(&gen_params);
+    /* Validate VAE tiling */
+    if (params->vae_tiling != SD_WRAPPER_VAE_TILING_AUTO &&
+        params->vae_tiling != SD_WRAPPER_VAE_TILING_OFF &&
+        params->vae_tiling != SD_WRAPPER_VAE_TILING_ON) {
+        ctx->error_msg = "Invalid VAE tiling mode";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    if (params->vae_tile_size != 0 &&
+        (params->vae_tile_size < SD_WRAPPER_MIN_VAE_TILE_SIZE ||
+         params->vae_tile_size > SD_WRAPPER_MAX_VAE_TILE_SIZE)) {
+        ctx->error_msg = "Invalid VAE tile size: must be 0 or 16-128";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Validate sampling */
+    if ((unsigned)params->sampler >= SD_WRAPPER_SAMPLER_COUNT) {
+        ctx->error_msg = "Invalid sampler";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    if ((unsigned)params->scheduler >= SD_WRAPPER_SCHEDULER_COUNT) {
+        ctx->error_msg = "Invalid scheduler";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Validate step caching */
+    if (params->step_cache != SD_WRAPPER_STEP_CACHE_AUTO &&
+        params->step_cache != SD_WRAPPER_STEP_CACHE_OFF &&
+        params->step_cache != SD_WRAPPER_STEP_CACHE_ON) {
+        ctx->error_msg = "Invalid step cache mode";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+    if (!(params->step_cache_threshold >= 0.0f &&
+          params->step_cache_threshold <= SD_WRAPPER_MAX_STEP_CACHE_THRESHOLD)) {
+        ctx->error_msg = "Invalid step cache threshold: must be 0.0-1.0";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Validate img2img strength */
+    if (params->init_image != NULL && !(params->strength > 0.0f && params->strength <= 1.0f)) {
+        ctx->error_msg = "Invalid strength: must be above 0.0 and at most 1.0";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Map a wrapper sampler to stable-diffusion.cpp's, or SAMPLE_METHOD_COUNT for
+ * the model default.
+ */
+static enum sample_method_t sd_wrapper_sample_method(sd_wrapper_sampler_t sampler) {
+    switch (sampler) {
+        case SD_WRAPPER_SAMPLER_EULER:         return EULER_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_EULER_A:       return EULER_A_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_HEUN:          return HEUN_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DPM2:          return DPM2_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DPMPP_2S_A:    return DPMPP2S_A_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DPMPP_2M:      return DPMPP2M_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DPMPP_2M_V2:   return DPMPP2Mv2_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_IPNDM:         return IPNDM_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_IPNDM_V:       return IPNDM_V_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_LCM:           return LCM_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DDIM_TRAILING: return DDIM_TRAILING_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_TCD:           return TCD_SAMPLE_METHOD;
+        case SD_WRAPPER_SAMPLER_DEFAULT:
+        default:                               return SAMPLE_METHOD_COUNT;
+    }
+}
+
+/**
+ * Map a wrapper scheduler to stable-diffusion.cpp's, or SCHEDULER_COUNT for
+ * the model default.
+ */
+static enum scheduler_t sd_wrapper_schedule(sd_wrapper_scheduler_t scheduler) {
+    switch (scheduler) {
+        case SD_WRAPPER_SCHEDULER_DISCRETE:    return DISCRETE_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_KARRAS:      return KARRAS_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_EXPONENTIAL: return EXPONENTIAL_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_AYS:         return AYS_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_GITS:        return GITS_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_SGM_UNIFORM: return SGM_UNIFORM_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_SIMPLE:      return SIMPLE_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_SMOOTHSTEP:  return SMOOTHSTEP_SCHEDULER;
+        case SD_WRAPPER_SCHEDULER_DEFAULT:
+        default:                               return SCHEDULER_COUNT;
+    }
+}
+
+/**
+ * Translate wrapper generation parameters into stable-diffusion.cpp parameters.
+ */
+static void sd_wrapper_fill_gen_params(sd_wrapper_ctx_t* ctx,
+                                       const sd_wrapper_gen_params_t* params,
+                                       sd_img_gen_params_t* gen_params) {
+    sd_img_gen_params_init(gen_params);
 
     /* Set prompts */
-    gen_params.prompt = params->prompt;
-    gen_params.negative_prompt = params->negative_prompt;
+    gen_params->prompt = params->prompt;
+    gen_params->negative_prompt = params->negative_prompt;
 
     /* Set dimensions */
-    gen_params.width = params->width;
-    gen_params.height = params->height;
+    gen_params->width = params->width;
+    gen_params->height = params->height;
 
     /* Set sampling parameters */
-    gen_params.sample_params.sample_steps = params->steps;
-    gen_params.sample_params.guidance.txt_cfg = params->cfg_scale;
-
-    /* Get default sampler and scheduler from context */
-    gen_params.sample_params.sample_method = sd_get_default_sample_method(ctx->sd_ctx);
-    gen_params.sample_params.scheduler = sd_get_default_scheduler(
-        ctx->sd_ctx,
-        gen_params.sample_params.sample_method);
+    gen_params->sample_params.sample_steps = params->steps;
+    gen_params->sample_params.guidance.txt_cfg = params->cfg_scale;
+
+    /* Requested sampler and scheduler, else the context's defaults. The
+     * default scheduler depends on the sampler, so it is looked up after. */
+    enum sample_method_t method = sd_wrapper_sample_method(params->sampler);
+    if (method == SAMPLE_METHOD_COUNT) {
+        method = sd_get_default_sample_method(ctx->sd_ctx);
+    }
+    enum scheduler_t schedule = sd_wrapper_schedule(params->scheduler);
+    if (schedule == SCHEDULER_COUNT) {
+        schedule = sd_get_default_scheduler(ctx->sd_ctx, method);
+    }
+    gen_params->sample_params.sample_method = method;
+    gen_params->sample_params.scheduler = schedule;
 
     /* Set seed */
-    gen_params.seed = params->seed;
+    gen_params->seed = params->seed;
 
     /* Set CLIP skip */
-    gen_params.clip_skip = params->clip_skip;
+    gen_params->clip_skip = params->clip_skip;
 
-    /* Generate image */
-    sd_image_t* sd_img = generate_image(ctx->sd_ctx, &gen_params);
-    if (sd_img == NULL) {
-        ctx->error_msg = "Image generation failed. Check GPU memory and model.";
-        return SD_WRAPPER_ERR_GENERATION_FAILED;
+    /* Tile the VAE decode of images too large to decode in one pass */
+    uint32_t tile_pixels = ctx->config.vae_tile_pixels;
+    switch (params->vae_tiling) {
+        case SD_WRAPPER_VAE_TILING_ON:
+            gen_params->vae_tiling_params.enabled = true;
+            break;
+        case SD_WRAPPER_VAE_TILING_OFF:
+            gen_params->vae_tiling_params.enabled = false;
+            break;
+        case SD_WRAPPER_VAE_TILING_AUTO:
+        default:
+            gen_params->vae_tiling_params.enabled =
+                tile_pixels != 0 && (uint64_t)params->width * params->height > tile_pixels;
+            break;
+    }
+    if (params->vae_tile_size != 0) {
+        gen_params->vae_tiling_params.tile_size_x = (int)params->vae_tile_size;
+        gen_params->vae_tiling_params.tile_size_y = (int)params->vae_tile_size;
+    }
+
+    /* Reuse transformer output across steps that barely change it */
+    float threshold = 0.0f;
+    switch (params->step_cache) {
+        case SD_WRAPPER_STEP_CACHE_ON:
+            threshold = params->step_cache_threshold != 0.0f
+                            ? params->step_cache_threshold
+                            : gen_params->easycache.reuse_threshold;
+            break;
+        case SD_WRAPPER_STEP_CACHE_OFF:
+            break;
+        case SD_WRAPPER_STEP_CACHE_AUTO:
+        default:
+            threshold = ctx->config.step_cache_threshold;
+            break;
+    }
+    gen_params->easycache.enabled = threshold > 0.0f;
+    if (threshold > 0.0f) {
+        gen_params->easycache.reuse_threshold = threshold;
+    }
+
+    /* Start from the init image's latent instead of pure noise */
+    if (params->init_image != NULL) {
+        gen_params->init_image.width = params->width;
+        gen_params->init_image.height = params->height;
+        gen_params->init_image.channel = 3;
+        gen_params->init_image.data = const_cast<uint8_t*>(params->init_image);
+        gen_params->strength = params->strength;
+    }
+}
+
+/**
+ * Number of sampling steps stable-diffusion.cpp runs for the parameters.
+ *
+ * img2img skips the noisiest part of the schedule and samples only the
+ * last strength * steps steps (plus one), as stable-diffusion.cpp's
+ * generate_image() truncates its sigmas.
+ */
+static uint32_t sd_wrapper_sampled_steps(const sd_wrapper_gen_params_t* params) {
+    if (params->init_image == NULL) {
+        return params->steps;
     }
+    uint32_t t_enc = (uint32_t)((float)params->steps * params->strength);
+    if (t_enc >= params->steps) {
+        t_enc = params->steps - 1;
+    }
+    return t_enc + 1;
+}
 
-    /* Copy image data to output */
+/**
+ * Move one stable-diffusion.cpp image into a wrapper image.
+ *
+ * stable-diffusion.cpp allocates image data with malloc(), so the wrapper
+ * takes the buffer over as-is instead of copying it; callers release it with
+ * sd_wrapper_free_image(). On failure sd_img->data is released. Either way
+ * sd_img->data is NULL on return.
+ */
+static sd_wrapper_error_t sd_wrapper_take_image(sd_wrapper_ctx_t* ctx,
+                                                sd_image_t* sd_img,
+                                                sd_wrapper_image_t* image) {
     image->width = sd_img->width;
     image->height = sd_img->height;
     image->channels = sd_img->channel;
 
     /* Check for integer overflow in size calculation */
-    if (sd_img->width > SIZE_MAX / sd_img->height ||
-        sd_img->width * sd_img->height > SIZE_MAX / sd_img->channel) {
+    if (sd_img->data == NULL || sd_img->height == 0 || sd_img->channel == 0 ||
+        sd_img->width > SIZE_MAX / sd_img->height ||
+        (size_t)sd_img->width * sd_img->height > SIZE_MAX / sd_img->channel) {
         free(sd_img->data);
-        free(sd_img);
+        sd_img->data = NULL;
         ctx->error_msg = "Image size calculation overflow";
         return SD_WRAPPER_ERR_OUT_OF_MEMORY;
     }
 
-    image->data_size = sd_img->width * sd_img->height * sd_img->channel;
+    image->data_size = (size_t)sd_img->width * sd_img->height * sd_img->channel;
 
-    /* Allocate buffer for caller */
-    image->data = (uint8_t*)malloc(image->data_size);
-    if (image->data == NULL) {
-        free(sd_img->data);
-        free(sd_img);
-        ctx->error_msg = "Out of memory allocating image buffer";
+    /* Transfer ownership of the pixel buffer */
+    image->data = sd_img->data;
+    sd_img->data = NULL;
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Release an array of stable-diffusion.cpp images.
+ */
+static void sd_wrapper_free_sd_images(sd_image_t* sd_imgs, uint32_t count) {
+    if (sd_imgs == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        free(sd_imgs[i].data);
+    }
+    free(sd_imgs);
+}
+
+/**
+ * Add one generate_image() call's stages to ctx->timings.
+ *
+ * @param end_us  When the call returned
+ */
+static void sd_wrapper_record_run(sd_wrapper_ctx_t* ctx, uint64_t end_us) {
+    sd_wrapper_timings_t& timings = ctx->timings;
+
+    if (ctx->run_first_step_us == 0) {
+        /* No sampling step completed; report the whole call as sampling */
+        timings.sampling_us += end_us - ctx->run_start_us;
+        return;
+    }
+
+    timings.text_encode_us += ctx->run_first_step_us - ctx->run_start_us;
+    timings.sampling_us += ctx->run_last_step_us - ctx->run_first_step_us;
+    timings.vae_decode_us += end_us - ctx->run_last_step_us;
+}
+
+/**
+ * Run generate_image() and move its batch_count results into images.
+ */
+static sd_wrapper_error_t sd_wrapper_run(sd_wrapper_ctx_t* ctx,
+                                         sd_img_gen_params_t* gen_params,
+                                         uint32_t batch_count,
+                                         sd_wrapper_image_t* images) {
+    gen_params->batch_count = (int)batch_count;
+
+    if (sd_wrapper_check_abort(ctx)) {
+        ctx->error_msg = "Generation cancelled";
+        return SD_WRAPPER_ERR_CANCELLED;
+    }
+
+    ctx->out_of_memory = false;
+    ctx->run_first_step_us = 0;
+    ctx->run_last_step_us = 0;
+    ctx->run_start_us = sd_wrapper_now_us();
+    t_generating_ctx = ctx;
+    sd_image_t* sd_imgs = generate_image(ctx->sd_ctx, gen_params);
+    t_generating_ctx = NULL;
+    ctx->has_generated = true;
+    sd_wrapper_record_run(ctx, sd_wrapper_now_us());
+    if (ctx->aborted) {
+        /* The pass completed normally, so the context needs no full reset */
+        sd_wrapper_free_sd_images(sd_imgs, sd_imgs != NULL ? batch_count : 0);
+        ctx->error_msg = "Generation cancelled";
+        return SD_WRAPPER_ERR_CANCELLED;
+    }
+    if (sd_imgs == NULL && ctx->out_of_memory) {
+        ctx->needs_full_reset = true;
+        ctx->error_msg = gen_params->vae_tiling_params.enabled
+            ? "Out of GPU memory"
+            : "Out of GPU memory (VAE tiling may help at this size)";
         return SD_WRAPPER_ERR_OUT_OF_MEMORY;
     }
+    if (sd_imgs == NULL) {
+        ctx->needs_full_reset = true;
+        ctx->error_msg = "Image generation failed. Check GPU memory and model.";
+        return SD_WRAPPER_ERR_GENERATION_FAILED;
+    }
 
-    /* Copy pixel data */
-    memcpy(image->data, sd_img->data, image->data_size);
+    sd_wrapper_error_t err = SD_WRAPPER_OK;
+    for (uint32_t i = 0; i < batch_count; i++) {
+        if (err == SD_WRAPPER_OK) {
+            err = sd_wrapper_take_image(ctx, &sd_imgs[i], &images[i]);
+        }
+    }
+
+    if (err != SD_WRAPPER_OK) {
+        for (uint32_t i = 0; i < batch_count; i++) {
+            sd_wrapper_free_image(&images[i]);
+        }
+    }
+
+    sd_wrapper_free_sd_images(sd_imgs, batch_count);
+    return err;
+}
+
+/**
+ * Generate an image from text prompt.
+ */
+sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
+                                        const sd_wrapper_gen_params_t* params,
+                                        sd_wrapper_image_t* image) {
+    if (params == NULL) {
+        if (ctx != NULL) {
+            ctx->error_msg = "Invalid parameters: params, prompt, or image is NULL";
+        }
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    return sd_wrapper_generate_batch(ctx, params, &params->seed, 1, image);
+}
 
-    /* Free the sd_img now that we've copied the data */
-    free(sd_img->data);
-    free(sd_img);
+/**
+ * Generate one image per seed with shared prompt and parameters.
+ *
+ * stable-diffusion.cpp encodes the prompt once per generate_image() call and
+ * derives the seed of batch image i as seed + i. Consecutive seeds therefore
+ * run as a single call; arbitrary seeds fall back to one call per seed.
+ */
+sd_wrapper_error_t sd_wrapper_generate_batch(sd_wrapper_ctx_t* ctx,
+                                              const sd_wrapper_gen_params_t* params,
+                                              const int64_t* seeds,
+                                              uint32_t count,
+                                              sd_wrapper_image_t* images) {
+    if (ctx == NULL || ctx->sd_ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Timings describe this call, plus the resets that led up to it */
+    memset(&ctx->timings, 0, sizeof(ctx->timings));
+    ctx->timings.reset_us = ctx->pending_reset_us;
+    ctx->pending_reset_us = 0;
+
+    if (params == NULL || params->prompt == NULL || seeds == NULL || images == NULL) {
+        ctx->error_msg = "Invalid parameters: params, prompt, seeds, or images is NULL";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    if (count < 1 || count > SD_WRAPPER_MAX_BATCH) {
+        ctx->error_msg = "Invalid batch size: must be 1-8";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    sd_wrapper_error_t err = sd_wrapper_validate_params(ctx, params);
+    if (err != SD_WRAPPER_OK) {
+        return err;
+    }
+
+    memset(images, 0, sizeof(sd_wrapper_image_t) * count);
+
+    /* Initialize generation parameters */
+    sd_img_gen_params_t gen_params;
+    sd_wrapper_fill_gen_params(ctx, params, &gen_params);
+    ctx->progress_steps = sd_wrapper_sampled_steps(params);
+    ctx->aborted = false;
+
+    /*
+     * Compared as uint64_t so seeds near INT64_MAX cannot overflow. A run
+     * that would wrap is not consecutive: stable-diffusion.cpp adds the
+     * image index to the first seed itself.
+     */
+    bool consecutive = seeds[0] <= INT64_MAX - (int64_t)(count - 1);
+    for (uint32_t i = 1; consecutive && i < count; i++) {
+        if ((uint64_t)seeds[i] != (uint64_t)seeds[0] + i) {
+            consecutive = false;
+        }
+    }
+
+    if (consecutive) {
+        gen_params.seed = seeds[0];
+        return sd_wrapper_run(ctx, &gen_params, count, images);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        gen_params.seed = seeds[i];
+        err = sd_wrapper_run(ctx, &gen_params, 1, &images[i]);
+        if (err != SD_WRAPPER_OK) {
+            for (uint32_t j = 0; j < i; j++) {
+                sd_wrapper_free_image(&images[j]);
+            }
+            return err;
+        }
+    }
 
     return SD_WRAPPER_OK;
 }
@@ -294,6 +751,74 @@ const char* sd_wrapper_get_error(sd_wrapper_ctx_t* ctx) {
     return ctx->error_msg.c_str();
 }
 
+/**
+ * Driver pipeline cache settings for sd_wrapper_set_pipeline_cache_dir().
+ *
+ * NVIDIA reads the __GL_SHADER_DISK_CACHE variables for Vulkan as well as
+ * OpenGL; its default 128 MiB limit evicts part of ggml's pipeline set.
+ * RADV, ANV and the other Mesa drivers read MESA_SHADER_CACHE_*.
+ */
+#define SD_WRAPPER_PIPELINE_CACHE_BYTES "1073741824"
+
+sd_wrapper_error_t sd_wrapper_set_pipeline_cache_dir(const char* dir) {
+    if (dir == NULL || dir[0] == '\0') {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    const char* const settings[][2] = {
+        {"__GL_SHADER_DISK_CACHE", "1"},
+        {"__GL_SHADER_DISK_CACHE_PATH", dir},
+        {"__GL_SHADER_DISK_CACHE_SIZE", SD_WRAPPER_PIPELINE_CACHE_BYTES},
+        {"__GL_SHADER_DISK_CACHE_SKIP_CLEANUP", "1"},
+        {"MESA_SHADER_CACHE_DIR", dir},
+        {"MESA_SHADER_CACHE_MAX_SIZE", "1G"},
+    };
+    for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+        /* overwrite = 0: an explicit setting from the user wins */
+        if (setenv(settings[i][0], settings[i][1], 0) != 0) {
+            return SD_WRAPPER_ERR_OUT_OF_MEMORY;
+        }
+    }
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Query a Vulkan device's memory.
+ */
+sd_wrapper_error_t sd_wrapper_get_device_memory(int device_index,
+                                                 size_t* free_bytes,
+                                                 size_t* total_bytes) {
+    if (free_bytes == NULL || total_bytes == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Same default as the backend: SD_VK_DEVICE, else the first device */
+    if (device_index < 0) {
+        const char* env = getenv("SD_VK_DEVICE");
+        device_index = env != NULL ? atoi(env) : 0;
+    }
+
+    if (device_index < 0 || device_index >= ggml_backend_vk_get_device_count()) {
+        return SD_WRAPPER_ERR_GPU_ERROR;
+    }
+
+    ggml_backend_vk_get_device_memory(device_index, free_bytes, total_bytes);
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Get stage timings of the last generation.
+ */
+sd_wrapper_error_t sd_wrapper_get_timings(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_timings_t* timings) {
+    if (ctx == NULL || timings == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    *timings = ctx->timings;
+    return SD_WRAPPER_OK;
+}
+
 /**
  * Get model information.
  */
@@ -335,69 +860,465 @@ sd_wrapper_error_t sd_wrapper_get_model_info(sd_wrapper_ctx_t* ctx,
 
 /**
  * Reset the SD context to clean state.
- *
- * WORKAROUND: stable-diffusion.cpp has a bug where calling generate_image()
- * multiple times on the same context causes segfaults due to GGML compute
- * buffers not being properly freed between calls. This function destroys
- * and recreates the internal context to ensure clean state.
  */
 sd_wrapper_error_t sd_wrapper_reset(sd_wrapper_ctx_t* ctx) {
+    return sd_wrapper_reset_mode(ctx, SD_WRAPPER_RESET_FULL);
+}
+
+/**
+ * Reset the SD context between generations using the given mode.
+ *
+ * WORKAROUND: A second generate_image() call on the same context segfaulted
+ * (bug 002), so the context is destroyed and recreated between generations.
+ * The suspected cause is free_params_immediately, which releases weight
+ * tensors after their first use. Contexts created with reuse_context keep
+ * their weights, and compute mode then keeps the context and skips the
+ * 2-3 second reload. That is opt-in until verified on hardware.
+ */
+sd_wrapper_error_t sd_wrapper_reset_mode(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_reset_mode_t mode) {
     if (ctx == NULL) {
         return SD_WRAPPER_ERR_INVALID_PARAM;
     }
 
+    uint64_t start_us = sd_wrapper_now_us();
+    sd_wrapper_error_t err = sd_wrapper_reset_ctx(ctx, mode);
+    ctx->pending_reset_us += sd_wrapper_now_us() - start_us;
+    return err;
+}
+
+/**
+ * Whether generate_image() has run on this context.
+ */
+bool sd_wrapper_has_generated(const sd_wrapper_ctx_t* ctx) {
+    return ctx != NULL && ctx->has_generated;
+}
+
+/**
+ * Take the reset time not yet reported by a generation.
+ */
+uint64_t sd_wrapper_take_reset_time(sd_wrapper_ctx_t* ctx) {
+    if (ctx == NULL) {
+        return 0;
+    }
+
+    uint64_t reset_us = ctx->pending_reset_us;
+    ctx->pending_reset_us = 0;
+    return reset_us;
+}
+
+/**
+ * Reset ctx for sd_wrapper_reset_mode(), which times it.
+ */
+static sd_wrapper_error_t sd_wrapper_reset_ctx(sd_wrapper_ctx_t* ctx,
+                                               sd_wrapper_reset_mode_t mode) {
+    if (mode != SD_WRAPPER_RESET_FULL && mode != SD_WRAPPER_RESET_COMPUTE) {
+        ctx->error_msg = "Invalid reset mode";
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    /* Without reuse_context, every reset recreates the context */
+    if (mode == SD_WRAPPER_RESET_COMPUTE && !ctx->config.reuse_context) {
+        mode = SD_WRAPPER_RESET_FULL;
+    }
+
+    /* Escalate to a full reset if there is nothing safe to keep */
+    if (mode == SD_WRAPPER_RESET_COMPUTE &&
+        (ctx->sd_ctx == NULL || ctx->needs_full_reset)) {
+        fprintf(stderr, "[sd] INFO: escalating compute reset to full reset\n");
+        mode = SD_WRAPPER_RESET_FULL;
+    }
+
+    if (mode == SD_WRAPPER_RESET_COMPUTE) {
+        /* Weights stay resident; compute buffers are released per run */
+        ctx->error_msg = "";
+        return SD_WRAPPER_OK;
+    }
+
     /* Free existing SD context if present */
     if (ctx->sd_ctx != NULL) {
         free_sd_ctx(ctx->sd_ctx);
         ctx->sd_ctx = NULL;
     }
 
-    /* Recreate SD context with stored configuration */
-    sd_ctx_params_t sd_params;
-    sd_ctx_params_init(&sd_params);
+    /* Recreate SD context with stored configuration (same device, same files) */
+    ctx->sd_ctx = sd_wrapper_new_sd_ctx(&ctx->load_config);
+    if (ctx->sd_ctx == NULL) {
+        ctx->error_msg = "Failed to recreate SD context";
+        return SD_WRAPPER_ERR_INIT_FAILED;
+    }
 
-    /* Set model paths from stored config */
-    sd_params.model_path = ctx->config.model_path;
-    sd_params.clip_l_path = ctx->config.clip_l_path;
-    sd_params.clip_g_path = ctx->config.clip_g_path;
-    sd_params.t5xxl_path = ctx->config.t5xxl_path;
-    sd_params.vae_path = ctx->config.vae_path;
+    ctx->needs_full_reset = false;
+    ctx->error_msg = "";
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Translate wrapper configuration into stable-diffusion.cpp parameters.
+ *
+ * Shared by sd_wrapper_create() and full resets so both build identical
+ * contexts.
+ */
+static void sd_wrapper_fill_ctx_params(const sd_wrapper_config_t* config,
+                                       sd_ctx_params_t* sd_params) {
+    sd_ctx_params_init(sd_params);
+
+    /* Set model paths */
+    sd_params->model_path = config->model_path;
+    sd_params->clip_l_path = config->clip_l_path;
+    sd_params->clip_g_path = config->clip_g_path;
+    sd_params->t5xxl_path = config->t5xxl_path;
+    sd_params->vae_path = config->vae_path;
 
     /* Set CPU/GPU offloading */
-    sd_params.keep_clip_on_cpu = ctx->config.keep_clip_on_cpu;
-    sd_params.keep_vae_on_cpu = ctx->config.keep_vae_on_cpu;
+    sd_params->keep_clip_on_cpu = config->keep_clip_on_cpu;
+    sd_params->keep_vae_on_cpu = config->keep_vae_on_cpu;
 
     /* Set threading */
-    if (ctx->config.n_threads > 0) {
-        sd_params.n_threads = ctx->config.n_threads;
+    if (config->n_threads > 0) {
+        sd_params->n_threads = config->n_threads;
     } else {
-        sd_params.n_threads = sd_get_num_physical_cores();
+        sd_params->n_threads = sd_get_num_physical_cores();
     }
 
-    /* Enable flash attention if configured */
-    sd_params.diffusion_flash_attn = ctx->config.enable_flash_attn;
+    /* Enable flash attention if requested */
+    sd_params->diffusion_flash_attn = config->enable_flash_attn;
 
-    /* Use FP16 for model weights */
-    sd_params.wtype = SD_TYPE_F16;
+    /*
+     * Keep weight tensors resident after first use so the context can be
+     * reused across generations (see sd_wrapper_reset_mode()). Otherwise
+     * stable-diffusion.cpp's default frees them, as the context is
+     * recreated before the next generation anyway.
+     */
+    if (config->reuse_context) {
+        sd_params->free_params_immediately = false;
+    }
 
-    /* Recreate context */
-    ctx->sd_ctx = new_sd_ctx(&sd_params);
-    if (ctx->sd_ctx == NULL) {
-        ctx->error_msg = "Failed to recreate SD context";
-        return SD_WRAPPER_ERR_INIT_FAILED;
+    /*
+     * FP16 by default: saves ~50% VRAM over F32 with minimal quality loss for
+     * SD 3.5 Medium. Smaller cards get a quantized type from the VRAM plan.
+     */
+    sd_params->wtype = sd_wrapper_sd_type(config->weight_type);
+
+    /* Enable Vulkan backend (will be set by build flags) */
+    /* The library will automatically use Vulkan if built with -DSD_USE_VULKAN */
+}
+
+/**
+ * Create a stable-diffusion.cpp context on the configured device.
+ *
+ * sd_ctx_params_t has no device field; the Vulkan backend picks the device
+ * from the SD_VK_DEVICE environment variable while new_sd_ctx() runs. The
+ * variable is set for the duration of the call and then restored, under a
+ * lock so concurrent creations cannot see each other's device.
+ */
+static sd_ctx_t* sd_wrapper_new_sd_ctx(const sd_wrapper_config_t* config) {
+    sd_ctx_params_t sd_params;
+    sd_wrapper_fill_ctx_params(config, &sd_params);
+
+    std::lock_guard<std::mutex> lock(g_sd_ctx_create_lock);
+
+    if (config->device_index < 0) {
+        return new_sd_ctx(&sd_params);
     }
 
-    ctx->error_msg = "";
+    /* Copy the previous value; setenv() may invalidate the getenv() pointer */
+    char previous[16];
+    const char* env = getenv("SD_VK_DEVICE");
+    bool had_previous = env != NULL && strlen(env) < sizeof(previous);
+    if (had_previous) {
+        memcpy(previous, env, strlen(env) + 1);
+    }
+
+    char device[16];
+    snprintf(device, sizeof(device), "%d", config->device_index);
+    if (setenv("SD_VK_DEVICE", device, 1) != 0) {
+        return NULL;
+    }
+
+    sd_ctx_t* sd_ctx = new_sd_ctx(&sd_params);
+
+    if (had_previous) {
+        setenv("SD_VK_DEVICE", previous, 1);
+    } else {
+        unsetenv("SD_VK_DEVICE");
+    }
+
+    return sd_ctx;
+}
+
+/**
+ * Resolve one weight file to its prepared GGUF, converting it first if the
+ * prepared file is missing or stale.
+ *
+ * convert() writes the weights in stable-diffusion.cpp's GGUF layout with
+ * every tensor in the context's weight type, so loading the result skips the
+ * per-load type conversion. GGUF sources are already in that layout and are
+ * left alone.
+ *
+ * @return Prepared path, or the source path if it is GGUF or cannot be prepared
+ */
+static std::string sd_wrapper_prepare_file(const char* source, sd_wrapper_wtype_t wtype) {
+    std::string source_path(source);
+    char prepared[4096];
+    char tmp[4096];
+    prepared_model_fingerprint_t fingerprint;
+    prepared_model_error_t err;
+
+    static const char gguf_ext[] = ".gguf";
+    size_t ext_len = sizeof(gguf_ext) - 1;
+    if (source_path.size() >= ext_len &&
+        source_path.compare(source_path.size() - ext_len, ext_len, gguf_ext) == 0) {
+        return source_path;
+    }
+
+    const char* suffix = PREPARED_MODEL_SUFFIX;
+    if (wtype == SD_WRAPPER_WTYPE_Q8_0) {
+        suffix = PREPARED_MODEL_SUFFIX_Q8_0;
+    } else if (wtype == SD_WRAPPER_WTYPE_Q4_0) {
+        suffix = PREPARED_MODEL_SUFFIX_Q4_0;
+    }
+
+    if (prepared_model_path(source, suffix, prepared, sizeof(prepared))
+            != PREPARED_MODEL_OK ||
+        prepared_model_path(prepared, PREPARED_MODEL_TMP_SUFFIX, tmp, sizeof(tmp))
+            != PREPARED_MODEL_OK) {
+        fprintf(stderr, "[sd] WARN: path too long to prepare %s\n", source);
+        return source_path;
+    }
+
+    std::lock_guard<std::mutex> lock(g_prepare_lock);
+
+    err = prepared_model_check(source, prepared);
+    if (err == PREPARED_MODEL_OK) {
+        fprintf(stderr, "[sd] INFO: using prepared weights %s\n", prepared);
+        return std::string(prepared);
+    }
+    if (err == PREPARED_MODEL_ERR_IO) {
+        /* Unreadable source: let the load report it */
+        return source_path;
+    }
+
+    /* Fingerprint before converting, so a source replaced meanwhile is stale */
+    if (prepared_model_fingerprint(source, &fingerprint) != PREPARED_MODEL_OK) {
+        return source_path;
+    }
+
+    fprintf(stderr, "[sd] INFO: preparing %s (%s)\n", prepared,
+            prepared_model_error_string(err));
+    if (!convert(source, NULL, tmp, sd_wrapper_sd_type(wtype), "")) {
+        unlink(tmp);
+        fprintf(stderr, "[sd] WARN: converting %s failed, loading it directly\n", source);
+        return source_path;
+    }
+
+    err = prepared_model_commit(&fingerprint, tmp, prepared);
+    if (err != PREPARED_MODEL_OK) {
+        fprintf(stderr, "[sd] WARN: saving %s failed (%s), loading source\n", prepared,
+                prepared_model_error_string(err));
+        return source_path;
+    }
+
+    return std::string(prepared);
+}
+
+/**
+ * Point ctx->load_config at prepared copies of every configured weight file.
+ *
+ * @throws std::bad_alloc (the caller falls back to the source files)
+ */
+static void sd_wrapper_prepare_weights(sd_wrapper_ctx_t* ctx) {
+    const char** paths[] = {
+        &ctx->load_config.model_path,
+        &ctx->load_config.clip_l_path,
+        &ctx->load_config.clip_g_path,
+        &ctx->load_config.t5xxl_path,
+        &ctx->load_config.vae_path,
+    };
+    static_assert(sizeof(paths) / sizeof(paths[0]) ==
+                      sizeof(ctx->prepared_paths) / sizeof(ctx->prepared_paths[0]),
+                  "one prepared path per weight file");
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        if (*paths[i] == NULL) {
+            continue;
+        }
+        ctx->prepared_paths[i] = sd_wrapper_prepare_file(*paths[i],
+                                                         ctx->load_config.weight_type);
+        *paths[i] = ctx->prepared_paths[i].c_str();
+    }
+}
+
+/**
+ * Register a progress callback for subsequent generations.
+ */
+sd_wrapper_error_t sd_wrapper_set_progress_callback(sd_wrapper_ctx_t* ctx,
+                                                     sd_wrapper_progress_fn fn,
+                                                     void* user_data,
+                                                     uint32_t preview_interval) {
+    if (ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    ctx->progress_fn = fn;
+    ctx->progress_user_data = user_data;
+    ctx->preview_interval = fn != NULL ? preview_interval : 0;
+
+    sd_wrapper_install_callbacks(ctx);
+    return SD_WRAPPER_OK;
+}
+
+/**
+ * Register an abort callback for subsequent generations.
+ */
+sd_wrapper_error_t sd_wrapper_set_abort_callback(sd_wrapper_ctx_t* ctx,
+                                                  sd_wrapper_abort_fn fn,
+                                                  void* user_data) {
+    if (ctx == NULL) {
+        return SD_WRAPPER_ERR_INVALID_PARAM;
+    }
+
+    ctx->abort_fn = fn;
+    ctx->abort_user_data = user_data;
+
+    sd_wrapper_install_callbacks(ctx);
     return SD_WRAPPER_OK;
 }
 
+/**
+ * Update stable-diffusion.cpp's process-wide callbacks after ctx changed.
+ *
+ * The step callback serves progress reporting, abort polling and step
+ * timing for every context and is installed with the first context; it
+ * finds its context through t_generating_ctx. Previews cost a latent projection per interval, so the
+ * preview callback is installed only while some context wants previews.
+ */
+static void sd_wrapper_install_callbacks(sd_wrapper_ctx_t* ctx) {
+    bool wants_previews = ctx->progress_fn != NULL && ctx->preview_interval > 0;
+
+    std::lock_guard<std::mutex> lock(g_callback_lock);
+
+    sd_set_progress_callback(sd_wrapper_progress_callback, NULL);
+
+    if (wants_previews != ctx->has_previews) {
+        ctx->has_previews = wants_previews;
+        if (wants_previews) {
+            g_preview_users++;
+        } else {
+            g_preview_users--;
+        }
+    }
+
+    if (wants_previews) {
+        /* PREVIEW_PROJ maps latents to RGB with a fixed linear projection */
+        sd_set_preview_callback(sd_wrapper_preview_callback, PREVIEW_PROJ,
+                                (int)ctx->preview_interval, true, false, NULL);
+    } else if (g_preview_users == 0) {
+        sd_set_preview_callback(NULL, PREVIEW_NONE, 0, false, false, NULL);
+    }
+}
+
+/**
+ * Poll the abort callback, latching the result for the running generation.
+ */
+static bool sd_wrapper_check_abort(sd_wrapper_ctx_t* ctx) {
+    if (!ctx->aborted && ctx->abort_fn != NULL && ctx->abort_fn(ctx->abort_user_data)) {
+        ctx->aborted = true;
+    }
+
+    return ctx->aborted;
+}
+
+/**
+ * Step progress callback for stable-diffusion.cpp.
+ */
+static void sd_wrapper_progress_callback(int step, int steps, float time, void* data) {
+    (void)data; /* Process-wide registration; see t_generating_ctx */
+
+    sd_wrapper_ctx_t* ctx = t_generating_ctx;
+    if (ctx == NULL || step < 0 || steps <= 0) {
+        return;
+    }
+
+    /* Ignore non-sampling progress (tensor loading, tiled VAE) */
+    if ((uint32_t)steps != ctx->progress_steps) {
+        return;
+    }
+
+    /* time is this step's duration in seconds, measured by the sampler */
+    uint64_t now_us = sd_wrapper_now_us();
+    uint64_t step_us = time > 0.0f ? (uint64_t)((double)time * 1e6) : 0;
+    if (step_us > now_us - ctx->run_start_us) {
+        step_us = now_us - ctx->run_start_us;
+    }
+    if (ctx->run_first_step_us == 0) {
+        ctx->run_first_step_us = now_us - step_us;
+    }
+    ctx->run_last_step_us = now_us;
+    if (ctx->timings.step_count < SD_WRAPPER_MAX_TIMED_STEPS) {
+        ctx->timings.step_us[ctx->timings.step_count++] =
+            step_us > UINT32_MAX ? UINT32_MAX : (uint32_t)step_us;
+    }
+
+    /* Nothing more is reported for an abandoned generation */
+    if (sd_wrapper_check_abort(ctx) || ctx->progress_fn == NULL) {
+        return;
+    }
+
+    sd_wrapper_progress_t progress;
+    progress.step = (uint32_t)step;
+    progress.total_steps = (uint32_t)steps;
+    progress.preview = NULL;
+
+    ctx->progress_fn(&progress, ctx->progress_user_data);
+}
+
+/**
+ * Latent preview callback for stable-diffusion.cpp.
+ */
+static void sd_wrapper_preview_callback(int step, int frame_count, sd_image_t* frames,
+                                        bool is_noisy, void* data) {
+    (void)is_noisy; /* Only denoised previews are requested */
+    (void)data;     /* Process-wide registration; see t_generating_ctx */
+
+    sd_wrapper_ctx_t* ctx = t_generating_ctx;
+    if (ctx == NULL || ctx->progress_fn == NULL || !ctx->has_previews || ctx->aborted || step < 0 ||
+        frame_count < 1 || frames == NULL || frames[0].data == NULL) {
+        return;
+    }
+
+    sd_wrapper_image_t preview;
+    preview.width = frames[0].width;
+    preview.height = frames[0].height;
+    preview.channels = frames[0].channel;
+    preview.data = frames[0].data;
+    preview.data_size = (size_t)frames[0].width * frames[0].height * frames[0].channel;
+
+    sd_wrapper_progress_t progress;
+    progress.step = (uint32_t)step;
+    progress.total_steps = ctx->progress_steps;
+    progress.preview = &preview;
+
+    ctx->progress_fn(&progress, ctx->progress_user_data);
+}
+
 /**
  * Logging callback for stable-diffusion.cpp.
  */
 static void sd_wrapper_log_callback(enum sd_log_level_t level,
                                      const char* text,
                                      void* data) {
-    (void)data; /* Unused for now */
+    (void)data; /* Process-wide; the generating thread's context is t_generating_ctx */
+
+    /*
+     * stable-diffusion.cpp reports a failed allocation (weights, compute or
+     * VAE buffers) only through the log before generate_image() returns
+     * NULL. Remember it so the failure is reported as out of memory.
+     */
+    if (level == SD_LOG_ERROR && t_generating_ctx != NULL && text != NULL &&
+        strstr(text, "alloc") != NULL && strstr(text, "fail") != NULL) {
+        t_generating_ctx->out_of_memory = true;
+    }
 
     /* Map SD log levels to stderr output */
     const char* level_str = "INFO";
@@ -0,0 +1,178 @@
+/**
+ * Weave Server Stats Module - Implementation
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <string.h>
+
+#include "weave/server_stats.h"
+
+server_stats_error_t server_stats_init(server_stats_t *s, int workers) {
+    admission_error_t adm_err;
+
+    if (s == NULL) {
+        return SERVER_STATS_ERR_NULL_POINTER;
+    }
+    if (workers < 1) {
+        return SERVER_STATS_ERR_INVALID_ARG;
+    }
+
+    if (stats_init(&s->stats) != STATS_OK) {
+        return SERVER_STATS_ERR_INIT_FAILED;
+    }
+    adm_err = admission_init(&s->admission, workers);
+    if (adm_err != ADMISSION_OK) {
+        stats_destroy(&s->stats);
+        return SERVER_STATS_ERR_INIT_FAILED;
+    }
+    return SERVER_STATS_OK;
+}
+
+void server_stats_destroy(server_stats_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    admission_destroy(&s->admission);
+    stats_destroy(&s->stats);
+}
+
+void server_stats_received(server_stats_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    stats_request_received(&s->stats);
+}
+
+/**
+ * Microseconds left until deadline, at least 1 so a request already past
+ * it still has a budget, just one nothing fits in.
+ */
+static uint64_t budget_until(const struct timespec *deadline) {
+    struct timespec now;
+    int64_t us;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    us = (int64_t)(deadline->tv_sec - now.tv_sec) * 1000000 +
+         (deadline->tv_nsec - now.tv_nsec) / 1000;
+    return us > 0 ? (uint64_t)us : 1;
+}
+
+server_stats_error_t server_stats_admit(server_stats_t *s, const sd35_generate_request_t *req,
+                                        uint32_t images, const struct timespec *deadline,
+                                        server_stats_ticket_t *ticket, uint64_t *wait_us) {
+    admission_error_t err;
+
+    if (s == NULL || req == NULL || ticket == NULL) {
+        return SERVER_STATS_ERR_NULL_POINTER;
+    }
+
+    ticket->priority = req->priority;
+    ticket->units = admission_request_units(req, images);
+
+    err = admission_enqueue(&s->admission, ticket->priority, ticket->units,
+                            deadline != NULL ? budget_until(deadline) : 0, wait_us);
+    switch (err) {
+    case ADMISSION_OK:
+        return SERVER_STATS_OK;
+    case ADMISSION_ERR_BUSY:
+        return SERVER_STATS_ERR_BUSY;
+    case ADMISSION_ERR_NULL_POINTER:
+        return SERVER_STATS_ERR_NULL_POINTER;
+    default:
+        return SERVER_STATS_ERR_INVALID_ARG;
+    }
+}
+
+void server_stats_answered(server_stats_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    /* Through both gauges, so they return to zero when idle */
+    stats_request_started(&s->stats);
+    stats_request_generated(&s->stats);
+}
+
+void server_stats_started(server_stats_t *s, const server_stats_ticket_t *ticket) {
+    if (s == NULL) {
+        return;
+    }
+    stats_request_started(&s->stats);
+    if (ticket != NULL) {
+        admission_start(&s->admission, ticket->priority, ticket->units);
+    }
+}
+
+void server_stats_generated(server_stats_t *s, const server_stats_ticket_t *ticket,
+                            const sd35_generate_timings_t *timings) {
+    uint64_t gpu_us = 0;
+
+    if (s == NULL) {
+        return;
+    }
+    stats_request_generated(&s->stats);
+    if (ticket == NULL) {
+        return;
+    }
+
+    /* Only a completed generation says how fast the device is */
+    if (timings != NULL) {
+        for (int stage = TIMING_STAGE_RESET; stage <= TIMING_STAGE_VAE_DECODE; stage++) {
+            gpu_us += timings->stage_us[stage];
+        }
+    }
+    admission_finish(&s->admission, ticket->units, gpu_us);
+}
+
+void server_stats_finished(server_stats_t *s, error_code_t error,
+                           const sd35_generate_timings_t *timings) {
+    if (s == NULL) {
+        return;
+    }
+    stats_request_finished(&s->stats, error, timings);
+}
+
+void server_stats_set_vram(server_stats_t *s, int device, size_t bytes) {
+    if (s == NULL) {
+        return;
+    }
+    stats_set_vram(&s->stats, device, bytes);
+}
+
+server_stats_error_t server_stats_snapshot(server_stats_t *s, uint64_t request_id,
+                                           buffer_pool_t *pool, stats_response_t *resp) {
+    buffer_pool_stats_t pool_stats;
+
+    if (s == NULL || resp == NULL) {
+        return SERVER_STATS_ERR_NULL_POINTER;
+    }
+
+    if (stats_snapshot(&s->stats, request_id, resp) != STATS_OK) {
+        return SERVER_STATS_ERR_NULL_POINTER;
+    }
+    if (buffer_pool_get_stats(pool, &pool_stats) == BUFFER_POOL_OK) {
+        resp->pool_hits = pool_stats.hits;
+        resp->pool_misses = pool_stats.misses;
+        resp->pool_idle_bytes = pool_stats.idle_bytes;
+    }
+    admission_snapshot(&s->admission, resp->class_queue_depth, resp->class_wait_ms);
+    return SERVER_STATS_OK;
+}
+
+const char *server_stats_error_string(server_stats_error_t err) {
+    switch (err) {
+    case SERVER_STATS_OK:
+        return "success";
+    case SERVER_STATS_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case SERVER_STATS_ERR_INVALID_ARG:
+        return "invalid argument";
+    case SERVER_STATS_ERR_INIT_FAILED:
+        return "failed to initialize mutex";
+    case SERVER_STATS_ERR_BUSY:
+        return "estimated wait exceeds the deadline";
+    default:
+        return "unknown error";
+    }
+}
@@ -23,9 +23,13 @@
 #include <errno.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
@@ -62,6 +66,13 @@ static volatile sig_atomic_t g_shutdown_requested = 0;
 #define DEFAULT_READ_TIMEOUT_S 60
 #define DEFAULT_WRITE_TIMEOUT_S 5
 
+/**
+ * socket_event_loop() tuning: the longest epoll_wait() between shutdown
+ * checks, and how many events one wait returns.
+ */
+#define EVENT_LOOP_WAIT_MS 500
+#define EVENT_LOOP_MAX_EVENTS 16
+
 /**
  * Logging infrastructure.
  * Default log level is INFO, which means DEBUG messages are not shown.
@@ -507,6 +518,12 @@ const char *socket_error_string(socket_error_t err) {
             return "null handler provided to accept loop";
         case SOCKET_ERR_CONNECT_FAILED:
             return "failed to connect to socket";
+        case SOCKET_ERR_SHM_FAILED:
+            return "failed to create shared memory";
+        case SOCKET_ERR_SEND_FAILED:
+            return "failed to send on socket";
+        case SOCKET_ERR_EPOLL_FAILED:
+            return "epoll failed";
         default:
             return "unknown error";
     }
@@ -691,3 +708,273 @@ socket_error_t socket_accept_loop(int listen_fd, socket_connection_handler_t han
     socket_log(SOCKET_LOG_INFO, "accept loop stopped (shutdown requested)");
     return SOCKET_OK;
 }
+
+/**
+ * One open connection in socket_event_loop(). fd is -1 when the slot is free.
+ * epoll events carry a pointer to the slot; the listening socket's carry NULL.
+ */
+typedef struct {
+    int fd;
+    void *conn;
+} event_slot_t;
+
+/**
+ * event_loop_drop - Stop watching a connection and hand it to close
+ */
+static void event_loop_drop(int epoll_fd, event_slot_t *slot,
+                            const socket_event_handlers_t *handlers, void *user_data) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, slot->fd, NULL);
+    handlers->close(slot->conn, user_data);
+    slot->fd = -1;
+    slot->conn = NULL;
+}
+
+/**
+ * event_loop_accept - Accept one pending connection into a free slot
+ *
+ * @return SOCKET_OK unless accept() failed with a non-transient error
+ */
+static socket_error_t event_loop_accept(int listen_fd, int epoll_fd, event_slot_t *slots,
+                                        const socket_event_handlers_t *handlers,
+                                        void *user_data) {
+    event_slot_t *slot = NULL;
+    struct epoll_event ev;
+
+    int client_fd = accept(listen_fd, NULL, NULL);
+    if (client_fd < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ||
+            errno == ECONNABORTED) {
+            return SOCKET_OK;
+        }
+        socket_log(SOCKET_LOG_ERROR, "accept() failed: %s", strerror(errno));
+        return SOCKET_ERR_ACCEPT_FAILED;
+    }
+
+    if (socket_auth_connection(client_fd) != SOCKET_OK) {
+        close(client_fd);
+        return SOCKET_OK;
+    }
+
+    if (socket_set_timeouts(client_fd, DEFAULT_READ_TIMEOUT_S,
+                            DEFAULT_WRITE_TIMEOUT_S) != SOCKET_OK) {
+        socket_log(SOCKET_LOG_WARN, "failed to set client timeouts, continuing anyway");
+    }
+
+    for (int i = 0; i < SOCKET_MAX_CONNECTIONS; i++) {
+        if (slots[i].fd < 0) {
+            slot = &slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        socket_log(SOCKET_LOG_WARN, "refusing connection: %d already open",
+                   SOCKET_MAX_CONNECTIONS);
+        close(client_fd);
+        return SOCKET_OK;
+    }
+
+    void *conn = handlers->open(client_fd, user_data);
+    if (conn == NULL) {
+        close(client_fd);
+        return SOCKET_OK;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = slot;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) != 0) {
+        socket_log(SOCKET_LOG_ERROR, "epoll_ctl() failed: %s", strerror(errno));
+        handlers->close(conn, user_data);
+        return SOCKET_OK;
+    }
+
+    slot->fd = client_fd;
+    slot->conn = conn;
+    socket_log(SOCKET_LOG_DEBUG, "connection opened");
+    return SOCKET_OK;
+}
+
+/**
+ * socket_event_loop - Serve many connections at once from one thread
+ */
+socket_error_t socket_event_loop(int listen_fd, const socket_event_handlers_t *handlers,
+                                 void *user_data) {
+    event_slot_t slots[SOCKET_MAX_CONNECTIONS];
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    struct epoll_event ev;
+    socket_error_t err = SOCKET_OK;
+
+    if (listen_fd < 0) {
+        return SOCKET_ERR_INVALID_FD;
+    }
+
+    if (handlers == NULL || handlers->open == NULL || handlers->readable == NULL ||
+        handlers->close == NULL) {
+        return SOCKET_ERR_NULL_HANDLER;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        socket_log(SOCKET_LOG_ERROR, "epoll_create1() failed: %s", strerror(errno));
+        return SOCKET_ERR_EPOLL_FAILED;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) != 0) {
+        socket_log(SOCKET_LOG_ERROR, "epoll_ctl() failed: %s", strerror(errno));
+        close(epoll_fd);
+        return SOCKET_ERR_EPOLL_FAILED;
+    }
+
+    for (int i = 0; i < SOCKET_MAX_CONNECTIONS; i++) {
+        slots[i].fd = -1;
+        slots[i].conn = NULL;
+    }
+
+    socket_log(SOCKET_LOG_INFO, "event loop started");
+
+    while (!g_shutdown_requested && err == SOCKET_OK) {
+        int n = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, EVENT_LOOP_WAIT_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            socket_log(SOCKET_LOG_ERROR, "epoll_wait() failed: %s", strerror(errno));
+            err = SOCKET_ERR_EPOLL_FAILED;
+            break;
+        }
+
+        for (int i = 0; i < n && err == SOCKET_OK; i++) {
+            event_slot_t *slot = events[i].data.ptr;
+
+            if (slot == NULL) {
+                err = event_loop_accept(listen_fd, epoll_fd, slots, handlers, user_data);
+                continue;
+            }
+
+            if (handlers->readable(slot->conn, user_data) != 0) {
+                socket_log(SOCKET_LOG_DEBUG, "connection closed");
+                event_loop_drop(epoll_fd, slot, handlers, user_data);
+            }
+        }
+    }
+
+    for (int i = 0; i < SOCKET_MAX_CONNECTIONS; i++) {
+        if (slots[i].fd >= 0) {
+            event_loop_drop(epoll_fd, &slots[i], handlers, user_data);
+        }
+    }
+    close(epoll_fd);
+
+    if (err == SOCKET_OK) {
+        socket_log(SOCKET_LOG_INFO, "event loop stopped (shutdown requested)");
+    }
+    return err;
+}
+
+/**
+ * socket_create_shm - Copy buffers into a sealed anonymous memory file
+ */
+socket_error_t socket_create_shm(const struct iovec *iov, int iovcnt, int *shm_fd) {
+    if (iov == NULL || shm_fd == NULL) {
+        return SOCKET_ERR_NULL_POINTER;
+    }
+
+    int memfd = memfd_create("weave-image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0) {
+        socket_log(SOCKET_LOG_ERROR, "memfd_create() failed: %s", strerror(errno));
+        return SOCKET_ERR_SHM_FAILED;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        const uint8_t *ptr = (const uint8_t *)iov[i].iov_base;
+        size_t remaining = iov[i].iov_len;
+
+        while (remaining > 0) {
+            ssize_t n = write(memfd, ptr, remaining);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                socket_log(SOCKET_LOG_ERROR, "write to memfd failed: %s", strerror(errno));
+                close(memfd);
+                return SOCKET_ERR_SHM_FAILED;
+            }
+            ptr += n;
+            remaining -= (size_t)n;
+        }
+    }
+
+    /* Receiver may rely on the size and contents staying fixed */
+    if (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        socket_log(SOCKET_LOG_ERROR, "sealing memfd failed: %s", strerror(errno));
+        close(memfd);
+        return SOCKET_ERR_SHM_FAILED;
+    }
+
+    *shm_fd = memfd;
+    return SOCKET_OK;
+}
+
+/**
+ * socket_send_with_fd - Send a buffer with a file descriptor attached
+ */
+socket_error_t socket_send_with_fd(int fd, const void *buf, size_t len, int pass_fd) {
+    if (fd < 0 || pass_fd < 0) {
+        return SOCKET_ERR_INVALID_FD;
+    }
+    if (buf == NULL || len == 0) {
+        return SOCKET_ERR_NULL_POINTER;
+    }
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct iovec iov;
+    iov.iov_base = (void *)buf;
+    iov.iov_len = len;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(fd, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        socket_log(SOCKET_LOG_ERROR, "sendmsg() failed: %s", strerror(errno));
+        return SOCKET_ERR_SEND_FAILED;
+    }
+
+    /* Descriptor went with the first chunk; send the remainder plainly */
+    const uint8_t *ptr = (const uint8_t *)buf + n;
+    size_t remaining = len - (size_t)n;
+    while (remaining > 0) {
+        n = write(fd, ptr, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SOCKET_ERR_SEND_FAILED;
+        }
+        ptr += n;
+        remaining -= (size_t)n;
+    }
+
+    return SOCKET_OK;
+}
@@ -0,0 +1,169 @@
+/**
+ * Weave Stats Module - Implementation
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <string.h>
+
+#include "weave/stats.h"
+
+/**
+ * Inclusive upper bound of each histogram bucket in microseconds
+ */
+static const uint64_t k_bucket_bounds_us[STATS_HISTOGRAM_BUCKETS] = {
+    1000,     5000,     10000,    50000,    100000,   250000,   500000,
+    1000000,  2500000,  5000000,  10000000, 30000000, 60000000, UINT64_MAX,
+};
+
+stats_error_t stats_init(stats_t *stats) {
+    if (stats == NULL) {
+        return STATS_ERR_NULL_POINTER;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    if (pthread_mutex_init(&stats->lock, NULL) != 0) {
+        return STATS_ERR_INIT_FAILED;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stats->start);
+    return STATS_OK;
+}
+
+void stats_destroy(stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&stats->lock);
+}
+
+void stats_request_received(stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&stats->lock);
+    stats->requests++;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_request_started(stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&stats->lock);
+    stats->started++;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_request_generated(stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&stats->lock);
+    stats->generated++;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+uint32_t stats_bucket_index(uint64_t duration_us) {
+    uint32_t i = 0;
+
+    while (i < STATS_HISTOGRAM_BUCKETS - 1 && duration_us > k_bucket_bounds_us[i]) {
+        i++;
+    }
+    return i;
+}
+
+void stats_request_finished(stats_t *stats, error_code_t error,
+                            const sd35_generate_timings_t *timings) {
+    uint32_t code;
+
+    if (stats == NULL) {
+        return;
+    }
+
+    code = (uint32_t)error <= ERR_INTERNAL ? (uint32_t)error : ERR_INTERNAL;
+
+    pthread_mutex_lock(&stats->lock);
+    if (code == ERR_NONE) {
+        stats->completed++;
+    } else {
+        stats->error_counts[code]++;
+    }
+
+    if (timings != NULL) {
+        for (uint32_t stage = 0; stage < TIMING_STAGE_COUNT; stage++) {
+            stats_histogram_t *hist = &stats->histograms[stage];
+            uint64_t us = timings->stage_us[stage];
+
+            hist->count++;
+            hist->sum_us += us;
+            hist->buckets[stats_bucket_index(us)]++;
+        }
+    }
+    pthread_mutex_unlock(&stats->lock);
+}
+
+void stats_set_vram(stats_t *stats, int device, size_t bytes) {
+    if (stats == NULL || device < 0 || device >= STATS_MAX_DEVICES) {
+        return;
+    }
+    pthread_mutex_lock(&stats->lock);
+    stats->vram_bytes[device] = bytes;
+    pthread_mutex_unlock(&stats->lock);
+}
+
+stats_error_t stats_snapshot(stats_t *stats, uint64_t request_id, stats_response_t *resp) {
+    struct timespec now;
+    int64_t uptime_ms;
+
+    if (stats == NULL || resp == NULL) {
+        return STATS_ERR_NULL_POINTER;
+    }
+
+    memset(resp, 0, sizeof(*resp));
+    resp->request_id = request_id;
+    resp->status = STATUS_OK;
+    memcpy(resp->bucket_bounds_us, k_bucket_bounds_us, sizeof(k_bucket_bounds_us));
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&stats->lock);
+    uptime_ms = (int64_t)(now.tv_sec - stats->start.tv_sec) * 1000 +
+                (now.tv_nsec - stats->start.tv_nsec) / 1000000;
+    resp->uptime_ms = uptime_ms > 0 ? (uint64_t)uptime_ms : 0;
+    resp->requests = stats->requests;
+    resp->completed = stats->completed;
+    resp->queue_depth = (uint32_t)(stats->requests - stats->started);
+    resp->in_flight = (uint32_t)(stats->started - stats->generated);
+
+    for (int i = 0; i < STATS_MAX_DEVICES; i++) {
+        resp->vram_bytes += stats->vram_bytes[i];
+    }
+
+    for (uint32_t code = 0; code <= ERR_INTERNAL && resp->error_count < STATS_MAX_ERROR_CODES;
+         code++) {
+        if (stats->error_counts[code] > 0) {
+            resp->errors[resp->error_count].code = code;
+            resp->errors[resp->error_count].count = stats->error_counts[code];
+            resp->error_count++;
+        }
+    }
+
+    memcpy(resp->histograms, stats->histograms, sizeof(stats->histograms));
+    pthread_mutex_unlock(&stats->lock);
+
+    return STATS_OK;
+}
+
+const char *stats_error_string(stats_error_t err) {
+    switch (err) {
+    case STATS_OK:
+        return "success";
+    case STATS_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case STATS_ERR_INIT_FAILED:
+        return "failed to initialize mutex";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * Weave VRAM Plan Module - Implementation
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "weave/vram_plan.h"
+
+/** Pixels per megapixel for the per-MP estimates */
+#define PIXELS_PER_MP ((uint64_t)1024 * 1024)
+
+/**
+ * Configurations from fastest to most frugal
+ */
+static const struct {
+    vram_plan_wtype_t wtype;
+    bool keep_clip_on_cpu;
+    bool keep_vae_on_cpu;
+} k_ladder[] = {
+    {VRAM_PLAN_WTYPE_F16, false, false},
+    {VRAM_PLAN_WTYPE_F16, true, false},
+    {VRAM_PLAN_WTYPE_Q8_0, true, false},
+    {VRAM_PLAN_WTYPE_Q4_0, true, false},
+    {VRAM_PLAN_WTYPE_Q4_0, true, true},
+};
+
+#define LADDER_SIZE (sizeof(k_ladder) / sizeof(k_ladder[0]))
+
+/**
+ * quantized_bytes - Size of F16 weights after conversion to wtype
+ *
+ * Q8_0 and Q4_0 store 32 weights in 34 and 18 bytes against 64 for F16.
+ */
+static uint64_t quantized_bytes(uint64_t f16_bytes, vram_plan_wtype_t wtype) {
+    switch (wtype) {
+    case VRAM_PLAN_WTYPE_Q8_0:
+        return f16_bytes / 64 * 34;
+    case VRAM_PLAN_WTYPE_Q4_0:
+        return f16_bytes / 64 * 18;
+    case VRAM_PLAN_WTYPE_F16:
+    default:
+        return f16_bytes;
+    }
+}
+
+static uint64_t per_mp(size_t bytes_per_mp, uint32_t pixels) {
+    return (uint64_t)bytes_per_mp * pixels / PIXELS_PER_MP;
+}
+
+static uint64_t max_u64(uint64_t a, uint64_t b) {
+    return a > b ? a : b;
+}
+
+void vram_plan_input_init(vram_plan_input_t *input) {
+    if (input == NULL) {
+        return;
+    }
+    memset(input, 0, sizeof(*input));
+    input->reserve_bytes = VRAM_PLAN_DEFAULT_RESERVE_BYTES;
+}
+
+/**
+ * try_rung - Evaluate one ladder configuration
+ *
+ * @return true if it fits, with plan filled in either way
+ */
+static bool try_rung(const vram_plan_input_t *input, size_t rung, vram_plan_t *plan) {
+    uint64_t avail = 0;
+    uint64_t weights;
+    uint64_t compute;
+    uint64_t vae_untiled;
+    bool fits;
+
+    if (input->vram_free > input->reserve_bytes) {
+        avail = (uint64_t)(input->vram_free - input->reserve_bytes);
+    }
+
+    plan->wtype = k_ladder[rung].wtype;
+    plan->keep_clip_on_cpu = k_ladder[rung].keep_clip_on_cpu;
+    plan->keep_vae_on_cpu = k_ladder[rung].keep_vae_on_cpu;
+    plan->vae_tile_pixels = 0;
+
+    weights = quantized_bytes(input->diffusion_bytes, plan->wtype);
+    compute = VRAM_PLAN_DIFFUSION_BASE_BYTES + per_mp(VRAM_PLAN_DIFFUSION_PER_MP_BYTES,
+                                                      input->max_pixels);
+    if (!plan->keep_clip_on_cpu) {
+        weights += quantized_bytes(input->text_encoder_bytes, plan->wtype);
+        compute = max_u64(compute, VRAM_PLAN_TEXT_ENCODER_BYTES);
+    }
+
+    if (!plan->keep_vae_on_cpu) {
+        weights += input->vae_bytes;
+        vae_untiled = per_mp(VRAM_PLAN_VAE_PER_MP_BYTES, input->max_pixels);
+
+        if (weights + max_u64(compute, vae_untiled) > avail &&
+            weights + compute <= avail) {
+            /* Decode the largest images in tiles, smaller ones in one pass */
+            uint64_t room = avail - weights;
+            uint64_t pixels = room * PIXELS_PER_MP / VRAM_PLAN_VAE_PER_MP_BYTES;
+
+            plan->vae_tile_pixels = pixels > 0 ? (uint32_t)pixels : 1;
+            compute = max_u64(compute, VRAM_PLAN_VAE_TILED_BYTES);
+        } else {
+            compute = max_u64(compute, vae_untiled);
+        }
+    }
+
+    fits = weights + compute <= avail;
+    plan->weight_bytes = (size_t)weights;
+    plan->peak_bytes = (size_t)(weights + compute);
+    return fits;
+}
+
+vram_plan_error_t vram_plan_choose(const vram_plan_input_t *input, vram_plan_t *plan) {
+    if (input == NULL || plan == NULL) {
+        return VRAM_PLAN_ERR_NULL_POINTER;
+    }
+    if (input->max_pixels == 0) {
+        return VRAM_PLAN_ERR_INVALID;
+    }
+
+    for (size_t i = 0; i < LADDER_SIZE; i++) {
+        if (try_rung(input, i, plan)) {
+            return VRAM_PLAN_OK;
+        }
+    }
+
+    /* plan holds the last (most frugal) rung */
+    return VRAM_PLAN_ERR_NO_FIT;
+}
+
+const char *vram_plan_wtype_name(vram_plan_wtype_t wtype) {
+    switch (wtype) {
+    case VRAM_PLAN_WTYPE_F16:
+        return "f16";
+    case VRAM_PLAN_WTYPE_Q8_0:
+        return "q8_0";
+    case VRAM_PLAN_WTYPE_Q4_0:
+        return "q4_0";
+    default:
+        return "unknown";
+    }
+}
+
+const char *vram_plan_error_string(vram_plan_error_t err) {
+    switch (err) {
+    case VRAM_PLAN_OK:
+        return "success";
+    case VRAM_PLAN_ERR_NULL_POINTER:
+        return "null pointer argument";
+    case VRAM_PLAN_ERR_INVALID:
+        return "invalid plan input";
+    case VRAM_PLAN_ERR_NO_FIT:
+        return "model does not fit in VRAM";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,268 @@
+/**
+ * Weave Admission Module - Unit Tests
+ *
+ * Tests for request costs, queue wait estimates per priority class and
+ * refusing requests that cannot meet their deadline.
+ *
+ * Test categories:
+ * - Cost tests
+ * - Estimate and admission tests
+ * - Argument and error string tests
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/admission.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/** Pixel-steps of a 100x100, 10 step request: 1 us each once calibrated */
+#define UNITS 100000
+
+/**
+ * Teach adm 1 us per pixel-step with one finished request.
+ */
+static void calibrate(admission_t *adm) {
+    admission_enqueue(adm, SD35_PRIORITY_INTERACTIVE, UNITS, 0, NULL);
+    admission_start(adm, SD35_PRIORITY_INTERACTIVE, UNITS);
+    admission_finish(adm, UNITS, UNITS);
+}
+
+/**
+ * ==========================================================================
+ * Cost Tests
+ * ==========================================================================
+ */
+
+static void test_request_units(void) {
+    sd35_generate_request_t req;
+
+    TEST("test_request_units");
+
+    memset(&req, 0, sizeof(req));
+    req.width = 512;
+    req.height = 256;
+    req.steps = 20;
+    ASSERT_TRUE(admission_request_units(&req, 1) == 512ULL * 256 * 20);
+    ASSERT_TRUE(admission_request_units(&req, 4) == 512ULL * 256 * 20 * 4);
+
+    /* A refinement runs only its share of the steps, at least one */
+    req.init_source = SD35_INIT_RETAINED;
+    req.strength = 0.25f;
+    ASSERT_TRUE(admission_request_units(&req, 1) == 512ULL * 256 * 5);
+    req.strength = 0.01f;
+    ASSERT_TRUE(admission_request_units(&req, 1) == 512ULL * 256);
+
+    ASSERT_TRUE(admission_request_units(NULL, 1) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Estimate and Admission Tests
+ * ==========================================================================
+ */
+
+static void test_unknown_cost_admits(void) {
+    admission_t adm;
+    uint64_t wait = 99;
+
+    TEST("test_unknown_cost_admits");
+
+    ASSERT_EQ(ADMISSION_OK, admission_init(&adm, 1));
+
+    /* Nothing timed yet: no estimate, every request admitted */
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_BATCH, UNITS, 1, &wait));
+        ASSERT_TRUE(wait == 0);
+    }
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_BATCH) == 0);
+
+    admission_destroy(&adm);
+    TEST_PASS();
+}
+
+static void test_wait_by_class(void) {
+    admission_t adm;
+    uint32_t depth[SD35_PRIORITY_COUNT];
+    uint32_t wait_ms[SD35_PRIORITY_COUNT];
+
+    TEST("test_wait_by_class");
+
+    ASSERT_EQ(ADMISSION_OK, admission_init(&adm, 2));
+    calibrate(&adm);
+
+    ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_BATCH, 40 * UNITS, 0, NULL));
+    ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_DRAFT, 20 * UNITS, 0, NULL));
+    ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_INTERACTIVE, 20 * UNITS, 0, NULL));
+
+    /* Each class waits only for itself and more urgent classes, over 2 workers */
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_INTERACTIVE) == 10 * UNITS);
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_DRAFT) == 20 * UNITS);
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_BATCH) == 40 * UNITS);
+
+    /* Generating work counts half */
+    admission_start(&adm, SD35_PRIORITY_INTERACTIVE, 20 * UNITS);
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_INTERACTIVE) == 5 * UNITS);
+
+    admission_snapshot(&adm, depth, wait_ms);
+    ASSERT_EQ(0, depth[SD35_PRIORITY_INTERACTIVE]);
+    ASSERT_EQ(1, depth[SD35_PRIORITY_DRAFT]);
+    ASSERT_EQ(1, depth[SD35_PRIORITY_BATCH]);
+    ASSERT_EQ(5 * UNITS / 1000, wait_ms[SD35_PRIORITY_INTERACTIVE]);
+    ASSERT_EQ(35 * UNITS / 1000, wait_ms[SD35_PRIORITY_BATCH]);
+
+    admission_destroy(&adm);
+    TEST_PASS();
+}
+
+static void test_busy_past_budget(void) {
+    admission_t adm;
+    uint64_t wait = 0;
+
+    TEST("test_busy_past_budget");
+
+    ASSERT_EQ(ADMISSION_OK, admission_init(&adm, 1));
+    calibrate(&adm);
+    ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_BATCH, 10 * UNITS, 0, NULL));
+
+    /* Wait plus its own GPU time must fit the budget */
+    ASSERT_EQ(ADMISSION_ERR_BUSY,
+              admission_enqueue(&adm, SD35_PRIORITY_BATCH, UNITS, 11 * UNITS - 1, &wait));
+    ASSERT_TRUE(wait == 10 * UNITS);
+    ASSERT_EQ(ADMISSION_OK, admission_enqueue(&adm, SD35_PRIORITY_BATCH, UNITS, 11 * UNITS, NULL));
+
+    /* An interactive request does not wait for the batch work */
+    ASSERT_EQ(ADMISSION_OK,
+              admission_enqueue(&adm, SD35_PRIORITY_INTERACTIVE, UNITS, 2 * UNITS, NULL));
+
+    /* A refused request is not counted */
+    ASSERT_EQ(ADMISSION_ERR_BUSY, admission_enqueue(&adm, SD35_PRIORITY_DRAFT, UNITS, 1, NULL));
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_DRAFT) == UNITS);
+
+    admission_destroy(&adm);
+    TEST_PASS();
+}
+
+static void test_moving_average(void) {
+    admission_t adm;
+
+    TEST("test_moving_average");
+
+    ASSERT_EQ(ADMISSION_OK, admission_init(&adm, 1));
+    calibrate(&adm);
+
+    /* A failed request leaves the average alone */
+    admission_enqueue(&adm, SD35_PRIORITY_INTERACTIVE, UNITS, 0, NULL);
+    admission_start(&adm, SD35_PRIORITY_INTERACTIVE, UNITS);
+    admission_finish(&adm, UNITS, 0);
+    admission_enqueue(&adm, SD35_PRIORITY_INTERACTIVE, UNITS, 0, NULL);
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_INTERACTIVE) == UNITS);
+
+    /* 5 us per unit moves the average a quarter of the way: 2 us */
+    admission_start(&adm, SD35_PRIORITY_INTERACTIVE, UNITS);
+    admission_finish(&adm, UNITS, 5 * UNITS);
+    admission_enqueue(&adm, SD35_PRIORITY_INTERACTIVE, UNITS, 0, NULL);
+    ASSERT_TRUE(admission_estimate_wait_us(&adm, SD35_PRIORITY_INTERACTIVE) == 2 * UNITS);
+
+    admission_destroy(&adm);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_null_arguments(void) {
+    admission_t adm;
+    uint32_t depth[SD35_PRIORITY_COUNT];
+    uint32_t wait_ms[SD35_PRIORITY_COUNT];
+
+    TEST("test_null_arguments");
+
+    ASSERT_EQ(ADMISSION_ERR_NULL_POINTER, admission_init(NULL, 1));
+    ASSERT_EQ(ADMISSION_ERR_INVALID_ARG, admission_init(&adm, 0));
+    ASSERT_EQ(ADMISSION_OK, admission_init(&adm, 1));
+    ASSERT_EQ(ADMISSION_ERR_NULL_POINTER,
+              admission_enqueue(NULL, SD35_PRIORITY_INTERACTIVE, 1, 0, NULL));
+    ASSERT_EQ(ADMISSION_ERR_INVALID_ARG, admission_enqueue(&adm, SD35_PRIORITY_COUNT, 1, 0, NULL));
+    ASSERT_TRUE(admission_estimate_wait_us(NULL, SD35_PRIORITY_INTERACTIVE) == 0);
+
+    /* Recording into NULL is a no-op; a NULL snapshot is all zeros */
+    admission_start(NULL, SD35_PRIORITY_INTERACTIVE, 1);
+    admission_finish(NULL, 1, 1);
+    memset(depth, 0xFF, sizeof(depth));
+    memset(wait_ms, 0xFF, sizeof(wait_ms));
+    admission_snapshot(NULL, depth, wait_ms);
+    ASSERT_EQ(0, depth[SD35_PRIORITY_BATCH]);
+    ASSERT_EQ(0, wait_ms[SD35_PRIORITY_BATCH]);
+    admission_destroy(NULL);
+
+    ASSERT_TRUE(strcmp(admission_error_string(ADMISSION_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(admission_error_string((admission_error_t)-100), "unknown error") == 0);
+
+    admission_destroy(&adm);
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running admission tests...\n\n");
+
+    printf("=== Cost Tests ===\n");
+    test_request_units();
+
+    printf("\n=== Estimate and Admission Tests ===\n");
+    test_unknown_cost_admits();
+    test_wait_by_class();
+    test_busy_past_budget();
+    test_moving_average();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,458 @@
+/**
+ * Weave Buffer Pool Module - Unit Tests
+ *
+ * Tests for size classes, buffer recycling, the idle byte cap, oversized
+ * buffers, the hugepage and mlock options, and concurrent use.
+ *
+ * Test categories:
+ * - Size class tests
+ * - Recycling tests
+ * - Option tests
+ * - Concurrency tests
+ * - Argument and error string tests
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/buffer_pool.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+#define MB ((size_t)1024 * 1024)
+
+/**
+ * create_pool - Create a pool with the given idle cap and options
+ */
+static buffer_pool_t *create_pool(size_t max_idle_bytes, bool hugepages, bool lock) {
+    buffer_pool_config_t config;
+    buffer_pool_t *pool = NULL;
+
+    config.max_idle_bytes = max_idle_bytes;
+    config.hugepages = hugepages;
+    config.lock = lock;
+    if (buffer_pool_create(&config, &pool) != BUFFER_POOL_OK) {
+        return NULL;
+    }
+    return pool;
+}
+
+/**
+ * ==========================================================================
+ * Size Class Tests
+ * ==========================================================================
+ */
+
+/**
+ * Test: Sizes round up to the next power of two from one page
+ */
+void test_class_sizes(void) {
+    TEST("test_class_sizes");
+
+    ASSERT_TRUE(buffer_pool_class_size(0) == BUFFER_POOL_MIN_CLASS);
+    ASSERT_TRUE(buffer_pool_class_size(1) == BUFFER_POOL_MIN_CLASS);
+    ASSERT_TRUE(buffer_pool_class_size(4096) == 4096);
+    ASSERT_TRUE(buffer_pool_class_size(4097) == 8192);
+    ASSERT_TRUE(buffer_pool_class_size(3 * MB) == 4 * MB);
+    ASSERT_TRUE(buffer_pool_class_size(BUFFER_POOL_MAX_CLASS) == BUFFER_POOL_MAX_CLASS);
+    ASSERT_TRUE(buffer_pool_class_size(BUFFER_POOL_MAX_CLASS + 1) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Recycling Tests
+ * ==========================================================================
+ */
+
+/**
+ * Test: A released buffer is handed out again for any size in its class
+ */
+void test_recycles_within_class(void) {
+    TEST("test_recycles_within_class");
+
+    buffer_pool_t *pool = create_pool(16 * MB, false, false);
+    buffer_pool_stats_t stats;
+    uint8_t *first;
+    uint8_t *second;
+    uint8_t *other;
+
+    ASSERT_TRUE(pool != NULL);
+
+    first = buffer_pool_get(pool, 5000);
+    ASSERT_TRUE(first != NULL);
+    ASSERT_TRUE((uintptr_t)first % BUFFER_POOL_MIN_CLASS == 0);
+    memset(first, 0xAB, 8192);
+    buffer_pool_put(pool, first, 5000);
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_EQ(1, stats.idle_buffers);
+    ASSERT_TRUE(stats.idle_bytes == 8192);
+
+    /* Same class (8 KiB), different size */
+    second = buffer_pool_get(pool, 8000);
+    ASSERT_TRUE(second == first);
+
+    /* Different class: allocates */
+    other = buffer_pool_get(pool, 100);
+    ASSERT_TRUE(other != NULL && other != first);
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_TRUE(stats.hits == 1);
+    ASSERT_TRUE(stats.misses == 2);
+    ASSERT_EQ(0, stats.idle_buffers);
+    ASSERT_TRUE(stats.idle_bytes == 0);
+
+    buffer_pool_put(pool, second, 8000);
+    buffer_pool_put(pool, other, 100);
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * Test: The most recently released buffer is reused first
+ */
+void test_reuses_newest_first(void) {
+    TEST("test_reuses_newest_first");
+
+    buffer_pool_t *pool = create_pool(16 * MB, false, false);
+    void *a;
+    void *b;
+
+    ASSERT_TRUE(pool != NULL);
+
+    a = buffer_pool_get(pool, MB);
+    b = buffer_pool_get(pool, MB);
+    ASSERT_TRUE(a != NULL && b != NULL);
+    buffer_pool_put(pool, a, MB);
+    buffer_pool_put(pool, b, MB);
+
+    ASSERT_TRUE(buffer_pool_get(pool, MB) == b);
+    ASSERT_TRUE(buffer_pool_get(pool, MB) == a);
+
+    buffer_pool_put(pool, a, MB);
+    buffer_pool_put(pool, b, MB);
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * Test: Releases beyond max_idle_bytes are freed, not kept
+ */
+void test_idle_cap(void) {
+    TEST("test_idle_cap");
+
+    buffer_pool_t *pool = create_pool(2 * 4096, false, false);
+    buffer_pool_stats_t stats;
+    void *bufs[3];
+
+    ASSERT_TRUE(pool != NULL);
+
+    for (int i = 0; i < 3; i++) {
+        bufs[i] = buffer_pool_get(pool, 4096);
+        ASSERT_TRUE(bufs[i] != NULL);
+    }
+    for (int i = 0; i < 3; i++) {
+        buffer_pool_put(pool, bufs[i], 4096);
+    }
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_EQ(2, stats.idle_buffers);
+    ASSERT_TRUE(stats.idle_bytes == 2 * 4096);
+    ASSERT_TRUE(stats.drops == 1);
+
+    buffer_pool_destroy(pool);
+
+    /* A zero cap keeps nothing */
+    pool = create_pool(0, false, false);
+    ASSERT_TRUE(pool != NULL);
+    bufs[0] = buffer_pool_get(pool, 4096);
+    ASSERT_TRUE(bufs[0] != NULL);
+    buffer_pool_put(pool, bufs[0], 4096);
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_EQ(0, stats.idle_buffers);
+    ASSERT_TRUE(stats.drops == 1);
+
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * Test: Buffers above the largest class are allocated and freed directly
+ */
+void test_oversized_bypasses_pool(void) {
+    TEST("test_oversized_bypasses_pool");
+
+    buffer_pool_t *pool = create_pool(256 * MB, false, false);
+    buffer_pool_stats_t stats;
+    size_t size = BUFFER_POOL_MAX_CLASS + 1;
+    uint8_t *buf;
+
+    ASSERT_TRUE(pool != NULL);
+
+    buf = buffer_pool_get(pool, size);
+    ASSERT_TRUE(buf != NULL);
+    ASSERT_TRUE((uintptr_t)buf % BUFFER_POOL_MIN_CLASS == 0);
+    buf[size - 1] = 1;
+    buffer_pool_put(pool, buf, size);
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_TRUE(stats.misses == 1);
+    ASSERT_TRUE(stats.drops == 1);
+    ASSERT_EQ(0, stats.idle_buffers);
+
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * Test: A NULL pool falls back to malloc() and free()
+ */
+void test_null_pool(void) {
+    TEST("test_null_pool");
+
+    uint8_t *buf = buffer_pool_get(NULL, 100);
+    ASSERT_TRUE(buf != NULL);
+    memset(buf, 0, 100);
+    buffer_pool_put(NULL, buf, 100);
+
+    buf = buffer_pool_get(NULL, 0);
+    ASSERT_TRUE(buf != NULL);
+    buffer_pool_put(NULL, buf, 0);
+
+    buffer_pool_put(NULL, NULL, 100);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Option Tests
+ * ==========================================================================
+ */
+
+/**
+ * Test: With hugepages, large classes are hugepage-aligned and small ones are not padded
+ */
+void test_hugepage_alignment(void) {
+    TEST("test_hugepage_alignment");
+
+    buffer_pool_t *pool = create_pool(16 * MB, true, false);
+    uint8_t *large;
+    uint8_t *small;
+
+    ASSERT_TRUE(pool != NULL);
+
+    large = buffer_pool_get(pool, 3 * MB);
+    small = buffer_pool_get(pool, 4096);
+    ASSERT_TRUE(large != NULL && small != NULL);
+    ASSERT_TRUE((uintptr_t)large % BUFFER_POOL_HUGEPAGE_SIZE == 0);
+    ASSERT_TRUE((uintptr_t)small % BUFFER_POOL_MIN_CLASS == 0);
+    memset(large, 0x11, 4 * MB);
+
+    buffer_pool_put(pool, large, 3 * MB);
+    ASSERT_TRUE(buffer_pool_get(pool, 4 * MB) == large);
+
+    buffer_pool_put(pool, large, 4 * MB);
+    buffer_pool_put(pool, small, 4096);
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * Test: With lock, buffers work whether or not RLIMIT_MEMLOCK allows locking them
+ */
+void test_lock_option(void) {
+    TEST("test_lock_option");
+
+    buffer_pool_t *pool = create_pool(16 * MB, false, true);
+    buffer_pool_stats_t stats;
+    uint8_t *bufs[4];
+
+    ASSERT_TRUE(pool != NULL);
+
+    for (int i = 0; i < 4; i++) {
+        bufs[i] = buffer_pool_get(pool, MB);
+        ASSERT_TRUE(bufs[i] != NULL);
+        memset(bufs[i], i, MB);
+    }
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_TRUE(stats.lock_failures <= 4);
+    ASSERT_TRUE(stats.misses == 4);
+
+    for (int i = 0; i < 4; i++) {
+        buffer_pool_put(pool, bufs[i], MB);
+    }
+    ASSERT_TRUE(buffer_pool_get(pool, MB) == bufs[3]);
+    buffer_pool_put(pool, bufs[3], MB);
+
+    /* Destroy munlocks and frees the idle buffers */
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Concurrency Tests
+ * ==========================================================================
+ */
+
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_ROUNDS 2000
+
+static void *get_put_worker(void *arg) {
+    buffer_pool_t *pool = arg;
+
+    for (int i = 0; i < CONCURRENT_ROUNDS; i++) {
+        size_t size = (size_t)4096 << (i % 4);
+        uint8_t *buf = buffer_pool_get(pool, size);
+        if (buf == NULL) {
+            return NULL;
+        }
+        buf[0] = (uint8_t)i;
+        buf[size - 1] = (uint8_t)i;
+        buffer_pool_put(pool, buf, size);
+    }
+    return pool;
+}
+
+/**
+ * Test: Threads sharing a pool never hand out one buffer twice
+ */
+void test_concurrent_get_put(void) {
+    TEST("test_concurrent_get_put");
+
+    buffer_pool_t *pool = create_pool(16 * MB, false, false);
+    pthread_t threads[CONCURRENT_THREADS];
+    buffer_pool_stats_t stats;
+    int ok = 1;
+
+    ASSERT_TRUE(pool != NULL);
+
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, get_put_worker, pool));
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        void *result;
+        pthread_join(threads[i], &result);
+        ok = ok && result == pool;
+    }
+    ASSERT_TRUE(ok);
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_get_stats(pool, &stats));
+    ASSERT_TRUE(stats.hits + stats.misses == (uint64_t)CONCURRENT_THREADS * CONCURRENT_ROUNDS);
+    /* At most one buffer per thread per class is ever live at once */
+    ASSERT_TRUE(stats.misses <= (uint64_t)CONCURRENT_THREADS * 4);
+    ASSERT_TRUE(stats.drops == 0);
+    ASSERT_TRUE(stats.idle_buffers == stats.misses);
+
+    buffer_pool_destroy(pool);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+/**
+ * Test: NULL arguments are rejected
+ */
+void test_null_arguments(void) {
+    TEST("test_null_arguments");
+
+    buffer_pool_config_t config;
+    buffer_pool_t *pool = (buffer_pool_t *)&config;
+    buffer_pool_stats_t stats;
+
+    memset(&config, 0, sizeof(config));
+    ASSERT_EQ(BUFFER_POOL_ERR_NULL_POINTER, buffer_pool_create(NULL, &pool));
+    ASSERT_TRUE(pool == NULL);
+    ASSERT_EQ(BUFFER_POOL_ERR_NULL_POINTER, buffer_pool_create(&config, NULL));
+    ASSERT_EQ(BUFFER_POOL_ERR_NULL_POINTER, buffer_pool_get_stats(NULL, &stats));
+
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_create(&config, &pool));
+    ASSERT_EQ(BUFFER_POOL_ERR_NULL_POINTER, buffer_pool_get_stats(pool, NULL));
+    buffer_pool_put(pool, NULL, 4096);
+    buffer_pool_destroy(pool);
+    buffer_pool_destroy(NULL);
+
+    ASSERT_TRUE(strcmp(buffer_pool_error_string(BUFFER_POOL_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(buffer_pool_error_string(BUFFER_POOL_ERR_OUT_OF_MEMORY),
+                       "out of memory") == 0);
+    ASSERT_TRUE(strcmp(buffer_pool_error_string((buffer_pool_error_t)-100),
+                       "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running buffer pool tests...\n\n");
+
+    printf("=== Size Class Tests ===\n");
+    test_class_sizes();
+
+    printf("\n=== Recycling Tests ===\n");
+    test_recycles_within_class();
+    test_reuses_newest_first();
+    test_idle_cap();
+    test_oversized_bypasses_pool();
+    test_null_pool();
+
+    printf("\n=== Option Tests ===\n");
+    test_hugepage_alignment();
+    test_lock_option();
+
+    printf("\n=== Concurrency Tests ===\n");
+    test_concurrent_get_put();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
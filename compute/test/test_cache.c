@@ -0,0 +1,707 @@
+/**
+ * Weave Cache Module - Unit Tests
+ *
+ * Tests for the content-addressed result cache.
+ *
+ * Test categories:
+ * - Creation tests
+ * - Key tests (what does and does not affect a hit)
+ * - Memory tier LRU tests
+ * - Disk tier tests (use a temporary directory under ./tmp)
+ * - Retained result tests
+ * - Error string tests
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "weave/cache.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/* 4x4 RGB test images */
+#define TEST_IMAGE_SIZE (4 * 4 * 3)
+
+static const uint8_t test_prompts[] = "a cata doga bird";
+
+/**
+ * Helper: Build a request whose three prompts point into test_prompts
+ */
+static sd35_generate_request_t make_request(void) {
+    sd35_generate_request_t req;
+
+    memset(&req, 0, sizeof(req));
+    req.request_id = 1;
+    req.model_id = MODEL_ID_SD35;
+    req.width = 512;
+    req.height = 512;
+    req.steps = 28;
+    req.cfg_scale = 7.0f;
+    req.seed = 42;
+    req.clip_l_offset = 0;
+    req.clip_l_length = 5;
+    req.clip_g_offset = 5;
+    req.clip_g_length = 5;
+    req.t5_offset = 10;
+    req.t5_length = 6;
+    req.prompt_data = test_prompts;
+    req.prompt_data_len = sizeof(test_prompts) - 1;
+
+    return req;
+}
+
+/**
+ * Helper: Fill an image with a recognizable pattern
+ */
+static result_cache_image_t make_image(uint8_t *pixels, uint8_t fill) {
+    result_cache_image_t image;
+
+    memset(pixels, fill, TEST_IMAGE_SIZE);
+    image.width = 4;
+    image.height = 4;
+    image.channels = 3;
+    image.data_size = TEST_IMAGE_SIZE;
+    image.data = pixels;
+
+    return image;
+}
+
+/**
+ * Helper: Look up and check the first pixel, freeing the copy
+ *
+ * @return  Fill byte on a hit, -1 on a miss
+ */
+static int lookup_fill(result_cache_t *cache, const sd35_generate_request_t *req, uint64_t seed) {
+    result_cache_image_t image;
+    int fill;
+
+    if (result_cache_lookup(cache, req, seed, NULL, &image) != CACHE_OK) {
+        return -1;
+    }
+
+    fill = image.data[0];
+    if (image.data_size != TEST_IMAGE_SIZE || image.data[TEST_IMAGE_SIZE - 1] != fill ||
+        image.width != 4 || image.height != 4 || image.channels != 3) {
+        fill = -2;
+    }
+    free(image.data);
+    return fill;
+}
+
+/**
+ * Helper: Temporary directory for the disk tier
+ */
+static char temp_dir[256] = {0};
+
+static int create_temp_dir(void) {
+    const char *base_dir = getenv("TMPDIR");
+    if (base_dir == NULL || base_dir[0] == '\0') {
+        base_dir = "./tmp";
+        mkdir(base_dir, 0700); /* Ignore errors if it already exists */
+    }
+
+    snprintf(temp_dir, sizeof(temp_dir), "%s/weave_cache_XXXXXX", base_dir);
+    if (mkdtemp(temp_dir) == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Helper: Count regular files in the temp directory
+ */
+static int count_files(void) {
+    struct dirent *de;
+    int count = 0;
+    DIR *dir = opendir(temp_dir);
+
+    if (dir == NULL) {
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void cleanup_temp_dir(void) {
+    struct dirent *de;
+    char path[512];
+    DIR *dir;
+
+    if (temp_dir[0] == '\0') {
+        return;
+    }
+
+    dir = opendir(temp_dir);
+    if (dir != NULL) {
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] != '.') {
+                snprintf(path, sizeof(path), "%s/%s", temp_dir, de->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(temp_dir);
+    temp_dir[0] = '\0';
+}
+
+/**
+ * ==========================================================================
+ * Creation Tests
+ * ==========================================================================
+ */
+
+static void test_create_requires_a_tier(void) {
+    TEST("test_create_requires_a_tier");
+
+    result_cache_config_t config = {0, 0, NULL};
+    ASSERT_TRUE(result_cache_create(NULL) == NULL);
+    ASSERT_TRUE(result_cache_create(&config) == NULL);
+
+    /* Disk budget without a directory is still disabled */
+    config.disk_max_bytes = 1024;
+    ASSERT_TRUE(result_cache_create(&config) == NULL);
+
+    config.memory_max_bytes = 1024;
+    result_cache_t *cache = result_cache_create(&config);
+    ASSERT_TRUE(cache != NULL);
+    result_cache_destroy(cache);
+    result_cache_destroy(NULL);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Key Tests
+ * ==========================================================================
+ */
+
+static void test_store_then_hit(void) {
+    TEST("test_store_then_hit");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 0xAB);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_lookup(cache, &req, 42, NULL, &out));
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, NULL, &image));
+
+    /* Stored pixels are copied: changing the source does not affect the entry */
+    memset(pixels, 0, sizeof(pixels));
+    ASSERT_EQ(0xAB, lookup_fill(cache, &req, 42));
+
+    /* request_id is not part of the key */
+    req.request_id = 999;
+    ASSERT_EQ(0xAB, lookup_fill(cache, &req, 42));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_random_seed_not_cacheable(void) {
+    TEST("test_random_seed_not_cacheable");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 1);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_store(cache, &req, 0, NULL, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_lookup(cache, &req, 0, NULL, &out));
+    ASSERT_EQ(CACHE_ERR_NULL_POINTER, result_cache_lookup(cache, NULL, 42, NULL, &out));
+
+    /* Wire seeds of 2^63 and up are negative to stable-diffusion.cpp, which randomizes them */
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE,
+              result_cache_store(cache, &req, (uint64_t)INT64_MAX + 1, NULL, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE,
+              result_cache_lookup(cache, &req, (uint64_t)INT64_MAX + 1, NULL, &out));
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_store(cache, &req, UINT64_MAX, NULL, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_lookup(cache, &req, UINT64_MAX, NULL, &out));
+
+    /* The largest fixed seed is still cached */
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, (uint64_t)INT64_MAX, NULL, &image));
+    ASSERT_EQ(CACHE_OK, result_cache_lookup(cache, &req, (uint64_t)INT64_MAX, NULL, &out));
+    free(out.data);
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_init_image_not_cacheable(void) {
+    TEST("test_init_image_not_cacheable");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 1);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+
+    /* The result depends on the init image's pixels, which are not hashed */
+    req.init_source = SD35_INIT_RETAINED;
+    req.strength = 0.5f;
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_store(cache, &req, 42, NULL, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_lookup(cache, &req, 42, NULL, &out));
+
+    req.init_source = SD35_INIT_INLINE;
+    req.init_data = pixels;
+    req.init_data_len = sizeof(pixels);
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_store(cache, &req, 42, NULL, &image));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_every_input_is_part_of_key(void) {
+    TEST("test_every_input_is_part_of_key");
+
+    result_cache_config_t config = {4096, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    sd35_generate_request_t other;
+    result_cache_image_t image = make_image(pixels, 7);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, NULL, &image));
+
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 43));
+
+    other = req;
+    other.width = 576;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    other = req;
+    other.steps = 27;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    other = req;
+    other.cfg_scale = 7.5f;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    other = req;
+    other.sampler = SD35_SAMPLER_LCM;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    other = req;
+    other.scheduler = SD35_SCHEDULER_KARRAS;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    /* Same total text, different split between encoders */
+    other = req;
+    other.clip_l_length = 4;
+    other.clip_g_offset = 4;
+    other.clip_g_length = 6;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    /* Different T5 text */
+    other = req;
+    other.t5_offset = 5;
+    other.t5_length = 5;
+    ASSERT_EQ(-1, lookup_fill(cache, &other, 42));
+
+    ASSERT_EQ(7, lookup_fill(cache, &req, 42));
+
+    /* Same request generated from other model files or settings */
+    image = make_image(pixels, 8);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, "model-a", &image));
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_lookup(cache, &req, 42, "model-b", &out));
+    ASSERT_EQ(CACHE_OK, result_cache_lookup(cache, &req, 42, "model-a", &out));
+    ASSERT_EQ(8, out.data[0]);
+    free(out.data);
+    ASSERT_EQ(7, lookup_fill(cache, &req, 42));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Memory Tier LRU Tests
+ * ==========================================================================
+ */
+
+static void test_memory_lru_eviction(void) {
+    TEST("test_memory_lru_eviction");
+
+    /* Room for exactly two images */
+    result_cache_config_t config = {2 * TEST_IMAGE_SIZE, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image;
+    ASSERT_TRUE(cache != NULL);
+
+    image = make_image(pixels, 1);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 1, NULL, &image));
+    image = make_image(pixels, 2);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 2, NULL, &image));
+
+    /* Touch seed 1 so seed 2 becomes least recently used */
+    ASSERT_EQ(1, lookup_fill(cache, &req, 1));
+
+    image = make_image(pixels, 3);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 3, NULL, &image));
+
+    ASSERT_EQ(1, lookup_fill(cache, &req, 1));
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 2));
+    ASSERT_EQ(3, lookup_fill(cache, &req, 3));
+
+    result_cache_stats_t stats;
+    ASSERT_EQ(CACHE_OK, result_cache_get_stats(cache, &stats));
+    ASSERT_EQ(3, stats.hits);
+    ASSERT_EQ(1, stats.misses);
+    ASSERT_EQ(1, stats.evictions);
+    ASSERT_EQ(2 * TEST_IMAGE_SIZE, stats.memory_bytes);
+
+    /* Replacing an entry does not grow the cache */
+    image = make_image(pixels, 4);
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 3, NULL, &image));
+    ASSERT_EQ(1, lookup_fill(cache, &req, 1));
+    ASSERT_EQ(4, lookup_fill(cache, &req, 3));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_image_larger_than_budget(void) {
+    TEST("test_image_larger_than_budget");
+
+    result_cache_config_t config = {TEST_IMAGE_SIZE - 1, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 1);
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_ERR_NOT_CACHEABLE, result_cache_store(cache, &req, 42, NULL, &image));
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 42));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Disk Tier Tests
+ * ==========================================================================
+ */
+
+static void test_disk_tier_survives_restart(void) {
+    TEST("test_disk_tier_survives_restart");
+
+    ASSERT_EQ(0, create_temp_dir());
+
+    result_cache_config_t config = {0, 1024 * 1024, temp_dir};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 0x5A);
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, NULL, &image));
+    ASSERT_EQ(1, count_files());
+    result_cache_destroy(cache);
+
+    /* A new cache indexes the file and serves it, with a memory tier to promote into */
+    config.memory_max_bytes = 1024;
+    cache = result_cache_create(&config);
+    ASSERT_TRUE(cache != NULL);
+    ASSERT_EQ(0x5A, lookup_fill(cache, &req, 42));
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 43));
+
+    result_cache_stats_t stats;
+    ASSERT_EQ(CACHE_OK, result_cache_get_stats(cache, &stats));
+    ASSERT_EQ(1, stats.disk_hits);
+    ASSERT_EQ(0, stats.hits);
+
+    /* Promoted to memory: still served after the file is gone */
+    cleanup_temp_dir();
+    ASSERT_EQ(0x5A, lookup_fill(cache, &req, 42));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_disk_tier_eviction(void) {
+    TEST("test_disk_tier_eviction");
+
+    ASSERT_EQ(0, create_temp_dir());
+
+    /* Room for two files (header + key + pixels each, under 200 bytes) */
+    result_cache_config_t config = {0, 2 * 200, temp_dir};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image;
+    ASSERT_TRUE(cache != NULL);
+
+    for (uint64_t seed = 1; seed <= 3; seed++) {
+        image = make_image(pixels, (uint8_t)seed);
+        ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, seed, NULL, &image));
+    }
+
+    ASSERT_EQ(2, count_files());
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 1));
+    ASSERT_EQ(2, lookup_fill(cache, &req, 2));
+    ASSERT_EQ(3, lookup_fill(cache, &req, 3));
+
+    result_cache_destroy(cache);
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+static void test_disk_tier_corrupt_file(void) {
+    TEST("test_disk_tier_corrupt_file");
+
+    ASSERT_EQ(0, create_temp_dir());
+
+    result_cache_config_t config = {0, 1024 * 1024, temp_dir};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 9);
+    struct dirent *de;
+    char path[512] = {0};
+    DIR *dir;
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, NULL, &image));
+
+    dir = opendir(temp_dir);
+    ASSERT_TRUE(dir != NULL);
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", temp_dir, de->d_name);
+        }
+    }
+    closedir(dir);
+    ASSERT_EQ(0, truncate(path, 40));
+
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 42));
+    ASSERT_EQ(0, count_files());
+
+    result_cache_destroy(cache);
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Error String Tests
+ * ==========================================================================
+ */
+
+/**
+ * ==========================================================================
+ * Retained Result Tests
+ * ==========================================================================
+ */
+
+static void test_retain_then_recall(void) {
+    TEST("test_retain_then_recall");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    result_cache_image_t image = make_image(pixels, 0x11);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 1, 7, 0, &out));
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 1, 7, 0, &image));
+    image = make_image(pixels, 0x22);
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 1, 7, 1, &image));
+
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 1, 7, 0, &out));
+    ASSERT_EQ(0x11, out.data[0]);
+    ASSERT_EQ(4, out.width);
+    ASSERT_EQ(3, out.channels);
+    free(out.data);
+
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 1, 7, 1, &out));
+    ASSERT_EQ(0x22, out.data[0]);
+    free(out.data);
+
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 1, 8, 0, &out));
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 1, 7, 2, &out));
+
+    /* Retaining again under the same handle replaces the image */
+    image = make_image(pixels, 0x33);
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 1, 7, 0, &image));
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 1, 7, 0, &out));
+    ASSERT_EQ(0x33, out.data[0]);
+    free(out.data);
+
+    ASSERT_EQ(CACHE_ERR_NULL_POINTER, result_cache_retain(NULL, 1, 7, 0, &image));
+    ASSERT_EQ(CACHE_ERR_NULL_POINTER, result_cache_recall(cache, 1, 7, 0, NULL));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_retained_separate_from_results(void) {
+    TEST("test_retained_separate_from_results");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    sd35_generate_request_t req = make_request();
+    result_cache_image_t image = make_image(pixels, 0x44);
+    result_cache_image_t out;
+    ASSERT_TRUE(cache != NULL);
+
+    /* A stored result is not recallable by its request_id, and vice versa */
+    ASSERT_EQ(CACHE_OK, result_cache_store(cache, &req, 42, NULL, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 1, req.request_id, 0, &out));
+
+    result_cache_destroy(cache);
+    cache = result_cache_create(&config);
+    ASSERT_TRUE(cache != NULL);
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 1, req.request_id, 0, &image));
+    ASSERT_EQ(-1, lookup_fill(cache, &req, 42));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_retained_per_owner(void) {
+    TEST("test_retained_per_owner");
+
+    result_cache_config_t config = {1024, 0, NULL};
+    result_cache_t *cache = result_cache_create(&config);
+    uint8_t pixels[TEST_IMAGE_SIZE];
+    result_cache_image_t image = make_image(pixels, 0x55);
+    result_cache_image_t out;
+    result_cache_stats_t stats;
+    ASSERT_TRUE(cache != NULL);
+
+    /* Two clients reuse request_id 7 without seeing each other's images */
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 1, 7, 0, &image));
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 2, 7, 0, &out));
+    image = make_image(pixels, 0x66);
+    ASSERT_EQ(CACHE_OK, result_cache_retain(cache, 2, 7, 0, &image));
+
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 1, 7, 0, &out));
+    ASSERT_EQ(0x55, out.data[0]);
+    free(out.data);
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 2, 7, 0, &out));
+    ASSERT_EQ(0x66, out.data[0]);
+    free(out.data);
+
+    /* Forgetting an owner drops only its images */
+    ASSERT_EQ(1, result_cache_forget(cache, 1));
+    ASSERT_EQ(CACHE_ERR_NOT_FOUND, result_cache_recall(cache, 1, 7, 0, &out));
+    ASSERT_EQ(CACHE_OK, result_cache_recall(cache, 2, 7, 0, &out));
+    free(out.data);
+    ASSERT_EQ(CACHE_OK, result_cache_get_stats(cache, &stats));
+    ASSERT_EQ(TEST_IMAGE_SIZE, stats.memory_bytes);
+
+    ASSERT_EQ(0, result_cache_forget(cache, 1));
+    ASSERT_EQ(0, result_cache_forget(NULL, 1));
+
+    result_cache_destroy(cache);
+    TEST_PASS();
+}
+
+static void test_error_strings(void) {
+    TEST("test_error_strings");
+
+    ASSERT_TRUE(strcmp(cache_error_string(CACHE_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(cache_error_string(CACHE_ERR_NOT_FOUND), "no cached result") == 0);
+    ASSERT_TRUE(strcmp(cache_error_string((cache_error_t)-100), "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running cache tests...\n\n");
+
+    printf("=== Creation Tests ===\n");
+    test_create_requires_a_tier();
+
+    printf("\n=== Key Tests ===\n");
+    test_store_then_hit();
+    test_random_seed_not_cacheable();
+    test_init_image_not_cacheable();
+    test_every_input_is_part_of_key();
+
+    printf("\n=== Memory Tier LRU Tests ===\n");
+    test_memory_lru_eviction();
+    test_image_larger_than_budget();
+
+    printf("\n=== Disk Tier Tests ===\n");
+    test_disk_tier_survives_restart();
+    test_disk_tier_eviction();
+    test_disk_tier_corrupt_file();
+
+    printf("\n=== Retained Result Tests ===\n");
+    test_retain_then_recall();
+    test_retained_separate_from_results();
+    test_retained_per_owner();
+
+    printf("\n=== Error String Tests ===\n");
+    test_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+/**
+ * Weave Connection Module - Unit Tests
+ *
+ * Tests for connection reference counting, serialized sends that give up
+ * after the first failure, and tracking requests for MSG_CANCEL.
+ *
+ * Test categories:
+ * - Lifetime tests
+ * - Send tests
+ * - Cancellation tests
+ * - Argument and error string tests
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "weave/connection.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/** Threads taking and dropping references at once */
+#define REF_THREADS 4
+#define REFS_PER_THREAD 1000
+
+/**
+ * on_release recorder.
+ */
+typedef struct {
+    int calls;
+    uint64_t owner;
+} release_record_t;
+
+static void record_release(uint64_t owner, void *user_data) {
+    release_record_t *record = (release_record_t *)user_data;
+
+    record->calls++;
+    record->owner = owner;
+}
+
+static connection_config_t make_config(int fd, int owns_fd, release_record_t *record) {
+    connection_config_t config;
+
+    memset(&config, 0, sizeof(config));
+    config.client_fd = fd;
+    config.owns_fd = owns_fd;
+    config.owner = 42;
+    config.max_inflight = 2;
+    config.on_release = record != NULL ? record_release : NULL;
+    config.user_data = record;
+    return config;
+}
+
+static int fd_is_open(int fd) {
+    return fcntl(fd, F_GETFD) != -1 || errno != EBADF;
+}
+
+/**
+ * send callbacks: write one byte, fail, or count calls.
+ */
+static int send_byte(int client_fd, void *arg) {
+    const char *byte = (const char *)arg;
+
+    return write(client_fd, byte, 1) == 1 ? 0 : -1;
+}
+
+static int send_fail(int client_fd, void *arg) {
+    (void)client_fd;
+    (*(int *)arg)++;
+    return -1;
+}
+
+static int send_count(int client_fd, void *arg) {
+    (void)client_fd;
+    (*(int *)arg)++;
+    return 0;
+}
+
+/**
+ * ==========================================================================
+ * Lifetime Tests
+ * ==========================================================================
+ */
+
+static void test_last_unref_releases(void) {
+    release_record_t record = {0, 0};
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int fds[2];
+
+    TEST("test_last_unref_releases");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, &record);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+    ASSERT_EQ(fds[0], connection_fd(conn));
+    ASSERT_TRUE(connection_owner(conn) == 42);
+
+    /* A queued request keeps it alive after the reader lets go */
+    connection_ref(conn);
+    connection_unref(conn);
+    ASSERT_EQ(0, record.calls);
+    ASSERT_TRUE(fd_is_open(fds[0]));
+
+    connection_unref(conn);
+    ASSERT_EQ(1, record.calls);
+    ASSERT_TRUE(record.owner == 42);
+    ASSERT_TRUE(!fd_is_open(fds[0]));
+
+    close(fds[1]);
+    TEST_PASS();
+}
+
+static void test_unowned_fd_stays_open(void) {
+    release_record_t record = {0, 0};
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int fds[2];
+
+    TEST("test_unowned_fd_stays_open");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 0, &record);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+    connection_unref(conn);
+    ASSERT_EQ(1, record.calls);
+    ASSERT_TRUE(fd_is_open(fds[0]));
+
+    close(fds[0]);
+    close(fds[1]);
+    TEST_PASS();
+}
+
+static void *ref_unref_thread(void *arg) {
+    connection_t *conn = (connection_t *)arg;
+
+    for (int i = 0; i < REFS_PER_THREAD; i++) {
+        connection_ref(conn);
+        connection_unref(conn);
+    }
+    return NULL;
+}
+
+static void test_concurrent_refs(void) {
+    release_record_t record = {0, 0};
+    connection_config_t config;
+    connection_t *conn = NULL;
+    pthread_t threads[REF_THREADS];
+    int fds[2];
+
+    TEST("test_concurrent_refs");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, &record);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+
+    for (int i = 0; i < REF_THREADS; i++) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, ref_unref_thread, conn));
+    }
+    for (int i = 0; i < REF_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQ(0, record.calls);
+
+    connection_unref(conn);
+    ASSERT_EQ(1, record.calls);
+
+    close(fds[1]);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Send Tests
+ * ==========================================================================
+ */
+
+static void test_send_writes(void) {
+    connection_config_t config;
+    connection_t *conn = NULL;
+    char byte = 'x';
+    char got = 0;
+    int fds[2];
+
+    TEST("test_send_writes");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, NULL);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+
+    ASSERT_EQ(CONNECTION_OK, connection_send(conn, send_byte, &byte));
+    ASSERT_EQ(1, (int)read(fds[1], &got, 1));
+    ASSERT_EQ('x', got);
+    ASSERT_EQ(0, connection_is_broken(conn));
+
+    connection_unref(conn);
+    close(fds[1]);
+    TEST_PASS();
+}
+
+static void test_failed_send_breaks(void) {
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int failures = 0;
+    int sends = 0;
+    char got;
+    int fds[2];
+
+    TEST("test_failed_send_breaks");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, NULL);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+
+    ASSERT_EQ(CONNECTION_ERR_BROKEN, connection_send(conn, send_fail, &failures));
+    ASSERT_EQ(1, failures);
+    ASSERT_EQ(1, connection_is_broken(conn));
+
+    /* The socket is shut down, so the peer sees end of stream */
+    ASSERT_EQ(0, (int)read(fds[1], &got, 1));
+
+    /* Later sends are skipped */
+    ASSERT_EQ(CONNECTION_ERR_BROKEN, connection_send(conn, send_count, &sends));
+    ASSERT_EQ(0, sends);
+
+    connection_unref(conn);
+    close(fds[1]);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Cancellation Tests
+ * ==========================================================================
+ */
+
+static void test_cancel_tracked(void) {
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int fds[2];
+
+    TEST("test_cancel_tracked");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, NULL);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+
+    /* Nothing in flight yet */
+    ASSERT_EQ(CONNECTION_ERR_NOT_FOUND, connection_cancel(conn, 7));
+
+    ASSERT_EQ(CONNECTION_OK, connection_track(conn, 7));
+    ASSERT_EQ(CONNECTION_OK, connection_track(conn, 8));
+    ASSERT_EQ(0, connection_is_cancelled(conn, 7));
+
+    ASSERT_EQ(CONNECTION_OK, connection_cancel(conn, 7));
+    ASSERT_EQ(1, connection_is_cancelled(conn, 7));
+    ASSERT_EQ(0, connection_is_cancelled(conn, 8));
+
+    /* Once generated, a late cancel no longer applies */
+    connection_untrack(conn, 7);
+    ASSERT_EQ(0, connection_is_cancelled(conn, 7));
+    ASSERT_EQ(CONNECTION_ERR_NOT_FOUND, connection_cancel(conn, 7));
+
+    connection_unref(conn);
+    close(fds[1]);
+    TEST_PASS();
+}
+
+static void test_track_full(void) {
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int fds[2];
+
+    TEST("test_track_full");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    config = make_config(fds[0], 1, NULL);
+    ASSERT_EQ(CONNECTION_OK, connection_create(&config, &conn));
+
+    ASSERT_EQ(CONNECTION_OK, connection_track(conn, 1));
+    ASSERT_EQ(CONNECTION_OK, connection_track(conn, 2));
+    ASSERT_EQ(CONNECTION_ERR_FULL, connection_track(conn, 3));
+    ASSERT_EQ(CONNECTION_ERR_NOT_FOUND, connection_cancel(conn, 3));
+
+    /* A freed slot is reused */
+    connection_untrack(conn, 1);
+    ASSERT_EQ(CONNECTION_OK, connection_track(conn, 3));
+    ASSERT_EQ(CONNECTION_OK, connection_cancel(conn, 3));
+
+    connection_unref(conn);
+    close(fds[1]);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_null_arguments(void) {
+    connection_config_t config;
+    connection_t *conn = NULL;
+    int sends = 0;
+
+    TEST("test_null_arguments");
+
+    config = make_config(3, 0, NULL);
+    ASSERT_EQ(CONNECTION_ERR_NULL_POINTER, connection_create(NULL, &conn));
+    ASSERT_EQ(CONNECTION_ERR_NULL_POINTER, connection_create(&config, NULL));
+
+    config.client_fd = -1;
+    ASSERT_EQ(CONNECTION_ERR_INVALID_ARG, connection_create(&config, &conn));
+    config.client_fd = 3;
+    config.max_inflight = 0;
+    ASSERT_EQ(CONNECTION_ERR_INVALID_ARG, connection_create(&config, &conn));
+    ASSERT_TRUE(conn == NULL);
+
+    connection_ref(NULL);
+    connection_unref(NULL);
+    connection_untrack(NULL, 1);
+    ASSERT_EQ(-1, connection_fd(NULL));
+    ASSERT_TRUE(connection_owner(NULL) == 0);
+    ASSERT_EQ(CONNECTION_ERR_NULL_POINTER, connection_send(NULL, send_count, &sends));
+    ASSERT_EQ(0, sends);
+    ASSERT_EQ(1, connection_is_broken(NULL));
+    ASSERT_EQ(CONNECTION_ERR_NULL_POINTER, connection_track(NULL, 1));
+    ASSERT_EQ(CONNECTION_ERR_NULL_POINTER, connection_cancel(NULL, 1));
+    ASSERT_EQ(0, connection_is_cancelled(NULL, 1));
+
+    ASSERT_TRUE(strcmp(connection_error_string(CONNECTION_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(connection_error_string(CONNECTION_ERR_BROKEN), "connection broken") == 0);
+    ASSERT_TRUE(strcmp(connection_error_string((connection_error_t)-100), "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running connection tests...\n\n");
+
+    printf("=== Lifetime Tests ===\n");
+    test_last_unref_releases();
+    test_unowned_fd_stays_open();
+    test_concurrent_refs();
+
+    printf("\n=== Send Tests ===\n");
+    test_send_writes();
+    test_failed_send_breaks();
+
+    printf("\n=== Cancellation Tests ===\n");
+    test_cancel_tracked();
+    test_track_full();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -20,6 +20,14 @@ typedef struct {
     sd_wrapper_gen_params_t last_params;
     char last_prompt[2048];
     uint32_t generate_call_count;
+    uint32_t batch_call_count;
+    int64_t last_seeds[SD_WRAPPER_MAX_BATCH];
+    uint32_t last_seed_count;
+    uint32_t reset_call_count;
+    sd_wrapper_reset_mode_t last_reset_mode;
+    sd_wrapper_error_t reset_error_to_return;
+    uint64_t pending_reset_us;
+    bool has_generated;
 } mock_sd_ctx_t;
 
 static mock_sd_ctx_t mock_ctx;
@@ -33,6 +41,7 @@ sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
                                         sd_wrapper_image_t* image) {
     mock_sd_ctx_t* mock = (mock_sd_ctx_t*)ctx;
     mock->generate_call_count++;
+    mock->has_generated = true;
     memcpy(&mock->last_params, params, sizeof(*params));
 
     if (params->prompt != NULL) {
@@ -58,6 +67,33 @@ sd_wrapper_error_t sd_wrapper_generate(sd_wrapper_ctx_t* ctx,
     return SD_WRAPPER_OK;
 }
 
+sd_wrapper_error_t sd_wrapper_generate_batch(sd_wrapper_ctx_t* ctx,
+                                              const sd_wrapper_gen_params_t* params,
+                                              const int64_t* seeds,
+                                              uint32_t count,
+                                              sd_wrapper_image_t* images) {
+    mock_sd_ctx_t* mock = (mock_sd_ctx_t*)ctx;
+    mock->batch_call_count++;
+    memcpy(mock->last_seeds, seeds, sizeof(int64_t) * count);
+    mock->last_seed_count = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        sd_wrapper_gen_params_t seeded = *params;
+        seeded.seed = seeds[i];
+
+        sd_wrapper_error_t err = sd_wrapper_generate(ctx, &seeded, &images[i]);
+        if (err != SD_WRAPPER_OK) {
+            for (uint32_t j = 0; j < i; j++) {
+                free(images[j].data);
+                images[j].data = NULL;
+            }
+            return err;
+        }
+    }
+
+    return SD_WRAPPER_OK;
+}
+
 void sd_wrapper_free_image(sd_wrapper_image_t* image) {
     if (image != NULL && image->data != NULL) {
         free(image->data);
@@ -66,9 +102,25 @@ void sd_wrapper_free_image(sd_wrapper_image_t* image) {
     }
 }
 
-sd_wrapper_error_t sd_wrapper_reset(sd_wrapper_ctx_t* ctx) {
-    (void)ctx;  /* Unused in mock - no actual reset needed */
-    return SD_WRAPPER_OK;
+sd_wrapper_error_t sd_wrapper_reset_mode(sd_wrapper_ctx_t* ctx,
+                                          sd_wrapper_reset_mode_t mode) {
+    mock_sd_ctx_t* mock = (mock_sd_ctx_t*)ctx;
+    mock->reset_call_count++;
+    mock->last_reset_mode = mode;
+    mock->pending_reset_us += 1000;
+    return mock->reset_error_to_return;
+}
+
+bool sd_wrapper_has_generated(const sd_wrapper_ctx_t* ctx) {
+    const mock_sd_ctx_t* mock = (const mock_sd_ctx_t*)ctx;
+    return mock != NULL && mock->has_generated;
+}
+
+uint64_t sd_wrapper_take_reset_time(sd_wrapper_ctx_t* ctx) {
+    mock_sd_ctx_t* mock = (mock_sd_ctx_t*)ctx;
+    uint64_t reset_us = mock->pending_reset_us;
+    mock->pending_reset_us = 0;
+    return reset_us;
 }
 
 /**
@@ -296,6 +348,20 @@ void test_sd_wrapper_generation_failed_error(void) {
     printf("PASS: test_sd_wrapper_generation_failed_error\n");
 }
 
+void test_sd_wrapper_cancelled_error(void) {
+    reset_mock();
+    mock_ctx.error_to_return = SD_WRAPPER_ERR_CANCELLED;
+
+    sd35_generate_request_t req = create_valid_request();
+    sd35_generate_response_t resp;
+
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+
+    assert(err == ERR_CANCELLED);
+
+    printf("PASS: test_sd_wrapper_cancelled_error\n");
+}
+
 void test_parameter_conversion(void) {
     reset_mock();
 
@@ -305,12 +371,16 @@ void test_parameter_conversion(void) {
     req.steps = 50;
     req.cfg_scale = 9.5f;
     req.seed = 999;
+    req.sampler = SD35_SAMPLER_TCD;
+    req.scheduler = SD35_SCHEDULER_SIMPLE;
 
     sd35_generate_response_t resp;
 
     error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
 
     assert(err == ERR_NONE);
+    assert(mock_ctx.last_params.sampler == SD_WRAPPER_SAMPLER_TCD);
+    assert(mock_ctx.last_params.scheduler == SD_WRAPPER_SCHEDULER_SIMPLE);
     assert(mock_ctx.last_params.width == 1024);
     assert(mock_ctx.last_params.height == 768);
     assert(mock_ctx.last_params.steps == 50);
@@ -324,6 +394,43 @@ void test_parameter_conversion(void) {
     printf("PASS: test_parameter_conversion\n");
 }
 
+void test_init_image_conversion(void) {
+    reset_mock();
+
+    static uint8_t pixels[64 * 64 * 3];
+    sd35_generate_request_t req = create_valid_request();
+    req.width = 64;
+    req.height = 64;
+    sd35_generate_response_t resp;
+
+    /* txt2img leaves the wrapper's init image unset */
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    assert(mock_ctx.last_params.init_image == NULL);
+    free_generate_response(&resp);
+
+    req.init_source = SD35_INIT_INLINE;
+    req.strength = 0.4f;
+    req.init_data = pixels;
+    req.init_data_len = sizeof(pixels);
+    err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    assert(mock_ctx.last_params.init_image == pixels);
+    assert(mock_ctx.last_params.strength == 0.4f);
+    free_generate_response(&resp);
+
+    /* A retained source must have been resolved to pixels first */
+    req.init_source = SD35_INIT_RETAINED;
+    req.init_data = NULL;
+    req.init_data_len = 0;
+    mock_ctx.generate_call_count = 0;
+    err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_INVALID_INIT_IMAGE);
+    assert(mock_ctx.generate_call_count == 0);
+
+    printf("PASS: test_init_image_conversion\n");
+}
+
 void test_generation_time_tracking(void) {
     reset_mock();
 
@@ -369,6 +476,221 @@ void test_double_free_response(void) {
     printf("PASS: test_double_free_response\n");
 }
 
+void test_reset_keeps_weights_resident(void) {
+    reset_mock();
+
+    sd35_generate_request_t req = create_valid_request();
+    sd35_generate_response_t resp;
+
+    /* Two generations: at least the second must reset before generating */
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+
+    err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+
+    assert(mock_ctx.reset_call_count >= 1);
+    assert(mock_ctx.last_reset_mode == SD_WRAPPER_RESET_COMPUTE);
+
+    printf("PASS: test_reset_keeps_weights_resident\n");
+}
+
+void test_first_generation_skips_reset(void) {
+    reset_mock();
+
+    sd35_generate_request_t req = create_valid_request();
+    sd35_generate_response_t resp;
+
+    /* A fresh context generates without a reset */
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+    assert(mock_ctx.reset_call_count == 0);
+
+    /* Every later generation starts with a compute reset */
+    for (uint32_t i = 1; i <= 3; i++) {
+        err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+        assert(err == ERR_NONE);
+        free_generate_response(&resp);
+        assert(mock_ctx.reset_call_count == i);
+        assert(mock_ctx.last_reset_mode == SD_WRAPPER_RESET_COMPUTE);
+    }
+
+    printf("PASS: test_first_generation_skips_reset\n");
+}
+
+void test_first_generation_per_context(void) {
+    mock_sd_ctx_t other;
+
+    reset_mock();
+    memset(&other, 0, sizeof(other));
+
+    sd35_generate_request_t req = create_valid_request();
+    sd35_generate_response_t resp;
+
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+
+    /* A generation on one device's context does not count for another's */
+    err = process_generate_request((sd_wrapper_ctx_t*)&other, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+    assert(other.reset_call_count == 0);
+
+    err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+    assert(mock_ctx.reset_call_count == 1);
+    assert(other.reset_call_count == 0);
+
+    printf("PASS: test_first_generation_per_context\n");
+}
+
+void test_prepare_resets_ahead(void) {
+    reset_mock();
+
+    sd35_generate_request_t req = create_valid_request();
+    sd35_generate_response_t resp;
+    sd35_prepare_request_t prep;
+    memset(&prep, 0, sizeof(prep));
+
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&resp);
+
+    /* After a generation, the prepare does the compute reset */
+    uint32_t resets_before = mock_ctx.reset_call_count;
+    uint64_t reset_us = 0;
+    err = process_prepare_request((sd_wrapper_ctx_t*)&mock_ctx, &prep, &reset_us);
+    assert(err == ERR_NONE);
+    assert(mock_ctx.reset_call_count - resets_before == 1);
+    assert(mock_ctx.last_reset_mode == SD_WRAPPER_RESET_COMPUTE);
+    assert(mock_ctx.generate_call_count == 1);
+
+    /* The reset time is the prepare's, not charged to the next generation */
+    assert(reset_us == 1000);
+    assert(mock_ctx.pending_reset_us == 0);
+
+    /* A failed reset is reported, not hidden until the generation */
+    mock_ctx.reset_error_to_return = SD_WRAPPER_ERR_GPU_ERROR;
+    err = process_prepare_request((sd_wrapper_ctx_t*)&mock_ctx, &prep, NULL);
+    assert(err == ERR_INTERNAL);
+    assert(mock_ctx.pending_reset_us == 0);
+
+    assert(process_prepare_request(NULL, &prep, NULL) == ERR_INTERNAL);
+    assert(process_prepare_request((sd_wrapper_ctx_t*)&mock_ctx, NULL, NULL) == ERR_INTERNAL);
+
+    printf("PASS: test_prepare_resets_ahead\n");
+}
+
+static sd35_generate_batch_request_t create_valid_batch_request(void) {
+    sd35_generate_batch_request_t req;
+    memset(&req, 0, sizeof(req));
+
+    req.base = create_valid_request();
+    req.seed_count = 3;
+    req.seeds[0] = 7;
+    req.seeds[1] = 100;
+    req.seeds[2] = 8;
+    req.base.seed = req.seeds[0];
+
+    return req;
+}
+
+void test_process_valid_batch_request(void) {
+    reset_mock();
+
+    sd35_generate_batch_request_t req = create_valid_batch_request();
+    sd35_generate_batch_response_t resp;
+
+    error_code_t err = process_generate_batch_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    assert(resp.request_id == 12345);
+    assert(resp.status == STATUS_OK);
+    assert(resp.image_width == 512);
+    assert(resp.image_height == 512);
+    assert(resp.channels == 3);
+    assert(resp.image_count == 3);
+    assert(resp.image_data_len == 512 * 512 * 3);
+    for (uint32_t i = 0; i < resp.image_count; i++) {
+        assert(resp.images[i] != NULL);
+    }
+
+    /* One wrapper batch call with every seed, in order */
+    assert(mock_ctx.batch_call_count == 1);
+    assert(mock_ctx.last_seed_count == 3);
+    assert(mock_ctx.last_seeds[0] == 7);
+    assert(mock_ctx.last_seeds[1] == 100);
+    assert(mock_ctx.last_seeds[2] == 8);
+
+    free_generate_batch_response(&resp);
+    assert(resp.images[0] == NULL);
+    free_generate_batch_response(&resp);
+
+    printf("PASS: test_process_valid_batch_request\n");
+}
+
+void test_batch_single_reset(void) {
+    reset_mock();
+
+    sd35_generate_request_t single = create_valid_request();
+    sd35_generate_response_t single_resp;
+    error_code_t err = process_generate_request((sd_wrapper_ctx_t*)&mock_ctx, &single, &single_resp);
+    assert(err == ERR_NONE);
+    free_generate_response(&single_resp);
+
+    uint32_t resets_before = mock_ctx.reset_call_count;
+
+    sd35_generate_batch_request_t req = create_valid_batch_request();
+    req.seed_count = SD35_MAX_BATCH_SIZE;
+    sd35_generate_batch_response_t resp;
+
+    err = process_generate_batch_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_NONE);
+    assert(resp.image_count == SD35_MAX_BATCH_SIZE);
+    free_generate_batch_response(&resp);
+
+    /* The whole batch costs at most one context reset */
+    assert(mock_ctx.reset_call_count - resets_before == 1);
+
+    printf("PASS: test_batch_single_reset\n");
+}
+
+void test_batch_invalid_seed_count(void) {
+    reset_mock();
+
+    sd35_generate_batch_request_t req = create_valid_batch_request();
+    sd35_generate_batch_response_t resp;
+
+    req.seed_count = 0;
+    error_code_t err = process_generate_batch_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_INVALID_SEED_COUNT);
+
+    req.seed_count = SD35_MAX_BATCH_SIZE + 1;
+    err = process_generate_batch_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_INVALID_SEED_COUNT);
+
+    assert(mock_ctx.batch_call_count == 0);
+
+    printf("PASS: test_batch_invalid_seed_count\n");
+}
+
+void test_batch_generation_error(void) {
+    reset_mock();
+    mock_ctx.error_to_return = SD_WRAPPER_ERR_GPU_ERROR;
+
+    sd35_generate_batch_request_t req = create_valid_batch_request();
+    sd35_generate_batch_response_t resp;
+
+    error_code_t err = process_generate_batch_request((sd_wrapper_ctx_t*)&mock_ctx, &req, &resp);
+    assert(err == ERR_GPU_ERROR);
+
+    printf("PASS: test_batch_generation_error\n");
+}
+
 int main(void) {
     printf("Running generate pipeline tests...\n\n");
 
@@ -385,11 +707,21 @@ int main(void) {
     test_sd_wrapper_gpu_error();
     test_sd_wrapper_model_not_found_error();
     test_sd_wrapper_generation_failed_error();
+    test_sd_wrapper_cancelled_error();
     test_parameter_conversion();
+    test_init_image_conversion();
     test_generation_time_tracking();
     test_free_null_response();
     test_free_empty_response();
     test_double_free_response();
+    test_reset_keeps_weights_resident();
+    test_first_generation_skips_reset();
+    test_first_generation_per_context();
+    test_prepare_resets_ahead();
+    test_process_valid_batch_request();
+    test_batch_single_reset();
+    test_batch_invalid_seed_count();
+    test_batch_generation_error();
 
     printf("\nAll tests passed!\n");
     return 0;
@@ -0,0 +1,228 @@
+/**
+ * Weave Image Encode Module - Unit Tests
+ *
+ * Tests for PNG response encoding. Encoded files are decoded again with
+ * libpng's simplified read API and compared pixel for pixel.
+ *
+ * Test categories:
+ * - Round-trip tests (RGB, RGBA, caller buffer)
+ * - Parameter validation tests
+ * - Error string tests
+ */
+
+#include <png.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "weave/image_encode.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/**
+ * fill_gradient - Fill pixels with a smooth pattern, like a generated image
+ */
+static void fill_gradient(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels) {
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t *p = pixels + ((size_t)y * width + x) * channels;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)y;
+            p[2] = (uint8_t)(x + y);
+            if (channels == 4) {
+                p[3] = (uint8_t)(255 - x);
+            }
+        }
+    }
+}
+
+/**
+ * round_trip - Encode pixels, decode the PNG, and compare
+ *
+ * @return  1 if the decoded image matches and is smaller than the raw pixels
+ */
+static int round_trip(uint32_t width, uint32_t height, uint32_t channels) {
+    size_t raw_len = (size_t)width * height * channels;
+    uint8_t *pixels = malloc(raw_len);
+    uint8_t *decoded = malloc(raw_len);
+    uint8_t *png = NULL;
+    size_t png_len = 0;
+    png_image image;
+    int ok = 0;
+
+    if (pixels == NULL || decoded == NULL) {
+        goto out;
+    }
+    fill_gradient(pixels, width, height, channels);
+
+    if (image_encode_png(pixels, width, height, channels, &png, &png_len) != IMAGE_ENCODE_OK) {
+        goto out;
+    }
+
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, png, png_len)) {
+        goto out;
+    }
+    image.format = channels == 4 ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+    if (image.width != width || image.height != height ||
+        !png_image_finish_read(&image, NULL, decoded, 0, NULL)) {
+        png_image_free(&image);
+        goto out;
+    }
+
+    ok = memcmp(pixels, decoded, raw_len) == 0 && png_len < raw_len;
+
+out:
+    free(pixels);
+    free(decoded);
+    free(png);
+    return ok;
+}
+
+/**
+ * Test: RGB and RGBA images survive a round trip and shrink
+ */
+void test_round_trip(void) {
+    TEST("test_round_trip");
+
+    ASSERT_TRUE(round_trip(64, 64, 3));
+    ASSERT_TRUE(round_trip(512, 256, 4));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Encoding into a caller buffer writes the same file as image_encode_png()
+ */
+void test_encode_to_caller_buffer(void) {
+    TEST("test_encode_to_caller_buffer");
+
+    static uint8_t pixels[64 * 48 * 3];
+    size_t bound = image_encode_png_bound(64, 48, 3);
+    uint8_t *buffer = malloc(bound);
+    uint8_t *png = NULL;
+    size_t png_len = 0;
+    size_t out_len = 1;
+
+    ASSERT_TRUE(bound > sizeof(pixels) && buffer != NULL);
+    fill_gradient(pixels, 64, 48, 3);
+
+    ASSERT_EQ(IMAGE_ENCODE_OK, image_encode_png(pixels, 64, 48, 3, &png, &png_len));
+    ASSERT_EQ(IMAGE_ENCODE_OK,
+              image_encode_png_to(pixels, 64, 48, 3, buffer, bound, &out_len));
+    ASSERT_TRUE(out_len == png_len && out_len <= bound);
+    ASSERT_TRUE(memcmp(buffer, png, png_len) == 0);
+
+    out_len = 1;
+    ASSERT_EQ(IMAGE_ENCODE_ERR_BUFFER_TOO_SMALL,
+              image_encode_png_to(pixels, 64, 48, 3, buffer, bound - 1, &out_len));
+    ASSERT_EQ(0, out_len);
+
+    ASSERT_EQ(0, image_encode_png_bound(64, 48, 2));
+    ASSERT_EQ(0, image_encode_png_bound(0, 48, 3));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_INVALID_PARAMS,
+              image_encode_png_to(pixels, 64, 48, 5, buffer, bound, &out_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_NULL_POINTER,
+              image_encode_png_to(pixels, 64, 48, 3, NULL, bound, &out_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_NULL_POINTER,
+              image_encode_png_to(pixels, 64, 48, 3, buffer, bound, NULL));
+
+    free(png);
+    free(buffer);
+    TEST_PASS();
+}
+
+/**
+ * Test: Invalid arguments are rejected and clear the outputs
+ */
+void test_invalid_params(void) {
+    TEST("test_invalid_params");
+
+    uint8_t pixels[4 * 4 * 4] = {0};
+    uint8_t *png = (uint8_t *)pixels;
+    size_t png_len = 1;
+
+    ASSERT_EQ(IMAGE_ENCODE_ERR_INVALID_PARAMS, image_encode_png(pixels, 4, 4, 2, &png, &png_len));
+    ASSERT_TRUE(png == NULL);
+    ASSERT_EQ(0, png_len);
+
+    ASSERT_EQ(IMAGE_ENCODE_ERR_INVALID_PARAMS, image_encode_png(pixels, 0, 4, 3, &png, &png_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_INVALID_PARAMS, image_encode_png(pixels, 4, 0, 3, &png, &png_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_NULL_POINTER, image_encode_png(NULL, 4, 4, 3, &png, &png_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_NULL_POINTER, image_encode_png(pixels, 4, 4, 3, NULL, &png_len));
+    ASSERT_EQ(IMAGE_ENCODE_ERR_NULL_POINTER, image_encode_png(pixels, 4, 4, 3, &png, NULL));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Error strings
+ */
+void test_error_strings(void) {
+    TEST("test_error_strings");
+
+    ASSERT_TRUE(strcmp(image_encode_error_string(IMAGE_ENCODE_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(image_encode_error_string(IMAGE_ENCODE_ERR_ENCODE_FAILED),
+                       "PNG encoding failed") == 0);
+    ASSERT_TRUE(strcmp(image_encode_error_string((image_encode_error_t)-100),
+                       "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running image encode tests...\n\n");
+
+    printf("=== Round-Trip Tests ===\n");
+    test_round_trip();
+    test_encode_to_caller_buffer();
+
+    printf("\n=== Parameter Validation Tests ===\n");
+    test_invalid_params();
+
+    printf("\n=== Error String Tests ===\n");
+    test_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
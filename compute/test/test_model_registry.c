@@ -0,0 +1,469 @@
+/**
+ * Weave Model Registry - Unit Tests
+ *
+ * Tests for config parsing, lazy loading and VRAM-budget eviction. Models
+ * are "loaded" by a mock loader, so no model files or GPU are needed.
+ *
+ * Test categories:
+ * - Config parsing tests
+ * - Loading tests
+ * - Eviction tests
+ * - Error string tests
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "weave/model_registry.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+#define MB (1024 * 1024)
+
+/**
+ * Mock loader state: which models are loaded, and load/unload counts
+ */
+typedef struct {
+    int loaded[MODEL_REGISTRY_MAX_MODELS];   /* Indexed by model_id */
+    int loads;
+    int unloads;
+    int fail_loads;                          /* Make load() return NULL */
+} mock_loader_t;
+
+static void *mock_load(const model_config_t *model, void *user_data) {
+    mock_loader_t *mock = (mock_loader_t *)user_data;
+
+    if (mock->fail_loads) {
+        return NULL;
+    }
+    mock->loaded[model->model_id] = 1;
+    mock->loads++;
+    return &mock->loaded[model->model_id];
+}
+
+static void mock_unload(void *handle, const model_config_t *model, void *user_data) {
+    mock_loader_t *mock = (mock_loader_t *)user_data;
+
+    if (handle == &mock->loaded[model->model_id]) {
+        mock->loaded[model->model_id] = 0;
+    }
+    mock->unloads++;
+}
+
+/**
+ * Helper: Registry of count models with ids 0..count-1, each vram_mb MB
+ */
+static model_registry_t *make_registry(mock_loader_t *mock, size_t count, size_t vram_mb,
+                                       size_t budget_mb, uint32_t pinned_id) {
+    model_config_t models[MODEL_REGISTRY_MAX_MODELS];
+    model_loader_t loader;
+
+    memset(mock, 0, sizeof(*mock));
+    for (size_t i = 0; i < count; i++) {
+        model_config_init(&models[i], (uint32_t)i);
+        snprintf(models[i].model_path, sizeof(models[i].model_path), "model%zu.gguf", i);
+        models[i].vram_bytes = vram_mb * MB;
+        models[i].pinned = (uint32_t)i == pinned_id;
+    }
+
+    loader.load = mock_load;
+    loader.unload = mock_unload;
+    loader.user_data = mock;
+
+    return model_registry_create(models, count, budget_mb * MB, &loader);
+}
+
+/* ========================================================================
+ * Config Parsing Tests
+ * ======================================================================== */
+
+/**
+ * Test: A config with comments, two models and defaults parses
+ */
+void test_parse_config(void) {
+    TEST("test_parse_config");
+
+    static const char config[] =
+        "# weave-compute models\n"
+        "[model 0]\n"
+        "name = sd3.5-medium\n"
+        "model = ./config/models/sd3.5_medium.safetensors\n"
+        "  clip_l = ./config/models/clip_l.safetensors  \n"
+        "pinned = true\n"
+        "step_cache = 0.25\n"
+        "\n"
+        "[model 0x2]\r\n"
+        "model=./config/models/sd3.5_large_turbo.gguf\r\n"
+        "vram_mb = 6000\r\n"
+        "keep_clip_on_cpu = false\r\n"
+        "flash_attn = false\r\n"
+        "clip_only = 3\r\n"
+        "[model 3]\n"
+        "model = ./config/models/sd3.5_large_turbo.gguf\n"
+        "t5 = false\n";
+    model_config_t models[4];
+    size_t count = 0;
+    unsigned line = 99;
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_parse(config, models, 4, &count, &line));
+    ASSERT_EQ(3, count);
+    ASSERT_EQ(0, line);
+
+    ASSERT_EQ(0, models[0].model_id);
+    ASSERT_TRUE(strcmp(models[0].name, "sd3.5-medium") == 0);
+    ASSERT_TRUE(strcmp(models[0].model_path, "./config/models/sd3.5_medium.safetensors") == 0);
+    ASSERT_TRUE(strcmp(models[0].clip_l_path, "./config/models/clip_l.safetensors") == 0);
+    ASSERT_TRUE(models[0].clip_g_path[0] == '\0');
+    ASSERT_TRUE(models[0].pinned);
+    ASSERT_TRUE(models[0].keep_clip_on_cpu);
+    ASSERT_TRUE(models[0].enable_flash_attn);
+    ASSERT_EQ(0, models[0].vram_bytes);
+    ASSERT_TRUE(models[0].step_cache == 0.25f);
+    ASSERT_TRUE(models[0].t5);
+    ASSERT_TRUE(models[0].clip_only_model == MODEL_REGISTRY_NO_MODEL);
+
+    ASSERT_EQ(2, models[1].model_id);
+    ASSERT_TRUE(strcmp(models[1].name, "model-2") == 0);
+    ASSERT_TRUE(strcmp(models[1].model_path, "./config/models/sd3.5_large_turbo.gguf") == 0);
+    ASSERT_TRUE(models[1].vram_bytes == (size_t)6000 * MB);
+    ASSERT_TRUE(!models[1].pinned);
+    ASSERT_TRUE(!models[1].keep_clip_on_cpu);
+    ASSERT_TRUE(!models[1].enable_flash_attn);
+    ASSERT_TRUE(models[1].step_cache == 0.0f);
+    ASSERT_EQ(3, models[1].clip_only_model);
+
+    ASSERT_EQ(3, models[2].model_id);
+    ASSERT_TRUE(!models[2].t5);
+    ASSERT_TRUE(models[2].clip_only_model == MODEL_REGISTRY_NO_MODEL);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: CLIP-only requests go to a model without T5-XXL, or nowhere
+ */
+void test_clip_only_model(void) {
+    TEST("test_clip_only_model");
+
+    model_config_t with_t5;
+    model_config_t counterpart;
+    model_config_t without_t5;
+
+    /* T5-XXL loaded and no clip_only: CLIP-only conditioning is unavailable */
+    model_config_init(&with_t5, 0);
+    ASSERT_TRUE(model_config_clip_only_model(&with_t5) == MODEL_REGISTRY_NO_MODEL);
+
+    /* A configured counterpart serves the request */
+    model_config_init(&counterpart, 2);
+    counterpart.clip_only_model = 3;
+    ASSERT_EQ(3, model_config_clip_only_model(&counterpart));
+
+    /* A model without T5-XXL serves it itself */
+    model_config_init(&without_t5, 3);
+    without_t5.t5 = false;
+    ASSERT_EQ(3, model_config_clip_only_model(&without_t5));
+
+    ASSERT_TRUE(model_config_clip_only_model(NULL) == MODEL_REGISTRY_NO_MODEL);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Malformed configs are rejected with the offending line
+ */
+void test_parse_errors(void) {
+    TEST("test_parse_errors");
+
+    static const struct {
+        const char *config;
+        unsigned line;
+    } cases[] = {
+        { "[model 0]\nmodel = a\ncolour = red\n", 3 },     /* Unknown key */
+        { "model = a\n", 1 },                             /* Key outside a section */
+        { "[model 0]\nmodel = a\npinned = yes\n", 3 },     /* Bad boolean */
+        { "[model 0]\nmodel = a\nvram_mb = -1\n", 3 },     /* Bad number */
+        { "[model 0]\nmodel = a\nstep_cache = 1.5\n", 3 }, /* Threshold too high */
+        { "[model 0]\nmodel = a\nstep_cache = nan\n", 3 }, /* Not a number */
+        { "[model 0]\nmodel = a\n[model 0]\nmodel = b\n", 3 }, /* Duplicate id */
+        { "[model 0]\nname = a\n[model 1]\nmodel = b\n", 1 },  /* Missing model */
+        { "[model 0]\nmodel = a\n[model 1]\nname = b\n", 3 },  /* Missing model (last) */
+        { "[model]\nmodel = a\n", 1 },                     /* Missing id */
+        { "[model 0\nmodel = a\n", 1 },                    /* Unterminated section */
+        { "# nothing\n", 0 },                              /* No models */
+        { "[model 0]\nmodel = a\nclip_only = x\n", 3 },  /* Bad model ID */
+        { "[model 0]\nmodel = a\nclip_only = 1\n", 0 },  /* Unknown CLIP-only model */
+        { "[model 0]\nmodel = a\nclip_only = 1\n[model 1]\nmodel = a\n", 0 }, /* Has T5 */
+    };
+    model_config_t models[4];
+    size_t count;
+    unsigned line;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        ASSERT_EQ(MODEL_REGISTRY_ERR_PARSE,
+                  model_registry_parse(cases[i].config, models, 4, &count, &line));
+        ASSERT_EQ(cases[i].line, line);
+        ASSERT_EQ(0, count);
+    }
+
+    /* More models than fit */
+    ASSERT_EQ(MODEL_REGISTRY_ERR_PARSE,
+              model_registry_parse("[model 0]\nmodel = a\n[model 1]\nmodel = b\n",
+                                   models, 1, &count, &line));
+    ASSERT_EQ(3, line);
+
+    ASSERT_EQ(MODEL_REGISTRY_ERR_IO,
+              model_registry_parse_file("./tmp/nonexistent_models.conf", models, 4, &count,
+                                        &line));
+
+    TEST_PASS();
+}
+
+/* ========================================================================
+ * Loading Tests
+ * ======================================================================== */
+
+/**
+ * Test: Models load on first acquire and are reused afterwards
+ */
+void test_lazy_load(void) {
+    TEST("test_lazy_load");
+
+    mock_loader_t mock;
+    model_registry_t *registry = make_registry(&mock, 2, 4, 0, UINT32_MAX);
+    model_registry_stats_t stats;
+    void *handle = NULL;
+
+    ASSERT_TRUE(registry != NULL);
+    ASSERT_EQ(0, mock.loads);
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 1, &handle));
+    ASSERT_TRUE(handle == &mock.loaded[1]);
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 1, &handle));
+    ASSERT_TRUE(handle == &mock.loaded[1]);
+    ASSERT_EQ(1, mock.loads);
+
+    ASSERT_EQ(MODEL_REGISTRY_ERR_NOT_FOUND, model_registry_acquire(registry, 7, &handle));
+    ASSERT_TRUE(model_registry_find(registry, 0) != NULL);
+    ASSERT_TRUE(model_registry_find(registry, 7) == NULL);
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_get_stats(registry, &stats));
+    ASSERT_EQ(1, stats.hits);
+    ASSERT_EQ(1, stats.loads);
+    ASSERT_EQ(1, stats.loaded);
+    ASSERT_TRUE(stats.vram_bytes == (size_t)4 * MB);
+
+    /* Destroy unloads what is still loaded */
+    model_registry_destroy(registry);
+    ASSERT_EQ(1, mock.unloads);
+    ASSERT_EQ(0, mock.loaded[1]);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Pinned models load up front; a failed load is reported
+ */
+void test_load_pinned_and_failure(void) {
+    TEST("test_load_pinned_and_failure");
+
+    mock_loader_t mock;
+    model_registry_t *registry = make_registry(&mock, 3, 4, 0, 2);
+    model_registry_stats_t stats;
+    void *handle = NULL;
+
+    ASSERT_TRUE(registry != NULL);
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_load_pinned(registry));
+    ASSERT_EQ(1, mock.loads);
+    ASSERT_EQ(1, mock.loaded[2]);
+
+    mock.fail_loads = 1;
+    ASSERT_EQ(MODEL_REGISTRY_ERR_LOAD_FAILED, model_registry_acquire(registry, 0, &handle));
+
+    /* Already loaded models are still served */
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 2, &handle));
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_get_stats(registry, &stats));
+    ASSERT_EQ(1, stats.load_failures);
+    ASSERT_EQ(1, stats.loaded);
+
+    model_registry_destroy(registry);
+    TEST_PASS();
+}
+
+/* ========================================================================
+ * Eviction Tests
+ * ======================================================================== */
+
+/**
+ * Test: The least recently used model is unloaded to make room
+ */
+void test_lru_eviction(void) {
+    TEST("test_lru_eviction");
+
+    mock_loader_t mock;
+    model_registry_t *registry = make_registry(&mock, 3, 4, 8, UINT32_MAX);
+    model_registry_stats_t stats;
+    void *handle;
+
+    ASSERT_TRUE(registry != NULL);
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 0, &handle));
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 1, &handle));
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 0, &handle));
+
+    /* 1 is now least recently used */
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 2, &handle));
+    ASSERT_EQ(1, mock.loaded[0]);
+    ASSERT_EQ(0, mock.loaded[1]);
+    ASSERT_EQ(1, mock.loaded[2]);
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_get_stats(registry, &stats));
+    ASSERT_EQ(1, stats.evictions);
+    ASSERT_EQ(2, stats.loaded);
+    ASSERT_TRUE(stats.vram_bytes == (size_t)8 * MB);
+
+    model_registry_destroy(registry);
+    TEST_PASS();
+}
+
+/**
+ * Test: Pinned models are never evicted, even when least recently used
+ */
+void test_pinned_not_evicted(void) {
+    TEST("test_pinned_not_evicted");
+
+    mock_loader_t mock;
+    model_registry_t *registry = make_registry(&mock, 3, 4, 8, 0);
+    void *handle;
+
+    ASSERT_TRUE(registry != NULL);
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_load_pinned(registry));
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 1, &handle));
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 2, &handle));
+
+    ASSERT_EQ(1, mock.loaded[0]);
+    ASSERT_EQ(0, mock.loaded[1]);
+    ASSERT_EQ(1, mock.loaded[2]);
+
+    model_registry_destroy(registry);
+    TEST_PASS();
+}
+
+/**
+ * Test: A model that cannot fit is refused without evicting anything
+ */
+void test_no_vram(void) {
+    TEST("test_no_vram");
+
+    mock_loader_t mock;
+    model_config_t models[2];
+    model_loader_t loader;
+    model_registry_t *registry;
+    void *handle;
+
+    memset(&mock, 0, sizeof(mock));
+    model_config_init(&models[0], 0);
+    snprintf(models[0].model_path, sizeof(models[0].model_path), "small.gguf");
+    models[0].vram_bytes = (size_t)6 * MB;
+    model_config_init(&models[1], 1);
+    snprintf(models[1].model_path, sizeof(models[1].model_path), "large.gguf");
+    models[1].vram_bytes = (size_t)12 * MB;
+    loader.load = mock_load;
+    loader.unload = mock_unload;
+    loader.user_data = &mock;
+
+    registry = model_registry_create(models, 2, (size_t)10 * MB, &loader);
+    ASSERT_TRUE(registry != NULL);
+
+    ASSERT_EQ(MODEL_REGISTRY_OK, model_registry_acquire(registry, 0, &handle));
+    ASSERT_EQ(MODEL_REGISTRY_ERR_NO_VRAM, model_registry_acquire(registry, 1, &handle));
+    ASSERT_EQ(1, mock.loaded[0]);
+    ASSERT_EQ(0, mock.unloads);
+
+    model_registry_destroy(registry);
+    TEST_PASS();
+}
+
+/* ========================================================================
+ * Error String Tests
+ * ======================================================================== */
+
+/**
+ * Test: Every error code has a message
+ */
+void test_error_strings(void) {
+    TEST("test_error_strings");
+
+    ASSERT_TRUE(strcmp(model_registry_error_string(MODEL_REGISTRY_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(model_registry_error_string(MODEL_REGISTRY_ERR_NO_VRAM),
+                       "unknown error") != 0);
+    ASSERT_TRUE(strcmp(model_registry_error_string(MODEL_REGISTRY_ERR_PARSE),
+                       "unknown error") != 0);
+    ASSERT_TRUE(strcmp(model_registry_error_string((model_registry_error_t)-100),
+                       "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running model registry tests...\n\n");
+
+    printf("=== Config Parsing Tests ===\n");
+    test_parse_config();
+    test_parse_errors();
+    test_clip_only_model();
+
+    printf("\n=== Loading Tests ===\n");
+    test_lazy_load();
+    test_load_pinned_and_failure();
+
+    printf("\n=== Eviction Tests ===\n");
+    test_lru_eviction();
+    test_pinned_not_evicted();
+    test_no_vram();
+
+    printf("\n=== Error String Tests ===\n");
+    test_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+/**
+ * Weave Pipeline Module - Unit Tests
+ *
+ * Tests that every submitted job passes through the stages it needs exactly
+ * once, that the generate queue is served by priority, and that stopping
+ * drains the pipeline.
+ *
+ * Test categories:
+ * - Stage tests
+ * - Ordering tests
+ * - Argument and error string tests
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/pipeline.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/** Jobs submitted by the stage test, more than every queue holds at once */
+#define STAGE_JOBS 64
+
+/** Jobs queued behind the gate in the ordering test */
+#define ORDER_JOBS 3
+
+/**
+ * A test job and what each stage did to it.
+ */
+typedef struct {
+    int answer_early;        /* prepare hands it straight to the writer */
+    unsigned priority;       /* Priority prepare queues it with */
+    int gate;                /* generate blocks until the gate opens */
+    int prepared;
+    int generated;
+    int responded;
+    int released;
+    int responded_generated; /* generated was set when respond ran */
+    void *device;            /* Device it was generated on */
+} test_job_t;
+
+/**
+ * Shared by the callbacks of one test.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int gate_open;           /* A gate job may finish generating */
+    int marker_prepared;     /* The job after the ordered ones was prepared */
+    test_job_t *order[ORDER_JOBS + 1]; /* Jobs in generate order */
+    int order_count;
+} test_context_t;
+
+static void context_init(test_context_t *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->changed, NULL);
+}
+
+static void context_destroy(test_context_t *ctx) {
+    pthread_cond_destroy(&ctx->changed);
+    pthread_mutex_destroy(&ctx->lock);
+}
+
+static int test_prepare(void *item, unsigned *priority, void *user_data) {
+    test_job_t *job = (test_job_t *)item;
+    test_context_t *ctx = (test_context_t *)user_data;
+
+    job->prepared++;
+    if (job->answer_early) {
+        /* The prepare thread pushed every job before this one already */
+        pthread_mutex_lock(&ctx->lock);
+        ctx->marker_prepared = 1;
+        pthread_cond_broadcast(&ctx->changed);
+        pthread_mutex_unlock(&ctx->lock);
+        return 0;
+    }
+    *priority = job->priority;
+    return 1;
+}
+
+static void test_generate(void *item, void *device, void *user_data) {
+    test_job_t *job = (test_job_t *)item;
+    test_context_t *ctx = (test_context_t *)user_data;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (job->gate) {
+        while (!ctx->gate_open) {
+            pthread_cond_wait(&ctx->changed, &ctx->lock);
+        }
+    }
+    if (ctx->order_count < ORDER_JOBS + 1) {
+        ctx->order[ctx->order_count++] = job;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    job->generated++;
+    job->device = device;
+}
+
+static void test_respond(void *item, void *user_data) {
+    test_job_t *job = (test_job_t *)item;
+
+    (void)user_data;
+    job->responded++;
+    job->responded_generated = job->generated;
+}
+
+static void test_release(void *item, void *user_data) {
+    test_job_t *job = (test_job_t *)item;
+
+    (void)user_data;
+    job->released++;
+}
+
+static const pipeline_ops_t test_ops = {
+    test_prepare, test_generate, test_respond, test_release
+};
+
+/**
+ * ==========================================================================
+ * Stage Tests
+ * ==========================================================================
+ */
+
+static void test_every_job_answered(void) {
+    static test_job_t jobs[STAGE_JOBS];
+    test_context_t ctx;
+    pipeline_t pipeline;
+    int devices[2];
+    void *device_ptrs[2] = {&devices[0], &devices[1]};
+
+    TEST("test_every_job_answered");
+
+    context_init(&ctx);
+    memset(jobs, 0, sizeof(jobs));
+    ASSERT_EQ(PIPELINE_OK, pipeline_start(&pipeline, &test_ops, device_ptrs, 2, &ctx));
+
+    for (int i = 0; i < STAGE_JOBS; i++) {
+        jobs[i].answer_early = (i % 3 == 0);
+        jobs[i].priority = (unsigned)(i % 2);
+        ASSERT_EQ(PIPELINE_OK, pipeline_submit(&pipeline, &jobs[i]));
+    }
+
+    /* Stopping drains everything already submitted */
+    pipeline_stop(&pipeline);
+
+    for (int i = 0; i < STAGE_JOBS; i++) {
+        ASSERT_EQ(1, jobs[i].prepared);
+        ASSERT_EQ(jobs[i].answer_early ? 0 : 1, jobs[i].generated);
+        ASSERT_EQ(1, jobs[i].responded);
+        ASSERT_EQ(1, jobs[i].released);
+        ASSERT_EQ(jobs[i].generated, jobs[i].responded_generated);
+        if (!jobs[i].answer_early) {
+            ASSERT_TRUE(jobs[i].device == device_ptrs[0] || jobs[i].device == device_ptrs[1]);
+        }
+    }
+
+    context_destroy(&ctx);
+    TEST_PASS();
+}
+
+static void test_stop_idle(void) {
+    test_context_t ctx;
+    pipeline_t pipeline;
+    int device;
+    void *device_ptrs[1] = {&device};
+
+    TEST("test_stop_idle");
+
+    context_init(&ctx);
+    ASSERT_EQ(PIPELINE_OK, pipeline_start(&pipeline, &test_ops, device_ptrs, 1, &ctx));
+    pipeline_stop(&pipeline);
+    context_destroy(&ctx);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Ordering Tests
+ * ==========================================================================
+ */
+
+static void test_generate_by_priority(void) {
+    test_job_t gate;
+    test_job_t jobs[ORDER_JOBS];
+    test_job_t marker;
+    test_context_t ctx;
+    pipeline_t pipeline;
+    int device;
+    void *device_ptrs[1] = {&device};
+
+    TEST("test_generate_by_priority");
+
+    context_init(&ctx);
+    memset(&gate, 0, sizeof(gate));
+    memset(jobs, 0, sizeof(jobs));
+    memset(&marker, 0, sizeof(marker));
+    gate.gate = 1;
+    marker.answer_early = 1;
+    ASSERT_EQ(PIPELINE_OK, pipeline_start(&pipeline, &test_ops, device_ptrs, 1, &ctx));
+
+    /* The only worker is held by the gate while the rest queue up */
+    ASSERT_EQ(PIPELINE_OK, pipeline_submit(&pipeline, &gate));
+    for (int i = 0; i < ORDER_JOBS; i++) {
+        jobs[i].priority = (unsigned)(ORDER_JOBS - 1 - i);
+        ASSERT_EQ(PIPELINE_OK, pipeline_submit(&pipeline, &jobs[i]));
+    }
+    ASSERT_EQ(PIPELINE_OK, pipeline_submit(&pipeline, &marker));
+
+    pthread_mutex_lock(&ctx.lock);
+    while (!ctx.marker_prepared) {
+        pthread_cond_wait(&ctx.changed, &ctx.lock);
+    }
+    ctx.gate_open = 1;
+    pthread_cond_broadcast(&ctx.changed);
+    pthread_mutex_unlock(&ctx.lock);
+
+    pipeline_stop(&pipeline);
+
+    ASSERT_EQ(ORDER_JOBS + 1, ctx.order_count);
+    ASSERT_TRUE(ctx.order[0] == &gate);
+    /* Submitted least urgent first, generated most urgent first */
+    for (int i = 0; i < ORDER_JOBS; i++) {
+        ASSERT_TRUE(ctx.order[i + 1] == &jobs[ORDER_JOBS - 1 - i]);
+    }
+    ASSERT_EQ(0, marker.generated);
+    ASSERT_EQ(1, marker.released);
+
+    context_destroy(&ctx);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_null_arguments(void) {
+    pipeline_ops_t ops = test_ops;
+    pipeline_t pipeline;
+    int device;
+    void *device_ptrs[1] = {&device};
+    int job = 0;
+
+    TEST("test_null_arguments");
+
+    ASSERT_EQ(PIPELINE_ERR_NULL_POINTER, pipeline_start(NULL, &ops, device_ptrs, 1, NULL));
+    ASSERT_EQ(PIPELINE_ERR_NULL_POINTER, pipeline_start(&pipeline, NULL, device_ptrs, 1, NULL));
+    ASSERT_EQ(PIPELINE_ERR_NULL_POINTER, pipeline_start(&pipeline, &ops, NULL, 1, NULL));
+    ops.release = NULL;
+    ASSERT_EQ(PIPELINE_ERR_NULL_POINTER, pipeline_start(&pipeline, &ops, device_ptrs, 1, NULL));
+    ops = test_ops;
+    ASSERT_EQ(PIPELINE_ERR_INVALID_ARG, pipeline_start(&pipeline, &ops, device_ptrs, 0, NULL));
+    ASSERT_EQ(PIPELINE_ERR_INVALID_ARG,
+              pipeline_start(&pipeline, &ops, device_ptrs, PIPELINE_MAX_WORKERS + 1, NULL));
+
+    ASSERT_EQ(PIPELINE_ERR_NULL_POINTER, pipeline_submit(NULL, &job));
+    pipeline_stop(NULL);
+
+    ASSERT_TRUE(strcmp(pipeline_error_string(PIPELINE_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(pipeline_error_string(PIPELINE_ERR_CLOSED), "pipeline closed") == 0);
+    ASSERT_TRUE(strcmp(pipeline_error_string((pipeline_error_t)-100), "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running pipeline tests...\n\n");
+
+    printf("=== Stage Tests ===\n");
+    test_every_job_answered();
+    test_stop_idle();
+
+    printf("\n=== Ordering Tests ===\n");
+    test_generate_by_priority();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -0,0 +1,377 @@
+/**
+ * Weave Prepared Model Module - Unit Tests
+ *
+ * Tests for prepared model naming, fingerprinting and validation. The
+ * conversion itself needs stable-diffusion.cpp and is not exercised here;
+ * "prepared" files are plain files written by the tests.
+ *
+ * Test categories:
+ * - Path tests
+ * - Fingerprint tests
+ * - Validation tests (use a temporary directory under ./tmp)
+ * - Error string tests
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "weave/prepared_model.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/* Larger than both samples, so the middle is never hashed */
+#define TEST_SOURCE_SIZE (3 * PREPARED_MODEL_SAMPLE_BYTES)
+
+/**
+ * Helper: Temporary directory for model files
+ */
+static char temp_dir[256] = {0};
+static char source_path[320];
+static char prepared_path[384];
+static char tmp_path[448];
+static char manifest_path[448];
+
+static int create_temp_dir(void) {
+    const char *base_dir = getenv("TMPDIR");
+    if (base_dir == NULL || base_dir[0] == '\0') {
+        base_dir = "./tmp";
+        mkdir(base_dir, 0700); /* Ignore errors if it already exists */
+    }
+
+    snprintf(temp_dir, sizeof(temp_dir), "%s/weave_prepared_XXXXXX", base_dir);
+    if (mkdtemp(temp_dir) == NULL) {
+        return -1;
+    }
+
+    snprintf(source_path, sizeof(source_path), "%s/model.safetensors", temp_dir);
+    snprintf(prepared_path, sizeof(prepared_path), "%s%s", source_path, PREPARED_MODEL_SUFFIX);
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", prepared_path, PREPARED_MODEL_TMP_SUFFIX);
+    snprintf(manifest_path, sizeof(manifest_path), "%s%s",
+             prepared_path, PREPARED_MODEL_MANIFEST_SUFFIX);
+    return 0;
+}
+
+static void cleanup_temp_dir(void) {
+    struct dirent *de;
+    char path[512];
+    DIR *dir;
+
+    if (temp_dir[0] == '\0') {
+        return;
+    }
+
+    dir = opendir(temp_dir);
+    if (dir != NULL) {
+        while ((de = readdir(dir)) != NULL) {
+            if (de->d_name[0] != '.') {
+                snprintf(path, sizeof(path), "%s/%s", temp_dir, de->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(temp_dir);
+    temp_dir[0] = '\0';
+}
+
+/**
+ * Helper: Write size bytes of a repeating pattern to path
+ */
+static int write_file(const char *path, size_t size, uint8_t seed) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (fputc((int)(uint8_t)(seed + i * 7), file) == EOF) {
+            fclose(file);
+            return -1;
+        }
+    }
+    return fclose(file);
+}
+
+/**
+ * Helper: Overwrite one byte of path in place (size unchanged)
+ */
+static int poke_byte(const char *path, long offset, uint8_t value) {
+    FILE *file = fopen(path, "r+b");
+    if (file == NULL) {
+        return -1;
+    }
+    if (fseek(file, offset, SEEK_SET) != 0 || fputc(value, file) == EOF) {
+        fclose(file);
+        return -1;
+    }
+    return fclose(file);
+}
+
+/**
+ * Helper: Write a source and commit a prepared file for it
+ */
+static int prepare_fixture(void) {
+    prepared_model_fingerprint_t fp;
+
+    if (write_file(source_path, TEST_SOURCE_SIZE, 1) != 0 ||
+        prepared_model_fingerprint(source_path, &fp) != PREPARED_MODEL_OK ||
+        write_file(tmp_path, 4096, 9) != 0) {
+        return -1;
+    }
+    return prepared_model_commit(&fp, tmp_path, prepared_path) == PREPARED_MODEL_OK ? 0 : -1;
+}
+
+/**
+ * ==========================================================================
+ * Path Tests
+ * ==========================================================================
+ */
+
+static void test_path_appends_suffix(void) {
+    char out[64];
+    char small[16];
+
+    TEST("test_path_appends_suffix");
+
+    ASSERT_EQ(PREPARED_MODEL_OK,
+              prepared_model_path("m.safetensors", PREPARED_MODEL_SUFFIX, out, sizeof(out)));
+    ASSERT_TRUE(strcmp(out, "m.safetensors.f16.gguf") == 0);
+
+    ASSERT_EQ(PREPARED_MODEL_ERR_PATH_TOO_LONG,
+              prepared_model_path("m.safetensors", PREPARED_MODEL_SUFFIX, small, sizeof(small)));
+    ASSERT_EQ(PREPARED_MODEL_ERR_NULL_POINTER,
+              prepared_model_path(NULL, PREPARED_MODEL_SUFFIX, out, sizeof(out)));
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Fingerprint Tests
+ * ==========================================================================
+ */
+
+static void test_fingerprint_samples_both_ends(void) {
+    prepared_model_fingerprint_t a;
+    prepared_model_fingerprint_t b;
+
+    TEST("test_fingerprint_samples_both_ends");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, write_file(source_path, TEST_SOURCE_SIZE, 1));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &a));
+    ASSERT_TRUE(a.size == TEST_SOURCE_SIZE);
+
+    /* The middle is not sampled */
+    ASSERT_EQ(0, poke_byte(source_path, TEST_SOURCE_SIZE / 2, 0xAA));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &b));
+    ASSERT_TRUE(a.sample_hash == b.sample_hash);
+
+    /* The first and last bytes are */
+    ASSERT_EQ(0, poke_byte(source_path, TEST_SOURCE_SIZE - 1, 0xAA));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &b));
+    ASSERT_TRUE(a.sample_hash != b.sample_hash);
+
+    ASSERT_EQ(0, write_file(source_path, TEST_SOURCE_SIZE, 1));
+    ASSERT_EQ(0, poke_byte(source_path, 0, 0xAA));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &b));
+    ASSERT_TRUE(a.sample_hash != b.sample_hash);
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+static void test_fingerprint_small_and_missing_files(void) {
+    prepared_model_fingerprint_t a;
+    prepared_model_fingerprint_t b;
+
+    TEST("test_fingerprint_small_and_missing_files");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, write_file(source_path, 10, 1));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &a));
+    ASSERT_EQ(0, write_file(source_path, 10, 2));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &b));
+    ASSERT_TRUE(a.sample_hash != b.sample_hash);
+
+    ASSERT_EQ(0, write_file(source_path, 0, 1));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &a));
+    ASSERT_TRUE(a.size == 0);
+
+    ASSERT_EQ(PREPARED_MODEL_ERR_IO, prepared_model_fingerprint(prepared_path, &a));
+    ASSERT_EQ(PREPARED_MODEL_ERR_IO, prepared_model_fingerprint(temp_dir, &a));
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Validation Tests
+ * ==========================================================================
+ */
+
+static void test_commit_then_check(void) {
+    TEST("test_commit_then_check");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, write_file(source_path, TEST_SOURCE_SIZE, 1));
+    ASSERT_EQ(PREPARED_MODEL_ERR_NOT_FOUND, prepared_model_check(source_path, prepared_path));
+
+    ASSERT_EQ(0, prepare_fixture());
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_check(source_path, prepared_path));
+    ASSERT_TRUE(access(tmp_path, F_OK) != 0);
+    ASSERT_TRUE(access(manifest_path, F_OK) == 0);
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+static void test_changed_source_is_stale(void) {
+    TEST("test_changed_source_is_stale");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, prepare_fixture());
+
+    /* Replaced with a different file of another size */
+    ASSERT_EQ(0, write_file(source_path, TEST_SOURCE_SIZE + 1, 1));
+    ASSERT_EQ(PREPARED_MODEL_ERR_STALE, prepared_model_check(source_path, prepared_path));
+
+    /* Missing source cannot be validated */
+    ASSERT_EQ(0, unlink(source_path));
+    ASSERT_EQ(PREPARED_MODEL_ERR_IO, prepared_model_check(source_path, prepared_path));
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+static void test_damaged_prepared_file_is_stale(void) {
+    FILE *file;
+
+    TEST("test_damaged_prepared_file_is_stale");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, prepare_fixture());
+
+    /* Truncated prepared file */
+    ASSERT_EQ(0, truncate(prepared_path, 100));
+    ASSERT_EQ(PREPARED_MODEL_ERR_STALE, prepared_model_check(source_path, prepared_path));
+
+    /* Garbage manifest */
+    ASSERT_EQ(0, prepare_fixture());
+    file = fopen(manifest_path, "w");
+    ASSERT_TRUE(file != NULL);
+    fputs("not a manifest\n", file);
+    fclose(file);
+    ASSERT_EQ(PREPARED_MODEL_ERR_STALE, prepared_model_check(source_path, prepared_path));
+
+    /* Prepared file without a manifest */
+    ASSERT_EQ(0, unlink(manifest_path));
+    ASSERT_EQ(PREPARED_MODEL_ERR_NOT_FOUND, prepared_model_check(source_path, prepared_path));
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+static void test_commit_missing_tmp_fails(void) {
+    prepared_model_fingerprint_t fp;
+
+    TEST("test_commit_missing_tmp_fails");
+
+    ASSERT_EQ(0, create_temp_dir());
+    ASSERT_EQ(0, write_file(source_path, 10, 1));
+    ASSERT_EQ(PREPARED_MODEL_OK, prepared_model_fingerprint(source_path, &fp));
+    ASSERT_EQ(PREPARED_MODEL_ERR_IO, prepared_model_commit(&fp, tmp_path, prepared_path));
+    ASSERT_TRUE(access(prepared_path, F_OK) != 0);
+    ASSERT_TRUE(access(manifest_path, F_OK) != 0);
+    ASSERT_EQ(PREPARED_MODEL_ERR_NULL_POINTER,
+              prepared_model_commit(NULL, tmp_path, prepared_path));
+
+    cleanup_temp_dir();
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Error String Tests
+ * ==========================================================================
+ */
+
+static void test_error_strings(void) {
+    TEST("test_error_strings");
+
+    ASSERT_TRUE(strcmp(prepared_model_error_string(PREPARED_MODEL_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(prepared_model_error_string(PREPARED_MODEL_ERR_STALE),
+                       "prepared model does not match its source") == 0);
+    ASSERT_TRUE(strcmp(prepared_model_error_string((prepared_model_error_t)-100),
+                       "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running prepared model tests...\n\n");
+
+    printf("=== Path Tests ===\n");
+    test_path_appends_suffix();
+
+    printf("\n=== Fingerprint Tests ===\n");
+    test_fingerprint_samples_both_ends();
+    test_fingerprint_small_and_missing_files();
+
+    printf("\n=== Validation Tests ===\n");
+    test_commit_then_check();
+    test_changed_source_is_stale();
+    test_damaged_prepared_file_is_stale();
+    test_commit_missing_tmp_fails();
+
+    printf("\n=== Error String Tests ===\n");
+    test_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
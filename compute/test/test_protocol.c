@@ -320,6 +320,23 @@ void test_unsupported_version_too_high(void) {
     TEST_PASS();
 }
 
+void test_version_2_request_accepted(void) {
+    TEST("test_version_2_request_accepted");
+
+    uint8_t buffer[4096];
+    size_t len = build_valid_request(buffer, sizeof(buffer),
+                                     1, 512, 512, 28, 7.0f, 0, "test");
+
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_2);
+
+    sd35_generate_request_t req;
+    error_code_t err = decode_generate_request(buffer, len, &req);
+
+    ASSERT_EQ(ERR_NONE, err);
+
+    TEST_PASS();
+}
+
 void test_unsupported_version_zero(void) {
     TEST("test_unsupported_version_zero");
 
@@ -347,7 +364,7 @@ void test_invalid_model_id(void) {
     size_t len = build_valid_request(buffer, sizeof(buffer),
                                      1, 512, 512, 28, 7.0f, 0, "test");
 
-    write_u32_be(buffer + 24, 1);
+    write_u32_be(buffer + 24, MODEL_ID_SD35_MAX + 1);
 
     sd35_generate_request_t req;
     error_code_t err = decode_generate_request(buffer, len, &req);
@@ -357,6 +374,27 @@ void test_invalid_model_id(void) {
     TEST_PASS();
 }
 
+/**
+ * Test: Any SD 3.5 family model ID decodes (the registry decides if it exists)
+ */
+void test_sd35_family_model_id(void) {
+    TEST("test_sd35_family_model_id");
+
+    uint8_t buffer[4096];
+    size_t len = build_valid_request(buffer, sizeof(buffer),
+                                     1, 512, 512, 28, 7.0f, 0, "test");
+
+    write_u32_be(buffer + 24, MODEL_ID_SD35_MAX);
+
+    sd35_generate_request_t req;
+    error_code_t err = decode_generate_request(buffer, len, &req);
+
+    ASSERT_EQ(ERR_NONE, err);
+    ASSERT_EQ(MODEL_ID_SD35_MAX, req.model_id);
+
+    TEST_PASS();
+}
+
 /**
  * Test: Invalid dimensions
  */
@@ -1106,6 +1144,1392 @@ void test_encode_error_response_buffer_too_small(void) {
     TEST_PASS();
 }
 
+/**
+ * Helper: Build a valid SD 3.5 batch request
+ */
+static size_t build_valid_batch_request(uint8_t *buffer, size_t buffer_size,
+                                        uint64_t request_id,
+                                        const uint64_t *seeds, uint32_t seed_count,
+                                        const char *prompt) {
+    size_t prompt_len = strlen(prompt);
+    size_t payload_len = 12 + 44 + (size_t)seed_count * 8 + prompt_len;
+    size_t total_len = 16 + payload_len;
+
+    if (total_len > buffer_size) {
+        return 0;
+    }
+
+    uint8_t *ptr = buffer;
+
+    write_u32_be(ptr, PROTOCOL_MAGIC);
+    ptr += 4;
+    write_u16_be(ptr, PROTOCOL_VERSION_1);
+    ptr += 2;
+    write_u16_be(ptr, MSG_GENERATE_BATCH_REQUEST);
+    ptr += 2;
+    write_u32_be(ptr, (uint32_t)payload_len);
+    ptr += 4;
+    write_u32_be(ptr, 0);
+    ptr += 4;
+
+    write_u64_be(ptr, request_id);
+    ptr += 8;
+    write_u32_be(ptr, MODEL_ID_SD35);
+    ptr += 4;
+
+    write_u32_be(ptr, 512);
+    ptr += 4;
+    write_u32_be(ptr, 512);
+    ptr += 4;
+    write_u32_be(ptr, 28);
+    ptr += 4;
+    write_f32_be(ptr, 7.0f);
+    ptr += 4;
+    write_u32_be(ptr, seed_count);
+    ptr += 4;
+
+    /* All three encoders share the same prompt bytes */
+    for (int i = 0; i < 3; i++) {
+        write_u32_be(ptr, 0);
+        ptr += 4;
+        write_u32_be(ptr, (uint32_t)prompt_len);
+        ptr += 4;
+    }
+
+    for (uint32_t i = 0; i < seed_count; i++) {
+        write_u64_be(ptr, seeds[i]);
+        ptr += 8;
+    }
+
+    memcpy(ptr, prompt, prompt_len);
+
+    return total_len;
+}
+
+/**
+ * Test: Valid batch request decodes every seed in order
+ */
+void test_batch_request_valid(void) {
+    TEST("test_batch_request_valid");
+
+    const uint64_t seeds[] = {7, 100, 8, 0};
+    uint8_t buffer[4096];
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 777, seeds, 4,
+                                           "a cat in space");
+    ASSERT_TRUE(len > 0);
+
+    sd35_generate_batch_request_t req;
+    error_code_t err = decode_generate_batch_request(buffer, len, &req);
+
+    ASSERT_EQ(ERR_NONE, err);
+    ASSERT_EQ(777, req.base.request_id);
+    ASSERT_EQ(512, req.base.width);
+    ASSERT_EQ(28, req.base.steps);
+    ASSERT_EQ(4, req.seed_count);
+    ASSERT_TRUE(req.seeds[0] == 7 && req.seeds[1] == 100);
+    ASSERT_TRUE(req.seeds[2] == 8 && req.seeds[3] == 0);
+    ASSERT_TRUE(req.base.seed == 7);
+    ASSERT_EQ(14, req.base.clip_l_length);
+    ASSERT_TRUE(memcmp(req.base.prompt_data, "a cat in space", 14) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch request rejects seed counts outside 1-8
+ */
+void test_batch_request_invalid_seed_count(void) {
+    TEST("test_batch_request_invalid_seed_count");
+
+    uint64_t seeds[SD35_MAX_BATCH_SIZE + 1] = {0};
+    uint8_t buffer[4096];
+    sd35_generate_batch_request_t req;
+
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds, 0, "a cat");
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_INVALID_SEED_COUNT, decode_generate_batch_request(buffer, len, &req));
+
+    len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds,
+                                    SD35_MAX_BATCH_SIZE + 1, "a cat");
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_INVALID_SEED_COUNT, decode_generate_batch_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch request with seed table running past the payload
+ */
+void test_batch_request_truncated_seeds(void) {
+    TEST("test_batch_request_truncated_seeds");
+
+    const uint64_t seeds[] = {1, 2};
+    uint8_t buffer[4096];
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds, 2, "");
+    ASSERT_TRUE(len > 0);
+
+    /* Claim 8 seeds while only 2 are present */
+    write_u32_be(buffer + 16 + 12 + 16, SD35_MAX_BATCH_SIZE);
+
+    sd35_generate_batch_request_t req;
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_batch_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Helper: Insert a PROTOCOL_FLAG_SAMPLING block at offset in a built request
+ *
+ * @return  New message length, or 0 if it does not fit
+ */
+static size_t insert_sampling_block(uint8_t *buffer, size_t buffer_size, size_t len,
+                                    size_t offset, uint32_t sampler, uint32_t scheduler) {
+    if (len + 8 > buffer_size) {
+        return 0;
+    }
+
+    memmove(buffer + offset + 8, buffer + offset, len - offset);
+    write_u32_be(buffer + offset, sampler);
+    write_u32_be(buffer + offset + 4, scheduler);
+    write_u32_be(buffer + 8, read_u32_be(buffer + 8) + 8);
+    write_u32_be(buffer + 12, read_u32_be(buffer + 12) | PROTOCOL_FLAG_SAMPLING);
+    return len + 8;
+}
+
+/**
+ * Test: Sampler and scheduler default without PROTOCOL_FLAG_SAMPLING and
+ * decode ahead of the prompt data with it
+ */
+void test_request_sampling(void) {
+    TEST("test_request_sampling");
+
+    uint8_t buffer[4096];
+    sd35_generate_request_t req;
+    size_t len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_SAMPLER_DEFAULT, req.sampler);
+    ASSERT_EQ(SD35_SCHEDULER_DEFAULT, req.scheduler);
+
+    len = insert_sampling_block(buffer, sizeof(buffer), len, 16 + 60,
+                                SD35_SAMPLER_LCM, SD35_SCHEDULER_SGM_UNIFORM);
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_SAMPLER_LCM, req.sampler);
+    ASSERT_EQ(SD35_SCHEDULER_SGM_UNIFORM, req.scheduler);
+    ASSERT_EQ(5, req.clip_l_length);
+    ASSERT_TRUE(memcmp(req.prompt_data + req.clip_l_offset, "a cat", 5) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Unknown samplers and schedulers are rejected, a cut-off block is
+ * structural
+ */
+void test_request_sampling_invalid(void) {
+    TEST("test_request_sampling_invalid");
+
+    uint8_t buffer[4096];
+    sd35_generate_request_t req;
+    size_t base_len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "");
+    ASSERT_TRUE(base_len > 0);
+
+    size_t len = insert_sampling_block(buffer, sizeof(buffer), base_len, 16 + 60,
+                                       SD35_SAMPLER_COUNT, SD35_SCHEDULER_DEFAULT);
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_INVALID_SAMPLER, decode_generate_request(buffer, len, &req));
+
+    write_u32_be(buffer + 16 + 60, SD35_SAMPLER_EULER);
+    write_u32_be(buffer + 16 + 64, SD35_SCHEDULER_COUNT);
+    ASSERT_EQ(ERR_INVALID_SAMPLER, decode_generate_request(buffer, len, &req));
+
+    /* Flag set with no room for the block */
+    len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "");
+    ASSERT_TRUE(len > 0);
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_SAMPLING);
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Priority and deadline default without PROTOCOL_FLAG_SCHEDULING and
+ * decode after the other blocks with it; unknown classes are rejected
+ */
+void test_request_scheduling(void) {
+    TEST("test_request_scheduling");
+
+    uint8_t buffer[4096];
+    sd35_generate_request_t req;
+    size_t len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_PRIORITY_INTERACTIVE, req.priority);
+    ASSERT_EQ(0, req.deadline_ms);
+
+    /* The scheduling block has the sampling block's shape */
+    len = insert_sampling_block(buffer, sizeof(buffer), len, 16 + 60,
+                                SD35_SAMPLER_EULER, SD35_SCHEDULER_DEFAULT);
+    len = insert_sampling_block(buffer, sizeof(buffer), len, 16 + 68,
+                                SD35_PRIORITY_BATCH, 30000);
+    ASSERT_TRUE(len > 0);
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_SAMPLING | PROTOCOL_FLAG_SCHEDULING);
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_SAMPLER_EULER, req.sampler);
+    ASSERT_EQ(SD35_PRIORITY_BATCH, req.priority);
+    ASSERT_EQ(30000, req.deadline_ms);
+    ASSERT_TRUE(memcmp(req.prompt_data + req.clip_l_offset, "a cat", 5) == 0);
+
+    write_u32_be(buffer + 16 + 68, SD35_PRIORITY_COUNT);
+    ASSERT_EQ(ERR_INVALID_PRIORITY, decode_generate_request(buffer, len, &req));
+
+    /* Flag set with no room for the block */
+    len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "");
+    ASSERT_TRUE(len > 0);
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_SCHEDULING);
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: PROTOCOL_FLAG_CLIP_ONLY allows an empty T5 prompt and nothing else
+ */
+void test_request_clip_only(void) {
+    TEST("test_request_clip_only");
+
+    uint8_t buffer[4096];
+    sd35_generate_request_t req;
+    size_t len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 4, 1.0f, 9, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    /* Empty T5 prompt needs the flag */
+    write_u32_be(buffer + 16 + 56, 0);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_generate_request(buffer, len, &req));
+
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_CLIP_ONLY);
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(0, req.t5_length);
+    ASSERT_EQ(5, req.clip_l_length);
+
+    /* CLIP prompts are still required */
+    write_u32_be(buffer + 16 + 40, 0);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_generate_request(buffer, len, &req));
+    write_u32_be(buffer + 16 + 40, 5);
+
+    /* A T5 prompt that is sent is still bounds checked */
+    write_u32_be(buffer + 16 + 56, SD35_MAX_PROMPT_LENGTH + 1);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_generate_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch requests carry the sampling block after the seed table
+ */
+void test_batch_request_sampling(void) {
+    TEST("test_batch_request_sampling");
+
+    const uint64_t seeds[] = {3, 4, 5};
+    uint8_t buffer[4096];
+    sd35_generate_batch_request_t req;
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds, 3, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    len = insert_sampling_block(buffer, sizeof(buffer), len, 16 + 56 + 3 * 8,
+                                SD35_SAMPLER_DPMPP_2M, SD35_SCHEDULER_KARRAS);
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_generate_batch_request(buffer, len, &req));
+    ASSERT_EQ(SD35_SAMPLER_DPMPP_2M, req.base.sampler);
+    ASSERT_EQ(SD35_SCHEDULER_KARRAS, req.base.scheduler);
+    ASSERT_TRUE(req.seeds[2] == 5);
+    ASSERT_TRUE(memcmp(req.base.prompt_data, "a cat", 5) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * Helper: Insert a PROTOCOL_FLAG_INIT_IMAGE block and its pixels at offset
+ *
+ * @return  New message length, or 0 if it does not fit
+ */
+static size_t insert_init_image_block(uint8_t *buffer, size_t buffer_size, size_t len,
+                                      size_t offset, float strength, uint32_t source,
+                                      uint64_t request_id, uint32_t index,
+                                      const uint8_t *data, uint32_t data_len) {
+    size_t block_len = SD35_INIT_IMAGE_BLOCK_SIZE + data_len;
+
+    if (len + block_len > buffer_size) {
+        return 0;
+    }
+
+    memmove(buffer + offset + block_len, buffer + offset, len - offset);
+    write_f32_be(buffer + offset, strength);
+    write_u32_be(buffer + offset + 4, source);
+    write_u64_be(buffer + offset + 8, request_id);
+    write_u32_be(buffer + offset + 16, index);
+    write_u32_be(buffer + offset + 20, data_len);
+    if (data_len > 0) {
+        memcpy(buffer + offset + SD35_INIT_IMAGE_BLOCK_SIZE, data, data_len);
+    }
+    write_u32_be(buffer + 8, read_u32_be(buffer + 8) + (uint32_t)block_len);
+    write_u32_be(buffer + 12, read_u32_be(buffer + 12) | PROTOCOL_FLAG_INIT_IMAGE);
+    return len + block_len;
+}
+
+/**
+ * Test: Inline and retained init images decode ahead of the prompt data,
+ * after the sampling block when both are present
+ */
+void test_request_init_image(void) {
+    TEST("test_request_init_image");
+
+    static uint8_t buffer[64 * 64 * 3 + 4096];
+    static uint8_t pixels[64 * 64 * 3];
+    sd35_generate_request_t req;
+    size_t base_len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "a cat");
+    ASSERT_TRUE(base_len > 0);
+
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, base_len, &req));
+    ASSERT_EQ(SD35_INIT_NONE, req.init_source);
+    ASSERT_TRUE(req.init_data == NULL);
+
+    memset(pixels, 0x5A, sizeof(pixels));
+    size_t len = insert_init_image_block(buffer, sizeof(buffer), base_len, 16 + 60, 0.5f,
+                                         SD35_INIT_INLINE, 0, 0, pixels, sizeof(pixels));
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_INIT_INLINE, req.init_source);
+    ASSERT_TRUE(req.strength == 0.5f);
+    ASSERT_TRUE(req.init_data == buffer + 16 + 60 + SD35_INIT_IMAGE_BLOCK_SIZE);
+    ASSERT_TRUE(req.init_data_len == sizeof(pixels));
+    ASSERT_EQ(0x5A, req.init_data[sizeof(pixels) - 1]);
+    ASSERT_TRUE(memcmp(req.prompt_data + req.clip_l_offset, "a cat", 5) == 0);
+
+    len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "a cat");
+    len = insert_sampling_block(buffer, sizeof(buffer), len, 16 + 60,
+                                SD35_SAMPLER_EULER, SD35_SCHEDULER_DEFAULT);
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 68, 1.0f,
+                                  SD35_INIT_RETAINED, 0x0102030405060708ULL, 3, NULL, 0);
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &req));
+    ASSERT_EQ(SD35_SAMPLER_EULER, req.sampler);
+    ASSERT_EQ(SD35_INIT_RETAINED, req.init_source);
+    ASSERT_TRUE(req.init_request_id == 0x0102030405060708ULL);
+    ASSERT_EQ(3, req.init_index);
+    ASSERT_TRUE(req.init_data == NULL);
+    ASSERT_TRUE(memcmp(req.prompt_data + req.clip_l_offset, "a cat", 5) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Bad strengths, sources and pixel counts are ERR_INVALID_INIT_IMAGE,
+ * a cut-off block is structural
+ */
+void test_request_init_image_invalid(void) {
+    TEST("test_request_init_image_invalid");
+
+    uint8_t buffer[4096];
+    uint8_t pixels[8 * 3];
+    sd35_generate_request_t req;
+    size_t base_len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+    ASSERT_TRUE(base_len > 0);
+
+    const float bad_strengths[] = {0.0f, -0.5f, 1.5f, NAN};
+    for (size_t i = 0; i < sizeof(bad_strengths) / sizeof(bad_strengths[0]); i++) {
+        size_t len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+        len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 60, bad_strengths[i],
+                                      SD35_INIT_RETAINED, 1, 0, NULL, 0);
+        ASSERT_TRUE(len > 0);
+        ASSERT_EQ(ERR_INVALID_INIT_IMAGE, decode_generate_request(buffer, len, &req));
+    }
+
+    /* Source NONE, unknown sources, and pixels that are not width x height RGB */
+    size_t len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 60, 0.5f,
+                                  SD35_INIT_NONE, 0, 0, NULL, 0);
+    ASSERT_EQ(ERR_INVALID_INIT_IMAGE, decode_generate_request(buffer, len, &req));
+    write_u32_be(buffer + 16 + 64, 3);
+    ASSERT_EQ(ERR_INVALID_INIT_IMAGE, decode_generate_request(buffer, len, &req));
+
+    memset(pixels, 0, sizeof(pixels));
+    len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 60, 0.5f,
+                                  SD35_INIT_INLINE, 0, 0, pixels, sizeof(pixels));
+    ASSERT_EQ(ERR_INVALID_INIT_IMAGE, decode_generate_request(buffer, len, &req));
+
+    len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 60, 0.5f,
+                                  SD35_INIT_RETAINED, 1, 0, pixels, sizeof(pixels));
+    ASSERT_EQ(ERR_INVALID_INIT_IMAGE, decode_generate_request(buffer, len, &req));
+
+    /* Flag set with no room for the block */
+    len = build_valid_request(buffer, sizeof(buffer), 1, 64, 64, 4, 1.0f, 9, "");
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_INIT_IMAGE);
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request(buffer, len, &req));
+
+    /* Pixel count larger than the rest of the message */
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 60, 0.5f,
+                                  SD35_INIT_INLINE, 0, 0, NULL, 0);
+    write_u32_be(buffer + 16 + 60 + 20, 64 * 64 * 3);
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch requests carry the init image block after the seed table
+ */
+void test_batch_request_init_image(void) {
+    TEST("test_batch_request_init_image");
+
+    const uint64_t seeds[] = {3, 4};
+    uint8_t buffer[4096];
+    sd35_generate_batch_request_t req;
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds, 2, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    len = insert_init_image_block(buffer, sizeof(buffer), len, 16 + 56 + 2 * 8, 0.3f,
+                                  SD35_INIT_RETAINED, 42, 1, NULL, 0);
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_generate_batch_request(buffer, len, &req));
+    ASSERT_EQ(SD35_INIT_RETAINED, req.base.init_source);
+    ASSERT_TRUE(req.base.init_request_id == 42);
+    ASSERT_EQ(1, req.base.init_index);
+    ASSERT_TRUE(req.seeds[1] == 4);
+    ASSERT_TRUE(memcmp(req.base.prompt_data, "a cat", 5) == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Each decoder rejects the other's message type
+ */
+void test_batch_request_wrong_type(void) {
+    TEST("test_batch_request_wrong_type");
+
+    const uint64_t seeds[] = {1};
+    uint8_t buffer[4096];
+    size_t len = build_valid_batch_request(buffer, sizeof(buffer), 1, seeds, 1, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    sd35_generate_request_t single;
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request(buffer, len, &single));
+
+    len = build_valid_request(buffer, sizeof(buffer), 1, 512, 512, 28, 7.0f, 0, "a cat");
+    ASSERT_TRUE(len > 0);
+
+    sd35_generate_batch_request_t req;
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_batch_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch response encodes metadata and images in seed order
+ */
+void test_encode_generate_batch_response_valid(void) {
+    TEST("test_encode_generate_batch_response_valid");
+
+    const uint32_t image_len = 64 * 64 * 3;
+    uint8_t *pixels = malloc((size_t)image_len * 2);
+    ASSERT_TRUE(pixels != NULL);
+    memset(pixels, 0x11, image_len);
+    memset(pixels + image_len, 0x22, image_len);
+
+    sd35_generate_batch_response_t resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.request_id = 99;
+    resp.status = STATUS_OK;
+    resp.generation_time_ms = 1234;
+    resp.image_width = 64;
+    resp.image_height = 64;
+    resp.channels = 3;
+    resp.image_count = 2;
+    resp.image_data_len = image_len;
+    resp.images[0] = pixels;
+    resp.images[1] = pixels + image_len;
+
+    size_t buf_size = 16 + 36 + (size_t)image_len * 2;
+    uint8_t *buffer = malloc(buf_size);
+    if (buffer == NULL) {
+        free(pixels);
+    }
+    ASSERT_TRUE(buffer != NULL);
+
+    size_t out_len = 0;
+    error_code_t err = encode_generate_batch_response(&resp, buffer, buf_size, &out_len);
+
+    int ok = err == ERR_NONE && out_len == buf_size &&
+             read_u16_be(buffer + 6) == MSG_GENERATE_BATCH_RESPONSE &&
+             read_u32_be(buffer + 8) == 36 + image_len * 2 &&
+             read_u64_be(buffer + 16) == 99 &&
+             read_u32_be(buffer + 24) == STATUS_OK &&
+             read_u32_be(buffer + 28) == 1234 &&
+             read_u32_be(buffer + 44) == 2 &&
+             read_u32_be(buffer + 48) == image_len &&
+             buffer[52] == 0x11 && buffer[52 + image_len] == 0x22;
+
+    /* Too small a buffer is rejected */
+    size_t short_len;
+    int short_ok = encode_generate_batch_response(&resp, buffer, buf_size - 1, &short_len) ==
+                   ERR_INTERNAL;
+
+    free(buffer);
+    free(pixels);
+
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(short_ok);
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch response rejects invalid image counts and missing images
+ */
+void test_encode_generate_batch_response_invalid(void) {
+    TEST("test_encode_generate_batch_response_invalid");
+
+    static uint8_t pixels[64 * 64 * 3];
+    sd35_generate_batch_response_t resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.request_id = 1;
+    resp.status = STATUS_OK;
+    resp.image_width = 64;
+    resp.image_height = 64;
+    resp.channels = 3;
+    resp.image_count = 1;
+    resp.image_data_len = sizeof(pixels);
+    resp.images[0] = pixels;
+
+    uint8_t buffer[16 + 36 + sizeof(pixels)];
+    size_t out_len;
+
+    ASSERT_EQ(ERR_NONE, encode_generate_batch_response(&resp, buffer, sizeof(buffer), &out_len));
+
+    resp.image_count = 0;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response(&resp, buffer, sizeof(buffer), &out_len));
+
+    resp.image_count = SD35_MAX_BATCH_SIZE + 1;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response(&resp, buffer, sizeof(buffer), &out_len));
+
+    resp.image_count = 2;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response(&resp, buffer, sizeof(buffer), &out_len));
+
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response(NULL, buffer, sizeof(buffer), &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Progress frame without preview
+ */
+void test_encode_generate_progress_no_preview(void) {
+    TEST("test_encode_generate_progress_no_preview");
+
+    sd35_generate_progress_t progress;
+    memset(&progress, 0, sizeof(progress));
+    progress.request_id = 42;
+    progress.step = 3;
+    progress.total_steps = 28;
+    progress.elapsed_ms = 1500;
+
+    uint8_t buffer[64];
+    size_t out_len = 0;
+    ASSERT_EQ(ERR_NONE, encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(16 + 36, out_len);
+
+    ASSERT_EQ(MSG_GENERATE_PROGRESS, read_u16_be(buffer + 6));
+    ASSERT_EQ(36, read_u32_be(buffer + 8));
+    ASSERT_TRUE(read_u64_be(buffer + 16) == 42);
+    ASSERT_EQ(3, read_u32_be(buffer + 24));
+    ASSERT_EQ(28, read_u32_be(buffer + 28));
+    ASSERT_EQ(1500, read_u32_be(buffer + 32));
+    ASSERT_EQ(0, read_u32_be(buffer + 36));
+    ASSERT_EQ(0, read_u32_be(buffer + 48));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Timings frame layout, with and without step times
+ */
+void test_encode_generate_timings(void) {
+    TEST("test_encode_generate_timings");
+
+    static sd35_generate_timings_t timings;
+    static uint8_t buffer[SD35_TIMINGS_MAX_SIZE];
+    size_t out_len = 0;
+
+    memset(&timings, 0, sizeof(timings));
+    timings.request_id = 9;
+    for (uint32_t i = 0; i < TIMING_STAGE_COUNT; i++) {
+        timings.stage_us[i] = 1000 * (i + 1);
+    }
+    timings.stage_us[TIMING_STAGE_SAMPLING] = 5000000000ULL; /* Beyond 32 bits */
+    timings.step_count = 2;
+    timings.step_us[0] = 150000;
+    timings.step_us[1] = 149000;
+
+    ASSERT_EQ(ERR_NONE, encode_generate_timings(&timings, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(16 + 12 + 8 * TIMING_STAGE_COUNT + 4 + 8, out_len);
+    ASSERT_EQ(MSG_GENERATE_TIMINGS, read_u16_be(buffer + 6));
+    ASSERT_EQ(out_len - 16, read_u32_be(buffer + 8));
+    ASSERT_TRUE(read_u64_be(buffer + 16) == 9);
+    ASSERT_EQ(TIMING_STAGE_COUNT, read_u32_be(buffer + 24));
+    ASSERT_TRUE(read_u64_be(buffer + 28) == 1000);
+    ASSERT_TRUE(read_u64_be(buffer + 28 + 8 * TIMING_STAGE_SAMPLING) == 5000000000ULL);
+    ASSERT_EQ(2, read_u32_be(buffer + 28 + 8 * TIMING_STAGE_COUNT));
+    ASSERT_EQ(150000, read_u32_be(buffer + 32 + 8 * TIMING_STAGE_COUNT));
+    ASSERT_EQ(149000, read_u32_be(buffer + 36 + 8 * TIMING_STAGE_COUNT));
+
+    /* The largest frame fits the documented bound */
+    timings.step_count = SD35_MAX_TIMED_STEPS;
+    ASSERT_EQ(ERR_NONE, encode_generate_timings(&timings, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(SD35_TIMINGS_MAX_SIZE, out_len);
+
+    timings.step_count = SD35_MAX_TIMED_STEPS + 1;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_timings(&timings, buffer, sizeof(buffer), &out_len));
+    timings.step_count = 2;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_timings(&timings, buffer, 40, &out_len));
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_timings(NULL, buffer, sizeof(buffer), &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Stats response layout
+ */
+void test_encode_stats_response(void) {
+    TEST("test_encode_stats_response");
+
+    static stats_response_t resp;
+    static uint8_t buffer[STATS_RESPONSE_MAX_SIZE];
+    size_t out_len = 0;
+    const uint8_t *ptr;
+
+    memset(&resp, 0, sizeof(resp));
+    resp.request_id = 5;
+    resp.status = STATUS_OK;
+    resp.uptime_ms = 123456;
+    resp.requests = 10;
+    resp.completed = 7;
+    resp.queue_depth = 2;
+    resp.in_flight = 1;
+    resp.vram_bytes = 6ULL * 1024 * 1024 * 1024;
+    resp.pool_hits = 40;
+    resp.pool_misses = 3;
+    resp.pool_idle_bytes = 32ULL * 1024 * 1024;
+    resp.class_queue_depth[SD35_PRIORITY_BATCH] = 4;
+    resp.class_wait_ms[SD35_PRIORITY_BATCH] = 90000;
+    resp.error_count = 1;
+    resp.errors[0].code = ERR_TIMEOUT;
+    resp.errors[0].count = 3;
+    for (uint32_t i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        resp.bucket_bounds_us[i] = 1000 * (i + 1);
+    }
+    resp.histograms[TIMING_STAGE_TOTAL].count = 7;
+    resp.histograms[TIMING_STAGE_TOTAL].sum_us = 70;
+    resp.histograms[TIMING_STAGE_TOTAL].buckets[STATS_HISTOGRAM_BUCKETS - 1] = 7;
+
+    ASSERT_EQ(ERR_NONE, encode_stats_response(&resp, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(MSG_STATS_RESPONSE, read_u16_be(buffer + 6));
+    ASSERT_EQ(out_len - 16, read_u32_be(buffer + 8));
+    ASSERT_TRUE(out_len == STATS_RESPONSE_MAX_SIZE - 12 * (STATS_MAX_ERROR_CODES - 1));
+
+    ptr = buffer + 16;
+    ASSERT_TRUE(read_u64_be(ptr) == 5);
+    ASSERT_EQ(STATUS_OK, read_u32_be(ptr + 8));
+    ASSERT_TRUE(read_u64_be(ptr + 12) == 123456);
+    ASSERT_TRUE(read_u64_be(ptr + 20) == 10);
+    ASSERT_TRUE(read_u64_be(ptr + 28) == 7);
+    ASSERT_EQ(2, read_u32_be(ptr + 36));
+    ASSERT_EQ(1, read_u32_be(ptr + 40));
+    ASSERT_TRUE(read_u64_be(ptr + 44) == 6ULL * 1024 * 1024 * 1024);
+    ASSERT_TRUE(read_u64_be(ptr + 52) == 40);
+    ASSERT_TRUE(read_u64_be(ptr + 60) == 3);
+    ASSERT_TRUE(read_u64_be(ptr + 68) == 32ULL * 1024 * 1024);
+    ptr += 76;
+
+    ASSERT_EQ(SD35_PRIORITY_COUNT, read_u32_be(ptr));
+    ASSERT_EQ(0, read_u32_be(ptr + 4 + 8 * SD35_PRIORITY_INTERACTIVE));
+    ASSERT_EQ(4, read_u32_be(ptr + 4 + 8 * SD35_PRIORITY_BATCH));
+    ASSERT_EQ(90000, read_u32_be(ptr + 8 + 8 * SD35_PRIORITY_BATCH));
+    ptr += 4 + 8 * SD35_PRIORITY_COUNT;
+
+    ASSERT_EQ(1, read_u32_be(ptr));
+    ASSERT_EQ(ERR_TIMEOUT, read_u32_be(ptr + 4));
+    ASSERT_TRUE(read_u64_be(ptr + 8) == 3);
+    ptr += 16;
+
+    ASSERT_EQ(STATS_HISTOGRAM_BUCKETS, read_u32_be(ptr));
+    ASSERT_TRUE(read_u64_be(ptr + 4) == 1000);
+    ptr += 4 + 8 * STATS_HISTOGRAM_BUCKETS;
+
+    ASSERT_EQ(TIMING_STAGE_COUNT, read_u32_be(ptr));
+    ptr += 4 + (20 + 8 * STATS_HISTOGRAM_BUCKETS) * TIMING_STAGE_TOTAL;
+    ASSERT_EQ(TIMING_STAGE_TOTAL, read_u32_be(ptr));
+    ASSERT_TRUE(read_u64_be(ptr + 4) == 7);
+    ASSERT_TRUE(read_u64_be(ptr + 12) == 70);
+    ASSERT_TRUE(read_u64_be(ptr + 20 + 8 * (STATS_HISTOGRAM_BUCKETS - 1)) == 7);
+    ASSERT_TRUE(ptr + 20 + 8 * STATS_HISTOGRAM_BUCKETS == buffer + out_len);
+
+    resp.error_count = STATS_MAX_ERROR_CODES + 1;
+    ASSERT_EQ(ERR_INTERNAL, encode_stats_response(&resp, buffer, sizeof(buffer), &out_len));
+    resp.error_count = 1;
+    ASSERT_EQ(ERR_INTERNAL, encode_stats_response(&resp, buffer, 64, &out_len));
+    ASSERT_EQ(ERR_INTERNAL, encode_stats_response(&resp, NULL, sizeof(buffer), &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Progress frame with preview pixels
+ */
+void test_encode_generate_progress_with_preview(void) {
+    TEST("test_encode_generate_progress_with_preview");
+
+    static uint8_t pixels[96 * 96 * 3];
+    memset(pixels, 0x5A, sizeof(pixels));
+
+    sd35_generate_progress_t progress;
+    memset(&progress, 0, sizeof(progress));
+    progress.request_id = 7;
+    progress.step = 4;
+    progress.total_steps = 28;
+    progress.preview_width = 96;
+    progress.preview_height = 96;
+    progress.preview_channels = 3;
+    progress.preview_data_len = sizeof(pixels);
+    progress.preview_data = pixels;
+
+    static uint8_t buffer[16 + 36 + sizeof(pixels)];
+    size_t out_len = 0;
+    ASSERT_EQ(ERR_NONE, encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(sizeof(buffer), out_len);
+    ASSERT_EQ(96, read_u32_be(buffer + 36));
+    ASSERT_EQ(96, read_u32_be(buffer + 40));
+    ASSERT_EQ(3, read_u32_be(buffer + 44));
+    ASSERT_EQ(sizeof(pixels), read_u32_be(buffer + 48));
+    ASSERT_TRUE(buffer[52] == 0x5A && buffer[sizeof(buffer) - 1] == 0x5A);
+
+    /* Buffer one byte short */
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_progress(&progress, buffer, sizeof(buffer) - 1,
+                                                     &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Progress frame rejects inconsistent fields
+ */
+void test_encode_generate_progress_invalid(void) {
+    TEST("test_encode_generate_progress_invalid");
+
+    static uint8_t pixels[16 * 16 * 3];
+    static uint8_t buffer[16 + 36 + sizeof(pixels)];
+    size_t out_len;
+
+    sd35_generate_progress_t progress;
+    memset(&progress, 0, sizeof(progress));
+    progress.step = 29;
+    progress.total_steps = 28;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+
+    progress.step = 1;
+    progress.preview_width = 16;
+    progress.preview_height = 16;
+    progress.preview_channels = 3;
+    progress.preview_data_len = sizeof(pixels) - 1;
+    progress.preview_data = pixels;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS,
+              encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+
+    progress.preview_data_len = sizeof(pixels);
+    progress.preview_data = NULL;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS,
+              encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+
+    progress.preview_data = pixels;
+    progress.preview_width = SD35_MAX_PREVIEW_DIMENSION + 1;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS,
+              encode_generate_progress(&progress, buffer, sizeof(buffer), &out_len));
+
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_progress(NULL, buffer, sizeof(buffer), &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Response prefix plus pixels matches the full encoding
+ */
+void test_encode_generate_response_prefix(void) {
+    TEST("test_encode_generate_response_prefix");
+
+    static uint8_t pixels[64 * 64 * 3];
+    static uint8_t full[SD35_RESPONSE_PREFIX_SIZE + sizeof(pixels)];
+    uint8_t prefix[SD35_RESPONSE_PREFIX_SIZE];
+    size_t full_len;
+    size_t prefix_len;
+
+    memset(pixels, 0x7E, sizeof(pixels));
+
+    sd35_generate_response_t resp = {
+        .request_id = 77,
+        .status = STATUS_OK,
+        .generation_time_ms = 42,
+        .image_width = 64,
+        .image_height = 64,
+        .channels = 3,
+        .image_data_len = sizeof(pixels),
+        .image_data = pixels,
+    };
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response(&resp, full, sizeof(full), &full_len));
+    ASSERT_EQ(ERR_NONE, encode_generate_response_prefix(&resp, prefix, sizeof(prefix),
+                                                        &prefix_len));
+    ASSERT_EQ(SD35_RESPONSE_PREFIX_SIZE, prefix_len);
+    ASSERT_EQ(prefix_len + sizeof(pixels), full_len);
+    ASSERT_TRUE(memcmp(prefix, full, prefix_len) == 0);
+
+    /* Prefix only needs room for itself, not the pixels */
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_response_prefix(&resp, prefix, sizeof(prefix) - 1,
+                                                            &prefix_len));
+
+    /* Invalid metadata is still rejected */
+    resp.image_data_len -= 1;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS,
+              encode_generate_response_prefix(&resp, prefix, sizeof(prefix), &prefix_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Batch response prefix plus images matches the full encoding
+ */
+void test_encode_generate_batch_response_prefix(void) {
+    TEST("test_encode_generate_batch_response_prefix");
+
+    static uint8_t pixels[2][64 * 64 * 3];
+    static uint8_t full[SD35_BATCH_RESPONSE_PREFIX_SIZE + sizeof(pixels)];
+    uint8_t prefix[SD35_BATCH_RESPONSE_PREFIX_SIZE];
+    size_t full_len;
+    size_t prefix_len;
+
+    memset(pixels[0], 0x11, sizeof(pixels[0]));
+    memset(pixels[1], 0x22, sizeof(pixels[1]));
+
+    sd35_generate_batch_response_t resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.request_id = 5;
+    resp.status = STATUS_OK;
+    resp.image_width = 64;
+    resp.image_height = 64;
+    resp.channels = 3;
+    resp.image_count = 2;
+    resp.image_data_len = sizeof(pixels[0]);
+    resp.images[0] = pixels[0];
+    resp.images[1] = pixels[1];
+
+    ASSERT_EQ(ERR_NONE, encode_generate_batch_response(&resp, full, sizeof(full), &full_len));
+    ASSERT_EQ(ERR_NONE, encode_generate_batch_response_prefix(&resp, prefix, sizeof(prefix),
+                                                              &prefix_len));
+    ASSERT_EQ(SD35_BATCH_RESPONSE_PREFIX_SIZE, prefix_len);
+    ASSERT_EQ(sizeof(full), full_len);
+    ASSERT_TRUE(memcmp(prefix, full, prefix_len) == 0);
+
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response_prefix(&resp, prefix,
+                                                                  sizeof(prefix) - 1,
+                                                                  &prefix_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Moving the image data to shared memory rewrites the header
+ */
+void test_move_payload_tail_to_shm(void) {
+    TEST("test_move_payload_tail_to_shm");
+
+    static uint8_t pixels[64 * 64 * 3];
+    uint8_t prefix[SD35_RESPONSE_PREFIX_SIZE];
+    size_t prefix_len;
+
+    sd35_generate_response_t resp = {
+        .request_id = 3,
+        .status = STATUS_OK,
+        .image_width = 64,
+        .image_height = 64,
+        .channels = 3,
+        .image_data_len = sizeof(pixels),
+        .image_data = pixels,
+    };
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response_prefix(&resp, prefix, sizeof(prefix),
+                                                        &prefix_len));
+    ASSERT_EQ(ERR_NONE, move_payload_tail_to_shm(prefix, sizeof(pixels)));
+
+    /* Only the inline fields remain; image_data_len still describes the image */
+    ASSERT_EQ(SD35_RESPONSE_PREFIX_SIZE - 16, read_u32_be(prefix + 8));
+    ASSERT_EQ(PROTOCOL_FLAG_SHM, read_u32_be(prefix + 12));
+    ASSERT_EQ(sizeof(pixels), read_u32_be(prefix + 44));
+
+    /* Cannot move more than the remaining payload */
+    ASSERT_EQ(ERR_INTERNAL, move_payload_tail_to_shm(prefix, SD35_RESPONSE_PREFIX_SIZE));
+    ASSERT_EQ(ERR_INTERNAL, move_payload_tail_to_shm(NULL, 0));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Version 2 response heads lift the message size limit
+ */
+void test_encode_response_heads_v2(void) {
+    TEST("test_encode_response_heads_v2");
+
+    /* 2048x2048 RGBA is larger than MAX_MESSAGE_SIZE; only the head is encoded */
+    static uint8_t pixels[1];
+    uint8_t head[SD35_BATCH_RESPONSE_HEAD_SIZE];
+    uint8_t prefix[SD35_RESPONSE_PREFIX_SIZE];
+    size_t head_len;
+
+    sd35_generate_response_t resp = {
+        .request_id = 9,
+        .status = STATUS_OK,
+        .generation_time_ms = 1234,
+        .image_width = 2048,
+        .image_height = 2048,
+        .channels = 4,
+        .image_data_len = 2048 * 2048 * 4,
+        .image_data = pixels,
+    };
+
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_response_prefix(&resp, prefix, sizeof(prefix),
+                                                            &head_len));
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response_head(&resp, PROTOCOL_FLAG_CHUNKED, head,
+                                                      sizeof(head), &head_len));
+    ASSERT_EQ(SD35_RESPONSE_HEAD_SIZE, head_len);
+    ASSERT_EQ(PROTOCOL_VERSION_2, read_u16_be(head + 4));
+    ASSERT_EQ(MSG_GENERATE_RESPONSE, read_u16_be(head + 6));
+    ASSERT_EQ(SD35_RESPONSE_HEAD_SIZE - 16, read_u32_be(head + 8));
+    ASSERT_EQ(PROTOCOL_FLAG_CHUNKED, read_u32_be(head + 12));
+    ASSERT_EQ(9, read_u64_be(head + 16));
+    ASSERT_EQ(2048 * 2048 * 4, read_u32_be(head + 44));
+    ASSERT_TRUE(read_u64_be(head + 48) == 2048ULL * 2048 * 4);
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response_head(&resp, PROTOCOL_FLAG_SHM, head,
+                                                      sizeof(head), &head_len));
+    ASSERT_EQ(PROTOCOL_FLAG_SHM, read_u32_be(head + 12));
+
+    /* Exactly one data transport flag, and room for the length */
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_response_head(&resp, 0, head, sizeof(head),
+                                                          &head_len));
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_response_head(
+        &resp, PROTOCOL_FLAG_CHUNKED | PROTOCOL_FLAG_SHM, head, sizeof(head), &head_len));
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_response_head(&resp, PROTOCOL_FLAG_CHUNKED, head,
+                                                          SD35_RESPONSE_PREFIX_SIZE, &head_len));
+
+    resp.image_data_len--;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, encode_generate_response_head(
+        &resp, PROTOCOL_FLAG_CHUNKED, head, sizeof(head), &head_len));
+
+    /* Batch: eight full-size images need a 64-bit-safe total */
+    sd35_generate_batch_response_t batch = {
+        .request_id = 10,
+        .status = STATUS_OK,
+        .image_width = 2048,
+        .image_height = 2048,
+        .channels = 4,
+        .image_count = SD35_MAX_BATCH_SIZE,
+        .image_data_len = 2048 * 2048 * 4,
+    };
+    for (uint32_t i = 0; i < SD35_MAX_BATCH_SIZE; i++) {
+        batch.images[i] = pixels;
+    }
+
+    ASSERT_EQ(ERR_NONE, encode_generate_batch_response_head(&batch, PROTOCOL_FLAG_CHUNKED, head,
+                                                            sizeof(head), &head_len));
+    ASSERT_EQ(SD35_BATCH_RESPONSE_HEAD_SIZE, head_len);
+    ASSERT_EQ(PROTOCOL_VERSION_2, read_u16_be(head + 4));
+    ASSERT_EQ(MSG_GENERATE_BATCH_RESPONSE, read_u16_be(head + 6));
+    ASSERT_EQ(SD35_BATCH_RESPONSE_HEAD_SIZE - 16, read_u32_be(head + 8));
+    ASSERT_EQ(SD35_MAX_BATCH_SIZE, read_u32_be(head + 44));
+    ASSERT_TRUE(read_u64_be(head + 52) == (uint64_t)SD35_MAX_BATCH_SIZE * 2048 * 2048 * 4);
+
+    batch.images[3] = NULL;
+    ASSERT_EQ(ERR_INTERNAL, encode_generate_batch_response_head(&batch, PROTOCOL_FLAG_CHUNKED,
+                                                                head, sizeof(head), &head_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: PNG responses set PROTOCOL_FLAG_PNG and carry the file length
+ */
+void test_encode_png_response(void) {
+    TEST("test_encode_png_response");
+
+    static const uint8_t png[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    uint8_t buffer[SD35_RESPONSE_PREFIX_SIZE + sizeof(png)];
+    uint8_t head[SD35_RESPONSE_HEAD_SIZE];
+    size_t out_len;
+
+    sd35_generate_response_t resp = {
+        .request_id = 3,
+        .status = STATUS_OK,
+        .image_width = 2048,
+        .image_height = 2048,
+        .channels = 3,
+        .image_data_len = sizeof(png),
+        .image_data = png,
+        .image_format = IMAGE_FORMAT_PNG,
+    };
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response(&resp, buffer, sizeof(buffer), &out_len));
+    ASSERT_EQ(sizeof(buffer), out_len);
+    ASSERT_EQ(PROTOCOL_FLAG_PNG, read_u32_be(buffer + 12));
+    ASSERT_EQ(16 + 16 + sizeof(png), read_u32_be(buffer + 8));
+    ASSERT_EQ(sizeof(png), read_u32_be(buffer + 44));
+    ASSERT_TRUE(memcmp(buffer + SD35_RESPONSE_PREFIX_SIZE, png, sizeof(png)) == 0);
+
+    ASSERT_EQ(ERR_NONE, encode_generate_response_head(&resp, PROTOCOL_FLAG_CHUNKED, head,
+                                                      sizeof(head), &out_len));
+    ASSERT_EQ(PROTOCOL_FLAG_CHUNKED | PROTOCOL_FLAG_PNG, read_u32_be(head + 12));
+    ASSERT_TRUE(read_u64_be(head + SD35_RESPONSE_PREFIX_SIZE) == sizeof(png));
+
+    /* Dimensions are still validated, the length only has to be non-zero */
+    resp.image_width = 100;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, encode_generate_response(&resp, buffer, sizeof(buffer),
+                                                               &out_len));
+    resp.image_width = 2048;
+    resp.image_data_len = 0;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, encode_generate_response(&resp, buffer, sizeof(buffer),
+                                                               &out_len));
+
+    /* Raw responses never set the flag */
+    resp.image_format = IMAGE_FORMAT_RAW;
+    resp.image_data_len = sizeof(png);
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, encode_generate_response(&resp, buffer, sizeof(buffer),
+                                                               &out_len));
+    resp.image_format = (image_format_t)7;
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, encode_generate_response(&resp, buffer, sizeof(buffer),
+                                                               &out_len));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: MSG_CHUNK headers carry a bounded data length
+ */
+void test_encode_chunk_header(void) {
+    TEST("test_encode_chunk_header");
+
+    uint8_t header[16];
+
+    ASSERT_EQ(ERR_NONE, encode_chunk_header(PROTOCOL_MAX_CHUNK_SIZE, header, sizeof(header)));
+    ASSERT_EQ(PROTOCOL_MAGIC, read_u32_be(header));
+    ASSERT_EQ(PROTOCOL_VERSION_2, read_u16_be(header + 4));
+    ASSERT_EQ(MSG_CHUNK, read_u16_be(header + 6));
+    ASSERT_EQ(PROTOCOL_MAX_CHUNK_SIZE, read_u32_be(header + 8));
+    ASSERT_EQ(0, read_u32_be(header + 12));
+
+    ASSERT_EQ(ERR_INTERNAL, encode_chunk_header(0, header, sizeof(header)));
+    ASSERT_EQ(ERR_INTERNAL, encode_chunk_header(PROTOCOL_MAX_CHUNK_SIZE + 1, header,
+                                                sizeof(header)));
+    ASSERT_EQ(ERR_INTERNAL, encode_chunk_header(1, header, 15));
+    ASSERT_EQ(ERR_INTERNAL, encode_chunk_header(1, NULL, 16));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Cancel requests carry exactly one request ID
+ */
+void test_decode_cancel_request(void) {
+    TEST("test_decode_cancel_request");
+
+    uint8_t buffer[16 + 9];
+    cancel_request_t req;
+
+    write_u32_be(buffer, PROTOCOL_MAGIC);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_1);
+    write_u16_be(buffer + 6, MSG_CANCEL);
+    write_u32_be(buffer + 8, 8);
+    write_u32_be(buffer + 12, 0);
+    write_u64_be(buffer + 16, 0x0102030405060708ULL);
+
+    ASSERT_EQ(ERR_NONE, decode_cancel_request(buffer, 24, &req));
+    ASSERT_TRUE(req.request_id == 0x0102030405060708ULL);
+
+    /* Truncated payload */
+    ASSERT_EQ(ERR_INTERNAL, decode_cancel_request(buffer, 23, &req));
+
+    /* Payload length other than 8 */
+    write_u32_be(buffer + 8, 9);
+    ASSERT_EQ(ERR_INTERNAL, decode_cancel_request(buffer, sizeof(buffer), &req));
+    write_u32_be(buffer + 8, 8);
+
+    /* Wrong message type */
+    write_u16_be(buffer + 6, MSG_GENERATE_REQUEST);
+    ASSERT_EQ(ERR_INTERNAL, decode_cancel_request(buffer, 24, &req));
+    write_u16_be(buffer + 6, MSG_CANCEL);
+
+    /* Bad magic */
+    write_u32_be(buffer, 0xDEADBEEF);
+    ASSERT_EQ(ERR_INVALID_MAGIC, decode_cancel_request(buffer, 24, &req));
+
+    ASSERT_EQ(ERR_INTERNAL, decode_cancel_request(NULL, 24, &req));
+    ASSERT_EQ(ERR_INTERNAL, decode_cancel_request(buffer, 24, NULL));
+
+    TEST_PASS();
+}
+
+/**
+ * build_prepare_request - Write a prepare request with the given prompt
+ *
+ * The same prompt is used for all three encoders.
+ *
+ * @return  Total message size
+ */
+static size_t build_prepare_request(uint8_t *buffer, const char *prompt) {
+    uint32_t len = (uint32_t)strlen(prompt);
+
+    write_u32_be(buffer, PROTOCOL_MAGIC);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_1);
+    write_u16_be(buffer + 6, MSG_PREPARE);
+    write_u32_be(buffer + 8, 44 + len);
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_PNG);
+    write_u64_be(buffer + 16, 42);
+    write_u32_be(buffer + 24, MODEL_ID_SD35);
+    write_u32_be(buffer + 28, 768);
+    write_u32_be(buffer + 32, 512);
+    for (int i = 0; i < 3; i++) {
+        write_u32_be(buffer + 36 + i * 8, 0);
+        write_u32_be(buffer + 40 + i * 8, len);
+    }
+    memcpy(buffer + 60, prompt, len);
+    return 60 + len;
+}
+
+/**
+ * Test: Prepare requests decode with full, partial and empty prompts
+ */
+void test_decode_prepare_request(void) {
+    TEST("test_decode_prepare_request");
+
+    uint8_t buffer[60 + SD35_MAX_PROMPT_LENGTH + 1];
+    sd35_prepare_request_t req;
+    size_t len = build_prepare_request(buffer, "a cat in a hat");
+
+    ASSERT_EQ(ERR_NONE, decode_prepare_request(buffer, len, &req));
+    ASSERT_TRUE(req.request_id == 42);
+    ASSERT_EQ(MODEL_ID_SD35, req.model_id);
+    ASSERT_EQ(768, req.width);
+    ASSERT_EQ(512, req.height);
+    ASSERT_EQ(14, req.t5_length);
+    ASSERT_TRUE(req.prompt_data_len == 14);
+    ASSERT_TRUE(memcmp(req.prompt_data, "a cat in a hat", 14) == 0);
+
+    /* Unlike a generation request, a prepare may carry no prompt yet */
+    len = build_prepare_request(buffer, "");
+    ASSERT_EQ(ERR_NONE, decode_prepare_request(buffer, len, &req));
+    ASSERT_TRUE(req.prompt_data_len == 0);
+
+    /* Truncated fixed fields */
+    write_u32_be(buffer + 8, 43);
+    ASSERT_EQ(ERR_INTERNAL, decode_prepare_request(buffer, 59, &req));
+
+    /* Wrong message type */
+    len = build_prepare_request(buffer, "cat");
+    write_u16_be(buffer + 6, MSG_GENERATE_REQUEST);
+    ASSERT_EQ(ERR_INTERNAL, decode_prepare_request(buffer, len, &req));
+    write_u16_be(buffer + 6, MSG_PREPARE);
+
+    ASSERT_EQ(ERR_INTERNAL, decode_prepare_request(NULL, len, &req));
+    ASSERT_EQ(ERR_INTERNAL, decode_prepare_request(buffer, len, NULL));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Prepare requests are validated like the requests they announce
+ */
+void test_decode_prepare_request_invalid(void) {
+    TEST("test_decode_prepare_request_invalid");
+
+    uint8_t buffer[60 + SD35_MAX_PROMPT_LENGTH + 1];
+    sd35_prepare_request_t req;
+    char long_prompt[SD35_MAX_PROMPT_LENGTH + 2];
+    size_t len;
+
+    len = build_prepare_request(buffer, "cat");
+    write_u32_be(buffer + 24, MODEL_ID_SD35_MAX + 1);
+    ASSERT_EQ(ERR_INVALID_MODEL_ID, decode_prepare_request(buffer, len, &req));
+
+    len = build_prepare_request(buffer, "cat");
+    write_u32_be(buffer + 28, 100);
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, decode_prepare_request(buffer, len, &req));
+
+    len = build_prepare_request(buffer, "cat");
+    write_u32_be(buffer + 32, SD35_MAX_DIMENSION + SD35_DIMENSION_ALIGNMENT);
+    ASSERT_EQ(ERR_INVALID_DIMENSIONS, decode_prepare_request(buffer, len, &req));
+
+    /* Prompt past the end of the prompt data */
+    len = build_prepare_request(buffer, "cat");
+    write_u32_be(buffer + 52, 1);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_prepare_request(buffer, len, &req));
+
+    /* Offset that would wrap a 32-bit sum */
+    len = build_prepare_request(buffer, "cat");
+    write_u32_be(buffer + 36, 0xFFFFFFFF);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_prepare_request(buffer, len, &req));
+
+    memset(long_prompt, 'a', sizeof(long_prompt) - 1);
+    long_prompt[sizeof(long_prompt) - 1] = '\0';
+    len = build_prepare_request(buffer, long_prompt);
+    ASSERT_EQ(ERR_INVALID_PROMPT, decode_prepare_request(buffer, len, &req));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Stats requests carry exactly one request ID
+ */
+void test_decode_stats_request(void) {
+    TEST("test_decode_stats_request");
+
+    uint8_t buffer[16 + 9];
+    stats_request_t req;
+
+    write_u32_be(buffer, PROTOCOL_MAGIC);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_1);
+    write_u16_be(buffer + 6, MSG_STATS_REQUEST);
+    write_u32_be(buffer + 8, 8);
+    write_u32_be(buffer + 12, 0);
+    write_u64_be(buffer + 16, 77);
+
+    ASSERT_EQ(ERR_NONE, decode_stats_request(buffer, 24, &req));
+    ASSERT_TRUE(req.request_id == 77);
+
+    ASSERT_EQ(ERR_INTERNAL, decode_stats_request(buffer, 23, &req));
+
+    write_u32_be(buffer + 8, 9);
+    ASSERT_EQ(ERR_INTERNAL, decode_stats_request(buffer, sizeof(buffer), &req));
+    write_u32_be(buffer + 8, 8);
+
+    write_u16_be(buffer + 6, MSG_CANCEL);
+    ASSERT_EQ(ERR_INTERNAL, decode_stats_request(buffer, 24, &req));
+
+    ASSERT_EQ(ERR_INTERNAL, decode_stats_request(NULL, 24, &req));
+    ASSERT_EQ(ERR_INTERNAL, decode_stats_request(buffer, 24, NULL));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: decode_header validates magic, version and length, not type
+ */
+void test_decode_header(void) {
+    TEST("test_decode_header");
+
+    uint8_t buffer[16];
+    protocol_header_t header;
+
+    write_u32_be(buffer, PROTOCOL_MAGIC);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_2);
+    write_u16_be(buffer + 6, 0x1234);
+    write_u32_be(buffer + 8, 100);
+    write_u32_be(buffer + 12, PROTOCOL_FLAG_PNG);
+
+    ASSERT_EQ(ERR_NONE, decode_header(buffer, sizeof(buffer), &header));
+    ASSERT_EQ(PROTOCOL_VERSION_2, header.version);
+    ASSERT_EQ(0x1234, header.msg_type);
+    ASSERT_EQ(100, header.payload_len);
+    ASSERT_EQ(PROTOCOL_FLAG_PNG, header.flags);
+
+    /* Payload length is filled in even when the version is rejected */
+    write_u16_be(buffer + 4, 99);
+    ASSERT_EQ(ERR_UNSUPPORTED_VERSION, decode_header(buffer, sizeof(buffer), &header));
+    ASSERT_EQ(100, header.payload_len);
+    write_u16_be(buffer + 4, PROTOCOL_VERSION_1);
+
+    write_u32_be(buffer + 8, MAX_MESSAGE_SIZE - 16 + 1);
+    ASSERT_EQ(ERR_INTERNAL, decode_header(buffer, sizeof(buffer), &header));
+    write_u32_be(buffer + 8, MAX_MESSAGE_SIZE - 16);
+    ASSERT_EQ(ERR_NONE, decode_header(buffer, sizeof(buffer), &header));
+
+    write_u32_be(buffer, 0xDEADBEEF);
+    ASSERT_EQ(ERR_INVALID_MAGIC, decode_header(buffer, sizeof(buffer), &header));
+
+    ASSERT_EQ(ERR_INTERNAL, decode_header(buffer, 15, &header));
+    ASSERT_EQ(ERR_INTERNAL, decode_header(NULL, 16, &header));
+    ASSERT_EQ(ERR_INTERNAL, decode_header(buffer, 16, NULL));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: Payload decoders after decode_header match the whole-message decoders
+ */
+void test_decode_payload_after_header(void) {
+    TEST("test_decode_payload_after_header");
+
+    const uint64_t seeds[] = {5, 6, 7};
+    uint8_t buffer[4096];
+    protocol_header_t header;
+    sd35_generate_request_t full;
+    sd35_generate_request_t fast;
+    sd35_generate_batch_request_t batch_full;
+    sd35_generate_batch_request_t batch_fast;
+
+    size_t len = build_valid_request(buffer, sizeof(buffer), 42, 768, 512, 20, 3.5f, 9,
+                                     "a red fox");
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_header(buffer, len, &header));
+    ASSERT_EQ(ERR_NONE, decode_generate_request(buffer, len, &full));
+    ASSERT_EQ(ERR_NONE, decode_generate_request_payload(&header, buffer + 16, &fast));
+    ASSERT_TRUE(fast.request_id == full.request_id);
+    ASSERT_EQ(full.width, fast.width);
+    ASSERT_EQ(full.height, fast.height);
+    ASSERT_EQ(full.steps, fast.steps);
+    ASSERT_TRUE(fast.cfg_scale == full.cfg_scale);
+    ASSERT_TRUE(fast.seed == full.seed);
+    ASSERT_EQ(full.t5_offset, fast.t5_offset);
+    ASSERT_EQ(full.t5_length, fast.t5_length);
+    ASSERT_TRUE(fast.prompt_data == full.prompt_data);
+    ASSERT_EQ(full.prompt_data_len, fast.prompt_data_len);
+
+    /* The payload decoders check the type decode_header leaves alone */
+    ASSERT_EQ(ERR_INTERNAL,
+              decode_generate_batch_request_payload(&header, buffer + 16, &batch_fast));
+
+    /* A payload shorter than the fixed fields is structural */
+    header.payload_len = 12 + 47;
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request_payload(&header, buffer + 16, &fast));
+
+    len = build_valid_batch_request(buffer, sizeof(buffer), 43, seeds, 3, "a red fox");
+    ASSERT_TRUE(len > 0);
+    ASSERT_EQ(ERR_NONE, decode_header(buffer, len, &header));
+    ASSERT_EQ(ERR_NONE, decode_generate_batch_request(buffer, len, &batch_full));
+    ASSERT_EQ(ERR_NONE,
+              decode_generate_batch_request_payload(&header, buffer + 16, &batch_fast));
+    ASSERT_EQ(3, batch_fast.seed_count);
+    ASSERT_TRUE(batch_fast.seeds[2] == 7);
+    ASSERT_TRUE(batch_fast.base.prompt_data == batch_full.base.prompt_data);
+    ASSERT_EQ(batch_full.base.prompt_data_len, batch_fast.base.prompt_data_len);
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request_payload(&header, buffer + 16, &fast));
+
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request_payload(NULL, buffer + 16, &fast));
+    ASSERT_EQ(ERR_INTERNAL, decode_generate_request_payload(&header, NULL, &fast));
+
+    TEST_PASS();
+}
+
 /**
  * Main test runner
  */
@@ -1120,8 +2544,10 @@ int main(void) {
     test_invalid_magic();
     test_unsupported_version_too_high();
     test_unsupported_version_zero();
+    test_version_2_request_accepted();
 
     test_invalid_model_id();
+    test_sd35_family_model_id();
 
     test_dimensions_too_small();
     test_dimensions_too_large();
@@ -1148,8 +2574,30 @@ int main(void) {
 
     test_prompt_offset_overflow();
 
+    test_request_sampling();
+    test_request_sampling_invalid();
+    test_request_scheduling();
+    test_request_clip_only();
+    test_request_init_image();
+    test_request_init_image_invalid();
+
+    test_batch_request_valid();
+    test_batch_request_invalid_seed_count();
+    test_batch_request_truncated_seeds();
+    test_batch_request_sampling();
+    test_batch_request_init_image();
+    test_batch_request_wrong_type();
+
+    test_decode_cancel_request();
+    test_decode_stats_request();
+    test_decode_prepare_request();
+    test_decode_prepare_request_invalid();
+    test_decode_header();
+    test_decode_payload_after_header();
+
     printf("\n=== Encoder Tests ===\n");
     test_encode_generate_response_valid();
+    test_encode_generate_response_prefix();
     test_encode_generate_response_min_dimensions();
     test_encode_generate_response_max_dimensions();
     test_encode_generate_response_rgba();
@@ -1159,6 +2607,21 @@ int main(void) {
     test_encode_generate_response_mismatched_data_len();
     test_encode_generate_response_buffer_too_small();
 
+    test_encode_generate_batch_response_valid();
+    test_encode_generate_batch_response_prefix();
+    test_move_payload_tail_to_shm();
+    test_encode_response_heads_v2();
+    test_encode_chunk_header();
+    test_encode_png_response();
+    test_encode_generate_batch_response_invalid();
+
+    test_encode_generate_progress_no_preview();
+    test_encode_generate_progress_with_preview();
+    test_encode_generate_progress_invalid();
+
+    test_encode_generate_timings();
+    test_encode_stats_response();
+
     test_encode_error_response_valid();
     test_encode_error_response_empty_message();
     test_encode_error_response_long_message();
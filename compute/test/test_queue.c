@@ -0,0 +1,464 @@
+/**
+ * Weave Queue Module - Unit Tests
+ *
+ * Tests for the bounded work queue connecting the request pipeline stages.
+ *
+ * Test categories:
+ * - Initialization tests
+ * - FIFO ordering tests
+ * - Priority ordering tests
+ * - Close/drain tests
+ * - Blocking and wakeup tests (use a helper thread)
+ * - Error string tests
+ */
+
+/* Enable POSIX features for nanosleep */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weave/queue.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/**
+ * Helper: Convert a small integer to a queue item and back
+ */
+#define ITEM(n) ((void *)(uintptr_t)(n))
+#define ITEM_VALUE(p) ((int)(uintptr_t)(p))
+
+/**
+ * Helper: Sleep long enough for a helper thread to block
+ */
+static void short_sleep(void) {
+    struct timespec ts = {0, 50 * 1000 * 1000};
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Helper thread state for blocking tests
+ */
+typedef struct {
+    work_queue_t *queue;
+    void *item;
+    queue_error_t result;
+    int done;
+    pthread_mutex_t lock;
+} helper_t;
+
+static void helper_init(helper_t *helper, work_queue_t *queue, void *item) {
+    helper->queue = queue;
+    helper->item = item;
+    helper->result = QUEUE_OK;
+    helper->done = 0;
+    pthread_mutex_init(&helper->lock, NULL);
+}
+
+static int helper_is_done(helper_t *helper) {
+    int done;
+    pthread_mutex_lock(&helper->lock);
+    done = helper->done;
+    pthread_mutex_unlock(&helper->lock);
+    return done;
+}
+
+static void *push_thread(void *arg) {
+    helper_t *helper = (helper_t *)arg;
+    queue_error_t result = work_queue_push(helper->queue, helper->item);
+
+    pthread_mutex_lock(&helper->lock);
+    helper->result = result;
+    helper->done = 1;
+    pthread_mutex_unlock(&helper->lock);
+    return NULL;
+}
+
+static void *pop_thread(void *arg) {
+    helper_t *helper = (helper_t *)arg;
+    void *item = NULL;
+    queue_error_t result = work_queue_pop(helper->queue, &item);
+
+    pthread_mutex_lock(&helper->lock);
+    helper->item = item;
+    helper->result = result;
+    helper->done = 1;
+    pthread_mutex_unlock(&helper->lock);
+    return NULL;
+}
+
+/**
+ * ==========================================================================
+ * Initialization Tests
+ * ==========================================================================
+ */
+
+static void test_init_invalid_args(void) {
+    TEST("test_init_invalid_args");
+
+    work_queue_t queue;
+
+    ASSERT_EQ(QUEUE_ERR_NULL_POINTER, work_queue_init(NULL, 4));
+    ASSERT_EQ(QUEUE_ERR_INVALID_CAPACITY, work_queue_init(&queue, 0));
+    ASSERT_EQ(QUEUE_ERR_NULL_POINTER, work_queue_push(NULL, ITEM(1)));
+    ASSERT_EQ(QUEUE_ERR_NULL_POINTER, work_queue_pop(NULL, NULL));
+
+    /* NULL safe */
+    work_queue_close(NULL);
+    work_queue_destroy(NULL);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * FIFO Ordering Tests
+ * ==========================================================================
+ */
+
+static void test_fifo_order_with_wraparound(void) {
+    TEST("test_fifo_order_with_wraparound");
+
+    work_queue_t queue;
+    void *item;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 3));
+
+    /* Several rounds so head wraps the ring more than once */
+    for (int round = 0; round < 4; round++) {
+        for (int i = 1; i <= 3; i++) {
+            ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(round * 10 + i)));
+        }
+        for (int i = 1; i <= 3; i++) {
+            ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+            ASSERT_EQ(round * 10 + i, ITEM_VALUE(item));
+        }
+    }
+
+    /* Interleaved push/pop */
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(1)));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(2)));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(1, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(3)));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(4)));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(2, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(3, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(4, ITEM_VALUE(item));
+
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Priority Ordering Tests
+ * ==========================================================================
+ */
+
+static void test_priority_order(void) {
+    TEST("test_priority_order");
+
+    work_queue_t queue;
+    void *item;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 4));
+
+    /* Start off the ring's first slot so the gap closing wraps */
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(99)));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(99, ITEM_VALUE(item));
+
+    ASSERT_EQ(QUEUE_OK, work_queue_push_priority(&queue, ITEM(1), 2));
+    ASSERT_EQ(QUEUE_OK, work_queue_push_priority(&queue, ITEM(2), 1));
+    ASSERT_EQ(QUEUE_OK, work_queue_push_priority(&queue, ITEM(3), 2));
+    ASSERT_EQ(QUEUE_OK, work_queue_push_priority(&queue, ITEM(4), 1));
+
+    /* Most urgent first, FIFO within a priority */
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(2, ITEM_VALUE(item));
+
+    /* work_queue_push() is priority 0 and jumps the rest */
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(5)));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(5, ITEM_VALUE(item));
+
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(4, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(1, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(3, ITEM_VALUE(item));
+
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Close/Drain Tests
+ * ==========================================================================
+ */
+
+static void test_close_drains_then_reports_closed(void) {
+    TEST("test_close_drains_then_reports_closed");
+
+    work_queue_t queue;
+    void *item;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 4));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(1)));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(2)));
+
+    work_queue_close(&queue);
+    work_queue_close(&queue); /* Idempotent */
+
+    /* Pushes are rejected, queued items are still delivered */
+    ASSERT_EQ(QUEUE_ERR_CLOSED, work_queue_push(&queue, ITEM(3)));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(1, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(2, ITEM_VALUE(item));
+    ASSERT_EQ(QUEUE_ERR_CLOSED, work_queue_pop(&queue, &item));
+
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Blocking and Wakeup Tests
+ * ==========================================================================
+ */
+
+static void test_push_blocks_until_pop(void) {
+    TEST("test_push_blocks_until_pop");
+
+    work_queue_t queue;
+    helper_t helper;
+    pthread_t thread;
+    void *item;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 1));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(1)));
+
+    helper_init(&helper, &queue, ITEM(2));
+    ASSERT_EQ(0, pthread_create(&thread, NULL, push_thread, &helper));
+
+    /* Queue is full - the producer must wait */
+    short_sleep();
+    ASSERT_EQ(0, helper_is_done(&helper));
+
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(1, ITEM_VALUE(item));
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ(QUEUE_OK, helper.result);
+    ASSERT_EQ(QUEUE_OK, work_queue_pop(&queue, &item));
+    ASSERT_EQ(2, ITEM_VALUE(item));
+
+    pthread_mutex_destroy(&helper.lock);
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+static void test_pop_blocks_until_push(void) {
+    TEST("test_pop_blocks_until_push");
+
+    work_queue_t queue;
+    helper_t helper;
+    pthread_t thread;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 2));
+
+    helper_init(&helper, &queue, NULL);
+    ASSERT_EQ(0, pthread_create(&thread, NULL, pop_thread, &helper));
+
+    short_sleep();
+    ASSERT_EQ(0, helper_is_done(&helper));
+
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&queue, ITEM(7)));
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ(QUEUE_OK, helper.result);
+    ASSERT_EQ(7, ITEM_VALUE(helper.item));
+
+    pthread_mutex_destroy(&helper.lock);
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+static void test_close_wakes_blocked_threads(void) {
+    TEST("test_close_wakes_blocked_threads");
+
+    work_queue_t empty_queue;
+    work_queue_t full_queue;
+    helper_t popper;
+    helper_t pusher;
+    pthread_t pop_tid;
+    pthread_t push_tid;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&empty_queue, 1));
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&full_queue, 1));
+    ASSERT_EQ(QUEUE_OK, work_queue_push(&full_queue, ITEM(1)));
+
+    helper_init(&popper, &empty_queue, NULL);
+    helper_init(&pusher, &full_queue, ITEM(2));
+    ASSERT_EQ(0, pthread_create(&pop_tid, NULL, pop_thread, &popper));
+    ASSERT_EQ(0, pthread_create(&push_tid, NULL, push_thread, &pusher));
+
+    short_sleep();
+    ASSERT_EQ(0, helper_is_done(&popper));
+    ASSERT_EQ(0, helper_is_done(&pusher));
+
+    work_queue_close(&empty_queue);
+    work_queue_close(&full_queue);
+
+    pthread_join(pop_tid, NULL);
+    pthread_join(push_tid, NULL);
+    ASSERT_EQ(QUEUE_ERR_CLOSED, popper.result);
+    ASSERT_EQ(QUEUE_ERR_CLOSED, pusher.result);
+
+    pthread_mutex_destroy(&popper.lock);
+    pthread_mutex_destroy(&pusher.lock);
+    work_queue_destroy(&empty_queue);
+    work_queue_destroy(&full_queue);
+    TEST_PASS();
+}
+
+/**
+ * Producer/consumer stress: every item arrives exactly once, in order.
+ */
+#define STRESS_ITEMS 10000
+
+static void *stress_producer(void *arg) {
+    work_queue_t *queue = (work_queue_t *)arg;
+
+    for (int i = 1; i <= STRESS_ITEMS; i++) {
+        if (work_queue_push(queue, ITEM(i)) != QUEUE_OK) {
+            break;
+        }
+    }
+    work_queue_close(queue);
+    return NULL;
+}
+
+static void test_producer_consumer_order(void) {
+    TEST("test_producer_consumer_order");
+
+    work_queue_t queue;
+    pthread_t thread;
+    void *item;
+    int expected = 1;
+
+    ASSERT_EQ(QUEUE_OK, work_queue_init(&queue, 4));
+    ASSERT_EQ(0, pthread_create(&thread, NULL, stress_producer, &queue));
+
+    while (work_queue_pop(&queue, &item) == QUEUE_OK) {
+        if (ITEM_VALUE(item) != expected) {
+            break;
+        }
+        expected++;
+    }
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ(STRESS_ITEMS + 1, expected);
+
+    work_queue_destroy(&queue);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Error String Tests
+ * ==========================================================================
+ */
+
+static void test_error_strings(void) {
+    TEST("test_error_strings");
+
+    ASSERT_TRUE(strcmp(queue_error_string(QUEUE_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(queue_error_string(QUEUE_ERR_CLOSED), "queue closed") == 0);
+    ASSERT_TRUE(strcmp(queue_error_string((queue_error_t)-99), "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Main Test Runner
+ * ==========================================================================
+ */
+
+int main(void) {
+    printf("Running queue tests...\n\n");
+
+    printf("=== Initialization Tests ===\n");
+    test_init_invalid_args();
+
+    printf("\n=== FIFO Ordering Tests ===\n");
+    test_fifo_order_with_wraparound();
+
+    printf("\n=== Priority Ordering Tests ===\n");
+    test_priority_order();
+
+    printf("\n=== Close/Drain Tests ===\n");
+    test_close_drains_then_reports_closed();
+
+    printf("\n=== Blocking and Wakeup Tests ===\n");
+    test_push_blocks_until_pop();
+    test_pop_blocks_until_push();
+    test_close_wakes_blocked_threads();
+    test_producer_consumer_order();
+
+    printf("\n=== Error String Tests ===\n");
+    test_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -26,6 +26,11 @@ void test_config_init(void) {
     assert(config.keep_clip_on_cpu == true);
     assert(config.keep_vae_on_cpu == false);
     assert(config.enable_flash_attn == true);
+    assert(config.device_index == -1);
+    assert(config.prepare_weights == false);
+    assert(config.weight_type == SD_WRAPPER_WTYPE_F16);
+    assert(config.vae_tile_pixels == 1024 * 1024);
+    assert(config.reuse_context == false);
 
     printf("[test_config_init] PASS\n");
 }
@@ -42,6 +47,8 @@ void test_gen_params_init(void) {
     assert(params.cfg_scale == 4.5f);
     assert(params.seed == 0);
     assert(params.clip_skip == 0);
+    assert(params.vae_tiling == SD_WRAPPER_VAE_TILING_AUTO);
+    assert(params.vae_tile_size == 0);
 
     printf("[test_gen_params_init] PASS\n");
 }
@@ -106,6 +113,34 @@ void test_get_error_null_context(void) {
     printf("[test_get_error_null_context] PASS\n");
 }
 
+void test_reset_null_context(void) {
+    assert(sd_wrapper_reset(NULL) == SD_WRAPPER_ERR_INVALID_PARAM);
+    assert(sd_wrapper_reset_mode(NULL, SD_WRAPPER_RESET_FULL) == SD_WRAPPER_ERR_INVALID_PARAM);
+    assert(sd_wrapper_reset_mode(NULL, SD_WRAPPER_RESET_COMPUTE) == SD_WRAPPER_ERR_INVALID_PARAM);
+
+    printf("[test_reset_null_context] PASS\n");
+}
+
+void test_progress_callback_null_context(void) {
+    assert(sd_wrapper_set_progress_callback(NULL, NULL, NULL, 0) == SD_WRAPPER_ERR_INVALID_PARAM);
+
+    printf("[test_progress_callback_null_context] PASS\n");
+}
+
+void test_abort_callback_null_context(void) {
+    assert(sd_wrapper_set_abort_callback(NULL, NULL, NULL) == SD_WRAPPER_ERR_INVALID_PARAM);
+
+    printf("[test_abort_callback_null_context] PASS\n");
+}
+
+void test_timings_null(void) {
+    static sd_wrapper_timings_t timings;
+
+    assert(sd_wrapper_get_timings(NULL, &timings) == SD_WRAPPER_ERR_INVALID_PARAM);
+
+    printf("[test_timings_null] PASS\n");
+}
+
 int main(void) {
     printf("Running SD wrapper tests...\n");
 
@@ -117,6 +152,10 @@ int main(void) {
     test_free_null_context();
     test_free_image_null();
     test_get_error_null_context();
+    test_reset_null_context();
+    test_timings_null();
+    test_progress_callback_null_context();
+    test_abort_callback_null_context();
 
     printf("\nAll SD wrapper tests passed.\n");
     printf("\nNote: These tests verify API correctness only.\n");
@@ -0,0 +1,368 @@
+/**
+ * Weave Server Stats Module - Unit Tests
+ *
+ * Tests that each request lifecycle keeps the stats gauges and the
+ * admission queue in step, that deadlines refuse requests once GPU time is
+ * known, and that snapshots combine the stats, buffer pool and admission
+ * values.
+ *
+ * Test categories:
+ * - Lifecycle tests
+ * - Admission tests
+ * - Snapshot tests
+ * - Argument and error string tests
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "weave/server_stats.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/** 100x100 at 10 steps: pixel-steps of make_request() */
+#define UNITS 100000
+
+static sd35_generate_request_t make_request(uint32_t priority) {
+    sd35_generate_request_t req;
+
+    memset(&req, 0, sizeof(req));
+    req.width = 100;
+    req.height = 100;
+    req.steps = 10;
+    req.priority = priority;
+    return req;
+}
+
+/**
+ * Run one request through every stage, its GPU stages taking gpu_us in all.
+ */
+static void run_request(server_stats_t *s, uint32_t priority, uint64_t gpu_us) {
+    sd35_generate_request_t req = make_request(priority);
+    sd35_generate_timings_t timings;
+    server_stats_ticket_t ticket;
+
+    memset(&timings, 0, sizeof(timings));
+    timings.stage_us[TIMING_STAGE_SAMPLING] = gpu_us;
+
+    server_stats_received(s);
+    server_stats_admit(s, &req, 1, NULL, &ticket, NULL);
+    server_stats_started(s, &ticket);
+    server_stats_generated(s, &ticket, &timings);
+    server_stats_finished(s, ERR_NONE, &timings);
+}
+
+/**
+ * ==========================================================================
+ * Lifecycle Tests
+ * ==========================================================================
+ */
+
+static void test_generated_lifecycle(void) {
+    sd35_generate_request_t req = make_request(SD35_PRIORITY_BATCH);
+    server_stats_ticket_t ticket;
+    stats_response_t resp;
+    server_stats_t s;
+
+    TEST("test_generated_lifecycle");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+
+    server_stats_received(&s);
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 2, NULL, &ticket, NULL));
+    ASSERT_EQ(SD35_PRIORITY_BATCH, ticket.priority);
+    ASSERT_TRUE(ticket.units == 2 * UNITS);
+
+    server_stats_snapshot(&s, 1, NULL, &resp);
+    ASSERT_EQ(1, resp.queue_depth);
+    ASSERT_EQ(1, resp.class_queue_depth[SD35_PRIORITY_BATCH]);
+
+    server_stats_started(&s, &ticket);
+    server_stats_snapshot(&s, 1, NULL, &resp);
+    ASSERT_EQ(0, resp.queue_depth);
+    ASSERT_EQ(1, resp.in_flight);
+    ASSERT_EQ(0, resp.class_queue_depth[SD35_PRIORITY_BATCH]);
+
+    server_stats_generated(&s, &ticket, NULL);
+    server_stats_finished(&s, ERR_NONE, NULL);
+    server_stats_snapshot(&s, 1, NULL, &resp);
+    ASSERT_EQ(0, resp.in_flight);
+    ASSERT_TRUE(resp.requests == 1);
+    ASSERT_TRUE(resp.completed == 1);
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+static void test_answered_lifecycle(void) {
+    stats_response_t resp;
+    server_stats_t s;
+
+    TEST("test_answered_lifecycle");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+
+    /* A cache hit or rejected request never reaches the queue */
+    server_stats_received(&s);
+    server_stats_answered(&s);
+    server_stats_finished(&s, ERR_BUSY, NULL);
+
+    server_stats_snapshot(&s, 1, NULL, &resp);
+    ASSERT_EQ(0, resp.queue_depth);
+    ASSERT_EQ(0, resp.in_flight);
+    ASSERT_TRUE(resp.requests == 1);
+    ASSERT_TRUE(resp.completed == 0);
+    for (uint32_t i = 0; i < SD35_PRIORITY_COUNT; i++) {
+        ASSERT_EQ(0, resp.class_queue_depth[i]);
+    }
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+static void test_unadmitted_generation(void) {
+    sd35_generate_request_t req = make_request(SD35_PRIORITY_INTERACTIVE);
+    server_stats_ticket_t ticket;
+    stats_response_t resp;
+    server_stats_t s;
+
+    TEST("test_unadmitted_generation");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+    server_stats_received(&s);
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, NULL, &ticket, NULL));
+
+    /* Generated one at a time: gauges move, the admitted request stays queued */
+    server_stats_received(&s);
+    server_stats_started(&s, NULL);
+    server_stats_generated(&s, NULL, NULL);
+
+    server_stats_snapshot(&s, 1, NULL, &resp);
+    ASSERT_EQ(1, resp.class_queue_depth[SD35_PRIORITY_INTERACTIVE]);
+    ASSERT_EQ(0, resp.class_wait_ms[SD35_PRIORITY_INTERACTIVE]);
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Admission Tests
+ * ==========================================================================
+ */
+
+static void test_deadline_refuses(void) {
+    sd35_generate_request_t req = make_request(SD35_PRIORITY_INTERACTIVE);
+    server_stats_ticket_t ticket;
+    struct timespec deadline;
+    uint64_t wait_us = 0;
+    server_stats_t s;
+
+    TEST("test_deadline_refuses");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+
+    /* Nothing is known yet: even a past deadline is admitted */
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, &deadline, &ticket, NULL));
+    server_stats_started(&s, &ticket);
+    server_stats_generated(&s, &ticket, NULL);
+
+    /* Teach it 1 us per pixel-step: a request now takes 100 ms */
+    run_request(&s, SD35_PRIORITY_INTERACTIVE, UNITS);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    ASSERT_EQ(SERVER_STATS_ERR_BUSY,
+              server_stats_admit(&s, &req, 1, &deadline, &ticket, &wait_us));
+
+    /* A deadline far enough out, or none, is admitted */
+    deadline.tv_sec += 60;
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, &deadline, &ticket, &wait_us));
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, NULL, &ticket, &wait_us));
+
+    /* Only the admitted 100 ms request is queued ahead of it */
+    ASSERT_TRUE(wait_us == UNITS);
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+static void test_failed_generation_teaches_nothing(void) {
+    sd35_generate_request_t req = make_request(SD35_PRIORITY_INTERACTIVE);
+    server_stats_ticket_t ticket;
+    uint64_t wait_us = 1;
+    server_stats_t s;
+
+    TEST("test_failed_generation_teaches_nothing");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, NULL, &ticket, NULL));
+    server_stats_started(&s, &ticket);
+    server_stats_generated(&s, &ticket, NULL);
+
+    /* Still no GPU time known, so nothing queued estimates a wait */
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_admit(&s, &req, 1, NULL, &ticket, &wait_us));
+    ASSERT_TRUE(wait_us == 0);
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Snapshot Tests
+ * ==========================================================================
+ */
+
+static void test_snapshot_combines(void) {
+    buffer_pool_config_t pool_config;
+    buffer_pool_t *pool = NULL;
+    stats_response_t resp;
+    server_stats_t s;
+    void *buf;
+
+    TEST("test_snapshot_combines");
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+    memset(&pool_config, 0, sizeof(pool_config));
+    pool_config.max_idle_bytes = 1 << 20;
+    ASSERT_EQ(BUFFER_POOL_OK, buffer_pool_create(&pool_config, &pool));
+
+    buf = buffer_pool_get(pool, 4096);
+    ASSERT_TRUE(buf != NULL);
+    buffer_pool_put(pool, buf, 4096);
+
+    run_request(&s, SD35_PRIORITY_INTERACTIVE, UNITS);
+    server_stats_set_vram(&s, 0, 1024);
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_snapshot(&s, 99, pool, &resp));
+    ASSERT_TRUE(resp.request_id == 99);
+    ASSERT_TRUE(resp.completed == 1);
+    ASSERT_TRUE(resp.vram_bytes == 1024);
+    ASSERT_TRUE(resp.pool_misses == 1);
+    ASSERT_TRUE(resp.pool_idle_bytes > 0);
+
+    /* Without a pool the pool counters are zero */
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_snapshot(&s, 99, NULL, &resp));
+    ASSERT_TRUE(resp.pool_misses == 0);
+    ASSERT_TRUE(resp.pool_idle_bytes == 0);
+
+    buffer_pool_destroy(pool);
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_null_arguments(void) {
+    sd35_generate_request_t req = make_request(SD35_PRIORITY_INTERACTIVE);
+    server_stats_ticket_t ticket;
+    stats_response_t resp;
+    server_stats_t s;
+
+    TEST("test_null_arguments");
+
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER, server_stats_init(NULL, 1));
+    ASSERT_EQ(SERVER_STATS_ERR_INVALID_ARG, server_stats_init(&s, 0));
+
+    ASSERT_EQ(SERVER_STATS_OK, server_stats_init(&s, 1));
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER,
+              server_stats_admit(NULL, &req, 1, NULL, &ticket, NULL));
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER,
+              server_stats_admit(&s, NULL, 1, NULL, &ticket, NULL));
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER, server_stats_admit(&s, &req, 1, NULL, NULL, NULL));
+    req.priority = SD35_PRIORITY_COUNT;
+    ASSERT_EQ(SERVER_STATS_ERR_INVALID_ARG,
+              server_stats_admit(&s, &req, 1, NULL, &ticket, NULL));
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER, server_stats_snapshot(NULL, 1, NULL, &resp));
+    ASSERT_EQ(SERVER_STATS_ERR_NULL_POINTER, server_stats_snapshot(&s, 1, NULL, NULL));
+
+    /* Recording into NULL is a no-op */
+    server_stats_received(NULL);
+    server_stats_answered(NULL);
+    server_stats_started(NULL, &ticket);
+    server_stats_generated(NULL, &ticket, NULL);
+    server_stats_finished(NULL, ERR_NONE, NULL);
+    server_stats_set_vram(NULL, 0, 1);
+    server_stats_destroy(NULL);
+
+    ASSERT_TRUE(strcmp(server_stats_error_string(SERVER_STATS_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(server_stats_error_string((server_stats_error_t)-100),
+                       "unknown error") == 0);
+
+    server_stats_destroy(&s);
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running server stats tests...\n\n");
+
+    printf("=== Lifecycle Tests ===\n");
+    test_generated_lifecycle();
+    test_answered_lifecycle();
+    test_unadmitted_generation();
+
+    printf("\n=== Admission Tests ===\n");
+    test_deadline_refuses();
+    test_failed_generation_teaches_nothing();
+
+    printf("\n=== Snapshot Tests ===\n");
+    test_snapshot_combines();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
@@ -21,9 +21,11 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -1010,6 +1012,177 @@ void test_accept_loop_handles_shutdown(void) {
     TEST_PASS();
 }
 
+/**
+ * Test: socket_event_loop argument checks
+ */
+void test_event_loop_invalid_args(void) {
+    TEST("test_event_loop_invalid_args");
+
+    socket_event_handlers_t handlers;
+    memset(&handlers, 0, sizeof(handlers));
+
+    ASSERT_EQ(SOCKET_ERR_INVALID_FD, socket_event_loop(-1, &handlers, NULL));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_TRUE(fd >= 0);
+    ASSERT_EQ(SOCKET_ERR_NULL_HANDLER, socket_event_loop(fd, NULL, NULL));
+    ASSERT_EQ(SOCKET_ERR_NULL_HANDLER, socket_event_loop(fd, &handlers, NULL));
+    close(fd);
+
+    TEST_PASS();
+}
+
+/**
+ * Event loop handlers for testing - echo bytes back upper-cased and shut
+ * down once two connections have closed.
+ */
+typedef struct {
+    int fd;
+} echo_conn_t;
+
+static int event_open_count = 0;
+static int event_close_count = 0;
+
+static void *echo_open(int client_fd, void *user_data) {
+    (void)user_data;
+    echo_conn_t *conn = calloc(1, sizeof(*conn));
+    if (conn != NULL) {
+        conn->fd = client_fd;
+        event_open_count++;
+    }
+    return conn;
+}
+
+static int echo_readable(void *arg, void *user_data) {
+    echo_conn_t *conn = arg;
+    char buf[64];
+    (void)user_data;
+
+    ssize_t n = recv(conn->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : 1;
+    }
+    if (n == 0) {
+        return 1;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] >= 'a' && buf[i] <= 'z') {
+            buf[i] = (char)(buf[i] - 'a' + 'A');
+        }
+    }
+    return write(conn->fd, buf, (size_t)n) == n ? 0 : 1;
+}
+
+static void echo_close(void *arg, void *user_data) {
+    echo_conn_t *conn = arg;
+    (void)user_data;
+
+    close(conn->fd);
+    free(conn);
+    if (++event_close_count >= 2) {
+        socket_request_shutdown();
+    }
+}
+
+/**
+ * connect_test_client - Connect to the test socket with a 5 second read timeout
+ */
+static int connect_test_client(void) {
+    char socket_path[SOCKET_PATH_MAX];
+    struct sockaddr_un addr;
+    struct timeval tv = {5, 0};
+
+    socket_get_path(socket_path, sizeof(socket_path));
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+/**
+ * Test: socket_event_loop serves a second client while the first is idle
+ *
+ * Client A connects and sends nothing. Client B connects and must get its
+ * echo while A is still open - a serial accept loop would be stuck on A.
+ * Then A is served too, both disconnect, and the loop shuts down.
+ */
+void test_event_loop_serves_concurrent_clients(void) {
+    TEST("test_event_loop_serves_concurrent_clients");
+
+    save_xdg_runtime_dir();
+    socket_reset_shutdown();
+
+    if (create_temp_dir() != 0) {
+        printf("  SKIP: Could not create temp directory\n");
+        restore_xdg_runtime_dir();
+        tests_passed++;
+        return;
+    }
+
+    setenv("XDG_RUNTIME_DIR", temp_dir, 1);
+
+    int listen_fd = -1;
+    socket_error_t err = socket_create(&listen_fd);
+    ASSERT_EQ(SOCKET_OK, err);
+
+    event_open_count = 0;
+    event_close_count = 0;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        char reply[2] = {0, 0};
+        close(listen_fd);
+
+        int fd_a = connect_test_client();
+        int fd_b = connect_test_client();
+        if (fd_a < 0 || fd_b < 0) {
+            _exit(1);
+        }
+
+        if (write(fd_b, "b", 1) != 1 || read(fd_b, reply, 1) != 1 || reply[0] != 'B') {
+            _exit(2);
+        }
+        if (write(fd_a, "a", 1) != 1 || read(fd_a, reply, 1) != 1 || reply[0] != 'A') {
+            _exit(3);
+        }
+
+        close(fd_a);
+        close(fd_b);
+        _exit(0);
+    }
+
+    ASSERT_TRUE(pid > 0);
+
+    socket_event_handlers_t handlers = {echo_open, echo_readable, echo_close};
+    err = socket_event_loop(listen_fd, &handlers, NULL);
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    close(listen_fd);
+    socket_cleanup();
+    cleanup_temp_dir();
+    socket_reset_shutdown();
+    restore_xdg_runtime_dir();
+
+    ASSERT_EQ(SOCKET_OK, err);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+    ASSERT_EQ(2, event_open_count);
+    ASSERT_EQ(2, event_close_count);
+
+    TEST_PASS();
+}
+
 /**
  * ==========================================================================
  * Socket Connect Tests
@@ -1589,6 +1762,9 @@ void test_error_strings(void) {
     ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_ACCEPT_FAILED), "accept");
     ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_NULL_HANDLER), "handler");
     ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_CONNECT_FAILED), "connect");
+    ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_SHM_FAILED), "shared memory");
+    ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_SEND_FAILED), "send");
+    ASSERT_STR_CONTAINS(socket_error_string(SOCKET_ERR_EPOLL_FAILED), "epoll");
 
     /* Unknown error should not crash */
     const char *unknown = socket_error_string((socket_error_t)-999);
@@ -1597,6 +1773,104 @@ void test_error_strings(void) {
     TEST_PASS();
 }
 
+/**
+ * ==========================================================================
+ * Shared Memory Transport Tests
+ * ==========================================================================
+ */
+
+/**
+ * Test: socket_create_shm and socket_send_with_fd reject bad arguments
+ */
+void test_shm_invalid_args(void) {
+    TEST("test_shm_invalid_args");
+
+    struct iovec iov = { .iov_base = "x", .iov_len = 1 };
+    int shm_fd;
+
+    ASSERT_EQ(SOCKET_ERR_NULL_POINTER, socket_create_shm(NULL, 1, &shm_fd));
+    ASSERT_EQ(SOCKET_ERR_NULL_POINTER, socket_create_shm(&iov, 1, NULL));
+    ASSERT_EQ(SOCKET_ERR_INVALID_FD, socket_send_with_fd(-1, "x", 1, 0));
+    ASSERT_EQ(SOCKET_ERR_INVALID_FD, socket_send_with_fd(0, "x", 1, -1));
+    ASSERT_EQ(SOCKET_ERR_NULL_POINTER, socket_send_with_fd(0, NULL, 1, 0));
+
+    TEST_PASS();
+}
+
+/**
+ * Test: memfd contents arrive intact with the data they were attached to
+ *
+ * Sends a header with a sealed memfd over a socketpair, then maps the
+ * received descriptor and checks size, contents, and that it is read-only.
+ */
+void test_shm_send_receive(void) {
+    TEST("test_shm_send_receive");
+
+    int sv[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+
+    static uint8_t first[4096];
+    static uint8_t second[8192];
+    memset(first, 0xA1, sizeof(first));
+    memset(second, 0xB2, sizeof(second));
+    struct iovec iov[2] = {
+        { .iov_base = first, .iov_len = sizeof(first) },
+        { .iov_base = second, .iov_len = sizeof(second) },
+    };
+
+    int shm_fd = -1;
+    ASSERT_EQ(SOCKET_OK, socket_create_shm(iov, 2, &shm_fd));
+
+    const char header[] = "header-bytes";
+    ASSERT_EQ(SOCKET_OK, socket_send_with_fd(sv[0], header, sizeof(header), shm_fd));
+    close(shm_fd);
+
+    /* Receive header and descriptor */
+    char received[sizeof(header)];
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec recv_iov = { .iov_base = received, .iov_len = sizeof(received) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &recv_iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ASSERT_EQ((ssize_t)sizeof(header), recvmsg(sv[1], &msg, 0));
+    ASSERT_TRUE(memcmp(received, header, sizeof(header)) == 0);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    ASSERT_TRUE(cmsg != NULL);
+    ASSERT_EQ(SCM_RIGHTS, cmsg->cmsg_type);
+    int received_fd;
+    memcpy(&received_fd, CMSG_DATA(cmsg), sizeof(int));
+
+    struct stat st;
+    ASSERT_EQ(0, fstat(received_fd, &st));
+    ASSERT_EQ(sizeof(first) + sizeof(second), (size_t)st.st_size);
+
+    uint8_t *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, received_fd, 0);
+    ASSERT_TRUE(map != MAP_FAILED);
+    int contents_ok = map[0] == 0xA1 && map[sizeof(first) - 1] == 0xA1 &&
+                      map[sizeof(first)] == 0xB2 && map[st.st_size - 1] == 0xB2;
+    munmap(map, (size_t)st.st_size);
+
+    /* Sealed: further writes are refused */
+    int write_refused = write(received_fd, "x", 1) < 0;
+
+    close(received_fd);
+    close(sv[0]);
+    close(sv[1]);
+
+    ASSERT_TRUE(contents_ok);
+    ASSERT_TRUE(write_refused);
+
+    TEST_PASS();
+}
+
 /**
  * ==========================================================================
  * Main Test Runner
@@ -1645,6 +1919,10 @@ int main(void) {
     test_accept_loop_null_handler();
     test_accept_loop_handles_shutdown();
 
+    printf("\n=== Event Loop Tests ===\n");
+    test_event_loop_invalid_args();
+    test_event_loop_serves_concurrent_clients();
+
     printf("\n=== Socket Connect Tests ===\n");
     test_connect_null_socket_path();
     test_connect_null_connected_fd();
@@ -1658,6 +1936,10 @@ int main(void) {
     test_client_terminates_on_close();
     test_client_handles_partial_io();
 
+    printf("\n=== Shared Memory Transport Tests ===\n");
+    test_shm_invalid_args();
+    test_shm_send_receive();
+
     printf("\n=== Error String Tests ===\n");
     test_error_strings();
 
@@ -0,0 +1,258 @@
+/**
+ * Weave Stats Module - Unit Tests
+ *
+ * Tests for request counters, gauges, error counts, VRAM totals and stage
+ * latency histograms.
+ *
+ * Test categories:
+ * - Counter tests
+ * - Histogram tests
+ * - Argument and error string tests
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/stats.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+/**
+ * ==========================================================================
+ * Counter Tests
+ * ==========================================================================
+ */
+
+static void test_lifecycle_gauges(void) {
+    stats_t stats;
+    stats_response_t resp;
+
+    TEST("test_lifecycle_gauges");
+
+    ASSERT_EQ(STATS_OK, stats_init(&stats));
+
+    stats_request_received(&stats);
+    stats_request_received(&stats);
+    stats_request_received(&stats);
+    stats_request_started(&stats);
+    stats_request_started(&stats);
+    stats_request_generated(&stats);
+
+    ASSERT_EQ(STATS_OK, stats_snapshot(&stats, 42, &resp));
+    ASSERT_TRUE(resp.request_id == 42);
+    ASSERT_EQ(STATUS_OK, resp.status);
+    ASSERT_TRUE(resp.requests == 3);
+    ASSERT_EQ(1, resp.queue_depth);
+    ASSERT_EQ(1, resp.in_flight);
+    ASSERT_TRUE(resp.completed == 0);
+
+    stats_request_started(&stats);
+    stats_request_generated(&stats);
+    stats_request_generated(&stats);
+    ASSERT_EQ(STATS_OK, stats_snapshot(&stats, 43, &resp));
+    ASSERT_EQ(0, resp.queue_depth);
+    ASSERT_EQ(0, resp.in_flight);
+
+    stats_destroy(&stats);
+    TEST_PASS();
+}
+
+static void test_error_counts(void) {
+    stats_t stats;
+    stats_response_t resp;
+
+    TEST("test_error_counts");
+
+    ASSERT_EQ(STATS_OK, stats_init(&stats));
+
+    stats_request_finished(&stats, ERR_NONE, NULL);
+    stats_request_finished(&stats, ERR_NONE, NULL);
+    stats_request_finished(&stats, ERR_TIMEOUT, NULL);
+    stats_request_finished(&stats, ERR_INVALID_STEPS, NULL);
+    stats_request_finished(&stats, ERR_TIMEOUT, NULL);
+    stats_request_finished(&stats, (error_code_t)500, NULL);
+
+    ASSERT_EQ(STATS_OK, stats_snapshot(&stats, 1, &resp));
+    ASSERT_TRUE(resp.completed == 2);
+
+    /* Ascending by code; unknown codes count as ERR_INTERNAL */
+    ASSERT_EQ(3, resp.error_count);
+    ASSERT_EQ(ERR_INVALID_STEPS, resp.errors[0].code);
+    ASSERT_TRUE(resp.errors[0].count == 1);
+    ASSERT_EQ(ERR_TIMEOUT, resp.errors[1].code);
+    ASSERT_TRUE(resp.errors[1].count == 2);
+    ASSERT_EQ(ERR_INTERNAL, resp.errors[2].code);
+    ASSERT_TRUE(resp.errors[2].count == 1);
+
+    stats_destroy(&stats);
+    TEST_PASS();
+}
+
+static void test_vram_total(void) {
+    stats_t stats;
+    stats_response_t resp;
+
+    TEST("test_vram_total");
+
+    ASSERT_EQ(STATS_OK, stats_init(&stats));
+
+    stats_set_vram(&stats, 0, 1000);
+    stats_set_vram(&stats, 1, 500);
+    stats_set_vram(&stats, 0, 2000);
+    stats_set_vram(&stats, STATS_MAX_DEVICES, 7);
+    stats_set_vram(&stats, -1, 7);
+
+    ASSERT_EQ(STATS_OK, stats_snapshot(&stats, 1, &resp));
+    ASSERT_TRUE(resp.vram_bytes == 2500);
+
+    stats_destroy(&stats);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Histogram Tests
+ * ==========================================================================
+ */
+
+static void test_bucket_index(void) {
+    TEST("test_bucket_index");
+
+    ASSERT_EQ(0, stats_bucket_index(0));
+    ASSERT_EQ(0, stats_bucket_index(1000));
+    ASSERT_EQ(1, stats_bucket_index(1001));
+    ASSERT_EQ(7, stats_bucket_index(1000000));
+    ASSERT_EQ(STATS_HISTOGRAM_BUCKETS - 2, stats_bucket_index(60000000));
+    ASSERT_EQ(STATS_HISTOGRAM_BUCKETS - 1, stats_bucket_index(60000001));
+    ASSERT_EQ(STATS_HISTOGRAM_BUCKETS - 1, stats_bucket_index(UINT64_MAX));
+
+    TEST_PASS();
+}
+
+static void test_stage_histograms(void) {
+    stats_t stats;
+    stats_response_t resp;
+    sd35_generate_timings_t timings;
+
+    TEST("test_stage_histograms");
+
+    ASSERT_EQ(STATS_OK, stats_init(&stats));
+
+    memset(&timings, 0, sizeof(timings));
+    timings.stage_us[TIMING_STAGE_SAMPLING] = 4000000;   /* 4 s */
+    timings.stage_us[TIMING_STAGE_WRITE] = 300;
+    stats_request_finished(&stats, ERR_NONE, &timings);
+
+    timings.stage_us[TIMING_STAGE_SAMPLING] = 6000000;   /* 6 s */
+    stats_request_finished(&stats, ERR_CANCELLED, &timings);
+
+    ASSERT_EQ(STATS_OK, stats_snapshot(&stats, 1, &resp));
+
+    ASSERT_TRUE(resp.bucket_bounds_us[0] == 1000);
+    ASSERT_TRUE(resp.bucket_bounds_us[STATS_HISTOGRAM_BUCKETS - 1] == UINT64_MAX);
+
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_SAMPLING].count == 2);
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_SAMPLING].sum_us == 10000000);
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_SAMPLING].buckets[stats_bucket_index(4000000)] == 1);
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_SAMPLING].buckets[stats_bucket_index(6000000)] == 1);
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_WRITE].buckets[0] == 2);
+
+    /* Stages that did not run are recorded as 0 */
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_RESET].count == 2);
+    ASSERT_TRUE(resp.histograms[TIMING_STAGE_RESET].buckets[0] == 2);
+
+    stats_destroy(&stats);
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_null_arguments(void) {
+    stats_t stats;
+    stats_response_t resp;
+
+    TEST("test_null_arguments");
+
+    ASSERT_EQ(STATS_ERR_NULL_POINTER, stats_init(NULL));
+    ASSERT_EQ(STATS_OK, stats_init(&stats));
+    ASSERT_EQ(STATS_ERR_NULL_POINTER, stats_snapshot(NULL, 1, &resp));
+    ASSERT_EQ(STATS_ERR_NULL_POINTER, stats_snapshot(&stats, 1, NULL));
+
+    /* Recording into NULL is a no-op */
+    stats_request_received(NULL);
+    stats_request_started(NULL);
+    stats_request_generated(NULL);
+    stats_request_finished(NULL, ERR_NONE, NULL);
+    stats_set_vram(NULL, 0, 1);
+    stats_destroy(NULL);
+
+    ASSERT_TRUE(strcmp(stats_error_string(STATS_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(stats_error_string((stats_error_t)-100), "unknown error") == 0);
+
+    stats_destroy(&stats);
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running stats tests...\n\n");
+
+    printf("=== Counter Tests ===\n");
+    test_lifecycle_gauges();
+    test_error_counts();
+    test_vram_total();
+
+    printf("\n=== Histogram Tests ===\n");
+    test_bucket_index();
+    test_stage_histograms();
+
+    printf("\n=== Argument and Error String Tests ===\n");
+    test_null_arguments();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}
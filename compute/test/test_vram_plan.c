@@ -0,0 +1,225 @@
+/**
+ * Weave VRAM Plan Module - Unit Tests
+ *
+ * Tests for choosing placement, weight type and VAE tiling from a VRAM
+ * budget. Model sizes are close to SD 3.5 Medium's files.
+ *
+ * Test categories:
+ * - Plan tests (one per card size)
+ * - Argument tests
+ * - Name and error string tests
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "weave/vram_plan.h"
+
+/**
+ * Test result tracking
+ */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) \
+    do { \
+        printf("Running: %s\n", name); \
+        tests_run++; \
+    } while(0)
+
+#define ASSERT_EQ(expected, actual) \
+    do { \
+        if ((expected) != (actual)) { \
+            printf("  FAIL: Expected %d, got %d at line %d\n", \
+                   (int)(expected), (int)(actual), __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define ASSERT_TRUE(expr) \
+    do { \
+        if (!(expr)) { \
+            printf("  FAIL: Assertion failed: %s at line %d\n", #expr, __LINE__); \
+            return; \
+        } \
+    } while(0)
+
+#define TEST_PASS() \
+    do { \
+        tests_passed++; \
+        printf("  PASS\n"); \
+    } while(0)
+
+#define GIB(x) ((size_t)((x) * 1024.0 * 1024.0 * 1024.0))
+
+/**
+ * Helper: SD 3.5 Medium sized input for a card with vram GiB free
+ */
+static vram_plan_input_t medium_input(double vram, uint32_t max_pixels) {
+    vram_plan_input_t input;
+
+    vram_plan_input_init(&input);
+    input.vram_free = GIB(vram);
+    input.diffusion_bytes = GIB(5.0);
+    input.text_encoder_bytes = GIB(6.5);
+    input.vae_bytes = GIB(0.2);
+    input.max_pixels = max_pixels;
+    return input;
+}
+
+/**
+ * ==========================================================================
+ * Plan Tests
+ * ==========================================================================
+ */
+
+static void test_24gb_everything_on_gpu(void) {
+    vram_plan_input_t input = medium_input(24.0, 2048 * 2048);
+    vram_plan_t plan;
+
+    TEST("test_24gb_everything_on_gpu");
+
+    ASSERT_EQ(VRAM_PLAN_OK, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_WTYPE_F16, plan.wtype);
+    ASSERT_TRUE(!plan.keep_clip_on_cpu);
+    ASSERT_TRUE(!plan.keep_vae_on_cpu);
+    ASSERT_TRUE(plan.vae_tile_pixels > 1536 * 1536);
+    ASSERT_TRUE(plan.peak_bytes + input.reserve_bytes <= input.vram_free);
+
+    /* Up to 1536x1536 decodes in one pass */
+    input = medium_input(24.0, 1536 * 1536);
+    ASSERT_EQ(VRAM_PLAN_OK, vram_plan_choose(&input, &plan));
+    ASSERT_TRUE(!plan.keep_clip_on_cpu);
+    ASSERT_EQ(0, plan.vae_tile_pixels);
+
+    TEST_PASS();
+}
+
+static void test_12gb_text_encoders_on_cpu(void) {
+    vram_plan_input_t input = medium_input(12.0, 2048 * 2048);
+    vram_plan_t plan;
+
+    TEST("test_12gb_text_encoders_on_cpu");
+
+    /* The hand-tuned RTX 4070 Super configuration, plus tiling for 2048px */
+    ASSERT_EQ(VRAM_PLAN_OK, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_WTYPE_F16, plan.wtype);
+    ASSERT_TRUE(plan.keep_clip_on_cpu);
+    ASSERT_TRUE(!plan.keep_vae_on_cpu);
+    ASSERT_TRUE(plan.vae_tile_pixels >= 1024 * 1024);
+    ASSERT_TRUE(plan.vae_tile_pixels < 1536 * 1536);
+    ASSERT_TRUE(plan.peak_bytes + input.reserve_bytes <= input.vram_free);
+
+    /* Small images decode in one pass */
+    input = medium_input(12.0, 512 * 512);
+    ASSERT_EQ(VRAM_PLAN_OK, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_WTYPE_F16, plan.wtype);
+    ASSERT_TRUE(plan.keep_clip_on_cpu);
+    ASSERT_EQ(0, plan.vae_tile_pixels);
+
+    TEST_PASS();
+}
+
+static void test_8gb_quantizes(void) {
+    vram_plan_input_t input = medium_input(8.0, 2048 * 2048);
+    vram_plan_t plan;
+
+    TEST("test_8gb_quantizes");
+
+    ASSERT_EQ(VRAM_PLAN_OK, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_WTYPE_Q8_0, plan.wtype);
+    ASSERT_TRUE(plan.keep_clip_on_cpu);
+    ASSERT_TRUE(!plan.keep_vae_on_cpu);
+    ASSERT_TRUE(plan.vae_tile_pixels > 0);
+    ASSERT_TRUE(plan.weight_bytes < GIB(3.0));
+
+    TEST_PASS();
+}
+
+static void test_nothing_fits(void) {
+    vram_plan_input_t input = medium_input(2.0, 2048 * 2048);
+    vram_plan_t plan;
+
+    TEST("test_nothing_fits");
+
+    /* Most frugal configuration is still returned */
+    ASSERT_EQ(VRAM_PLAN_ERR_NO_FIT, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_WTYPE_Q4_0, plan.wtype);
+    ASSERT_TRUE(plan.keep_clip_on_cpu);
+    ASSERT_TRUE(plan.keep_vae_on_cpu);
+    ASSERT_EQ(0, plan.vae_tile_pixels);
+
+    /* Less free memory than the reserve */
+    input = medium_input(0.25, 512 * 512);
+    ASSERT_EQ(VRAM_PLAN_ERR_NO_FIT, vram_plan_choose(&input, &plan));
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Argument Tests
+ * ==========================================================================
+ */
+
+static void test_invalid_arguments(void) {
+    vram_plan_input_t input = medium_input(12.0, 0);
+    vram_plan_t plan;
+
+    TEST("test_invalid_arguments");
+
+    ASSERT_EQ(VRAM_PLAN_ERR_INVALID, vram_plan_choose(&input, &plan));
+    ASSERT_EQ(VRAM_PLAN_ERR_NULL_POINTER, vram_plan_choose(NULL, &plan));
+    ASSERT_EQ(VRAM_PLAN_ERR_NULL_POINTER, vram_plan_choose(&input, NULL));
+
+    vram_plan_input_init(&input);
+    ASSERT_TRUE(input.reserve_bytes == VRAM_PLAN_DEFAULT_RESERVE_BYTES);
+    ASSERT_TRUE(input.vram_free == 0);
+
+    TEST_PASS();
+}
+
+/**
+ * ==========================================================================
+ * Name and Error String Tests
+ * ==========================================================================
+ */
+
+static void test_names_and_error_strings(void) {
+    TEST("test_names_and_error_strings");
+
+    ASSERT_TRUE(strcmp(vram_plan_wtype_name(VRAM_PLAN_WTYPE_F16), "f16") == 0);
+    ASSERT_TRUE(strcmp(vram_plan_wtype_name(VRAM_PLAN_WTYPE_Q8_0), "q8_0") == 0);
+    ASSERT_TRUE(strcmp(vram_plan_wtype_name(VRAM_PLAN_WTYPE_Q4_0), "q4_0") == 0);
+    ASSERT_TRUE(strcmp(vram_plan_error_string(VRAM_PLAN_OK), "success") == 0);
+    ASSERT_TRUE(strcmp(vram_plan_error_string(VRAM_PLAN_ERR_NO_FIT),
+                       "model does not fit in VRAM") == 0);
+    ASSERT_TRUE(strcmp(vram_plan_error_string((vram_plan_error_t)-100), "unknown error") == 0);
+
+    TEST_PASS();
+}
+
+int main(void) {
+    printf("Running VRAM plan tests...\n\n");
+
+    printf("=== Plan Tests ===\n");
+    test_24gb_everything_on_gpu();
+    test_12gb_text_encoders_on_cpu();
+    test_8gb_quantizes();
+    test_nothing_fits();
+
+    printf("\n=== Argument Tests ===\n");
+    test_invalid_arguments();
+
+    printf("\n=== Name and Error String Tests ===\n");
+    test_names_and_error_strings();
+
+    printf("\n========================================\n");
+    printf("Tests run: %d\n", tests_run);
+    printf("Tests passed: %d\n", tests_passed);
+    printf("Tests failed: %d\n", tests_run - tests_passed);
+    printf("========================================\n");
+
+    return (tests_run == tests_passed) ? 0 : 1;
+}